@@ -37,6 +37,7 @@ protected:
 
     // Implementation of RenderPass interface
     bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) override;
+    void compileShaders() override { mpRays->compileShaders(); }
     void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
     void renderGui(Gui* pGui) override;
     void execute(RenderContext* pRenderContext) override;
@@ -16,13 +16,20 @@
 # ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 **********************************************************************************************************************/
 
-void getLightData(in int index, in float3 hitPos, out float3 toLight, out float3 lightIntensity, out float distToLight)
+//     u picks the point on area lights, as two uniform random numbers.  (0.5, 0.5) is the light's center.
+void getLightData(in int index, in float3 hitPos, in float2 u, out float3 toLight, out float3 lightIntensity, out float distToLight)
 {
 	// Use built-in Falcor functions to fill in a LightSample data structure
 	//   -> See "Lights.slang" for it's definition
 	LightSample ls;
 	if (gLights[index].type == LightDirectional)
 		ls = evalDirectionalLight(gLights[index], hitPos);
+	else if (gLights[index].type == LightAreaRect)
+	{
+		// The intensity of the sample is already divided by its pdf
+		float pdf;
+		ls = sampleAreaRectLight(gLights[index], hitPos, u, pdf);
+	}
 	else
 		ls = evalPointLight(gLights[index], hitPos);
 
@@ -31,6 +38,12 @@ void getLightData(in int index, in float3 hitPos, out float3 toLight, out float3
 	distToLight = length(ls.posW - hitPos);
 }
 
+// Without random numbers, area lights are lit from their center
+void getLightData(in int index, in float3 hitPos, out float3 toLight, out float3 lightIntensity, out float distToLight)
+{
+	getLightData(index, hitPos, float2(0.5f, 0.5f), toLight, lightIntensity, distToLight);
+}
+
 // Utility function to get a vector perpendicular to an input vector 
 //    (from "Efficient Construction of Perpendicular Vectors Without Branching")
 float3 getPerpendicularVector(float3 u)
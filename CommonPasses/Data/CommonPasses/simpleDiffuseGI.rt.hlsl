@@ -95,7 +95,7 @@ void IndirectClosestHit(inout IndirectRayPayload rayData, BuiltInTriangleInterse
 	float distToLight;
 	float3 lightIntensity;
 	float3 toLight;
-	getLightData(lightToSample, shadeData.posW, toLight, lightIntensity, distToLight);
+	getLightData(lightToSample, shadeData.posW, float2(nextRand(rayData.rndSeed), nextRand(rayData.rndSeed)), toLight, lightIntensity, distToLight);
 
 	// Compute our lambertion term (L dot N)
 	float LdotN = saturate(dot(shadeData.N, toLight));
@@ -158,7 +158,7 @@ void SimpleDiffuseGIRayGen()
 		float distToLight;
 		float3 lightIntensity;
 		float3 toLight;
-		getLightData(lightToSample, worldPos.xyz, toLight, lightIntensity, distToLight);
+		getLightData(lightToSample, worldPos.xyz, float2(nextRand(randSeed), nextRand(randSeed)), toLight, lightIntensity, distToLight);
 
 		// Compute our lambertion term (L dot N)
 		float LdotN = saturate(dot(worldNorm.xyz, toLight));
@@ -21,7 +21,8 @@
 
 // A helper to extract important light data from internal Falcor data structures.  What's going on isn't particularly
 //     important -- any framework you use will expose internal scene data in some way.  Use your framework's utilities.
-void getLightData(in int index, in float3 hitPos, out float3 toLight, out float3 lightIntensity, out float distToLight)
+//     u picks the point on area lights, as two uniform random numbers.  (0.5, 0.5) is the light's center.
+void getLightData(in int index, in float3 hitPos, in float2 u, out float3 toLight, out float3 lightIntensity, out float distToLight)
 {
 	// Use built-in Falcor functions and data structures to fill in a LightSample data structure
 	//   -> See "Lights.slang" for it's definition
@@ -31,6 +32,13 @@ void getLightData(in int index, in float3 hitPos, out float3 toLight, out float3
 	if (gLights[index].type == LightDirectional)
 		ls = evalDirectionalLight(gLights[index], hitPos);
 
+	// A rectangular area light?  Sample a point on it.  The sample's intensity is already divided by its pdf.
+	else if (gLights[index].type == LightAreaRect)
+	{
+		float pdf;
+		ls = sampleAreaRectLight(gLights[index], hitPos, u, pdf);
+	}
+
 	// No?  Must be a point light.
 	else
 		ls = evalPointLight(gLights[index], hitPos);
@@ -41,6 +49,12 @@ void getLightData(in int index, in float3 hitPos, out float3 toLight, out float3
 	distToLight = length(ls.posW - hitPos);
 }
 
+// Without random numbers, area lights are lit from their center
+void getLightData(in int index, in float3 hitPos, out float3 toLight, out float3 lightIntensity, out float distToLight)
+{
+	getLightData(index, hitPos, float2(0.5f, 0.5f), toLight, lightIntensity, distToLight);
+}
+
 // Encapsulates a bunch of Falcor stuff into one simpler function. 
 //    -> This can only be called within a closest hit or any hit shader
 ShadingData getHitShadingData( BuiltinIntersectionAttribs attribs )
@@ -36,6 +36,7 @@ protected:
 
     // Implementation of RenderPass interface
     bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) override;
+    void compileShaders() override { mpRays->compileShaders(); }
     void execute(RenderContext* pRenderContext) override;
 	void renderGui(Gui* pGui) override;
 	void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
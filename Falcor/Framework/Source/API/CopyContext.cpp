@@ -63,9 +63,9 @@ namespace Falcor
         }
     }
 
-    CopyContext::ReadTextureTask::SharedPtr CopyContext::asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, Buffer::SharedPtr pStagingBuffer)
     {
-        return CopyContext::ReadTextureTask::create(shared_from_this(), pTexture, subresourceIndex);
+        return CopyContext::ReadTextureTask::create(shared_from_this(), pTexture, subresourceIndex, pStagingBuffer);
     }
 
     std::vector<uint8> CopyContext::readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
@@ -45,8 +45,18 @@ namespace Falcor
         {
         public:
             using SharedPtr = std::shared_ptr<ReadTextureTask>;
-            static SharedPtr create(CopyContext::SharedPtr pCtx, const Texture* pTexture, uint32_t subresourceIndex);
+            /** Record a copy of a texture subresource into a CPU-readable buffer and submit it.
+                \param[in] pStagingBuffer Optional readback buffer to copy into. It is used if it's large enough, otherwise a new buffer is allocated. Pass the result of a previous task's getBuffer() to recycle readback memory.
+            */
+            static SharedPtr create(CopyContext::SharedPtr pCtx, const Texture* pTexture, uint32_t subresourceIndex, Buffer::SharedPtr pStagingBuffer = nullptr);
+
+            /** Wait for the copy to complete and return the tightly packed texel data
+            */
             std::vector<uint8> getData();
+
+            /** Get the readback buffer the texture is copied into
+            */
+            const Buffer::SharedPtr& getBuffer() const { return mpBuffer; }
         private:
             ReadTextureTask() = default;
             GpuFence::SharedPtr mpFence;
@@ -122,7 +132,7 @@ namespace Falcor
 
         /** Read texture data Asynchronously
         */
-        ReadTextureTask::SharedPtr asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex);
+        ReadTextureTask::SharedPtr asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, Buffer::SharedPtr pStagingBuffer = nullptr);
         
         /** Get the low-level context data
         */
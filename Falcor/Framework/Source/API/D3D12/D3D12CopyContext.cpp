@@ -143,7 +143,7 @@ namespace Falcor
         pBuffer->unmap();
     }
 
-    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext::SharedPtr pCtx, const Texture* pTexture, uint32_t subresourceIndex)
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext::SharedPtr pCtx, const Texture* pTexture, uint32_t subresourceIndex, Buffer::SharedPtr pStagingBuffer)
     {
         SharedPtr pThis = SharedPtr(new ReadTextureTask);
         pThis->mpContext = pCtx;
@@ -155,8 +155,15 @@ namespace Falcor
         ID3D12Device* pDevice = gpDevice->getApiHandle();
         pDevice->GetCopyableFootprints(&texDesc, subresourceIndex, 1, 0, &footprint, &pThis->mRowCount, &rowSize, &size);
 
-        //Create buffer 
-        pThis->mpBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        //Create buffer, unless the caller gave us one that's big enough
+        if (pStagingBuffer && pStagingBuffer->getCpuAccess() == Buffer::CpuAccess::Read && pStagingBuffer->getSize() >= size)
+        {
+            pThis->mpBuffer = pStagingBuffer;
+        }
+        else
+        {
+            pThis->mpBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        }
 
         //Copy from texture to buffer
         D3D12_TEXTURE_COPY_LOCATION srcLoc = { pTexture->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX, subresourceIndex };
@@ -32,7 +32,8 @@
 namespace Falcor
 {
     RootSignature::SharedPtr RootSignature::spEmptySig;
-    uint64_t RootSignature::sObjCount = 0;
+    std::atomic<uint64_t> RootSignature::sObjCount = { 0 };
+    std::mutex RootSignature::sEmptySigMutex;
 
     RootSignature::Desc& RootSignature::Desc::addDescriptorSet(const DescriptorSetLayout& setLayout)
     {
@@ -57,14 +58,18 @@ namespace Falcor
 
     RootSignature::SharedPtr RootSignature::getEmpty()
     {
-        if (spEmptySig) return spEmptySig;
         return create(Desc());
     }
 
     RootSignature::SharedPtr RootSignature::create(const Desc& desc)
     {
         bool empty = desc.mSets.size() == 0;
-        if (empty && spEmptySig) return spEmptySig;
+        std::unique_lock<std::mutex> emptySigLock(sEmptySigMutex, std::defer_lock);
+        if (empty)
+        {
+            emptySigLock.lock();
+            if (spEmptySig) return spEmptySig;
+        }
 
         SharedPtr pSig = SharedPtr(new RootSignature(desc));
         if (pSig->apiInit() == false)
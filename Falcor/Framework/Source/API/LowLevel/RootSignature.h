@@ -28,6 +28,8 @@
 #pragma once
 #include "API/Sampler.h"
 #include "API/DescriptorSet.h"
+#include <atomic>
+#include <mutex>
 
 namespace Falcor
 {
@@ -87,7 +89,8 @@ namespace Falcor
         ApiHandle mApiHandle;
         Desc mDesc;
         static SharedPtr spEmptySig;
-        static uint64_t sObjCount;
+        static std::atomic<uint64_t> sObjCount;     // Programs (and their root signatures) may be created on several threads
+        static std::mutex sEmptySigMutex;
 
         uint32_t mSizeInBytes;
         std::vector<uint32_t> mElementByteOffset;
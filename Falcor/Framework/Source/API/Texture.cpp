@@ -28,7 +28,7 @@
 #include "Framework.h"
 #include "API/Texture.h"
 #include "API/Device.h"
-#include "Utils/ThreadPool.h"
+#include "Utils/AsyncFrameCapture.h"
 
 namespace Falcor
 {
@@ -126,16 +126,7 @@ namespace Falcor
 
     void Texture::captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format, Bitmap::ExportFlags exportFlags) const
     {
-        uint32_t subresource = getSubresourceIndex(arraySlice, mipLevel);
-        std::vector<uint8> textureData = gpDevice->getRenderContext()->readTextureSubresource(this, subresource);
-
-        auto func = [=]()
-        {
-            Bitmap::saveImage(filename, getWidth(mipLevel), getHeight(mipLevel), format, exportFlags, getFormat(), true, (void*)textureData.data());
-        };
-
-        static ThreadPool<16> sThreadPool;
-        sThreadPool.getAvailable() = std::thread(func);
+        AsyncFrameCapture::getDefault()->capture(this, mipLevel, arraySlice, filename, format, exportFlags);
     }
 
     void Texture::uploadInitData(const void* pData, bool autoGenMips)
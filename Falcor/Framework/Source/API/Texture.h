@@ -160,6 +160,7 @@ namespace Falcor
             \param[in] filename Name of the file to save.
             \param[in] fileFormat Destination image file format (e.g., PNG, PFM, etc.)
             \param[in] exportFlags Save flags, see Bitmap::ExportFlags
+            The file is written asynchronously by AsyncFrameCapture::getDefault(). Call its flush() if you need the file to exist when this returns.
         */
         void captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None) const;
 
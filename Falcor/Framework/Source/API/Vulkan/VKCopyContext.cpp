@@ -184,8 +184,9 @@ namespace Falcor
 
         dataSize = getMipLevelPackedDataSize(pTexture, vkCopy.imageExtent.width, vkCopy.imageExtent.height, vkCopy.imageExtent.depth, pTexture->getFormat());
 
-        // Upload the data to a staging buffer
-        pStaging = Buffer::create(dataSize, Buffer::BindFlags::None, pSrcData ? Buffer::CpuAccess::Write : Buffer::CpuAccess::Read, pSrcData);
+        // Upload the data to a staging buffer. Readbacks may pass in a recycled buffer.
+        bool reuseStaging = pStaging && (pSrcData == nullptr) && (pStaging->getCpuAccess() == Buffer::CpuAccess::Read) && (pStaging->getSize() >= dataSize);
+        if (!reuseStaging) pStaging = Buffer::create(dataSize, Buffer::BindFlags::None, pSrcData ? Buffer::CpuAccess::Write : Buffer::CpuAccess::Read, pSrcData);
         vkCopy.bufferOffset = pStaging->getGpuAddressOffset();
     }
 
@@ -219,12 +220,13 @@ namespace Falcor
         }
     }
 
-    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext::SharedPtr pCtx, const Texture* pTexture, uint32_t subresourceIndex)
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext::SharedPtr pCtx, const Texture* pTexture, uint32_t subresourceIndex, Buffer::SharedPtr pStagingBuffer)
     {
         SharedPtr pThis = SharedPtr(new ReadTextureTask);
         pThis->mpContext = pCtx;
 
         VkBufferImageCopy vkCopy;
+        pThis->mpBuffer = pStagingBuffer;
         initTexAccessParams(pTexture, subresourceIndex, vkCopy, pThis->mpBuffer, nullptr, {}, uvec3(-1, -1, -1), pThis->mDataSize);
 
         // Execute the copy
@@ -208,9 +208,9 @@ struct LightData
     float    penumbraAngle      DEFAULTS(0.f);              ///< For point (spot) light: Opening angle of penumbra region in radians, usually does not exceed openingAngle. 0.f by default, meaning a spot light with hard cut-off
 
     // Extra parameters for analytic area lights
-    float3   tangent			DEFAULTS(float3());         ///< Tangent vector of the light shape
+    float3   tangent			DEFAULTS(float3());         ///< Tangent vector of the light shape. Half the width of rectangular lights.
     float    surfaceArea		DEFAULTS(0.f);              ///< Surface area of the light shape
-    float3   bitangent			DEFAULTS(float3());         ///< Bitangent vector of the light shape
+    float3   bitangent			DEFAULTS(float3());         ///< Bitangent vector of the light shape. Half the height of rectangular lights.
     float    pad1;
     float4x4 transMat			DEFAULTS(float4x4());       ///< Transformation matrix of the light shape
     float4x4 transMatIT			DEFAULTS(float4x4());       ///< Inverse-transpose of transformation matrix of the light shape
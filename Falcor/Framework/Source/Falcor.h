@@ -76,6 +76,10 @@
 #include "Graphics/GraphicsState.h"
 #include "Graphics/FullScreenPass.h"
 #include "Graphics/TextureHelper.h"
+#include "Graphics/TextureCooker.h"
+#include "Graphics/TextureResidency.h"
+#include "Graphics/TextureFeedbackSimulator.h"
+#include "Graphics/TextureStreamer.h"
 #include "Graphics/Light.h"
 #include "Graphics/LightProbe.h"
 #include "Graphics/FboHelper.h"
@@ -86,6 +90,7 @@
 #include "Graphics/Program/ProgramVars.h"
 #include "Graphics/Program/ProgramVersion.h"
 #include "Graphics/Program/Program.h"
+#include "Graphics/Program/ProgramCache.h"
 #include "Graphics/Program/GraphicsProgram.h"
 #include "Graphics/Program/ComputeProgram.h"
 #include "Graphics/Program/ParameterBlock.h"
@@ -94,19 +99,35 @@
 #include "Graphics/Material/Material.h"
 
 // Model
+#include "Graphics/Model/CpuSkinning.h"
 #include "Graphics/Model/Mesh.h"
+#include "Graphics/Model/MeshletBuilder.h"
 #include "Graphics/Model/Model.h"
 #include "Graphics/Model/ModelRenderer.h"
+#include "Graphics/Model/Loaders/ModelCache.h"
 
 // Scene
 #include "Graphics/Scene/Scene.h"
 #include "Graphics/Scene/SceneRenderer.h"
+#include "Graphics/Scene/InstanceCuller.h"
+#include "Graphics/Scene/LightStore.h"
+#include "Graphics/Scene/LightScatterer.h"
+#include "Graphics/Scene/ScenePackage.h"
+#include "Graphics/Scene/TransformStore.h"
 #include "Graphics/Scene/Editor/SceneEditor.h"
 
+// BVH
+#include "Graphics/Bvh/Bvh.h"
+#include "Graphics/Bvh/BvhUpdateTracker.h"
+#include "Graphics/Bvh/MeshBvh.h"
+#include "Graphics/Bvh/SceneBvh.h"
+
 // Math
 #include "Utils/Math/FalcorMath.h"
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/ParallelReduction.h"
+#include "Utils/Math/SimdFloat4.h"
+#include "Utils/Math/SimdFloat8.h"
 
 // RenderGraph
 #include "Graphics/RenderGraph/RenderGraph.h"
@@ -124,10 +145,15 @@
 
 // Utils
 #include "Utils/Bitmap.h"
+#include "Utils/BlockCompression.h"
 #include "Utils/DDSHeader.h"
 #include "Utils/Font.h"
 #include "Utils/Gui.h"
 #include "Utils/Logger.h"
+#include "Utils/Lz4.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/MeshOptimizer.h"
+#include "Utils/MipGenerator.h"
 #include "Utils/TextRenderer.h"
 #include "Utils/CpuTimer.h"
 #include "Utils/UserInput.h"
@@ -140,6 +166,7 @@
 #include "Utils/Platform/OS.h"
 #include "Utils/Platform/ProgressBar.h"
 #include "Utils/ThreadPool.h"
+#include "Utils/AsyncFrameCapture.h"
 #include "Utils/PatternGenerators/DxSamplePattern.h"
 #include "Utils/PatternGenerators/HaltonSamplePattern.h"
 
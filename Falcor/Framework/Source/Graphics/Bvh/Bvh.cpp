@@ -0,0 +1,497 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Bvh.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kMaxBinCount = 32;
+
+        /** Bounds in SIMD registers. The 4th lane is unused.
+        */
+        struct Aabb
+        {
+            SimdFloat4 min;
+            SimdFloat4 max;
+
+            static Aabb empty() { return { SimdFloat4(FLT_MAX), SimdFloat4(-FLT_MAX) }; }
+
+            void grow(const Aabb& b)
+            {
+                min = simdMin(min, b.min);
+                max = simdMax(max, b.max);
+            }
+
+            float getHalfArea() const
+            {
+                float d[4];
+                simdMax(max - min, SimdFloat4(0.0f)).store(d);
+                return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+            }
+
+            void store(glm::vec3& pMin, glm::vec3& pMax) const
+            {
+                float a[4], b[4];
+                min.store(a);
+                max.store(b);
+                pMin = glm::vec3(a[0], a[1], a[2]);
+                pMax = glm::vec3(b[0], b[1], b[2]);
+            }
+        };
+
+        /** The bounds of a primitive being sorted into the tree. The build moves these around along with the primitive indices,
+            rather than looking them up through the indices, so it reads memory in order.
+        */
+        struct PrimRef
+        {
+            float min[4];   ///< The 4th components are 0. Anything else would risk denormals, which are very slow.
+            float max[4];
+
+            Aabb getBounds() const { return { SimdFloat4::load(min), SimdFloat4::load(max) }; }
+            SimdFloat4 getCentroid() const { return (SimdFloat4::load(min) + SimdFloat4::load(max)) * SimdFloat4(0.5f); }
+        };
+
+        struct Range
+        {
+            uint32_t begin;
+            uint32_t end;
+            uint32_t depth;
+            uint32_t node;      ///< Where the node of the range goes
+            Aabb bounds;
+        };
+
+        /** Builds the nodes of a range of primitives, either the whole tree or one subtree.
+        */
+        class Builder
+        {
+        public:
+            Builder(PrimRef* pRefs, uint32_t* pIndices, const Bvh::BuildDesc& desc) : mpRefs(pRefs), mpIndices(pIndices), mDesc(desc) {}
+
+            /** Build the subtree of a range. Ranges with fewer than taskThreshold primitives are returned in tasks instead of being built,
+                and their node is left for the caller to fill in.
+            */
+            void build(const Range& root, std::vector<BvhNode>& nodes, uint32_t taskThreshold, std::vector<Range>& tasks)
+            {
+                std::vector<Range> stack;
+                stack.push_back(root);
+                while (stack.empty() == false)
+                {
+                    Range r = stack.back();
+                    stack.pop_back();
+
+                    if (r.node != root.node && r.end - r.begin < taskThreshold)
+                    {
+                        tasks.push_back(r);
+                        continue;
+                    }
+
+                    BvhNode& node = nodes[r.node];
+                    r.bounds.store(node.boundsMin, node.boundsMax);
+                    mMaxDepth = std::max(mMaxDepth, r.depth);
+
+                    Range left, right;
+                    if (split(r, left, right) == false)
+                    {
+                        node.offset = r.begin;
+                        node.count = r.end - r.begin;
+                        mLeafCount++;
+                        mSahCost += r.bounds.getHalfArea() * node.count * mDesc.intersectionCost;
+                        continue;
+                    }
+
+                    mSahCost += r.bounds.getHalfArea() * mDesc.traversalCost;
+                    node.offset = (uint32_t)nodes.size();
+                    node.count = 0;
+                    left.node = node.offset;
+                    right.node = node.offset + 1;
+                    left.depth = right.depth = r.depth + 1;
+                    nodes.resize(nodes.size() + 2);
+
+                    // Keep the larger range at the top of the stack, so it's split further before the small ones are set aside as tasks
+                    if (left.end - left.begin > right.end - right.begin) std::swap(left, right);
+                    stack.push_back(left);
+                    stack.push_back(right);
+                }
+            }
+
+            uint32_t mLeafCount = 0;
+            uint32_t mMaxDepth = 0;
+            double mSahCost = 0;    ///< Unnormalized, sum of the half areas times the node costs
+
+        private:
+            Aabb getRangeBounds(uint32_t begin, uint32_t end) const
+            {
+                Aabb b = Aabb::empty();
+                for (uint32_t i = begin; i < end; i++) b.grow(mpRefs[i].getBounds());
+                return b;
+            }
+
+            /** Find the best binned SAH split of a range and partition it. Returns false if the range should be a leaf.
+            */
+            bool split(const Range& r, Range& left, Range& right)
+            {
+                uint32_t count = r.end - r.begin;
+                if (count <= 1) return false;
+                if (r.depth + 1 >= Bvh::kMaxDepth) return false;
+
+                SimdFloat4 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+                for (uint32_t i = r.begin; i < r.end; i++)
+                {
+                    SimdFloat4 c = mpRefs[i].getCentroid();
+                    centroidMin = simdMin(centroidMin, c);
+                    centroidMax = simdMax(centroidMax, c);
+                }
+                float extent[4];
+                (centroidMax - centroidMin).store(extent);
+
+                // Small ranges don't need as many bins as primitives
+                const uint32_t binCount = std::max(2u, std::min(std::min(mDesc.binCount, kMaxBinCount), count));
+                float scale[4];
+                for (int axis = 0; axis < 3; axis++) scale[axis] = extent[axis] > 0 ? binCount * (1 - 1e-5f) / extent[axis] : 0.0f;
+                scale[3] = 0;
+                const SimdFloat4 binScale = SimdFloat4::load(scale);
+                const uint32_t lastBin = binCount - 1;
+
+                // Bin the primitives along the 3 axes in one pass
+                Aabb bins[3][kMaxBinCount];
+                uint32_t binCounts[3][kMaxBinCount] = {};
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    for (uint32_t b = 0; b < binCount; b++) bins[axis][b] = Aabb::empty();
+                }
+                for (uint32_t i = r.begin; i < r.end; i++)
+                {
+                    const PrimRef& ref = mpRefs[i];
+                    Aabb primBounds = ref.getBounds();
+                    float binF[4];
+                    ((ref.getCentroid() - centroidMin) * binScale).store(binF);
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        uint32_t b = std::min(lastBin, (uint32_t)binF[axis]);
+                        bins[axis][b].grow(primBounds);
+                        binCounts[axis][b]++;
+                    }
+                }
+
+                float bestCost = FLT_MAX;
+                int bestAxis = -1;
+                uint32_t bestBin = 0;
+                Aabb bestLeft, bestRight;
+
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    if (extent[axis] <= 0) continue;
+
+                    // Sweep from the right to get the cost of everything past each split plane, then from the left
+                    float rightArea[kMaxBinCount];
+                    uint32_t rightCount[kMaxBinCount];
+                    Aabb rightBounds[kMaxBinCount];
+                    Aabb acc = Aabb::empty();
+                    uint32_t accCount = 0;
+                    for (uint32_t b = lastBin; b > 0; b--)
+                    {
+                        acc.grow(bins[axis][b]);
+                        accCount += binCounts[axis][b];
+                        rightBounds[b] = acc;
+                        rightArea[b] = acc.getHalfArea();
+                        rightCount[b] = accCount;
+                    }
+
+                    acc = Aabb::empty();
+                    accCount = 0;
+                    for (uint32_t b = 0; b < lastBin; b++)
+                    {
+                        acc.grow(bins[axis][b]);
+                        accCount += binCounts[axis][b];
+                        if (accCount == 0 || rightCount[b + 1] == 0) continue;
+                        float cost = acc.getHalfArea() * accCount + rightArea[b + 1] * rightCount[b + 1];
+                        if (cost < bestCost)
+                        {
+                            bestCost = cost;
+                            bestAxis = axis;
+                            bestBin = b;
+                            bestLeft = acc;
+                            bestRight = rightBounds[b + 1];
+                        }
+                    }
+                }
+
+                float area = r.bounds.getHalfArea();
+                float leafCost = mDesc.intersectionCost * count;
+                float splitCost = mDesc.traversalCost + mDesc.intersectionCost * (area > 0 ? bestCost / area : 0.0f);
+                if (count <= mDesc.maxLeafSize && (bestAxis < 0 || leafCost <= splitCost)) return false;
+
+                uint32_t mid = r.begin;
+                if (bestAxis >= 0)
+                {
+                    float minC[4];
+                    centroidMin.store(minC);
+                    const float axisMin = minC[bestAxis];
+                    const float axisScale = scale[bestAxis];
+                    auto isLeft = [&](const PrimRef& ref)
+                    {
+                        float c = (ref.min[bestAxis] + ref.max[bestAxis]) * 0.5f;
+                        return std::min(lastBin, (uint32_t)((c - axisMin) * axisScale)) <= bestBin;
+                    };
+
+                    // Partition the bounds and the indices together
+                    uint32_t i = r.begin, j = r.end;
+                    while (true)
+                    {
+                        while (i < j && isLeft(mpRefs[i])) i++;
+                        while (i < j && !isLeft(mpRefs[j - 1])) j--;
+                        if (i >= j) break;
+                        std::swap(mpRefs[i], mpRefs[j - 1]);
+                        std::swap(mpIndices[i], mpIndices[j - 1]);
+                        i++;
+                        j--;
+                    }
+                    mid = i;
+                    left.bounds = bestLeft;
+                    right.bounds = bestRight;
+                }
+
+                if (bestAxis < 0 || mid == r.begin || mid == r.end)
+                {
+                    // All the centroids are in the same place, or rounding put them all on one side. Split in the middle to respect the leaf size.
+                    mid = r.begin + count / 2;
+                    left.bounds = getRangeBounds(r.begin, mid);
+                    right.bounds = getRangeBounds(mid, r.end);
+                }
+
+                left.begin = r.begin;
+                left.end = mid;
+                right.begin = mid;
+                right.end = r.end;
+                return true;
+            }
+
+            PrimRef* mpRefs;
+            uint32_t* mpIndices;
+            Bvh::BuildDesc mDesc;
+        };
+    }
+
+    void Bvh::build(const glm::vec3* pBoundsMin, const glm::vec3* pBoundsMax, uint32_t primitiveCount, const BuildDesc& desc)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+
+        mNodes.clear();
+        mParents.clear();
+        mPrimitiveLeaves.clear();
+        mPrimitiveIndices.resize(primitiveCount);
+        mDesc = desc;
+        mStats = BuildStats();
+        mStats.primitiveCount = primitiveCount;
+        if (primitiveCount == 0) return;
+
+        std::vector<PrimRef> refs(primitiveCount);
+        Range root = { 0, primitiveCount, 0, 0, Aabb::empty() };
+        for (uint32_t i = 0; i < primitiveCount; i++)
+        {
+            mPrimitiveIndices[i] = i;
+            refs[i] = { { pBoundsMin[i].x, pBoundsMin[i].y, pBoundsMin[i].z, 0 }, { pBoundsMax[i].x, pBoundsMax[i].y, pBoundsMax[i].z, 0 } };
+            root.bounds.grow(refs[i].getBounds());
+        }
+
+        uint32_t threadCount = desc.threadCount ? desc.threadCount : WorkerPool::get().getThreadCount();
+        // Below this many primitives per thread the build isn't worth splitting up
+        const uint32_t kMinPrimitivesPerTask = 4096;
+        threadCount = std::max(1u, std::min(threadCount, primitiveCount / kMinPrimitivesPerTask));
+        mStats.threadCount = threadCount;
+
+        // Build the top of the tree, setting aside subtrees small enough to balance the work over the threads
+        uint32_t taskThreshold = threadCount > 1 ? std::max(kMinPrimitivesPerTask, primitiveCount / (threadCount * 8)) : 0;
+        Builder topBuilder(refs.data(), mPrimitiveIndices.data(), desc);
+        std::vector<Range> tasks;
+        mNodes.reserve(primitiveCount * 2);
+        mNodes.resize(1);
+        topBuilder.build(root, mNodes, taskThreshold, tasks);
+
+        uint32_t leafCount = topBuilder.mLeafCount;
+        uint32_t maxDepth = topBuilder.mMaxDepth;
+        double sahCost = topBuilder.mSahCost;
+
+        if (tasks.empty() == false)
+        {
+            // Largest subtrees first. They cover disjoint ranges of the primitives, so they can be partitioned concurrently.
+            std::sort(tasks.begin(), tasks.end(), [](const Range& a, const Range& b) { return a.end - a.begin > b.end - b.begin; });
+
+            struct Subtree
+            {
+                std::vector<BvhNode> nodes;
+                uint32_t leafCount = 0;
+                uint32_t maxDepth = 0;
+                double sahCost = 0;
+            };
+            std::vector<Subtree> subtrees(tasks.size());
+            parallelFor((uint32_t)tasks.size(), threadCount, [&](uint32_t t)
+            {
+                Range r = tasks[t];
+                r.node = 0;
+                Builder builder(refs.data(), mPrimitiveIndices.data(), desc);
+                std::vector<Range> unused;
+                Subtree& s = subtrees[t];
+                s.nodes.reserve((r.end - r.begin) * 2);
+                s.nodes.resize(1);
+                builder.build(r, s.nodes, 0, unused);
+                s.leafCount = builder.mLeafCount;
+                s.maxDepth = builder.mMaxDepth;
+                s.sahCost = builder.mSahCost;
+            });
+
+            // Append the subtrees. Their root goes where the top builder left room for it, the other nodes are shifted.
+            for (size_t t = 0; t < tasks.size(); t++)
+            {
+                const Subtree& s = subtrees[t];
+                uint32_t base = (uint32_t)mNodes.size() - 1;
+                auto remap = [base](BvhNode n)
+                {
+                    if (n.isLeaf() == false) n.offset += base;
+                    return n;
+                };
+                mNodes[tasks[t].node] = remap(s.nodes[0]);
+                for (size_t i = 1; i < s.nodes.size(); i++) mNodes.push_back(remap(s.nodes[i]));
+
+                leafCount += s.leafCount;
+                maxDepth = std::max(maxDepth, s.maxDepth);
+                sahCost += s.sahCost;
+            }
+        }
+        mNodes.shrink_to_fit();
+
+        mStats.nodeCount = (uint32_t)mNodes.size();
+        mStats.leafCount = leafCount;
+        mStats.maxDepth = maxDepth;
+        float rootArea = root.bounds.getHalfArea();
+        mStats.sahCost = rootArea > 0 ? sahCost / rootArea : 0;
+        mStats.timeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
+
+    void Bvh::refitLeaf(BvhNode& node, const glm::vec3* pBoundsMin, const glm::vec3* pBoundsMax) const
+    {
+        Aabb bounds = Aabb::empty();
+        for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+        {
+            uint32_t p = mPrimitiveIndices[i];
+            bounds.grow({ SimdFloat4(pBoundsMin[p].x, pBoundsMin[p].y, pBoundsMin[p].z, 0), SimdFloat4(pBoundsMax[p].x, pBoundsMax[p].y, pBoundsMax[p].z, 0) });
+        }
+        bounds.store(node.boundsMin, node.boundsMax);
+    }
+
+    void Bvh::refit(const glm::vec3* pBoundsMin, const glm::vec3* pBoundsMax)
+    {
+        // Children are always stored after their parent, so walking backwards visits them first
+        for (size_t n = mNodes.size(); n-- > 0;)
+        {
+            BvhNode& node = mNodes[n];
+            if (node.isLeaf())
+            {
+                refitLeaf(node, pBoundsMin, pBoundsMax);
+            }
+            else
+            {
+                const BvhNode& left = mNodes[node.offset];
+                const BvhNode& right = mNodes[node.offset + 1];
+                node.boundsMin = glm::vec3(std::min(left.boundsMin.x, right.boundsMin.x), std::min(left.boundsMin.y, right.boundsMin.y), std::min(left.boundsMin.z, right.boundsMin.z));
+                node.boundsMax = glm::vec3(std::max(left.boundsMax.x, right.boundsMax.x), std::max(left.boundsMax.y, right.boundsMax.y), std::max(left.boundsMax.z, right.boundsMax.z));
+            }
+        }
+    }
+
+    void Bvh::refit(const glm::vec3* pBoundsMin, const glm::vec3* pBoundsMax, const uint32_t* pChanged, uint32_t changedCount)
+    {
+        if (mNodes.empty()) return;
+        if (mParents.empty())
+        {
+            mParents.assign(mNodes.size(), uint32_t(-1));
+            mPrimitiveLeaves.resize(mPrimitiveIndices.size());
+            for (uint32_t n = 0; n < (uint32_t)mNodes.size(); n++)
+            {
+                const BvhNode& node = mNodes[n];
+                if (node.isLeaf())
+                {
+                    for (uint32_t i = node.offset; i < node.offset + node.count; i++) mPrimitiveLeaves[mPrimitiveIndices[i]] = n;
+                }
+                else
+                {
+                    mParents[node.offset] = mParents[node.offset + 1] = n;
+                }
+            }
+        }
+
+        for (uint32_t c = 0; c < changedCount; c++)
+        {
+            uint32_t n = mPrimitiveLeaves[pChanged[c]];
+            refitLeaf(mNodes[n], pBoundsMin, pBoundsMax);
+
+            // Walk up until a node's bounds don't change. Nodes above it only depend on it through its bounds.
+            for (n = mParents[n]; n != uint32_t(-1); n = mParents[n])
+            {
+                BvhNode& node = mNodes[n];
+                const BvhNode& left = mNodes[node.offset];
+                const BvhNode& right = mNodes[node.offset + 1];
+                glm::vec3 boundsMin(std::min(left.boundsMin.x, right.boundsMin.x), std::min(left.boundsMin.y, right.boundsMin.y), std::min(left.boundsMin.z, right.boundsMin.z));
+                glm::vec3 boundsMax(std::max(left.boundsMax.x, right.boundsMax.x), std::max(left.boundsMax.y, right.boundsMax.y), std::max(left.boundsMax.z, right.boundsMax.z));
+                if (boundsMin == node.boundsMin && boundsMax == node.boundsMax) break;
+                node.boundsMin = boundsMin;
+                node.boundsMax = boundsMax;
+            }
+        }
+    }
+
+    double Bvh::computeSahCost() const
+    {
+        if (mNodes.empty()) return 0;
+        auto getHalfArea = [](const BvhNode& node)
+        {
+            glm::vec3 d = node.boundsMax - node.boundsMin;
+            d = glm::vec3(std::max(d.x, 0.0f), std::max(d.y, 0.0f), std::max(d.z, 0.0f));
+            return double(d.x * d.y + d.y * d.z + d.z * d.x);
+        };
+
+        double cost = 0;
+        for (const BvhNode& node : mNodes)
+        {
+            cost += getHalfArea(node) * (node.isLeaf() ? node.count * mDesc.intersectionCost : mDesc.traversalCost);
+        }
+        double rootArea = getHalfArea(mNodes[0]);
+        return rootArea > 0 ? cost / rootArea : 0;
+    }
+
+    BoundingBox Bvh::getBounds() const
+    {
+        if (mNodes.empty()) return BoundingBox::fromMinMax(glm::vec3(0), glm::vec3(0));
+        return BoundingBox::fromMinMax(mNodes[0].boundsMin, mNodes[0].boundsMax);
+    }
+}
@@ -0,0 +1,391 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <float.h>
+#include <stddef.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/common.hpp"
+#include "Utils/AABB.h"
+#include "Utils/Math/SimdFloat4.h"
+#include "Utils/Math/SimdFloat8.h"
+
+namespace Falcor
+{
+    /** A BVH node. Interior nodes have two children stored next to each other, leaves reference a range of primitives.
+    */
+    struct BvhNode
+    {
+        glm::vec3 boundsMin;
+        uint32_t offset;        ///< Interior nodes: index of the first child. Leaves: index of the first primitive.
+        glm::vec3 boundsMax;
+        uint32_t count;         ///< Number of primitives in a leaf, 0 for interior nodes
+
+        bool isLeaf() const { return count != 0; }
+    };
+    static_assert(sizeof(BvhNode) == 32, "BvhNode must be 32 bytes");
+    static_assert(offsetof(BvhNode, boundsMax) == 16, "The traversal reads the bounds as one float array");
+
+    struct BvhRay
+    {
+        glm::vec3 origin;
+        float tMin = 0;
+        glm::vec3 direction;    ///< Doesn't need to be normalized
+        float tMax = FLT_MAX;
+    };
+
+    struct BvhHit
+    {
+        static const uint32_t kInvalidId = uint32_t(-1);
+
+        float t = FLT_MAX;
+        float u = 0;                        ///< Barycentrics of the hit point. The hit is at v0 * (1 - u - v) + v1 * u + v2 * v.
+        float v = 0;
+        uint32_t instanceId = kInvalidId;   ///< See SceneBvh::getInstance()
+        uint32_t primitiveId = kInvalidId;  ///< The triangle, as ordered in the mesh's index buffer
+
+        bool isValid() const { return primitiveId != kInvalidId; }
+    };
+
+    /** A packet of rays in SoA layout, traversed together using SimdFloat4 or SimdFloat8.
+        Lanes are masked out by 'active'; any-hit queries clear a lane when its ray hits something.
+    */
+    template<typename SimdT>
+    struct BvhRayPacket
+    {
+        static const uint32_t kWidth = SimdT::kWidth;
+
+        SimdT origin[3];
+        SimdT direction[3];
+        SimdT invDirection[3];
+        SimdT tMin;
+        SimdT tMax;
+        SimdT active;
+
+        /** Load kWidth rays. Lanes with tMin > tMax start inactive.
+        */
+        void load(const BvhRay* pRays);
+    };
+
+    /** Closest hits of a ray packet. The hit distances are the packet's tMax.
+    */
+    template<typename SimdT>
+    struct BvhPacketHit
+    {
+        static const uint32_t kWidth = SimdT::kWidth;
+
+        SimdT u;
+        SimdT v;
+        uint32_t instanceId[kWidth];
+        uint32_t primitiveId[kWidth];
+
+        void reset();
+    };
+
+    /** A binary bounding volume hierarchy over a set of primitives given by their bounds.
+        The build sorts the primitives into bins along each axis and splits at the bin boundary with the lowest surface area
+        heuristic cost, so it runs in O(n log n) regardless of how the primitives are spread. The top of the tree is built on the
+        calling thread; once the ranges are small enough, the subtrees are built in parallel and appended.
+        Users store their primitives in the order given by getPrimitiveIndices() and intersect them in the callbacks of
+        traverse() and traversePacket().
+    */
+    class Bvh
+    {
+    public:
+        static const uint32_t kMaxDepth = 64;   ///< Deeper ranges are turned into leaves. Also the size of the traversal stacks.
+
+        struct BuildDesc
+        {
+            uint32_t binCount = 16;         ///< Number of SAH bins per axis, at most 32
+            uint32_t maxLeafSize = 4;       ///< Larger ranges are always split
+            float traversalCost = 1.0f;     ///< Relative cost of visiting a node ...
+            float intersectionCost = 1.0f;  ///< ... and of intersecting a primitive
+            uint32_t threadCount = 0;       ///< 0 uses one thread per hardware thread
+        };
+
+        struct BuildStats
+        {
+            uint32_t primitiveCount = 0;
+            uint32_t nodeCount = 0;
+            uint32_t leafCount = 0;
+            uint32_t maxDepth = 0;
+            uint32_t threadCount = 0;
+            double sahCost = 0;         ///< Expected cost of tracing a ray through the tree, in units of intersectionCost
+            double timeMs = 0;
+        };
+
+        /** Build the hierarchy.
+            \param[in] pBoundsMin The min corner of each primitive's bounds
+            \param[in] pBoundsMax The max corner of each primitive's bounds
+        */
+        void build(const glm::vec3* pBoundsMin, const glm::vec3* pBoundsMax, uint32_t primitiveCount, const BuildDesc& desc);
+
+        bool isEmpty() const { return mNodes.empty(); }
+        const std::vector<BvhNode>& getNodes() const { return mNodes; }
+        BoundingBox getBounds() const;
+
+        /** The primitives in leaf order. Leaves reference ranges of this array.
+        */
+        const std::vector<uint32_t>& getPrimitiveIndices() const { return mPrimitiveIndices; }
+
+        const BuildStats& getBuildStats() const { return mStats; }
+        const BuildDesc& getBuildDesc() const { return mDesc; }
+
+        /** Update the node bounds after the primitives moved, keeping the tree.
+            \param[in] pBoundsMin, pBoundsMax The bounds of all the primitives, in the order they were passed to build()
+        */
+        void refit(const glm::vec3* pBoundsMin, const glm::vec3* pBoundsMax);
+
+        /** Update the bounds of the leaves holding the given primitives and of the nodes above them.
+            Cheaper than refitting the whole tree when few primitives moved.
+            \param[in] pChanged The primitives which moved, as indices into pBoundsMin and pBoundsMax
+        */
+        void refit(const glm::vec3* pBoundsMin, const glm::vec3* pBoundsMax, const uint32_t* pChanged, uint32_t changedCount);
+
+        /** Compute the SAH cost of the tree with its current bounds, normalized like BuildStats::sahCost. Refits make it grow as the tree degrades.
+        */
+        double computeSahCost() const;
+
+        /** Traverse the nodes a ray passes through, nearest first.
+            \param[in] ray The ray. ray.tMax is ignored in favor of tMax.
+            \param[in,out] tMax The farthest distance to look at. The leaf callback shrinks it when it finds a hit.
+            \param[in] leafFunc Called as bool(uint32_t firstPrimitive, uint32_t primitiveCount, float& tMax) for each leaf the ray enters.
+                Return true to stop the traversal (any-hit queries).
+        */
+        template<typename LeafFunc>
+        void traverse(const BvhRay& ray, float& tMax, LeafFunc leafFunc) const;
+
+        /** Traverse the nodes any active ray of a packet passes through.
+            \param[in] leafFunc Called as bool(uint32_t firstPrimitive, uint32_t primitiveCount, BvhRayPacket<SimdT>& packet) for each leaf.
+                It shrinks the packet's tMax on hits and may clear lanes. Return true to stop the traversal.
+        */
+        template<typename SimdT, typename LeafFunc>
+        void traversePacket(BvhRayPacket<SimdT>& packet, LeafFunc leafFunc) const;
+
+    private:
+        void refitLeaf(BvhNode& node, const glm::vec3* pBoundsMin, const glm::vec3* pBoundsMax) const;
+
+        std::vector<BvhNode> mNodes;
+        std::vector<uint32_t> mPrimitiveIndices;
+        BuildDesc mDesc;
+        BuildStats mStats;
+
+        // Created by the first partial refit
+        std::vector<uint32_t> mParents;             ///< Parent of each node
+        std::vector<uint32_t> mPrimitiveLeaves;     ///< Leaf holding each primitive, indexed like the build input
+    };
+
+    /** Get the reciprocal of a ray direction, replacing zeros by a tiny value so the slab test stays finite.
+        simdSafeInverse() does the same for packets.
+    */
+    inline glm::vec3 getSafeInverse(const glm::vec3& d)
+    {
+        const float kTiny = 1e-20f;
+        glm::vec3 r;
+        for (int i = 0; i < 3; i++) r[i] = 1.0f / (std::abs(d[i]) > kTiny ? d[i] : std::copysign(kTiny, d[i]));
+        return r;
+    }
+
+    template<typename SimdT>
+    SimdT simdSafeInverse(SimdT d)
+    {
+        // The sign of the replacement doesn't matter, the slab test orders the distances anyway
+        const float kTiny = 1e-20f;
+        SimdT isTiny = simdAnd(simdLess(d, SimdT(kTiny)), simdLess(SimdT(-kTiny), d));
+        return SimdT(1.0f) / simdSelect(d, SimdT(kTiny), isTiny);
+    }
+
+    template<typename SimdT>
+    void BvhRayPacket<SimdT>::load(const BvhRay* pRays)
+    {
+        float data[8][kWidth];
+        for (uint32_t l = 0; l < kWidth; l++)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                data[i][l] = pRays[l].origin[i];
+                data[3 + i][l] = pRays[l].direction[i];
+            }
+            data[6][l] = pRays[l].tMin;
+            data[7][l] = pRays[l].tMax;
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            origin[i] = SimdT::load(data[i]);
+            direction[i] = SimdT::load(data[3 + i]);
+            invDirection[i] = simdSafeInverse(direction[i]);
+        }
+        tMin = SimdT::load(data[6]);
+        tMax = SimdT::load(data[7]);
+        active = simdLessEqual(tMin, tMax);
+    }
+
+    template<typename SimdT>
+    void BvhPacketHit<SimdT>::reset()
+    {
+        u = SimdT(0.0f);
+        v = SimdT(0.0f);
+        for (uint32_t l = 0; l < kWidth; l++) instanceId[l] = primitiveId[l] = BvhHit::kInvalidId;
+    }
+
+    template<typename LeafFunc>
+    void Bvh::traverse(const BvhRay& ray, float& tMax, LeafFunc leafFunc) const
+    {
+        if (mNodes.empty()) return;
+
+        const glm::vec3 invDir = getSafeInverse(ray.direction);
+        const glm::vec3 originScaled = ray.origin * invDir;
+
+        // Which of the node's bounds the ray enters through on each axis, as offsets in the node read as floats (min at 0, max at 4)
+        const uint32_t nearX = invDir.x < 0 ? 4 : 0, nearY = invDir.y < 0 ? 5 : 1, nearZ = invDir.z < 0 ? 6 : 2;
+        const uint32_t farX = nearX ^ 4, farY = nearY ^ 4, farZ = nearZ ^ 4;
+
+        // Slab test, returns the entry distance or FLT_MAX on a miss
+        auto intersectNode = [&](const BvhNode& node)
+        {
+            const float* b = &node.boundsMin.x;
+            float enter = std::max(std::max(b[nearX] * invDir.x - originScaled.x, b[nearY] * invDir.y - originScaled.y), std::max(b[nearZ] * invDir.z - originScaled.z, ray.tMin));
+            float exit = std::min(std::min(b[farX] * invDir.x - originScaled.x, b[farY] * invDir.y - originScaled.y), std::min(b[farZ] * invDir.z - originScaled.z, tMax));
+            return enter <= exit ? enter : FLT_MAX;
+        };
+
+        if (intersectNode(mNodes[0]) == FLT_MAX) return;
+
+        // Children are tested from their parent, so the nearer one is visited first and the other one is pushed with its entry distance
+        struct Entry { uint32_t node; float t; };
+        Entry stack[kMaxDepth];
+        uint32_t stackSize = 0;
+        uint32_t nodeIndex = 0;
+
+        while (true)
+        {
+            const BvhNode& node = mNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                if (leafFunc(node.offset, node.count, tMax)) return;
+            }
+            else
+            {
+                float tLeft = intersectNode(mNodes[node.offset]);
+                float tRight = intersectNode(mNodes[node.offset + 1]);
+                if (tLeft != FLT_MAX || tRight != FLT_MAX)
+                {
+                    bool leftFirst = tLeft <= tRight;
+                    nodeIndex = leftFirst ? node.offset : node.offset + 1;
+                    if (tLeft != FLT_MAX && tRight != FLT_MAX)
+                    {
+                        stack[stackSize++] = leftFirst ? Entry{ node.offset + 1, tRight } : Entry{ node.offset, tLeft };
+                    }
+                    continue;
+                }
+            }
+
+            // Pop the next node which is still closer than the nearest hit
+            do
+            {
+                if (stackSize == 0) return;
+                stackSize--;
+            } while (stack[stackSize].t > tMax);
+            nodeIndex = stack[stackSize].node;
+        }
+    }
+
+    template<typename SimdT, typename LeafFunc>
+    void Bvh::traversePacket(BvhRayPacket<SimdT>& packet, LeafFunc leafFunc) const
+    {
+        if (mNodes.empty() || simdMoveMask(packet.active) == 0) return;
+
+        SimdT originScaled[3];
+        for (int i = 0; i < 3; i++) originScaled[i] = packet.origin[i] * packet.invDirection[i];
+
+        // Children are visited in the order of the packet's average direction. Finding the nearest entry over the lanes costs more than it saves.
+        float dirSign[3];
+        for (int i = 0; i < 3; i++)
+        {
+            float d[SimdT::kWidth];
+            simdSelect(SimdT(0.0f), packet.direction[i], packet.active).store(d);
+            float sum = 0;
+            for (uint32_t l = 0; l < SimdT::kWidth; l++) sum += d[l];
+            dirSign[i] = sum < 0 ? -1.0f : 1.0f;
+        }
+
+        // Slab test for all the lanes, returns a bit mask of the lanes which hit
+        auto intersectNode = [&](const BvhNode& node)
+        {
+            SimdT enter = packet.tMin;
+            SimdT exit = packet.tMax;
+            for (int i = 0; i < 3; i++)
+            {
+                SimdT t0 = SimdT(node.boundsMin[i]) * packet.invDirection[i] - originScaled[i];
+                SimdT t1 = SimdT(node.boundsMax[i]) * packet.invDirection[i] - originScaled[i];
+                enter = simdMax(enter, simdMin(t0, t1));
+                exit = simdMin(exit, simdMax(t0, t1));
+            }
+            return simdMoveMask(simdAnd(simdLessEqual(enter, exit), packet.active));
+        };
+
+        if (intersectNode(mNodes[0]) == 0) return;
+
+        uint32_t stack[kMaxDepth];
+        uint32_t stackSize = 0;
+        uint32_t nodeIndex = 0;
+
+        while (true)
+        {
+            const BvhNode& node = mNodes[nodeIndex];
+            if (node.isLeaf())
+            {
+                if (leafFunc(node.offset, node.count, packet) || simdMoveMask(packet.active) == 0) return;
+            }
+            else
+            {
+                const BvhNode& left = mNodes[node.offset];
+                const BvhNode& right = mNodes[node.offset + 1];
+                bool hitLeft = intersectNode(left) != 0;
+                bool hitRight = intersectNode(right) != 0;
+                if (hitLeft || hitRight)
+                {
+                    // Visit the child which comes first along the axis the children are most apart on
+                    glm::vec3 d = (left.boundsMin + left.boundsMax) - (right.boundsMin + right.boundsMax);
+                    glm::vec3 a = glm::abs(d);
+                    int axis = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+                    bool leftFirst = hitLeft && (!hitRight || d[axis] * dirSign[axis] <= 0);
+                    nodeIndex = leftFirst ? node.offset : node.offset + 1;
+                    if (hitLeft && hitRight) stack[stackSize++] = leftFirst ? node.offset + 1 : node.offset;
+                    continue;
+                }
+            }
+
+            if (stackSize == 0) return;
+            nodeIndex = stack[--stackSize];
+        }
+    }
+}
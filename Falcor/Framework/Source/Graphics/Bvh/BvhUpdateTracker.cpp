@@ -0,0 +1,107 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "BvhUpdateTracker.h"
+#include <string.h>
+
+namespace Falcor
+{
+    BvhUpdateType BvhUpdateTracker::decide(bool structureChanged, bool geometryChanged, double cost) const
+    {
+        if (structureChanged || mIsBuilt == false) return BvhUpdateType::Rebuild;
+        if (geometryChanged == false) return BvhUpdateType::None;
+        if (mPolicy.allowRefit == false) return BvhUpdateType::Rebuild;
+        if (mPolicy.maxRefitCount > 0 && mRefitCount >= mPolicy.maxRefitCount) return BvhUpdateType::Rebuild;
+        if (mPolicy.maxCostGrowth > 0 && cost > 0 && mRebuildCost > 0 && cost > mRebuildCost * mPolicy.maxCostGrowth) return BvhUpdateType::Rebuild;
+        return BvhUpdateType::Refit;
+    }
+
+    void BvhUpdateTracker::onUpdated(BvhUpdateType type, double cost)
+    {
+        switch (type)
+        {
+        case BvhUpdateType::Rebuild:
+            mIsBuilt = true;
+            mRefitCount = 0;
+            mRebuildCost = cost;
+            mCost = cost;
+            break;
+        case BvhUpdateType::Refit:
+            mRefitCount++;
+            mCost = cost;
+            break;
+        default:
+            break;
+        }
+    }
+
+    bool InstanceChangeTracker::update(const std::vector<Instance>& instances)
+    {
+        mDirty.clear();
+        uint32_t count = (uint32_t)instances.size();
+        bool structureChanged = (mIsValid == false) || (count != (uint32_t)mInstances.size());
+        if (structureChanged)
+        {
+            mInstances = instances;
+            mIsValid = true;
+            mDirty.resize(count);
+            for (uint32_t i = 0; i < count; i++) mDirty[i] = i;
+            return true;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const Instance& inst = instances[i];
+            Instance& prev = mInstances[i];
+            // Bitwise comparison, so a transform which is rewritten with the same values stays clean
+            if (inst.geometryId != prev.geometryId || inst.flags != prev.flags || memcmp(&inst.transform, &prev.transform, sizeof(glm::mat4)) != 0)
+            {
+                prev = inst;
+                mDirty.push_back(i);
+            }
+        }
+        return false;
+    }
+
+    std::vector<InstanceChangeTracker::Range> InstanceChangeTracker::getDirtyRanges(uint32_t maxGap) const
+    {
+        std::vector<Range> ranges;
+        for (uint32_t i : mDirty)
+        {
+            if (ranges.size() && i <= ranges.back().first + ranges.back().count + maxGap)
+            {
+                ranges.back().count = i - ranges.back().first + 1;
+            }
+            else
+            {
+                ranges.push_back({ i, 1 });
+            }
+        }
+        return ranges;
+    }
+}
@@ -0,0 +1,156 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "glm/mat4x4.hpp"
+
+namespace Falcor
+{
+    /** How an acceleration structure is brought up to date after its primitives changed
+    */
+    enum class BvhUpdateType
+    {
+        None,       ///< Nothing changed
+        Refit,      ///< Keep the tree and recompute its bounds. Much cheaper than a rebuild, but the tree degrades as the primitives move away from where they were when it was built.
+        Rebuild,    ///< Build the tree from scratch
+    };
+
+    inline std::string to_string(BvhUpdateType type)
+    {
+        switch (type)
+        {
+        case BvhUpdateType::None: return "None";
+        case BvhUpdateType::Refit: return "Refit";
+        case BvhUpdateType::Rebuild: return "Rebuild";
+        default: should_not_get_here(); return "";
+        }
+    }
+
+    /** Decides when an acceleration structure whose primitives move is refit and when it is rebuilt.
+        The tracker compares a cost estimate of the refit structure with the cost right after the last rebuild, and asks for a rebuild once
+        it grew by more than Policy::maxCostGrowth, or after Policy::maxRefitCount refits in a row. What the cost is depends on what the
+        caller can measure: the SAH cost for a CPU BVH (see Bvh::computeSahCost()), or a cheaper estimate such as the surface area of the
+        primitives' bounds when the structure lives on the GPU.
+        This is the decision logic only, shared by the DXR acceleration structures and their CPU equivalent (SceneBvh).
+    */
+    class BvhUpdateTracker
+    {
+    public:
+        struct Policy
+        {
+            bool allowRefit = true;         ///< If false, every change rebuilds the structure
+            uint32_t maxRefitCount = 64;    ///< Rebuild after this many refits in a row. 0 for no limit.
+            float maxCostGrowth = 1.5f;     ///< Rebuild once the cost grew by this factor since the last rebuild. 0 disables the test.
+        };
+
+        BvhUpdateTracker() = default;
+        BvhUpdateTracker(const Policy& policy) : mPolicy(policy) {}
+
+        /** Decide how to update the structure. Doesn't change the tracker's state, call onUpdated() once the update is done.
+            CPU structures are cheap to refit, so they can be refit first and pass the resulting cost, then rebuilt if this asks for it.
+            \param[in] structureChanged Primitives were added or removed. A refit can't handle that. Also forced until the first rebuild.
+            \param[in] geometryChanged Primitives moved
+            \param[in] cost The cost estimate of the refit structure. 0 if it isn't known, which skips the cost test.
+        */
+        BvhUpdateType decide(bool structureChanged, bool geometryChanged, double cost = 0) const;
+
+        /** Record an update
+            \param[in] cost The cost estimate after the update. After a rebuild, this is the reference further refits are compared to.
+        */
+        void onUpdated(BvhUpdateType type, double cost = 0);
+
+        /** Force a rebuild on the next change
+        */
+        void invalidate() { mIsBuilt = false; }
+
+        /** Number of refits since the last rebuild
+        */
+        uint32_t getRefitCount() const { return mRefitCount; }
+
+        /** Get the last cost estimate divided by the cost after the last rebuild, or 1 if the costs aren't known
+        */
+        double getCostGrowth() const { return (mRebuildCost > 0 && mCost > 0) ? mCost / mRebuildCost : 1.0; }
+
+        const Policy& getPolicy() const { return mPolicy; }
+        void setPolicy(const Policy& policy) { mPolicy = policy; }
+
+    private:
+        Policy mPolicy;
+        bool mIsBuilt = false;
+        uint32_t mRefitCount = 0;
+        double mRebuildCost = 0;
+        double mCost = 0;
+    };
+
+    /** Finds the instances of a top-level structure which changed since the previous frame, so only those get new transforms and are
+        re-uploaded. Instances are identified by their position in the list; a different count is a structure change.
+    */
+    class InstanceChangeTracker
+    {
+    public:
+        struct Instance
+        {
+            glm::mat4 transform;
+            uint64_t geometryId = 0;    ///< What the instance references, such as the address of its BLAS. Changing it dirties the instance.
+            uint32_t flags = 0;         ///< Anything else stored per instance, such as culling flags. Changing it dirties the instance.
+        };
+
+        /** A range of consecutive dirty instances
+        */
+        struct Range
+        {
+            uint32_t first;
+            uint32_t count;
+        };
+
+        /** Compare the instances with the previous call's. Afterwards getDirtyInstances() lists the changes.
+            \return true if the instance count changed. All the instances are dirty then.
+        */
+        bool update(const std::vector<Instance>& instances);
+
+        /** Forget the previous instances, so the next update() reports a structure change
+        */
+        void reset() { mInstances.clear(); mIsValid = false; }
+
+        const std::vector<uint32_t>& getDirtyInstances() const { return mDirty; }
+
+        /** Get the dirty instances merged into ranges
+            \param[in] maxGap Clean instances between two dirty ones which are merged into the range, to save uploads. 0 merges only adjacent instances.
+        */
+        std::vector<Range> getDirtyRanges(uint32_t maxGap = 0) const;
+
+        const std::vector<Instance>& getInstances() const { return mInstances; }
+
+    private:
+        std::vector<Instance> mInstances;
+        std::vector<uint32_t> mDirty;
+        bool mIsValid = false;
+    };
+}
@@ -0,0 +1,349 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshBvh.h"
+#include "Graphics/Model/Mesh.h"
+#include "Data/VertexAttrib.h"
+#include <cstring>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Moller-Trumbore ray/triangle test. Returns true on a hit closer than tMax.
+        */
+        bool intersectTriangle(const MeshBvh::Triangle& tri, const glm::vec3& origin, const glm::vec3& dir, float tMin, float tMax, float& t, float& u, float& v)
+        {
+            glm::vec3 p = glm::cross(dir, tri.e2);
+            float det = glm::dot(tri.e1, p);
+            if (det == 0) return false;
+            float invDet = 1.0f / det;
+            glm::vec3 s = origin - tri.v0;
+            u = glm::dot(s, p) * invDet;
+            if (u < 0 || u > 1) return false;
+            glm::vec3 q = glm::cross(s, tri.e1);
+            v = glm::dot(dir, q) * invDet;
+            if (v < 0 || u + v > 1) return false;
+            t = glm::dot(tri.e2, q) * invDet;
+            return t >= tMin && t < tMax;
+        }
+
+        /** The same test for all the lanes of a packet. Returns the lanes which hit.
+        */
+        template<typename SimdT>
+        SimdT intersectTriangle(const MeshBvh::Triangle& tri, const BvhRayPacket<SimdT>& packet, SimdT& t, SimdT& u, SimdT& v)
+        {
+            const SimdT* d = packet.direction;
+            SimdT e1[3] = { SimdT(tri.e1.x), SimdT(tri.e1.y), SimdT(tri.e1.z) };
+            SimdT e2[3] = { SimdT(tri.e2.x), SimdT(tri.e2.y), SimdT(tri.e2.z) };
+            SimdT p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+            SimdT det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+            SimdT invDet = SimdT(1.0f) / det;
+            SimdT s[3] = { packet.origin[0] - SimdT(tri.v0.x), packet.origin[1] - SimdT(tri.v0.y), packet.origin[2] - SimdT(tri.v0.z) };
+            u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+            SimdT q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+            v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * invDet;
+            t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+
+            const SimdT zero(0.0f);
+            SimdT hit = simdAnd(packet.active, simdOr(simdLess(det, zero), simdLess(zero, det)));
+            hit = simdAnd(hit, simdAnd(simdLessEqual(zero, u), simdLessEqual(zero, v)));
+            hit = simdAnd(hit, simdLessEqual(u + v, SimdT(1.0f)));
+            hit = simdAnd(hit, simdAnd(simdLessEqual(packet.tMin, t), simdLess(t, packet.tMax)));
+            return hit;
+        }
+
+        template<typename SimdT>
+        void intersectRays(const MeshBvh* pBvh, const BvhRay* pRays, BvhHit* pHits)
+        {
+            const uint32_t kWidth = SimdT::kWidth;
+            BvhRay rays[kWidth];
+            for (uint32_t l = 0; l < kWidth; l++)
+            {
+                rays[l] = pRays[l];
+                rays[l].tMax = std::min(rays[l].tMax, pHits[l].t);
+            }
+
+            BvhRayPacket<SimdT> packet;
+            packet.load(rays);
+            BvhPacketHit<SimdT> hit;
+            hit.reset();
+            pBvh->intersectPacket(packet, hit, BvhHit::kInvalidId);
+
+            float t[kWidth], u[kWidth], v[kWidth];
+            packet.tMax.store(t);
+            hit.u.store(u);
+            hit.v.store(v);
+            for (uint32_t l = 0; l < kWidth; l++)
+            {
+                if (hit.primitiveId[l] == BvhHit::kInvalidId) continue;
+                pHits[l].t = t[l];
+                pHits[l].u = u[l];
+                pHits[l].v = v[l];
+                pHits[l].primitiveId = hit.primitiveId[l];
+            }
+        }
+
+        template<typename SimdT>
+        uint32_t occludedRays(const MeshBvh* pBvh, const BvhRay* pRays)
+        {
+            BvhRayPacket<SimdT> packet;
+            packet.load(pRays);
+            int valid = simdMoveMask(packet.active);
+            pBvh->occludedPacket(packet);
+            return (uint32_t)(valid & ~simdMoveMask(packet.active));
+        }
+    }
+
+    bool MeshBvh::readMeshGeometry(const Mesh* pMesh, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+    {
+        const Vao* pVao = pMesh->getVao().get();
+        if (pVao->getPrimitiveTopology() != Vao::Topology::TriangleList || pVao->getIndexBuffer() == nullptr)
+        {
+            logWarning("MeshBvh::readMeshGeometry() - Only indexed triangle lists are supported.");
+            return false;
+        }
+
+        const auto& elemDesc = pVao->getElementIndexByLocation(VERTEX_POSITION_LOC);
+        if (elemDesc.vbIndex == Vao::ElementDesc::kInvalidIndex)
+        {
+            logWarning("MeshBvh::readMeshGeometry() - The mesh has no positions.");
+            return false;
+        }
+        const VertexBufferLayout* pVbLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex).get();
+        if (pVbLayout->getElementFormat(elemDesc.elementIndex) != ResourceFormat::RGB32Float)
+        {
+            logWarning("MeshBvh::readMeshGeometry() - Only RGB32Float positions are supported.");
+            return false;
+        }
+
+        ResourceFormat ibFormat = pVao->getIndexBufferFormat();
+        if (ibFormat != ResourceFormat::R32Uint && ibFormat != ResourceFormat::R16Uint)
+        {
+            logWarning("MeshBvh::readMeshGeometry() - Unsupported index format.");
+            return false;
+        }
+
+        // Read the buffers back, like ModelCache does
+        indices.resize(pMesh->getIndexCount());
+        const Buffer::SharedPtr& pIB = pVao->getIndexBuffer();
+        const void* pIndexData = pIB->map(Buffer::MapType::Read);
+        if (ibFormat == ResourceFormat::R32Uint)
+        {
+            std::memcpy(indices.data(), pIndexData, indices.size() * sizeof(uint32_t));
+        }
+        else
+        {
+            const uint16_t* pIndices16 = (const uint16_t*)pIndexData;
+            for (size_t i = 0; i < indices.size(); i++) indices[i] = pIndices16[i];
+        }
+        pIB->unmap();
+
+        positions.resize(pMesh->getVertexCount());
+        const Buffer::SharedPtr& pVB = pVao->getVertexBuffer(elemDesc.vbIndex);
+        const uint8_t* pVertexData = (const uint8_t*)pVB->map(Buffer::MapType::Read) + pVbLayout->getElementOffset(elemDesc.elementIndex);
+        for (size_t i = 0; i < positions.size(); i++) std::memcpy(&positions[i], pVertexData + i * pVbLayout->getStride(), sizeof(glm::vec3));
+        pVB->unmap();
+
+        // Guard against broken index buffers, the build would read out of bounds
+        for (uint32_t index : indices)
+        {
+            if (index >= positions.size())
+            {
+                logWarning("MeshBvh::readMeshGeometry() - The mesh has out of range indices.");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    MeshBvh::SharedPtr MeshBvh::create(const Mesh* pMesh, const Bvh::BuildDesc& desc)
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        if (readMeshGeometry(pMesh, positions, indices) == false) return nullptr;
+        return create((const float*)positions.data(), sizeof(glm::vec3), indices.data(), (uint32_t)indices.size() / 3, desc);
+    }
+
+    MeshBvh::SharedPtr MeshBvh::create(const float* pPositions, size_t positionStride, const uint32_t* pIndices, uint32_t triangleCount, const Bvh::BuildDesc& desc)
+    {
+        SharedPtr pBvh = SharedPtr(new MeshBvh());
+        pBvh->mIndices.assign(pIndices, pIndices + triangleCount * 3);
+        pBvh->build(pPositions, positionStride, desc, false);
+        return pBvh;
+    }
+
+    BvhUpdateType MeshBvh::update(const float* pPositions, size_t positionStride)
+    {
+        return build(pPositions, positionStride, mBvh.getBuildDesc(), true);
+    }
+
+    BvhUpdateType MeshBvh::build(const float* pPositions, size_t positionStride, const Bvh::BuildDesc& desc, bool allowRefit)
+    {
+        auto getPosition = [&](uint32_t index)
+        {
+            const float* p = (const float*)((const uint8_t*)pPositions + index * positionStride);
+            return glm::vec3(p[0], p[1], p[2]);
+        };
+
+        uint32_t triangleCount = (uint32_t)mIndices.size() / 3;
+        std::vector<Triangle> triangles(triangleCount);
+        std::vector<glm::vec3> boundsMin(triangleCount);
+        std::vector<glm::vec3> boundsMax(triangleCount);
+        for (uint32_t i = 0; i < triangleCount; i++)
+        {
+            glm::vec3 v0 = getPosition(mIndices[i * 3 + 0]);
+            glm::vec3 v1 = getPosition(mIndices[i * 3 + 1]);
+            glm::vec3 v2 = getPosition(mIndices[i * 3 + 2]);
+            triangles[i] = { v0, i, v1 - v0, v2 - v0 };
+            boundsMin[i] = glm::min(v0, glm::min(v1, v2));
+            boundsMax[i] = glm::max(v0, glm::max(v1, v2));
+        }
+
+        // Refitting is cheap compared to a rebuild, so refit first and let the tracker judge the result
+        BvhUpdateType type = mUpdateTracker.decide(allowRefit == false, true);
+        double cost = 0;
+        if (type == BvhUpdateType::Refit)
+        {
+            mBvh.refit(boundsMin.data(), boundsMax.data());
+            cost = mBvh.computeSahCost();
+            type = mUpdateTracker.decide(false, true, cost);
+        }
+        if (type == BvhUpdateType::Rebuild)
+        {
+            mBvh.build(boundsMin.data(), boundsMax.data(), triangleCount, desc);
+            cost = mBvh.getBuildStats().sahCost;
+        }
+        mUpdateTracker.onUpdated(type, cost);
+
+        // Store the triangles in leaf order, so leaves index them directly
+        const auto& order = mBvh.getPrimitiveIndices();
+        mTriangles.resize(triangleCount);
+        for (uint32_t i = 0; i < triangleCount; i++) mTriangles[i] = triangles[order[i]];
+        return type;
+    }
+
+    bool MeshBvh::intersect(const BvhRay& ray, BvhHit& hit) const
+    {
+        float tMax = std::min(ray.tMax, hit.t);
+        bool found = false;
+        mBvh.traverse(ray, tMax, [&](uint32_t first, uint32_t count, float& tClosest)
+        {
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                float t, u, v;
+                if (intersectTriangle(mTriangles[i], ray.origin, ray.direction, ray.tMin, tClosest, t, u, v))
+                {
+                    tClosest = t;
+                    hit.t = t;
+                    hit.u = u;
+                    hit.v = v;
+                    hit.primitiveId = mTriangles[i].primitiveId;
+                    found = true;
+                }
+            }
+            return false;
+        });
+        return found;
+    }
+
+    bool MeshBvh::occluded(const BvhRay& ray) const
+    {
+        float tMax = ray.tMax;
+        bool found = false;
+        mBvh.traverse(ray, tMax, [&](uint32_t first, uint32_t count, float& tLimit)
+        {
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                float t, u, v;
+                if (intersectTriangle(mTriangles[i], ray.origin, ray.direction, ray.tMin, tLimit, t, u, v))
+                {
+                    found = true;
+                    return true;
+                }
+            }
+            return false;
+        });
+        return found;
+    }
+
+    template<typename SimdT>
+    void MeshBvh::intersectPacket(BvhRayPacket<SimdT>& packet, BvhPacketHit<SimdT>& hit, uint32_t instanceId) const
+    {
+        mBvh.traversePacket(packet, [&](uint32_t first, uint32_t count, BvhRayPacket<SimdT>& rays)
+        {
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                SimdT t, u, v;
+                SimdT mask = intersectTriangle(mTriangles[i], rays, t, u, v);
+                int bits = simdMoveMask(mask);
+                if (bits == 0) continue;
+
+                rays.tMax = simdSelect(rays.tMax, t, mask);
+                hit.u = simdSelect(hit.u, u, mask);
+                hit.v = simdSelect(hit.v, v, mask);
+                for (uint32_t l = 0; l < SimdT::kWidth; l++)
+                {
+                    if (bits & (1 << l))
+                    {
+                        hit.primitiveId[l] = mTriangles[i].primitiveId;
+                        hit.instanceId[l] = instanceId;
+                    }
+                }
+            }
+            return false;
+        });
+    }
+
+    template<typename SimdT>
+    void MeshBvh::occludedPacket(BvhRayPacket<SimdT>& packet) const
+    {
+        mBvh.traversePacket(packet, [&](uint32_t first, uint32_t count, BvhRayPacket<SimdT>& rays)
+        {
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                SimdT t, u, v;
+                SimdT mask = intersectTriangle(mTriangles[i], rays, t, u, v);
+                if (simdMoveMask(mask) == 0) continue;
+                rays.active = simdAndNot(rays.active, mask);
+                if (simdMoveMask(rays.active) == 0) return true;
+            }
+            return false;
+        });
+    }
+
+    template void MeshBvh::intersectPacket<SimdFloat4>(BvhRayPacket<SimdFloat4>&, BvhPacketHit<SimdFloat4>&, uint32_t) const;
+    template void MeshBvh::intersectPacket<SimdFloat8>(BvhRayPacket<SimdFloat8>&, BvhPacketHit<SimdFloat8>&, uint32_t) const;
+    template void MeshBvh::occludedPacket<SimdFloat4>(BvhRayPacket<SimdFloat4>&) const;
+    template void MeshBvh::occludedPacket<SimdFloat8>(BvhRayPacket<SimdFloat8>&) const;
+
+    void MeshBvh::intersect4(const BvhRay* pRays, BvhHit* pHits) const { intersectRays<SimdFloat4>(this, pRays, pHits); }
+    void MeshBvh::intersect8(const BvhRay* pRays, BvhHit* pHits) const { intersectRays<SimdFloat8>(this, pRays, pHits); }
+    uint32_t MeshBvh::occluded4(const BvhRay* pRays) const { return occludedRays<SimdFloat4>(this, pRays); }
+    uint32_t MeshBvh::occluded8(const BvhRay* pRays) const { return occludedRays<SimdFloat8>(this, pRays); }
+}
@@ -0,0 +1,129 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+#include "Graphics/Bvh/Bvh.h"
+#include "Graphics/Bvh/BvhUpdateTracker.h"
+
+namespace Falcor
+{
+    class Mesh;
+
+    /** A BVH over the triangles of a mesh, in object space. This is the bottom level of SceneBvh.
+    */
+    class MeshBvh
+    {
+    public:
+        using SharedPtr = std::shared_ptr<MeshBvh>;
+        using SharedConstPtr = std::shared_ptr<const MeshBvh>;
+
+        /** A triangle, stored in leaf order in the form the intersection test uses
+        */
+        struct Triangle
+        {
+            glm::vec3 v0;
+            uint32_t primitiveId;   ///< The triangle's index in the mesh's index buffer
+            glm::vec3 e1;           ///< v1 - v0
+            glm::vec3 e2;           ///< v2 - v0
+        };
+
+        /** Create the BVH of a mesh. The positions and indices are read back from the GPU. Skinned meshes use their bind pose.
+            \return A new object, or nullptr if the mesh isn't an indexed triangle list with float3 positions.
+        */
+        static SharedPtr create(const Mesh* pMesh, const Bvh::BuildDesc& desc = Bvh::BuildDesc());
+
+        /** Read the positions and indices of a mesh back from the GPU. Needs to run on the thread which owns the render context.
+            \return false if the mesh isn't an indexed triangle list with float3 positions
+        */
+        static bool readMeshGeometry(const Mesh* pMesh, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices);
+
+        /** Create the BVH of an indexed triangle list.
+            \param[in] pPositions The vertex positions, 3 floats each
+            \param[in] positionStride The distance between positions, in bytes
+        */
+        static SharedPtr create(const float* pPositions, size_t positionStride, const uint32_t* pIndices, uint32_t triangleCount, const Bvh::BuildDesc& desc = Bvh::BuildDesc());
+
+        /** Bring the BVH up to date after the vertices moved, as they do for skinned meshes. The indices must be the ones it was created with.
+            The tree is refit, or rebuilt when its update tracker says refitting degraded it too much.
+            \param[in] pPositions The new vertex positions, 3 floats each
+            \param[in] positionStride The distance between positions, in bytes
+            \return What was done to the tree
+        */
+        BvhUpdateType update(const float* pPositions, size_t positionStride);
+
+        /** Find the closest hit closer than both ray.tMax and hit.t.
+            \param[in,out] hit Receives the hit. Its instanceId is left alone.
+            \return Whether a hit was found
+        */
+        bool intersect(const BvhRay& ray, BvhHit& hit) const;
+
+        /** Check whether a ray hits anything between ray.tMin and ray.tMax
+        */
+        bool occluded(const BvhRay& ray) const;
+
+        /** Closest-hit queries for 4 and 8 rays at once. See intersect().
+        */
+        void intersect4(const BvhRay* pRays, BvhHit* pHits) const;
+        void intersect8(const BvhRay* pRays, BvhHit* pHits) const;
+
+        /** Any-hit queries for 4 and 8 rays at once.
+            \return A bit mask of the rays which are occluded
+        */
+        uint32_t occluded4(const BvhRay* pRays) const;
+        uint32_t occluded8(const BvhRay* pRays) const;
+
+        /** Packet queries, used by the top level. Implemented for SimdFloat4 and SimdFloat8.
+            intersectPacket() shrinks the packet's tMax and sets the hits of the lanes that hit something, with instanceId as their instance.
+            occludedPacket() clears the active lanes which hit something.
+        */
+        template<typename SimdT> void intersectPacket(BvhRayPacket<SimdT>& packet, BvhPacketHit<SimdT>& hit, uint32_t instanceId) const;
+        template<typename SimdT> void occludedPacket(BvhRayPacket<SimdT>& packet) const;
+
+        const Bvh& getBvh() const { return mBvh; }
+        const std::vector<Triangle>& getTriangles() const { return mTriangles; }
+        uint32_t getTriangleCount() const { return (uint32_t)mTriangles.size(); }
+
+        /** Get the index buffer the BVH was created with, to find the vertices of a hit's primitive
+        */
+        const std::vector<uint32_t>& getIndices() const { return mIndices; }
+
+        /** The tracker deciding between refits and rebuilds in update(). Its cost is the BVH's SAH cost.
+        */
+        BvhUpdateTracker& getUpdateTracker() { return mUpdateTracker; }
+
+    private:
+        MeshBvh() = default;
+        BvhUpdateType build(const float* pPositions, size_t positionStride, const Bvh::BuildDesc& desc, bool allowRefit);
+
+        Bvh mBvh;
+        std::vector<Triangle> mTriangles;
+        std::vector<uint32_t> mIndices;     ///< Kept for update() and getIndices()
+        BvhUpdateTracker mUpdateTracker;
+    };
+}
@@ -0,0 +1,429 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneBvh.h"
+#include "Graphics/Scene/Scene.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include <algorithm>
+#include <unordered_map>
+#include <sstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Meshes with more triangles than this are built one at a time using all the threads, the others are built in parallel
+        const uint32_t kParallelMeshTriangleCount = 256 * 1024;
+
+        BvhRay transformRay(const BvhRay& ray, const glm::mat4& mat)
+        {
+            BvhRay r = ray;
+            r.origin = glm::vec3(mat * glm::vec4(ray.origin, 1.0f));
+            r.direction = glm::vec3(mat * glm::vec4(ray.direction, 0.0f));
+            return r;
+        }
+
+        /** Transform the rays of a packet by an affine matrix. Distances along the rays don't change since the directions aren't normalized.
+        */
+        template<typename SimdT>
+        void transformPacket(const BvhRayPacket<SimdT>& packet, const glm::mat4& mat, BvhRayPacket<SimdT>& result)
+        {
+            for (int r = 0; r < 3; r++)
+            {
+                SimdT m0(mat[0][r]), m1(mat[1][r]), m2(mat[2][r]);
+                result.origin[r] = m0 * packet.origin[0] + m1 * packet.origin[1] + m2 * packet.origin[2] + SimdT(mat[3][r]);
+                result.direction[r] = m0 * packet.direction[0] + m1 * packet.direction[1] + m2 * packet.direction[2];
+                result.invDirection[r] = simdSafeInverse(result.direction[r]);
+            }
+            result.tMin = packet.tMin;
+            result.tMax = packet.tMax;
+            result.active = packet.active;
+        }
+    }
+
+    SceneBvh::SharedPtr SceneBvh::create(const Scene* pScene, const Bvh::BuildDesc& desc)
+    {
+        SharedPtr pBvh = SharedPtr(new SceneBvh());
+        BuildStats& stats = pBvh->mBuildStats;
+
+        // Gather the mesh instances, and read the unique meshes back. Buffers can only be mapped on this thread.
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        struct MeshGeometry
+        {
+            std::vector<glm::vec3> positions;
+            std::vector<uint32_t> indices;
+        };
+        std::vector<MeshGeometry> geometry;
+        std::unordered_map<const Mesh*, uint32_t> meshIds;
+
+        for (uint32_t modelId = 0; modelId < pScene->getModelCount(); modelId++)
+        {
+            const Model* pModel = pScene->getModel(modelId).get();
+            for (uint32_t modelInstanceId = 0; modelInstanceId < pScene->getModelInstanceCount(modelId); modelInstanceId++)
+            {
+                const glm::mat4& modelMat = pScene->getModelInstance(modelId, modelInstanceId)->getTransformMatrix();
+                for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); meshId++)
+                {
+                    const Mesh* pMesh = pModel->getMesh(meshId).get();
+                    pBvh->mSceneInstanceCount += pModel->getMeshInstanceCount(meshId);
+                    auto it = meshIds.find(pMesh);
+                    if (it == meshIds.end())
+                    {
+                        MeshGeometry g;
+                        uint32_t id = uint32_t(-1);
+                        if (MeshBvh::readMeshGeometry(pMesh, g.positions, g.indices))
+                        {
+                            id = (uint32_t)geometry.size();
+                            geometry.push_back(std::move(g));
+                        }
+                        it = meshIds.insert(std::make_pair(pMesh, id)).first;
+                    }
+                    if (it->second == uint32_t(-1)) continue;
+
+                    for (uint32_t meshInstanceId = 0; meshInstanceId < pModel->getMeshInstanceCount(meshId); meshInstanceId++)
+                    {
+                        Instance inst;
+                        inst.worldMat = modelMat * pModel->getMeshInstance(meshId, meshInstanceId)->getTransformMatrix();
+                        inst.invWorldMat = glm::inverse(inst.worldMat);
+                        inst.meshBvhId = it->second;
+                        inst.modelId = modelId;
+                        inst.modelInstanceId = modelInstanceId;
+                        inst.meshId = meshId;
+                        inst.meshInstanceId = meshInstanceId;
+                        pBvh->mInstances.push_back(inst);
+                        stats.instancedTriangleCount += geometry[it->second].indices.size() / 3;
+                    }
+                }
+            }
+        }
+        stats.readbackTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // Build the mesh BVHs, largest first. Large meshes use all the threads for one build, the rest get one thread per mesh.
+        start = CpuTimer::getCurrentTimePoint();
+        uint32_t meshCount = (uint32_t)geometry.size();
+        pBvh->mMeshBvhs.resize(meshCount);
+        std::vector<uint32_t> order(meshCount);
+        for (uint32_t i = 0; i < meshCount; i++)
+        {
+            order[i] = i;
+            stats.triangleCount += geometry[i].indices.size() / 3;
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return geometry[a].indices.size() > geometry[b].indices.size(); });
+
+        auto buildMesh = [&](uint32_t id, const Bvh::BuildDesc& meshDesc)
+        {
+            const MeshGeometry& g = geometry[id];
+            pBvh->mMeshBvhs[id] = MeshBvh::create((const float*)g.positions.data(), sizeof(glm::vec3), g.indices.data(), (uint32_t)g.indices.size() / 3, meshDesc);
+        };
+
+        uint32_t threadCount = desc.threadCount ? desc.threadCount : WorkerPool::get().getThreadCount();
+        stats.threadCount = threadCount;
+        uint32_t next = 0;
+        while (next < meshCount && geometry[order[next]].indices.size() / 3 > kParallelMeshTriangleCount) buildMesh(order[next++], desc);
+
+        Bvh::BuildDesc singleThreadDesc = desc;
+        singleThreadDesc.threadCount = 1;
+        parallelFor(meshCount - next, threadCount, [&](uint32_t i) { buildMesh(order[next + i], singleThreadDesc); });
+        stats.meshBuildTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // Build the top level over the world-space bounds of the instances
+        start = CpuTimer::getCurrentTimePoint();
+        uint32_t instanceCount = (uint32_t)pBvh->mInstances.size();
+        pBvh->mInstanceBoundsMin.resize(instanceCount);
+        pBvh->mInstanceBoundsMax.resize(instanceCount);
+        for (uint32_t i = 0; i < instanceCount; i++) pBvh->updateInstanceBounds(i);
+        Bvh::BuildDesc instanceDesc = desc;
+        instanceDesc.maxLeafSize = 1;
+        pBvh->mInstanceBvh.build(pBvh->mInstanceBoundsMin.data(), pBvh->mInstanceBoundsMax.data(), instanceCount, instanceDesc);
+        pBvh->mUpdateTracker.onUpdated(BvhUpdateType::Rebuild, pBvh->mInstanceBvh.getBuildStats().sahCost);
+        stats.instanceBuildTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // Give the change tracker its reference state
+        pBvh->mMeshVersions.assign(meshCount, 0);
+        pBvh->mFrameInstances.resize(instanceCount);
+        for (uint32_t i = 0; i < instanceCount; i++)
+        {
+            pBvh->mFrameInstances[i].transform = pBvh->mInstances[i].worldMat;
+            pBvh->mFrameInstances[i].geometryId = pBvh->mInstances[i].meshBvhId;
+        }
+        pBvh->mChangeTracker.update(pBvh->mFrameInstances);
+
+        stats.meshCount = meshCount;
+        stats.instanceCount = instanceCount;
+        return pBvh;
+    }
+
+    void SceneBvh::updateInstanceBounds(uint32_t instanceId)
+    {
+        const Instance& inst = mInstances[instanceId];
+        BoundingBox box = mMeshBvhs[inst.meshBvhId]->getBvh().getBounds().transform(inst.worldMat);
+        mInstanceBoundsMin[instanceId] = box.getMinPos();
+        mInstanceBoundsMax[instanceId] = box.getMaxPos();
+    }
+
+    bool SceneBvh::update(const Scene* pScene)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+
+        uint32_t sceneInstanceCount = 0;
+        for (uint32_t modelId = 0; modelId < pScene->getModelCount(); modelId++)
+        {
+            const Model* pModel = pScene->getModel(modelId).get();
+            uint32_t meshInstanceCount = 0;
+            for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); meshId++) meshInstanceCount += pModel->getMeshInstanceCount(meshId);
+            sceneInstanceCount += meshInstanceCount * pScene->getModelInstanceCount(modelId);
+        }
+        if (sceneInstanceCount != mSceneInstanceCount)
+        {
+            logWarning("SceneBvh::update() - instances were added to or removed from the scene. Create a new SceneBvh.");
+            return false;
+        }
+
+        // The geometry ID includes the mesh version, so instances of updated meshes show up as dirty
+        for (uint32_t i = 0; i < (uint32_t)mInstances.size(); i++)
+        {
+            const Instance& inst = mInstances[i];
+            const Model* pModel = pScene->getModel(inst.modelId).get();
+            InstanceChangeTracker::Instance& frameInst = mFrameInstances[i];
+            frameInst.transform = pScene->getModelInstance(inst.modelId, inst.modelInstanceId)->getTransformMatrix() * pModel->getMeshInstance(inst.meshId, inst.meshInstanceId)->getTransformMatrix();
+            frameInst.geometryId = (uint64_t(mMeshVersions[inst.meshBvhId]) << 32) | inst.meshBvhId;
+        }
+        mChangeTracker.update(mFrameInstances);
+
+        const auto& dirty = mChangeTracker.getDirtyInstances();
+        for (uint32_t i : dirty)
+        {
+            Instance& inst = mInstances[i];
+            inst.worldMat = mFrameInstances[i].transform;
+            inst.invWorldMat = glm::inverse(inst.worldMat);
+            updateInstanceBounds(i);
+        }
+
+        // Refit first and let the tracker judge the result. Refitting the whole tree is cheaper once many instances moved.
+        BvhUpdateType type = mUpdateTracker.decide(false, dirty.empty() == false);
+        double cost = 0;
+        if (type == BvhUpdateType::Refit)
+        {
+            if (dirty.size() * 4 < mInstances.size())
+            {
+                mInstanceBvh.refit(mInstanceBoundsMin.data(), mInstanceBoundsMax.data(), dirty.data(), (uint32_t)dirty.size());
+            }
+            else
+            {
+                mInstanceBvh.refit(mInstanceBoundsMin.data(), mInstanceBoundsMax.data());
+            }
+            cost = mInstanceBvh.computeSahCost();
+            type = mUpdateTracker.decide(false, true, cost);
+        }
+        if (type == BvhUpdateType::Rebuild)
+        {
+            mInstanceBvh.build(mInstanceBoundsMin.data(), mInstanceBoundsMax.data(), (uint32_t)mInstances.size(), mInstanceBvh.getBuildDesc());
+            cost = mInstanceBvh.getBuildStats().sahCost;
+        }
+        mUpdateTracker.onUpdated(type, cost);
+
+        mUpdateStats = mPendingMeshStats;
+        mPendingMeshStats = UpdateStats();
+        mUpdateStats.instanceBvhUpdate = type;
+        mUpdateStats.dirtyInstanceCount = (uint32_t)dirty.size();
+        mUpdateStats.instanceUpdateTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return true;
+    }
+
+    BvhUpdateType SceneBvh::updateMesh(uint32_t meshBvhId, const float* pPositions, size_t positionStride)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        BvhUpdateType type = mMeshBvhs[meshBvhId]->update(pPositions, positionStride);
+        mMeshVersions[meshBvhId]++;
+
+        if (type == BvhUpdateType::Refit) mPendingMeshStats.meshRefitCount++;
+        else mPendingMeshStats.meshRebuildCount++;
+        mPendingMeshStats.meshUpdateTimeMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return type;
+    }
+
+    bool SceneBvh::intersect(const BvhRay& ray, BvhHit& hit) const
+    {
+        const auto& instanceIds = mInstanceBvh.getPrimitiveIndices();
+        float tMax = std::min(ray.tMax, hit.t);
+        bool found = false;
+        mInstanceBvh.traverse(ray, tMax, [&](uint32_t first, uint32_t count, float& tClosest)
+        {
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                const Instance& inst = mInstances[instanceIds[i]];
+                BvhRay localRay = transformRay(ray, inst.invWorldMat);
+                localRay.tMax = tClosest;
+                if (mMeshBvhs[inst.meshBvhId]->intersect(localRay, hit))
+                {
+                    hit.instanceId = instanceIds[i];
+                    tClosest = hit.t;
+                    found = true;
+                }
+            }
+            return false;
+        });
+        return found;
+    }
+
+    bool SceneBvh::occluded(const BvhRay& ray) const
+    {
+        const auto& instanceIds = mInstanceBvh.getPrimitiveIndices();
+        float tMax = ray.tMax;
+        bool found = false;
+        mInstanceBvh.traverse(ray, tMax, [&](uint32_t first, uint32_t count, float& tLimit)
+        {
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                const Instance& inst = mInstances[instanceIds[i]];
+                BvhRay localRay = transformRay(ray, inst.invWorldMat);
+                localRay.tMax = tLimit;
+                if (mMeshBvhs[inst.meshBvhId]->occluded(localRay))
+                {
+                    found = true;
+                    return true;
+                }
+            }
+            return false;
+        });
+        return found;
+    }
+
+    template<typename SimdT>
+    void SceneBvh::intersectPacket(const BvhRay* pRays, BvhHit* pHits) const
+    {
+        const uint32_t kWidth = SimdT::kWidth;
+        BvhRay rays[kWidth];
+        for (uint32_t l = 0; l < kWidth; l++)
+        {
+            rays[l] = pRays[l];
+            rays[l].tMax = std::min(rays[l].tMax, pHits[l].t);
+        }
+
+        BvhRayPacket<SimdT> packet;
+        packet.load(rays);
+        BvhPacketHit<SimdT> hit;
+        hit.reset();
+
+        const auto& instanceIds = mInstanceBvh.getPrimitiveIndices();
+        mInstanceBvh.traversePacket(packet, [&](uint32_t first, uint32_t count, BvhRayPacket<SimdT>& worldRays)
+        {
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                const Instance& inst = mInstances[instanceIds[i]];
+                BvhRayPacket<SimdT> localRays;
+                transformPacket(worldRays, inst.invWorldMat, localRays);
+                mMeshBvhs[inst.meshBvhId]->intersectPacket(localRays, hit, instanceIds[i]);
+                worldRays.tMax = localRays.tMax;
+            }
+            return false;
+        });
+
+        float t[kWidth], u[kWidth], v[kWidth];
+        packet.tMax.store(t);
+        hit.u.store(u);
+        hit.v.store(v);
+        for (uint32_t l = 0; l < kWidth; l++)
+        {
+            if (hit.primitiveId[l] == BvhHit::kInvalidId) continue;
+            pHits[l].t = t[l];
+            pHits[l].u = u[l];
+            pHits[l].v = v[l];
+            pHits[l].instanceId = hit.instanceId[l];
+            pHits[l].primitiveId = hit.primitiveId[l];
+        }
+    }
+
+    template<typename SimdT>
+    uint32_t SceneBvh::occludedPacket(const BvhRay* pRays) const
+    {
+        BvhRayPacket<SimdT> packet;
+        packet.load(pRays);
+        int valid = simdMoveMask(packet.active);
+
+        const auto& instanceIds = mInstanceBvh.getPrimitiveIndices();
+        mInstanceBvh.traversePacket(packet, [&](uint32_t first, uint32_t count, BvhRayPacket<SimdT>& worldRays)
+        {
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                const Instance& inst = mInstances[instanceIds[i]];
+                BvhRayPacket<SimdT> localRays;
+                transformPacket(worldRays, inst.invWorldMat, localRays);
+                mMeshBvhs[inst.meshBvhId]->occludedPacket(localRays);
+                worldRays.active = localRays.active;
+                if (simdMoveMask(worldRays.active) == 0) return true;
+            }
+            return false;
+        });
+        return (uint32_t)(valid & ~simdMoveMask(packet.active));
+    }
+
+    void SceneBvh::intersect4(const BvhRay* pRays, BvhHit* pHits) const { intersectPacket<SimdFloat4>(pRays, pHits); }
+    void SceneBvh::intersect8(const BvhRay* pRays, BvhHit* pHits) const { intersectPacket<SimdFloat8>(pRays, pHits); }
+    uint32_t SceneBvh::occluded4(const BvhRay* pRays) const { return occludedPacket<SimdFloat4>(pRays); }
+    uint32_t SceneBvh::occluded8(const BvhRay* pRays) const { return occludedPacket<SimdFloat8>(pRays); }
+
+    std::string SceneBvh::getBuildStatsString() const
+    {
+        const BuildStats& s = mBuildStats;
+        double buildMs = s.meshBuildTimeMs + s.instanceBuildTimeMs;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2);
+        ss << "SceneBvh: " << s.meshCount << " meshes (" << s.triangleCount << " triangles), " << s.instanceCount << " instances ("
+           << s.instancedTriangleCount << " triangles). Built in " << buildMs << " ms on " << s.threadCount << " threads ("
+           << s.triangleCount / (std::max(s.meshBuildTimeMs, 0.001) * 1000.0) << " Mtri/s for the meshes, "
+           << s.instanceBuildTimeMs << " ms for the instances), after reading the meshes back in " << s.readbackTimeMs << " ms";
+        return ss.str();
+    }
+
+    std::string SceneBvh::getUpdateStatsString() const
+    {
+        const UpdateStats& s = mUpdateStats;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "SceneBvh: " << s.dirtyInstanceCount << " of " << mInstances.size() << " instances changed, top level: " << to_string(s.instanceBvhUpdate)
+           << " (" << mUpdateTracker.getRefitCount() << " refits since the last rebuild, SAH cost x" << std::setprecision(2) << mUpdateTracker.getCostGrowth()
+           << ") in " << std::setprecision(3) << s.instanceUpdateTimeMs << " ms. Meshes: " << s.meshRefitCount << " refit, " << s.meshRebuildCount
+           << " rebuilt in " << s.meshUpdateTimeMs << " ms";
+        return ss.str();
+    }
+
+    BvhRay SceneBvh::createPrimaryRay(const Camera* pCamera, const glm::vec2& pixel, const glm::uvec2& frameSize)
+    {
+        // Unproject a point on the far plane, which is at depth 1 in both the D3D and GL conventions
+        glm::vec2 ndc = pixel / glm::vec2(frameSize) * 2.0f - 1.0f;
+        glm::vec4 farPoint = pCamera->getInvViewProjMatrix() * glm::vec4(ndc.x, -ndc.y, 1.0f, 1.0f);
+        BvhRay ray;
+        ray.origin = pCamera->getPosition();
+        ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+        return ray;
+    }
+}
@@ -0,0 +1,173 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "glm/vec2.hpp"
+#include "glm/mat4x4.hpp"
+#include "Graphics/Bvh/MeshBvh.h"
+
+namespace Falcor
+{
+    class Scene;
+    class Camera;
+
+    /** A two-level BVH of a scene for tracing rays on the CPU, independent of the DXR acceleration structures.
+        Each unique mesh gets a MeshBvh in object space. The top level is a BVH over the world-space bounds of the mesh instances,
+        whose leaves transform the rays into the instance's object space and trace its MeshBvh.
+        Call update() each frame to follow moving instances, and updateMesh() for meshes whose vertices move. Adding or removing instances
+        needs a new hierarchy.
+    */
+    class SceneBvh
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneBvh>;
+        using SharedConstPtr = std::shared_ptr<const SceneBvh>;
+
+        /** A mesh instance of the scene
+        */
+        struct Instance
+        {
+            glm::mat4 worldMat;         ///< Model instance transform times mesh instance transform
+            glm::mat4 invWorldMat;
+            uint32_t meshBvhId;         ///< See getMeshBvh()
+            uint32_t modelId;
+            uint32_t modelInstanceId;
+            uint32_t meshId;
+            uint32_t meshInstanceId;
+        };
+
+        struct BuildStats
+        {
+            uint32_t meshCount = 0;             ///< Unique meshes, one MeshBvh each
+            uint32_t instanceCount = 0;
+            uint64_t triangleCount = 0;         ///< Triangles of the unique meshes
+            uint64_t instancedTriangleCount = 0;
+            uint32_t threadCount = 0;
+            double readbackTimeMs = 0;          ///< Reading the meshes back from the GPU. Not part of the build rate.
+            double meshBuildTimeMs = 0;
+            double instanceBuildTimeMs = 0;
+        };
+
+        /** What the last update() did
+        */
+        struct UpdateStats
+        {
+            BvhUpdateType instanceBvhUpdate = BvhUpdateType::None;
+            uint32_t dirtyInstanceCount = 0;    ///< Instances whose transform or mesh changed
+            uint32_t meshRefitCount = 0;        ///< Mesh BVHs refit by updateMesh() since the previous update()
+            uint32_t meshRebuildCount = 0;      ///< Mesh BVHs rebuilt by updateMesh() since the previous update()
+            double meshUpdateTimeMs = 0;        ///< Time spent in updateMesh() since the previous update()
+            double instanceUpdateTimeMs = 0;    ///< Finding the dirty instances and updating the top level
+        };
+
+        /** Create the hierarchy for a scene. Reads the meshes back from the GPU, then builds their BVHs in parallel.
+        */
+        static SharedPtr create(const Scene* pScene, const Bvh::BuildDesc& desc = Bvh::BuildDesc());
+
+        /** Bring the hierarchy up to date with the scene's transforms. Call it after Scene::update().
+            Only the instances whose transform or mesh changed are updated. The top level is refit, or rebuilt when its update tracker
+            says refitting degraded it too much.
+            \return false if instances were added to or removed from the scene since create(). The hierarchy is left as is; create a new one.
+        */
+        bool update(const Scene* pScene);
+
+        /** Update the BVH of a mesh whose vertices moved, such as a skinned mesh. See MeshBvh::update().
+            The top level picks up the new bounds of the mesh's instances in the next update().
+        */
+        BvhUpdateType updateMesh(uint32_t meshBvhId, const float* pPositions, size_t positionStride);
+
+        /** Find the closest hit closer than both ray.tMax and hit.t.
+            \return Whether a hit was found
+        */
+        bool intersect(const BvhRay& ray, BvhHit& hit) const;
+
+        /** Check whether a ray hits anything between ray.tMin and ray.tMax
+        */
+        bool occluded(const BvhRay& ray) const;
+
+        /** Closest-hit queries for 4 and 8 rays at once. See intersect().
+        */
+        void intersect4(const BvhRay* pRays, BvhHit* pHits) const;
+        void intersect8(const BvhRay* pRays, BvhHit* pHits) const;
+
+        /** Any-hit queries for 4 and 8 rays at once.
+            \return A bit mask of the rays which are occluded
+        */
+        uint32_t occluded4(const BvhRay* pRays) const;
+        uint32_t occluded8(const BvhRay* pRays) const;
+
+        uint32_t getInstanceCount() const { return (uint32_t)mInstances.size(); }
+        const Instance& getInstance(uint32_t instanceId) const { return mInstances[instanceId]; }
+        uint32_t getMeshBvhCount() const { return (uint32_t)mMeshBvhs.size(); }
+        const MeshBvh* getMeshBvh(uint32_t meshBvhId) const { return mMeshBvhs[meshBvhId].get(); }
+        const Bvh& getInstanceBvh() const { return mInstanceBvh; }
+
+        const BuildStats& getBuildStats() const { return mBuildStats; }
+        const UpdateStats& getUpdateStats() const { return mUpdateStats; }
+
+        /** The tracker deciding between refits and rebuilds of the top level. Its cost is the top level's SAH cost.
+        */
+        BvhUpdateTracker& getUpdateTracker() { return mUpdateTracker; }
+
+        /** Get a one-line summary of the build stats, for logging
+        */
+        std::string getBuildStatsString() const;
+
+        /** Get a one-line summary of the last update(), for logging
+        */
+        std::string getUpdateStatsString() const;
+
+        /** Create a primary ray through a pixel
+            \param[in] pixel The pixel coordinates, with (0, 0) at the top-left corner. Use the pixel center for a ray through it.
+        */
+        static BvhRay createPrimaryRay(const Camera* pCamera, const glm::vec2& pixel, const glm::uvec2& frameSize);
+
+    private:
+        SceneBvh() = default;
+
+        template<typename SimdT> void intersectPacket(const BvhRay* pRays, BvhHit* pHits) const;
+        template<typename SimdT> uint32_t occludedPacket(const BvhRay* pRays) const;
+        void updateInstanceBounds(uint32_t instanceId);
+
+        std::vector<MeshBvh::SharedPtr> mMeshBvhs;
+        std::vector<uint32_t> mMeshVersions;                ///< Incremented by updateMesh(), so the change tracker sees the mesh's instances as changed
+        std::vector<Instance> mInstances;
+        std::vector<glm::vec3> mInstanceBoundsMin;          ///< World-space bounds of the instances, the primitives of the top level
+        std::vector<glm::vec3> mInstanceBoundsMax;
+        uint32_t mSceneInstanceCount = 0;                   ///< Mesh instances in the scene at creation, including the ones skipped
+        Bvh mInstanceBvh;
+        BvhUpdateTracker mUpdateTracker;
+        InstanceChangeTracker mChangeTracker;
+        std::vector<InstanceChangeTracker::Instance> mFrameInstances;   ///< Scratch space of update()
+        BuildStats mBuildStats;
+        UpdateStats mUpdateStats;
+        UpdateStats mPendingMeshStats;                      ///< The mesh updates since the last update()
+    };
+}
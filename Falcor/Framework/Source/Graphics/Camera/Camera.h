@@ -195,6 +195,11 @@ namespace Falcor
         */
         bool isObjectCulled(const BoundingBox& box) const;
 
+        /** Get the world-space frustum planes used by isObjectCulled(), for culling many boxes at once
+            \param[out] planes The six frustum planes. xyz is the plane normal, pointing into the frustum. A point p is inside the frustum when dot(p, xyz) + w > 0 for all the planes.
+        */
+        void getFrustumPlanes(glm::vec4 planes[6]) const;
+
         /** Set camera data into a program's constant buffer.
             \param[in] pBuffer The constant buffer to set the parameters into.
             \param[in] varName The name of the light variable in the program.
@@ -37,9 +37,17 @@
 #include "Graphics/Model/Model.h"
 #include "Graphics/TextureHelper.h"
 #include "API/Device.h"
+#include <atomic>
 
 namespace Falcor
 {
+    uint64_t Light::newChangeStamp()
+    {
+        // Shared by all the lights, which may be created and changed from any thread
+        static std::atomic<uint64_t> sChangeCounter(0);
+        return ++sChangeCounter;
+    }
+
     bool checkOffset(const std::string& structName, size_t cbOffset, size_t cppOffset, const char* field)
     {
         if (cbOffset != cppOffset)
@@ -116,6 +124,7 @@ namespace Falcor
         mUiLightIntensityColor = uiColor;
         mData.intensity = (mUiLightIntensityColor * mUiLightIntensityScale);
         updateAreaLightIntensity(mData);
+        markChanged();
     }
 
     float Light::getIntensityForUI()
@@ -143,6 +152,7 @@ namespace Falcor
         mUiLightIntensityScale = intensity;
         mData.intensity = (mUiLightIntensityColor * mUiLightIntensityScale);
         updateAreaLightIntensity(mData);
+        markChanged();
     }
 
     void Light::renderUI(Gui* pGui, const char* group)
@@ -200,6 +210,7 @@ namespace Falcor
     {
         mData.dirW = normalize(dir);
         mData.posW = mCenter - mData.dirW * mDistance; // Move light's position sufficiently far away
+        markChanged();
     }
 
     void DirectionalLight::setWorldParams(const glm::vec3& center, float radius)
@@ -207,6 +218,7 @@ namespace Falcor
         mDistance = radius;
         mCenter = center;
         mData.posW = mCenter - mData.dirW * mDistance; // Move light's position sufficiently far away
+        markChanged();
     }
 
     float DirectionalLight::getPower() const
@@ -242,8 +254,14 @@ namespace Falcor
     {
         if (!group || pGui->beginGroup(group))
         {
-            pGui->addFloat3Var("World Position", mData.posW, -FLT_MAX, FLT_MAX);
-            pGui->addDirectionWidget("Direction", mData.dirW);
+            if (pGui->addFloat3Var("World Position", mData.posW, -FLT_MAX, FLT_MAX))
+            {
+                markChanged();
+            }
+            if (pGui->addDirectionWidget("Direction", mData.dirW))
+            {
+                markChanged();
+            }
 
             if (pGui->addFloatVar("Opening Angle", mData.openingAngle, 0.f, (float)M_PI))
             {
@@ -268,12 +286,14 @@ namespace Falcor
         mData.openingAngle = openingAngle;
         /* Prepare an auxiliary cosine of the opening angle to quickly check whether we're within the cone of a spot light */
         mData.cosOpeningAngle = cos(openingAngle);
+        markChanged();
     }
 
     void PointLight::move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up)
     {
         mData.posW = position;
         mData.dirW = target - position;
+        markChanged();
     }
 
     AreaLight::SharedPtr AreaLight::create()
@@ -574,6 +594,12 @@ namespace Falcor
         mData.transMat = mTransformMatrix * glm::scale(glm::mat4(), mScaling);
         mData.transMatIT = glm::inverse(glm::transpose(mData.transMat));
 
+        // World-space frame of the shape, which the shaders sample the light with: its center, its normal (the local Z axis), and the half-extents along the local X and Y axes
+        mData.posW = vec3(mData.transMat * vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        mData.dirW = glm::normalize(vec3(mData.transMatIT * vec4(0.0f, 0.0f, 1.0f, 0.0f)));
+        mData.tangent = vec3(mData.transMat * vec4(1.0f, 0.0f, 0.0f, 0.0f));
+        mData.bitangent = vec3(mData.transMat * vec4(0.0f, 1.0f, 0.0f, 0.0f));
+
         switch (mData.type)
         {
 
@@ -607,6 +633,8 @@ namespace Falcor
         default:
             break;
         }
+
+        markChanged();
     }
 
     void AnalyticAreaLight::move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up)
@@ -97,10 +97,20 @@ namespace Falcor
         */
         static uint32_t getShaderStructSize() { return kDataSize; }
 
+        /** Get a stamp which changes whenever the light's data is set, by its setters, move() or its UI.
+            The stamps come from a counter shared by all the lights, so two lights never have the same one. LightStore only compares the data of the lights whose stamp changed.
+        */
+        uint64_t getChangeStamp() const { return mChangeStamp; }
+
     protected:
 
         static const size_t kDataSize = sizeof(LightData);
 
+        /** Give the light a new change stamp. Derived classes call it whenever they change mData.
+        */
+        void markChanged() { mChangeStamp = newChangeStamp(); }
+        static uint64_t newChangeStamp();
+
         /* UI callbacks for keeping the intensity in-sync */
         glm::vec3 getColorForUI();
         void setColorFromUI(const glm::vec3& uiColor);
@@ -113,6 +123,7 @@ namespace Falcor
         glm::vec3 mUiLightIntensityColor = glm::vec3(0.5f, 0.5f, 0.5f);
         float     mUiLightIntensityScale = 1.0f;
         LightData mData;
+        uint64_t  mChangeStamp = newChangeStamp();
     };
 
     /** Directional light source.
@@ -141,7 +152,7 @@ namespace Falcor
         /** Set the light intensity.
             \param[in] intensity Vec3 corresponding to RGB intensity
         */
-        void setIntensity(const glm::vec3& intensity) { mData.intensity = intensity; }
+        void setIntensity(const glm::vec3& intensity) { mData.intensity = intensity; markChanged(); }
 
         /** Set the scene parameters
         */
@@ -194,15 +205,15 @@ namespace Falcor
 
         /** Set the light's world-space position
         */
-        void setWorldPosition(const glm::vec3& pos) { mData.posW = pos; }
+        void setWorldPosition(const glm::vec3& pos) { mData.posW = pos; markChanged(); }
 
         /** Set the light's world-space position
         */
-        void setWorldDirection(const glm::vec3& dir) { mData.dirW = dir; }
+        void setWorldDirection(const glm::vec3& dir) { mData.dirW = dir; markChanged(); }
 
         /** Set the light intensity.
         */
-        void setIntensity(const glm::vec3& intensity) { mData.intensity = intensity; }
+        void setIntensity(const glm::vec3& intensity) { mData.intensity = intensity; markChanged(); }
 
         /** Set the cone opening angle for use as a spot light
             \param[in] openingAngle Angle in radians.
@@ -228,7 +239,7 @@ namespace Falcor
         /** Set the penumbra angle
             \param[in] angle Angle in radians
         */
-        void setPenumbraAngle(float angle) { mData.penumbraAngle = glm::clamp(angle, 0.0f, mData.openingAngle);; }
+        void setPenumbraAngle(float angle) { mData.penumbraAngle = glm::clamp(angle, 0.0f, mData.openingAngle); markChanged(); }
 
         /** Get the opening angle
         */
@@ -28,11 +28,86 @@
 #include "Framework.h"
 #include "Animation.h"
 #include "AnimationController.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/Math/SimdFloat8.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/transform.hpp"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
 
 namespace Falcor
 {
+    namespace
+    {
+        // Sets are evaluated on several threads only above this count. Skeletons are usually much smaller, and handing them to the worker pool would cost more than it saves.
+        const uint32_t kParallelSetCount = 1024;
+        const uint32_t kSetsPerTask = 256;
+
+        /** Interpolate 8 pairs of quaternions at once, in SoA layout. Uses the polynomial approximation of slerp from
+            D. Eberly, "A Fast and Accurate Algorithm for Computing SLERP", which needs no trigonometric functions, square roots or branches.
+            Takes the shortest path, like glm::slerp(). The result is renormalized, since mat4_cast() expects a unit quaternion.
+        */
+        void slerp8(const float q0[4][8], const float q1[4][8], const float t[8], float result[4][8])
+        {
+            static const float kMu = 1.85298109240830f;
+            static const float u[8] = { 1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9), 1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), kMu / (8 * 17) };
+            static const float v[8] = { 1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15, kMu * 8 / 17 };
+
+            SimdFloat8 a[4], b[4];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                a[c] = SimdFloat8::load(q0[c]);
+                b[c] = SimdFloat8::load(q1[c]);
+            }
+            SimdFloat8 zero(0.0f);
+            SimdFloat8 one(1.0f);
+            SimdFloat8 x = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+
+            // Negate q1 where the quaternions are more than 90 degrees apart
+            SimdFloat8 flip = simdLess(x, zero);
+            x = simdSelect(x, zero - x, flip);
+            for (uint32_t c = 0; c < 4; c++) b[c] = simdSelect(b[c], zero - b[c], flip);
+
+            SimdFloat8 tt = SimdFloat8::load(t);
+            SimdFloat8 d = one - tt;
+            SimdFloat8 sqrT = tt * tt;
+            SimdFloat8 sqrD = d * d;
+            SimdFloat8 xm1 = x - one;
+
+            SimdFloat8 f0 = one;
+            SimdFloat8 f1 = one;
+            for (int i = 7; i >= 0; i--)
+            {
+                SimdFloat8 ui(u[i]);
+                SimdFloat8 vi(v[i]);
+                f0 = one + (ui * sqrD - vi) * xm1 * f0;
+                f1 = one + (ui * sqrT - vi) * xm1 * f1;
+            }
+            f0 = f0 * d;
+            f1 = f1 * tt;
+
+            SimdFloat8 r[4];
+            for (uint32_t c = 0; c < 4; c++) r[c] = f0 * a[c] + f1 * b[c];
+
+            // The length is within 1e-4 of 1, so one Newton step of 1/sqrt() is enough
+            SimdFloat8 lengthSqr = r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3];
+            SimdFloat8 invLength = (SimdFloat8(3.0f) - lengthSqr) * SimdFloat8(0.5f);
+            for (uint32_t c = 0; c < 4; c++) (r[c] * invLength).store(result[c]);
+        }
+
+        glm::mat4 composeTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scaling)
+        {
+            glm::mat4 m = glm::mat4_cast(rotation);
+            m[0] = m[0] * scaling.x;
+            m[1] = m[1] * scaling.y;
+            m[2] = m[2] * scaling.z;
+            m[3] = glm::vec4(translation, 1);
+            return m;
+        }
+    }
+
     Animation::UniquePtr Animation::create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond)
     {
         return UniquePtr(new Animation(name, animationSets, duration, ticksPerSecond));
@@ -43,82 +118,157 @@ namespace Falcor
         return UniquePtr(new Animation(other));
     }
 
-    Animation::Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond) : mName(name), mAnimationSets(animationSets), mDuration(duration), mTicksPerSecond(ticksPerSecond)
+    template<typename T>
+    Animation::Track Animation::addTrack(const AnimationChannel<T>& channel, std::vector<float>& times, std::vector<T>& values)
     {
-
+        Track track;
+        track.firstKey = (uint32_t)times.size();
+        track.keyCount = (uint32_t)channel.keys.size();
+        for (const auto& key : channel.keys)
+        {
+            times.push_back(key.time);
+            values.push_back(key.value);
+        }
+        return track;
     }
 
-    Animation::Animation(const Animation& other) : mName(other.mName), mDuration(other.mDuration), mTicksPerSecond(other.mTicksPerSecond)
+    Animation::Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond) : mName(name), mDuration(duration), mTicksPerSecond(ticksPerSecond)
     {
-        mAnimationSets = other.mAnimationSets;
+        size_t vec3KeyCount = 0;
+        size_t quatKeyCount = 0;
+        for (const auto& set : animationSets)
+        {
+            vec3KeyCount += set.translation.keys.size() + set.scaling.keys.size();
+            quatKeyCount += set.rotation.keys.size();
+        }
+        mVec3KeyTimes.reserve(vec3KeyCount);
+        mVec3Keys.reserve(vec3KeyCount);
+        mQuatKeyTimes.reserve(quatKeyCount);
+        mQuatKeys.reserve(quatKeyCount);
+
+        mSets.reserve(animationSets.size());
+        for (const auto& set : animationSets)
+        {
+            PackedSet packed;
+            packed.boneID = set.boneID;
+            packed.translation = addTrack(set.translation, mVec3KeyTimes, mVec3Keys);
+            packed.scaling = addTrack(set.scaling, mVec3KeyTimes, mVec3Keys);
+            packed.rotation = addTrack(set.rotation, mQuatKeyTimes, mQuatKeys);
+            mSets.push_back(packed);
+        }
+
+        mCursors.resize(mSets.size() * 3, 0);
+        mLocalTransforms.resize(mSets.size());
     }
 
     Animation::~Animation() = default;
 
-    template<typename T>
-    uint32_t findCurrentFrame(T channel, float ticks)
+    uint32_t Animation::findKey(const Track& track, const std::vector<float>& times, uint32_t& cursor, float ticks, uint32_t& nextKey, float& ratio) const
     {
-        uint32_t curKeyID = channel.lastKeyUsed;
-        while(curKeyID < channel.keys.size() - 1)
+        const float* pTimes = times.data() + track.firstKey;
+        uint32_t count = track.keyCount;
+        uint32_t key;
+
+        if (ticks < pTimes[0])
         {
-            if(channel.keys[curKeyID + 1].time > ticks)
-            {
-                break;
-            }
-            curKeyID++;
+            // Hold the first key until it starts
+            key = 0;
         }
-        return curKeyID;
+        else if (ticks >= pTimes[cursor] && (cursor + 1 == count || ticks < pTimes[cursor + 1]))
+        {
+            key = cursor;
+        }
+        else if (cursor + 1 < count && ticks >= pTimes[cursor + 1] && (cursor + 2 == count || ticks < pTimes[cursor + 2]))
+        {
+            key = cursor + 1;
+        }
+        else
+        {
+            // Seeking, looping or skipping several keys at once
+            key = (uint32_t)(std::upper_bound(pTimes, pTimes + count, ticks) - pTimes) - 1;
+        }
+        cursor = key;
+
+        // The key after the last one is the first one of the next loop
+        nextKey = (key + 1 == count) ? 0 : key + 1;
+        float diff = pTimes[nextKey] - pTimes[key];
+        if (diff < 0) diff += mDuration;
+        ratio = (diff > 0 && ticks > pTimes[key]) ? (ticks - pTimes[key]) / diff : 0.0f;
+        return key;
     }
 
-    glm::vec3 interpolate(const glm::vec3& start, const glm::vec3& end, float ratio)
+    glm::vec3 Animation::interpolate(const Track& track, uint32_t& cursor, float ticks) const
     {
+        uint32_t nextKey;
+        float ratio;
+        uint32_t key = findKey(track, mVec3KeyTimes, cursor, ticks, nextKey, ratio);
+        const glm::vec3& start = mVec3Keys[track.firstKey + key];
+        const glm::vec3& end = mVec3Keys[track.firstKey + nextKey];
         return start + ((end - start) * ratio);
     }
 
-    glm::quat interpolate(const glm::quat& start, const glm::quat& end, float ratio)
+    void Animation::evaluate(float ticks, uint32_t firstSet, uint32_t endSet)
     {
-        return glm::slerp(start, end, ratio);
-    }
+        const uint32_t kWidth = SimdFloat8::kWidth;
+        alignas(32) float q0[4][kWidth];
+        alignas(32) float q1[4][kWidth];
+        alignas(32) float t[kWidth];
+        alignas(32) float q[4][kWidth];
+        glm::vec3 translation[kWidth];
+        glm::vec3 scaling[kWidth];
 
-    template<typename KeyType>
-    KeyType Animation::calcCurrentKey(AnimationChannel<KeyType>& channel, float ticks, float lastUpdateTime)
-    {
-        KeyType curValue;
-        if(channel.keys.size() > 0)
+        for (uint32_t batch = firstSet; batch < endSet; batch += kWidth)
         {
-            if(ticks < lastUpdateTime)
-            {
-                channel.lastKeyUsed = 0;
-            }
-
-            // search for the next keyframe
-            uint32_t curKeyIndex = findCurrentFrame(channel, ticks);
-            uint32_t nextKeyIndex = (curKeyIndex + 1) % channel.keys.size();
-            const AnimationKey<KeyType>& curKey = channel.keys[curKeyIndex];
-            const AnimationKey<KeyType>& nextKey = channel.keys[nextKeyIndex];
-
-            assert(ticks >= curKey.time);
-            // Interpolate between them
-            float diff = nextKey.time - curKey.time;
+            uint32_t batchSize = std::min(kWidth, endSet - batch);
 
-            if (diff == 0)
+            // Gather the keys of the batch, then slerp all of its rotations at once. Sets without rotation keys, and the padding, interpolate identities.
+            for (uint32_t lane = 0; lane < kWidth; lane++)
             {
-                curValue = curKey.value;
-            }
-            else
-            {
-                if (diff < 0)
+                glm::quat start(1, 0, 0, 0);
+                glm::quat end(1, 0, 0, 0);
+                float ratio = 0;
+                if (lane < batchSize)
                 {
-                    diff += mDuration;
+                    uint32_t setID = batch + lane;
+                    const PackedSet& set = mSets[setID];
+                    uint32_t* pCursors = &mCursors[setID * 3];
+
+                    translation[lane] = set.translation.keyCount ? interpolate(set.translation, pCursors[0], ticks) : glm::vec3(0.0f);
+                    scaling[lane] = set.scaling.keyCount ? interpolate(set.scaling, pCursors[1], ticks) : glm::vec3(1.0f);
+
+                    if (set.rotation.keyCount)
+                    {
+                        uint32_t nextKey;
+                        uint32_t key = findKey(set.rotation, mQuatKeyTimes, pCursors[2], ticks, nextKey, ratio);
+                        start = mQuatKeys[set.rotation.firstKey + key];
+                        end = mQuatKeys[set.rotation.firstKey + nextKey];
+                    }
                 }
+                q0[0][lane] = start.x; q0[1][lane] = start.y; q0[2][lane] = start.z; q0[3][lane] = start.w;
+                q1[0][lane] = end.x; q1[1][lane] = end.y; q1[2][lane] = end.z; q1[3][lane] = end.w;
+                t[lane] = ratio;
+            }
+
+            slerp8(q0, q1, t, q);
 
-                float ratio = (ticks - curKey.time) / diff;
-                curValue = interpolate(curKey.value, nextKey.value, ratio);
+            for (uint32_t lane = 0; lane < batchSize; lane++)
+            {
+                glm::quat rotation(q[3][lane], q[0][lane], q[1][lane], q[2][lane]);
+                mLocalTransforms[batch + lane] = composeTransform(translation[lane], rotation, scaling[lane]);
             }
-            
-            channel.lastKeyUsed = curKeyIndex;
         }
-        return curValue;
+    }
+
+    void Animation::evaluateParallel(float ticks, uint32_t threadCount)
+    {
+        // Tasks start on a batch boundary so the last batch of a task is the only partial one
+        uint32_t setCount = (uint32_t)mSets.size();
+        uint32_t taskCount = (setCount + kSetsPerTask - 1) / kSetsPerTask;
+        parallelFor(taskCount, threadCount, [&](uint32_t task)
+        {
+            uint32_t firstSet = task * kSetsPerTask;
+            evaluate(ticks, firstSet, std::min(firstSet + kSetsPerTask, setCount));
+        });
     }
 
     void Animation::animate(double totalTime, AnimationController* pAnimationController)
@@ -126,24 +276,19 @@ namespace Falcor
         // Calculate the relative time
         float ticks = (float)fmod(totalTime * mTicksPerSecond, mDuration);
 
-        for(auto& Key : mAnimationSets)
+        uint32_t setCount = (uint32_t)mSets.size();
+        if (setCount >= kParallelSetCount)
         {
-            glm::mat4 translation;
-            translation[3] = glm::vec4(calcCurrentKey(Key.translation, ticks, Key.lastUpdateTime), 1);
-
-            glm::mat4 scaling;
-            if (Key.scaling.keys.size() > 0)
-            {
-                scaling = glm::scale(calcCurrentKey(Key.scaling, ticks, Key.lastUpdateTime));
-            }
-
-            glm::quat q = calcCurrentKey(Key.rotation, ticks, Key.lastUpdateTime);
-            glm::mat4 rotation = glm::mat4_cast(q);
-
-            Key.lastUpdateTime = ticks;
+            evaluateParallel(ticks, WorkerPool::get().getThreadCount());
+        }
+        else
+        {
+            evaluate(ticks, 0, setCount);
+        }
 
-            glm::mat4 T = translation * rotation * scaling;
-            pAnimationController->setBoneLocalTransform(Key.boneID, T);
+        for (uint32_t i = 0; i < setCount; i++)
+        {
+            pAnimationController->setBoneLocalTransform(mSets[i].boneID, mLocalTransforms[i]);
         }
     }
 }
@@ -26,14 +26,21 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <memory>
+#include <string>
 #include <vector>
 #include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
 #include "glm/gtc/quaternion.hpp"
 
 namespace Falcor
 {
     class AnimationController;
 
+    /** A skeletal animation, made of keyframed translation, scaling and rotation channels for each animated bone.
+        The keys are repacked at creation into contiguous tracks. Each track remembers the key it used last, so playing forward finds the keys in constant time,
+        and seeking or looping falls back to a binary search. Rotations are interpolated 8 bones at a time, and evaluating a frame doesn't allocate memory.
+    */
     class Animation
     {
     public:
@@ -50,8 +57,7 @@ namespace Falcor
         template<typename T>
         struct AnimationChannel
         {
-            std::vector<AnimationKey<T>> keys;
-            uint32_t lastKeyUsed = 0;
+            std::vector<AnimationKey<T>> keys;  ///< Sorted by time
         };
 
         struct AnimationSet
@@ -60,7 +66,6 @@ namespace Falcor
             AnimationChannel<glm::vec3> translation;
             AnimationChannel<glm::vec3> scaling;
             AnimationChannel<glm::quat> rotation;
-            float lastUpdateTime = 0;
         };
 
         static UniquePtr create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
@@ -68,18 +73,45 @@ namespace Falcor
         ~Animation();
         void animate(double totalTime, AnimationController* pAnimationController);
         const std::string& getName() const { return mName; }
+        uint32_t getSetCount() const { return (uint32_t)mSets.size(); }
 
     private:
         Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
-        Animation(const Animation& other);
-        
+        Animation(const Animation& other) = default;
+
+        /** A channel's keys, in the key arrays of its type
+        */
+        struct Track
+        {
+            uint32_t firstKey = 0;
+            uint32_t keyCount = 0;
+        };
+
+        struct PackedSet
+        {
+            uint32_t boneID;
+            Track translation;
+            Track scaling;
+            Track rotation;
+        };
+
+        template<typename T>
+        static Track addTrack(const AnimationChannel<T>& channel, std::vector<float>& times, std::vector<T>& values);
+        uint32_t findKey(const Track& track, const std::vector<float>& times, uint32_t& cursor, float ticks, uint32_t& nextKey, float& ratio) const;
+        glm::vec3 interpolate(const Track& track, uint32_t& cursor, float ticks) const;
+        void evaluate(float ticks, uint32_t firstSet, uint32_t endSet);
+        void evaluateParallel(float ticks, uint32_t threadCount);
+
         const std::string mName;
         float mDuration;
         float mTicksPerSecond;
 
-        std::vector<AnimationSet> mAnimationSets;
-
-        template<typename _KeyType>
-        _KeyType calcCurrentKey(AnimationChannel<_KeyType>& channel, float ticks, float lastUpdateTime);
+        std::vector<PackedSet> mSets;
+        std::vector<float> mVec3KeyTimes;           ///< Translation and scaling keys
+        std::vector<glm::vec3> mVec3Keys;
+        std::vector<float> mQuatKeyTimes;           ///< Rotation keys
+        std::vector<glm::quat> mQuatKeys;
+        std::vector<uint32_t> mCursors;             ///< The key each track used last. Translation, scaling and rotation for each set.
+        std::vector<glm::mat4> mLocalTransforms;    ///< The bones' transforms evaluated by animate()
     };
-}
\ No newline at end of file
+}
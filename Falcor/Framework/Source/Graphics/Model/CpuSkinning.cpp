@@ -0,0 +1,317 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "CpuSkinning.h"
+#include "Graphics/Model/Model.h"
+#include "Data/VertexAttrib.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/Math/SimdFloat8.h"
+#include "glm/mat3x3.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Meshes are skinned in chunks of this many vertices, so large meshes are split across the threads
+        const uint32_t kChunkVertexCount = 4096;
+
+        /** Read a vertex attribute back from the GPU
+            \return false if the VAO doesn't have the attribute, or if it has a different format
+        */
+        template<typename T>
+        bool readAttribute(const Vao* pVao, uint32_t location, ResourceFormat format, uint32_t vertexCount, std::vector<T>& data)
+        {
+            data.clear();
+            const auto& elemDesc = pVao->getElementIndexByLocation(location);
+            if (elemDesc.vbIndex == Vao::ElementDesc::kInvalidIndex) return false;
+
+            const VertexBufferLayout* pVbLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex).get();
+            if (pVbLayout->getElementFormat(elemDesc.elementIndex) != format)
+            {
+                logWarning("CpuSkinning - Unsupported format for the vertex attribute at location " + std::to_string(location) + ".");
+                return false;
+            }
+
+            data.resize(vertexCount);
+            const Buffer::SharedPtr& pVB = pVao->getVertexBuffer(elemDesc.vbIndex);
+            const uint8_t* pVertexData = (const uint8_t*)pVB->map(Buffer::MapType::Read) + pVbLayout->getElementOffset(elemDesc.elementIndex);
+            for (size_t i = 0; i < data.size(); i++) std::memcpy(&data[i], pVertexData + i * pVbLayout->getStride(), sizeof(T));
+            pVB->unmap();
+            return true;
+        }
+
+        // Write the first 3 lanes. A 4-float store could overwrite the next vertex, or run past the end of the buffer.
+        void storeFloat3(SimdFloat4 v, uint8_t* pDst)
+        {
+            float tmp[4];
+            v.store(tmp);
+            std::memcpy(pDst, tmp, 3 * sizeof(float));
+        }
+
+        CpuSkinning::Output offsetOutput(const CpuSkinning::Output& output, uint32_t firstVertex)
+        {
+            CpuSkinning::Output result = output;
+            size_t offset = firstVertex * output.stride;
+            if (result.pPositions) result.pPositions = (float*)((uint8_t*)result.pPositions + offset);
+            if (result.pNormals) result.pNormals = (float*)((uint8_t*)result.pNormals + offset);
+            if (result.pBitangents) result.pBitangents = (float*)((uint8_t*)result.pBitangents + offset);
+            return result;
+        }
+
+        float maxDifference(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b)
+        {
+            float result = 0;
+            for (size_t i = 0; i < std::min(a.size(), b.size()); i++)
+            {
+                glm::vec3 d = glm::abs(a[i] - b[i]);
+                result = std::max(result, std::max(d.x, std::max(d.y, d.z)));
+            }
+            return result;
+        }
+    }
+
+    bool CpuSkinning::readMeshData(const Mesh* pMesh, uint32_t boneCount, MeshData& data)
+    {
+        // The formats SkinningCache's shader reads
+        const Vao* pVao = pMesh->getVao().get();
+        uint32_t vertexCount = pMesh->getVertexCount();
+        data.pMesh = pMesh;
+        if (readAttribute(pVao, VERTEX_POSITION_LOC, ResourceFormat::RGB32Float, vertexCount, data.positions) == false ||
+            readAttribute(pVao, VERTEX_BONE_WEIGHT_LOC, ResourceFormat::RGBA32Float, vertexCount, data.boneWeights) == false ||
+            readAttribute(pVao, VERTEX_BONE_ID_LOC, ResourceFormat::RGBA8Uint, vertexCount, data.boneIds) == false)
+        {
+            logWarning("CpuSkinning::readMeshData() - The mesh needs float3 positions, float4 bone weights and uint8 bone IDs.");
+            return false;
+        }
+        readAttribute(pVao, VERTEX_NORMAL_LOC, ResourceFormat::RGB32Float, vertexCount, data.normals);
+        readAttribute(pVao, VERTEX_BITANGENT_LOC, ResourceFormat::RGB32Float, vertexCount, data.bitangents);
+
+        // Guard against IDs past the model's bones, skinning would read out of bounds
+        for (uint32_t ids : data.boneIds)
+        {
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                if (((ids >> (i * 8)) & 0xff) >= boneCount)
+                {
+                    logWarning("CpuSkinning::readMeshData() - The mesh has out of range bone IDs.");
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    CpuSkinning::SharedPtr CpuSkinning::create(const Model* pModel)
+    {
+        if (pModel->hasBones() == false)
+        {
+            logWarning("CpuSkinning::create() - The model has no bones.");
+            return nullptr;
+        }
+
+        SharedPtr pSkinning = SharedPtr(new CpuSkinning());
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); meshId++)
+        {
+            const Mesh* pMesh = pModel->getMesh(meshId).get();
+            if (pMesh->hasBones() == false) continue;
+
+            MeshData data;
+            if (readMeshData(pMesh, pModel->getBoneCount(), data)) pSkinning->mMeshes.push_back(std::move(data));
+        }
+        if (pSkinning->mMeshes.empty()) return nullptr;
+
+        for (uint32_t meshId = 0; meshId < pSkinning->getMeshCount(); meshId++)
+        {
+            uint32_t vertexCount = pSkinning->getVertexCount(meshId);
+            for (uint32_t first = 0; first < vertexCount; first += kChunkVertexCount)
+            {
+                pSkinning->mChunks.push_back({ meshId, first, std::min(kChunkVertexCount, vertexCount - first) });
+            }
+        }
+        pSkinning->mStats.meshCount = pSkinning->getMeshCount();
+        pSkinning->mStats.readbackTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return pSkinning;
+    }
+
+    uint32_t CpuSkinning::findMesh(const Mesh* pMesh) const
+    {
+        for (uint32_t meshId = 0; meshId < getMeshCount(); meshId++)
+        {
+            if (mMeshes[meshId].pMesh == pMesh) return meshId;
+        }
+        return uint32_t(-1);
+    }
+
+    void CpuSkinning::skinMesh(uint32_t meshId, const glm::mat4* pBones, const glm::mat4* pBonesInvTranspose, const Output& output, uint32_t firstVertex, uint32_t vertexCount) const
+    {
+        const MeshData& mesh = mMeshes[meshId];
+        assert(firstVertex + vertexCount <= mesh.positions.size());
+        uint8_t* pPositions = (uint8_t*)output.pPositions;
+        uint8_t* pNormals = mesh.normals.empty() ? nullptr : (uint8_t*)output.pNormals;
+        uint8_t* pBitangents = mesh.bitangents.empty() ? nullptr : (uint8_t*)output.pBitangents;
+        const SimdFloat4 zero(0.0f);
+        const SimdFloat4 one(1.0f);
+
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            uint32_t v = firstVertex + i;
+            uint32_t ids = mesh.boneIds[v];
+            uint32_t id[4] = { ids & 0xff, (ids >> 8) & 0xff, (ids >> 16) & 0xff, ids >> 24 };
+            const glm::vec4& w = mesh.boneWeights[v];
+            SimdFloat8 weight[4] = { SimdFloat8(w.x), SimdFloat8(w.y), SimdFloat8(w.z), SimdFloat8(w.w) };
+            size_t offset = i * output.stride;
+
+            // Blend the bone matrices two columns at a time, in the shader's order. The matrices are column-major, so columns 0-1 and 2-3 are 8 consecutive floats.
+            SimdFloat8 cols01 = SimdFloat8::load(&pBones[id[0]][0][0]) * weight[0];
+            SimdFloat8 cols23 = SimdFloat8::load(&pBones[id[0]][2][0]) * weight[0];
+            for (uint32_t b = 1; b < 4; b++)
+            {
+                cols01 = cols01 + SimdFloat8::load(&pBones[id[b]][0][0]) * weight[b];
+                cols23 = cols23 + SimdFloat8::load(&pBones[id[b]][2][0]) * weight[b];
+            }
+
+            if (pPositions)
+            {
+                const glm::vec3& p = mesh.positions[v];
+                SimdFloat8 r = cols01 * SimdFloat8(SimdFloat4(p.x), SimdFloat4(p.y)) + cols23 * SimdFloat8(SimdFloat4(p.z), one);
+                storeFloat3(simdLow(r) + simdHigh(r), pPositions + offset);
+            }
+            if (pBitangents)
+            {
+                const glm::vec3& t = mesh.bitangents[v];
+                SimdFloat8 r = cols01 * SimdFloat8(SimdFloat4(t.x), SimdFloat4(t.y)) + cols23 * SimdFloat8(SimdFloat4(t.z), zero);
+                storeFloat3(simdLow(r) + simdHigh(r), pBitangents + offset);
+            }
+            if (pNormals)
+            {
+                // Only the upper 3x3 of the inverse transpose is used, its 4th column is multiplied by 0
+                SimdFloat8 invCols01 = SimdFloat8::load(&pBonesInvTranspose[id[0]][0][0]) * weight[0];
+                SimdFloat8 invCols23 = SimdFloat8::load(&pBonesInvTranspose[id[0]][2][0]) * weight[0];
+                for (uint32_t b = 1; b < 4; b++)
+                {
+                    invCols01 = invCols01 + SimdFloat8::load(&pBonesInvTranspose[id[b]][0][0]) * weight[b];
+                    invCols23 = invCols23 + SimdFloat8::load(&pBonesInvTranspose[id[b]][2][0]) * weight[b];
+                }
+                const glm::vec3& n = mesh.normals[v];
+                SimdFloat8 r = invCols01 * SimdFloat8(SimdFloat4(n.x), SimdFloat4(n.y)) + invCols23 * SimdFloat8(SimdFloat4(n.z), zero);
+                storeFloat3(simdLow(r) + simdHigh(r), pNormals + offset);
+            }
+        }
+    }
+
+    void CpuSkinning::skinChunks(const glm::mat4* pBones, const glm::mat4* pBonesInvTranspose, const Output* pOutputs, uint32_t threadCount) const
+    {
+        parallelFor((uint32_t)mChunks.size(), threadCount, [&](uint32_t chunkId)
+        {
+            const Chunk& chunk = mChunks[chunkId];
+            skinMesh(chunk.meshId, pBones, pBonesInvTranspose, offsetOutput(pOutputs[chunk.meshId], chunk.firstVertex), chunk.firstVertex, chunk.vertexCount);
+        });
+    }
+
+    void CpuSkinning::skin(const Model* pModel, const Output* pOutputs, uint32_t threadCount)
+    {
+        if (pModel->getBoneCount() == 0)
+        {
+            logWarning("CpuSkinning::skin() - The model has no bones.");
+            return;
+        }
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        threadCount = threadCount ? threadCount : WorkerPool::get().getThreadCount();
+        skinChunks(pModel->getBoneMatrices(), pModel->getBoneInvTransposeMatrices(), pOutputs, threadCount);
+
+        mStats.vertexCount = 0;
+        for (uint32_t meshId = 0; meshId < getMeshCount(); meshId++) mStats.vertexCount += getVertexCount(meshId);
+        mStats.threadCount = std::min(threadCount, (uint32_t)mChunks.size());
+        mStats.skinTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
+
+    CpuSkinning::ValidationStats CpuSkinning::validate(const Model* pModel) const
+    {
+        ValidationStats stats;
+        const SkinningCache* pSkinningCache = pModel->getSkinningCache().get();
+        if (pSkinningCache == nullptr || pModel->getBoneCount() == 0)
+        {
+            logWarning("CpuSkinning::validate() - The model has no bones, or no skinning cache.");
+            return stats;
+        }
+
+        std::vector<glm::vec3> gpu[3];
+        std::vector<glm::vec3> cpu[3];
+        for (uint32_t meshId = 0; meshId < getMeshCount(); meshId++)
+        {
+            const Vao* pVao = pSkinningCache->getVao(mMeshes[meshId].pMesh).get();
+            if (pVao == nullptr) continue;
+
+            uint32_t vertexCount = getVertexCount(meshId);
+            readAttribute(pVao, VERTEX_POSITION_LOC, ResourceFormat::RGB32Float, vertexCount, gpu[0]);
+            readAttribute(pVao, VERTEX_NORMAL_LOC, ResourceFormat::RGB32Float, vertexCount, gpu[1]);
+            readAttribute(pVao, VERTEX_BITANGENT_LOC, ResourceFormat::RGB32Float, vertexCount, gpu[2]);
+
+            // Skin only the attributes the GPU wrote
+            for (uint32_t i = 0; i < 3; i++) cpu[i].assign(gpu[i].size(), glm::vec3(0.0f));
+            Output output;
+            output.pPositions = cpu[0].empty() ? nullptr : &cpu[0][0].x;
+            output.pNormals = cpu[1].empty() ? nullptr : &cpu[1][0].x;
+            output.pBitangents = cpu[2].empty() ? nullptr : &cpu[2][0].x;
+            skinMesh(meshId, pModel->getBoneMatrices(), pModel->getBoneInvTransposeMatrices(), output, 0, vertexCount);
+
+            stats.maxPositionError = std::max(stats.maxPositionError, maxDifference(cpu[0], gpu[0]));
+            stats.maxNormalError = std::max(stats.maxNormalError, maxDifference(cpu[1], gpu[1]));
+            stats.maxBitangentError = std::max(stats.maxBitangentError, maxDifference(cpu[2], gpu[2]));
+            stats.meshCount++;
+            stats.vertexCount += vertexCount;
+        }
+        return stats;
+    }
+
+    std::string CpuSkinning::getStatsString() const
+    {
+        const Stats& s = mStats;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "CpuSkinning: " << s.meshCount << " meshes, readback " << s.readbackTimeMs << " ms. Skinned " << s.vertexCount << " vertices in " << s.skinTimeMs << " ms on "
+           << s.threadCount << " threads (" << std::setprecision(1) << s.vertexCount / (std::max(s.skinTimeMs, 0.001) * 1000.0) << " Mverts/s)";
+        return ss.str();
+    }
+
+    std::string CpuSkinning::getValidationStatsString(const ValidationStats& stats)
+    {
+        std::stringstream ss;
+        ss << std::scientific << std::setprecision(2);
+        ss << "CpuSkinning: Compared " << stats.meshCount << " meshes, " << stats.vertexCount << " vertices with the GPU. Max error: position " << stats.maxPositionError
+           << ", normal " << stats.maxNormalError << ", bitangent " << stats.maxBitangentError;
+        return ss.str();
+    }
+}
@@ -0,0 +1,155 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "glm/mat4x4.hpp"
+
+namespace Falcor
+{
+    class Model;
+    class Mesh;
+
+    /** Skins the meshes of a model on the CPU, with the same math as SkinningCache's compute shader.
+        For code which needs the skinned geometry without the GPU round trip, such as headless tools and the CPU BVH (see SceneBvh::updateMesh()).
+        The bind pose, bone IDs and weights are read back from the GPU once, at creation. Skinning writes into buffers owned by the caller and doesn't allocate memory.
+        Each vertex blends its 4 bone matrices two columns at a time with SimdFloat8. Meshes are split into chunks of vertices which are skinned in parallel.
+    */
+    class CpuSkinning
+    {
+    public:
+        using SharedPtr = std::shared_ptr<CpuSkinning>;
+        using SharedConstPtr = std::shared_ptr<const CpuSkinning>;
+
+        /** The skinning input of a mesh, as stored in its vertex buffers
+        */
+        struct MeshData
+        {
+            const Mesh* pMesh = nullptr;
+            std::vector<glm::vec3> positions;
+            std::vector<glm::vec3> normals;         ///< Empty if the mesh has no normals
+            std::vector<glm::vec3> bitangents;      ///< Empty if the mesh has no bitangents
+            std::vector<glm::vec4> boneWeights;
+            std::vector<uint32_t> boneIds;          ///< 4 8-bit bone IDs per vertex, like the RGBA8Uint vertex buffer
+        };
+
+        /** Where to write the skinned vertices of a mesh. Null pointers skip the attribute, as does a mesh without it.
+        */
+        struct Output
+        {
+            float* pPositions = nullptr;
+            float* pNormals = nullptr;
+            float* pBitangents = nullptr;
+            size_t stride = sizeof(glm::vec3);      ///< The distance between vertices in each buffer, in bytes
+        };
+
+        struct Stats
+        {
+            uint32_t meshCount = 0;
+            uint64_t vertexCount = 0;               ///< Vertices skinned by the last skin()
+            uint32_t threadCount = 0;
+            double readbackTimeMs = 0;              ///< Reading the meshes back at creation
+            double skinTimeMs = 0;                  ///< The last skin()
+        };
+
+        /** Difference between the vertices skinned on the CPU and by SkinningCache. See validate().
+        */
+        struct ValidationStats
+        {
+            uint32_t meshCount = 0;                 ///< Meshes compared. Meshes SkinningCache hasn't skinned yet are skipped.
+            uint64_t vertexCount = 0;
+            float maxPositionError = 0;             ///< Largest difference of a coordinate
+            float maxNormalError = 0;
+            float maxBitangentError = 0;
+        };
+
+        /** Create the skinning data of a model. Needs to run on the thread which owns the render context.
+            \return A new object, or nullptr if the model has no meshes which can be skinned
+        */
+        static SharedPtr create(const Model* pModel);
+
+        uint32_t getMeshCount() const { return (uint32_t)mMeshes.size(); }
+        const MeshData& getMeshData(uint32_t meshId) const { return mMeshes[meshId]; }
+        uint32_t getVertexCount(uint32_t meshId) const { return (uint32_t)mMeshes[meshId].positions.size(); }
+
+        /** Find the skinning data of a mesh of the model
+            \return The mesh ID, or uint32_t(-1) if the mesh isn't skinned
+        */
+        uint32_t findMesh(const Mesh* pMesh) const;
+
+        /** Skin a range of the vertices of a mesh. Can be called from any thread.
+            \param[in] pBones The model's bone matrices, see Model::getBoneMatrices()
+            \param[in] pBonesInvTranspose The inverse transpose of the bone matrices, see Model::getBoneInvTransposeMatrices()
+            \param[in] output The mesh's output buffers. Vertex firstVertex is written at the start of each buffer.
+        */
+        void skinMesh(uint32_t meshId, const glm::mat4* pBones, const glm::mat4* pBonesInvTranspose, const Output& output, uint32_t firstVertex, uint32_t vertexCount) const;
+
+        /** Skin all the meshes with the model's current bone matrices
+            \param[in] pOutputs The output buffers of each mesh, getMeshCount() elements
+            \param[in] threadCount The number of threads to use. 0 uses all the hardware threads.
+        */
+        void skin(const Model* pModel, const Output* pOutputs, uint32_t threadCount = 0);
+
+        /** Compare the CPU skinning of the model's current pose with the vertex buffers written by the model's SkinningCache.
+            Call it after SkinningCache::update() for the same pose. Needs to run on the thread which owns the render context.
+        */
+        ValidationStats validate(const Model* pModel) const;
+
+        const Stats& getStats() const { return mStats; }
+
+        /** Get a one-line summary of the stats, for logging
+        */
+        std::string getStatsString() const;
+
+        /** Get a one-line summary of validate() results, for logging
+        */
+        static std::string getValidationStatsString(const ValidationStats& stats);
+
+    private:
+        CpuSkinning() = default;
+
+        /** A range of the vertices of a mesh, the unit of work of skin()
+        */
+        struct Chunk
+        {
+            uint32_t meshId;
+            uint32_t firstVertex;
+            uint32_t vertexCount;
+        };
+
+        static bool readMeshData(const Mesh* pMesh, uint32_t boneCount, MeshData& data);
+        void skinChunks(const glm::mat4* pBones, const glm::mat4* pBonesInvTranspose, const Output* pOutputs, uint32_t threadCount) const;
+
+        std::vector<MeshData> mMeshes;
+        std::vector<Chunk> mChunks;
+        Stats mStats;
+    };
+}
@@ -43,6 +43,10 @@
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
 #include "API/Device.h"
+#include "Utils/MeshOptimizer.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include <atomic>
 
 namespace Falcor
 {
@@ -268,8 +272,46 @@ namespace Falcor
         }
     }
 
+    void AssimpModelImporter::prefetchTextures(const aiScene* pScene, const std::string& folder, bool useSrgb)
+    {
+        // Collect the textures of all materials, in the order loadTextures() would load them. The first use of a texture decides its color space, like it does there.
+        uint32_t shadingModel = is_set(mFlags, Model::LoadFlags::UseSpecGlossMaterials) ? ShadingModelSpecGloss : ShadingModelMetalRough;
+        std::vector<std::string> names;
+        std::vector<TextureFileDesc> files;
+        for (uint32_t m = 0; m < pScene->mNumMaterials; m++)
+        {
+            const aiMaterial* pAiMaterial = pScene->mMaterials[m];
+            for (int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
+            {
+                aiTextureType aiType = (aiTextureType)i;
+                uint32_t textureCount = pAiMaterial->GetTextureCount(aiType);
+                if (textureCount > 1) break;
+                if (textureCount == 0) continue;
+
+                aiString path;
+                pAiMaterial->GetTexture(aiType, 0, &path);
+                std::string s(path.data);
+                if (s.empty() || std::find(names.begin(), names.end(), s) != names.end()) continue;
+
+                TextureFileDesc file;
+                file.filename = replaceSubstring(folder + '/' + s, "\\", "/");
+                file.loadAsSrgb = isSrgbRequired(aiType, useSrgb, shadingModel);
+                names.push_back(s);
+                files.push_back(file);
+            }
+        }
+
+        // Decode them in parallel. Textures which fail to load aren't cached, so loadTextures() will try them again and report the error as before.
+        std::vector<Texture::SharedPtr> textures = createTexturesFromFiles(files, true);
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            if (textures[i]) mTextureCache[names[i]] = textures[i];
+        }
+    }
+
     void AssimpModelImporter::loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool isObjFile, bool useSrgb)
     {
+        bool loadedTexture = false;
         for (int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
         {
             aiTextureType aiType = (aiTextureType)i;
@@ -311,6 +353,7 @@ namespace Falcor
                     if (pTex)
                     {
                         mTextureCache[s] = pTex;
+                        loadedTexture = true;
                     }
                 }
 
@@ -319,8 +362,12 @@ namespace Falcor
             }
         }
 
-        // Flush upload heap after every material so we don't accumulate a ton of memory usage when loading a model with a lot of textures
-        gpDevice->flushAndSync();
+        // Flush upload heap after every material so we don't accumulate a ton of memory usage when loading a model with a lot of textures.
+        // Textures coming from prefetchTextures() were already flushed.
+        if (loadedTexture)
+        {
+            gpDevice->flushAndSync();
+        }
     }
 
     Material::SharedPtr AssimpModelImporter::createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb)
@@ -429,12 +476,158 @@ namespace Falcor
         return b;
     }
 
+    struct MeshOptimizationStats
+    {
+        uint32_t meshCount = 0;
+        uint64_t triangleCount = 0;
+        uint64_t vertexCount = 0;
+        uint64_t transformsBefore = 0;
+        uint64_t transformsAfter = 0;
+        uint32_t meshletCount = 0;
+        uint64_t meshletTriangleCount = 0;
+        double meshletTimeMs = 0;
+    };
+
+    template<typename T>
+    void remapVertexArray(T* pData, uint32_t vertexCount, const std::vector<uint32_t>& remap)
+    {
+        if (pData == nullptr) return;
+        std::vector<T> original(pData, pData + vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++) pData[remap[v]] = original[v];
+    }
+
+    void setFaces(aiMesh* pAiMesh, const std::vector<uint32_t>& indices)
+    {
+        for (uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
+        {
+            for (uint32_t j = 0; j < 3; j++) pAiMesh->mFaces[i].mIndices[j] = indices[i * 3 + j];
+        }
+    }
+
+    // Reorders the triangles of a mesh for the vertex cache and for overdraw, then its vertices for fetch locality
+    void optimizeMesh(aiMesh* pAiMesh, MeshOptimizationStats& stats)
+    {
+        if (pAiMesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || pAiMesh->mNumFaces == 0) return;
+
+        const uint32_t vertexCount = pAiMesh->mNumVertices;
+        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+        MeshOptimizer::CacheStats before = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+        MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+        MeshOptimizer::optimizeOverdraw(indices.data(), indices.size(), &pAiMesh->mVertices[0].x, sizeof(aiVector3D), vertexCount);
+
+        // Morph targets store their own copies of the vertex attributes, so don't renumber the vertices of those meshes
+        if (pAiMesh->mNumAnimMeshes == 0)
+        {
+            std::vector<uint32_t> remap;
+            MeshOptimizer::optimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+
+            remapVertexArray(pAiMesh->mVertices, vertexCount, remap);
+            remapVertexArray(pAiMesh->mNormals, vertexCount, remap);
+            remapVertexArray(pAiMesh->mTangents, vertexCount, remap);
+            remapVertexArray(pAiMesh->mBitangents, vertexCount, remap);
+            for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++) remapVertexArray(pAiMesh->mColors[i], vertexCount, remap);
+            for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++) remapVertexArray(pAiMesh->mTextureCoords[i], vertexCount, remap);
+            for (uint32_t b = 0; b < pAiMesh->mNumBones; b++)
+            {
+                aiBone* pBone = pAiMesh->mBones[b];
+                for (uint32_t w = 0; w < pBone->mNumWeights; w++) pBone->mWeights[w].mVertexId = remap[pBone->mWeights[w].mVertexId];
+            }
+        }
+
+        setFaces(pAiMesh, indices);
+
+        stats.meshCount++;
+        stats.triangleCount += pAiMesh->mNumFaces;
+        stats.vertexCount += vertexCount;
+        stats.transformsBefore += before.transformedVertices;
+    }
+
+    // Measures the vertex cache efficiency of the final index buffer, once the meshlets are built too
+    void measureOptimizedMesh(aiMesh* pAiMesh, MeshOptimizationStats& stats)
+    {
+        if (pAiMesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || pAiMesh->mNumFaces == 0) return;
+
+        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+        stats.transformsAfter += MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), pAiMesh->mNumVertices).transformedVertices;
+    }
+
+    // Splits a mesh into meshlets. Unless the triangles were already optimized, they are reordered to match.
+    void buildMeshlets(aiMesh* pAiMesh, bool keepTriangleOrder, MeshletData& meshlets, MeshOptimizationStats& stats)
+    {
+        if (pAiMesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || pAiMesh->mNumFaces == 0) return;
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+        MeshletBuilder::Desc desc;
+        desc.keepTriangleOrder = keepTriangleOrder;
+        MeshletBuilder::build(indices.data(), indices.size(), &pAiMesh->mVertices[0].x, sizeof(aiVector3D), pAiMesh->mNumVertices, desc, meshlets);
+        setFaces(pAiMesh, indices);
+
+        stats.meshletCount += (uint32_t)meshlets.meshlets.size();
+        stats.meshletTriangleCount += pAiMesh->mNumFaces;
+        stats.meshletTimeMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
+
+    void AssimpModelImporter::processMeshes(const aiScene* pScene, const std::string& filename)
+    {
+        const bool optimize = is_set(mFlags, Model::LoadFlags::DontOptimizeMeshes) == false;
+        const bool generateMeshlets = is_set(mFlags, Model::LoadFlags::GenerateMeshlets);
+        if (pScene->mNumMeshes == 0 || (optimize == false && generateMeshlets == false)) return;
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+
+        if (generateMeshlets) mMeshlets.resize(pScene->mNumMeshes);
+        uint32_t threadCount = std::min(WorkerPool::get().getThreadCount(), pScene->mNumMeshes);
+        std::vector<MeshOptimizationStats> threadStats(threadCount);
+        std::atomic<uint32_t> nextMesh(0);
+        parallelFor(threadCount, threadCount, [&](uint32_t threadId)
+        {
+            for (uint32_t meshId = nextMesh++; meshId < pScene->mNumMeshes; meshId = nextMesh++)
+            {
+                // The cache stats are measured last, so they describe the index buffer the mesh ends up with
+                if (optimize) optimizeMesh(pScene->mMeshes[meshId], threadStats[threadId]);
+                if (generateMeshlets) buildMeshlets(pScene->mMeshes[meshId], optimize, mMeshlets[meshId], threadStats[threadId]);
+                if (optimize) measureOptimizedMesh(pScene->mMeshes[meshId], threadStats[threadId]);
+            }
+        });
+
+        MeshOptimizationStats stats;
+        for (const auto& s : threadStats)
+        {
+            stats.meshCount += s.meshCount;
+            stats.triangleCount += s.triangleCount;
+            stats.vertexCount += s.vertexCount;
+            stats.transformsBefore += s.transformsBefore;
+            stats.transformsAfter += s.transformsAfter;
+            stats.meshletCount += s.meshletCount;
+            stats.meshletTriangleCount += s.meshletTriangleCount;
+            stats.meshletTimeMs += s.meshletTimeMs;
+        }
+
+        double timeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        auto ratio = [](uint64_t a, uint64_t b) { return std::to_string(double(a) / double(b)).substr(0, 5); };
+        if (stats.triangleCount)
+        {
+            logInfo("AssimpModelImporter: Optimized " + std::to_string(stats.meshCount) + " meshes (" + std::to_string(stats.triangleCount) + " triangles) of '" + filename + "'. " +
+                "ACMR " + ratio(stats.transformsBefore, stats.triangleCount) + " -> " + ratio(stats.transformsAfter, stats.triangleCount) + ", " +
+                "ATVR " + ratio(stats.transformsBefore, stats.vertexCount) + " -> " + ratio(stats.transformsAfter, stats.vertexCount));
+        }
+        if (stats.meshletTriangleCount)
+        {
+            logInfo("AssimpModelImporter: Built " + std::to_string(stats.meshletCount) + " meshlets (" + ratio(stats.meshletTriangleCount, stats.meshletCount) + " triangles each) for '" + filename + "', " +
+                std::to_string(stats.meshletTriangleCount / (std::max(stats.meshletTimeMs, 0.001) * 1000.0)) + " Mtri/s per thread");
+        }
+        logInfo("AssimpModelImporter: Processed the meshes of '" + filename + "' in " + std::to_string(timeMs) + " ms on " + std::to_string(threadCount) + " threads");
+    }
+
     AssimpModelImporter::AssimpModelImporter(Model& model, Model::LoadFlags flags) : mFlags(flags), mModel(model)
     {
     }
 
     bool AssimpModelImporter::createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb)
     {
+        prefetchTextures(pScene, modelFolder, useSrgb);
+
         for (uint32_t i = 0; i < pScene->mNumMaterials; i++)
         {
             const aiMaterial* pAiMaterial = pScene->mMaterials[i];
@@ -479,6 +672,10 @@ namespace Falcor
                 {
                     // Cache mesh
                     aiToFalcorMesh[aiId] = createMesh(pScene->mMeshes[aiId]);
+                    if (aiId < mMeshlets.size() && aiToFalcorMesh[aiId])
+                    {
+                        aiToFalcorMesh[aiId]->setMeshlets(std::move(mMeshlets[aiId]));
+                    }
                 }
 
                 mModel.addMeshInstance(aiToFalcorMesh[aiId], aiMatToGLM(transform));
@@ -523,6 +720,9 @@ namespace Falcor
         // Never use Assimp's tangent gen code
         assimpFlags &= ~(aiProcess_CalcTangentSpace);
 
+        // We reorder the triangles ourselves, see processMeshes()
+        if (is_set(mFlags, Model::LoadFlags::DontOptimizeMeshes) == false) assimpFlags &= ~aiProcess_ImproveCacheLocality;
+
         Assimp::Importer importer;
         const aiScene* pScene = importer.ReadFile(fullpath, assimpFlags);
 
@@ -547,6 +747,8 @@ namespace Falcor
             return false;
         }
 
+        processMeshes(pScene, filename);
+
         if (createDrawList(pScene) == false)
         {
             logError(std::string("Can't create draw lists for model ") + filename, true);
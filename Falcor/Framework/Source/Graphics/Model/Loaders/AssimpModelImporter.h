@@ -77,6 +77,7 @@ namespace Falcor
         bool createDrawList(const aiScene* pScene);
         bool parseAiSceneNode(const aiNode* pCurrent, const aiScene* pScene, IdToMesh& aiToFalcorMesh);
         bool createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb);
+        void processMeshes(const aiScene* pScene, const std::string& filename);
 
         void createAnimationController(const aiScene* pScene);
         void initializeBones(const aiScene* pScene);
@@ -89,6 +90,7 @@ namespace Falcor
         VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh);
         Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh);
         Buffer::SharedPtr createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights);
+        void prefetchTextures(const aiScene* pScene, const std::string& folder, bool useSrgb);
         void loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool isObjFile, bool useSrgb);
         Material::SharedPtr createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb);
 
@@ -100,6 +102,7 @@ namespace Falcor
         std::unordered_set<const aiNode*> mAdditionalUsedNodes;
 
         std::map<uint32_t, Material::SharedPtr> mAiMaterialToFalcor;
+        std::vector<MeshletData> mMeshlets;     ///< Built by processMeshes(), indexed by Assimp mesh ID
 
         Model& mModel;
 
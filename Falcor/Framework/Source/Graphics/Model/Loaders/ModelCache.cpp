@@ -0,0 +1,764 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ModelCache.h"
+#include "Utils/Platform/OS.h"
+#include "Utils/StringUtils.h"
+#include "Utils/CpuTimer.h"
+#include "Graphics/TextureHelper.h"
+#include "API/Device.h"
+#include "API/Buffer.h"
+#include "API/VertexLayout.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <type_traits>
+
+namespace Falcor
+{
+    static const uint32_t kFileMagic = 0x464d4346;      // 'FCMF'
+    static const uint32_t kFileVersion = 4;
+    static const uint32_t kTextureSlotCount = 7;
+    static const uint64_t kSectionAlignment = 16;
+    static const uint64_t kUploadFlushThreshold = 256 * 1024 * 1024;
+
+    namespace
+    {
+        // On-disk layout. Every record is a POD with 4-byte members, so the tables can be used in place from the mapped file.
+        // Offsets in the header are relative to the start of the file, data offsets in the records are relative to dataOffset.
+        struct StringRef
+        {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        struct FileHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t sourceHash;
+            uint32_t loadFlags;
+            uint32_t textureCount;
+            uint32_t materialCount;
+            uint32_t meshCount;
+            uint32_t vertexBufferCount;
+            uint32_t elementCount;
+            uint32_t instanceCount;
+            uint32_t reserved;
+            uint64_t texturesOffset;
+            uint64_t materialsOffset;
+            uint64_t meshesOffset;
+            uint64_t vertexBuffersOffset;
+            uint64_t elementsOffset;
+            uint64_t instancesOffset;
+            uint64_t stringsOffset;
+            uint64_t stringsSize;
+            uint64_t dataOffset;
+            uint64_t fileSize;
+        };
+
+        struct TextureRecord
+        {
+            StringRef path;
+            uint32_t isSrgb;
+            uint32_t reserved;
+        };
+
+        struct MaterialRecord
+        {
+            StringRef name;
+            uint32_t shadingModel;
+            uint32_t alphaMode;
+            uint32_t doubleSided;
+            float alphaThreshold;
+            float indexOfRefraction;
+            float heightScale;
+            float heightOffset;
+            float baseColor[4];
+            float specular[4];
+            float emissive[3];
+            int32_t textures[kTextureSlotCount];    ///< Index into the texture table, or -1
+        };
+
+        struct MeshRecord
+        {
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            uint32_t topology;
+            uint32_t materialIndex;
+            uint32_t firstVertexBuffer;
+            uint32_t vertexBufferCount;
+            float bboxCenter[3];
+            float bboxExtent[3];
+            uint64_t indexDataOffset;
+            uint64_t indexDataSize;
+            uint32_t meshletCount;          ///< 0 if the mesh has no meshlets. Otherwise there is one meshlet triangle per triangle of the mesh.
+            uint32_t meshletVertexCount;
+            uint64_t meshletsOffset;
+            uint64_t meshletVerticesOffset;
+            uint64_t meshletTrianglesOffset;
+        };
+
+        static_assert(sizeof(Meshlet) == 88 && std::is_trivially_copyable<Meshlet>::value, "Meshlets are stored as-is, bump kFileVersion when changing them");
+
+        struct VertexBufferRecord
+        {
+            uint32_t firstElement;
+            uint32_t elementCount;
+            uint32_t stride;
+            uint32_t reserved;
+            uint64_t dataOffset;
+            uint64_t dataSize;
+        };
+
+        struct ElementRecord
+        {
+            StringRef name;
+            uint32_t offset;
+            uint32_t format;
+            uint32_t arraySize;
+            uint32_t shaderLocation;
+        };
+
+        struct InstanceRecord
+        {
+            uint32_t meshIndex;
+            uint32_t reserved[3];
+            float transform[16];
+        };
+
+        uint64_t alignUp(uint64_t value)
+        {
+            return (value + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+        }
+
+        // 64-bit FNV-1a, 8 bytes at a time. Model files can be hundreds of MB, so a byte-wise hash is noticeably slower.
+        uint64_t hashData(const void* pData, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+        {
+            const uint64_t kPrime = 0x100000001b3ull;
+            const uint8_t* pBytes = (const uint8_t*)pData;
+            size_t words = size / sizeof(uint64_t);
+            for (size_t i = 0; i < words; i++)
+            {
+                uint64_t w;
+                std::memcpy(&w, pBytes + i * sizeof(uint64_t), sizeof(w));
+                hash = (hash ^ w) * kPrime;
+            }
+            for (size_t i = words * sizeof(uint64_t); i < size; i++)
+            {
+                hash = (hash ^ pBytes[i]) * kPrime;
+            }
+            return hash;
+        }
+
+        // Unmaps a file when going out of scope
+        struct MappedFile
+        {
+            const uint8_t* pData = nullptr;
+            size_t size = 0;
+            MappedFile(const std::string& filename) { pData = (const uint8_t*)mapFile(filename, size); }
+            ~MappedFile() { unmapFile(pData, size); }
+        };
+
+        // Find the material libraries referenced by an OBJ file. Their content affects the imported materials.
+        std::vector<std::string> findObjMaterialLibraries(const char* pData, size_t size)
+        {
+            std::vector<std::string> libs;
+            const char* pCur = pData;
+            const char* pEnd = pData + size;
+            while (pCur < pEnd)
+            {
+                const char* pLineEnd = (const char*)std::memchr(pCur, '\n', pEnd - pCur);
+                if (pLineEnd == nullptr) pLineEnd = pEnd;
+                if (pLineEnd - pCur > 7 && std::strncmp(pCur, "mtllib", 6) == 0 && (pCur[6] == ' ' || pCur[6] == '\t'))
+                {
+                    std::string name(pCur + 7, pLineEnd);
+                    size_t first = name.find_first_not_of(" \t");
+                    size_t last = name.find_last_not_of(" \t\r");
+                    if (first != std::string::npos) libs.push_back(name.substr(first, last - first + 1));
+                }
+                pCur = pLineEnd + 1;
+            }
+            return libs;
+        }
+
+        Texture::SharedPtr getMaterialTexture(const Material* pMaterial, uint32_t slot)
+        {
+            switch (slot)
+            {
+            case 0: return pMaterial->getBaseColorTexture();
+            case 1: return pMaterial->getSpecularTexture();
+            case 2: return pMaterial->getEmissiveTexture();
+            case 3: return pMaterial->getNormalMap();
+            case 4: return pMaterial->getOcclusionMap();
+            case 5: return pMaterial->getLightMap();
+            case 6: return pMaterial->getHeightMap();
+            default: should_not_get_here(); return nullptr;
+            }
+        }
+
+        void setMaterialTexture(Material* pMaterial, uint32_t slot, Texture::SharedPtr pTexture)
+        {
+            switch (slot)
+            {
+            case 0: pMaterial->setBaseColorTexture(pTexture); break;
+            case 1: pMaterial->setSpecularTexture(pTexture); break;
+            case 2: pMaterial->setEmissiveTexture(pTexture); break;
+            case 3: pMaterial->setNormalMap(pTexture); break;
+            case 4: pMaterial->setOcclusionMap(pTexture); break;
+            case 5: pMaterial->setLightMap(pTexture); break;
+            case 6: pMaterial->setHeightMap(pTexture); break;
+            default: should_not_get_here();
+            }
+        }
+
+        // Bounds-checked access to the tables of a mapped cache file
+        class FileReader
+        {
+        public:
+            FileReader(const uint8_t* pData, size_t size) : mpData(pData), mSize(size) {}
+
+            template<typename T>
+            const T* getArray(uint64_t offset, uint64_t count) const
+            {
+                if (offset > mSize || count > (mSize - offset) / sizeof(T)) return nullptr;
+                if (offset % alignof(T)) return nullptr;
+                return (const T*)(mpData + offset);
+            }
+
+            bool isValidRange(uint64_t offset, uint64_t size) const
+            {
+                return offset <= mSize && size <= mSize - offset;
+            }
+
+            const uint8_t* getData(uint64_t offset) const { return mpData + offset; }
+
+        private:
+            const uint8_t* mpData;
+            size_t mSize;
+        };
+
+        // Get the header of a cache file, or nullptr if it isn't one written by this version with these load flags.
+        // BuffersAsShaderResource only changes how the buffers are created, so it doesn't have to match.
+        const FileHeader* readHeader(const uint8_t* pData, size_t size, Model::LoadFlags flags)
+        {
+            const uint32_t kFlagsMask = ~(uint32_t)Model::LoadFlags::BuffersAsShaderResource;
+            const FileHeader* pHeader = FileReader(pData, size).getArray<FileHeader>(0, 1);
+            if (pHeader == nullptr || pHeader->magic != kFileMagic || pHeader->version != kFileVersion || pHeader->fileSize != size) return nullptr;
+            if ((pHeader->loadFlags & kFlagsMask) != ((uint32_t)flags & kFlagsMask)) return nullptr;
+            return pHeader;
+        }
+    }
+
+    ModelCache::SharedPtr ModelCache::create(const Desc& desc)
+    {
+        if (isDirectoryExists(desc.directory) == false && createDirectory(desc.directory) == false)
+        {
+            logWarning("ModelCache: Can't create the cache directory '" + desc.directory + "'. Models will not be cached.");
+            return nullptr;
+        }
+        return SharedPtr(new ModelCache(desc));
+    }
+
+    std::string ModelCache::getCacheFilename(const std::string& fullpath, Model::LoadFlags flags) const
+    {
+        std::string key = canonicalizeFilename(fullpath) + "|" + std::to_string((uint32_t)flags) + "|" + std::to_string(kFileVersion);
+        std::stringstream ss;
+        ss << mDesc.directory << "/" << std::hex << std::setw(16) << std::setfill('0') << hashData(key.data(), key.size()) << ".fmc";
+        return ss.str();
+    }
+
+    bool ModelCache::hashSources(const std::string& fullpath, uint64_t& hash) const
+    {
+        MappedFile file(fullpath);
+        if (file.pData == nullptr) return false;
+        hash = hashData(file.pData, file.size);
+
+        if (hasSuffix(fullpath, ".obj", false))
+        {
+            std::string folder = getDirectoryFromFile(fullpath);
+            for (const auto& lib : findObjMaterialLibraries((const char*)file.pData, file.size))
+            {
+                // A missing library is hashed as empty, so creating it later invalidates the entry
+                hash = hashData(lib.data(), lib.size(), hash);
+                MappedFile libFile(folder + "/" + lib);
+                if (libFile.pData) hash = hashData(libFile.pData, libFile.size, hash);
+            }
+        }
+        return true;
+    }
+
+    bool ModelCache::serialize(const Model& model, Model::LoadFlags flags, uint64_t sourceHash, std::vector<uint8_t>& fileData)
+    {
+        if (model.hasBones() || model.hasAnimations()) return false;
+
+        std::vector<TextureRecord> textures;
+        std::vector<MaterialRecord> materials;
+        std::vector<MeshRecord> meshes;
+        std::vector<VertexBufferRecord> vertexBuffers;
+        std::vector<ElementRecord> elements;
+        std::vector<InstanceRecord> instances;
+        std::string strings;
+        std::vector<uint8_t> data;
+
+        auto addString = [&strings](const std::string& str)
+        {
+            StringRef ref = { (uint32_t)strings.size(), (uint32_t)str.size() };
+            strings += str;
+            return ref;
+        };
+
+        auto addData = [&data](const void* pSrc, size_t size)
+        {
+            uint64_t offset = alignUp(data.size());
+            data.resize(offset + size);
+            std::memcpy(data.data() + offset, pSrc, size);
+            return offset;
+        };
+
+        // Reads a GPU buffer back and appends it to the data section
+        auto addBufferData = [&addData](const Buffer::SharedPtr& pBuffer)
+        {
+            const void* pSrc = pBuffer->map(Buffer::MapType::Read);
+            uint64_t offset = addData(pSrc, pBuffer->getSize());
+            pBuffer->unmap();
+            return offset;
+        };
+
+        std::map<const Texture*, int32_t> textureIds;
+        std::map<const Material*, uint32_t> materialIds;
+        bool cacheable = true;
+
+        auto addTexture = [&](const Texture::SharedPtr& pTexture) -> int32_t
+        {
+            if (pTexture == nullptr) return -1;
+            auto it = textureIds.find(pTexture.get());
+            if (it != textureIds.end()) return it->second;
+
+            // Textures which weren't loaded from a file can't be recreated
+            if (pTexture->getSourceFilename().empty()) cacheable = false;
+
+            TextureRecord rec = {};
+            rec.path = addString(pTexture->getSourceFilename());
+            rec.isSrgb = isSrgbFormat(pTexture->getFormat()) ? 1 : 0;
+            int32_t id = (int32_t)textures.size();
+            textures.push_back(rec);
+            textureIds[pTexture.get()] = id;
+            return id;
+        };
+
+        auto addMaterial = [&](const Material* pMaterial) -> uint32_t
+        {
+            auto it = materialIds.find(pMaterial);
+            if (it != materialIds.end()) return it->second;
+
+            MaterialRecord rec = {};
+            rec.name = addString(pMaterial->getName());
+            rec.shadingModel = pMaterial->getShadingModel();
+            rec.alphaMode = pMaterial->getAlphaMode();
+            rec.doubleSided = pMaterial->getDoubleSided() ? 1 : 0;
+            rec.alphaThreshold = pMaterial->getAlphaThreshold();
+            rec.indexOfRefraction = pMaterial->getIndexOfRefraction();
+            rec.heightScale = pMaterial->getHeightScale();
+            rec.heightOffset = pMaterial->getHeightOffset();
+            std::memcpy(rec.baseColor, &pMaterial->getBaseColor(), sizeof(rec.baseColor));
+            std::memcpy(rec.specular, &pMaterial->getSpecularParams(), sizeof(rec.specular));
+            std::memcpy(rec.emissive, &pMaterial->getEmissiveColor(), sizeof(rec.emissive));
+            for (uint32_t slot = 0; slot < kTextureSlotCount; slot++)
+            {
+                rec.textures[slot] = addTexture(getMaterialTexture(pMaterial, slot));
+            }
+
+            uint32_t id = (uint32_t)materials.size();
+            materials.push_back(rec);
+            materialIds[pMaterial] = id;
+            return id;
+        };
+
+        for (uint32_t meshId = 0; meshId < model.getMeshCount(); meshId++)
+        {
+            const Mesh* pMesh = model.getMesh(meshId).get();
+            const Vao* pVao = pMesh->getVao().get();
+            const VertexLayout* pLayout = pVao->getVertexLayout().get();
+
+            MeshRecord rec = {};
+            rec.vertexCount = pMesh->getVertexCount();
+            rec.indexCount = pMesh->getIndexCount();
+            rec.topology = (uint32_t)pVao->getPrimitiveTopology();
+            rec.materialIndex = addMaterial(pMesh->getMaterial().get());
+            rec.firstVertexBuffer = (uint32_t)vertexBuffers.size();
+            rec.vertexBufferCount = pVao->getVertexBuffersCount();
+            std::memcpy(rec.bboxCenter, &pMesh->getBoundingBox().center, sizeof(rec.bboxCenter));
+            std::memcpy(rec.bboxExtent, &pMesh->getBoundingBox().extent, sizeof(rec.bboxExtent));
+
+            if (pVao->getIndexBuffer() == nullptr || pVao->getIndexBufferFormat() != ResourceFormat::R32Uint || pLayout->getBufferCount() != rec.vertexBufferCount)
+            {
+                cacheable = false;
+                break;
+            }
+            rec.indexDataSize = pVao->getIndexBuffer()->getSize();
+            rec.indexDataOffset = addBufferData(pVao->getIndexBuffer());
+
+            const MeshletData& meshlets = pMesh->getMeshlets();
+            if (meshlets.meshlets.size() && meshlets.triangles.size() == rec.indexCount)
+            {
+                rec.meshletCount = (uint32_t)meshlets.meshlets.size();
+                rec.meshletVertexCount = (uint32_t)meshlets.vertices.size();
+                rec.meshletsOffset = addData(meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(Meshlet));
+                rec.meshletVerticesOffset = addData(meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t));
+                rec.meshletTrianglesOffset = addData(meshlets.triangles.data(), meshlets.triangles.size());
+            }
+
+            for (uint32_t i = 0; i < rec.vertexBufferCount; i++)
+            {
+                const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(i).get();
+                VertexBufferRecord vbRec = {};
+                vbRec.firstElement = (uint32_t)elements.size();
+                vbRec.elementCount = pVbLayout->getElementCount();
+                vbRec.stride = pVbLayout->getStride();
+                vbRec.dataSize = pVao->getVertexBuffer(i)->getSize();
+                vbRec.dataOffset = addBufferData(pVao->getVertexBuffer(i));
+                vertexBuffers.push_back(vbRec);
+
+                for (uint32_t e = 0; e < vbRec.elementCount; e++)
+                {
+                    ElementRecord elemRec = {};
+                    elemRec.name = addString(pVbLayout->getElementName(e));
+                    elemRec.offset = pVbLayout->getElementOffset(e);
+                    elemRec.format = (uint32_t)pVbLayout->getElementFormat(e);
+                    elemRec.arraySize = pVbLayout->getElementArraySize(e);
+                    elemRec.shaderLocation = pVbLayout->getElementShaderLocation(e);
+                    elements.push_back(elemRec);
+                }
+            }
+
+            for (uint32_t i = 0; i < model.getMeshInstanceCount(meshId); i++)
+            {
+                InstanceRecord instRec = {};
+                instRec.meshIndex = (uint32_t)meshes.size();
+                std::memcpy(instRec.transform, &model.getMeshInstance(meshId, i)->getTransformMatrix(), sizeof(instRec.transform));
+                instances.push_back(instRec);
+            }
+            meshes.push_back(rec);
+        }
+
+        if (cacheable == false) return false;
+
+        // Lay out the sections
+        FileHeader header = {};
+        header.magic = kFileMagic;
+        header.version = kFileVersion;
+        header.sourceHash = sourceHash;
+        header.loadFlags = (uint32_t)flags;
+        header.textureCount = (uint32_t)textures.size();
+        header.materialCount = (uint32_t)materials.size();
+        header.meshCount = (uint32_t)meshes.size();
+        header.vertexBufferCount = (uint32_t)vertexBuffers.size();
+        header.elementCount = (uint32_t)elements.size();
+        header.instanceCount = (uint32_t)instances.size();
+
+        uint64_t offset = alignUp(sizeof(FileHeader));
+        header.texturesOffset = offset;         offset = alignUp(offset + textures.size() * sizeof(TextureRecord));
+        header.materialsOffset = offset;        offset = alignUp(offset + materials.size() * sizeof(MaterialRecord));
+        header.meshesOffset = offset;           offset = alignUp(offset + meshes.size() * sizeof(MeshRecord));
+        header.vertexBuffersOffset = offset;    offset = alignUp(offset + vertexBuffers.size() * sizeof(VertexBufferRecord));
+        header.elementsOffset = offset;         offset = alignUp(offset + elements.size() * sizeof(ElementRecord));
+        header.instancesOffset = offset;        offset = alignUp(offset + instances.size() * sizeof(InstanceRecord));
+        header.stringsOffset = offset;          offset = alignUp(offset + strings.size());
+        header.stringsSize = strings.size();
+        header.dataOffset = offset;             offset = offset + data.size();
+        header.fileSize = offset;
+
+        fileData.assign(header.fileSize, 0);
+        auto writeSection = [&fileData](uint64_t sectionOffset, const void* pData, size_t size)
+        {
+            if (size) std::memcpy(fileData.data() + sectionOffset, pData, size);
+        };
+
+        writeSection(0, &header, sizeof(header));
+        writeSection(header.texturesOffset, textures.data(), textures.size() * sizeof(TextureRecord));
+        writeSection(header.materialsOffset, materials.data(), materials.size() * sizeof(MaterialRecord));
+        writeSection(header.meshesOffset, meshes.data(), meshes.size() * sizeof(MeshRecord));
+        writeSection(header.vertexBuffersOffset, vertexBuffers.data(), vertexBuffers.size() * sizeof(VertexBufferRecord));
+        writeSection(header.elementsOffset, elements.data(), elements.size() * sizeof(ElementRecord));
+        writeSection(header.instancesOffset, instances.data(), instances.size() * sizeof(InstanceRecord));
+        writeSection(header.stringsOffset, strings.data(), strings.size());
+        writeSection(header.dataOffset, data.data(), data.size());
+        return true;
+    }
+
+    bool ModelCache::store(const Model& model, const std::string& filename, Model::LoadFlags flags, double importTimeMs)
+    {
+        mStats.importTimeMs += importTimeMs;
+
+        std::string fullpath;
+        uint64_t sourceHash;
+        if (findFileInDataDirectories(filename, fullpath) == false || hashSources(fullpath, sourceHash) == false) return false;
+
+        std::vector<uint8_t> fileData;
+        if (serialize(model, flags, sourceHash, fileData) == false)
+        {
+            mStats.uncacheable++;
+            return false;
+        }
+
+        // Write to a temporary file first, so a crash or a concurrent load never sees a partial entry
+        std::string cacheFile = getCacheFilename(fullpath, flags);
+        std::string tempFile = cacheFile + ".tmp";
+        {
+            std::ofstream stream(tempFile, std::ios::binary | std::ios::trunc);
+            if (stream.is_open() == false)
+            {
+                logWarning("ModelCache: Can't write '" + tempFile + "'");
+                return false;
+            }
+
+            stream.write((const char*)fileData.data(), fileData.size());
+            if (stream.fail())
+            {
+                stream.close();
+                std::remove(tempFile.c_str());
+                logWarning("ModelCache: Failed writing '" + tempFile + "'");
+                return false;
+            }
+        }
+
+        std::remove(cacheFile.c_str());
+        if (std::rename(tempFile.c_str(), cacheFile.c_str()) != 0)
+        {
+            std::remove(tempFile.c_str());
+            return false;
+        }
+
+        mStats.stores++;
+        return true;
+    }
+
+    bool ModelCache::load(Model& model, const std::string& filename, Model::LoadFlags flags)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false) return false;
+
+        std::string cacheFile = getCacheFilename(fullpath, flags);
+        if (doesFileExist(cacheFile) == false)
+        {
+            mStats.misses++;
+            return false;
+        }
+
+        MappedFile file(cacheFile);
+        const FileHeader* pHeader = readHeader(file.pData, file.size, flags);
+        if (pHeader == nullptr)
+        {
+            logWarning("ModelCache: '" + cacheFile + "' is invalid, importing '" + filename + "' again");
+            mStats.misses++;
+            return false;
+        }
+
+        uint64_t sourceHash;
+        if (hashSources(fullpath, sourceHash) == false || sourceHash != pHeader->sourceHash)
+        {
+            mStats.staleMisses++;
+            return false;
+        }
+
+        if (deserialize(model, file.pData, file.size, flags) == false)
+        {
+            logWarning("ModelCache: '" + cacheFile + "' is corrupt, importing '" + filename + "' again");
+            mStats.misses++;
+            return false;
+        }
+
+        mStats.hits++;
+        mStats.bytesLoaded += file.size;
+        mStats.loadTimeMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return true;
+    }
+
+    bool ModelCache::deserialize(Model& model, const uint8_t* pData, size_t size, Model::LoadFlags flags)
+    {
+        FileReader reader(pData, size);
+        const FileHeader* pHeader = readHeader(pData, size, flags);
+        if (pHeader == nullptr) return false;
+
+        const TextureRecord* pTextures = reader.getArray<TextureRecord>(pHeader->texturesOffset, pHeader->textureCount);
+        const MaterialRecord* pMaterials = reader.getArray<MaterialRecord>(pHeader->materialsOffset, pHeader->materialCount);
+        const MeshRecord* pMeshes = reader.getArray<MeshRecord>(pHeader->meshesOffset, pHeader->meshCount);
+        const VertexBufferRecord* pVertexBuffers = reader.getArray<VertexBufferRecord>(pHeader->vertexBuffersOffset, pHeader->vertexBufferCount);
+        const ElementRecord* pElements = reader.getArray<ElementRecord>(pHeader->elementsOffset, pHeader->elementCount);
+        const InstanceRecord* pInstances = reader.getArray<InstanceRecord>(pHeader->instancesOffset, pHeader->instanceCount);
+        const char* pStrings = reader.getArray<char>(pHeader->stringsOffset, pHeader->stringsSize);
+        bool valid = pTextures && pMaterials && pMeshes && pVertexBuffers && pElements && pInstances && pStrings && reader.isValidRange(pHeader->dataOffset, 0);
+
+        // Validate every cross-reference before creating any resource, so a corrupt file can't crash us or leave a half-built model
+        auto isValidString = [&](const StringRef& ref) { return (uint64_t)ref.offset + ref.length <= pHeader->stringsSize; };
+        auto isValidData = [&](uint64_t offset, uint64_t dataSize) { return offset <= size - pHeader->dataOffset && reader.isValidRange(pHeader->dataOffset + offset, dataSize); };
+        for (uint32_t i = 0; valid && i < pHeader->textureCount; i++) valid = isValidString(pTextures[i].path);
+        for (uint32_t i = 0; valid && i < pHeader->materialCount; i++)
+        {
+            valid = isValidString(pMaterials[i].name);
+            for (uint32_t slot = 0; slot < kTextureSlotCount; slot++) valid = valid && pMaterials[i].textures[slot] < (int32_t)pHeader->textureCount;
+        }
+        for (uint32_t i = 0; valid && i < pHeader->elementCount; i++) valid = isValidString(pElements[i].name);
+        for (uint32_t i = 0; valid && i < pHeader->vertexBufferCount; i++)
+        {
+            const VertexBufferRecord& vb = pVertexBuffers[i];
+            valid = (uint64_t)vb.firstElement + vb.elementCount <= pHeader->elementCount && isValidData(vb.dataOffset, vb.dataSize);
+        }
+        for (uint32_t i = 0; valid && i < pHeader->meshCount; i++)
+        {
+            const MeshRecord& mesh = pMeshes[i];
+            valid = mesh.materialIndex < pHeader->materialCount && (uint64_t)mesh.firstVertexBuffer + mesh.vertexBufferCount <= pHeader->vertexBufferCount && isValidData(mesh.indexDataOffset, mesh.indexDataSize);
+            if (valid && mesh.meshletCount)
+            {
+                valid = isValidData(mesh.meshletsOffset, (uint64_t)mesh.meshletCount * sizeof(Meshlet)) && isValidData(mesh.meshletVerticesOffset, (uint64_t)mesh.meshletVertexCount * sizeof(uint32_t)) && isValidData(mesh.meshletTrianglesOffset, mesh.indexCount);
+                for (uint32_t m = 0; valid && m < mesh.meshletCount; m++)
+                {
+                    Meshlet meshlet;
+                    std::memcpy(&meshlet, reader.getData(pHeader->dataOffset + mesh.meshletsOffset + m * sizeof(Meshlet)), sizeof(Meshlet));
+                    valid = (uint64_t)meshlet.vertexOffset + meshlet.vertexCount <= mesh.meshletVertexCount && ((uint64_t)meshlet.triangleOffset + meshlet.triangleCount) * 3 <= mesh.indexCount;
+                }
+            }
+        }
+        for (uint32_t i = 0; valid && i < pHeader->instanceCount; i++) valid = pInstances[i].meshIndex < pHeader->meshCount;
+
+        if (valid == false) return false;
+
+        auto getString = [&](const StringRef& ref) { return std::string(pStrings + ref.offset, ref.length); };
+
+        std::vector<Texture::SharedPtr> textures(pHeader->textureCount);
+        for (uint32_t i = 0; i < pHeader->textureCount; i++)
+        {
+            textures[i] = createTextureFromFile(getString(pTextures[i].path), true, pTextures[i].isSrgb != 0);
+        }
+
+        std::vector<Material::SharedPtr> materials(pHeader->materialCount);
+        for (uint32_t i = 0; i < pHeader->materialCount; i++)
+        {
+            const MaterialRecord& rec = pMaterials[i];
+            Material::SharedPtr pMaterial = Material::create(getString(rec.name));
+            pMaterial->setShadingModel(rec.shadingModel);
+            pMaterial->setAlphaMode(rec.alphaMode);
+            pMaterial->setDoubleSided(rec.doubleSided != 0);
+            pMaterial->setAlphaThreshold(rec.alphaThreshold);
+            pMaterial->setIndexOfRefraction(rec.indexOfRefraction);
+            pMaterial->setHeightScaleOffset(rec.heightScale, rec.heightOffset);
+            pMaterial->setBaseColor(vec4(rec.baseColor[0], rec.baseColor[1], rec.baseColor[2], rec.baseColor[3]));
+            pMaterial->setSpecularParams(vec4(rec.specular[0], rec.specular[1], rec.specular[2], rec.specular[3]));
+            pMaterial->setEmissiveColor(vec3(rec.emissive[0], rec.emissive[1], rec.emissive[2]));
+            for (uint32_t slot = 0; slot < kTextureSlotCount; slot++)
+            {
+                if (rec.textures[slot] >= 0) setMaterialTexture(pMaterial.get(), slot, textures[rec.textures[slot]]);
+            }
+            materials[i] = pMaterial;
+        }
+        // Texture uploads go through the upload heap, don't let them pile up with the geometry
+        gpDevice->flushAndSync();
+
+        Buffer::BindFlags vbBindFlags = Buffer::BindFlags::Vertex;
+        Buffer::BindFlags ibBindFlags = Buffer::BindFlags::Index;
+        if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+        {
+            vbBindFlags |= Buffer::BindFlags::ShaderResource;
+            ibBindFlags |= Buffer::BindFlags::ShaderResource;
+        }
+
+        // Vertex and index data is uploaded straight from the mapped file
+        std::vector<Mesh::SharedPtr> meshes(pHeader->meshCount);
+        uint64_t pendingUploadBytes = 0;
+        for (uint32_t i = 0; i < pHeader->meshCount; i++)
+        {
+            const MeshRecord& rec = pMeshes[i];
+            VertexLayout::SharedPtr pLayout = VertexLayout::create();
+            Vao::BufferVec vbs(rec.vertexBufferCount);
+            for (uint32_t b = 0; b < rec.vertexBufferCount; b++)
+            {
+                const VertexBufferRecord& vbRec = pVertexBuffers[rec.firstVertexBuffer + b];
+                VertexBufferLayout::SharedPtr pVbLayout = VertexBufferLayout::create();
+                for (uint32_t e = 0; e < vbRec.elementCount; e++)
+                {
+                    const ElementRecord& elemRec = pElements[vbRec.firstElement + e];
+                    pVbLayout->addElement(getString(elemRec.name), elemRec.offset, (ResourceFormat)elemRec.format, elemRec.arraySize, elemRec.shaderLocation);
+                }
+                pLayout->addBufferLayout(b, pVbLayout);
+                vbs[b] = Buffer::create(vbRec.dataSize, vbBindFlags, Buffer::CpuAccess::None, reader.getData(pHeader->dataOffset + vbRec.dataOffset));
+                pendingUploadBytes += vbRec.dataSize;
+            }
+            Buffer::SharedPtr pIB = Buffer::create(rec.indexDataSize, ibBindFlags, Buffer::CpuAccess::None, reader.getData(pHeader->dataOffset + rec.indexDataOffset));
+            pendingUploadBytes += rec.indexDataSize;
+
+            BoundingBox bbox;
+            bbox.center = vec3(rec.bboxCenter[0], rec.bboxCenter[1], rec.bboxCenter[2]);
+            bbox.extent = vec3(rec.bboxExtent[0], rec.bboxExtent[1], rec.bboxExtent[2]);
+            meshes[i] = Mesh::create(vbs, rec.vertexCount, pIB, rec.indexCount, pLayout, (Vao::Topology)rec.topology, materials[rec.materialIndex], bbox, false);
+
+            if (rec.meshletCount)
+            {
+                MeshletData meshlets;
+                meshlets.meshlets.resize(rec.meshletCount);
+                meshlets.vertices.resize(rec.meshletVertexCount);
+                meshlets.triangles.resize(rec.indexCount);
+                std::memcpy(meshlets.meshlets.data(), reader.getData(pHeader->dataOffset + rec.meshletsOffset), meshlets.meshlets.size() * sizeof(Meshlet));
+                std::memcpy(meshlets.vertices.data(), reader.getData(pHeader->dataOffset + rec.meshletVerticesOffset), meshlets.vertices.size() * sizeof(uint32_t));
+                std::memcpy(meshlets.triangles.data(), reader.getData(pHeader->dataOffset + rec.meshletTrianglesOffset), meshlets.triangles.size());
+                meshes[i]->setMeshlets(std::move(meshlets));
+            }
+
+            if (pendingUploadBytes > kUploadFlushThreshold)
+            {
+                gpDevice->flushAndSync();
+                pendingUploadBytes = 0;
+            }
+        }
+
+        for (uint32_t i = 0; i < pHeader->instanceCount; i++)
+        {
+            glm::mat4 transform;
+            std::memcpy(&transform, pInstances[i].transform, sizeof(transform));
+            model.addMeshInstance(meshes[pInstances[i].meshIndex], transform);
+        }
+        return true;
+    }
+
+    std::string ModelCache::getStatsString() const
+    {
+        uint32_t lookups = mStats.hits + mStats.misses + mStats.staleMisses;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1);
+        ss << "Model cache: " << mStats.hits << " hits, " << mStats.misses << " misses, " << mStats.staleMisses << " stale";
+        if (lookups) ss << " (" << 100.0 * mStats.hits / lookups << "% hit rate)";
+        ss << "\n  " << mStats.stores << " stored, " << mStats.uncacheable << " not cacheable, " << mStats.bytesLoaded / (1024 * 1024) << " MB loaded";
+        ss << "\n  " << mStats.loadTimeMs << " ms loading from the cache, " << mStats.importTimeMs << " ms importing misses";
+        return ss.str();
+    }
+}
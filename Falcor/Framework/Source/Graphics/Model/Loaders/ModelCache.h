@@ -0,0 +1,131 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "Graphics/Model/Model.h"
+
+namespace Falcor
+{
+    /** A persistent cache of imported models.
+        Importing a model through Assimp (parsing, the full post-processing pipeline and tangent generation) takes most of the time
+        it takes to load a large scene, and the result only changes when the model file changes. After a model has been imported,
+        this class writes the flattened result to a binary file: vertex and index streams, vertex layouts, materials and mesh
+        instances. Later loads of the same file with the same load flags read that file instead of running the importer.
+
+        The cache file is laid out so it can be memory-mapped and uploaded directly. Every section is an array of fixed-size records
+        at a 16-byte aligned offset, and vertex/index data is stored in the exact layout of the GPU buffers. Loading just maps the
+        file, validates the offsets and creates the buffers from the mapped pages.
+
+        Each cache file records a content hash of the model file (and, for OBJ files, of the material libraries it references).
+        If the sources change, the entry is considered stale and the model is imported again.
+
+        Textures are referenced by filename and still loaded from their source files. Models with bones or animations are not cached.
+    */
+    class ModelCache
+    {
+    public:
+        using SharedPtr = std::shared_ptr<ModelCache>;
+        using SharedConstPtr = std::shared_ptr<const ModelCache>;
+
+        struct Desc
+        {
+            std::string directory;      ///< Where cache files are stored. Created if it doesn't exist.
+        };
+
+        struct Stats
+        {
+            uint32_t hits = 0;              ///< Models loaded from the cache
+            uint32_t misses = 0;            ///< Models which were not in the cache
+            uint32_t staleMisses = 0;       ///< Models which were in the cache, but whose source files changed
+            uint32_t stores = 0;            ///< Models written to the cache
+            uint32_t uncacheable = 0;       ///< Models which can't be cached (bones/animations)
+            uint64_t bytesLoaded = 0;       ///< Size of the cache files loaded
+            double loadTimeMs = 0;          ///< Total time spent loading models from the cache
+            double importTimeMs = 0;        ///< Total time spent importing the models that missed (as reported to store())
+        };
+
+        /** Create a cache.
+            \return A new object, or nullptr if the directory doesn't exist and can't be created.
+        */
+        static SharedPtr create(const Desc& desc);
+
+        /** Try to load a model from the cache.
+            \param[out] model The model to populate. It is only modified if the function succeeds.
+            \param[in] filename The model's filename, as passed to Model::createFromFile().
+            \param[in] flags The load flags, as passed to Model::createFromFile().
+            \return true if the model was loaded from the cache, false otherwise.
+        */
+        bool load(Model& model, const std::string& filename, Model::LoadFlags flags);
+
+        /** Write an imported model to the cache.
+            \param[in] model The model, as returned by the importer.
+            \param[in] filename, flags The arguments the model was imported with.
+            \param[in] importTimeMs How long the import took. Only used for statistics.
+            \return true if the model was written.
+        */
+        bool store(const Model& model, const std::string& filename, Model::LoadFlags flags, double importTimeMs = 0);
+
+        /** Serialize a model in the cache file format, in memory. This is what store() writes, and lets other files embed models.
+            \param[in] model The model, as returned by the importer.
+            \param[in] flags The load flags the model was imported with.
+            \param[in] sourceHash Recorded in the header. load() compares it with the hash of the model's source files.
+            \param[out] data The serialized model. Its tables are aligned relative to the start of the data.
+            \return false if the model can't be serialized (bones, animations, or resources that can't be recreated).
+        */
+        static bool serialize(const Model& model, Model::LoadFlags flags, uint64_t sourceHash, std::vector<uint8_t>& data);
+
+        /** Create the meshes, materials and instances of a model from data written by serialize().
+            \param[out] model The model to populate. It is only modified if the function succeeds.
+            \param[in] pData The data. Must be 16-byte aligned.
+            \param[in] size Size of the data.
+            \param[in] flags The load flags. Must match the ones the data was serialized with, except for BuffersAsShaderResource.
+            \return false if the data is invalid or was serialized with other load flags.
+        */
+        static bool deserialize(Model& model, const uint8_t* pData, size_t size, Model::LoadFlags flags);
+
+        const Stats& getStats() const { return mStats; }
+        void resetStats() { mStats = Stats(); }
+
+        /** Get a one-line summary of the stats, for logging
+        */
+        std::string getStatsString() const;
+
+        const Desc& getDesc() const { return mDesc; }
+
+    private:
+        ModelCache(const Desc& desc) : mDesc(desc) {}
+
+        std::string getCacheFilename(const std::string& fullpath, Model::LoadFlags flags) const;
+        bool hashSources(const std::string& fullpath, uint64_t& hash) const;
+
+        Desc mDesc;
+        Stats mStats;
+    };
+}
@@ -35,6 +35,7 @@
 #include "Utils/AABB.h"
 #include "Graphics/Material/Material.h"
 #include "Graphics/Paths/MovableObject.h"
+#include "Graphics/Model/MeshletBuilder.h"
 
 namespace Falcor
 {
@@ -112,6 +113,14 @@ namespace Falcor
         */
         const Vao::SharedPtr& getVao() const { return mpVao; }
 
+        /** Get the mesh's meshlets. Empty unless the model was loaded with Model::LoadFlags::GenerateMeshlets.
+        */
+        const MeshletData& getMeshlets() const { return mMeshlets; }
+
+        /** Set the mesh's meshlets. Their triangle ranges must match the index buffer.
+        */
+        void setMeshlets(MeshletData meshlets) { mMeshlets = std::move(meshlets); }
+
         /** Get global mesh ID
         */
         const uint32_t getId() const { return mId; }
@@ -152,5 +161,6 @@ namespace Falcor
         Material::SharedPtr mpMaterial;
         BoundingBox mBoundingBox;
         Vao::SharedPtr mpVao;
+        MeshletData mMeshlets;
     };
 }
\ No newline at end of file
@@ -0,0 +1,347 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshletBuilder.h"
+#include "Graphics/Camera/Camera.h"
+#include "Graphics/Scene/Scene.h"
+#include "Utils/CpuTimer.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    namespace MeshletBuilder
+    {
+        namespace
+        {
+            static const uint32_t kInvalidIndex = uint32_t(-1);
+            static const float kMinConeDot = 0.1f;      // Cones wider than ~84 degrees almost never cull anything
+
+            const glm::vec3& getPosition(const float* pPositions, size_t stride, uint32_t v)
+            {
+                return *(const glm::vec3*)((const uint8_t*)pPositions + stride * v);
+            }
+
+            struct TriangleInfo
+            {
+                glm::vec3 normal;       // Unit length, or zero for degenerate triangles
+                glm::vec3 centroid;
+                float area;
+            };
+
+            void computeBounds(Meshlet& meshlet, const MeshletData& data, const std::vector<TriangleInfo>& triangles, const float* pPositions, size_t stride)
+            {
+                glm::vec3 boxMin(FLT_MAX);
+                glm::vec3 boxMax(-FLT_MAX);
+                for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+                {
+                    const glm::vec3& p = getPosition(pPositions, stride, data.vertices[meshlet.vertexOffset + i]);
+                    boxMin = glm::min(boxMin, p);
+                    boxMax = glm::max(boxMax, p);
+                }
+                meshlet.bounds = BoundingBox::fromMinMax(boxMin, boxMax);
+
+                meshlet.sphereCenter = meshlet.bounds.center;
+                float radiusSq = 0;
+                for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+                {
+                    glm::vec3 d = getPosition(pPositions, stride, data.vertices[meshlet.vertexOffset + i]) - meshlet.sphereCenter;
+                    radiusSq = std::max(radiusSq, glm::dot(d, d));
+                }
+                meshlet.sphereRadius = sqrtf(radiusSq);
+
+                // The cone axis is the area-weighted average normal, and its width is set by the triangle furthest from it
+                glm::vec3 axis(0);
+                for (uint32_t t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; t++)
+                {
+                    axis += triangles[t].normal * triangles[t].area;
+                }
+                float axisLength = glm::length(axis);
+                meshlet.coneAxis = glm::vec3(0);
+                meshlet.coneCutoff = 1;
+                meshlet.coneApex = meshlet.sphereCenter;
+                if (axisLength == 0) return;
+                axis /= axisLength;
+
+                float minDot = 1;
+                for (uint32_t t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; t++)
+                {
+                    if (triangles[t].area > 0) minDot = std::min(minDot, glm::dot(triangles[t].normal, axis));
+                }
+                if (minDot <= kMinConeDot) return;
+
+                // Move the apex back along the axis until it is behind the plane of every triangle
+                float apexDistance = 0;
+                for (uint32_t t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; t++)
+                {
+                    if (triangles[t].area == 0) continue;
+                    float d = glm::dot(meshlet.sphereCenter - triangles[t].centroid, triangles[t].normal) / glm::dot(axis, triangles[t].normal);
+                    apexDistance = std::max(apexDistance, d);
+                }
+
+                meshlet.coneAxis = axis;
+                meshlet.coneCutoff = sqrtf(1 - minDot * minDot);
+                meshlet.coneApex = meshlet.sphereCenter - axis * apexDistance;
+            }
+        }
+
+        void build(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride, uint32_t vertexCount, const Desc& desc, MeshletData& data)
+        {
+            assert(indexCount % 3 == 0);
+            data = MeshletData();
+            const uint32_t triangleCount = uint32_t(indexCount / 3);
+            if (triangleCount == 0) return;
+
+            const uint32_t maxVertices = std::max(3u, std::min(desc.maxVertices, 256u));
+            const uint32_t maxTriangles = std::max(1u, desc.maxTriangles);
+
+            std::vector<TriangleInfo> triangles(triangleCount);
+            for (uint32_t t = 0; t < triangleCount; t++)
+            {
+                const glm::vec3& p0 = getPosition(pPositions, positionStride, pIndices[t * 3 + 0]);
+                const glm::vec3& p1 = getPosition(pPositions, positionStride, pIndices[t * 3 + 1]);
+                const glm::vec3& p2 = getPosition(pPositions, positionStride, pIndices[t * 3 + 2]);
+                glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                float length = glm::length(n);
+                triangles[t].normal = length > 0 ? n / length : glm::vec3(0);
+                triangles[t].centroid = (p0 + p1 + p2) / 3.0f;
+                triangles[t].area = length * 0.5f;
+            }
+
+            // The triangles using each vertex
+            std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+            std::vector<uint32_t> adjacency(indexCount);
+            for (size_t i = 0; i < indexCount; i++) adjacencyOffsets[pIndices[i] + 1]++;
+            for (uint32_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+            {
+                std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+                for (size_t i = 0; i < indexCount; i++) adjacency[cursor[pIndices[i]]++] = uint32_t(i / 3);
+            }
+
+            std::vector<uint8_t> emitted(triangleCount, 0);
+            std::vector<uint32_t> localIndex(vertexCount, kInvalidIndex);   // Index of each vertex in the current meshlet
+            std::vector<uint32_t> candidates;       // Triangles touching the current meshlet which weren't emitted yet
+            std::vector<uint32_t> candidateOf(triangleCount, kInvalidIndex);  // The meshlet each triangle was last made a candidate of
+            std::vector<uint32_t> result;           // The reordered indices
+            std::vector<TriangleInfo> resultTriangles;
+            result.reserve(indexCount);
+            resultTriangles.reserve(triangleCount);
+            data.triangles.reserve(indexCount);
+
+            Meshlet meshlet;
+            glm::vec3 coneSum(0);
+            uint32_t seedCursor = 0;
+
+            auto finishMeshlet = [&]()
+            {
+                for (uint32_t i = 0; i < meshlet.vertexCount; i++) localIndex[data.vertices[meshlet.vertexOffset + i]] = kInvalidIndex;
+                data.meshlets.push_back(meshlet);
+
+                meshlet = Meshlet();
+                meshlet.vertexOffset = (uint32_t)data.vertices.size();
+                meshlet.triangleOffset = (uint32_t)resultTriangles.size();
+                coneSum = glm::vec3(0);
+                candidates.clear();
+            };
+
+            auto addTriangle = [&](uint32_t t)
+            {
+                emitted[t] = 1;
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    uint32_t v = pIndices[t * 3 + j];
+                    if (localIndex[v] == kInvalidIndex)
+                    {
+                        localIndex[v] = meshlet.vertexCount++;
+                        data.vertices.push_back(v);
+                        for (uint32_t k = adjacencyOffsets[v]; k < adjacencyOffsets[v + 1]; k++)
+                        {
+                            uint32_t t2 = adjacency[k];
+                            if (emitted[t2] == 0 && candidateOf[t2] != data.meshlets.size())
+                            {
+                                candidateOf[t2] = (uint32_t)data.meshlets.size();
+                                candidates.push_back(t2);
+                            }
+                        }
+                    }
+                    data.triangles.push_back((uint8_t)localIndex[v]);
+                    result.push_back(v);
+                }
+                resultTriangles.push_back(triangles[t]);
+                meshlet.triangleCount++;
+                coneSum += triangles[t].normal * triangles[t].area;
+            };
+
+            auto getNewVertexCount = [&](uint32_t t)
+            {
+                return uint32_t(localIndex[pIndices[t * 3 + 0]] == kInvalidIndex) + uint32_t(localIndex[pIndices[t * 3 + 1]] == kInvalidIndex) + uint32_t(localIndex[pIndices[t * 3 + 2]] == kInvalidIndex);
+            };
+
+            if (desc.keepTriangleOrder)
+            {
+                for (uint32_t t = 0; t < triangleCount; t++)
+                {
+                    if (meshlet.triangleCount > 0 && (meshlet.vertexCount + getNewVertexCount(t) > maxVertices || meshlet.triangleCount >= maxTriangles)) finishMeshlet();
+                    addTriangle(t);
+                }
+            }
+
+            else
+            {
+                for (uint32_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+                {
+                    // Pick the candidate which adds the fewest vertices and is closest to the current cone, dropping the ones emitted since they were added
+                    uint32_t best = kInvalidIndex;
+                    if (meshlet.triangleCount > 0 && meshlet.triangleCount < maxTriangles)
+                    {
+                        float coneLength = glm::length(coneSum);
+                        glm::vec3 coneAxis = coneLength > 0 ? coneSum / coneLength : glm::vec3(0);
+                        float bestScore = FLT_MAX;
+                        for (size_t i = 0; i < candidates.size();)
+                        {
+                            uint32_t t = candidates[i];
+                            if (emitted[t])
+                            {
+                                candidates[i] = candidates.back();
+                                candidates.pop_back();
+                                continue;
+                            }
+                            i++;
+
+                            uint32_t newVertices = getNewVertexCount(t);
+                            if (meshlet.vertexCount + newVertices > maxVertices) continue;
+                            float score = float(newVertices) + desc.coneWeight * (1.0f - glm::dot(triangles[t].normal, coneAxis));
+                            if (score < bestScore)
+                            {
+                                bestScore = score;
+                                best = t;
+                            }
+                        }
+                    }
+
+                    // Nothing adjacent fits. Take the next triangle in index order if the meshlet is still mostly empty, otherwise start a new one.
+                    while (emitted[seedCursor]) seedCursor++;
+                    if (best == kInvalidIndex)
+                    {
+                        bool fits = meshlet.vertexCount + getNewVertexCount(seedCursor) <= maxVertices && meshlet.triangleCount < maxTriangles;
+                        bool mostlyEmpty = meshlet.vertexCount < maxVertices / 2 && meshlet.triangleCount < maxTriangles / 2;
+                        if (meshlet.triangleCount > 0 && (fits == false || mostlyEmpty == false)) finishMeshlet();
+                        best = seedCursor;
+                    }
+
+                    addTriangle(best);
+                }
+            }
+            finishMeshlet();
+
+            std::copy(result.begin(), result.end(), pIndices);
+            for (Meshlet& m : data.meshlets)
+            {
+                computeBounds(m, data, resultTriangles, pPositions, positionStride);
+            }
+        }
+
+        bool isBackfacing(const Meshlet& meshlet, const glm::vec3& viewPosition)
+        {
+            glm::vec3 d = meshlet.coneApex - viewPosition;
+            float length = glm::length(d);
+            return length > 0 && glm::dot(d, meshlet.coneAxis) >= meshlet.coneCutoff * length;
+        }
+
+        bool isCulled(const Meshlet& meshlet, const glm::mat4& worldMat, const glm::vec3& viewPosition, const Camera* pCamera, bool backfaceCulling)
+        {
+            if (backfaceCulling && isBackfacing(meshlet, viewPosition)) return true;
+            return pCamera->isObjectCulled(meshlet.bounds.transform(worldMat));
+        }
+
+        CullStats evaluateCulling(const Scene* pScene, const Camera* pCamera)
+        {
+            CullStats stats;
+            double timeMs = 0;
+            for (uint32_t modelId = 0; modelId < pScene->getModelCount(); modelId++)
+            {
+                for (uint32_t instanceId = 0; instanceId < pScene->getModelInstanceCount(modelId); instanceId++)
+                {
+                    const Scene::ModelInstance* pModelInstance = pScene->getModelInstance(modelId, instanceId).get();
+                    if (pModelInstance->isVisible() == false) continue;
+                    const Model* pModel = pModelInstance->getObject().get();
+
+                    for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); meshId++)
+                    {
+                        const Mesh* pMesh = pModel->getMesh(meshId).get();
+                        const MeshletData& meshlets = pMesh->getMeshlets();
+                        const bool backfaceCulling = pMesh->getMaterial() == nullptr || pMesh->getMaterial()->getDoubleSided() == false;
+
+                        for (uint32_t i = 0; i < pModel->getMeshInstanceCount(meshId); i++)
+                        {
+                            const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshId, i).get();
+                            if (pMeshInstance->isVisible() == false) continue;
+
+                            stats.triangles += pMesh->getPrimitiveCount();
+                            BoundingBox box = pMeshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
+                            if (pCamera->isObjectCulled(box)) continue;
+                            stats.trianglesAfterObjectCulling += pMesh->getPrimitiveCount();
+
+                            if (meshlets.meshlets.empty())
+                            {
+                                stats.trianglesAfterMeshletCulling += pMesh->getPrimitiveCount();
+                                continue;
+                            }
+
+                            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+                            glm::mat4 worldMat = pModelInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix();
+                            glm::vec3 viewPosition = glm::vec3(glm::inverse(worldMat) * glm::vec4(pCamera->getPosition(), 1.0f));
+                            for (const Meshlet& meshlet : meshlets.meshlets)
+                            {
+                                stats.meshletsTested++;
+                                if (backfaceCulling && isBackfacing(meshlet, viewPosition)) stats.meshletsBackfaceCulled++;
+                                else if (pCamera->isObjectCulled(meshlet.bounds.transform(worldMat))) stats.meshletsFrustumCulled++;
+                                else stats.trianglesAfterMeshletCulling += meshlet.triangleCount;
+                            }
+                            timeMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+                        }
+                    }
+                }
+            }
+            stats.timeMs = timeMs;
+            return stats;
+        }
+
+        std::string getCullStatsString(const CullStats& stats)
+        {
+            auto percent = [](uint64_t a, uint64_t b) { return b ? 100.0 * double(a) / double(b) : 0.0; };
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(1);
+            ss << "Meshlet culling: " << stats.trianglesAfterMeshletCulling << " of " << stats.triangles << " triangles left (" << percent(stats.trianglesAfterMeshletCulling, stats.triangles) << "%), ";
+            ss << "instance culling alone leaves " << stats.trianglesAfterObjectCulling << " (" << percent(stats.trianglesAfterObjectCulling, stats.triangles) << "%). ";
+            ss << stats.meshletsTested << " meshlets tested, " << stats.meshletsFrustumCulled << " outside the frustum, " << stats.meshletsBackfaceCulled << " back-facing, in " << std::setprecision(3) << stats.timeMs << " ms";
+            return ss.str();
+        }
+    }
+}
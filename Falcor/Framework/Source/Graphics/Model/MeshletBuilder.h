@@ -0,0 +1,127 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    class Camera;
+    class Scene;
+
+    /** A cluster of up to a few dozen triangles of a mesh, with bounds for culling it on its own.
+        The triangles of a meshlet are contiguous in the mesh's index buffer, so each meshlet can also be drawn, or built into an
+        acceleration structure, as an index range.
+    */
+    struct Meshlet
+    {
+        uint32_t vertexOffset = 0;                  ///< First entry in MeshletData::vertices
+        uint32_t vertexCount = 0;
+        uint32_t triangleOffset = 0;                ///< First triangle, both in the mesh's index buffer and in MeshletData::triangles
+        uint32_t triangleCount = 0;
+        glm::vec3 sphereCenter = glm::vec3(0);      ///< Bounding sphere, in object space
+        float sphereRadius = 0;
+        glm::vec3 coneApex = glm::vec3(0);          ///< Normal cone. The triangles all face away from any point P for which
+        float coneCutoff = 1;                       ///< dot(normalize(coneApex - P), coneAxis) >= coneCutoff.
+        glm::vec3 coneAxis = glm::vec3(0);          ///< Zero when the triangles face too many directions for the test to ever pass.
+        uint32_t reserved = 0;
+        BoundingBox bounds;                         ///< Axis-aligned bounds, in object space
+    };
+
+    /** The meshlets of a mesh
+    */
+    struct MeshletData
+    {
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> vertices;     ///< Mesh vertex indices referenced by each meshlet
+        std::vector<uint8_t> triangles;     ///< 3 indices into the meshlet's vertices per triangle
+    };
+
+    /** Splits meshes into meshlets.
+        Meshlets are grown from a seed triangle by adding the adjacent triangle which adds the fewest new vertices and bends the
+        normal cone the least, until the vertex or triangle limit is reached. Seeds are taken in index buffer order, so running
+        MeshOptimizer::optimizeVertexCache() first keeps meshlets compact.
+        Growing meshlets reorders the triangles, which undoes the ordering of MeshOptimizer. Desc::keepTriangleOrder cuts the meshlets
+        from runs of consecutive triangles instead, which keeps that ordering at the cost of somewhat wider normal cones.
+    */
+    namespace MeshletBuilder
+    {
+        struct Desc
+        {
+            uint32_t maxVertices = 64;      ///< At most 256, since the meshlet triangles use 8-bit indices
+            uint32_t maxTriangles = 124;
+            float coneWeight = 0.5f;        ///< How much to favor triangles facing the same way over sharing vertices. Tighter cones cull better.
+            bool keepTriangleOrder = false; ///< Cut meshlets from consecutive triangles instead of growing them, so an index buffer already ordered by MeshOptimizer stays as it is
+        };
+
+        /** Build the meshlets of an indexed triangle list.
+            \param[in,out] pIndices The indices. Triangles are reordered so the ones of each meshlet are contiguous; the winding of each triangle is kept.
+            \param[in] pPositions The vertex positions, 3 floats each
+            \param[in] positionStride The distance between positions, in bytes
+            \param[out] data Receives the meshlets
+        */
+        void build(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride, uint32_t vertexCount, const Desc& desc, MeshletData& data);
+
+        /** Check whether all the triangles of a meshlet face away from a point
+            \param[in] viewPosition The point, in the mesh's object space
+        */
+        bool isBackfacing(const Meshlet& meshlet, const glm::vec3& viewPosition);
+
+        /** Check whether a meshlet can be skipped: it's outside the camera's frustum, or all its triangles face away from the camera.
+            \param[in] worldMat The world matrix of the mesh instance
+            \param[in] viewPosition The camera position in the mesh's object space, i.e. transformed by the inverse of worldMat
+            \param[in] backfaceCulling Whether to use the normal cone. Disable it for double-sided materials.
+        */
+        bool isCulled(const Meshlet& meshlet, const glm::mat4& worldMat, const glm::vec3& viewPosition, const Camera* pCamera, bool backfaceCulling);
+
+        struct CullStats
+        {
+            uint64_t triangles = 0;                 ///< Triangles of all the visible mesh instances
+            uint64_t trianglesAfterObjectCulling = 0;   ///< Left after culling mesh instances against the frustum, like SceneRenderer does
+            uint64_t trianglesAfterMeshletCulling = 0;  ///< Left after also culling the meshlets of the remaining instances
+            uint64_t meshletsTested = 0;
+            uint64_t meshletsFrustumCulled = 0;
+            uint64_t meshletsBackfaceCulled = 0;
+            double timeMs = 0;                      ///< Time spent culling the meshlets
+        };
+
+        /** Measure how much meshlet culling removes on top of per-instance culling, for a scene and a camera.
+            Meshes without meshlets count as fully visible when their instance isn't culled.
+        */
+        CullStats evaluateCulling(const Scene* pScene, const Camera* pCamera);
+
+        /** Get a one-line summary of the culling stats, for logging
+        */
+        std::string getCullStatsString(const CullStats& stats);
+    }
+}
@@ -30,6 +30,7 @@
 #include "Loaders/AssimpModelImporter.h"
 #include "Loaders/BinaryModelImporter.h"
 #include "Loaders/BinaryModelExporter.h"
+#include "Loaders/ModelCache.h"
 #include "Utils/Platform/OS.h"
 #include "Mesh.h"
 #include "AnimationController.h"
@@ -46,6 +47,7 @@ namespace Falcor
 {
 
     uint32_t Model::sModelCounter = 0;
+    std::shared_ptr<ModelCache> Model::spModelCache;
     const char* Model::kSupportedFileFormatsStr = "Supported Formats\0*.obj;*.bin;*.dae;*.x;*.md5mesh;*.ply;*.fbx;*.3ds;*.blend;*.ase;*.ifc;*.xgl;*.zgl;*.dxf;*.lwo;*.lws;*.lxo;*.stl;*.x;*.ac;*.ms3d;*.cob;*.scn;*.3d;*.mdl;*.mdl2;*.pk3;*.smd;*.vta;*.raw;*.ter\0\0";
 
     // Method to sort meshes
@@ -94,20 +96,23 @@ namespace Falcor
         {
             res = BinaryModelImporter::import(*pModel, filename, flags);
         }
+        else if(spModelCache && spModelCache->load(*pModel, filename, flags))
+        {
+            res = true;
+        }
         else
         {
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
             res = AssimpModelImporter::import(*pModel, filename, flags);
+            if(res && spModelCache)
+            {
+                spModelCache->store(*pModel, filename, flags, CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()));
+            }
         }
 
         if(res)
         {
-            pModel->calculateModelProperties();
-            pModel->setFilename(filename);
-
-            std::string name = getFilenameFromPath(filename);
-            size_t extPos = name.find_last_of('.');
-            name = (extPos == std::string::npos) ? name : name.substr(0, extPos);
-            pModel->setName(name);
+            pModel->finalizeLoad(filename);
         }
         else
         {
@@ -117,6 +122,28 @@ namespace Falcor
         return pModel;
     }
 
+    Model::SharedPtr Model::createFromCacheData(const uint8_t* pData, size_t size, const std::string& filename, LoadFlags flags)
+    {
+        SharedPtr pModel = SharedPtr(new Model());
+        if(ModelCache::deserialize(*pModel, pData, size, flags) == false)
+        {
+            return nullptr;
+        }
+        pModel->finalizeLoad(filename);
+        return pModel;
+    }
+
+    void Model::finalizeLoad(const std::string& filename)
+    {
+        calculateModelProperties();
+        setFilename(filename);
+
+        std::string name = getFilenameFromPath(filename);
+        size_t extPos = name.find_last_of('.');
+        name = (extPos == std::string::npos) ? name : name.substr(0, extPos);
+        setName(name);
+    }
+
     Model::SharedPtr Model::create()
     {
         return SharedPtr(new Model());
@@ -363,6 +390,7 @@ namespace Falcor
         }
 
         mMeshes[meshID].push_back(MeshInstance::create(pMesh, baseTransform));
+        mMeshInstanceVersion++;
     }
 
     void Model::sortMeshes()
@@ -374,6 +402,7 @@ namespace Falcor
         };
         
         std::sort(mMeshes.begin(), mMeshes.end(), matSortPred);
+        mMeshInstanceVersion++;
     }
 
     template<typename T>
@@ -429,6 +458,7 @@ namespace Falcor
         auto pred = [](MeshInstanceList& meshInstances) { return meshInstances.size() == 0; };
         auto meshesEnd = std::remove_if(mMeshes.begin(), mMeshes.end(), pred);
         mMeshes.erase(meshesEnd, mMeshes.end());
+        mMeshInstanceVersion++;
 
         calculateModelProperties();
     }
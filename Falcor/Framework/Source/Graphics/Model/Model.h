@@ -44,6 +44,7 @@ namespace Falcor
     class BinaryModelExporter;
     class Buffer;
     class Camera;
+    class ModelCache;
 
     /** Class representing a complete model object, including meshes, animations and materials
     */
@@ -67,12 +68,22 @@ namespace Falcor
             BuffersAsShaderResource     = 0x10,   ///< Generate the VBs and IB with the shader-resource-view bind flag
             RemoveInstancing            = 0x20,   ///< Flatten mesh instances
             UseSpecGlossMaterials       = 0x40,   ///< Set materials to use Spec-Gloss shading model. Otherwise default is Metal-Rough.
+            DontOptimizeMeshes          = 0x80,   ///< Keep Assimp's triangle and vertex order. By default, meshes are reordered for the vertex cache, overdraw and vertex fetch.
+            GenerateMeshlets            = 0x100,  ///< Split meshes into meshlets (see MeshletBuilder). Reorders the triangles of each mesh so the ones of each meshlet are contiguous.
         };
 
         /** Create a new model from file
         */
         static SharedPtr createFromFile(const char* filename, LoadFlags flags = LoadFlags::None);
 
+        /** Create a model from data written by ModelCache::serialize(), e.g. a model embedded in a scene package
+            \param[in] pData, size The serialized model. pData must be 16-byte aligned.
+            \param[in] filename The filename the model was imported from. Sets the model's filename and name.
+            \param[in] flags The flags the model was serialized with.
+            \return A new object, or nullptr if the data is invalid
+        */
+        static SharedPtr createFromCacheData(const uint8_t* pData, size_t size, const std::string& filename, LoadFlags flags = LoadFlags::None);
+
         static SharedPtr create();
 
         static const char* kSupportedFileFormatsStr;
@@ -146,6 +157,10 @@ namespace Falcor
         */
         uint32_t getMeshInstanceCount(uint32_t meshID) const { return meshID >= mMeshes.size() ? 0 : (uint32_t)(mMeshes[meshID].size()); }
 
+        /** Gets a counter which is incremented whenever mesh instances are added, removed or reordered.
+        */
+        uint32_t getMeshInstanceVersion() const { return mMeshInstanceVersion; }
+
         /** Adds a new mesh instance.
             \param[in] pMesh Mesh geometry
             \param[in] baseTransform Base transform for the instance
@@ -252,6 +267,15 @@ namespace Falcor
         */
         static void resetGlobalIdCounter();
 
+        /** Set a cache for imported models, or nullptr to disable caching. When set, createFromFile() loads models from the cache
+            when their source files haven't changed, and adds newly imported models to it.
+        */
+        static void setModelCache(const std::shared_ptr<ModelCache>& pCache) { spModelCache = pCache; }
+
+        /** Get the model cache, or nullptr if none is set.
+        */
+        static const std::shared_ptr<ModelCache>& getModelCache() { return spModelCache; }
+
 
     protected:
         friend class SimpleModelImporter;
@@ -276,6 +300,7 @@ namespace Falcor
         uint32_t mId;
 
         std::vector<MeshInstanceList> mMeshes; // [Mesh][Instance]
+        uint32_t mMeshInstanceVersion = 0;
 
         AnimationController::UniquePtr mpAnimationController;
         SkinningCache::SharedPtr mpSkinningCache;
@@ -284,8 +309,13 @@ namespace Falcor
         std::string mFilename;
 
         static uint32_t sModelCounter;
+        static std::shared_ptr<ModelCache> spModelCache;
 
         void calculateModelProperties();
+
+        /** Compute the model properties and set the filename and name, after an importer populated the model
+        */
+        void finalizeLoad(const std::string& filename);
     };
 
     enum_class_operators(Model::LoadFlags);
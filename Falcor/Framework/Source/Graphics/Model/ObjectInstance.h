@@ -38,6 +38,29 @@ namespace Falcor
     class SceneRenderer;
     class Model;
 
+    /** Collects the instances whose transform changed. Instances push an index into each list they were added to whenever their transform changes,
+        so the owner of the list only needs to look at the instances that moved instead of comparing the matrices of all of them.
+    */
+    class TransformChangeList
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TransformChangeList>;
+
+        static SharedPtr create() { return SharedPtr(new TransformChangeList()); }
+
+        void push(uint32_t index) { mIndices.push_back(index); }
+
+        /** Get the indices pushed since the last clear(). An instance pushes its index on each change, so an index can appear more than once.
+        */
+        const std::vector<uint32_t>& getIndices() const { return mIndices; }
+
+        void clear() { mIndices.clear(); }
+
+    private:
+        TransformChangeList() = default;
+        std::vector<uint32_t> mIndices;
+    };
+
     /** Handles transformations for Mesh and Model instances. Primary transform is stored in the "Base" transform. An additional "Movable"
         transform is applied after the Base transform can be set through the IMovableObject interface. This is currently used by paths.
     */
@@ -126,6 +149,7 @@ namespace Falcor
 
             mBase.translation = translation;
             mBase.matrixDirty = true;
+            notifyTransformChanged();
         };
 
         /** Gets the position/translation of the instance
@@ -136,7 +160,7 @@ namespace Falcor
         /** Sets scale of the instance
             \param[in] scaling Instance scale
         */
-        void setScaling(const glm::vec3& scaling) { mBase.scale = scaling; mBase.matrixDirty = true; }
+        void setScaling(const glm::vec3& scaling) { mBase.scale = scaling; mBase.matrixDirty = true; notifyTransformChanged(); }
 
         /** Gets scale of the instance
             \return Scale of the instance
@@ -156,6 +180,7 @@ namespace Falcor
             mBase.target = mBase.translation + rotMtx[2]; // position + forward
 
             mBase.matrixDirty = true;
+            notifyTransformChanged();
         }
 
         /** Gets rotation for the instance
@@ -173,11 +198,11 @@ namespace Falcor
 
         /** Sets the up vector orientation
         */
-        void setUpVector(const glm::vec3& up) { mBase.up = glm::normalize(up); mBase.matrixDirty = true; }
+        void setUpVector(const glm::vec3& up) { mBase.up = glm::normalize(up); mBase.matrixDirty = true; notifyTransformChanged(); }
 
         /** Sets the look-at target
         */
-        void setTarget(const glm::vec3& target) { mBase.target = target; mBase.matrixDirty = true; }
+        void setTarget(const glm::vec3& target) { mBase.target = target; mBase.matrixDirty = true; notifyTransformChanged(); }
 
         /** Gets the up vector of the instance
             \return Up vector
@@ -222,6 +247,16 @@ namespace Falcor
             mMovable.up = up;
             mMovable.scale = glm::vec3(1.0f);
             mMovable.matrixDirty = true;
+            notifyTransformChanged();
+        }
+
+        /** Push an index into a list whenever the transform changes, by the setters or move(). An instance can be added to several lists, and to the same
+            list with several indices. It only keeps weak references to the lists, and forgets the ones which were destroyed.
+        */
+        void addTransformChangeList(const TransformChangeList::SharedPtr& pList, uint32_t index)
+        {
+            mTransformListeners.erase(std::remove_if(mTransformListeners.begin(), mTransformListeners.end(), [](const TransformListener& l) { return l.pList.expired(); }), mTransformListeners.end());
+            mTransformListeners.push_back({ pList, index });
         }
 
         SharedPtr shared_from_this()
@@ -235,6 +270,14 @@ namespace Falcor
         }
     private:
 
+        void notifyTransformChanged()
+        {
+            for (const TransformListener& listener : mTransformListeners)
+            {
+                if (TransformChangeList::SharedPtr pList = listener.pList.lock()) pList->push(listener.index);
+            }
+        }
+
         void updateInstanceProperties() const
         {
             if (mBase.matrixDirty || mMovable.matrixDirty)
@@ -329,6 +372,13 @@ namespace Falcor
         mutable Transform mMovable;
         mutable Transform mPrevMovable;
 
+        struct TransformListener
+        {
+            std::weak_ptr<TransformChangeList> pList;
+            uint32_t index;
+        };
+        std::vector<TransformListener> mTransformListeners;
+
         mutable glm::mat4 mFinalTransformMatrix;
         mutable glm::mat4 mPrevFinalTransformMatrix;
         mutable BoundingBox mBoundingBox;
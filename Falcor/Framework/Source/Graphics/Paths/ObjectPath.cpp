@@ -33,6 +33,15 @@
 
 namespace Falcor
 {
+    namespace
+    {
+        // Samples per key frame interval used by bake() to measure the length of the path
+        const uint32_t kLengthSamplesPerInterval = 256;
+
+        // Baked samples per key frame interval when bake() is not given a sample count
+        const uint32_t kBakedSamplesPerInterval = 128;
+    }
+
     ObjectPath::SharedPtr ObjectPath::create()
     {
         return SharedPtr(new ObjectPath);
@@ -47,7 +56,7 @@ namespace Falcor
         keyFrame.target = target;
         keyFrame.position = position;
         keyFrame.up = up;
-        mDirty = true;
+        invalidate();
 
         if(mKeyFrames.size() == 0 || mKeyFrames[0].time > time)
         {
@@ -106,7 +115,13 @@ namespace Falcor
                 animTime = lastFrame.time;
         }
 
-        if(animTime >= lastFrame.time)
+        if(mPlayback == Playback::ConstantSpeed && mKeyFrames.size() > 1)
+        {
+            float duration = getDuration();
+            float u = (duration > 0) ? float((animTime - firstFrame.time) / duration) : 1.0f;
+            getBakedFrame(u, mCurrentFrame);
+        }
+        else if(animTime >= lastFrame.time)
         {
             mCurrentFrame = lastFrame;
         }
@@ -143,6 +158,141 @@ namespace Falcor
         return true;
     }
 
+    bool ObjectPath::animateFrame(uint32_t frame, uint32_t frameCount)
+    {
+        if(mKeyFrames.size() == 0 || frameCount == 0)
+        {
+            return false;
+        }
+
+        float u = 0;
+        if(mRepeatAnimation)
+        {
+            u = float(frame % frameCount) / float(frameCount);
+        }
+        else if(frameCount > 1)
+        {
+            u = float(std::min(frame, frameCount - 1)) / float(frameCount - 1);
+        }
+        getBakedFrame(u, mCurrentFrame);
+
+        for(auto& pObj : mpObjects)
+        {
+            pObj->move(mCurrentFrame.position, mCurrentFrame.target, mCurrentFrame.up);
+        }
+
+        return true;
+    }
+
+    void ObjectPath::bake(uint32_t sampleCount)
+    {
+        mBakedSampleCount = sampleCount;
+        mBakeDirty = false;
+        mBakedSamples.clear();
+        mLength = 0;
+
+        if (mKeyFrames.size() < 2)
+        {
+            if (mKeyFrames.size() == 1)
+            {
+                mBakedSamples.push_back({ mKeyFrames[0].position, mKeyFrames[0].target, mKeyFrames[0].up });
+            }
+            return;
+        }
+
+        // Sample the path densely, and measure the distance to each sample along the polyline through them
+        const uint32_t intervalCount = getKeyFrameCount() - 1;
+        std::vector<Frame> frames(intervalCount * kLengthSamplesPerInterval + 1);
+        for (uint32_t interval = 0; interval < intervalCount; interval++)
+        {
+            for (uint32_t i = 0; i < kLengthSamplesPerInterval; i++)
+            {
+                getFrameAt(interval, float(i) / float(kLengthSamplesPerInterval), frames[interval * kLengthSamplesPerInterval + i]);
+            }
+        }
+        getFrameAt(intervalCount - 1, 1.0f, frames.back());
+
+        std::vector<float> distances(frames.size());
+        distances[0] = 0;
+        for (size_t i = 1; i < frames.size(); i++)
+        {
+            distances[i] = distances[i - 1] + glm::length(frames[i].position - frames[i - 1].position);
+        }
+        mLength = distances.back();
+
+        // A path which doesn't move can still turn, so spread its samples over time instead
+        if (mLength <= 0)
+        {
+            for (size_t i = 0; i < frames.size(); i++)
+            {
+                distances[i] = (getDuration() > 0) ? frames[i].time - frames[0].time : float(i);
+            }
+        }
+
+        // Resample at equal distances
+        const uint32_t bakedCount = sampleCount ? std::max(2u, sampleCount) : intervalCount * kBakedSamplesPerInterval + 1;
+        const float totalDistance = distances.back();
+        mBakedSamples.resize(bakedCount);
+        size_t segment = 0;
+        for (uint32_t i = 0; i < bakedCount; i++)
+        {
+            float distance = totalDistance * float(i) / float(bakedCount - 1);
+            while ((segment + 2 < frames.size()) && (distances[segment + 1] < distance))
+            {
+                segment++;
+            }
+
+            float span = distances[segment + 1] - distances[segment];
+            float t = (span > 0) ? glm::clamp((distance - distances[segment]) / span, 0.0f, 1.0f) : 0.0f;
+            const Frame& a = frames[segment];
+            const Frame& b = frames[segment + 1];
+            mBakedSamples[i] = { glm::mix(a.position, b.position, t), glm::mix(a.target, b.target, t), glm::mix(a.up, b.up, t) };
+        }
+    }
+
+    const std::vector<ObjectPath::BakedSample>& ObjectPath::getBakedSamples()
+    {
+        if (mBakeDirty)
+        {
+            bake(mBakedSampleCount);
+        }
+        return mBakedSamples;
+    }
+
+    float ObjectPath::getLength()
+    {
+        if (mBakeDirty)
+        {
+            bake(mBakedSampleCount);
+        }
+        return mLength;
+    }
+
+    void ObjectPath::getBakedFrame(float u, Frame& frameOut)
+    {
+        const auto& samples = getBakedSamples();
+        u = glm::clamp(u, 0.0f, 1.0f);
+        frameOut.time = mKeyFrames.empty() ? 0 : mKeyFrames[0].time + u * getDuration();
+
+        if (samples.size() < 2)
+        {
+            if (samples.size() == 1)
+            {
+                frameOut.position = samples[0].position;
+                frameOut.target = samples[0].target;
+                frameOut.up = samples[0].up;
+            }
+            return;
+        }
+
+        float x = u * float(samples.size() - 1);
+        uint32_t i = std::min((uint32_t)x, (uint32_t)samples.size() - 2);
+        float t = x - float(i);
+        frameOut.position = glm::mix(samples[i].position, samples[i + 1].position, t);
+        frameOut.target = glm::mix(samples[i].target, samples[i + 1].target, t);
+        frameOut.up = glm::mix(samples[i].up, samples[i + 1].up, t);
+    }
+
     void ObjectPath::getFrameAt(uint32_t frameID, float t, Frame& frameOut)
     {
         if (getKeyFrameCount() == 1)
@@ -253,7 +403,7 @@ namespace Falcor
     void ObjectPath::removeKeyFrame(uint32_t frameID)
     {
         mKeyFrames.erase(mKeyFrames.begin() + frameID);
-        mDirty = true;
+        invalidate();
     }
 
     uint32_t ObjectPath::setFrameTime(uint32_t frameID, float time)
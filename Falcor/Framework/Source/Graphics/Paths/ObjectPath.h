@@ -60,7 +60,23 @@ namespace Falcor
 
         /**  Set the interpolation mode.
         */
-        void setInterpolationMode(Interpolation mode) { mMode = mode; }
+        void setInterpolationMode(Interpolation mode) { mMode = mode; invalidate(); }
+
+        /** Ways animate() maps the time to a point on the path
+        */
+        enum class Playback
+        {
+            KeyFrameTime,   ///< Reach each key frame at its time. The speed varies with the spacing of the key frames.
+            ConstantSpeed   ///< Travel the path at a constant speed, over the same total time as the key frames. Uses the baked table, see bake().
+        };
+
+        /** Set the playback mode. Defaults to Playback::KeyFrameTime.
+        */
+        void setPlaybackMode(Playback mode) { mPlayback = mode; }
+
+        /** Get the playback mode.
+        */
+        Playback getPlaybackMode() const { return mPlayback; }
 
         /** Insert a key frame. Key frame will be inserted/sorted into the path based on time.
             \param[in] time Time in seconds
@@ -80,6 +96,15 @@ namespace Falcor
         */
         bool animate(double currentTime);
 
+        /** Move the attached objects to one of frameCount frames spread at equal distances along the path, using the baked table.
+            Doesn't depend on the time, so benchmarks can play exactly frameCount frames along a path and see the same views on every run.
+            The first frame is the start of the path. The last frame is the end of the path, or one step before the start for paths which repeat, so looping over the frames doesn't show the start twice.
+            \param[in] frame The frame index, clamped to frameCount - 1, or wrapped for paths which repeat
+            \param[in] frameCount The number of frames along the path
+            \return Whether update was successful. Fails if the path has no key frames.
+        */
+        bool animateFrame(uint32_t frame, uint32_t frameCount);
+
         /** Attach a movable object to the path, such as models, cameras, and lights.
         */
         void attachObject(const IMovableObject::SharedPtr& pObject);
@@ -150,19 +175,19 @@ namespace Falcor
             \param[in] frameID Key frame index
             \param[in] pos Position
         */
-        void setFramePosition(uint32_t frameID, const glm::vec3& pos) { mDirty = true; mKeyFrames[frameID].position = pos; }
+        void setFramePosition(uint32_t frameID, const glm::vec3& pos) { invalidate(); mKeyFrames[frameID].position = pos; }
 
         /** Set a key frame's look-at target.
             \param[in] frameID Key frame index
             \param[in] target Target position
         */
-        void setFrameTarget(uint32_t frameID, const glm::vec3& target) { mDirty = true; mKeyFrames[frameID].target = target; }
+        void setFrameTarget(uint32_t frameID, const glm::vec3& target) { invalidate(); mKeyFrames[frameID].target = target; }
 
         /** Set a key frame's up vector.
             \param[in] frameID Key frame index
             \param[in] up Up vector
         */
-        void setFrameUp(uint32_t frameID, const glm::vec3& up) { mDirty = true; mKeyFrames[frameID].up = up; }
+        void setFrameUp(uint32_t frameID, const glm::vec3& up) { invalidate(); mKeyFrames[frameID].up = up; }
 
         /** Set a key frame's time. This will re-sort the key frame in the path.
             \param[in] frameID Key frame index
@@ -177,9 +202,48 @@ namespace Falcor
         */
         void getFrameAt(uint32_t frameID, float t, Frame& frameOut);
 
+        /** A point of the baked path
+        */
+        struct BakedSample
+        {
+            glm::vec3 position;
+            glm::vec3 target;
+            glm::vec3 up;
+        };
+
+        /** Bake the path into a table of samples at equal distances along it, for constant-speed playback.
+            The path is sampled densely with the current interpolation mode to measure its length, then resampled at equal arc-length intervals.
+            Paths which don't move, only turn, are sampled at equal time intervals instead.
+            The table is rebuilt with the same sample count when the key frames change, the next time it's used.
+            \param[in] sampleCount The number of samples. 0 uses a fixed number of samples per key frame interval.
+        */
+        void bake(uint32_t sampleCount = 0);
+
+        /** Get the baked samples, which are equally spaced along the path. Bakes the path first if needed.
+        */
+        const std::vector<BakedSample>& getBakedSamples();
+
+        /** Get the length of the path, as measured by bake(). Bakes the path first if needed.
+        */
+        float getLength();
+
+        /** Get the time from the first to the last key frame, in seconds
+        */
+        float getDuration() const { return mKeyFrames.empty() ? 0 : mKeyFrames.back().time - mKeyFrames.front().time; }
+
+        /** Get interpolated frame data at a distance along the path, from the baked table. Bakes the path first if needed. Takes constant time.
+            \param[in] u The distance from the start of the path, as a fraction of its length. Clamped to [0, 1].
+            \param[out] frameOut Frame data struct to store output. Its time is at the same fraction of the path's duration.
+        */
+        void getBakedFrame(float u, Frame& frameOut);
+
     private:
         ObjectPath() = default;
 
+        /** Mark the splines and the baked table as out of date
+        */
+        void invalidate() { mDirty = true; mBakeDirty = true; }
+
         float getInterpolationFactor(uint32_t frameID, double currentTime) const;
 
         Frame linearInterpolation(uint32_t currentFrame, float t) const;
@@ -192,8 +256,14 @@ namespace Falcor
 
         Frame mCurrentFrame;
         Interpolation mMode = Interpolation::CubicSpline;
+        Playback mPlayback = Playback::KeyFrameTime;
         bool mDirty = false;
 
+        std::vector<BakedSample> mBakedSamples;
+        uint32_t mBakedSampleCount = 0;     ///< The sample count bake() was last called with
+        float mLength = 0;
+        bool mBakeDirty = true;
+
         std::unique_ptr<Vec3CubicSpline> mpPositionSpline;
         std::unique_ptr<Vec3CubicSpline> mpTargetSpline;
         std::unique_ptr<Vec3CubicSpline> mpUpSpline;
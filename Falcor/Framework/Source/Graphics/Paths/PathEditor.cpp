@@ -112,6 +112,15 @@ namespace Falcor
         }
     }
 
+    void PathEditor::editPathPlayback(Gui* pGui)
+    {
+        bool constantSpeed = mpPath->getPlaybackMode() == ObjectPath::Playback::ConstantSpeed;
+        if (pGui->addCheckBox("Constant Speed", constantSpeed))
+        {
+            mpPath->setPlaybackMode(constantSpeed ? ObjectPath::Playback::ConstantSpeed : ObjectPath::Playback::KeyFrameTime);
+        }
+    }
+
     void PathEditor::editPathName(Gui* pGui)
     {
         char buffer[1024];
@@ -152,6 +161,7 @@ namespace Falcor
         pGui->addSeparator();
         editPathName(pGui);
         editPathLoop(pGui);
+        editPathPlayback(pGui);
         editActiveFrameID(pGui);
 
         addFrame(pGui);
@@ -74,6 +74,7 @@ namespace Falcor
         bool closeEditor(Gui* pGui);
         void editPathName(Gui* pGui);
         void editPathLoop(Gui* pGui);
+        void editPathPlayback(Gui* pGui);
         void editActiveFrameID(Gui* pGui);
         void addFrame(Gui* pGui);
         void deleteFrame(Gui* pGui);
@@ -38,6 +38,11 @@
 #include "API/RenderContext.h"
 #include "Utils/StringUtils.h"
 #include "ShaderLibrary.h"
+#include "ProgramCache.h"
+#include "Utils/CpuTimer.h"
+#include <atomic>
+#include <mutex>
+#include <sstream>
 
 namespace Falcor
 {
@@ -47,6 +52,45 @@ namespace Falcor
     const std::string kSupportedShaderModels[] = { "4_0", "4_1", "5_0", "5_1", "6_0", "6_1", "6_2", "6_3" };
 #endif
 
+    // An ISlangBlob holding code loaded from the program cache, so that it can be used in place of the code Slang generates
+    class CachedCodeBlob : public ISlangBlob
+    {
+    public:
+        CachedCodeBlob(std::vector<uint8_t>&& code) : mCode(std::move(code)) {}
+        virtual ~CachedCodeBlob() = default;
+
+        // Nobody queries the blobs we hand out, so this doesn't expose any interfaces
+        SLANG_NO_THROW SlangResult SLANG_MCALL QueryInterface(SlangUUID const& uuid, void** outObject) override { *outObject = nullptr; return SlangResult(0x80004002); /* E_NOINTERFACE */ }
+        SLANG_NO_THROW uint32_t SLANG_MCALL AddRef() override { return ++mRefCount; }
+        SLANG_NO_THROW uint32_t SLANG_MCALL Release() override { uint32_t count = --mRefCount; if (count == 0) delete this; return count; }
+
+        SLANG_NO_THROW void const* SLANG_MCALL getBufferPointer() override { return mCode.data(); }
+        SLANG_NO_THROW size_t SLANG_MCALL getBufferSize() override { return mCode.size(); }
+    private:
+        std::vector<uint8_t> mCode;
+        std::atomic<uint32_t> mRefCount = { 0 };
+    };
+
+    // A hash of the compiler binaries, so that updating Slang or dxcompiler invalidates the program cache
+    static uint64_t computeCompilerVersionHash()
+    {
+        uint64_t compilerHash = ProgramCache::kHashSeed;
+        for (const char* dll : { "slang.dll", "slang-glslang.dll", "dxcompiler.dll", "dxil.dll" })
+        {
+            std::string path = getExecutableDirectory() + "/" + dll;
+            compilerHash = ProgramCache::hash(dll, strlen(dll), compilerHash);
+            if (doesFileExist(path)) compilerHash = ProgramCache::hash(readFile(path), compilerHash);
+        }
+        return compilerHash;
+    }
+
+    static uint64_t getCompilerVersionHash()
+    {
+        // Programs may be compiled on several threads; a function-local static is initialized exactly once
+        static const uint64_t compilerHash = computeCompilerVersionHash();
+        return compilerHash;
+    }
+
     static Shader::SharedPtr createShaderFromBlob(const Shader::Blob& shaderBlob, ShaderType shaderType, const std::string& entryPointName, Shader::CompilerFlags flags, std::string& log)
     {
         std::string errorMsg;
@@ -158,6 +202,7 @@ namespace Falcor
 
     // Program
     std::vector<Program*> Program::sPrograms;
+    std::shared_ptr<ProgramCache> Program::sProgramCache;
 
     Program::Program()
     {
@@ -215,6 +260,40 @@ namespace Falcor
         return desc;
     }
 
+    std::string Program::getProgramCacheKey(int slangTarget) const
+    {
+        // Everything that affects the generated code, except the contents of the files. The cache tracks those itself.
+        std::stringstream key;
+        key << "target=" << slangTarget << ";sm=" << mDesc.mShaderModel << ";flags=" << (uint32_t)mDesc.getCompilerFlags() << ";compiler=" << std::hex << getCompilerVersionHash() << std::dec << ";";
+        for (const auto& path : getDataDirectoriesList())
+        {
+            key << "searchPath=" << path << ";";
+        }
+        for (const auto& src : mDesc.mSources)
+        {
+            if (src.type == Desc::Source::Type::File)
+            {
+                std::string fullpath;
+                findFileInDataDirectories(src.pLibrary->getFilename(), fullpath);
+                key << "file=" << fullpath << ";";
+            }
+            else
+            {
+                key << "string=" << std::hex << ProgramCache::hash(src.str) << std::dec << ";";
+            }
+        }
+        for (uint32_t i = 0; i < kShaderCount; i++)
+        {
+            const auto& entryPoint = mDesc.mEntryPoints[i];
+            if (entryPoint.isValid()) key << "entry" << i << "=" << entryPoint.index << ":" << entryPoint.name << ";";
+        }
+        for (const auto& define : mDefineList)
+        {
+            key << "define=" << define.first << "=" << define.second << ";";
+        }
+        return key.str();
+    }
+
     bool Program::addDefine(const std::string& name, const std::string& value)
     {
         // Make sure that it doesn't exist already
@@ -368,17 +447,51 @@ namespace Falcor
         return mActiveProgram.pVersion;
     }
 
-    SlangSession* getSlangSession()
+    // A Slang session can only be used by one thread at a time. To allow programs to be compiled concurrently, each compile
+    // borrows a session from this pool, which creates new sessions as needed.
+    // TODO: figure out a strategy for finalizing the Slang sessions, if desired
+    static std::mutex sSlangSessionMutex;
+    static std::vector<SlangSession*> sFreeSlangSessions;
+    static std::vector<std::pair<std::string, std::string>> sSlangBuiltins;
+
+    static SlangSession* acquireSlangSession()
     {
-        // TODO: figure out a strategy for finalizing the Slang session, if desired
+        std::vector<std::pair<std::string, std::string>> builtins;
+        {
+            std::lock_guard<std::mutex> lock(sSlangSessionMutex);
+            if (sFreeSlangSessions.size())
+            {
+                SlangSession* pSession = sFreeSlangSessions.back();
+                sFreeSlangSessions.pop_back();
+                return pSession;
+            }
+            builtins = sSlangBuiltins;
+        }
 
-        static SlangSession* slangSession = spCreateSession(NULL);
-        return slangSession;
+        // Creating a session is slow, don't hold the lock while doing it
+        SlangSession* pSession = spCreateSession(NULL);
+        for (const auto& b : builtins)
+        {
+            spAddBuiltins(pSession, b.first.c_str(), b.second.c_str());
+        }
+        return pSession;
+    }
+
+    static void releaseSlangSession(SlangSession* pSession)
+    {
+        std::lock_guard<std::mutex> lock(sSlangSessionMutex);
+        sFreeSlangSessions.push_back(pSession);
     }
 
     void loadSlangBuiltins(char const* name, char const* text)
     {
-        spAddBuiltins(getSlangSession(), name, text);
+        // Builtins need to be loaded before any program is compiled; sessions that are currently in use won't see them
+        std::lock_guard<std::mutex> lock(sSlangSessionMutex);
+        sSlangBuiltins.push_back({ name, text });
+        for (auto pSession : sFreeSlangSessions)
+        {
+            spAddBuiltins(pSession, name, text);
+        }
     }
 
     // Translation a Falcor `ShaderType` to the corresponding `SlangStage`
@@ -427,7 +540,7 @@ namespace Falcor
         // Note that we provide all the shaders at once, so that automatically
         // generated bindings can be made consistent across the stages.
 
-        SlangSession* slangSession = getSlangSession();
+        SlangSession* slangSession = acquireSlangSession();
 
         // Start building a request for compilation
         SlangCompileRequest* slangRequest = spCreateCompileRequest(slangSession);
@@ -482,6 +595,23 @@ namespace Falcor
 
         // Don't actually perform semantic checking: just pass through functions bodies to downstream compiler
         slangFlags |= SLANG_COMPILE_FLAG_NO_CHECKING | SLANG_COMPILE_FLAG_SPLIT_MIXED_TYPES;
+
+        // If the code is in the program cache, we still need Slang for the reflection data, but can skip code generation
+        std::string cacheKey;
+        ProgramCache::CodeBlobs cachedCode;
+        bool cacheHit = false;
+        if (sProgramCache)
+        {
+            cacheKey = getProgramCacheKey(slangTarget);
+            cacheHit = sProgramCache->find(cacheKey, cachedCode) && (cachedCode.size() == kShaderCount);
+            for (uint32_t i = 0; cacheHit && i < kShaderCount; i++)
+            {
+                if (mDesc.mEntryPoints[i].isValid() && cachedCode[i].empty()) cacheHit = false;
+            }
+            if (cacheHit) slangFlags |= SLANG_COMPILE_FLAG_NO_CODEGEN;
+        }
+        CpuTimer::TimePoint compileStart = CpuTimer::getCurrentTimePoint();
+
         spSetCompileFlags(slangRequest, slangFlags);
 
         // Now lets add all our input shader code, one-by-one
@@ -537,6 +667,7 @@ namespace Falcor
         if(anySlangErrors)
         {
             spDestroyCompileRequest(slangRequest);
+            releaseSlangSession(slangSession);
             return VersionData();
         }
 
@@ -554,7 +685,14 @@ namespace Falcor
             int entryPointIndex = entryPointCounter++;
             int targetIndex = 0; // We always compile for a single target
 
-            spGetEntryPointCodeBlob(slangRequest, entryPointIndex, targetIndex, shaderBlob[i].writeRef());
+            if (cacheHit)
+            {
+                shaderBlob[i] = new CachedCodeBlob(std::move(cachedCode[i]));
+            }
+            else
+            {
+                spGetEntryPointCodeBlob(slangRequest, entryPointIndex, targetIndex, shaderBlob[i].writeRef());
+            }
         }
 
         VersionData programVersion;
@@ -566,13 +704,28 @@ namespace Falcor
 
         // Extract list of files referenced, for dependency-tracking purposes
         int depFileCount = spGetDependencyFileCount(slangRequest);
+        std::vector<std::string> depFiles;
         for(int ii = 0; ii < depFileCount; ++ii)
         {
             std::string depFilePath = spGetDependencyFilePath(slangRequest, ii);
             mFileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
+            depFiles.push_back(depFilePath);
         }
 
         spDestroyCompileRequest(slangRequest);
+        releaseSlangSession(slangSession);
+
+        if (sProgramCache && !cacheHit)
+        {
+            ProgramCache::CodeBlobs code(kShaderCount);
+            for (uint32_t i = 0; i < kShaderCount; i++)
+            {
+                if (!shaderBlob[i]) continue;
+                const uint8_t* pCode = (const uint8_t*)shaderBlob[i]->getBufferPointer();
+                code[i].assign(pCode, pCode + shaderBlob[i]->getBufferSize());
+            }
+            sProgramCache->store(cacheKey, depFiles, code, CpuTimer::calcDuration(compileStart, CpuTimer::getCurrentTimePoint()));
+        }
 
         // Now that we've preprocessed things, dispatch to the actual program creation logic,
         // which may vary in subclasses of `Program`
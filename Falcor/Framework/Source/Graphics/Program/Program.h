@@ -36,6 +36,7 @@ namespace Falcor
     class Shader;
     class RenderContext;
     class ShaderLibrary;
+    class ProgramCache;
 
     /** Common interface for modifying the macro definitions of programs.
         This is a workaround for the fact that RtProgram is currently unrelated to Program.
@@ -215,7 +216,9 @@ namespace Falcor
 
         virtual ~Program() = 0;
 
-        /** Get the API handle of the active program
+        /** Get the API handle of the active program. Compiles and links the program if its version isn't built yet.
+            Different programs can be compiled concurrently on different threads, but a single program must only be used by one thread at a time.
+            Slang builtins have to be loaded before the first program is compiled.
         */
         ProgramVersion::SharedConstPtr getActiveVersion() const;
 
@@ -266,6 +269,15 @@ namespace Falcor
         */
         static void reloadAllPrograms();
 
+        /** Set a persistent cache for compiled shader code, used by all programs. Pass nullptr to disable caching (the default).
+            Programs found in the cache still run through Slang to generate reflection data, but skip code generation.
+        */
+        static void setProgramCache(const std::shared_ptr<ProgramCache>& pCache) { sProgramCache = pCache; }
+
+        /** Get the persistent program cache, or nullptr if caching is disabled.
+        */
+        static const std::shared_ptr<ProgramCache>& getProgramCache() { return sProgramCache; }
+
         deprecate("3.2", "Use setDefines({}) instead")
         bool clearDefines();
 
@@ -313,7 +325,9 @@ namespace Falcor
         mutable VersionData mActiveProgram;
 
         std::string getProgramDescString() const;
+        std::string getProgramCacheKey(int slangTarget) const;
         static std::vector<Program*> sPrograms;
+        static std::shared_ptr<ProgramCache> sProgramCache;
 
         using string_time_map = std::unordered_map<std::string, time_t>;
         mutable string_time_map mFileTimeMap;
@@ -0,0 +1,406 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ProgramCache.h"
+#include "Utils/Platform/OS.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+namespace Falcor
+{
+    static const uint32_t kEntryMagic = 0x45435046;    // 'FPCE'
+    static const uint32_t kEntryVersion = 1;
+    static const char* kIndexFilename = "index.txt";
+    static const char* kIndexHeader = "FalcorProgramCache 1";
+
+    namespace
+    {
+        // Simple binary helpers for the entry files. Every read is checked, so a truncated or corrupt file is treated as a miss.
+        template<typename T>
+        void writePod(std::ostream& stream, const T& val)
+        {
+            stream.write((const char*)&val, sizeof(T));
+        }
+
+        void writeString(std::ostream& stream, const std::string& str)
+        {
+            writePod(stream, (uint32_t)str.size());
+            stream.write(str.data(), str.size());
+        }
+
+        template<typename T>
+        bool readPod(std::istream& stream, T& val)
+        {
+            return (bool)stream.read((char*)&val, sizeof(T));
+        }
+
+        // maxSize is the size of the file, so a corrupt length fails instead of allocating gigabytes
+        bool readString(std::istream& stream, std::string& str, uint64_t maxSize)
+        {
+            uint32_t size;
+            if (!readPod(stream, size) || size > maxSize) return false;
+            str.resize(size);
+            return size == 0 || (bool)stream.read(&str[0], size);
+        }
+
+        std::string toHex(uint64_t val)
+        {
+            std::stringstream ss;
+            ss << std::hex << std::setw(16) << std::setfill('0') << val;
+            return ss.str();
+        }
+    }
+
+    ProgramCache::SharedPtr ProgramCache::create(const Desc& desc)
+    {
+        if (isDirectoryExists(desc.directory) == false && createDirectory(desc.directory) == false)
+        {
+            logWarning("ProgramCache: Can't create the cache directory '" + desc.directory + "'. Shaders will not be cached.");
+            return nullptr;
+        }
+        return SharedPtr(new ProgramCache(desc));
+    }
+
+    ProgramCache::ProgramCache(const Desc& desc) : mDesc(desc)
+    {
+        loadIndex();
+    }
+
+    ProgramCache::~ProgramCache()
+    {
+        flush();
+    }
+
+    uint64_t ProgramCache::hash(const void* pData, size_t size, uint64_t seed)
+    {
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        uint64_t h = seed;
+        for (size_t i = 0; i < size; i++)
+        {
+            h ^= pBytes[i];
+            h *= 0x100000001b3ull;
+        }
+        return h;
+    }
+
+    std::string ProgramCache::getEntryFilename(uint64_t keyHash) const
+    {
+        return mDesc.directory + "/" + toHex(keyHash) + ".bin";
+    }
+
+    bool ProgramCache::hashFile(const std::string& filename, uint64_t& hash)
+    {
+        if (doesFileExist(filename) == false) return false;
+
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+
+        // The modified time only has a resolution of a second, so the size is checked too, to catch most edits made within the same second
+        time_t modifiedTime = getFileModifiedTime(filename);
+        uint64_t size = (uint64_t)file.tellg();
+        auto it = mFileHashes.find(filename);
+        if (it != mFileHashes.end() && it->second.modifiedTime == modifiedTime && it->second.size == size)
+        {
+            hash = it->second.hash;
+            return true;
+        }
+
+        file.seekg(0);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        hash = ProgramCache::hash(contents.str());
+        mFileHashes[filename] = { modifiedTime, size, hash };
+        return true;
+    }
+
+    bool ProgramCache::find(const std::string& key, CodeBlobs& code)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        uint64_t keyHash = hash(key);
+        auto indexIt = mIndex.find(keyHash);
+        if (indexIt == mIndex.end())
+        {
+            mStats.misses++;
+            return false;
+        }
+
+        bool valid = false;
+        double compileTimeMs = 0;
+        std::ifstream file(getEntryFilename(keyHash), std::ios::binary | std::ios::ate);
+        const uint64_t fileSize = file ? (uint64_t)file.tellg() : 0;
+        file.seekg(0);
+        uint32_t magic, version;
+        std::string storedKey;
+        if (file && readPod(file, magic) && readPod(file, version) && magic == kEntryMagic && version == kEntryVersion && readString(file, storedKey, fileSize) && readPod(file, compileTimeMs))
+        {
+            // Compare the full key, in case of a hash collision
+            valid = (storedKey == key);
+
+            uint32_t depCount = 0;
+            valid = valid && readPod(file, depCount);
+            for (uint32_t i = 0; valid && i < depCount; i++)
+            {
+                std::string depFile;
+                uint64_t storedHash, currentHash;
+                valid = readString(file, depFile, fileSize) && readPod(file, storedHash) && hashFile(depFile, currentHash) && (currentHash == storedHash);
+            }
+
+            uint32_t blobCount = 0;
+            valid = valid && readPod(file, blobCount) && blobCount <= fileSize;
+            if (valid) code.assign(blobCount, {});
+            for (uint32_t i = 0; valid && i < blobCount; i++)
+            {
+                uint64_t size;
+                valid = readPod(file, size) && size <= fileSize;
+                if (valid && size)
+                {
+                    code[i].resize((size_t)size);
+                    valid = (bool)file.read((char*)code[i].data(), size);
+                }
+            }
+        }
+
+        if (valid == false)
+        {
+            // The sources changed (or the file is corrupt). The caller will recompile and replace the entry.
+            code.clear();
+            mStats.staleMisses++;
+            return false;
+        }
+
+        indexIt->second.lastUse = ++mUseCounter;
+        mIndexDirty = true;
+        mStats.hits++;
+        mStats.bytesLoaded += indexIt->second.size;
+        mStats.savedCompileTimeMs += compileTimeMs;
+        return true;
+    }
+
+    void ProgramCache::store(const std::string& key, const std::vector<std::string>& dependencies, const CodeBlobs& code, double compileTimeMs)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.missCompileTimeMs += compileTimeMs;
+
+        uint64_t keyHash = hash(key);
+        std::string filename = getEntryFilename(keyHash);
+        {
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            if (!file)
+            {
+                logWarning("ProgramCache: Can't write '" + filename + "'");
+                return;
+            }
+
+            writePod(file, kEntryMagic);
+            writePod(file, kEntryVersion);
+            writeString(file, key);
+            writePod(file, compileTimeMs);
+
+            writePod(file, (uint32_t)dependencies.size());
+            for (const auto& dep : dependencies)
+            {
+                uint64_t depHash = 0;
+                if (hashFile(dep, depHash) == false)
+                {
+                    // We can't validate this entry later, so don't store it
+                    file.close();
+                    std::remove(filename.c_str());
+                    removeEntry(keyHash);
+                    return;
+                }
+                writeString(file, dep);
+                writePod(file, depHash);
+            }
+
+            writePod(file, (uint32_t)code.size());
+            for (const auto& blob : code)
+            {
+                writePod(file, (uint64_t)blob.size());
+                file.write((const char*)blob.data(), blob.size());
+            }
+
+            if (!file)
+            {
+                logWarning("ProgramCache: Failed writing '" + filename + "'");
+                file.close();
+                std::remove(filename.c_str());
+                removeEntry(keyHash);
+                return;
+            }
+        }
+
+        uint64_t size = 0;
+        std::ifstream sizeCheck(filename, std::ios::binary | std::ios::ate);
+        if (sizeCheck) size = (uint64_t)sizeCheck.tellg();
+
+        IndexEntry& entry = mIndex[keyHash];
+        mTotalSize = mTotalSize - entry.size + size;
+        entry.size = size;
+        entry.lastUse = ++mUseCounter;
+        mIndexDirty = true;
+
+        mStats.stores++;
+        mStats.bytesStored += size;
+
+        evict(keyHash);
+    }
+
+    void ProgramCache::removeEntry(uint64_t keyHash)
+    {
+        auto it = mIndex.find(keyHash);
+        if (it == mIndex.end()) return;
+        mTotalSize -= it->second.size;
+        mIndex.erase(it);
+        mIndexDirty = true;
+    }
+
+    void ProgramCache::evict(uint64_t keep)
+    {
+        while (mTotalSize > mDesc.maxSizeInBytes && mIndex.size() > 1)
+        {
+            // Linear search is fine, the cache holds hundreds of entries at most and this only runs when storing
+            auto oldest = mIndex.end();
+            for (auto it = mIndex.begin(); it != mIndex.end(); it++)
+            {
+                if (it->first == keep) continue;
+                if (oldest == mIndex.end() || it->second.lastUse < oldest->second.lastUse) oldest = it;
+            }
+            if (oldest == mIndex.end()) break;
+
+            std::remove(getEntryFilename(oldest->first).c_str());
+            removeEntry(oldest->first);
+            mStats.evictions++;
+        }
+    }
+
+    void ProgramCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& entry : mIndex)
+        {
+            std::remove(getEntryFilename(entry.first).c_str());
+        }
+        mIndex.clear();
+        mTotalSize = 0;
+        mIndexDirty = true;
+    }
+
+    void ProgramCache::loadIndex()
+    {
+        std::ifstream file(mDesc.directory + "/" + kIndexFilename);
+        if (!file) return;
+
+        std::string header;
+        std::getline(file, header);
+        if (header != kIndexHeader)
+        {
+            logWarning("ProgramCache: Ignoring the index in '" + mDesc.directory + "', it was written by a different version");
+            return;
+        }
+
+        // Each line is <key hash> <size> <last use>
+        std::string hashStr;
+        IndexEntry entry;
+        while (file >> hashStr >> entry.size >> entry.lastUse)
+        {
+            uint64_t keyHash = std::stoull(hashStr, nullptr, 16);
+            if (doesFileExist(getEntryFilename(keyHash)) == false) continue;
+            mIndex[keyHash] = entry;
+            mTotalSize += entry.size;
+            mUseCounter = std::max(mUseCounter, entry.lastUse);
+        }
+    }
+
+    void ProgramCache::saveIndex() const
+    {
+        std::string filename = mDesc.directory + "/" + kIndexFilename;
+        std::ofstream file(filename, std::ios::trunc);
+        if (!file)
+        {
+            logWarning("ProgramCache: Can't write '" + filename + "'");
+            return;
+        }
+
+        file << kIndexHeader << "\n";
+        for (const auto& entry : mIndex)
+        {
+            file << toHex(entry.first) << " " << entry.second.size << " " << entry.second.lastUse << "\n";
+        }
+    }
+
+    void ProgramCache::flush()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mIndexDirty)
+        {
+            saveIndex();
+            mIndexDirty = false;
+        }
+    }
+
+    ProgramCache::Stats ProgramCache::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+    void ProgramCache::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats = Stats();
+    }
+
+    std::string ProgramCache::getStatsString() const
+    {
+        Stats stats = getStats();
+        uint32_t lookups = stats.hits + stats.misses + stats.staleMisses;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1);
+        ss << "Program cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.staleMisses << " stale";
+        if (lookups) ss << " (" << 100.0 * stats.hits / lookups << "% hit rate)";
+        ss << "\n  " << stats.stores << " stored (" << stats.bytesStored / 1024 << " KB), " << stats.evictions << " evicted, " << stats.bytesLoaded / 1024 << " KB loaded";
+        ss << "\n  " << stats.missCompileTimeMs << " ms spent compiling misses, about " << stats.savedCompileTimeMs << " ms of compilation skipped";
+        ss << "\n  " << getEntryCount() << " entries, " << getSizeInBytes() / 1024 << " KB on disk";
+        return ss.str();
+    }
+
+    size_t ProgramCache::getEntryCount() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mIndex.size();
+    }
+
+    uint64_t ProgramCache::getSizeInBytes() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mTotalSize;
+    }
+}
@@ -0,0 +1,165 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+namespace Falcor
+{
+    /** A persistent, content-addressed cache of compiled shader code.
+        Compiling the shaders of a program (especially ray tracing programs, which pull in a large number of Falcor modules) is slow,
+        and the result only changes when the sources, the defines, the entry points or the compiler change. This class stores
+        compiled code on disk so subsequent runs (or define changes that return to a previously seen set of defines) can skip
+        code generation.
+
+        An entry is identified by a key string which the caller builds from everything that affects compilation *except* file
+        contents. Each entry also records the content hash of every file the preprocessor read when the entry was compiled.
+        A lookup only succeeds if all of those files still hash to the same value, which makes the cache equivalent to one keyed
+        on the fully preprocessed source.
+
+        The cache has no dependency on Slang or the graphics API. It stores and returns opaque byte blobs, one per shader stage,
+        so it can be exercised with any compiler backend (or a stub one).
+
+        The total size of the cache on disk is bounded. When it grows beyond Desc::maxSizeInBytes, the least recently used
+        entries are removed. All public functions are thread-safe.
+    */
+    class ProgramCache
+    {
+    public:
+        using SharedPtr = std::shared_ptr<ProgramCache>;
+        using SharedConstPtr = std::shared_ptr<const ProgramCache>;
+
+        /** Compiled code for each shader stage. Unused stages hold empty blobs.
+        */
+        using CodeBlobs = std::vector<std::vector<uint8_t>>;
+
+        struct Desc
+        {
+            std::string directory;                        ///< Where cache files are stored. Created if it doesn't exist.
+            uint64_t maxSizeInBytes = 256 * 1024 * 1024;  ///< Least recently used entries are evicted once the cache is larger than this
+        };
+
+        struct Stats
+        {
+            uint32_t hits = 0;                  ///< Lookups that returned code
+            uint32_t misses = 0;                ///< Lookups for keys which were not in the cache
+            uint32_t staleMisses = 0;           ///< Lookups for keys which were in the cache, but one of their files changed
+            uint32_t stores = 0;
+            uint32_t evictions = 0;
+            uint64_t bytesLoaded = 0;
+            uint64_t bytesStored = 0;
+            double missCompileTimeMs = 0;       ///< Total compile time of the programs that missed (as reported to store())
+            double savedCompileTimeMs = 0;      ///< Sum of the original compile times of the entries that hit
+        };
+
+        /** Create a cache, loading the index of any existing cache found in desc.directory.
+            \return A new object, or nullptr if the directory doesn't exist and can't be created.
+        */
+        static SharedPtr create(const Desc& desc);
+        ~ProgramCache();
+
+        /** Look up the code compiled for a key.
+            \param[in] key Everything that affects the compilation, except the contents of the source files.
+            \param[out] code On success, the compiled code for each stage.
+            \return true on a hit, false otherwise.
+        */
+        bool find(const std::string& key, CodeBlobs& code);
+
+        /** Add (or replace) an entry.
+            \param[in] key The same key passed to find().
+            \param[in] dependencies Every file read while compiling, including the source files themselves.
+            \param[in] code The compiled code for each stage.
+            \param[in] compileTimeMs How long compilation took. Only used for statistics.
+        */
+        void store(const std::string& key, const std::vector<std::string>& dependencies, const CodeBlobs& code, double compileTimeMs = 0);
+
+        /** Remove all entries from memory and disk.
+        */
+        void clear();
+
+        /** Write the index to disk. This happens automatically on destruction.
+        */
+        void flush();
+
+        Stats getStats() const;
+        void resetStats();
+
+        /** Get a human-readable summary of the statistics.
+        */
+        std::string getStatsString() const;
+
+        /** Get the number of entries and their total size on disk.
+        */
+        size_t getEntryCount() const;
+        uint64_t getSizeInBytes() const;
+
+        const Desc& getDesc() const { return mDesc; }
+
+        /** 64-bit FNV-1a hash. Exposed so callers can fold file contents or compiler binaries into their keys.
+        */
+        static uint64_t hash(const void* pData, size_t size, uint64_t seed = kHashSeed);
+        static uint64_t hash(const std::string& str, uint64_t seed = kHashSeed) { return hash(str.data(), str.size(), seed); }
+
+        static const uint64_t kHashSeed = 0xcbf29ce484222325ull;
+
+    private:
+        ProgramCache(const Desc& desc);
+
+        struct IndexEntry
+        {
+            uint64_t size = 0;
+            uint64_t lastUse = 0;
+        };
+
+        struct FileHash
+        {
+            time_t modifiedTime = 0;
+            uint64_t size = 0;
+            uint64_t hash = 0;
+        };
+
+        std::string getEntryFilename(uint64_t keyHash) const;
+        bool hashFile(const std::string& filename, uint64_t& hash);
+        void loadIndex();
+        void saveIndex() const;
+        void removeEntry(uint64_t keyHash);
+        void evict(uint64_t keep);
+
+        Desc mDesc;
+        std::unordered_map<uint64_t, IndexEntry> mIndex;
+        std::unordered_map<std::string, FileHash> mFileHashes;   ///< Dependency hashes, so each file is only read once as long as it doesn't change
+        uint64_t mTotalSize = 0;
+        uint64_t mUseCounter = 0;
+        bool mIndexDirty = false;
+        Stats mStats;
+        mutable std::mutex mMutex;
+    };
+}
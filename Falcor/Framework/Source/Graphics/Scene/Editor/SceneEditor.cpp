@@ -66,6 +66,20 @@ namespace Falcor
         { ShadingModelSpecGloss, "Spec-Gloss" }
     };
 
+    const Gui::DropdownList SceneEditor::kScatterLightTypeList =
+    {
+        { (int32_t)LightScatterer::LightType::Point, "Point" },
+        { (int32_t)LightScatterer::LightType::Spot, "Spot" },
+        { (int32_t)LightScatterer::LightType::AreaRect, "Area Rect" }
+    };
+
+    const Gui::DropdownList SceneEditor::kScatterPowerDistributionList =
+    {
+        { (int32_t)LightScatterer::PowerDistribution::Constant, "Constant" },
+        { (int32_t)LightScatterer::PowerDistribution::Uniform, "Uniform" },
+        { (int32_t)LightScatterer::PowerDistribution::PowerLaw, "Power Law" }
+    };
+
     const Gui::RadioButtonGroup SceneEditor::kGizmoSelectionButtons
     {
         { (int32_t)Gizmo::Type::Translate, "Translation", false },
@@ -359,12 +373,6 @@ namespace Falcor
         {
             if (pGui->addButton("Add Point Light"))
             {
-                if (mpScene->getLightCount() >= MAX_LIGHT_SOURCES)
-                {
-                    msgBox("There cannot be more than 16 lights at a time in a scene!");
-                    return;
-                }
-
                 auto pNewLight = PointLight::create();
 
                 // Place in front of camera
@@ -396,12 +404,6 @@ namespace Falcor
         {
             if (pGui->addButton("Add Directional Light"))
             {
-                if (mpScene->getLightCount() >= MAX_LIGHT_SOURCES)
-                {
-                    msgBox("There cannot be more than 16 lights at a time in a scene!");
-                    return;
-                }
-
                 auto pNewLight = DirectionalLight::create();
                 mpScene->addLight(pNewLight);
 
@@ -1051,12 +1053,76 @@ namespace Falcor
         }
     }
 
+    void SceneEditor::scatterLights(Gui* pGui)
+    {
+        if (pGui->beginGroup("Scatter Lights"))
+        {
+            LightScatterer::Desc& desc = mScatterDesc;
+            int32_t lightCount = (int32_t)desc.lightCount;
+            if (pGui->addIntVar("Light Count", lightCount, 1, 10000000)) desc.lightCount = (uint32_t)lightCount;
+            uint32_t type = (uint32_t)desc.type;
+            if (pGui->addDropdown("Light Type", kScatterLightTypeList, type)) desc.type = (LightScatterer::LightType)type;
+            uint32_t powerDistribution = (uint32_t)desc.powerDistribution;
+            if (pGui->addDropdown("Power Distribution", kScatterPowerDistributionList, powerDistribution)) desc.powerDistribution = (LightScatterer::PowerDistribution)powerDistribution;
+            pGui->addFloatVar("Min Power", desc.minPower, 0.0f);
+            if (desc.powerDistribution != LightScatterer::PowerDistribution::Constant)
+            {
+                pGui->addFloatVar("Max Power", desc.maxPower, desc.minPower);
+            }
+            if (desc.powerDistribution == LightScatterer::PowerDistribution::PowerLaw)
+            {
+                pGui->addFloatVar("Power Law Exponent", desc.powerLawExponent, 0.01f, 10.0f);
+            }
+            pGui->addFloatVar("Color Variation", desc.colorVariation, 0.0f, 1.0f);
+            int32_t clusterCount = (int32_t)desc.clusterCount;
+            if (pGui->addIntVar("Clusters", clusterCount, 0, 100000)) desc.clusterCount = (uint32_t)clusterCount;
+            if (desc.clusterCount > 0)
+            {
+                pGui->addFloatVar("Cluster Fraction", desc.clusterFraction, 0.0f, 1.0f);
+                pGui->addFloatVar("Cluster Radius", desc.clusterRadius, 0.0f, 1.0f, 0.001f);
+            }
+            pGui->addFloatVar("Surface Offset", desc.surfaceOffset, 0.0f, 1.0f, 0.0001f, false, "%.4f");
+            if (desc.type == LightScatterer::LightType::AreaRect)
+            {
+                pGui->addFloatVar("Area Light Size", desc.areaLightSize, 0.0f, 1.0f, 0.0001f, false, "%.4f");
+            }
+            int32_t seed = (int32_t)desc.seed;
+            if (pGui->addIntVar("Seed", seed, 0)) desc.seed = (uint32_t)seed;
+
+            if (pGui->addButton("Generate and Save"))
+            {
+                // The new scene includes the lights file and keeps everything else from the scene's file
+                std::string filename;
+                if (mpScene->getFilename().empty())
+                {
+                    logWarning("Scene Editor: Lights can only be scattered over a scene loaded from a file");
+                }
+                else if (saveFileDialog(Scene::kFileFormatString, filename))
+                {
+                    LightScatterer::SharedPtr pScatterer = LightScatterer::create(mpScene.get());
+                    if (pScatterer)
+                    {
+                        pScatterer->generate(desc);
+                        std::string lightsFile = swapFileExtension(filename, ".fscene", ".lights.fscene");
+                        if (lightsFile == filename) lightsFile += ".lights.fscene";
+                        if (pScatterer->writeLightsFile(lightsFile) && LightScatterer::writeSceneWithLights(mpScene->getFilename(), filename, lightsFile))
+                        {
+                            logInfo(pScatterer->getStatsString());
+                        }
+                    }
+                }
+            }
+            pGui->endGroup();
+        }
+    }
+
     void SceneEditor::renderLightElements(Gui* pGui)
     {
         if (pGui->beginGroup("Lights"))
         {
             addPointLight(pGui);
             addDirectionalLight(pGui);
+            scatterLights(pGui);
 
             for (uint32_t i = 0; i < mpScene->getLightCount(); i++)
             {
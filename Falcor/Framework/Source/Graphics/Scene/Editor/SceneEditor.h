@@ -33,6 +33,7 @@
 #include "Utils/Picking/Picking.h"
 #include "Graphics/Scene/Editor/Gizmo.h"
 #include "Graphics/Scene/Editor/SceneEditorRenderer.h"
+#include "Graphics/Scene/LightScatterer.h"
 
 namespace Falcor
 {
@@ -136,6 +137,7 @@ namespace Falcor
         void deleteLight(uint32_t id);
         void addPointLight(Gui* pGui);
         void addDirectionalLight(Gui* pGui);
+        void scatterLights(Gui* pGui);
 
         // Paths
         void addPath(Gui* pGui);
@@ -280,6 +282,11 @@ namespace Falcor
 
         const static Gui::DropdownList kShadingModelList;
 
+        // Settings of the "Scatter Lights" group
+        LightScatterer::Desc mScatterDesc;
+        const static Gui::DropdownList kScatterLightTypeList;
+        const static Gui::DropdownList kScatterPowerDistributionList;
+
         //
         // Paths
         //
@@ -0,0 +1,235 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "InstanceCuller.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/Math/SimdFloat8.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Instances culled together by one thread. Sets of a single chunk are culled on the calling thread.
+        const uint32_t kChunkSize = 16 * 1024;
+        const uint32_t kGroupSize = 2 * SimdFloat8::kWidth;
+
+        uint32_t alignToGroup(uint32_t count)
+        {
+            return (count + kGroupSize - 1) / kGroupSize * kGroupSize;
+        }
+    }
+
+    /** A frustum plane in the form used by Camera::isObjectCulled()
+    */
+    struct InstanceCuller::Plane
+    {
+        float normal[3];
+        float sign[3];      ///< Sign of the normal, selecting the box corner furthest along it
+        float negW;
+    };
+
+    InstanceCuller::SharedPtr InstanceCuller::create(uint32_t threadCount)
+    {
+        return SharedPtr(new InstanceCuller(threadCount));
+    }
+
+    InstanceCuller::InstanceCuller(uint32_t threadCount)
+    {
+        mThreadCount = threadCount ? threadCount : WorkerPool::get().getThreadCount();
+    }
+
+    void InstanceCuller::resize(uint32_t instanceCount)
+    {
+        // Zero the padding, so the tail group only tests finite values
+        uint32_t paddedCount = alignToGroup(instanceCount);
+        for (auto pArray : { &mCenterX, &mCenterY, &mCenterZ, &mExtentX, &mExtentY, &mExtentZ })
+        {
+            pArray->resize(instanceCount);
+            pArray->resize(paddedCount, 0.0f);
+        }
+        mInstanceCount = instanceCount;
+        mpBoundsStore = nullptr;
+    }
+
+    uint32_t InstanceCuller::updateBounds(const TransformStore::SharedConstPtr& pStore, uint32_t firstNode, uint32_t instanceCount, const std::function<void(std::vector<BoundingBox>& localBounds)>& getLocalBounds)
+    {
+        const uint64_t updateCount = pStore->getUpdateCount();
+        const auto& updatedNodes = pStore->getUpdatedNodes();
+        const bool sameInstances = (pStore == mpBoundsStore) && (firstNode == mBoundsFirstNode) && (instanceCount == mInstanceCount) && (firstNode + instanceCount <= pStore->getNodeCount());
+        if (sameInstances && (updateCount == mBoundsUpdateCount))
+        {
+            return 0;
+        }
+
+        // A store which rebuilt its hierarchy recomputes all its nodes, so the local bounds are refreshed then too
+        uint32_t updatedCount = 0;
+        if (sameInstances && (updateCount == mBoundsUpdateCount + 1) && (updatedNodes.size() < pStore->getNodeCount()))
+        {
+            for (uint32_t node : updatedNodes)
+            {
+                const uint32_t index = node - firstNode;
+                if (node < firstNode || index >= instanceCount) continue;
+                setBounds(index, mLocalBounds[index].transform(pStore->getWorldMatrix(node)));
+                updatedCount++;
+            }
+        }
+        else
+        {
+            resize(instanceCount);
+            mLocalBounds.clear();
+            getLocalBounds(mLocalBounds);
+            mLocalBounds.resize(instanceCount);
+            for (uint32_t index = 0; index < instanceCount; index++)
+            {
+                setBounds(index, mLocalBounds[index].transform(pStore->getWorldMatrix(firstNode + index)));
+            }
+            updatedCount = instanceCount;
+        }
+
+        mpBoundsStore = pStore;
+        mBoundsUpdateCount = updateCount;
+        mBoundsFirstNode = firstNode;
+        return updatedCount;
+    }
+
+    uint32_t InstanceCuller::cullRange(const Plane* pPlanes, uint32_t first, uint32_t end, uint32_t* pVisible) const
+    {
+        uint32_t visibleCount = 0;
+        for (uint32_t i = first; i < end; i += kGroupSize)
+        {
+            // Two groups of 8 per iteration, to keep more independent work in flight
+            const uint32_t j = i + SimdFloat8::kWidth;
+            SimdFloat8 cx0 = SimdFloat8::load(&mCenterX[i]), cx1 = SimdFloat8::load(&mCenterX[j]);
+            SimdFloat8 cy0 = SimdFloat8::load(&mCenterY[i]), cy1 = SimdFloat8::load(&mCenterY[j]);
+            SimdFloat8 cz0 = SimdFloat8::load(&mCenterZ[i]), cz1 = SimdFloat8::load(&mCenterZ[j]);
+            SimdFloat8 ex0 = SimdFloat8::load(&mExtentX[i]), ex1 = SimdFloat8::load(&mExtentX[j]);
+            SimdFloat8 ey0 = SimdFloat8::load(&mExtentY[i]), ey1 = SimdFloat8::load(&mExtentY[j]);
+            SimdFloat8 ez0 = SimdFloat8::load(&mExtentZ[i]), ez1 = SimdFloat8::load(&mExtentZ[j]);
+
+            SimdFloat8 culled0(0.0f), culled1(0.0f);
+            for (uint32_t p = 0; p < 6; p++)
+            {
+                const Plane& plane = pPlanes[p];
+                SimdFloat8 nx(plane.normal[0]), ny(plane.normal[1]), nz(plane.normal[2]);
+                SimdFloat8 sx(plane.sign[0]), sy(plane.sign[1]), sz(plane.sign[2]);
+                SimdFloat8 negW(plane.negW);
+                // dot(center + extent * sign, normal), as in Camera::isObjectCulled()
+                SimdFloat8 d0 = (cx0 + ex0 * sx) * nx + (cy0 + ey0 * sy) * ny + (cz0 + ez0 * sz) * nz;
+                SimdFloat8 d1 = (cx1 + ex1 * sx) * nx + (cy1 + ey1 * sy) * ny + (cz1 + ez1 * sz) * nz;
+                culled0 = simdOr(culled0, simdLessEqual(d0, negW));
+                culled1 = simdOr(culled1, simdLessEqual(d1, negW));
+            }
+
+            uint32_t visible = ~(uint32_t)(simdMoveMask(culled0) | (simdMoveMask(culled1) << SimdFloat8::kWidth)) & 0xffff;
+            if (end - i < kGroupSize)
+            {
+                visible &= (1u << (end - i)) - 1;
+            }
+            if (visible == 0) continue;
+
+            // Write every index and only advance past the visible ones. pVisible has room for the whole range, so this never overruns.
+            for (uint32_t k = 0; k < kGroupSize; k++)
+            {
+                pVisible[visibleCount] = i + k;
+                visibleCount += (visible >> k) & 1;
+            }
+        }
+        return visibleCount;
+    }
+
+    void InstanceCuller::cull(const glm::vec4 planes[6], uint32_t threadCount)
+    {
+        auto start = CpuTimer::getCurrentTimePoint();
+
+        Plane cullPlanes[6];
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                cullPlanes[p].normal[c] = planes[p][c];
+                cullPlanes[p].sign[c] = (planes[p][c] > 0.0f) ? 1.0f : ((planes[p][c] < 0.0f) ? -1.0f : 0.0f);
+            }
+            cullPlanes[p].negW = -planes[p].w;
+        }
+
+        // Each chunk writes its visible instances to the start of its own range of mVisible, then the ranges are packed together
+        mVisible.resize(alignToGroup(mInstanceCount));
+        uint32_t chunkCount = (mInstanceCount + kChunkSize - 1) / kChunkSize;
+        threadCount = std::max(1u, std::min(threadCount, chunkCount));
+        mChunkVisibleCount.resize(chunkCount);
+
+        parallelFor(chunkCount, threadCount, [&](uint32_t chunk)
+        {
+            uint32_t first = chunk * kChunkSize;
+            uint32_t end = std::min(first + kChunkSize, mInstanceCount);
+            mChunkVisibleCount[chunk] = cullRange(cullPlanes, first, end, &mVisible[first]);
+        });
+
+        uint32_t visibleCount = 0;
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            const uint32_t* pChunk = mVisible.data() + chunk * kChunkSize;
+            std::copy(pChunk, pChunk + mChunkVisibleCount[chunk], mVisible.data() + visibleCount);
+            visibleCount += mChunkVisibleCount[chunk];
+        }
+        mVisible.resize(visibleCount);
+
+        mStats.instanceCount = mInstanceCount;
+        mStats.visibleCount = visibleCount;
+        mStats.threadCount = threadCount;
+        mStats.cullTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
+
+    const std::vector<uint32_t>& InstanceCuller::cull(const glm::vec4 planes[6])
+    {
+        cull(planes, mThreadCount);
+        return mVisible;
+    }
+
+    const std::vector<uint32_t>& InstanceCuller::cull(const Camera* pCamera)
+    {
+        glm::vec4 planes[6];
+        pCamera->getFrustumPlanes(planes);
+        return cull(planes);
+    }
+
+    std::string InstanceCuller::getStatsString() const
+    {
+        const Stats& s = mStats;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "InstanceCuller: " << s.visibleCount << " of " << s.instanceCount << " instances visible. Culled in " << s.cullTimeMs << " ms on "
+           << s.threadCount << " threads (" << std::setprecision(1) << s.instanceCount / (std::max(s.cullTimeMs, 0.001) * 1000.0) << " Minst/s)";
+        return ss.str();
+    }
+}
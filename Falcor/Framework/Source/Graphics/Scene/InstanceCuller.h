@@ -0,0 +1,137 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "glm/vec4.hpp"
+#include "Utils/AABB.h"
+#include "Graphics/Scene/TransformStore.h"
+
+namespace Falcor
+{
+    class Camera;
+
+    /** Frustum culling of many instances at once.
+        The world-space bounding boxes of the instances are kept in structure-of-arrays form, and tested 16 at a time against the frustum
+        planes, using the same test as Camera::isObjectCulled(). Large sets are split into chunks culled in parallel.
+        The result is a compact list of the visible instances, in increasing order.
+        The bounds are kept between calls, and updateBounds() only rewrites the ones of instances which moved.
+    */
+    class InstanceCuller
+    {
+    public:
+        using SharedPtr = std::shared_ptr<InstanceCuller>;
+        using SharedConstPtr = std::shared_ptr<const InstanceCuller>;
+
+        /** What the last cull() did
+        */
+        struct Stats
+        {
+            uint32_t instanceCount = 0;
+            uint32_t visibleCount = 0;
+            uint32_t threadCount = 0;
+            double cullTimeMs = 0;
+        };
+
+        /** Create a culler
+            \param[in] threadCount The number of threads to cull large sets with. 0 uses all the hardware threads.
+        */
+        static SharedPtr create(uint32_t threadCount = 0);
+
+        /** Set the number of instances. The bounds of new instances are undefined until set.
+            The next updateBounds() rewrites all the bounds.
+        */
+        void resize(uint32_t instanceCount);
+
+        /** Bring the bounds up to date with the world matrices of a transform store.
+            Instance i is node firstNode + i, and its world bounds are its local bounds transformed by the node's world matrix.
+            Only the instances whose node the store recomputed since the last call are rewritten. All of them are when the store, its hierarchy or the instance
+            count changed, or when a store update() was not followed by a call.
+            \param[in] getLocalBounds Fills the local bounds of all the instances. Only called when all the bounds are rewritten, and the result is kept for the next calls.
+            \return The number of bounds rewritten
+        */
+        uint32_t updateBounds(const TransformStore::SharedConstPtr& pStore, uint32_t firstNode, uint32_t instanceCount, const std::function<void(std::vector<BoundingBox>& localBounds)>& getLocalBounds);
+
+        /** Set the world-space bounds of an instance
+        */
+        void setBounds(uint32_t instanceId, const BoundingBox& box)
+        {
+            mCenterX[instanceId] = box.center.x;
+            mCenterY[instanceId] = box.center.y;
+            mCenterZ[instanceId] = box.center.z;
+            mExtentX[instanceId] = box.extent.x;
+            mExtentY[instanceId] = box.extent.y;
+            mExtentZ[instanceId] = box.extent.z;
+        }
+
+        uint32_t getInstanceCount() const { return mInstanceCount; }
+
+        /** Find the instances inside a camera's frustum
+            \return The visible instances, in increasing order. Valid until the next call to cull().
+        */
+        const std::vector<uint32_t>& cull(const Camera* pCamera);
+
+        /** Find the instances inside a frustum
+            \param[in] planes The frustum planes, see Camera::getFrustumPlanes()
+            \return The visible instances, in increasing order. Valid until the next call to cull().
+        */
+        const std::vector<uint32_t>& cull(const glm::vec4 planes[6]);
+
+        /** Get the result of the last cull()
+        */
+        const std::vector<uint32_t>& getVisibleInstances() const { return mVisible; }
+
+        const Stats& getStats() const { return mStats; }
+
+        /** Get a one-line summary of the last cull(), for logging
+        */
+        std::string getStatsString() const;
+
+    private:
+        InstanceCuller(uint32_t threadCount);
+
+        struct Plane;
+        uint32_t cullRange(const Plane* pPlanes, uint32_t first, uint32_t end, uint32_t* pVisible) const;
+        void cull(const glm::vec4 planes[6], uint32_t threadCount);
+
+        uint32_t mThreadCount;
+        uint32_t mInstanceCount = 0;
+        // The arrays are padded to a multiple of 16 instances
+        std::vector<float> mCenterX, mCenterY, mCenterZ;
+        std::vector<float> mExtentX, mExtentY, mExtentZ;
+        std::vector<uint32_t> mVisible;
+        std::vector<BoundingBox> mLocalBounds;          ///< Local bounds of updateBounds()
+        TransformStore::SharedConstPtr mpBoundsStore;   ///< The store updateBounds() last read, or nullptr if the bounds were set otherwise
+        uint64_t mBoundsUpdateCount = 0;                ///< The store's update count when it did
+        uint32_t mBoundsFirstNode = 0;
+        std::vector<uint32_t> mChunkVisibleCount;
+        Stats mStats;
+    };
+}
@@ -0,0 +1,465 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "LightScatterer.h"
+#include "Scene.h"
+#include "SceneExportImportCommon.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/Platform/OS.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/prettywriter.h"
+#include "glm/gtx/euler_angles.hpp"
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Lights are generated and written in chunks of this size. Each chunk has its own random sequence, so the result doesn't depend on the thread count.
+        const uint32_t kChunkSize = 16 * 1024;
+
+        using Rng = std::mt19937;
+
+        float uniform01(Rng& rng)
+        {
+            return std::min(std::uniform_real_distribution<float>(0.0f, 1.0f)(rng), 0.99999994f);
+        }
+
+        // Index of the first element of a running sum which is greater than x
+        template<typename T>
+        uint32_t sampleCdf(const std::vector<T>& cdf, T x)
+        {
+            uint32_t i = (uint32_t)(std::upper_bound(cdf.begin(), cdf.end(), x) - cdf.begin());
+            return std::min(i, (uint32_t)cdf.size() - 1);
+        }
+
+        void buildTangentFrame(const glm::vec3& n, glm::vec3& t, glm::vec3& b)
+        {
+            t = (std::abs(n.x) > 0.9f) ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+            t = glm::normalize(glm::cross(n, t));
+            b = glm::cross(n, t);
+        }
+
+        // Yaw, pitch and roll, in the order of glm::yawPitchRoll(), rotating the +Z axis to a direction
+        glm::vec3 getRotationFromNormal(const glm::vec3& n, float roll)
+        {
+            return glm::vec3(std::atan2(n.x, n.z), std::asin(glm::clamp(-n.y, -1.0f, 1.0f)), roll);
+        }
+
+        std::string formatFloat(float f)
+        {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.6g", f);
+            return buffer;
+        }
+
+        std::string jsonKey(const char* key)
+        {
+            return std::string("\"") + key + "\": ";
+        }
+    }
+
+    LightScatterer::SharedPtr LightScatterer::create(Scene* pScene, SceneBvh::SharedConstPtr pBvh)
+    {
+        if (pBvh == nullptr)
+        {
+            pBvh = SceneBvh::create(pScene);
+        }
+        if (pBvh == nullptr || pBvh->getInstanceCount() == 0)
+        {
+            logWarning("LightScatterer: The scene has no triangles to place lights on");
+            return nullptr;
+        }
+
+        SharedPtr pThis = SharedPtr(new LightScatterer());
+        auto start = CpuTimer::getCurrentTimePoint();
+        pThis->mpBvh = pBvh;
+        pThis->mSceneRadius = glm::length(pBvh->getInstanceBvh().getBounds().extent);
+        if (pThis->mSceneRadius <= 0.0f) pThis->mSceneRadius = pScene->getRadius();
+        uint32_t threadCount = WorkerPool::get().getThreadCount();
+
+        // The triangle areas of each mesh, in object space
+        std::vector<MeshDistribution>& meshes = pThis->mMeshDistributions;
+        meshes.resize(pBvh->getMeshBvhCount());
+        parallelFor(pBvh->getMeshBvhCount(), threadCount, [&](uint32_t meshBvhId)
+        {
+            const MeshBvh* pMeshBvh = pBvh->getMeshBvh(meshBvhId);
+            if (pMeshBvh == nullptr) return;
+            const auto& triangles = pMeshBvh->getTriangles();
+            MeshDistribution& dist = meshes[meshBvhId];
+            dist.cdf.resize(triangles.size());
+            float sum = 0;
+            uint32_t primitiveCount = 0;
+            for (size_t i = 0; i < triangles.size(); i++)
+            {
+                sum += 0.5f * glm::length(glm::cross(triangles[i].e1, triangles[i].e2));
+                dist.cdf[i] = sum;
+                primitiveCount = std::max(primitiveCount, triangles[i].primitiveId + 1);
+            }
+            dist.triangleOfPrimitive.resize(primitiveCount, 0);
+            for (uint32_t i = 0; i < (uint32_t)triangles.size(); i++) dist.triangleOfPrimitive[triangles[i].primitiveId] = i;
+        });
+
+        // The world-space area of each instance. Non-uniform scaling makes this an approximation, which is good enough to spread the lights.
+        pThis->mInstanceCdf.resize(pBvh->getInstanceCount());
+        double sum = 0;
+        for (uint32_t i = 0; i < pBvh->getInstanceCount(); i++)
+        {
+            const SceneBvh::Instance& instance = pBvh->getInstance(i);
+            const MeshDistribution& dist = meshes[instance.meshBvhId];
+            if (dist.cdf.empty() == false)
+            {
+                double scale = std::pow(std::abs((double)glm::determinant(glm::mat3(instance.worldMat))), 2.0 / 3.0);
+                sum += dist.cdf.back() * scale;
+                pThis->mStats.sampledTriangleCount += dist.cdf.size();
+            }
+            pThis->mInstanceCdf[i] = sum;
+        }
+
+        if (sum <= 0)
+        {
+            logWarning("LightScatterer: The scene has no triangles to place lights on");
+            return nullptr;
+        }
+
+        pThis->mStats.prepareTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return pThis;
+    }
+
+    LightScatterer::SurfacePoint LightScatterer::getSurfacePoint(uint32_t instanceId, uint32_t triangle, float u, float v) const
+    {
+        const SceneBvh::Instance& instance = mpBvh->getInstance(instanceId);
+        const MeshBvh::Triangle& tri = mpBvh->getMeshBvh(instance.meshBvhId)->getTriangles()[triangle];
+
+        SurfacePoint p;
+        glm::vec3 posL = tri.v0 + tri.e1 * u + tri.e2 * v;
+        p.position = glm::vec3(instance.worldMat * glm::vec4(posL, 1.0f));
+
+        // Normals transform with the inverse transpose
+        glm::vec3 normalL = glm::cross(tri.e1, tri.e2);
+        const glm::mat4& inv = instance.invWorldMat;
+        glm::vec3 normalW(glm::dot(glm::vec3(inv[0]), normalL), glm::dot(glm::vec3(inv[1]), normalL), glm::dot(glm::vec3(inv[2]), normalL));
+        float length = glm::length(normalW);
+        p.normal = (length > 0) ? normalW / length : glm::vec3(0, 1, 0);
+        return p;
+    }
+
+    template<typename Rng>
+    LightScatterer::SurfacePoint LightScatterer::sampleSurface(Rng& rng) const
+    {
+        uint32_t instanceId = sampleCdf(mInstanceCdf, uniform01(rng) * mInstanceCdf.back());
+        const MeshDistribution& dist = mMeshDistributions[mpBvh->getInstance(instanceId).meshBvhId];
+        uint32_t triangle = sampleCdf(dist.cdf, uniform01(rng) * dist.cdf.back());
+
+        // Uniform barycentrics
+        float su = std::sqrt(uniform01(rng));
+        float r = uniform01(rng);
+        return getSurfacePoint(instanceId, triangle, su * (1.0f - r), su * r);
+    }
+
+    template<typename Rng>
+    LightScatterer::SurfacePoint LightScatterer::sampleCluster(Rng& rng, const SurfacePoint& center) const
+    {
+        // Offset the center in its tangent plane, then drop the point onto the surface below it
+        glm::vec3 t, b;
+        buildTangentFrame(center.normal, t, b);
+        float sigma = mDesc.clusterRadius * mSceneRadius;
+        std::normal_distribution<float> offset(0.0f, sigma);
+        glm::vec3 p = center.position + t * offset(rng) + b * offset(rng);
+
+        float height = std::max(3.0f * sigma, 1e-4f * mSceneRadius);
+        BvhRay ray;
+        ray.origin = p + center.normal * height;
+        ray.direction = -center.normal;
+        ray.tMax = 2.0f * height;
+        BvhHit hit;
+        if (mpBvh->intersect(ray, hit) == false)
+        {
+            // Past the edge of the surface. Keep the point floating in the center's plane.
+            return { p, center.normal };
+        }
+
+        const MeshDistribution& dist = mMeshDistributions[mpBvh->getInstance(hit.instanceId).meshBvhId];
+        SurfacePoint s = getSurfacePoint(hit.instanceId, dist.triangleOfPrimitive[hit.primitiveId], hit.u, hit.v);
+        if (glm::dot(s.normal, center.normal) < 0) s.normal = -s.normal;
+        return s;
+    }
+
+    template<typename Rng>
+    glm::vec3 LightScatterer::sampleIntensity(Rng& rng) const
+    {
+        float power = mDesc.minPower;
+        switch (mDesc.powerDistribution)
+        {
+        case PowerDistribution::Uniform:
+            power = glm::mix(mDesc.minPower, mDesc.maxPower, uniform01(rng));
+            break;
+        case PowerDistribution::PowerLaw:
+            if (mDesc.minPower > 0 && mDesc.maxPower > mDesc.minPower)
+            {
+                // Inverse CDF of the bounded Pareto distribution
+                float a = std::max(mDesc.powerLawExponent, 1e-3f);
+                float ratio = std::pow(mDesc.minPower / mDesc.maxPower, a);
+                power = mDesc.minPower * std::pow(1.0f - uniform01(rng) * (1.0f - ratio), -1.0f / a);
+            }
+            break;
+        default:
+            break;
+        }
+
+        glm::vec3 color(1.0f);
+        if (mDesc.colorVariation > 0)
+        {
+            float h = uniform01(rng) * 6.0f;
+            glm::vec3 hue = glm::clamp(glm::vec3(std::abs(h - 3.0f) - 1.0f, 2.0f - std::abs(h - 2.0f), 2.0f - std::abs(h - 4.0f)), 0.0f, 1.0f);
+            color = glm::mix(glm::vec3(1.0f), hue, mDesc.colorVariation);
+        }
+
+        // Scale the color so the light emits the requested power. See Light::getPower().
+        float lightSize = mDesc.areaLightSize * mSceneRadius;
+        float powerPerIntensity = (mDesc.type == LightType::AreaRect) ? (float)M_PI * lightSize * lightSize : 4.0f * (float)M_PI;
+        return color * (power / (powerPerIntensity * std::max(luminance(color), 1e-6f)));
+    }
+
+    void LightScatterer::generate(const Desc& desc)
+    {
+        auto start = CpuTimer::getCurrentTimePoint();
+        mDesc = desc;
+        uint32_t threadCount = desc.threadCount ? desc.threadCount : WorkerPool::get().getThreadCount();
+
+        Rng clusterRng(desc.seed);
+        mClusterCenters.resize(desc.clusterCount);
+        for (auto& c : mClusterCenters) c = sampleSurface(clusterRng);
+
+        mLights.resize(desc.lightCount);
+        uint32_t chunkCount = (desc.lightCount + kChunkSize - 1) / kChunkSize;
+        std::atomic<uint32_t> clusteredCount(0);
+        parallelFor(chunkCount, threadCount, [&](uint32_t chunk)
+        {
+            std::seed_seq seed = { desc.seed, chunk + 1 };
+            Rng rng(seed);
+            uint32_t clustered = 0;
+            uint32_t end = std::min(desc.lightCount, (chunk + 1) * kChunkSize);
+            for (uint32_t i = chunk * kChunkSize; i < end; i++)
+            {
+                SurfacePoint p;
+                if (mClusterCenters.size() && uniform01(rng) < desc.clusterFraction)
+                {
+                    p = sampleCluster(rng, mClusterCenters[std::min((uint32_t)(uniform01(rng) * mClusterCenters.size()), (uint32_t)mClusterCenters.size() - 1)]);
+                    clustered++;
+                }
+                else
+                {
+                    p = sampleSurface(rng);
+                }
+
+                GeneratedLight& light = mLights[i];
+                light.position = p.position + p.normal * (desc.surfaceOffset * mSceneRadius);
+                light.normal = p.normal;
+                light.intensity = sampleIntensity(rng);
+                light.roll = uniform01(rng) * 2.0f * (float)M_PI;
+            }
+            clusteredCount += clustered;
+        });
+
+        mStats.lightCount = desc.lightCount;
+        mStats.clusteredLightCount = clusteredCount;
+        mStats.threadCount = std::max(1u, std::min(threadCount, chunkCount));
+        mStats.generateTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        mStats.writeTimeMs = 0;
+    }
+
+    void LightScatterer::addToScene(Scene* pScene) const
+    {
+        float halfSize = 0.5f * mDesc.areaLightSize * mSceneRadius;
+        for (const GeneratedLight& light : mLights)
+        {
+            if (mDesc.type == LightType::AreaRect)
+            {
+                auto pLight = AnalyticAreaLight::create();
+                pLight->setScaling(glm::vec3(halfSize, halfSize, 1.0f));
+                glm::vec3 rotation = getRotationFromNormal(light.normal, light.roll);
+                pLight->setTransformMatrix(glm::translate(glm::mat4(), light.position) * glm::yawPitchRoll(rotation[0], rotation[1], rotation[2]));
+                pLight->setIntensity(light.intensity);
+                pScene->addLight(pLight);
+            }
+            else
+            {
+                auto pLight = PointLight::create();
+                pLight->setWorldPosition(light.position);
+                pLight->setIntensity(light.intensity);
+                if (mDesc.type == LightType::Spot)
+                {
+                    pLight->setWorldDirection(light.normal);
+                    pLight->setOpeningAngle(glm::radians(mDesc.spotOpeningAngle));
+                    pLight->setPenumbraAngle(glm::radians(mDesc.spotPenumbraAngle));
+                }
+                pScene->addLight(pLight);
+            }
+        }
+    }
+
+    bool LightScatterer::writeLightsFile(const std::string& filename)
+    {
+        auto start = CpuTimer::getCurrentTimePoint();
+
+        // Lights are left unnamed, so the importer doesn't track them by name. Values which are the same for all the lights go in the format string.
+        float halfSize = 0.5f * mDesc.areaLightSize * mSceneRadius;
+        bool isArea = (mDesc.type == LightType::AreaRect);
+        std::string format = "        {" + jsonKey(SceneKeys::kType) + '"' + (isArea ? SceneKeys::kAreaLightRect : SceneKeys::kPointLight) + "\", "
+            + jsonKey(SceneKeys::kLightIntensity) + "[%.6g, %.6g, %.6g], " + jsonKey(isArea ? SceneKeys::kTranslationVec : SceneKeys::kLightPos) + "[%.6g, %.6g, %.6g]";
+        if (isArea)
+        {
+            format += ", " + jsonKey(SceneKeys::kRotationVec) + "[%.6g, %.6g, %.6g], " + jsonKey(SceneKeys::kScalingVec) + "[" + formatFloat(halfSize) + ", " + formatFloat(halfSize) + ", 1]";
+        }
+        else if (mDesc.type == LightType::Spot)
+        {
+            // The opening angle goes first, the penumbra is clamped to it
+            format += ", " + jsonKey(SceneKeys::kLightDirection) + "[%.6g, %.6g, %.6g], " + jsonKey(SceneKeys::kLightOpeningAngle) + formatFloat(mDesc.spotOpeningAngle) + ", "
+                + jsonKey(SceneKeys::kLightPenumbraAngle) + formatFloat(mDesc.spotPenumbraAngle);
+        }
+        format += "}";
+
+        // Format the chunks in parallel, then write them in order
+        uint32_t lightCount = (uint32_t)mLights.size();
+        uint32_t chunkCount = (lightCount + kChunkSize - 1) / kChunkSize;
+        std::vector<std::string> chunks(chunkCount);
+        uint32_t threadCount = mDesc.threadCount ? mDesc.threadCount : WorkerPool::get().getThreadCount();
+        parallelFor(chunkCount, threadCount, [&](uint32_t chunk)
+        {
+            std::string& s = chunks[chunk];
+            uint32_t end = std::min(lightCount, (chunk + 1) * kChunkSize);
+            s.reserve((end - chunk * kChunkSize) * (format.size() + 64));
+            char line[512];
+            for (uint32_t i = chunk * kChunkSize; i < end; i++)
+            {
+                const GeneratedLight& light = mLights[i];
+                const glm::vec3& intensity = light.intensity;
+                const glm::vec3& pos = light.position;
+                glm::vec3 dir = isArea ? glm::degrees(getRotationFromNormal(light.normal, light.roll)) : light.normal;
+                int length = snprintf(line, sizeof(line), format.c_str(), intensity.x, intensity.y, intensity.z, pos.x, pos.y, pos.z, dir.x, dir.y, dir.z);
+                s.append(line, std::min(length, (int)sizeof(line) - 1));
+                s += (i + 1 < lightCount) ? ",\n" : "\n";
+            }
+        });
+
+        std::ofstream file(filename, std::ios::binary);
+        if (file.fail())
+        {
+            logError("LightScatterer: Can't open output file " + filename);
+            return false;
+        }
+        file << "{\n    \"" << SceneKeys::kVersion << "\": 2,\n    \"" << SceneKeys::kLights << "\": [\n";
+        for (const std::string& s : chunks) file.write(s.data(), s.size());
+        file << "    ]\n}\n";
+        file.close();
+        if (file.fail())
+        {
+            logError("LightScatterer: Failed writing " + filename);
+            return false;
+        }
+
+        mStats.writeTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return true;
+    }
+
+    bool LightScatterer::writeSceneWithLights(const std::string& sourceScene, const std::string& filename, const std::string& lightsFile)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(sourceScene, fullpath) == false)
+        {
+            logError("LightScatterer: Can't find scene file " + sourceScene);
+            return false;
+        }
+
+        std::string jsonData = readFile(fullpath);
+        rapidjson::Document jdoc;
+        jdoc.Parse(jsonData.c_str());
+        if (jdoc.HasParseError() || jdoc.IsObject() == false)
+        {
+            logError("LightScatterer: Can't parse scene file " + fullpath);
+            return false;
+        }
+
+        // Includes are resolved relative to the including scene, so use a relative path when the lights file is next to the new scene
+        std::string include = lightsFile;
+        if (getDirectoryFromFile(lightsFile) == getDirectoryFromFile(filename))
+        {
+            include = getFilenameFromPath(lightsFile);
+        }
+
+        auto& allocator = jdoc.GetAllocator();
+        rapidjson::Value jinclude;
+        jinclude.SetString(include.c_str(), (rapidjson::SizeType)include.size(), allocator);
+        auto it = jdoc.FindMember(SceneKeys::kInclude);
+        if (it != jdoc.MemberEnd() && it->value.IsArray())
+        {
+            it->value.PushBack(jinclude, allocator);
+        }
+        else
+        {
+            if (it != jdoc.MemberEnd()) jdoc.RemoveMember(it);
+            rapidjson::Value jarray(rapidjson::kArrayType);
+            jarray.PushBack(jinclude, allocator);
+            jdoc.AddMember(rapidjson::StringRef(SceneKeys::kInclude), jarray, allocator);
+        }
+
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        writer.SetIndent(' ', 4);
+        jdoc.Accept(writer);
+
+        std::ofstream file(filename, std::ios::binary);
+        if (file.fail())
+        {
+            logError("LightScatterer: Can't open output file " + filename);
+            return false;
+        }
+        file.write(buffer.GetString(), buffer.GetSize());
+        return file.good();
+    }
+
+    std::string LightScatterer::getStatsString() const
+    {
+        const Stats& s = mStats;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "LightScatterer: " << s.lightCount << " lights (" << s.clusteredLightCount << " clustered) on " << s.sampledTriangleCount << " triangles. Prepare "
+           << s.prepareTimeMs << " ms, generate " << s.generateTimeMs << " ms on " << s.threadCount << " threads ("
+           << std::setprecision(1) << s.lightCount / (std::max(s.generateTimeMs, 0.001) * 1000.0) << " Mlights/s), write " << std::setprecision(3) << s.writeTimeMs << " ms";
+        return ss.str();
+    }
+}
@@ -0,0 +1,173 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "Graphics/Bvh/SceneBvh.h"
+
+namespace Falcor
+{
+    class Scene;
+
+    /** Scatters many lights over the surfaces of a scene, for testing how rendering scales with the light count.
+        Lights are placed on triangles picked in proportion to their area, optionally gathered in clusters, and offset slightly along the surface normal.
+        The result can be written as an .fscene holding only the lights, plus a copy of the source .fscene that includes it.
+        Generation runs in parallel and is deterministic for a given seed, regardless of the thread count.
+    */
+    class LightScatterer
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightScatterer>;
+        using SharedConstPtr = std::shared_ptr<const LightScatterer>;
+
+        enum class LightType
+        {
+            Point,
+            Spot,           ///< Point light pointing along the surface normal
+            AreaRect,       ///< Analytic rectangular area light facing along the surface normal. Its normal is the local +Z axis.
+        };
+
+        enum class PowerDistribution
+        {
+            Constant,       ///< Every light emits minPower
+            Uniform,        ///< Uniform in [minPower, maxPower]
+            PowerLaw,       ///< Bounded Pareto in [minPower, maxPower]: many dim lights and a few bright ones
+        };
+
+        /** Distances are relative to the radius of the scene's bounding sphere, so the same settings work across scenes.
+        */
+        struct Desc
+        {
+            uint32_t lightCount = 1000;
+            LightType type = LightType::Point;
+            uint32_t seed = 0;
+
+            PowerDistribution powerDistribution = PowerDistribution::Constant;
+            float minPower = 1.0f;              ///< Emitted power, as returned by Light::getPower()
+            float maxPower = 100.0f;
+            float powerLawExponent = 1.5f;      ///< Higher values make bright lights rarer
+            float colorVariation = 0.0f;        ///< 0 for white lights, 1 for fully saturated random hues
+
+            uint32_t clusterCount = 0;          ///< Number of cluster centers. 0 scatters every light independently.
+            float clusterFraction = 1.0f;       ///< Fraction of the lights placed in clusters
+            float clusterRadius = 0.02f;        ///< Standard deviation of the lights' distance from their cluster center
+
+            float surfaceOffset = 0.001f;       ///< Height of the lights above the surface
+            float spotOpeningAngle = 45.0f;     ///< In degrees
+            float spotPenumbraAngle = 5.0f;     ///< In degrees
+            float areaLightSize = 0.002f;       ///< Side length of the area lights
+
+            uint32_t threadCount = 0;           ///< 0 uses all the hardware threads
+        };
+
+        struct GeneratedLight
+        {
+            glm::vec3 position;
+            glm::vec3 normal;                   ///< The surface normal, the direction spot and area lights face
+            glm::vec3 intensity;                ///< In the units of the light type's LightData::intensity
+            float roll;                         ///< Rotation of area lights around their normal, in radians
+        };
+
+        struct Stats
+        {
+            uint32_t lightCount = 0;
+            uint32_t clusteredLightCount = 0;
+            uint64_t sampledTriangleCount = 0;  ///< Triangles of all the instances, the surfaces lights are placed on
+            uint32_t threadCount = 0;
+            double prepareTimeMs = 0;           ///< Building the area distributions. Done once per scatterer.
+            double generateTimeMs = 0;
+            double writeTimeMs = 0;
+        };
+
+        /** Create a scatterer for a scene
+            \param[in] pScene The scene
+            \param[in] pBvh The scene's CPU BVH. If null, one is built.
+            \return A new object, or nullptr if the scene has no triangles to place lights on
+        */
+        static SharedPtr create(Scene* pScene, SceneBvh::SharedConstPtr pBvh = nullptr);
+
+        /** Generate a new set of lights, replacing the previous ones
+        */
+        void generate(const Desc& desc);
+
+        const std::vector<GeneratedLight>& getLights() const { return mLights; }
+        const Desc& getDesc() const { return mDesc; }
+
+        /** Add the generated lights to a scene
+        */
+        void addToScene(Scene* pScene) const;
+
+        /** Write the generated lights as an .fscene containing only a lights section, to be included by other scenes
+        */
+        bool writeLightsFile(const std::string& filename);
+
+        /** Write a copy of an .fscene which includes a lights file written by writeLightsFile().
+            Relative paths in the scene are resolved from the new file's directory, so it is usually written next to the source scene.
+        */
+        static bool writeSceneWithLights(const std::string& sourceScene, const std::string& filename, const std::string& lightsFile);
+
+        const Stats& getStats() const { return mStats; }
+
+        /** Get a one-line summary of the stats, for logging
+        */
+        std::string getStatsString() const;
+
+    private:
+        LightScatterer() = default;
+
+        struct SurfacePoint
+        {
+            glm::vec3 position;
+            glm::vec3 normal;
+        };
+
+        /** Area distribution of the triangles of a mesh, in leaf order. Instances scale it by their transform.
+        */
+        struct MeshDistribution
+        {
+            std::vector<float> cdf;                     ///< Running sum of the triangle areas
+            std::vector<uint32_t> triangleOfPrimitive;  ///< Leaf-order triangle of each index-buffer triangle, to find the triangles the BVH hits
+        };
+
+        template<typename Rng> SurfacePoint sampleSurface(Rng& rng) const;
+        SurfacePoint getSurfacePoint(uint32_t instanceId, uint32_t triangle, float u, float v) const;
+        template<typename Rng> SurfacePoint sampleCluster(Rng& rng, const SurfacePoint& center) const;
+        template<typename Rng> glm::vec3 sampleIntensity(Rng& rng) const;
+
+        SceneBvh::SharedConstPtr mpBvh;
+        float mSceneRadius = 1.0f;
+        std::vector<MeshDistribution> mMeshDistributions;
+        std::vector<double> mInstanceCdf;               ///< Running sum of the instances' world-space areas
+        std::vector<SurfacePoint> mClusterCenters;
+        std::vector<GeneratedLight> mLights;
+        Desc mDesc;
+        Stats mStats;
+    };
+}
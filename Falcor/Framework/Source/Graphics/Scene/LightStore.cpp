@@ -0,0 +1,217 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "LightStore.h"
+#include "Utils/CpuTimer.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    namespace
+    {
+        const char* kLightBufferName = "gLights";
+
+        // Dirty lights separated by at most this many clean ones are uploaded as a single range
+        const uint32_t kMaxRangeGap = 4;
+
+        // Capacity of a new buffer, and growth factor when the lights outgrow it
+        const uint32_t kMinCapacity = 64;
+        const float kGrowthFactor = 1.5f;
+    }
+
+    LightStore::SharedPtr LightStore::create(const ReflectionResourceType::SharedConstPtr& pBufferType)
+    {
+        if (pBufferType == nullptr || pBufferType->getType() != ReflectionResourceType::Type::StructuredBuffer)
+        {
+            logError("LightStore::create() - the light buffer must be a structured buffer");
+            return nullptr;
+        }
+
+        if (pBufferType->getSize() != sizeof(LightData))
+        {
+            logError("LightStore::create() - the light buffer's element is " + std::to_string(pBufferType->getSize()) + " bytes, but LightData is " + std::to_string(sizeof(LightData)) + " bytes");
+            return nullptr;
+        }
+
+        return SharedPtr(new LightStore(pBufferType));
+    }
+
+    void LightStore::uploadRange(uint32_t first, uint32_t count)
+    {
+        // Setting the blob marks the buffer dirty and uploadToGPU() clears it, so binding the buffer never uploads all of it again
+        size_t offset = first * sizeof(LightData);
+        size_t size = count * sizeof(LightData);
+        mpBuffer->setBlob(&mStaging[first], offset, size);
+        mpBuffer->uploadToGPU(offset, size);
+
+        mUpdateStats.uploadRangeCount++;
+        mUpdateStats.uploadedBytes += size;
+    }
+
+    bool LightStore::update(const std::vector<Light::SharedPtr>& lights)
+    {
+        auto start = CpuTimer::getCurrentTimePoint();
+        UpdateStats& stats = mUpdateStats;
+        stats = UpdateStats();
+        stats.lightCount = (uint32_t)lights.size();
+
+        if (mpBuffer == nullptr || lights.size() > mpBuffer->getElementCount())
+        {
+            size_t capacity = mpBuffer ? (size_t)(mpBuffer->getElementCount() * kGrowthFactor) : kMinCapacity;
+            capacity = std::max(capacity, lights.size());
+            mpBuffer = StructuredBuffer::create(kLightBufferName, mpBufferType, capacity, Resource::BindFlags::ShaderResource);
+            stats.reallocated = true;
+            mFullUpload = true;
+        }
+
+        // Find the changed lights, and remember them as ranges to upload once the comparison is done.
+        // A light whose stamp didn't change wasn't set since the last update. No two lights share a stamp, so this also catches a different light at the same index.
+        // The staging copy is compared even when everything is uploaded, so only lights whose data changed are reported to the passes.
+        const uint32_t lightCount = (uint32_t)lights.size();
+        const uint32_t comparedCount = std::min((uint32_t)mStaging.size(), lightCount);
+        mVersion++;
+        mStaging.resize(lightCount);
+        mLightVersions.resize(lightCount);
+        mChangeStamps.resize(lightCount);
+        mDirtyRanges.clear();
+        mChangedLights.clear();
+        for (uint32_t i = 0; i < comparedCount; i++)
+        {
+            const uint64_t stamp = lights[i]->getChangeStamp();
+            if (stamp == mChangeStamps[i])
+            {
+                continue;
+            }
+            mChangeStamps[i] = stamp;
+            stats.comparedLightCount++;
+
+            const LightData& data = lights[i]->getData();
+            if (std::memcmp(&mStaging[i], &data, sizeof(LightData)) != 0)
+            {
+                mStaging[i] = data;
+                mLightVersions[i] = mVersion;
+                mChangedLights.push_back(i);
+
+                if (mDirtyRanges.empty() || (i > mDirtyRanges.back().first + mDirtyRanges.back().count + kMaxRangeGap))
+                {
+                    mDirtyRanges.push_back({ i, 1 });
+                }
+                else
+                {
+                    mDirtyRanges.back().count = i - mDirtyRanges.back().first + 1;
+                }
+            }
+        }
+
+        // Lights added since the last update, such as the ones a scene adds in bulk at load time, are copied without comparing and uploaded as one range
+        if (lightCount > comparedCount)
+        {
+            for (uint32_t i = comparedCount; i < lightCount; i++)
+            {
+                mStaging[i] = lights[i]->getData();
+                mChangeStamps[i] = lights[i]->getChangeStamp();
+                mLightVersions[i] = mVersion;
+                mChangedLights.push_back(i);
+            }
+
+            if (mDirtyRanges.empty() || (comparedCount > mDirtyRanges.back().first + mDirtyRanges.back().count + kMaxRangeGap))
+            {
+                mDirtyRanges.push_back({ comparedCount, lightCount - comparedCount });
+            }
+            else
+            {
+                mDirtyRanges.back().count = lightCount - mDirtyRanges.back().first;
+            }
+        }
+        stats.dirtyLightCount = (uint32_t)mChangedLights.size();
+
+        if (mFullUpload)
+        {
+            mDirtyRanges.clear();
+            if (lightCount > 0)
+            {
+                mDirtyRanges.push_back({ 0, lightCount });
+            }
+            mFullUpload = false;
+        }
+
+        auto compared = CpuTimer::getCurrentTimePoint();
+        for (const auto& range : mDirtyRanges)
+        {
+            uploadRange(range.first, range.count);
+        }
+
+        stats.compareTimeMs = CpuTimer::calcDuration(start, compared);
+        stats.uploadTimeMs = CpuTimer::calcDuration(compared, CpuTimer::getCurrentTimePoint());
+        return stats.reallocated;
+    }
+
+    void LightStore::invalidate()
+    {
+        // Stamps start at 1, so every light is compared
+        std::fill(mChangeStamps.begin(), mChangeStamps.end(), 0);
+        mFullUpload = true;
+    }
+
+    void LightStore::getChangedLightsSince(uint64_t version, std::vector<uint32_t>& indices) const
+    {
+        indices.clear();
+        if (version >= mVersion)
+        {
+            return;
+        }
+
+        // The last update's list is already at hand, and is what passes running every frame ask for
+        if (version + 1 == mVersion)
+        {
+            indices = mChangedLights;
+            return;
+        }
+
+        for (uint32_t i = 0; i < (uint32_t)mLightVersions.size(); i++)
+        {
+            if (mLightVersions[i] > version)
+            {
+                indices.push_back(i);
+            }
+        }
+    }
+
+    std::string LightStore::getUpdateStatsString() const
+    {
+        const UpdateStats& s = mUpdateStats;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "LightStore: " << s.dirtyLightCount << " of " << s.lightCount << " lights changed (" << s.comparedLightCount << " compared), uploaded " << s.uploadedBytes / 1024.0 << " KB in "
+           << s.uploadRangeCount << " ranges" << (s.reallocated ? " to a new buffer" : "") << ". Compare " << s.compareTimeMs << " ms, upload " << s.uploadTimeMs << " ms";
+        return ss.str();
+    }
+}
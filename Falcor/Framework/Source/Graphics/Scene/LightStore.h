@@ -0,0 +1,130 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "API/StructuredBuffer.h"
+#include "Graphics/Light.h"
+
+namespace Falcor
+{
+    /** Keeps the LightData of a set of lights in a GPU structured buffer of any size, declared in ShaderCommon.slang as gLights.
+        On each update(), only the lights whose change stamp differs from the last update() are compared with a CPU staging copy of the buffer,
+        and only the ranges that changed are uploaded. The buffer grows as lights are added, and is never shrunk.
+        The scene owns a store, which it updates once per frame, so the changed lights are the same for every pass rendering the frame.
+        Every update() also records which light indices changed, and gives each index the version of the update that last changed it, so passes keeping
+        per-light state across frames, such as temporal reservoirs, can revalidate only the lights that changed instead of discarding everything.
+    */
+    class LightStore
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightStore>;
+        using SharedConstPtr = std::shared_ptr<const LightStore>;
+
+        /** What the last update() did
+        */
+        struct UpdateStats
+        {
+            uint32_t lightCount = 0;
+            uint32_t comparedLightCount = 0;    ///< Lights whose change stamp changed, and whose data was compared
+            uint32_t dirtyLightCount = 0;       ///< Lights whose data changed
+            uint32_t uploadRangeCount = 0;      ///< Contiguous ranges uploaded. Nearby dirty lights share a range.
+            uint64_t uploadedBytes = 0;
+            bool reallocated = false;           ///< The buffer was recreated, and has to be bound again
+            double compareTimeMs = 0;           ///< Finding the changed lights and copying them to the staging array
+            double uploadTimeMs = 0;            ///< CPU time of queuing the uploads
+        };
+
+        /** Create a store
+            \param[in] pBufferType The reflection of the structured buffer in the programs which use it
+            \return A new object, or nullptr if the buffer's element doesn't match LightData
+        */
+        static SharedPtr create(const ReflectionResourceType::SharedConstPtr& pBufferType);
+
+        /** Bring the buffer up to date with a set of lights
+            \return Whether the buffer was recreated. In that case it needs to be bound again.
+        */
+        bool update(const std::vector<Light::SharedPtr>& lights);
+
+        /** Compare and upload all the lights on the next update(), including the ones changed without a new change stamp.
+            The lights are only reported as changed if their data did change.
+        */
+        void invalidate();
+
+        const StructuredBuffer::SharedPtr& getBuffer() const { return mpBuffer; }
+        uint32_t getLightCount() const { return (uint32_t)mStaging.size(); }
+
+        /** Get the number of update() calls so far. Lights changed by the last update() have this version.
+        */
+        uint64_t getVersion() const { return mVersion; }
+
+        /** Get the version of the update() which last changed a light, or 0 if the index is not a light of the last update()
+        */
+        uint64_t getLightVersion(uint32_t index) const { return index < mLightVersions.size() ? mLightVersions[index] : 0; }
+
+        /** Get the indices of the lights which changed in the last update(), in increasing order. Lights added by it are included.
+            Removed lights are not listed: indices at or above getLightCount() are no longer valid.
+        */
+        const std::vector<uint32_t>& getChangedLights() const { return mChangedLights; }
+
+        /** Get the indices of the lights which changed after a version, for passes which don't run every frame
+            \param[in] version A value previously returned by getVersion()
+            \param[out] indices The changed lights, in increasing order
+        */
+        void getChangedLightsSince(uint64_t version, std::vector<uint32_t>& indices) const;
+
+        const UpdateStats& getUpdateStats() const { return mUpdateStats; }
+
+        /** Get a one-line summary of the last update(), for logging
+        */
+        std::string getUpdateStatsString() const;
+
+    private:
+        LightStore(const ReflectionResourceType::SharedConstPtr& pBufferType) : mpBufferType(pBufferType) {}
+
+        struct Range
+        {
+            uint32_t first;
+            uint32_t count;
+        };
+
+        void uploadRange(uint32_t first, uint32_t count);
+
+        ReflectionResourceType::SharedConstPtr mpBufferType;
+        StructuredBuffer::SharedPtr mpBuffer;
+        std::vector<LightData> mStaging;        ///< The lights as last uploaded
+        std::vector<Range> mDirtyRanges;        ///< Scratch space of update()
+        std::vector<uint32_t> mChangedLights;   ///< Lights changed by the last update()
+        std::vector<uint64_t> mLightVersions;   ///< Version of the update() which last changed each light
+        std::vector<uint64_t> mChangeStamps;    ///< Change stamp of each light as last compared
+        uint64_t mVersion = 0;
+        bool mFullUpload = true;
+        UpdateStats mUpdateStats;
+    };
+}
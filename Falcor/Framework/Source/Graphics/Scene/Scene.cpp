@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "Scene.h"
 #include "SceneImporter.h"
+#include "Utils/Profiler.h"
 #include "glm/gtx/euler_angles.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -37,7 +38,7 @@ namespace Falcor
 
     const Scene::UserVariable Scene::kInvalidVar;
 
-    const char* Scene::kFileFormatString = "Scene files\0*.fscene\0\0";
+    const char* Scene::kFileFormatString = "Scene files\0*.fscene;*.fbscene\0\0";
 
     Scene::SharedPtr Scene::loadFromFile(const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags)
     {
@@ -124,6 +125,18 @@ namespace Falcor
 
         mExtentsDirty = mExtentsDirty || changed;
 
+        if (mUseTransformStore)
+        {
+            updateTransformStore();
+        }
+
+        if (mpLightStore)
+        {
+            PROFILE(updateLights);
+            mpLightStore->update(mpLights);
+            mLightStoreGeneration = mLightsGeneration;
+        }
+
         if (getCameraCount() > 0)
         {
             getActiveCamera()->beginFrame();
@@ -140,16 +153,170 @@ namespace Falcor
         return changed;
     }
 
+    const LightStore::SharedPtr& Scene::createLightStore(const ReflectionResourceType::SharedConstPtr& pBufferType)
+    {
+        if (mpLightStore == nullptr)
+        {
+            mpLightStore = LightStore::create(pBufferType);
+            if (mpLightStore)
+            {
+                mpLightStore->update(mpLights);
+                mLightStoreGeneration = mLightsGeneration;
+            }
+        }
+        return mpLightStore;
+    }
+
+    void Scene::syncLightStore()
+    {
+        if (isLightStoreCurrent() == false)
+        {
+            mpLightStore->update(mpLights);
+            mLightStoreGeneration = mLightsGeneration;
+        }
+    }
+
+    static uint32_t getModelMeshInstanceCount(const Model* pModel)
+    {
+        uint32_t count = 0;
+        for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            count += pModel->getMeshInstanceCount(meshID);
+        }
+        return count;
+    }
+
+    void Scene::toggleTransformStore(bool enable)
+    {
+        mUseTransformStore = enable;
+        if (enable == false)
+        {
+            mpTransformStore = nullptr;
+            mpTransformChanges = nullptr;
+            mTransformModelInstances.clear();
+            mTransformMeshInstances.clear();
+        }
+    }
+
+    void Scene::updateTransformStore()
+    {
+        PROFILE(updateTransforms);
+        if (isTransformStoreCurrent())
+        {
+            // The instances pushed the nodes whose transform changed since the last update. Skinned meshes keep the identity, so they never push.
+            const uint32_t rootCount = (uint32_t)mTransformModelInstances.size();
+            for (uint32_t node : mpTransformChanges->getIndices())
+            {
+                if (node < rootCount)
+                {
+                    const ModelInstance* pInstance = mTransformModelInstances[node].get();
+                    mpTransformStore->setLocalMatrix(node, pInstance->getTransformMatrix(), pInstance->getPrevTransformMatrix());
+                }
+                else if (node - rootCount < mTransformMeshInstances.size())
+                {
+                    const Model::MeshInstance* pMeshInstance = mTransformMeshInstances[node - rootCount].get();
+                    mpTransformStore->setLocalMatrix(node, pMeshInstance->getTransformMatrix(), pMeshInstance->getPrevTransformMatrix());
+                }
+            }
+            mpTransformChanges->clear();
+            mpTransformStore->update();
+            return;
+        }
+
+        // Instances were added or removed, so rebuild the hierarchy. The model instances are the roots, and their mesh instances are their children.
+        // The registrations with the previous change list expire with it.
+        if (mpTransformStore == nullptr)
+        {
+            mpTransformStore = TransformStore::create();
+        }
+        mpTransformStore->clear();
+        mpTransformChanges = TransformChangeList::create();
+        mTransformModelInstances.clear();
+        mTransformMeshInstances.clear();
+
+        // The instances give both matrices, so the store's previous-world matrices match what the renderers compute without it
+        uint32_t node = 0;
+        for (uint32_t modelID = 0; modelID < getModelCount(); modelID++)
+        {
+            for (uint32_t instanceID = 0; instanceID < getModelInstanceCount(modelID); instanceID++)
+            {
+                const ModelInstance::SharedPtr& pInstance = getModelInstance(modelID, instanceID);
+                mpTransformStore->addNode(pInstance->getTransformMatrix(), pInstance->getPrevTransformMatrix(), TransformStore::kInvalidNode);
+                pInstance->addTransformChangeList(mpTransformChanges, node++);
+                mTransformModelInstances.push_back(pInstance);
+            }
+        }
+
+        // Skinned meshes are already in model space, so their mesh instances use the model instance's transform
+        const glm::mat4 identity;
+        uint32_t root = 0;
+        for (uint32_t modelID = 0; modelID < getModelCount(); modelID++)
+        {
+            const Model* pModel = getModel(modelID).get();
+            for (uint32_t instanceID = 0; instanceID < getModelInstanceCount(modelID); instanceID++, root++)
+            {
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    const bool hasBones = pModel->getMesh(meshID)->hasBones();
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        if (hasBones)
+                        {
+                            mpTransformStore->addNode(identity, identity, root);
+                            mTransformMeshInstances.push_back(nullptr);
+                        }
+                        else
+                        {
+                            // The model's mesh instances are shared by all its instances, so each of them is registered once per model instance
+                            const Model::MeshInstance::SharedPtr& pMeshInstance = pModel->getMeshInstance(meshID, meshInstanceID);
+                            mpTransformStore->addNode(pMeshInstance->getTransformMatrix(), pMeshInstance->getPrevTransformMatrix(), root);
+                            pMeshInstance->addTransformChangeList(mpTransformChanges, node);
+                            mTransformMeshInstances.push_back(pMeshInstance);
+                        }
+                        node++;
+                    }
+                }
+            }
+        }
+
+        mTransformStoreGeneration = mInstanceGeneration;
+        mTransformStoreMeshVersion = getMeshInstanceVersionSum();
+        mpTransformStore->update();
+    }
+
+    uint32_t Scene::getMeshInstanceVersionSum() const
+    {
+        uint32_t sum = 0;
+        for (uint32_t modelID = 0; modelID < getModelCount(); modelID++)
+        {
+            sum += getModel(modelID)->getMeshInstanceVersion();
+        }
+        return sum;
+    }
+
+    bool Scene::isTransformStoreCurrent() const
+    {
+        if (mUseTransformStore == false || mpTransformStore == nullptr)
+        {
+            return false;
+        }
+
+        // Adding or removing model instances bumps the scene's generation, and changing the mesh instances of a model bumps its version
+        return (mTransformStoreGeneration == mInstanceGeneration) && (mTransformStoreMeshVersion == getMeshInstanceVersionSum());
+    }
+
     void Scene::deleteModel(uint32_t modelID)
     {
         // Delete entire vector of instances
         mModels.erase(mModels.begin() + modelID);
+        mInstanceGeneration++;
         mExtentsDirty = true;
     }
 
     void Scene::deleteAllModels()
     {
         mModels.clear();
+        mInstanceGeneration++;
         mExtentsDirty = true;
     }
 
@@ -174,6 +341,7 @@ namespace Falcor
             if (getModel(modelID) == pInstance->getObject())
             {
                 mModels[modelID].push_back(pInstance);
+                mInstanceGeneration++;
                 return;
             }
         }
@@ -181,6 +349,7 @@ namespace Falcor
         // If not found, add a new list
         mModels.emplace_back();
         mModels.back().push_back(pInstance);
+        mInstanceGeneration++;
         mExtentsDirty = true;
     }
 
@@ -200,6 +369,7 @@ namespace Falcor
         {
             //  Erase the instance.
             instances.erase(instances.begin() + instanceID);
+            mInstanceGeneration++;
         }
 
         //  Extents will be dirty in either case.
@@ -246,13 +416,33 @@ namespace Falcor
         }
 
         mpLights.push_back(pLight);
+        mLightsGeneration++;
         mExtentsDirty = true;
         return (uint32_t)mpLights.size() - 1;
     }
 
+    uint32_t Scene::addLights(const std::vector<Light::SharedPtr>& lights)
+    {
+        uint32_t firstID = (uint32_t)mpLights.size();
+        mpLights.reserve(mpLights.size() + lights.size());
+        for (const auto& pLight : lights)
+        {
+            if (pLight->getType() == LightArea)
+            {
+                logWarning("Use Scene::addAreaLight() for area lights.");
+                continue;
+            }
+            mpLights.push_back(pLight);
+        }
+        mLightsGeneration++;
+        mExtentsDirty = true;
+        return firstID;
+    }
+
     void Scene::deleteLight(uint32_t lightID)
     {
         mpLights.erase(mpLights.begin() + lightID);
+        mLightsGeneration++;
         mExtentsDirty = true;
     }
 
@@ -320,6 +510,8 @@ namespace Falcor
         merge(mCameras);
 #undef merge
         mUserVars.insert(pFrom->mUserVars.begin(), pFrom->mUserVars.end());
+        mLightsGeneration++;
+        mInstanceGeneration++;
         mExtentsDirty = true;
     }
 
@@ -37,6 +37,8 @@
 #include "Graphics/Paths/ObjectPath.h"
 #include "Graphics/Model/ObjectInstance.h"
 #include "Graphics/Model/SkinningCache.h"
+#include "Graphics/Scene/TransformStore.h"
+#include "Graphics/Scene/LightStore.h"
 
 namespace Falcor
 {
@@ -100,6 +102,7 @@ namespace Falcor
         {
             None = 0x0,
             GenerateAreaLights = 0x1,    ///< Create area light(s) for meshes that have emissive material
+            CreateUserAreaLights = 0x2,  ///< Create analytic area lights from the numLights and lN_* values of the user_defined block
         };
 
         static Scene::SharedPtr loadFromFile(const std::string& filename, Model::LoadFlags modelLoadFlags = Model::LoadFlags::None, Scene::LoadFlags sceneLoadFlags = LoadFlags::None);
@@ -123,6 +126,10 @@ namespace Falcor
 
         // Light Sources
         uint32_t addLight(const Light::SharedPtr& pLight);
+        /** Add many lights at once. See addLight().
+            \return The ID of the first light added
+        */
+        uint32_t addLights(const std::vector<Light::SharedPtr>& lights);
         void deleteLight(uint32_t lightID);
         uint32_t getLightCount() const { return (uint32_t)mpLights.size(); }
         const Light::SharedPtr& getLight(uint32_t index) const { return mpLights[index]; }
@@ -168,6 +175,43 @@ namespace Falcor
         // Camera update
         virtual bool update(double currentTime, CameraController* cameraController = nullptr);
 
+        /** Enable/disable the transform store. When enabled, update() keeps the transforms of all the model and mesh instances in a TransformStore,
+            which only recomputes the world matrices of the instances that moved, and the scene renderers read the matrices of their draws from it. Enabled by default.
+            Transforms changed after update() are only seen by the renderers after the next one.
+        */
+        void toggleTransformStore(bool enable);
+        bool isTransformStoreEnabled() const { return mUseTransformStore; }
+
+        /** Get the store holding the instances' transforms, or nullptr if update() was not called with the store enabled yet.
+            Its nodes are the model instances, followed by the mesh instances of every model instance, both in the order the scene renderers visit them.
+            The previous-world matrices are built from the instances' getPrevTransformMatrix(), like the renderers do without the store.
+            Call upload() on it to get the matrices in GPU buffers.
+        */
+        const TransformStore::SharedPtr& getTransformStore() const { return mpTransformStore; }
+
+        /** Check if the transform store holds the scene's current instances. Instances added or removed after update() are only in it after the next one.
+        */
+        bool isTransformStoreCurrent() const;
+
+        /** Create the store keeping the lights on the GPU, if there isn't one yet. The renderers call it with the reflection of the gLights buffer of their programs.
+            The lights are uploaded when it's created, and update() uploads the ones that changed once per frame, so all the renderers of the scene share a single buffer.
+            \return The store, or nullptr if the buffer's element doesn't match LightData
+        */
+        const LightStore::SharedPtr& createLightStore(const ReflectionResourceType::SharedConstPtr& pBufferType);
+
+        /** Get the store holding the lights on the GPU, or nullptr if no renderer created it yet. Lights changed after update() are only uploaded by the next one.
+        */
+        const LightStore::SharedPtr& getLightStore() const { return mpLightStore; }
+
+        /** Check if the light store holds the scene's current set of lights. Lights added or removed after update() are only in it after the next update() or syncLightStore().
+        */
+        bool isLightStoreCurrent() const { return mpLightStore == nullptr || mLightStoreGeneration == mLightsGeneration; }
+
+        /** Upload the lights now if lights were added or removed since the store was last updated. The renderers call it before binding gLights, so gLightsCount
+            always matches the scene's lights. Changes to the existing lights are still uploaded once per frame, by update().
+        */
+        void syncLightStore();
+
         // User variables
         uint32_t getVersion() const { return mVersion; }
         void setVersion(uint32_t version) { mVersion = version; }
@@ -237,6 +281,12 @@ namespace Falcor
         */
         void updateExtents();
 
+        /** Bring the transform store up to date with the instances. Called by update().
+            The hierarchy is only rebuilt when instances were added or removed. Otherwise only the nodes of the instances which pushed a change are refreshed.
+        */
+        void updateTransformStore();
+        uint32_t getMeshInstanceVersionSum() const;
+
         static uint32_t sSceneCounter;
 
         uint32_t mId;
@@ -260,6 +310,19 @@ namespace Falcor
 
         bool mExtentsDirty = true;
 
+        bool mUseTransformStore = true;
+        TransformStore::SharedPtr mpTransformStore;
+        TransformChangeList::SharedPtr mpTransformChanges;                      ///< Nodes of the instances whose transform changed since the last update
+        std::vector<ModelInstance::SharedPtr> mTransformModelInstances;         ///< Instance of each root node
+        std::vector<Model::MeshInstance::SharedPtr> mTransformMeshInstances;    ///< Instance of each mesh node, following the roots. nullptr for skinned meshes.
+        uint32_t mInstanceGeneration = 0;           ///< Incremented when model instances are added or removed
+        uint32_t mTransformStoreGeneration = 0;     ///< mInstanceGeneration when the store's hierarchy was built
+        uint32_t mTransformStoreMeshVersion = 0;    ///< Sum of the models' mesh instance versions when the store's hierarchy was built
+
+        LightStore::SharedPtr mpLightStore;
+        uint32_t mLightsGeneration = 0;         ///< Incremented when lights are added or removed
+        uint32_t mLightStoreGeneration = 0;     ///< mLightsGeneration when the light store was last updated
+
         std::string mFilename;
 
         using string_uservar_map = std::map<const std::string, UserVariable>;
@@ -276,6 +339,7 @@ namespace Falcor
         {
             flag_str(None);
             flag_str(GenerateAreaLights);
+            flag_str(CreateUserAreaLights);
         default:
             should_not_get_here();
             return "";
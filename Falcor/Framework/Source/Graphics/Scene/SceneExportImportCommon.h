@@ -32,10 +32,10 @@ namespace Falcor
 {
     namespace SceneKeys
     {
-        // Values only used in the importer
-#ifdef SCENE_IMPORTER
         static const char* kInclude = "include";
 
+        // Values only used in the importer
+#ifdef SCENE_IMPORTER
         // Not supported in exporter yet
         static const char* kLightProbes = "light_probes";
         static const char* kLightProbeRadius = "radius";
@@ -46,6 +46,14 @@ namespace Falcor
         static const char* kCamFovY = "fovY";
         static const char* kActivePath = "active_path";
         static const char* kAmbientIntensity = "ambient_intensity";
+
+        // Rectangular area lights described in the user-defined section, as a light count and a set of "l<index>_<value>" values per light
+        static const char* kUserAreaLightCount = "numLights";
+        static const char* kUserAreaLightPower = "power";
+        static const char* kUserAreaLightExtent = "extent";
+        static const char* kUserAreaLightCenter = "center";
+        static const char* kUserAreaLightLeft = "left";
+        static const char* kUserAreaLightUp = "up";
 #endif
 
         // Values currently only used in the exporter
@@ -30,8 +30,10 @@
 
 #include "Framework.h"
 #include "SceneExporter.h"
+#include "ScenePackage.h"
 #include <fstream>
 #include "Utils/Platform/OS.h"
+#include "Utils/StringUtils.h"
 #include "Graphics/Scene/Editor/SceneEditor.h"
 
 #define SCENE_EXPORTER
@@ -45,6 +47,16 @@ namespace Falcor
 
     bool SceneExporter::saveScene(const std::string& filename, const Scene::SharedPtr& pScene, uint32_t exportOptions)
     {
+        if (hasSuffix(filename, ScenePackage::kFileExtension, false))
+        {
+            ScenePackage::Desc desc;
+            desc.exportOptions = exportOptions;
+            ScenePackage::Stats stats;
+            if (ScenePackage::write(filename, pScene, desc, &stats) == false) return false;
+            logInfo(ScenePackage::getStatsString(stats));
+            return true;
+        }
+
         SceneExporter exporter(filename, pScene);
         return exporter.save(exportOptions);
     }
@@ -53,6 +53,8 @@ namespace Falcor
             ExportAll = 0xFFFFFFFF
         };
 
+        /** Save a scene. Files with the ScenePackage::kFileExtension extension are written as binary scene packages, others as JSON.
+        */
         static bool saveScene(const std::string& filename, const Scene::SharedPtr& pScene, uint32_t exportOptions = ExportAll);
 
         static const uint32_t kVersion = 2;
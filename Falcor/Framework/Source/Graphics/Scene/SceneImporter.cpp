@@ -29,7 +29,9 @@
 #include "SceneImporter.h"
 #include "rapidjson/error/en.h"
 #include "Scene.h"
+#include "ScenePackage.h"
 #include "Utils/Platform/OS.h"
+#include "Utils/StringUtils.h"
 #include <sstream>
 #include <fstream>
 #include <algorithm>
@@ -439,17 +441,7 @@ namespace Falcor
             }
         }
 
-        if (isNameDuplicate(pPointLight->getName(), mLightMap, "lights"))
-        {
-            return false;
-        }
-        else
-        {
-            mLightMap[pPointLight->getName()] = pPointLight;
-            mScene.addLight(pPointLight);
-        }
-
-        return true;
+        return addLight(pPointLight);
     }
 
     // Support for analytic area lights
@@ -537,15 +529,23 @@ namespace Falcor
         glm::mat4 composite = translationMtx * rotationMtx;
         pAreaLight->setTransformMatrix(composite);
 
-        if (isNameDuplicate(pAreaLight->getName(), mLightMap, "lights"))
-        {
-            return false;
-        }
-        else
+        return addLight(pAreaLight);
+    }
+
+    bool SceneImporter::addLight(const Light::SharedPtr& pLight)
+    {
+        // Unnamed lights can't be attached to paths, so they are not tracked. Scenes with many lights usually leave them unnamed, and they would all collide on the empty name.
+        const std::string& name = pLight->getName();
+        if (name.empty() == false)
         {
-            mLightMap[pAreaLight->getName()] = pAreaLight;
-            mScene.addLight(pAreaLight);
+            if (isNameDuplicate(name, mLightMap, "lights"))
+            {
+                return false;
+            }
+            mLightMap[name] = pLight;
         }
+
+        mScene.addLight(pLight);
         return true;
     }
 
@@ -996,6 +996,23 @@ namespace Falcor
 
         if (findFileInDataDirectories(filename, fullpath))
         {
+            // Binary packages hold everything the JSON file would, they are loaded without parsing it
+            if (hasSuffix(fullpath, ScenePackage::kFileExtension, false))
+            {
+                ScenePackage::Stats stats;
+                if (ScenePackage::read(mScene, fullpath, mModelLoadFlags, 0, &stats) == false)
+                {
+                    return error("Can't load the scene package.");
+                }
+                logInfo(ScenePackage::getStatsString(stats));
+
+                if (is_set(mSceneLoadFlags, Scene::LoadFlags::GenerateAreaLights))
+                {
+                    mScene.createAreaLights();
+                }
+                return true;
+            }
+
             // Load the file
             std::string jsonData = readFile(fullpath);
             rapidjson::StringStream JStream(jsonData.c_str());
@@ -1215,9 +1232,76 @@ namespace Falcor
             }
             mScene.addUserVariable(name, userVar);
         }
+
+        if (is_set(mSceneLoadFlags, Scene::LoadFlags::CreateUserAreaLights))
+        {
+            createUserDefinedAreaLights(jsonVal);
+        }
         return true;
     }
 
+    void SceneImporter::createUserDefinedAreaLights(const rapidjson::Value& jsonVal)
+    {
+        // The lights are described by their power, their width and height, and their center and edge directions. They emit along cross(left, up).
+        auto count = jsonVal.FindMember(SceneKeys::kUserAreaLightCount);
+        if (count == jsonVal.MemberEnd() || count->value.IsUint() == false)
+        {
+            return;
+        }
+
+        auto getVec = [&jsonVal](const std::string& key, float* pVec, uint32_t size)
+        {
+            auto it = jsonVal.FindMember(key.c_str());
+            if (it == jsonVal.MemberEnd() || it->value.IsArray() == false || it->value.Size() != size) return false;
+            for (uint32_t i = 0; i < size; i++)
+            {
+                if (it->value[i].IsNumber() == false) return false;
+                pVec[i] = (float)it->value[i].GetDouble();
+            }
+            return true;
+        };
+
+        std::vector<Light::SharedPtr> lights;
+        lights.reserve(count->value.GetUint());
+        for (uint32_t i = 0; i < count->value.GetUint(); i++)
+        {
+            const std::string prefix = "l" + std::to_string(i) + "_";
+            glm::vec3 power, center, left, up;
+            glm::vec2 extent;
+            if (!getVec(prefix + SceneKeys::kUserAreaLightPower, &power[0], 3) || !getVec(prefix + SceneKeys::kUserAreaLightExtent, &extent[0], 2) ||
+                !getVec(prefix + SceneKeys::kUserAreaLightCenter, &center[0], 3) || !getVec(prefix + SceneKeys::kUserAreaLightLeft, &left[0], 3) ||
+                !getVec(prefix + SceneKeys::kUserAreaLightUp, &up[0], 3))
+            {
+                logWarning("User defined area light " + std::to_string(i) + " is missing values or has values of the wrong size. Skipping it.");
+                continue;
+            }
+
+            // Make the edge directions orthonormal, keeping the left direction
+            float leftLength = glm::length(left);
+            up -= left * (glm::dot(up, left) / std::max(leftLength * leftLength, 1e-12f));
+            float upLength = glm::length(up);
+            if (leftLength < 1e-6f || upLength < 1e-6f || extent.x <= 0 || extent.y <= 0)
+            {
+                logWarning("User defined area light " + std::to_string(i) + " has a degenerate shape. Skipping it.");
+                continue;
+            }
+            left /= leftLength;
+            up /= upLength;
+
+            auto pAreaLight = AnalyticAreaLight::create();
+            pAreaLight->setName(prefix + "area_light");
+            pAreaLight->setScaling(glm::vec3(0.5f * extent, 1.0f));
+            pAreaLight->setTransformMatrix(glm::mat4(glm::vec4(left, 0), glm::vec4(up, 0), glm::vec4(glm::cross(left, up), 0), glm::vec4(center, 1)));
+
+            // The power is emitted from one side. See AnalyticAreaLight::getPower().
+            pAreaLight->setIntensity(power / ((float)M_PI * extent.x * extent.y));
+            lights.push_back(pAreaLight);
+        }
+
+        // Scenes may describe many of these, so add them at once. They are not tracked by name, so they can't be attached to paths.
+        mScene.addLights(lights);
+    }
+
     bool SceneImporter::loadIncludeFile(const std::string& include)
     {
         // Find the file
@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <unordered_map>
 #include "rapidjson/document.h"
 #include "Graphics/Material/Material.h"
 #include "glm/vec2.hpp"
@@ -70,6 +71,8 @@ namespace Falcor
         bool createPointLight(const rapidjson::Value& jsonLight);
         bool createDirLight(const rapidjson::Value& jsonLight);
         bool createAnalyticAreaLight(const rapidjson::Value& jsonLight);
+        void createUserDefinedAreaLights(const rapidjson::Value& jsonVal);
+        bool addLight(const Light::SharedPtr& pLight);
         ObjectPath::SharedPtr createPath(const rapidjson::Value& jsonPath);
         bool createPathFrames(ObjectPath* pPath, const rapidjson::Value& jsonFramesArray);
         bool createCamera(const rapidjson::Value& jsonCamera);
@@ -86,7 +89,7 @@ namespace Falcor
         Model::LoadFlags mModelLoadFlags;
         Scene::LoadFlags mSceneLoadFlags;
 
-        using ObjectMap = std::map<std::string, IMovableObject::SharedPtr>;
+        using ObjectMap = std::unordered_map<std::string, IMovableObject::SharedPtr>;
         bool isNameDuplicate(const std::string& name, const ObjectMap& objectMap, const std::string& objectType) const;
         IMovableObject::SharedPtr getMovableObject(const std::string& type, const std::string& name) const;
 
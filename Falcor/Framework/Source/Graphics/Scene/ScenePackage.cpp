@@ -0,0 +1,837 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ScenePackage.h"
+#include "SceneExporter.h"
+#include "Graphics/Model/Loaders/ModelCache.h"
+#include "Utils/Lz4.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/Platform/OS.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <type_traits>
+
+namespace Falcor
+{
+    const char* ScenePackage::kFileExtension = ".fbscene";
+
+    namespace
+    {
+        const uint32_t kFileMagic = 0x4b505346;     // 'FSPK'
+        const uint32_t kFileVersion = 1;
+        const size_t kModelAlignment = 16;          // ModelCache::deserialize() reads its tables in place
+        const uint32_t kMinChunkSize = 64 * 1024;
+
+        // On-disk layout: the header, the chunk table, then the chunks.
+        // Every chunk holds chunkSize bytes of the content once decompressed, except the last one which holds the rest.
+        struct FileHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t chunkSize;
+            uint32_t chunkCount;
+            uint64_t contentSize;
+            uint64_t fileSize;
+        };
+
+        struct ChunkRecord
+        {
+            uint64_t offset;            ///< From the start of the file
+            uint32_t storedSize;        ///< The chunk is stored uncompressed if this is its decompressed size
+            uint32_t reserved;
+        };
+
+        enum class AttachmentType : uint32_t
+        {
+            ModelInstance,
+            Camera,
+            Light,
+        };
+
+        struct Attachment
+        {
+            AttachmentType type;
+            uint32_t index;             ///< Model, camera or light index
+            uint32_t instance;          ///< Model instance index
+        };
+
+        // Content layout. Every section starts with its element count, and strings are stored as a length followed by the characters.
+        //   models:    filename, name, load flags, active animation, embedded flag, [size, padding, ModelCache data], instances (name, translation, target, up, scaling)
+        //   lights:    type, name, intensity, type-specific values
+        //   cameras:   name, position, target, up, focal length, near and far planes, aspect ratio
+        //   paths:     name, repeat, playback mode, key frames, attachments
+        //   variables: name, type, value
+        //   settings:  present flag, camera speed, lighting scale, active camera
+
+        uint32_t resolveThreadCount(uint32_t threadCount)
+        {
+            return threadCount ? threadCount : WorkerPool::get().getThreadCount();
+        }
+
+        // Appends values to the content of a package
+        class ContentWriter
+        {
+        public:
+            template<typename T>
+            void write(const T& value)
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written as-is");
+                writeBytes(&value, sizeof(T));
+            }
+
+            void writeBytes(const void* pData, size_t size)
+            {
+                size_t offset = mData.size();
+                mData.resize(offset + size);
+                if (size) std::memcpy(mData.data() + offset, pData, size);
+            }
+
+            void writeString(const std::string& str)
+            {
+                write((uint32_t)str.size());
+                writeBytes(str.data(), str.size());
+            }
+
+            void align(size_t alignment)
+            {
+                mData.resize((mData.size() + alignment - 1) / alignment * alignment, 0);
+            }
+
+            std::vector<uint8_t>& getData() { return mData; }
+
+        private:
+            std::vector<uint8_t> mData;
+        };
+
+        // Bounds-checked reads from the content of a package. Once a read fails every following read fails too, so errors can be checked once per element.
+        class ContentReader
+        {
+        public:
+            ContentReader(const uint8_t* pData, size_t size) : mpData(pData), mSize(size) {}
+
+            template<typename T>
+            T read()
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read as-is");
+                T value = {};
+                const uint8_t* pSrc = getBytes(sizeof(T));
+                if (pSrc) std::memcpy(&value, pSrc, sizeof(T));
+                return value;
+            }
+
+            const uint8_t* getBytes(size_t size)
+            {
+                if (mValid == false || size > mSize - mOffset)
+                {
+                    mValid = false;
+                    return nullptr;
+                }
+                const uint8_t* pData = mpData + mOffset;
+                mOffset += size;
+                return pData;
+            }
+
+            std::string readString()
+            {
+                uint32_t length = read<uint32_t>();
+                const uint8_t* pChars = getBytes(length);
+                return pChars ? std::string((const char*)pChars, length) : std::string();
+            }
+
+            void align(size_t alignment)
+            {
+                size_t offset = (mOffset + alignment - 1) / alignment * alignment;
+                if (offset > mSize) mValid = false;
+                else mOffset = offset;
+            }
+
+            bool isValid() const { return mValid; }
+            bool isAtEnd() const { return mValid && mOffset == mSize; }
+
+        private:
+            const uint8_t* mpData;
+            size_t mSize;
+            size_t mOffset = 0;
+            bool mValid = true;
+        };
+
+        void writeModels(const Scene* pScene, const ScenePackage::Desc& desc, ContentWriter& writer, ScenePackage::Stats& stats)
+        {
+            uint32_t modelCount = (desc.exportOptions & SceneExporter::ExportModels) ? pScene->getModelCount() : 0;
+            writer.write(modelCount);
+            for (uint32_t modelId = 0; modelId < modelCount; modelId++)
+            {
+                const Model* pModel = pScene->getModel(modelId).get();
+
+                // Like SceneExporter, the shading model of the first mesh decides if the model is loaded with spec-gloss materials
+                Model::LoadFlags flags = desc.modelLoadFlags & ~Model::LoadFlags::UseSpecGlossMaterials;
+                if (pModel->getMeshCount() && pModel->getMesh(0)->getMaterial()->getShadingModel() == ShadingModelSpecGloss)
+                {
+                    flags |= Model::LoadFlags::UseSpecGlossMaterials;
+                }
+
+                writer.writeString(stripDataDirectories(pModel->getFilename()));
+                writer.writeString(pModel->getName());
+                writer.write((uint32_t)flags);
+                writer.write(pModel->hasAnimations() ? (int32_t)pModel->getActiveAnimation() : -1);
+
+                std::vector<uint8_t> modelData;
+                bool embedded = ModelCache::serialize(*pModel, flags, 0, modelData);
+                writer.write((uint32_t)(embedded ? 1 : 0));
+                if (embedded)
+                {
+                    writer.write((uint64_t)modelData.size());
+                    writer.align(kModelAlignment);
+                    writer.writeBytes(modelData.data(), modelData.size());
+                    stats.embeddedModelCount++;
+                }
+                else
+                {
+                    stats.referencedModelCount++;
+                }
+
+                writer.write(pScene->getModelInstanceCount(modelId));
+                for (uint32_t i = 0; i < pScene->getModelInstanceCount(modelId); i++)
+                {
+                    const auto& pInstance = pScene->getModelInstance(modelId, i);
+                    writer.writeString(pInstance->getName());
+                    writer.write(pInstance->getTranslation());
+                    writer.write(pInstance->getTarget());
+                    writer.write(pInstance->getUpVector());
+                    writer.write(pInstance->getScaling());
+                }
+            }
+        }
+
+        // Area lights generated from emissive meshes are not written. Scenes loaded with Scene::LoadFlags::GenerateAreaLights create them again.
+        bool isLightWritten(const Light* pLight)
+        {
+            uint32_t type = pLight->getType();
+            return type == LightPoint || type == LightDirectional || type == LightAreaRect || type == LightAreaSphere || type == LightAreaDisc;
+        }
+
+        void writeLights(const Scene* pScene, const ScenePackage::Desc& desc, ContentWriter& writer, std::map<const Light*, uint32_t>& lightIds)
+        {
+            if (desc.exportOptions & SceneExporter::ExportLights)
+            {
+                for (const auto& pLight : pScene->getLights())
+                {
+                    if (isLightWritten(pLight.get())) lightIds[pLight.get()] = (uint32_t)lightIds.size();
+                }
+            }
+
+            writer.write((uint32_t)lightIds.size());
+            if (lightIds.empty()) return;
+            for (const auto& pLight : pScene->getLights())
+            {
+                if (isLightWritten(pLight.get()) == false) continue;
+
+                writer.write(pLight->getType());
+                writer.writeString(pLight->getName());
+                writer.write(pLight->getData().intensity);
+                switch (pLight->getType())
+                {
+                case LightPoint:
+                {
+                    const PointLight* pPoint = (const PointLight*)pLight.get();
+                    writer.write(pPoint->getWorldPosition());
+                    writer.write(pPoint->getWorldDirection());
+                    writer.write(pPoint->getOpeningAngle());
+                    writer.write(pPoint->getPenumbraAngle());
+                    break;
+                }
+                case LightDirectional:
+                    writer.write(((const DirectionalLight*)pLight.get())->getWorldDirection());
+                    break;
+                default:
+                {
+                    const AnalyticAreaLight* pArea = (const AnalyticAreaLight*)pLight.get();
+                    writer.write(pArea->getScaling());
+                    writer.write(pArea->getTransformMatrix());
+                    break;
+                }
+                }
+            }
+        }
+
+        void writeCameras(const Scene* pScene, const ScenePackage::Desc& desc, ContentWriter& writer)
+        {
+            uint32_t cameraCount = (desc.exportOptions & SceneExporter::ExportCameras) ? pScene->getCameraCount() : 0;
+            writer.write(cameraCount);
+            for (uint32_t i = 0; i < cameraCount; i++)
+            {
+                const auto pCamera = pScene->getCamera(i);
+                writer.writeString(pCamera->getName());
+                writer.write(pCamera->getPosition());
+                writer.write(pCamera->getTarget());
+                writer.write(pCamera->getUpVector());
+                writer.write(pCamera->getFocalLength());
+                writer.write(pCamera->getNearPlane());
+                writer.write(pCamera->getFarPlane());
+                writer.write(pCamera->getAspectRatio());
+            }
+        }
+
+        void writePaths(const Scene* pScene, const ScenePackage::Desc& desc, ContentWriter& writer, const std::map<const Light*, uint32_t>& lightIds)
+        {
+            // Attachments are stored by index. Objects which are not in the package are dropped.
+            std::map<const IMovableObject*, Attachment> attachments;
+            if (desc.exportOptions & SceneExporter::ExportModels)
+            {
+                for (uint32_t modelId = 0; modelId < pScene->getModelCount(); modelId++)
+                {
+                    for (uint32_t i = 0; i < pScene->getModelInstanceCount(modelId); i++)
+                    {
+                        attachments[pScene->getModelInstance(modelId, i).get()] = { AttachmentType::ModelInstance, modelId, i };
+                    }
+                }
+            }
+            if (desc.exportOptions & SceneExporter::ExportCameras)
+            {
+                for (uint32_t i = 0; i < pScene->getCameraCount(); i++) attachments[pScene->getCamera(i).get()] = { AttachmentType::Camera, i, 0 };
+            }
+            for (const auto& light : lightIds) attachments[light.first] = { AttachmentType::Light, light.second, 0 };
+
+            uint32_t pathCount = (desc.exportOptions & SceneExporter::ExportPaths) ? pScene->getPathCount() : 0;
+            writer.write(pathCount);
+            for (uint32_t pathId = 0; pathId < pathCount; pathId++)
+            {
+                const auto& pPath = pScene->getPath(pathId);
+                writer.writeString(pPath->getName());
+                writer.write((uint32_t)(pPath->isRepeatOn() ? 1 : 0));
+                writer.write((uint32_t)pPath->getPlaybackMode());
+
+                writer.write(pPath->getKeyFrameCount());
+                for (uint32_t i = 0; i < pPath->getKeyFrameCount(); i++)
+                {
+                    const auto& frame = pPath->getKeyFrame(i);
+                    writer.write(frame.time);
+                    writer.write(frame.position);
+                    writer.write(frame.target);
+                    writer.write(frame.up);
+                }
+
+                std::vector<Attachment> pathAttachments;
+                for (uint32_t i = 0; i < pPath->getAttachedObjectCount(); i++)
+                {
+                    auto it = attachments.find(pPath->getAttachedObject(i).get());
+                    if (it != attachments.end()) pathAttachments.push_back(it->second);
+                }
+                writer.write((uint32_t)pathAttachments.size());
+                for (const auto& attachment : pathAttachments) writer.write(attachment);
+            }
+        }
+
+        void writeUserVariables(const Scene* pScene, const ScenePackage::Desc& desc, ContentWriter& writer)
+        {
+            uint32_t varCount = (desc.exportOptions & SceneExporter::ExportUserDefined) ? pScene->getUserVariableCount() : 0;
+            writer.write(varCount);
+            for (uint32_t i = 0; i < varCount; i++)
+            {
+                std::string name;
+                const auto& var = pScene->getUserVariable(i, name);
+                writer.writeString(name);
+                writer.write((uint32_t)var.type);
+                switch (var.type)
+                {
+                case Scene::UserVariable::Type::Int:    writer.write(var.i32); break;
+                case Scene::UserVariable::Type::Uint:   writer.write(var.u32); break;
+                case Scene::UserVariable::Type::Int64:  writer.write(var.i64); break;
+                case Scene::UserVariable::Type::Uint64: writer.write(var.u64); break;
+                case Scene::UserVariable::Type::Double: writer.write(var.d64); break;
+                case Scene::UserVariable::Type::String: writer.writeString(var.str); break;
+                case Scene::UserVariable::Type::Vec2:   writer.write(var.vec2); break;
+                case Scene::UserVariable::Type::Vec3:   writer.write(var.vec3); break;
+                case Scene::UserVariable::Type::Vec4:   writer.write(var.vec4); break;
+                case Scene::UserVariable::Type::Bool:   writer.write((uint32_t)(var.b ? 1 : 0)); break;
+                case Scene::UserVariable::Type::Vector:
+                    writer.write((uint32_t)var.vector.size());
+                    writer.writeBytes(var.vector.data(), var.vector.size() * sizeof(float));
+                    break;
+                default:
+                    should_not_get_here();
+                }
+            }
+        }
+
+        void writeSettings(const Scene* pScene, const ScenePackage::Desc& desc, ContentWriter& writer)
+        {
+            bool writeSettings = (desc.exportOptions & SceneExporter::ExportGlobalSettings) != 0;
+            writer.write((uint32_t)(writeSettings ? 1 : 0));
+            if (writeSettings == false) return;
+            writer.write(pScene->getCameraSpeed());
+            writer.write(pScene->getLightingScale());
+            writer.write(pScene->getActiveCameraIndex());
+        }
+
+        bool readModels(Scene& scene, ContentReader& reader, Model::LoadFlags modelLoadFlags, std::vector<std::vector<Scene::ModelInstance::SharedPtr>>& instances, ScenePackage::Stats& stats)
+        {
+            uint32_t modelCount = reader.read<uint32_t>();
+            bool flagsMismatch = false;
+            for (uint32_t modelId = 0; modelId < modelCount && reader.isValid(); modelId++)
+            {
+                std::string filename = reader.readString();
+                std::string name = reader.readString();
+                Model::LoadFlags storedFlags = (Model::LoadFlags)reader.read<uint32_t>();
+                int32_t activeAnimation = reader.read<int32_t>();
+                bool embedded = reader.read<uint32_t>() != 0;
+
+                // Embedded models were processed with the flags they were written with. Only the bind flags of the buffers can change when loading them.
+                Model::LoadFlags flags = modelLoadFlags | (storedFlags & Model::LoadFlags::UseSpecGlossMaterials);
+                Model::LoadFlags bindFlags = Model::LoadFlags::BuffersAsShaderResource;
+                bool flagsMatch = (storedFlags & ~bindFlags) == (flags & ~bindFlags);
+
+                Model::SharedPtr pModel;
+                if (embedded)
+                {
+                    uint64_t size = reader.read<uint64_t>();
+                    reader.align(kModelAlignment);
+                    const uint8_t* pData = reader.getBytes((size_t)size);
+                    if (pData == nullptr) return false;
+                    if (flagsMatch)
+                    {
+                        pModel = Model::createFromCacheData(pData, (size_t)size, filename, flags);
+                        if (pModel == nullptr)
+                        {
+                            logWarning("ScenePackage: The embedded data of model '" + filename + "' is invalid");
+                            return false;
+                        }
+                        stats.embeddedModelCount++;
+                    }
+                    flagsMismatch = flagsMismatch || (flagsMatch == false);
+                }
+
+                if (pModel == nullptr)
+                {
+                    pModel = Model::createFromFile(filename.c_str(), flags);
+                    if (pModel == nullptr)
+                    {
+                        logWarning("ScenePackage: Could not load model '" + filename + "'");
+                        return false;
+                    }
+                    stats.referencedModelCount++;
+                }
+                pModel->setName(name);
+                if (activeAnimation >= 0 && (uint32_t)activeAnimation < pModel->getAnimationsCount()) pModel->setActiveAnimation(activeAnimation);
+
+                uint32_t instanceCount = reader.read<uint32_t>();
+                instances.emplace_back();
+                for (uint32_t i = 0; i < instanceCount && reader.isValid(); i++)
+                {
+                    std::string instanceName = reader.readString();
+                    glm::vec3 translation = reader.read<glm::vec3>();
+                    glm::vec3 target = reader.read<glm::vec3>();
+                    glm::vec3 up = reader.read<glm::vec3>();
+                    glm::vec3 scaling = reader.read<glm::vec3>();
+                    auto pInstance = Scene::ModelInstance::create(pModel, translation, target, up, scaling, instanceName);
+                    scene.addModelInstance(pInstance);
+                    instances.back().push_back(pInstance);
+                }
+            }
+
+            if (flagsMismatch)
+            {
+                logWarning("ScenePackage: Some embedded models were written with other load flags. They were loaded from their source files instead.");
+            }
+            return reader.isValid();
+        }
+
+        bool readLights(Scene& scene, ContentReader& reader, std::vector<Light::SharedPtr>& lights)
+        {
+            uint32_t lightCount = reader.read<uint32_t>();
+            for (uint32_t i = 0; i < lightCount && reader.isValid(); i++)
+            {
+                uint32_t type = reader.read<uint32_t>();
+                std::string name = reader.readString();
+                glm::vec3 intensity = reader.read<glm::vec3>();
+
+                Light::SharedPtr pLight;
+                switch (type)
+                {
+                case LightPoint:
+                {
+                    auto pPoint = PointLight::create();
+                    pPoint->setIntensity(intensity);
+                    pPoint->setWorldPosition(reader.read<glm::vec3>());
+                    pPoint->setWorldDirection(reader.read<glm::vec3>());
+                    pPoint->setOpeningAngle(reader.read<float>());
+                    pPoint->setPenumbraAngle(reader.read<float>());
+                    pLight = pPoint;
+                    break;
+                }
+                case LightDirectional:
+                {
+                    auto pDirectional = DirectionalLight::create();
+                    pDirectional->setIntensity(intensity);
+                    pDirectional->setWorldDirection(reader.read<glm::vec3>());
+                    pLight = pDirectional;
+                    break;
+                }
+                case LightAreaRect:
+                case LightAreaSphere:
+                case LightAreaDisc:
+                {
+                    auto pArea = AnalyticAreaLight::create();
+                    pArea->setType(type);
+                    pArea->setIntensity(intensity);
+                    pArea->setScaling(reader.read<glm::vec3>());
+                    pArea->setTransformMatrix(reader.read<glm::mat4>());
+                    pLight = pArea;
+                    break;
+                }
+                default:
+                    return false;
+                }
+                pLight->setName(name);
+                lights.push_back(pLight);
+            }
+
+            if (reader.isValid() == false) return false;
+            // Scenes may hold many lights, add them at once
+            scene.addLights(lights);
+            return true;
+        }
+
+        bool readCameras(Scene& scene, ContentReader& reader)
+        {
+            uint32_t cameraCount = reader.read<uint32_t>();
+            for (uint32_t i = 0; i < cameraCount && reader.isValid(); i++)
+            {
+                auto pCamera = Camera::create();
+                pCamera->setName(reader.readString());
+                pCamera->setPosition(reader.read<glm::vec3>());
+                pCamera->setTarget(reader.read<glm::vec3>());
+                pCamera->setUpVector(reader.read<glm::vec3>());
+                pCamera->setFocalLength(reader.read<float>());
+                float nearPlane = reader.read<float>();
+                float farPlane = reader.read<float>();
+                pCamera->setDepthRange(nearPlane, farPlane);
+                pCamera->setAspectRatio(reader.read<float>());
+                scene.addCamera(pCamera);
+            }
+            if (cameraCount) scene.setActiveCamera(0);
+            return reader.isValid();
+        }
+
+        bool readPaths(Scene& scene, ContentReader& reader, const std::vector<std::vector<Scene::ModelInstance::SharedPtr>>& instances, const std::vector<Light::SharedPtr>& lights)
+        {
+            uint32_t pathCount = reader.read<uint32_t>();
+            for (uint32_t pathId = 0; pathId < pathCount && reader.isValid(); pathId++)
+            {
+                auto pPath = ObjectPath::create();
+                pPath->setName(reader.readString());
+                pPath->setAnimationRepeat(reader.read<uint32_t>() != 0);
+                uint32_t playback = reader.read<uint32_t>();
+                if (playback > (uint32_t)ObjectPath::Playback::ConstantSpeed) return false;
+                pPath->setPlaybackMode((ObjectPath::Playback)playback);
+
+                uint32_t frameCount = reader.read<uint32_t>();
+                for (uint32_t i = 0; i < frameCount && reader.isValid(); i++)
+                {
+                    float time = reader.read<float>();
+                    glm::vec3 position = reader.read<glm::vec3>();
+                    glm::vec3 target = reader.read<glm::vec3>();
+                    glm::vec3 up = reader.read<glm::vec3>();
+                    pPath->addKeyFrame(time, position, target, up);
+                }
+
+                uint32_t attachmentCount = reader.read<uint32_t>();
+                for (uint32_t i = 0; i < attachmentCount && reader.isValid(); i++)
+                {
+                    Attachment attachment = reader.read<Attachment>();
+                    IMovableObject::SharedPtr pObject;
+                    switch (attachment.type)
+                    {
+                    case AttachmentType::ModelInstance:
+                        if (attachment.index < instances.size() && attachment.instance < instances[attachment.index].size()) pObject = instances[attachment.index][attachment.instance];
+                        break;
+                    case AttachmentType::Camera:
+                        pObject = scene.getCamera(attachment.index);
+                        break;
+                    case AttachmentType::Light:
+                        if (attachment.index < lights.size()) pObject = lights[attachment.index];
+                        break;
+                    }
+                    if (pObject == nullptr) return false;
+                    pPath->attachObject(pObject);
+                }
+                scene.addPath(pPath);
+            }
+            return reader.isValid();
+        }
+
+        bool readUserVariables(Scene& scene, ContentReader& reader)
+        {
+            uint32_t varCount = reader.read<uint32_t>();
+            for (uint32_t i = 0; i < varCount && reader.isValid(); i++)
+            {
+                std::string name = reader.readString();
+                Scene::UserVariable var;
+                var.type = (Scene::UserVariable::Type)reader.read<uint32_t>();
+                switch (var.type)
+                {
+                case Scene::UserVariable::Type::Int:    var.i32 = reader.read<int32_t>(); break;
+                case Scene::UserVariable::Type::Uint:   var.u32 = reader.read<uint32_t>(); break;
+                case Scene::UserVariable::Type::Int64:  var.i64 = reader.read<int64_t>(); break;
+                case Scene::UserVariable::Type::Uint64: var.u64 = reader.read<uint64_t>(); break;
+                case Scene::UserVariable::Type::Double: var.d64 = reader.read<double>(); break;
+                case Scene::UserVariable::Type::String: var.str = reader.readString(); break;
+                case Scene::UserVariable::Type::Vec2:   var.vec2 = reader.read<glm::vec2>(); break;
+                case Scene::UserVariable::Type::Vec3:   var.vec3 = reader.read<glm::vec3>(); break;
+                case Scene::UserVariable::Type::Vec4:   var.vec4 = reader.read<glm::vec4>(); break;
+                case Scene::UserVariable::Type::Bool:   var.b = reader.read<uint32_t>() != 0; break;
+                case Scene::UserVariable::Type::Vector:
+                {
+                    uint32_t size = reader.read<uint32_t>();
+                    const uint8_t* pData = reader.getBytes((size_t)size * sizeof(float));
+                    if (pData == nullptr) return false;
+                    var.vector.resize(size);
+                    if (size) std::memcpy(var.vector.data(), pData, (size_t)size * sizeof(float));
+                    break;
+                }
+                default:
+                    return false;
+                }
+                scene.addUserVariable(name, var);
+            }
+            return reader.isValid();
+        }
+
+        bool readSettings(Scene& scene, ContentReader& reader)
+        {
+            if (reader.read<uint32_t>() == 0) return reader.isValid();
+            float cameraSpeed = reader.read<float>();
+            float lightingScale = reader.read<float>();
+            uint32_t activeCamera = reader.read<uint32_t>();
+            if (reader.isValid() == false) return false;
+
+            scene.setCameraSpeed(cameraSpeed);
+            scene.setLightingScale(lightingScale);
+            if (activeCamera < scene.getCameraCount()) scene.setActiveCamera(activeCamera);
+            return true;
+        }
+
+        // Unmaps a file when going out of scope
+        struct MappedFile
+        {
+            const uint8_t* pData = nullptr;
+            size_t size = 0;
+            MappedFile(const std::string& filename) { pData = (const uint8_t*)mapFile(filename, size); }
+            ~MappedFile() { unmapFile(pData, size); }
+        };
+    }
+
+    bool ScenePackage::write(const std::string& filename, const Scene::SharedPtr& pScene, const Desc& desc, Stats* pStats)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        Stats stats;
+
+        // Serialize the scene
+        ContentWriter writer;
+        std::map<const Light*, uint32_t> lightIds;
+        writeModels(pScene.get(), desc, writer, stats);
+        writeLights(pScene.get(), desc, writer, lightIds);
+        writeCameras(pScene.get(), desc, writer);
+        writePaths(pScene.get(), desc, writer, lightIds);
+        writeUserVariables(pScene.get(), desc, writer);
+        writeSettings(pScene.get(), desc, writer);
+        const std::vector<uint8_t>& content = writer.getData();
+        CpuTimer::TimePoint serialized = CpuTimer::getCurrentTimePoint();
+        stats.sceneTimeMs = CpuTimer::calcDuration(start, serialized);
+
+        // Compress the chunks. Chunks which don't get smaller are stored as they are.
+        uint32_t chunkSize = std::max(desc.chunkSize, kMinChunkSize);
+        uint32_t chunkCount = (uint32_t)((content.size() + chunkSize - 1) / chunkSize);
+        std::vector<std::vector<uint8_t>> compressedChunks(chunkCount);
+        stats.threadCount = desc.compress ? std::min(resolveThreadCount(desc.threadCount), std::max(chunkCount, 1u)) : 0;
+        if (desc.compress)
+        {
+            parallelFor(chunkCount, stats.threadCount, [&](uint32_t chunk)
+            {
+                size_t offset = (size_t)chunk * chunkSize;
+                size_t size = std::min((size_t)chunkSize, content.size() - offset);
+                std::vector<uint8_t>& compressed = compressedChunks[chunk];
+                compressed.resize(Lz4::compressBound(size));
+                compressed.resize(Lz4::compress(content.data() + offset, size, compressed.data(), size - 1));
+            });
+        }
+        CpuTimer::TimePoint compressed = CpuTimer::getCurrentTimePoint();
+        stats.compressionTimeMs = CpuTimer::calcDuration(serialized, compressed);
+
+        // Lay out the file
+        FileHeader header = {};
+        header.magic = kFileMagic;
+        header.version = kFileVersion;
+        header.chunkSize = chunkSize;
+        header.chunkCount = chunkCount;
+        header.contentSize = content.size();
+
+        std::vector<ChunkRecord> chunks(chunkCount);
+        uint64_t offset = sizeof(FileHeader) + chunkCount * sizeof(ChunkRecord);
+        for (uint32_t i = 0; i < chunkCount; i++)
+        {
+            size_t size = std::min((size_t)chunkSize, content.size() - (size_t)i * chunkSize);
+            chunks[i].offset = offset;
+            chunks[i].storedSize = (uint32_t)(compressedChunks[i].size() ? compressedChunks[i].size() : size);
+            offset += chunks[i].storedSize;
+            if (compressedChunks[i].size()) stats.compressedChunkCount++;
+        }
+        header.fileSize = offset;
+
+        std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+        if (stream.is_open() == false)
+        {
+            logError("Can't open output scene file " + filename + ".\nExporting failed.");
+            return false;
+        }
+        stream.write((const char*)&header, sizeof(header));
+        stream.write((const char*)chunks.data(), chunks.size() * sizeof(ChunkRecord));
+        for (uint32_t i = 0; i < chunkCount; i++)
+        {
+            const uint8_t* pData = compressedChunks[i].size() ? compressedChunks[i].data() : content.data() + (size_t)i * chunkSize;
+            stream.write((const char*)pData, chunks[i].storedSize);
+        }
+        stream.close();
+        if (stream.fail())
+        {
+            logError("Failed writing scene file " + filename + ".");
+            return false;
+        }
+
+        CpuTimer::TimePoint end = CpuTimer::getCurrentTimePoint();
+        stats.packageBytes = header.fileSize;
+        stats.contentBytes = header.contentSize;
+        stats.chunkCount = chunkCount;
+        stats.fileTimeMs = CpuTimer::calcDuration(compressed, end);
+        stats.totalTimeMs = CpuTimer::calcDuration(start, end);
+        if (pStats) *pStats = stats;
+        return true;
+    }
+
+    bool ScenePackage::read(Scene& scene, const std::string& filename, Model::LoadFlags modelLoadFlags, uint32_t threadCount, Stats* pStats)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        Stats stats;
+
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logWarning("ScenePackage: Can't find '" + filename + "'");
+            return false;
+        }
+
+        // Validate the chunk table before decompressing anything
+        std::vector<uint8_t> content;
+        {
+            MappedFile file(fullpath);
+            const FileHeader* pHeader = (file.size >= sizeof(FileHeader)) ? (const FileHeader*)file.pData : nullptr;
+            bool valid = pHeader && pHeader->magic == kFileMagic && pHeader->version == kFileVersion && pHeader->fileSize == file.size && pHeader->chunkSize >= kMinChunkSize &&
+                pHeader->chunkCount <= (file.size - sizeof(FileHeader)) / sizeof(ChunkRecord) && pHeader->contentSize <= (uint64_t)pHeader->chunkCount * pHeader->chunkSize &&
+                pHeader->contentSize + pHeader->chunkSize > (uint64_t)pHeader->chunkCount * pHeader->chunkSize;
+            const ChunkRecord* pChunks = valid ? (const ChunkRecord*)(file.pData + sizeof(FileHeader)) : nullptr;
+            for (uint32_t i = 0; valid && i < pHeader->chunkCount; i++)
+            {
+                valid = pChunks[i].offset <= file.size && pChunks[i].storedSize <= file.size - pChunks[i].offset;
+            }
+            if (valid == false)
+            {
+                logWarning("ScenePackage: '" + fullpath + "' is not a valid scene package");
+                return false;
+            }
+            CpuTimer::TimePoint mapped = CpuTimer::getCurrentTimePoint();
+            stats.fileTimeMs = CpuTimer::calcDuration(start, mapped);
+
+            // Decompress the chunks in parallel. The chunks are read from the mapped file, so reading the file overlaps with the decompression.
+            content.resize((size_t)pHeader->contentSize);
+            stats.threadCount = std::min(resolveThreadCount(threadCount), std::max(pHeader->chunkCount, 1u));
+            std::atomic<bool> chunksValid(true);
+            std::atomic<uint32_t> compressedChunkCount(0);
+            parallelFor(pHeader->chunkCount, stats.threadCount, [&](uint32_t chunk)
+            {
+                size_t offset = (size_t)chunk * pHeader->chunkSize;
+                size_t size = std::min((size_t)pHeader->chunkSize, content.size() - offset);
+                const ChunkRecord& rec = pChunks[chunk];
+                if (rec.storedSize == size)
+                {
+                    std::memcpy(content.data() + offset, file.pData + rec.offset, size);
+                }
+                else
+                {
+                    compressedChunkCount++;
+                    if (Lz4::decompress(file.pData + rec.offset, rec.storedSize, content.data() + offset, size) == false) chunksValid = false;
+                }
+            });
+            if (chunksValid == false)
+            {
+                logWarning("ScenePackage: '" + fullpath + "' is corrupt");
+                return false;
+            }
+            stats.packageBytes = file.size;
+            stats.contentBytes = content.size();
+            stats.chunkCount = pHeader->chunkCount;
+            stats.compressedChunkCount = compressedChunkCount;
+            stats.compressionTimeMs = CpuTimer::calcDuration(mapped, CpuTimer::getCurrentTimePoint());
+        }
+
+        // Create the scene
+        CpuTimer::TimePoint decompressed = CpuTimer::getCurrentTimePoint();
+        ContentReader reader(content.data(), content.size());
+        std::vector<std::vector<Scene::ModelInstance::SharedPtr>> instances;
+        std::vector<Light::SharedPtr> lights;
+        bool valid = readModels(scene, reader, modelLoadFlags, instances, stats) && readLights(scene, reader, lights) && readCameras(scene, reader) &&
+            readPaths(scene, reader, instances, lights) && readUserVariables(scene, reader) && readSettings(scene, reader) && reader.isAtEnd();
+        if (valid == false)
+        {
+            logWarning("ScenePackage: '" + fullpath + "' is corrupt");
+            return false;
+        }
+        scene.setVersion(SceneExporter::kVersion);
+
+        CpuTimer::TimePoint end = CpuTimer::getCurrentTimePoint();
+        stats.sceneTimeMs = CpuTimer::calcDuration(decompressed, end);
+        stats.totalTimeMs = CpuTimer::calcDuration(start, end);
+        if (pStats) *pStats = stats;
+        return true;
+    }
+
+    std::string ScenePackage::getStatsString(const Stats& stats)
+    {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2);
+        ss << "Scene package: " << stats.packageBytes / (1024.0 * 1024.0) << " MB (" << stats.contentBytes / (1024.0 * 1024.0) << " MB uncompressed, "
+           << stats.compressedChunkCount << "/" << stats.chunkCount << " chunks compressed), " << stats.embeddedModelCount << " models embedded, " << stats.referencedModelCount << " referenced";
+        ss << "\n  " << stats.totalTimeMs << " ms: " << stats.fileTimeMs << " ms file, " << stats.compressionTimeMs << " ms LZ4 on " << stats.threadCount << " threads, " << stats.sceneTimeMs << " ms scene";
+        return ss.str();
+    }
+}
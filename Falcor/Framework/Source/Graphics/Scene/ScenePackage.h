@@ -0,0 +1,97 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "Scene.h"
+
+namespace Falcor
+{
+    /** Binary scene packages (.fbscene), a self-contained alternative to the JSON .fscene files.
+        A package holds the scene's settings, models, instances, lights, cameras, paths and user variables. Models are embedded in the
+        ModelCache format, so loading them skips the importer and creates the GPU buffers directly from the package.
+        Models with bones or animations can't be embedded, and are referenced by filename like in an .fscene. Textures are always referenced by filename.
+
+        The package content is split into chunks which are LZ4 compressed independently, so they are decompressed in parallel when loading.
+        Loading doesn't involve any JSON parsing. Packages are loaded through SceneImporter and written through SceneExporter based on the file extension.
+    */
+    class ScenePackage
+    {
+    public:
+        static const char* kFileExtension;
+
+        struct Desc
+        {
+            uint32_t exportOptions = 0xFFFFFFFF;        ///< The sections to write, as SceneExporter flags
+            Model::LoadFlags modelLoadFlags = Model::LoadFlags::None;   ///< The flags the scene's models were loaded with. Embedded models can only be loaded with the same flags.
+            uint32_t chunkSize = 1024 * 1024;           ///< Size of the chunks, before compression
+            bool compress = true;
+            uint32_t threadCount = 0;                   ///< Threads compressing and decompressing the chunks. 0 uses all the hardware threads.
+        };
+
+        struct Stats
+        {
+            uint64_t packageBytes = 0;                  ///< Size of the file
+            uint64_t contentBytes = 0;                  ///< Size of the content, once decompressed
+            uint32_t chunkCount = 0;
+            uint32_t compressedChunkCount = 0;          ///< Chunks which are compressed. The others didn't compress and are stored as-is.
+            uint32_t embeddedModelCount = 0;
+            uint32_t referencedModelCount = 0;          ///< Models loaded from their source files
+            uint32_t threadCount = 0;
+            double fileTimeMs = 0;                      ///< Reading or writing the file
+            double compressionTimeMs = 0;               ///< Compressing or decompressing the chunks
+            double sceneTimeMs = 0;                     ///< Serializing the scene, or creating its objects and resources
+            double totalTimeMs = 0;
+        };
+
+        /** Write a scene to a package
+            \param[in] filename The file to write
+            \param[in] pScene The scene
+            \param[in] desc The options
+            \param[out] pStats Optional. Where to store the stats of the operation.
+            \return true if the package was written
+        */
+        static bool write(const std::string& filename, const Scene::SharedPtr& pScene, const Desc& desc, Stats* pStats = nullptr);
+
+        /** Load a package into a scene
+            \param[out] scene The scene to populate
+            \param[in] filename The package file. Looked for in the data directories.
+            \param[in] modelLoadFlags Flags for the models. Embedded models which were written with other flags are loaded from their source files instead.
+            \param[in] threadCount Threads decompressing the chunks. 0 uses all the hardware threads.
+            \param[out] pStats Optional. Where to store the stats of the operation.
+            \return true if the package was loaded. The scene may be partially populated otherwise.
+        */
+        static bool read(Scene& scene, const std::string& filename, Model::LoadFlags modelLoadFlags, uint32_t threadCount = 0, Stats* pStats = nullptr);
+
+        /** Get a one-line summary of stats, for logging
+        */
+        static std::string getStatsString(const Stats& stats);
+
+    private:
+        ScenePackage() = delete;
+    };
+}
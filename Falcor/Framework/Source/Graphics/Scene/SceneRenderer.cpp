@@ -36,6 +36,9 @@
 #include "VR/OpenVR/VRSystem.h"
 #include "API/Device.h"
 #include "glm/matrix.hpp"
+#include "Utils/Profiler.h"
+#include <sstream>
+#include <iomanip>
 
 namespace Falcor
 {
@@ -49,7 +52,6 @@ namespace Falcor
     size_t SceneRenderer::sMeshIdOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sDrawIDOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sLightCountOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sLightArrayOffset = ConstantBuffer::kInvalidOffset;
 
     const char* SceneRenderer::kPerFrameCbName = "InternalPerFrameCB";
     const char* SceneRenderer::kPerMeshCbName = "InternalPerMeshCB";
@@ -57,6 +59,7 @@ namespace Falcor
     const char* SceneRenderer::kProbeVarName = "gLightProbe";
     const char* SceneRenderer::kProbeSharedVarName = "gProbeShared";
     const char* SceneRenderer::kAreaLightCbName = "InternalAreaLightCB";
+    const char* SceneRenderer::kLightBufferName = "gLights";
 
 
     SceneRenderer::SharedPtr SceneRenderer::create(const Scene::SharedPtr& pScene)
@@ -105,12 +108,25 @@ namespace Falcor
                 sCameraDataOffset = pType->findMember("gCamera.viewMat")->getOffset();
                 const auto& pCountOffset = pType->findMember("gLightsCount");
                 sLightCountOffset = pCountOffset ? pCountOffset->getOffset() : ConstantBuffer::kInvalidOffset;
-                const auto& pLightOffset = pType->findMember("gLights");
-                sLightArrayOffset = pLightOffset ? pLightOffset->getOffset() : ConstantBuffer::kInvalidOffset;
             }
         }
     }
 
+    void SceneRenderer::createLightStore(const ProgramReflection* pReflector)
+    {
+        if (mpScene->getLightStore())
+        {
+            return;
+        }
+
+        const ReflectionVar* pVar = pReflector->getDefaultParameterBlock()->getResource(kLightBufferName).get();
+        const ReflectionResourceType* pType = pVar ? pVar->getType()->unwrapArray()->asResourceType() : nullptr;
+        if (pType)
+        {
+            mpScene->createLightStore(pType->inherit_shared_from_this::shared_from_this());
+        }
+    }
+
     void SceneRenderer::setPerFrameData(const CurrentWorkingData& currentData)
     {
         ConstantBuffer* pCB = currentData.pVars->getConstantBuffer(kPerFrameCbName).get();
@@ -122,18 +138,18 @@ namespace Falcor
                 currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
             }
 
-            // Set lights
-            if (sLightArrayOffset != ConstantBuffer::kInvalidOffset)
+            // Set lights. The scene's store uploads the data once per frame, and the count is the one of the buffer's contents.
+            // Lights added or removed since Scene::update() are uploaded now, so the count and the buffer match the scene's lights.
+            mpScene->syncLightStore();
+            const LightStore* pLightStore = mpScene->getLightStore().get();
+            assert(pLightStore == nullptr || pLightStore->getLightCount() == mpScene->getLightCount());
+            if (pLightStore && currentData.pVars->getReflection()->getDefaultParameterBlock()->getResource(kLightBufferName))
             {
-                assert(mpScene->getLightCount() <= MAX_LIGHT_SOURCES);  // Max array size in the shader
-                for (uint32_t i = 0; i < mpScene->getLightCount(); i++)
-                {
-                    mpScene->getLight(i)->setIntoProgramVars(currentData.pVars, pCB, sLightArrayOffset + (i * Light::getShaderStructSize()));
-                }
+                currentData.pVars->setStructuredBuffer(kLightBufferName, pLightStore->getBuffer());
             }
             if (sLightCountOffset != ConstantBuffer::kInvalidOffset)
             {
-                pCB->setVariable(sLightCountOffset, mpScene->getLightCount());
+                pCB->setVariable(sLightCountOffset, pLightStore ? pLightStore->getLightCount() : mpScene->getLightCount());
             }
             if (mpScene->getLightProbeCount() > 0)
             {
@@ -204,22 +220,34 @@ namespace Falcor
         if (pCB)
         {
             const Mesh* pMesh = pMeshInstance->getObject().get();
+            assert(drawInstanceID < sWorldMatArraySize);
 
-            glm::mat4 worldMat = pModelInstance->getTransformMatrix();
-            glm::mat4 prevWorldMat = pModelInstance->getPrevTransformMatrix();
-
-            if (pMesh->hasBones() == false)
+            if (currentData.transformNode != TransformStore::kInvalidNode)
             {
-                worldMat = worldMat * pMeshInstance->getTransformMatrix();
-                prevWorldMat = prevWorldMat * pMeshInstance->getPrevTransformMatrix();
+                // The matrices were computed by the scene's update()
+                const TransformStore* pStore = mpScene->getTransformStore().get();
+                const uint32_t node = currentData.transformNode;
+                pCB->setBlob(&pStore->getWorldMatrix(node), sWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
+                pCB->setBlob(&pStore->getNormalMatrix(node), sWorldInvTransposeMatOffset + drawInstanceID * sizeof(glm::mat3x4), sizeof(glm::mat3x4));
+                pCB->setBlob(&pStore->getPrevWorldMatrix(node), sPrevWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
             }
+            else
+            {
+                glm::mat4 worldMat = pModelInstance->getTransformMatrix();
+                glm::mat4 prevWorldMat = pModelInstance->getPrevTransformMatrix();
 
-            glm::mat3x4 worldInvTransposeMat = transpose(inverse(glm::mat3(worldMat)));
+                if (pMesh->hasBones() == false)
+                {
+                    worldMat = worldMat * pMeshInstance->getTransformMatrix();
+                    prevWorldMat = prevWorldMat * pMeshInstance->getPrevTransformMatrix();
+                }
 
-            assert(drawInstanceID < sWorldMatArraySize);
-            pCB->setBlob(&worldMat, sWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
-            pCB->setBlob(&worldInvTransposeMat, sWorldInvTransposeMatOffset + drawInstanceID * sizeof(glm::mat3x4), sizeof(glm::mat3x4)); // HLSL uses column-major and packing rules require 16B alignment, hence use glm:mat3x4
-            pCB->setBlob(&prevWorldMat, sPrevWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
+                glm::mat3x4 worldInvTransposeMat = transpose(inverse(glm::mat3(worldMat)));
+
+                pCB->setBlob(&worldMat, sWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
+                pCB->setBlob(&worldInvTransposeMat, sWorldInvTransposeMatOffset + drawInstanceID * sizeof(glm::mat3x4), sizeof(glm::mat3x4)); // HLSL uses column-major and packing rules require 16B alignment, hence use glm:mat3x4
+                pCB->setBlob(&prevWorldMat, sPrevWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
+            }
 
             // Set mesh id
             pCB->setVariable(sMeshIdOffset, pMesh->getId());
@@ -274,6 +302,107 @@ namespace Falcor
         return currentData.pCamera->isObjectCulled(box);
     }
 
+    static uint32_t getModelMeshInstanceCount(const Model* pModel)
+    {
+        uint32_t count = 0;
+        for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            count += pModel->getMeshInstanceCount(meshID);
+        }
+        return count;
+    }
+
+    uint32_t SceneRenderer::updateCullBounds(uint32_t instanceCount)
+    {
+        const uint32_t firstNode = getFirstMeshTransformNode();
+        if (firstNode != TransformStore::kInvalidNode)
+        {
+            // The store's world matrices transform the bounds of the meshes themselves, for skinned meshes too
+            return mpInstanceCuller->updateBounds(mpScene->getTransformStore(), firstNode, instanceCount, [this](std::vector<BoundingBox>& meshBounds)
+            {
+                for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+                {
+                    const Model* pModel = mpScene->getModel(modelID).get();
+                    for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
+                    {
+                        for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                        {
+                            meshBounds.resize(meshBounds.size() + pModel->getMeshInstanceCount(meshID), pModel->getMesh(meshID)->getBoundingBox());
+                        }
+                    }
+                }
+            });
+        }
+
+        // Without the store, gather the world bounds of every mesh instance in the order renderScene() visits them, including the hidden ones, so the indices match
+        mpInstanceCuller->resize(instanceCount);
+        uint32_t index = 0;
+        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = mpScene->getModel(modelID).get();
+            for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                const glm::mat4& transform = mpScene->getModelInstance(modelID, instanceID)->getTransformMatrix();
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        mpInstanceCuller->setBounds(index++, pModel->getMeshInstance(meshID, meshInstanceID)->getBoundingBox().transform(transform));
+                    }
+                }
+            }
+        }
+        return instanceCount;
+    }
+
+    void SceneRenderer::cullScene(const CurrentWorkingData& currentData)
+    {
+        PROFILE(cullScene);
+        auto start = CpuTimer::getCurrentTimePoint();
+        if (mpInstanceCuller == nullptr)
+        {
+            mpInstanceCuller = InstanceCuller::create();
+        }
+
+        uint32_t instanceCount = 0;
+        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            instanceCount += mpScene->getModelInstanceCount(modelID) * getModelMeshInstanceCount(mpScene->getModel(modelID).get());
+        }
+
+        mCullStats = CullStats();
+        mCullStats.instanceCount = instanceCount;
+        mCullStats.updatedBoundsCount = updateCullBounds(instanceCount);
+        auto gathered = CpuTimer::getCurrentTimePoint();
+
+        mpInstanceCuller->cull(currentData.pCamera);
+        mVisibleCursor = 0;
+
+        mCullStats.boundsTimeMs = CpuTimer::calcDuration(start, gathered);
+        mCullStats.cullTimeMs = CpuTimer::calcDuration(gathered, CpuTimer::getCurrentTimePoint());
+    }
+
+    std::string SceneRenderer::getCullStatsString() const
+    {
+        const CullStats& s = mCullStats;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "SceneRenderer culling: " << (mpInstanceCuller ? mpInstanceCuller->getStats().visibleCount : 0) << " of " << s.instanceCount << " instances visible, "
+           << s.updatedBoundsCount << " bounds updated in " << s.boundsTimeMs << " ms, culled in " << s.cullTimeMs << " ms, " << s.boundsTimeMs + s.cullTimeMs << " ms total";
+        return ss.str();
+    }
+
+    bool SceneRenderer::isCulledInBatch(uint32_t meshInstanceIndex)
+    {
+        // Instances are queried in increasing order, so the cursor only moves forward
+        const auto& visible = mpInstanceCuller->getVisibleInstances();
+        while ((mVisibleCursor < visible.size()) && (visible[mVisibleCursor] < meshInstanceIndex))
+        {
+            mVisibleCursor++;
+        }
+        return (mVisibleCursor == visible.size()) || (visible[mVisibleCursor] != meshInstanceIndex);
+    }
+
     void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID)
     {
         const Model* pModel = currentData.pModel;
@@ -300,8 +429,15 @@ namespace Falcor
 
                 if (pMeshInstance->isVisible())
                 {
-                    if ((mCullEnabled == false) || (cullMeshInstance(currentData, pModelInstance, pMeshInstance) == false))
+                    bool culled = false;
+                    if (mCullEnabled)
+                    {
+                        culled = mBatchedCulling ? isCulledInBatch(currentData.meshInstanceIndex + instanceID) : cullMeshInstance(currentData, pModelInstance, pMeshInstance);
+                    }
+
+                    if (culled == false)
                     {
+                        currentData.transformNode = (currentData.firstMeshTransformNode == TransformStore::kInvalidNode) ? TransformStore::kInvalidNode : currentData.firstMeshTransformNode + currentData.meshInstanceIndex + instanceID;
                         if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, activeInstances))
                         {
                             currentData.drawID++;
@@ -339,6 +475,7 @@ namespace Falcor
         for (uint32_t meshID = 0; meshID < pModelInstance->getObject()->getMeshCount(); meshID++)
         {
             renderMeshInstances(currentData, pModelInstance, meshID);
+            currentData.meshInstanceIndex += pModelInstance->getObject()->getMeshInstanceCount(meshID);
         }
     }
 
@@ -347,6 +484,22 @@ namespace Falcor
         return mpScene->update(currentTime, mpCameraController.get());
     }
 
+    uint32_t SceneRenderer::getFirstMeshTransformNode() const
+    {
+        if (mpScene->isTransformStoreCurrent() == false)
+        {
+            return TransformStore::kInvalidNode;
+        }
+
+        // Mesh instance nodes follow the model instance nodes
+        uint32_t modelInstanceCount = 0;
+        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            modelInstanceCount += mpScene->getModelInstanceCount(modelID);
+        }
+        return modelInstanceCount;
+    }
+
     void SceneRenderer::renderScene(RenderContext* pContext)
     {
         renderScene(pContext, mpScene->getActiveCamera().get());
@@ -356,9 +509,18 @@ namespace Falcor
     {
         setPerFrameData(currentData);
 
+        if (mCullEnabled && mBatchedCulling)
+        {
+            cullScene(currentData);
+        }
+
+        currentData.firstMeshTransformNode = getFirstMeshTransformNode();
+
+        uint32_t firstMeshInstance = 0;
         for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
         {
             currentData.pModel = mpScene->getModel(modelID).get();
+            const uint32_t meshInstancesPerInstance = getModelMeshInstanceCount(currentData.pModel);
 
             if (setPerModelData(currentData))
             {
@@ -369,17 +531,20 @@ namespace Falcor
                     {
                         if (setPerModelInstanceData(currentData, pInstance, instanceID))
                         {
+                            currentData.meshInstanceIndex = firstMeshInstance + instanceID * meshInstancesPerInstance;
                             renderModelInstance(currentData, pInstance);
                         }
                     }
                 }
             }
+            firstMeshInstance += mpScene->getModelInstanceCount(modelID) * meshInstancesPerInstance;
         }
     }
 
     void SceneRenderer::renderScene(RenderContext* pContext, const Camera* pCamera)
     {
         updateVariableOffsets(pContext->getGraphicsVars()->getReflection().get());
+        createLightStore(pContext->getGraphicsVars()->getReflection().get());
 
         CurrentWorkingData currentData;
         currentData.pContext = pContext;
@@ -30,6 +30,8 @@
 #include "Utils/Gui.h"
 #include "Graphics/Camera/CameraController.h"
 #include "Graphics/Scene/Scene.h"
+#include "Graphics/Scene/InstanceCuller.h"
+#include "Graphics/Scene/TransformStore.h"
 #include "Utils/CpuTimer.h"
 #include "API/ConstantBuffer.h"
 #include "Utils/DebugDrawer.h"
@@ -81,6 +83,32 @@ namespace Falcor
         */
         bool isMeshCullingEnabled() const { return mCullEnabled; }
 
+        /** Enable/disable batched culling. When enabled, the world bounds of all the mesh instances are culled together with an InstanceCuller
+            before rendering, instead of calling cullMeshInstance() for each of them. Enabled by default.
+            The culler keeps the bounds between renders. With the scene's transform store, only the bounds of the instances it recomputed are rewritten.
+        */
+        void toggleBatchedCulling(bool enable) { mBatchedCulling = enable; }
+
+        /** Get the culler used by batched culling, or nullptr if the scene was not rendered with it yet. Its stats describe the last rendered pass.
+        */
+        InstanceCuller::SharedConstPtr getInstanceCuller() const { return mpInstanceCuller; }
+
+        /** What the last batched culling did, from gathering the world bounds to the list of visible instances
+        */
+        struct CullStats
+        {
+            uint32_t instanceCount = 0;
+            uint32_t updatedBoundsCount = 0;    ///< World bounds rewritten. Only the instances which moved when the scene's transform store is used.
+            double boundsTimeMs = 0;            ///< Bringing the world bounds up to date
+            double cullTimeMs = 0;              ///< Testing the bounds against the frustum
+        };
+
+        const CullStats& getCullStats() const { return mCullStats; }
+
+        /** Get a one-line summary of the last batched culling, for logging
+        */
+        std::string getCullStatsString() const;
+
         /** Set the maximal number of mesh instance to dispatch in a single draw call.
         */
         void setMaxInstanceCount(uint32_t instanceCount) { mMaxInstanceCount = instanceCount; }
@@ -112,6 +140,9 @@ namespace Falcor
             const Material* pMaterial = nullptr;
 
             uint32_t drawID; // Zero-based mesh instance draw order/ID. Resets at the beginning of renderScene, and increments per mesh instance drawn.
+            uint32_t meshInstanceIndex = 0; // Index of the first mesh instance of the current mesh in the scene's traversal order, drawn or not. Used by batched culling.
+            uint32_t firstMeshTransformNode = TransformStore::kInvalidNode; // Transform store node of the first mesh instance in traversal order, or kInvalidNode if the store is not used
+            uint32_t transformNode = TransformStore::kInvalidNode; // Transform store node of the mesh instance being drawn, or kInvalidNode to compute its matrices from the instances
         };
 
         SceneRenderer(const Scene::SharedPtr& pScene);
@@ -123,12 +154,12 @@ namespace Falcor
         static const char* kProbeVarName;
         static const char* kProbeSharedVarName;
         static const char* kAreaLightCbName;
+        static const char* kLightBufferName;
 
         static size_t sBonesOffset;
         static size_t sBonesInvTransposeOffset;
         static size_t sCameraDataOffset;
         static size_t sLightCountOffset;
-        static size_t sLightArrayOffset;
         static size_t sWorldMatArraySize;
         static size_t sWorldMatOffset;
         static size_t sPrevWorldMatOffset;
@@ -138,6 +169,14 @@ namespace Falcor
 
         static void updateVariableOffsets(const ProgramReflection* pReflector);
 
+        /** Create the scene's light store, if no renderer of the scene did yet. Call before setPerFrameData(), which binds its buffer.
+        */
+        void createLightStore(const ProgramReflection* pReflector);
+
+        /** Get the transform store node of the first mesh instance, if the scene's store is current, or kInvalidNode to compute the matrices from the instances
+        */
+        uint32_t getFirstMeshTransformNode() const;
+
         virtual void setPerFrameData(const CurrentWorkingData& currentData);
         virtual bool setPerModelData(const CurrentWorkingData& currentData);
         virtual bool setPerModelInstanceData(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t instanceID);
@@ -153,6 +192,9 @@ namespace Falcor
         void draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount);
 
         void renderScene(CurrentWorkingData& currentData);
+        void cullScene(const CurrentWorkingData& currentData);
+        uint32_t updateCullBounds(uint32_t instanceCount);
+        bool isCulledInBatch(uint32_t meshInstanceIndex);
 
         CameraControllerType mCamControllerType = CameraControllerType::SixDof;
         CameraController::SharedPtr mpCameraController;
@@ -160,6 +202,10 @@ namespace Falcor
         uint32_t mMaxInstanceCount = 64;
         const Material* mpLastMaterial = nullptr;
         bool mCullEnabled = true;
+        bool mBatchedCulling = true;
+        InstanceCuller::SharedPtr mpInstanceCuller;
+        uint32_t mVisibleCursor = 0;        ///< Position in the culler's visible list, which is in traversal order
+        CullStats mCullStats;
         bool mCompileMaterialWithProgram = true;
     };
 }
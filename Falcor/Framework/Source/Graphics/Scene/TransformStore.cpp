@@ -0,0 +1,376 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TransformStore.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include "Utils/Math/SimdFloat8.h"
+#include "glm/matrix.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    namespace
+    {
+        enum NodeFlags : uint8_t
+        {
+            kDirty = 0x1,           ///< The local or previous local matrix changed
+            kUpdate = 0x2,          ///< Recomputed by the current update(): dirty, or an ancestor is
+            kPending = 0x4,         ///< The world, previous-world and normal matrices changed since the last upload()
+        };
+
+        // Levels with more nodes than this are recomputed in parallel, in tasks of kNodesPerTask nodes
+        const uint32_t kParallelNodeCount = 4096;
+        const uint32_t kNodesPerTask = 1024;
+
+        // Changed nodes separated by at most this many unchanged ones are uploaded as a single range
+        const uint32_t kMaxRangeGap = 4;
+
+        // Capacity of new buffers, and growth factor when the nodes outgrow them
+        const uint32_t kMinCapacity = 64;
+        const float kGrowthFactor = 1.5f;
+
+        /** Multiply two matrices one column at a time. Adds the products in the same order as glm's operator*, so the results match it.
+        */
+        glm::mat4 multiply(const glm::mat4& a, const glm::mat4& b)
+        {
+            SimdFloat4 a0 = SimdFloat4::load(&a[0][0]);
+            SimdFloat4 a1 = SimdFloat4::load(&a[1][0]);
+            SimdFloat4 a2 = SimdFloat4::load(&a[2][0]);
+            SimdFloat4 a3 = SimdFloat4::load(&a[3][0]);
+
+            glm::mat4 result;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                SimdFloat4 column = a0 * SimdFloat4(b[c][0]) + a1 * SimdFloat4(b[c][1]) + a2 * SimdFloat4(b[c][2]) + a3 * SimdFloat4(b[c][3]);
+                column.store(&result[c][0]);
+            }
+            return result;
+        }
+
+        /** Compute the inverse transpose of 8 3x3 matrices at once, in SoA layout with the elements in column-major order.
+            The columns of the inverse transpose are the cross products of pairs of columns of the matrix, divided by its determinant.
+        */
+        void inverseTranspose8(const float m[9][8], float result[9][8])
+        {
+            SimdFloat8 c0[3], c1[3], c2[3];
+            for (uint32_t r = 0; r < 3; r++)
+            {
+                c0[r] = SimdFloat8::load(m[r]);
+                c1[r] = SimdFloat8::load(m[3 + r]);
+                c2[r] = SimdFloat8::load(m[6 + r]);
+            }
+
+            auto cross = [](const SimdFloat8 a[3], const SimdFloat8 b[3], SimdFloat8 c[3])
+            {
+                c[0] = a[1] * b[2] - a[2] * b[1];
+                c[1] = a[2] * b[0] - a[0] * b[2];
+                c[2] = a[0] * b[1] - a[1] * b[0];
+            };
+
+            SimdFloat8 n0[3], n1[3], n2[3];
+            cross(c1, c2, n0);
+            cross(c2, c0, n1);
+            cross(c0, c1, n2);
+
+            SimdFloat8 invDet = SimdFloat8(1.0f) / (c0[0] * n0[0] + c0[1] * n0[1] + c0[2] * n0[2]);
+            for (uint32_t r = 0; r < 3; r++)
+            {
+                (n0[r] * invDet).store(result[r]);
+                (n1[r] * invDet).store(result[3 + r]);
+                (n2[r] * invDet).store(result[6 + r]);
+            }
+        }
+    }
+
+    TransformStore::SharedPtr TransformStore::create(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = WorkerPool::get().getThreadCount();
+        }
+        return SharedPtr(new TransformStore(threadCount));
+    }
+
+    uint32_t TransformStore::addNode(const glm::mat4& local, const glm::mat4& prevLocal, uint32_t parent)
+    {
+        uint32_t node = getNodeCount();
+        if (parent != kInvalidNode && parent >= node)
+        {
+            logWarning("TransformStore::addNode() - parent " + std::to_string(parent) + " is not in the store. Adding the node as a root.");
+            parent = kInvalidNode;
+        }
+
+        mLocal.push_back(local);
+        mPrevLocal.push_back(prevLocal);
+        mWorld.push_back(local);
+        mPrevWorld.push_back(prevLocal);
+        mNormal.push_back(glm::mat3x4(1.0f));
+        mParent.push_back(parent);
+        mDepth.push_back(parent == kInvalidNode ? 0 : mDepth[parent] + 1);
+        mFlags.push_back(kDirty);
+        mDirtyCount++;
+        return node;
+    }
+
+    void TransformStore::clear()
+    {
+        mLocal.clear();
+        mPrevLocal.clear();
+        mWorld.clear();
+        mPrevWorld.clear();
+        mNormal.clear();
+        mParent.clear();
+        mDepth.clear();
+        mFlags.clear();
+        mUpdatedNodes.clear();
+        mDirtyCount = 0;
+        mUploadPending = false;
+        mFullUpload = true;
+    }
+
+    void TransformStore::setLocalMatrix(uint32_t node, const glm::mat4& local)
+    {
+        if (std::memcmp(&mLocal[node], &local, sizeof(glm::mat4)) != 0)
+        {
+            setLocalMatrix(node, local, mLocal[node]);
+        }
+    }
+
+    void TransformStore::setLocalMatrix(uint32_t node, const glm::mat4& local, const glm::mat4& prevLocal)
+    {
+        if ((std::memcmp(&mLocal[node], &local, sizeof(glm::mat4)) != 0) || (std::memcmp(&mPrevLocal[node], &prevLocal, sizeof(glm::mat4)) != 0))
+        {
+            // prevLocal may alias mLocal[node], so it is copied first
+            mPrevLocal[node] = prevLocal;
+            mLocal[node] = local;
+            if ((mFlags[node] & kDirty) == 0)
+            {
+                mFlags[node] |= kDirty;
+                mDirtyCount++;
+            }
+        }
+    }
+
+    void TransformStore::recompute(const uint32_t* pNodes, uint32_t count)
+    {
+        float m[9][8];
+        float normal[9][8];
+        for (uint32_t first = 0; first < count; first += 8)
+        {
+            const uint32_t batchSize = std::min(8u, count - first);
+            for (uint32_t b = 0; b < batchSize; b++)
+            {
+                uint32_t node = pNodes[first + b];
+                uint32_t parent = mParent[node];
+                glm::mat4 world = (parent == kInvalidNode) ? mLocal[node] : multiply(mWorld[parent], mLocal[node]);
+                mPrevWorld[node] = (parent == kInvalidNode) ? mPrevLocal[node] : multiply(mPrevWorld[parent], mPrevLocal[node]);
+                mWorld[node] = world;
+
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    for (uint32_t r = 0; r < 3; r++) m[c * 3 + r][b] = world[c][r];
+                }
+            }
+
+            // Pad the last batch with identity matrices
+            for (uint32_t b = batchSize; b < 8; b++)
+            {
+                for (uint32_t i = 0; i < 9; i++) m[i][b] = (i % 4 == 0) ? 1.0f : 0.0f;
+            }
+
+            inverseTranspose8(m, normal);
+            for (uint32_t b = 0; b < batchSize; b++)
+            {
+                glm::mat3x4& n = mNormal[pNodes[first + b]];
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    n[c] = glm::vec4(normal[c * 3][b], normal[c * 3 + 1][b], normal[c * 3 + 2][b], 0.0f);
+                }
+            }
+        }
+    }
+
+    void TransformStore::update()
+    {
+        auto start = CpuTimer::getCurrentTimePoint();
+        UpdateStats& stats = mUpdateStats;
+        stats = UpdateStats();
+        stats.nodeCount = getNodeCount();
+        stats.dirtyNodeCount = mDirtyCount;
+        stats.threadCount = 1;
+        mUpdateCount++;
+        mUpdatedNodes.clear();
+
+        // Propagate the dirty flags down the hierarchy. Parents come before their children, so a single pass in index order is enough.
+        for (auto& level : mLevels) level.clear();
+        if (mDirtyCount > 0)
+        {
+            for (uint32_t node = 0; node < stats.nodeCount; node++)
+            {
+                uint8_t& flags = mFlags[node];
+                uint32_t parent = mParent[node];
+                if ((flags & kDirty) || (parent != kInvalidNode && (mFlags[parent] & kUpdate)))
+                {
+                    flags = (flags & ~kDirty) | kUpdate;
+                    uint32_t depth = mDepth[node];
+                    if (depth >= mLevels.size()) mLevels.resize(depth + 1);
+                    mLevels[depth].push_back(node);
+                }
+            }
+            mDirtyCount = 0;
+        }
+
+        auto propagated = CpuTimer::getCurrentTimePoint();
+
+        // Recompute one level at a time, since the nodes of a level only depend on the levels above it
+        for (const auto& level : mLevels)
+        {
+            const uint32_t nodeCount = (uint32_t)level.size();
+            if (nodeCount == 0) continue;
+            stats.levelCount++;
+            stats.updatedNodeCount += nodeCount;
+
+            if (nodeCount > kParallelNodeCount && mThreadCount > 1)
+            {
+                const uint32_t taskCount = (nodeCount + kNodesPerTask - 1) / kNodesPerTask;
+                stats.threadCount = std::max(stats.threadCount, std::min(mThreadCount, taskCount));
+                parallelFor(taskCount, mThreadCount, [&](uint32_t task)
+                {
+                    uint32_t first = task * kNodesPerTask;
+                    recompute(level.data() + first, std::min(kNodesPerTask, nodeCount - first));
+                });
+            }
+            else
+            {
+                recompute(level.data(), nodeCount);
+            }
+
+            for (uint32_t node : level)
+            {
+                mFlags[node] = (mFlags[node] & ~kUpdate) | kPending;
+            }
+            mUpdatedNodes.insert(mUpdatedNodes.end(), level.begin(), level.end());
+        }
+        mUploadPending = mUploadPending || stats.updatedNodeCount > 0;
+
+        stats.propagateTimeMs = CpuTimer::calcDuration(start, propagated);
+        stats.recomputeTimeMs = CpuTimer::calcDuration(propagated, CpuTimer::getCurrentTimePoint());
+    }
+
+    void TransformStore::takeUploadRanges()
+    {
+        std::vector<Range>& ranges = mUploadRanges;
+        ranges.clear();
+        const uint32_t nodeCount = getNodeCount();
+        for (uint32_t node = 0; node < nodeCount; node++)
+        {
+            if (mFlags[node] & kPending)
+            {
+                mFlags[node] &= ~kPending;
+                if (ranges.empty() || (node > ranges.back().first + ranges.back().count + kMaxRangeGap))
+                {
+                    ranges.push_back({ node, 1 });
+                }
+                else
+                {
+                    ranges.back().count = node - ranges.back().first + 1;
+                }
+            }
+        }
+    }
+
+    void TransformStore::uploadRanges(const std::vector<Range>& ranges, const Buffer::SharedPtr& pBuffer, const void* pData, size_t elementSize)
+    {
+        for (const auto& range : ranges)
+        {
+            size_t offset = range.first * elementSize;
+            size_t size = range.count * elementSize;
+            pBuffer->updateData((const uint8_t*)pData + offset, offset, size);
+            mUploadStats.uploadedBytes += size;
+        }
+    }
+
+    bool TransformStore::upload()
+    {
+        auto start = CpuTimer::getCurrentTimePoint();
+        UploadStats& stats = mUploadStats;
+        stats = UploadStats();
+
+        const uint32_t nodeCount = getNodeCount();
+        if (nodeCount > mCapacity)
+        {
+            mCapacity = std::max(nodeCount, mCapacity ? (uint32_t)(mCapacity * kGrowthFactor) : kMinCapacity);
+            mpWorldBuffer = Buffer::create(mCapacity * sizeof(glm::mat4), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None);
+            mpPrevWorldBuffer = Buffer::create(mCapacity * sizeof(glm::mat4), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None);
+            mpNormalBuffer = Buffer::create(mCapacity * sizeof(glm::mat3x4), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None);
+            stats.reallocated = true;
+            mFullUpload = true;
+        }
+
+        if (mFullUpload)
+        {
+            for (auto& flags : mFlags) flags &= ~kPending;
+            mUploadRanges.clear();
+            if (nodeCount > 0) mUploadRanges.push_back({ 0, nodeCount });
+        }
+        else if (mUploadPending)
+        {
+            takeUploadRanges();
+        }
+        else
+        {
+            mUploadRanges.clear();
+        }
+        mFullUpload = false;
+        mUploadPending = false;
+
+        uploadRanges(mUploadRanges, mpWorldBuffer, mWorld.data(), sizeof(glm::mat4));
+        uploadRanges(mUploadRanges, mpNormalBuffer, mNormal.data(), sizeof(glm::mat3x4));
+        uploadRanges(mUploadRanges, mpPrevWorldBuffer, mPrevWorld.data(), sizeof(glm::mat4));
+        stats.uploadRangeCount = (uint32_t)mUploadRanges.size();
+
+        stats.uploadTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return stats.reallocated;
+    }
+
+    std::string TransformStore::getStatsString() const
+    {
+        const UpdateStats& s = mUpdateStats;
+        const UploadStats& u = mUploadStats;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "TransformStore: " << s.dirtyNodeCount << " of " << s.nodeCount << " nodes changed, " << s.updatedNodeCount << " recomputed over " << s.levelCount << " levels on "
+           << s.threadCount << " threads. Propagate " << s.propagateTimeMs << " ms, recompute " << s.recomputeTimeMs << " ms. Uploaded "
+           << u.uploadedBytes / 1024.0 << " KB in " << u.uploadRangeCount << " ranges" << (u.reallocated ? " to new buffers" : "") << ", " << u.uploadTimeMs << " ms";
+        return ss.str();
+    }
+}
@@ -0,0 +1,190 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/mat3x4.hpp"
+#include "API/Buffer.h"
+
+namespace Falcor
+{
+    /** Keeps the transforms of a hierarchy of nodes in contiguous arrays: local, previous local, world, previous-world and normal matrices, one array each.
+        Nodes are added after their parent, so updating them in index order always sees an up-to-date parent.
+        Changing a node's local matrices marks it dirty, and update() recomputes the world and normal matrices of the dirty nodes and all their descendants,
+        one hierarchy level at a time, in batches processed with SIMD and in parallel for large levels.
+        The previous-world matrix is built from the previous local matrices the same way, like ObjectInstance::getPrevTransformMatrix() is built from the
+        transform before the instance's last move. It only depends on the matrices set, so calling update() more than once per frame doesn't change it.
+        The matrices can be uploaded to GPU buffers with upload(), which only uploads the ranges that changed since the last upload.
+    */
+    class TransformStore
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TransformStore>;
+        using SharedConstPtr = std::shared_ptr<const TransformStore>;
+
+        static const uint32_t kInvalidNode = (uint32_t)-1;
+
+        /** What the last update() did
+        */
+        struct UpdateStats
+        {
+            uint32_t nodeCount = 0;
+            uint32_t dirtyNodeCount = 0;        ///< Nodes whose local matrix changed
+            uint32_t updatedNodeCount = 0;      ///< Nodes whose world matrix was recomputed, the dirty nodes and their descendants
+            uint32_t levelCount = 0;            ///< Hierarchy levels with updated nodes
+            uint32_t threadCount = 0;
+            double propagateTimeMs = 0;         ///< Propagating the dirty flags down the hierarchy
+            double recomputeTimeMs = 0;
+        };
+
+        /** What the last upload() did
+        */
+        struct UploadStats
+        {
+            uint32_t uploadRangeCount = 0;      ///< Contiguous ranges uploaded, counted once for all the buffers
+            uint64_t uploadedBytes = 0;
+            bool reallocated = false;           ///< The buffers were recreated, and have to be bound again
+            double uploadTimeMs = 0;            ///< CPU time of queuing the uploads
+        };
+
+        /** Create an empty store
+            \param[in] threadCount The maximal number of threads update() uses. 0 uses all the hardware threads.
+        */
+        static SharedPtr create(uint32_t threadCount = 0);
+
+        /** Add a node
+            \param[in] local The node's transform relative to its parent
+            \param[in] parent The parent node, which must already be in the store, or kInvalidNode for a root
+            \return The node's index. Its world matrix is valid after the next update(). Its previous local matrix is the local matrix.
+        */
+        uint32_t addNode(const glm::mat4& local, uint32_t parent = kInvalidNode) { return addNode(local, local, parent); }
+
+        /** Add a node which moved in the current frame
+            \param[in] local The node's transform relative to its parent
+            \param[in] prevLocal The node's transform relative to its parent in the previous frame
+            \param[in] parent The parent node, which must already be in the store, or kInvalidNode for a root
+            \return The node's index. Its world matrix is valid after the next update().
+        */
+        uint32_t addNode(const glm::mat4& local, const glm::mat4& prevLocal, uint32_t parent);
+
+        /** Remove all the nodes. The GPU buffers are kept, and fully uploaded on the next upload().
+        */
+        void clear();
+
+        /** Set a node's local matrix. The matrix it replaces becomes the previous local matrix, and the node is only marked dirty if the matrix changed.
+        */
+        void setLocalMatrix(uint32_t node, const glm::mat4& local);
+
+        /** Set a node's local and previous local matrices, such as an ObjectInstance's getTransformMatrix() and getPrevTransformMatrix().
+            The node is only marked dirty if either of them changed.
+        */
+        void setLocalMatrix(uint32_t node, const glm::mat4& local, const glm::mat4& prevLocal);
+
+        /** Recompute the world and normal matrices of the nodes which changed since the last update
+        */
+        void update();
+
+        /** Upload the matrices which changed since the last upload, creating the buffers if needed
+            \return Whether the buffers were recreated. In that case they need to be bound again.
+        */
+        bool upload();
+
+        uint32_t getNodeCount() const { return (uint32_t)mLocal.size(); }
+        uint32_t getParent(uint32_t node) const { return mParent[node]; }
+        const glm::mat4& getLocalMatrix(uint32_t node) const { return mLocal[node]; }
+        const glm::mat4& getPrevLocalMatrix(uint32_t node) const { return mPrevLocal[node]; }
+        const glm::mat4& getWorldMatrix(uint32_t node) const { return mWorld[node]; }
+        const glm::mat4& getPrevWorldMatrix(uint32_t node) const { return mPrevWorld[node]; }
+
+        /** Get a node's normal matrix, the inverse transpose of the upper 3x3 of its world matrix. The 4th row is zero, and is there for HLSL's packing rules.
+        */
+        const glm::mat3x4& getNormalMatrix(uint32_t node) const { return mNormal[node]; }
+
+        /** The GPU copies of the matrix arrays, indexed by node. Null until the first upload().
+        */
+        const Buffer::SharedPtr& getWorldBuffer() const { return mpWorldBuffer; }
+        const Buffer::SharedPtr& getPrevWorldBuffer() const { return mpPrevWorldBuffer; }
+        const Buffer::SharedPtr& getNormalBuffer() const { return mpNormalBuffer; }
+
+        /** Get the number of update() calls so far
+        */
+        uint64_t getUpdateCount() const { return mUpdateCount; }
+
+        /** Get the nodes whose matrices were recomputed by the last update(), ordered by hierarchy level.
+            Users keeping data derived from the world matrices, such as world bounds, only need to refresh these nodes after each update().
+        */
+        const std::vector<uint32_t>& getUpdatedNodes() const { return mUpdatedNodes; }
+
+        const UpdateStats& getUpdateStats() const { return mUpdateStats; }
+        const UploadStats& getUploadStats() const { return mUploadStats; }
+
+        /** Get a one-line summary of the last update() and upload(), for logging
+        */
+        std::string getStatsString() const;
+
+    private:
+        TransformStore(uint32_t threadCount) : mThreadCount(threadCount) {}
+
+        struct Range
+        {
+            uint32_t first;
+            uint32_t count;
+        };
+
+        void recompute(const uint32_t* pNodes, uint32_t count);
+        void takeUploadRanges();
+        void uploadRanges(const std::vector<Range>& ranges, const Buffer::SharedPtr& pBuffer, const void* pData, size_t elementSize);
+
+        std::vector<glm::mat4> mLocal;
+        std::vector<glm::mat4> mPrevLocal;
+        std::vector<glm::mat4> mWorld;
+        std::vector<glm::mat4> mPrevWorld;
+        std::vector<glm::mat3x4> mNormal;
+        std::vector<uint32_t> mParent;
+        std::vector<uint32_t> mDepth;
+        std::vector<uint8_t> mFlags;
+
+        std::vector<std::vector<uint32_t>> mLevels; ///< Scratch space of update(), the nodes to recompute per hierarchy level
+        std::vector<uint32_t> mUpdatedNodes;        ///< Nodes recomputed by the last update()
+        std::vector<Range> mUploadRanges;           ///< Scratch space of upload()
+        uint32_t mDirtyCount = 0;
+        uint64_t mUpdateCount = 0;
+        bool mUploadPending = false;
+        bool mFullUpload = true;
+
+        uint32_t mThreadCount;
+        Buffer::SharedPtr mpWorldBuffer;
+        Buffer::SharedPtr mpPrevWorldBuffer;
+        Buffer::SharedPtr mpNormalBuffer;
+        uint32_t mCapacity = 0;
+        UpdateStats mUpdateStats;
+        UploadStats mUploadStats;
+    };
+}
@@ -0,0 +1,535 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureCooker.h"
+#include "Graphics/Scene/Scene.h"
+#include "Utils/BlockCompression.h"
+#include "Utils/MipGenerator.h"
+#include "Utils/Bitmap.h"
+#include "Utils/DDSHeader.h"
+#include "Utils/Platform/OS.h"
+#include "Utils/StringUtils.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ParallelFor.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <set>
+#include <cstdio>
+#include <cstring>
+
+namespace Falcor
+{
+    using namespace DdsHelper;
+
+    static const uint32_t kCookerVersion = 1;       // Bump when the encoders change, so existing baked files are ignored
+    static const uint32_t kDdsMagicNumber = 0x20534444;
+
+    namespace
+    {
+        // 64-bit FNV-1a, 8 bytes at a time
+        uint64_t hashData(const void* pData, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+        {
+            const uint64_t kPrime = 0x100000001b3ull;
+            const uint8_t* pBytes = (const uint8_t*)pData;
+            size_t words = size / sizeof(uint64_t);
+            for (size_t i = 0; i < words; i++)
+            {
+                uint64_t w;
+                std::memcpy(&w, pBytes + i * sizeof(uint64_t), sizeof(w));
+                hash = (hash ^ w) * kPrime;
+            }
+            for (size_t i = words * sizeof(uint64_t); i < size; i++)
+            {
+                hash = (hash ^ pBytes[i]) * kPrime;
+            }
+            return hash;
+        }
+
+        bool hashFile(const std::string& fullpath, uint64_t& hash)
+        {
+            size_t size;
+            const void* pData = mapFile(fullpath, size);
+            if (pData == nullptr) return false;
+            hash = hashData(pData, size);
+            unmapFile(pData, size);
+            return true;
+        }
+
+        uint64_t getMipChainSize(uint32_t width, uint32_t height, uint32_t mipCount, ResourceFormat format)
+        {
+            uint32_t blockWidth = getFormatWidthCompressionRatio(format);
+            uint32_t blockHeight = getFormatHeightCompressionRatio(format);
+            uint64_t size = 0;
+            for (uint32_t mip = 0; mip < mipCount; mip++)
+            {
+                uint64_t w = std::max(width >> mip, 1u), h = std::max(height >> mip, 1u);
+                size += ((w + blockWidth - 1) / blockWidth) * ((h + blockHeight - 1) / blockHeight) * getFormatBytesPerBlock(format);
+            }
+            return size;
+        }
+
+        DXFormat getDxgiFormat(ResourceFormat format)
+        {
+            switch (format)
+            {
+            case ResourceFormat::BC1Unorm:      return FORMAT_BC1_UNORM;
+            case ResourceFormat::BC1UnormSrgb:  return FORMAT_BC1_UNORM_SRGB;
+            case ResourceFormat::BC3Unorm:      return FORMAT_BC3_UNORM;
+            case ResourceFormat::BC3UnormSrgb:  return FORMAT_BC3_UNORM_SRGB;
+            case ResourceFormat::BC5Unorm:      return FORMAT_BC5_UNORM;
+            case ResourceFormat::BC7Unorm:      return FORMAT_BC7_UNORM;
+            case ResourceFormat::BC7UnormSrgb:  return FORMAT_BC7_UNORM_SRGB;
+            default:
+                should_not_get_here();
+                return FORMAT_UNKNOWN;
+            }
+        }
+
+        ResourceFormat getResourceFormat(DXFormat format)
+        {
+            switch (format)
+            {
+            case FORMAT_BC1_UNORM:      return ResourceFormat::BC1Unorm;
+            case FORMAT_BC1_UNORM_SRGB: return ResourceFormat::BC1UnormSrgb;
+            case FORMAT_BC3_UNORM:      return ResourceFormat::BC3Unorm;
+            case FORMAT_BC3_UNORM_SRGB: return ResourceFormat::BC3UnormSrgb;
+            case FORMAT_BC5_UNORM:      return ResourceFormat::BC5Unorm;
+            case FORMAT_BC7_UNORM:      return ResourceFormat::BC7Unorm;
+            case FORMAT_BC7_UNORM_SRGB: return ResourceFormat::BC7UnormSrgb;
+            default:                    return ResourceFormat::Unknown;
+            }
+        }
+
+        // Convert a decoded image to RGBA8, keeping what the shaders would sample from the uncompressed texture (missing channels read as 0, alpha as 1).
+        // Returns false for formats which can't be baked.
+        bool convertToRgba8(const Bitmap* pBitmap, std::vector<uint8_t>& rgba, bool& hasAlpha)
+        {
+            size_t pixelCount = (size_t)pBitmap->getWidth() * pBitmap->getHeight();
+            const uint8_t* pSrc = pBitmap->getData();
+            rgba.resize(pixelCount * 4);
+            hasAlpha = false;
+
+            switch (pBitmap->getFormat())
+            {
+            case ResourceFormat::BGRA8Unorm:
+            case ResourceFormat::BGRX8Unorm:
+            {
+                bool ignoreAlpha = (pBitmap->getFormat() == ResourceFormat::BGRX8Unorm);
+                for (size_t i = 0; i < pixelCount; i++)
+                {
+                    rgba[i * 4 + 0] = pSrc[i * 4 + 2];
+                    rgba[i * 4 + 1] = pSrc[i * 4 + 1];
+                    rgba[i * 4 + 2] = pSrc[i * 4 + 0];
+                    rgba[i * 4 + 3] = ignoreAlpha ? 0xff : pSrc[i * 4 + 3];
+                    hasAlpha = hasAlpha || (rgba[i * 4 + 3] != 0xff);
+                }
+                return true;
+            }
+            case ResourceFormat::RG8Unorm:
+                for (size_t i = 0; i < pixelCount; i++)
+                {
+                    rgba[i * 4 + 0] = pSrc[i * 2 + 0];
+                    rgba[i * 4 + 1] = pSrc[i * 2 + 1];
+                    rgba[i * 4 + 2] = 0;
+                    rgba[i * 4 + 3] = 0xff;
+                }
+                return true;
+            case ResourceFormat::R8Unorm:
+                for (size_t i = 0; i < pixelCount; i++)
+                {
+                    rgba[i * 4 + 0] = pSrc[i];
+                    rgba[i * 4 + 1] = 0;
+                    rgba[i * 4 + 2] = 0;
+                    rgba[i * 4 + 3] = 0xff;
+                }
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // Encode one mip-level. Blocks which extend past the edge of the level replicate the edge texels.
+        void encodeLevel(const uint8_t* pRgba, uint32_t width, uint32_t height, ResourceFormat format, uint8_t* pDst)
+        {
+            uint32_t blockSize = getFormatBytesPerBlock(format);
+            for (uint32_t by = 0; by < (height + 3) / 4; by++)
+            {
+                for (uint32_t bx = 0; bx < (width + 3) / 4; bx++)
+                {
+                    uint8_t pixels[64];
+                    for (uint32_t i = 0; i < 16; i++)
+                    {
+                        uint32_t x = std::min(bx * 4 + (i % 4), width - 1), y = std::min(by * 4 + (i / 4), height - 1);
+                        std::memcpy(pixels + i * 4, pRgba + (y * width + x) * 4, 4);
+                    }
+
+                    switch (format)
+                    {
+                    case ResourceFormat::BC1Unorm:
+                    case ResourceFormat::BC1UnormSrgb:
+                        BlockCompression::encodeBC1(pixels, pDst);
+                        break;
+                    case ResourceFormat::BC3Unorm:
+                    case ResourceFormat::BC3UnormSrgb:
+                        BlockCompression::encodeBC3(pixels, pDst);
+                        break;
+                    case ResourceFormat::BC5Unorm:
+                        BlockCompression::encodeBC5(pixels, pDst);
+                        break;
+                    case ResourceFormat::BC7Unorm:
+                    case ResourceFormat::BC7UnormSrgb:
+                        BlockCompression::encodeBC7(pixels, pDst);
+                        break;
+                    default:
+                        should_not_get_here();
+                    }
+                    pDst += blockSize;
+                }
+            }
+        }
+
+        // The format of the source image is stored in one of the reserved header fields, so the memory it saves can be reported without decoding the source
+        static const uint32_t kSourceFormatField = 9;
+
+        bool writeDdsFile(const std::string& filename, uint32_t width, uint32_t height, uint32_t mipCount, ResourceFormat format, ResourceFormat sourceFormat, const std::vector<uint8_t>& data)
+        {
+            DdsHeader header;
+            std::memset(&header, 0, sizeof(header));
+            header.headerSize = sizeof(DdsHeader);
+            header.flags = DdsHeader::kCapsMask | DdsHeader::kHeightMask | DdsHeader::kWidthMask | DdsHeader::kPixelFormatMask | DdsHeader::kMipCountMask | DdsHeader::kLinearSizeMask;
+            header.height = height;
+            header.width = width;
+            header.linearSize = (uint32_t)getMipChainSize(width, height, 1, format);
+            header.mipCount = mipCount;
+            header.pixelFormat.structSize = sizeof(DdsHeader::PixelFormat);
+            header.pixelFormat.flags = DdsHeader::PixelFormat::kFourCCFlag;
+            header.pixelFormat.fourCC = 0x30315844;     // 'DX10'
+            header.reserved[kSourceFormatField] = (uint32_t)sourceFormat;
+            header.caps[0] = DdsHeader::kCapsTextureMask | DdsHeader::kCapsComplexMask | DdsHeader::kCapsMipMapMask;
+
+            DdsHeaderDX10 dx10Header = {};
+            dx10Header.dxgiFormat = getDxgiFormat(format);
+            dx10Header.resourceDimension = RESOURCE_DIMENSION_TEXTURE2D;
+            dx10Header.arraySize = 1;
+
+            // Write to a temporary file first, so a crash or a concurrent load never sees a partial file
+            std::string tempFile = filename + ".tmp";
+            {
+                std::ofstream stream(tempFile, std::ios::binary | std::ios::trunc);
+                if (stream.is_open() == false) return false;
+                stream.write((const char*)&kDdsMagicNumber, sizeof(kDdsMagicNumber));
+                stream.write((const char*)&header, sizeof(header));
+                stream.write((const char*)&dx10Header, sizeof(dx10Header));
+                stream.write((const char*)data.data(), data.size());
+                if (stream.fail())
+                {
+                    stream.close();
+                    std::remove(tempFile.c_str());
+                    return false;
+                }
+            }
+
+            std::remove(filename.c_str());
+            if (std::rename(tempFile.c_str(), filename.c_str()) != 0)
+            {
+                std::remove(tempFile.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        std::string formatMB(uint64_t bytes)
+        {
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MB";
+            return ss.str();
+        }
+    }
+
+    struct TextureCooker::CookResult
+    {
+        enum class Status
+        {
+            Cooked,
+            UpToDate,
+            Skipped,
+        };
+
+        Status status = Status::Skipped;
+        uint64_t uncompressedBytes = 0;
+        uint64_t compressedBytes = 0;
+        uint64_t pixelsEncoded = 0;
+        double encodeTimeMs = 0;
+    };
+
+    bool TextureCooker::readCookedFileDesc(const std::string& filename, CookedFileDesc& desc)
+    {
+        std::ifstream stream(filename, std::ios::binary);
+        uint32_t magic = 0;
+        DdsHeader header;
+        DdsHeaderDX10 dx10Header;
+        stream.read((char*)&magic, sizeof(magic));
+        stream.read((char*)&header, sizeof(header));
+        stream.read((char*)&dx10Header, sizeof(dx10Header));
+        if (stream.fail() || magic != kDdsMagicNumber) return false;
+
+        desc.width = header.width;
+        desc.height = header.height;
+        desc.mipCount = std::max(header.mipCount, 1u);
+        desc.format = getResourceFormat(dx10Header.dxgiFormat);
+        desc.sourceFormat = (ResourceFormat)header.reserved[kSourceFormatField];
+        desc.dataOffset = sizeof(magic) + sizeof(header) + sizeof(dx10Header);
+        return desc.format != ResourceFormat::Unknown && desc.sourceFormat <= ResourceFormat::BC7UnormSrgb;
+    }
+
+    TextureCooker::SharedPtr TextureCooker::create(const Desc& desc)
+    {
+        if (isDirectoryExists(desc.directory) == false && createDirectory(desc.directory) == false)
+        {
+            logWarning("TextureCooker: Can't create the directory '" + desc.directory + "'. Textures will not be baked.");
+            return nullptr;
+        }
+        return SharedPtr(new TextureCooker(desc));
+    }
+
+    std::string TextureCooker::getCookedFilename(uint64_t sourceHash, bool isSrgb) const
+    {
+        uint64_t settings[] = { sourceHash, isSrgb ? 1u : 0u, mDesc.highQuality ? 1u : 0u, kCookerVersion };
+        std::stringstream ss;
+        ss << mDesc.directory << "/" << std::hex << std::setw(16) << std::setfill('0') << hashData(settings, sizeof(settings)) << ".dds";
+        return ss.str();
+    }
+
+    std::string TextureCooker::findCookedFile(const std::string& fullpath, bool isSrgb)
+    {
+        uint64_t sourceHash;
+        if (hashFile(fullpath, sourceHash) == false) return "";
+
+        std::string cookedFile = getCookedFilename(sourceHash, isSrgb);
+        if (doesFileExist(cookedFile) == false) return "";
+
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mStats.cookedLoads++;
+        return cookedFile;
+    }
+
+    void TextureCooker::cookTexture(const CookRequest& request, CookResult& result)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(request.filename, fullpath) == false)
+        {
+            logWarning("TextureCooker: Can't find '" + request.filename + "'");
+            return;
+        }
+        // DDS files are loaded as they are
+        if (hasSuffix(fullpath, ".dds", false)) return;
+
+        uint64_t sourceHash;
+        if (hashFile(fullpath, sourceHash) == false) return;
+        std::string cookedFile = getCookedFilename(sourceHash, request.isSrgb);
+
+        CookedFileDesc cookedDesc;
+        if (doesFileExist(cookedFile) && readCookedFileDesc(cookedFile, cookedDesc))
+        {
+            result.status = CookResult::Status::UpToDate;
+            result.uncompressedBytes = getMipChainSize(cookedDesc.width, cookedDesc.height, cookedDesc.mipCount, cookedDesc.sourceFormat);
+            result.compressedBytes = getMipChainSize(cookedDesc.width, cookedDesc.height, cookedDesc.mipCount, cookedDesc.format);
+            return;
+        }
+
+        uint32_t width, height, mipCount;
+        ResourceFormat format, sourceFormat;
+
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(fullpath, true);
+        if (pBitmap == nullptr) return;
+
+        width = pBitmap->getWidth();
+        height = pBitmap->getHeight();
+        mipCount = MipGenerator::getMipCount(width, height);
+        sourceFormat = pBitmap->getFormat();
+        result.uncompressedBytes = getMipChainSize(width, height, mipCount, sourceFormat);
+        result.compressedBytes = result.uncompressedBytes;
+
+        // Block-compressed textures must be a whole number of blocks
+        std::vector<uint8_t> rgba;
+        bool hasAlpha;
+        if ((width % 4) != 0 || (height % 4) != 0 || convertToRgba8(pBitmap.get(), rgba, hasAlpha) == false) return;
+        pBitmap = nullptr;
+
+        if (request.usage == Usage::NormalMap)
+        {
+            format = ResourceFormat::BC5Unorm;
+        }
+        else
+        {
+            format = mDesc.highQuality ? ResourceFormat::BC7Unorm : (hasAlpha ? ResourceFormat::BC3Unorm : ResourceFormat::BC1Unorm);
+            if (request.isSrgb) format = linearToSrgbFormat(format);
+        }
+
+        // Each cook runs on its own thread already, so the mip-chain is generated single-threaded
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        std::vector<uint8_t> levels;
+        MipGenerator::generate(rgba.data(), width, height, request.isSrgb ? ResourceFormat::RGBA8UnormSrgb : ResourceFormat::RGBA8Unorm, MipGenerator::Filter::Box, levels, 1);
+
+        std::vector<uint8_t> data(getMipChainSize(width, height, mipCount, format));
+        uint64_t srcOffset = 0;
+        uint64_t dstOffset = 0;
+        for (uint32_t mip = 0; mip < mipCount; mip++)
+        {
+            uint32_t w = std::max(width >> mip, 1u), h = std::max(height >> mip, 1u);
+            encodeLevel(levels.data() + srcOffset, w, h, format, data.data() + dstOffset);
+            srcOffset += (uint64_t)w * h * 4;
+            dstOffset += getMipChainSize(w, h, 1, format);
+            result.pixelsEncoded += (uint64_t)w * h;
+        }
+        result.encodeTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        if (writeDdsFile(cookedFile, width, height, mipCount, format, sourceFormat, data) == false)
+        {
+            logWarning("TextureCooker: Can't write '" + cookedFile + "'");
+            return;
+        }
+
+        result.status = CookResult::Status::Cooked;
+        result.compressedBytes = data.size();
+    }
+
+    void TextureCooker::cookTextures(const std::vector<CookRequest>& requests)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+
+        // The same image can be requested for several materials
+        std::vector<CookRequest> unique;
+        std::set<std::pair<std::string, bool>> seen;
+        for (const auto& r : requests)
+        {
+            if (seen.insert(std::make_pair(r.filename, r.isSrgb)).second) unique.push_back(r);
+        }
+
+        // Textures are baked in parallel, one texture per thread
+        std::vector<CookResult> results(unique.size());
+        uint32_t threadCount = mDesc.threadCount ? mDesc.threadCount : WorkerPool::get().getThreadCount();
+        threadCount = std::max(1u, std::min(threadCount, (uint32_t)unique.size()));
+        parallelFor((uint32_t)unique.size(), threadCount, [&](uint32_t i) { cookTexture(unique[i], results[i]); });
+
+        Stats total;
+        for (const auto& r : results)
+        {
+            switch (r.status)
+            {
+            case CookResult::Status::Cooked:   total.texturesCooked++; break;
+            case CookResult::Status::UpToDate: total.texturesUpToDate++; break;
+            case CookResult::Status::Skipped:  total.texturesSkipped++; break;
+            }
+            total.pixelsEncoded += r.pixelsEncoded;
+            total.encodeTimeMs += r.encodeTimeMs;
+            total.uncompressedBytes += r.uncompressedBytes;
+            total.compressedBytes += r.compressedBytes;
+        }
+        total.cookTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        double mpix = total.pixelsEncoded / 1.0e6;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1);
+        ss << "TextureCooker: " << total.texturesCooked << " textures baked, " << total.texturesUpToDate << " up to date, " << total.texturesSkipped << " left uncompressed";
+        if (total.texturesCooked)
+        {
+            ss << ". Encoded " << mpix << " MPix in " << total.cookTimeMs << " ms with " << threadCount << " threads: " << mpix / (total.cookTimeMs / 1000.0) << " MPix/s overall, "
+               << mpix / (total.encodeTimeMs / 1000.0) << " MPix/s per thread";
+        }
+        ss << ". GPU memory " << formatMB(total.uncompressedBytes) << " -> " << formatMB(total.compressedBytes) << ", saved " << formatMB(total.uncompressedBytes - total.compressedBytes);
+        logInfo(ss.str());
+
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mStats.texturesCooked += total.texturesCooked;
+        mStats.texturesUpToDate += total.texturesUpToDate;
+        mStats.texturesSkipped += total.texturesSkipped;
+        mStats.pixelsEncoded += total.pixelsEncoded;
+        mStats.encodeTimeMs += total.encodeTimeMs;
+        mStats.cookTimeMs += total.cookTimeMs;
+        mStats.uncompressedBytes += total.uncompressedBytes;
+        mStats.compressedBytes += total.compressedBytes;
+    }
+
+    void TextureCooker::cookScene(const Scene* pScene)
+    {
+        std::vector<CookRequest> requests;
+        std::set<const Texture*> seen;
+        auto addTexture = [&](const Texture::SharedPtr& pTexture, Usage usage)
+        {
+            if (pTexture == nullptr || pTexture->getSourceFilename().empty() || seen.insert(pTexture.get()).second == false) return;
+            CookRequest request;
+            request.filename = pTexture->getSourceFilename();
+            request.isSrgb = isSrgbFormat(pTexture->getFormat());
+            request.usage = usage;
+            requests.push_back(request);
+        };
+
+        // Height maps are left alone, BC1 doesn't have enough precision for them
+        for (uint32_t m = 0; m < pScene->getModelCount(); m++)
+        {
+            const Model* pModel = pScene->getModel(m).get();
+            for (uint32_t i = 0; i < pModel->getMeshCount(); i++)
+            {
+                const Material* pMaterial = pModel->getMesh(i)->getMaterial().get();
+                if (pMaterial == nullptr) continue;
+                addTexture(pMaterial->getBaseColorTexture(), Usage::Color);
+                addTexture(pMaterial->getSpecularTexture(), Usage::Color);
+                addTexture(pMaterial->getEmissiveTexture(), Usage::Color);
+                addTexture(pMaterial->getOcclusionMap(), Usage::Color);
+                addTexture(pMaterial->getLightMap(), Usage::Color);
+                addTexture(pMaterial->getNormalMap(), Usage::NormalMap);
+            }
+        }
+
+        cookTextures(requests);
+    }
+
+    TextureCooker::Stats TextureCooker::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        return mStats;
+    }
+
+    void TextureCooker::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mStats = Stats();
+    }
+
+    std::string TextureCooker::getStatsString() const
+    {
+        Stats stats = getStats();
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1);
+        ss << "TextureCooker: " << stats.cookedLoads << " baked textures loaded, " << stats.texturesCooked << " baked (" << stats.pixelsEncoded / 1.0e6 << " MPix in "
+           << stats.encodeTimeMs << " ms of encode time), " << stats.texturesUpToDate << " up to date, " << stats.texturesSkipped << " left uncompressed";
+        return ss.str();
+    }
+}
@@ -0,0 +1,154 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include "API/Formats.h"
+
+namespace Falcor
+{
+    class Scene;
+
+    /** Bakes textures into block-compressed DDS files with a full mip-chain, and finds the baked file for a texture at load time.
+        Uncompressed RGBA8 textures use 4x (BC3, BC5, BC7) to 8x (BC1) the memory and bandwidth of their block-compressed version.
+        Encoding is too slow to do at load time, so it runs as a separate cook step: cookScene() bakes all the textures a scene uses,
+        and later loads of those textures through createTextureFromFile() pick up the baked file instead of decoding the source image.
+        Install a cooker with setTextureCooker() for that to happen.
+
+        Baked files are named after a hash of the source image's content, so editing a texture invalidates its baked version
+        and identical textures in different locations share one file.
+
+        The format is chosen per texture:
+        - Normal maps use BC5. Materials use two-channel normal maps as-is (see NormalMapRG).
+        - Color textures use BC1 when they're opaque and BC3 when they have alpha, or BC7 in both cases if Desc::highQuality is set.
+        Only 8-bit images whose size is a multiple of 4 can be baked. Others (HDR images, height maps) are left uncompressed.
+    */
+    class TextureCooker
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TextureCooker>;
+        using SharedConstPtr = std::shared_ptr<const TextureCooker>;
+
+        struct Desc
+        {
+            std::string directory;      ///< Where the baked files are stored. Created if it doesn't exist.
+            bool highQuality = false;   ///< Encode color textures as BC7 instead of BC1/BC3
+            uint32_t threadCount = 0;   ///< Number of textures to bake concurrently. 0 uses one thread per hardware thread.
+        };
+
+        /** How a texture is used. This decides which format it is baked to.
+        */
+        enum class Usage
+        {
+            Color,          ///< Base color, specular, emissive, occlusion and light maps
+            NormalMap,      ///< Tangent space normal map
+        };
+
+        struct Stats
+        {
+            uint32_t texturesCooked = 0;        ///< Textures baked by cookTextures()
+            uint32_t texturesUpToDate = 0;      ///< Textures passed to cookTextures() which were already baked
+            uint32_t texturesSkipped = 0;       ///< Textures passed to cookTextures() which can't be baked
+            uint32_t cookedLoads = 0;           ///< Textures loaded from a baked file through findCookedFile()
+            uint64_t pixelsEncoded = 0;         ///< Number of pixels encoded, including the mip-levels
+            double encodeTimeMs = 0;            ///< Time spent encoding, summed over all threads
+            double cookTimeMs = 0;              ///< Wall-clock time spent in cookTextures()
+            uint64_t uncompressedBytes = 0;     ///< GPU memory the textures passed to cookTextures() take when loaded uncompressed
+            uint64_t compressedBytes = 0;       ///< GPU memory the same textures take when loaded from the baked files
+        };
+
+        /** Describes one texture to bake
+        */
+        struct CookRequest
+        {
+            std::string filename;       ///< The source image. Can also include a full path or relative path from a data directory
+            bool isSrgb = false;        ///< Whether the texture is loaded using an sRGB format
+            Usage usage = Usage::Color;
+        };
+
+        /** Describes a baked file
+        */
+        struct CookedFileDesc
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t mipCount = 0;
+            ResourceFormat format = ResourceFormat::Unknown;        ///< The block-compressed format
+            ResourceFormat sourceFormat = ResourceFormat::Unknown;  ///< The format of the decoded source image
+            uint64_t dataOffset = 0;    ///< Where the texel data starts. The mip-levels follow each other, largest first, each one tightly packed.
+        };
+
+        /** Read the header of a baked file.
+            \return false if the file can't be read or isn't a baked file
+        */
+        static bool readCookedFileDesc(const std::string& filename, CookedFileDesc& desc);
+
+        /** Create a cooker.
+            \return A new object, or nullptr if the directory doesn't exist and can't be created.
+        */
+        static SharedPtr create(const Desc& desc);
+
+        /** Find the baked version of a source image.
+            This reads the source file to hash it, which is much cheaper than decoding it. Can be called from multiple threads.
+            \param[in] fullpath The full path of the source image
+            \param[in] isSrgb Whether the texture is loaded using an sRGB format
+            \return The baked DDS file, or an empty string if the image wasn't baked.
+        */
+        std::string findCookedFile(const std::string& fullpath, bool isSrgb);
+
+        /** Bake textures which weren't baked yet. Logs the encode throughput and the memory the baked textures save.
+        */
+        void cookTextures(const std::vector<CookRequest>& requests);
+
+        /** Bake all the textures used by the materials of a scene. Logs the encode throughput and the memory the baked textures save.
+        */
+        void cookScene(const Scene* pScene);
+
+        Stats getStats() const;
+        void resetStats();
+
+        /** Get a one-line summary of the stats, for logging
+        */
+        std::string getStatsString() const;
+
+        const Desc& getDesc() const { return mDesc; }
+
+    private:
+        TextureCooker(const Desc& desc) : mDesc(desc) {}
+
+        struct CookResult;
+        std::string getCookedFilename(uint64_t sourceHash, bool isSrgb) const;
+        void cookTexture(const CookRequest& request, CookResult& result);
+
+        Desc mDesc;
+        Stats mStats;
+        mutable std::mutex mStatsMutex;     ///< findCookedFile() is called from the texture decode threads
+    };
+}
@@ -0,0 +1,85 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureFeedbackSimulator.h"
+#include <cmath>
+
+namespace Falcor
+{
+    TextureFeedbackSimulator::SharedPtr TextureFeedbackSimulator::create(const TextureResidency::SharedPtr& pResidency)
+    {
+        return SharedPtr(new TextureFeedbackSimulator(pResidency));
+    }
+
+    uint32_t TextureFeedbackSimulator::addSurface(const Surface& surface)
+    {
+        mSurfaces.push_back(surface);
+        return (uint32_t)mSurfaces.size() - 1;
+    }
+
+    uint32_t TextureFeedbackSimulator::simulateView(const View& view)
+    {
+        // Frustum planes, extracted the same way the Camera does
+        glm::vec4 planes[6];
+        glm::mat4 tempMat = glm::transpose(view.viewProjMat);
+        for (int i = 0; i < 6; i++)
+        {
+            planes[i] = (i & 1) ? tempMat[i >> 1] : -tempMat[i >> 1];
+            if (i != 5) planes[i] += tempMat[3];
+        }
+
+        // The size of a pixel at a distance of 1
+        float pixelSize = 2.0f * std::tan(view.fovY * 0.5f) / (float)std::max(view.viewportHeight, 1u);
+
+        uint32_t visibleCount = 0;
+        for (const auto& surface : mSurfaces)
+        {
+            const BoundingBox& box = surface.bounds;
+            bool isVisible = true;
+            for (int i = 0; i < 6 && isVisible; i++)
+            {
+                glm::vec3 normal(planes[i]);
+                isVisible = glm::dot(box.center + box.extent * glm::sign(normal), normal) > -planes[i].w;
+            }
+            float size = 2.0f * std::max(box.extent.x, std::max(box.extent.y, box.extent.z));
+            if (isVisible == false || size <= 0) continue;
+            visibleCount++;
+
+            // Textures are sampled finest at the closest point of the surface
+            float distance = glm::length(glm::max(glm::abs(view.position - box.center) - box.extent, glm::vec3(0)));
+            float uvPerPixel = surface.uvScale * distance * pixelSize / size;
+            for (uint32_t id : surface.textureIds)
+            {
+                const TextureResidency::TextureDesc& desc = mpResidency->getTextureDesc(id);
+                float texelsPerPixel = uvPerPixel * std::max(desc.width, desc.height);
+                mpResidency->requestMip(id, (texelsPerPixel > 1) ? std::log2(texelsPerPixel) : 0.0f);
+            }
+        }
+        return visibleCount;
+    }
+}
@@ -0,0 +1,94 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+#include "Graphics/TextureResidency.h"
+
+namespace Falcor
+{
+    /** Estimates texture usage on the CPU and feeds it to a TextureResidency.
+        Each surface is a bounding box with the textures of its material. For every surface a view can see, the mip-level its textures
+        are sampled at is estimated from the size of a pixel at the surface's closest point and from how often the texture repeats
+        across the surface. This stands in for GPU feedback, and lets residency policies be tested without a GPU: create a
+        TextureResidency, add textures and surfaces, then call simulateView() and TextureResidency::update() once per simulated frame.
+    */
+    class TextureFeedbackSimulator
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TextureFeedbackSimulator>;
+        using SharedConstPtr = std::shared_ptr<const TextureFeedbackSimulator>;
+
+        struct Surface
+        {
+            BoundingBox bounds;                 ///< World-space bounds
+            float uvScale = 1;                  ///< How many times the textures repeat across the largest side of the bounds
+            std::vector<uint32_t> textureIds;   ///< The textures of the surface's material, as TextureResidency IDs
+        };
+
+        struct View
+        {
+            glm::vec3 position;
+            glm::mat4 viewProjMat;
+            float fovY = 0;                     ///< Vertical field of view, in radians
+            uint32_t viewportHeight = 0;
+        };
+
+        static SharedPtr create(const TextureResidency::SharedPtr& pResidency);
+
+        /** Add a surface.
+            \return The surface's ID
+        */
+        uint32_t addSurface(const Surface& surface);
+
+        /** Update the bounds of a surface which moved
+        */
+        void setSurfaceBounds(uint32_t surfaceId, const BoundingBox& bounds) { mSurfaces[surfaceId].bounds = bounds; }
+
+        uint32_t getSurfaceCount() const { return (uint32_t)mSurfaces.size(); }
+
+        /** Remove all surfaces
+        */
+        void clearSurfaces() { mSurfaces.clear(); }
+
+        /** Request the mip-levels the surfaces visible from a view are sampled at. Can be called for several views before the residency is updated.
+            \return The number of visible surfaces
+        */
+        uint32_t simulateView(const View& view);
+
+        const TextureResidency::SharedPtr& getResidency() const { return mpResidency; }
+
+    private:
+        TextureFeedbackSimulator(const TextureResidency::SharedPtr& pResidency) : mpResidency(pResidency) {}
+
+        TextureResidency::SharedPtr mpResidency;
+        std::vector<Surface> mSurfaces;
+    };
+}
@@ -27,12 +27,23 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "TextureHelper.h"
+#include "TextureCooker.h"
+#include "TextureStreamer.h"
 #include "API/Texture.h"
 #include "Utils/Bitmap.h"
 #include "Utils/DDSHeader.h"
 #include "Utils/BinaryFileStream.h"
 #include "Utils/StringUtils.h"
+#include "Utils/Platform/OS.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/MipGenerator.h"
+#include "API/Device.h"
 #include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <map>
 
 static const bool kTopDown = true;
 
@@ -697,6 +708,90 @@ namespace Falcor
         return nullptr;
     }
 
+    static std::shared_ptr<TextureCooker> spTextureCooker;
+
+    void setTextureCooker(const std::shared_ptr<TextureCooker>& pCooker)
+    {
+        spTextureCooker = pCooker;
+    }
+
+    const std::shared_ptr<TextureCooker>& getTextureCooker()
+    {
+        return spTextureCooker;
+    }
+
+    static std::shared_ptr<TextureStreamer> spTextureStreamer;
+
+    void setTextureStreamer(const std::shared_ptr<TextureStreamer>& pStreamer)
+    {
+        spTextureStreamer = pStreamer;
+    }
+
+    const std::shared_ptr<TextureStreamer>& getTextureStreamer()
+    {
+        return spTextureStreamer;
+    }
+
+    static Texture::SharedPtr createTextureFromCookedFile(const std::string& cookedFile, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        Texture::SharedPtr pTex = spTextureStreamer ? spTextureStreamer->createTexture(cookedFile) : nullptr;
+        return pTex ? pTex : createTextureFromDDSFile(cookedFile, generateMipLevels, loadAsSrgb, bindFlags);
+    }
+
+    // Returns the baked version of an image, or an empty string if there isn't one or it can't be used for this texture
+    static std::string findCookedTexture(const std::string& fullpath, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        if (spTextureCooker == nullptr || generateMipLevels == false || bindFlags != Texture::BindFlags::ShaderResource) return "";
+        return spTextureCooker->findCookedFile(fullpath, loadAsSrgb);
+    }
+
+    static TextureMipGeneration sTextureMipGeneration = TextureMipGeneration::Gpu;
+
+    void setTextureMipGeneration(TextureMipGeneration mode)
+    {
+        sTextureMipGeneration = mode;
+    }
+
+    TextureMipGeneration getTextureMipGeneration()
+    {
+        return sTextureMipGeneration;
+    }
+
+    static ResourceFormat getBitmapTextureFormat(const Bitmap* pBitmap, bool loadAsSrgb)
+    {
+        return loadAsSrgb ? linearToSrgbFormat(pBitmap->getFormat()) : pBitmap->getFormat();
+    }
+
+    // Generates the mip-chain on the CPU if it's enabled and the format allows it. Returns false if the chain should be generated on the GPU.
+    static bool generateMipChain(const Bitmap* pBitmap, bool loadAsSrgb, std::vector<uint8_t>& chain, uint32_t threadCount)
+    {
+        if (sTextureMipGeneration == TextureMipGeneration::Gpu) return false;
+        MipGenerator::Filter filter = (sTextureMipGeneration == TextureMipGeneration::CpuKaiser) ? MipGenerator::Filter::Kaiser : MipGenerator::Filter::Box;
+        ResourceFormat format = getBitmapTextureFormat(pBitmap, loadAsSrgb);
+        return MipGenerator::isFormatSupported(format) && MipGenerator::generate(pBitmap->getData(), pBitmap->getWidth(), pBitmap->getHeight(), format, filter, chain, threadCount);
+    }
+
+    // pMipChain is a chain generated by generateMipChain(). If it's empty and the texture needs mips, they are generated here.
+    static Texture::SharedPtr createTextureFromBitmap(const Bitmap* pBitmap, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const std::vector<uint8_t>* pMipChain = nullptr)
+    {
+        if (pBitmap == nullptr) return nullptr;
+
+        ResourceFormat texFormat = getBitmapTextureFormat(pBitmap, loadAsSrgb);
+        uint32_t width = pBitmap->getWidth();
+        uint32_t height = pBitmap->getHeight();
+        if (generateMipLevels)
+        {
+            std::vector<uint8_t> chain;
+            if (pMipChain == nullptr && generateMipChain(pBitmap, loadAsSrgb, chain, 0)) pMipChain = &chain;
+            if (pMipChain && pMipChain->size())
+            {
+                return Texture::create2D(width, height, texFormat, 1, MipGenerator::getMipCount(width, height), pMipChain->data(), bindFlags);
+            }
+        }
+
+        return Texture::create2D(width, height, texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
+    }
+
     Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
     {
 #define no_srgb()   \
@@ -712,16 +807,16 @@ namespace Falcor
         }
         else
         {
-            Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
-            if(pBitmap)
+            std::string fullpath;
+            std::string cookedFile = findFileInDataDirectories(filename, fullpath) ? findCookedTexture(fullpath, generateMipLevels, loadAsSrgb, bindFlags) : "";
+            if (cookedFile.size())
             {
-                ResourceFormat texFormat = pBitmap->getFormat();
-                if(loadAsSrgb)
-                {
-                    texFormat = linearToSrgbFormat(texFormat);
-                }
-
-                pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
+                pTex = createTextureFromCookedFile(cookedFile, generateMipLevels, loadAsSrgb, bindFlags);
+            }
+            else
+            {
+                Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
+                pTex = createTextureFromBitmap(pBitmap.get(), generateMipLevels, loadAsSrgb, bindFlags);
             }
         }
 
@@ -733,4 +828,190 @@ namespace Falcor
         return pTex;
     }
 #undef no_srgb
+
+    static uint32_t sTextureDecodeThreadCount = 0;
+
+    void setTextureDecodeThreadCount(uint32_t threadCount)
+    {
+        sTextureDecodeThreadCount = threadCount;
+    }
+
+    uint32_t getTextureDecodeThreadCount()
+    {
+        return sTextureDecodeThreadCount;
+    }
+
+    std::vector<Texture::SharedPtr> createTexturesFromFiles(const std::vector<TextureFileDesc>& files, bool generateMipLevels, Texture::BindFlags bindFlags)
+    {
+        // Decoded images waiting for upload are capped at this size, so decoding far ahead of the upload doesn't exhaust memory
+        static const size_t kMaxPendingBytes = 1024 * 1024 * 1024;
+        // Flush the upload heap every so often, like createTextureFromFile() callers do per material
+        static const size_t kUploadFlushBytes = 256 * 1024 * 1024;
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        std::vector<Texture::SharedPtr> textures(files.size());
+
+        // Resolve and deduplicate the files. Missing files are reported here, on the calling thread.
+        struct Job
+        {
+            std::string fullpath;
+            std::string cookedFile;     ///< The baked version of the image, if there is one
+            bool loadAsSrgb;
+            bool isDds;
+            Bitmap::UniqueConstPtr pBitmap;
+            std::vector<uint8_t> mipChain;  ///< Generated on the CPU, if that's enabled
+            size_t size = 0;
+            bool decoded = false;
+        };
+        std::vector<Job> jobs;
+        std::vector<int32_t> fileToJob(files.size(), -1);
+        std::map<std::pair<std::string, bool>, int32_t> uniqueJobs;
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            std::string fullpath;
+            if (findFileInDataDirectories(files[i].filename, fullpath) == false)
+            {
+                logError("Error when loading image file " + files[i].filename + ". Can't find the file.");
+                continue;
+            }
+
+            auto key = std::make_pair(canonicalizeFilename(fullpath), files[i].loadAsSrgb);
+            auto it = uniqueJobs.find(key);
+            if (it == uniqueJobs.end())
+            {
+                it = uniqueJobs.insert(std::make_pair(key, (int32_t)jobs.size())).first;
+                jobs.emplace_back();
+                jobs.back().fullpath = fullpath;
+                jobs.back().loadAsSrgb = files[i].loadAsSrgb;
+                jobs.back().isDds = hasSuffix(fullpath, ".dds", false);
+            }
+            fileToJob[i] = it->second;
+        }
+
+        uint32_t threadCount = sTextureDecodeThreadCount ? sTextureDecodeThreadCount : std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::min(threadCount, (uint32_t)jobs.size());
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::atomic<uint32_t> nextJob(0);
+        size_t pendingBytes = 0;
+        uint32_t nextUpload = 0;
+        uint64_t mipTexels = 0;
+        double mipTimeMs = 0;
+
+        auto decodeJob = [&](uint32_t jobId)
+        {
+            Job& job = jobs[jobId];
+            if (job.isDds == false)
+            {
+                job.cookedFile = findCookedTexture(job.fullpath, generateMipLevels, job.loadAsSrgb, bindFlags);
+            }
+            if (job.isDds == false && job.cookedFile.empty())
+            {
+                // Wait for the upload to catch up. The job the upload is waiting for must never wait, or we'd deadlock.
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond.wait(lock, [&] { return pendingBytes < kMaxPendingBytes || jobId <= nextUpload; });
+                }
+                job.pBitmap = Bitmap::createFromFile(job.fullpath, kTopDown);
+            }
+
+            // The decode threads already run in parallel, so each chain is generated on a single thread
+            double jobMipTimeMs = 0;
+            if (job.pBitmap && generateMipLevels)
+            {
+                CpuTimer::TimePoint mipStart = CpuTimer::getCurrentTimePoint();
+                if (generateMipChain(job.pBitmap.get(), job.loadAsSrgb, job.mipChain, 1))
+                {
+                    jobMipTimeMs = CpuTimer::calcDuration(mipStart, CpuTimer::getCurrentTimePoint());
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (job.pBitmap) job.size = (size_t)job.pBitmap->getWidth() * job.pBitmap->getHeight() * getFormatBytesPerBlock(job.pBitmap->getFormat()) + job.mipChain.size();
+            if (job.mipChain.size())
+            {
+                mipTexels += (uint64_t)job.pBitmap->getWidth() * job.pBitmap->getHeight();
+                mipTimeMs += jobMipTimeMs;
+            }
+            pendingBytes += job.size;
+            job.decoded = true;
+            cond.notify_all();
+        };
+
+        // With a single thread, the calling thread decodes each file right before uploading it. Otherwise it only uploads.
+        // These aren't WorkerPool tasks: parallelFor() blocks the caller until all tasks are done, but here the calling thread has to
+        // create and upload the textures (it owns the render context) while the decoding is still running.
+        std::vector<std::thread> threads;
+        if (threadCount > 1)
+        {
+            for (uint32_t i = 0; i < threadCount; i++)
+            {
+                threads.push_back(std::thread([&]()
+                {
+                    for (uint32_t jobId = nextJob++; jobId < jobs.size(); jobId = nextJob++) decodeJob(jobId);
+                }));
+            }
+        }
+
+        size_t uploadedBytes = 0;
+        std::vector<Texture::SharedPtr> jobTextures(jobs.size());
+        for (uint32_t jobId = 0; jobId < jobs.size(); jobId++)
+        {
+            Job& job = jobs[jobId];
+            if (threads.empty()) decodeJob(jobId);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return job.decoded; });
+            }
+
+            Texture::SharedPtr pTex;
+            if (job.isDds)
+            {
+                pTex = createTextureFromDDSFile(job.fullpath, generateMipLevels, job.loadAsSrgb, bindFlags);
+            }
+            else if (job.cookedFile.size())
+            {
+                pTex = createTextureFromCookedFile(job.cookedFile, generateMipLevels, job.loadAsSrgb, bindFlags);
+            }
+            else
+            {
+                pTex = createTextureFromBitmap(job.pBitmap.get(), generateMipLevels, job.loadAsSrgb, bindFlags, &job.mipChain);
+            }
+            if (pTex) pTex->setSourceFilename(stripDataDirectories(job.fullpath));
+            jobTextures[jobId] = pTex;
+
+            uploadedBytes += job.size;
+            if (uploadedBytes >= kUploadFlushBytes)
+            {
+                gpDevice->flushAndSync();
+                uploadedBytes = 0;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job.pBitmap = nullptr;
+                job.mipChain = std::vector<uint8_t>();
+                pendingBytes -= job.size;
+                nextUpload = jobId + 1;
+            }
+            cond.notify_all();
+        }
+
+        for (auto& t : threads) t.join();
+        if (uploadedBytes) gpDevice->flushAndSync();
+
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            if (fileToJob[i] >= 0) textures[i] = jobTextures[fileToJob[i]];
+        }
+
+        logInfo("createTexturesFromFiles(): " + std::to_string(jobs.size()) + " textures (" + std::to_string(files.size() - jobs.size()) + " duplicate or missing) loaded with " +
+            std::to_string(std::max(1u, threadCount)) + " decode threads in " + std::to_string(CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint())) + " ms");
+        if (mipTexels)
+        {
+            logInfo("createTexturesFromFiles(): Generated mip-chains for " + std::to_string(mipTexels / 1000000.0) + " MPix on the CPU, " + std::to_string(mipTexels / (std::max(mipTimeMs, 0.001) * 1000.0)) + " MPix/s per thread");
+        }
+        return textures;
+    }
 }
@@ -27,9 +27,13 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
 #include "API/Texture.h"
 namespace Falcor
 {
+    class TextureCooker;
+    class TextureStreamer;
+
     /*!
     *  \addtogroup Falcor
     *  @{
@@ -43,5 +47,70 @@ namespace Falcor
     */
     Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
 
+    /** Describes one file in a batch passed to createTexturesFromFiles()
+    */
+    struct TextureFileDesc
+    {
+        std::string filename;       ///< Filename of the image. Can also include a full path or relative path from a data directory
+        bool loadAsSrgb = false;    ///< Load the texture using sRGB format
+    };
+
+    /** Create textures from a batch of files.
+        Decoding and format conversion run on worker threads (see setTextureDecodeThreadCount()), while the textures are created and
+        uploaded on the calling thread in the order of the files, overlapping with the decoding of later files. Files which resolve to
+        the same path and color space are loaded once and share a texture object.
+        DDS files and baked textures (see setTextureCooker()) are loaded on the calling thread, since they don't need decoding.
+        \param[in] files The files to load
+        \param[in] generateMipLevels Whether the mip-chains should be generated
+        \param[in] bindFlags The bind flags to create the textures with
+        \return One texture per entry in files, nullptr for files that failed to load
+    */
+    std::vector<Texture::SharedPtr> createTexturesFromFiles(const std::vector<TextureFileDesc>& files, bool generateMipLevels, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
+    /** Set the number of threads createTexturesFromFiles() decodes images with. 0 (the default) uses one thread per hardware thread, 1 decodes on the calling thread.
+    */
+    void setTextureDecodeThreadCount(uint32_t threadCount);
+
+    /** Get the number of decode threads set by setTextureDecodeThreadCount()
+    */
+    uint32_t getTextureDecodeThreadCount();
+
+    /** Where the mip-chains of textures created from images are generated
+    */
+    enum class TextureMipGeneration
+    {
+        Gpu,            ///< Texture::generateMips() after the upload. This is the default.
+        CpuBox,         ///< MipGenerator with a box filter. The whole chain is uploaded with the texture.
+        CpuKaiser,      ///< MipGenerator with a Kaiser filter. The whole chain is uploaded with the texture.
+    };
+
+    /** Set where createTextureFromFile() and createTexturesFromFiles() generate mip-chains. With the CPU modes, createTexturesFromFiles()
+        generates the chains on its decode threads. Formats MipGenerator doesn't support always use the GPU.
+    */
+    void setTextureMipGeneration(TextureMipGeneration mode);
+
+    /** Get the mode set by setTextureMipGeneration()
+    */
+    TextureMipGeneration getTextureMipGeneration();
+
+    /** Set the texture cooker to take baked textures from. When set, createTextureFromFile() and createTexturesFromFiles() load the
+        block-compressed version of an image if it was baked, instead of decoding the image. This only applies to shader-resource textures
+        which request a mip-chain. Pass nullptr to always load the source images.
+    */
+    void setTextureCooker(const std::shared_ptr<TextureCooker>& pCooker);
+
+    /** Get the texture cooker set by setTextureCooker()
+    */
+    const std::shared_ptr<TextureCooker>& getTextureCooker();
+
+    /** Set the texture streamer to create baked textures with. When set, textures loaded from a baked file (see setTextureCooker()) start
+        with only their mip tail, and the streamer loads the finer levels when they're needed. Pass nullptr to load baked files fully.
+    */
+    void setTextureStreamer(const std::shared_ptr<TextureStreamer>& pStreamer);
+
+    /** Get the texture streamer set by setTextureStreamer()
+    */
+    const std::shared_ptr<TextureStreamer>& getTextureStreamer();
+
     /*! @} */
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureResidency.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    namespace
+    {
+        static const uint32_t kNoRequest = uint32_t(-1);
+
+        std::string formatMB(uint64_t bytes)
+        {
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MB";
+            return ss.str();
+        }
+    }
+
+    TextureResidency::SharedPtr TextureResidency::create(const Desc& desc)
+    {
+        Desc d = desc;
+        d.tailSize = std::max(d.tailSize, 1u);
+        return SharedPtr(new TextureResidency(d));
+    }
+
+    uint64_t TextureResidency::getLevelsSize(const TextureDesc& desc, uint32_t topMip)
+    {
+        uint32_t blockWidth = getFormatWidthCompressionRatio(desc.format);
+        uint32_t blockHeight = getFormatHeightCompressionRatio(desc.format);
+        uint64_t size = 0;
+        for (uint32_t mip = topMip; mip < std::max(desc.mipCount, 1u); mip++)
+        {
+            uint64_t w = std::max(desc.width >> mip, 1u), h = std::max(desc.height >> mip, 1u);
+            size += ((w + blockWidth - 1) / blockWidth) * ((h + blockHeight - 1) / blockHeight) * getFormatBytesPerBlock(desc.format);
+        }
+        return size;
+    }
+
+    uint32_t TextureResidency::findTailMip(const TextureDesc& desc) const
+    {
+        // The finest resident level becomes the top level of the texture, and the top level of a block-compressed texture must be a whole number of blocks
+        uint32_t blockWidth = getFormatWidthCompressionRatio(desc.format);
+        uint32_t blockHeight = getFormatHeightCompressionRatio(desc.format);
+        uint32_t tailMip = 0;
+        while (tailMip + 1 < desc.mipCount && std::max(desc.width >> tailMip, desc.height >> tailMip) > mDesc.tailSize)
+        {
+            uint32_t next = tailMip + 1;
+            if (((desc.width >> next) % blockWidth) != 0 || ((desc.height >> next) % blockHeight) != 0) break;
+            tailMip = next;
+        }
+        return tailMip;
+    }
+
+    uint32_t TextureResidency::addTexture(const TextureDesc& desc)
+    {
+        TextureState t;
+        t.desc = desc;
+        t.desc.mipCount = std::max(desc.mipCount, 1u);
+        t.levelsSize.resize(t.desc.mipCount + 1, 0);
+        for (uint32_t mip = 0; mip < t.desc.mipCount; mip++) t.levelsSize[mip] = getLevelsSize(t.desc, mip);
+        t.tailMip = findTailMip(t.desc);
+        t.residentMip = t.tailMip;
+        t.usedMip = t.tailMip;
+        t.requestedMip = kNoRequest;
+
+        mStats.textureCount++;
+        mStats.residentBytes += t.levelsSize[t.tailMip];
+        mStats.tailBytes += t.levelsSize[t.tailMip];
+        mStats.fullBytes += t.levelsSize[0];
+        mTextures.push_back(t);
+        return (uint32_t)mTextures.size() - 1;
+    }
+
+    uint64_t TextureResidency::getLevelsSize(uint32_t textureId, uint32_t topMip) const
+    {
+        const TextureState& t = mTextures[textureId];
+        return t.levelsSize[std::min(topMip, t.desc.mipCount)];
+    }
+
+    void TextureResidency::requestMip(uint32_t textureId, float mip)
+    {
+        TextureState& t = mTextures[textureId];
+        uint32_t level = (mip > 0) ? std::min((uint32_t)mip, t.tailMip) : 0;
+        t.requestedMip = std::min(t.requestedMip, level);
+    }
+
+    void TextureResidency::setResidentMip(uint32_t textureId, uint32_t mip, std::vector<Change>& changes)
+    {
+        TextureState& t = mTextures[textureId];
+        mStats.residentBytes = mStats.residentBytes + t.levelsSize[mip] - t.levelsSize[t.residentMip];
+        t.residentMip = mip;
+        changes.push_back({ textureId, mip });
+    }
+
+    void TextureResidency::update(std::vector<Change>& changes)
+    {
+        mUpdateCount++;
+        mStats.usedBytes = 0;
+        mStats.texturesUsed = 0;
+
+        // Collect the requests. Textures missing the most levels are loaded first.
+        std::vector<uint32_t> loads;
+        for (uint32_t id = 0; id < mTextures.size(); id++)
+        {
+            TextureState& t = mTextures[id];
+            if (t.requestedMip == kNoRequest) continue;
+            t.lastUsed = mUpdateCount;
+            t.usedMip = t.requestedMip;
+            t.requestedMip = kNoRequest;
+            mStats.texturesUsed++;
+            mStats.usedBytes += t.levelsSize[t.usedMip];
+            if (t.usedMip < t.residentMip) loads.push_back(id);
+        }
+        std::stable_sort(loads.begin(), loads.end(), [this](uint32_t a, uint32_t b)
+        {
+            return (mTextures[a].residentMip - mTextures[a].usedMip) > (mTextures[b].residentMip - mTextures[b].usedMip);
+        });
+
+        // Memory that can be reclaimed, least recently used first
+        auto getTrimMip = [this](const TextureState& t) { return (t.lastUsed == mUpdateCount) ? t.usedMip : t.tailMip; };
+        std::vector<uint32_t> reclaimable;
+        for (uint32_t id = 0; id < mTextures.size(); id++)
+        {
+            if (mTextures[id].residentMip < getTrimMip(mTextures[id])) reclaimable.push_back(id);
+        }
+        std::stable_sort(reclaimable.begin(), reclaimable.end(), [this](uint32_t a, uint32_t b) { return mTextures[a].lastUsed < mTextures[b].lastUsed; });
+
+        size_t nextReclaim = 0;
+        auto reclaim = [&](uint64_t neededBytes)
+        {
+            while (mStats.residentBytes + neededBytes > mDesc.memoryBudget && nextReclaim < reclaimable.size())
+            {
+                uint32_t id = reclaimable[nextReclaim++];
+                setResidentMip(id, getTrimMip(mTextures[id]), changes);
+                mStats.evictions++;
+            }
+        };
+
+        // The budget may have been lowered
+        reclaim(0);
+
+        uint64_t loadedBytes = 0;
+        for (uint32_t id : loads)
+        {
+            if (loadedBytes >= mDesc.maxLoadBytesPerUpdate) break;
+            const TextureState& t = mTextures[id];
+            reclaim(t.levelsSize[t.usedMip] - t.levelsSize[t.residentMip]);
+
+            // Take as many of the requested levels as fit
+            uint32_t mip = t.usedMip;
+            while (mip < t.residentMip && mStats.residentBytes + t.levelsSize[mip] - t.levelsSize[t.residentMip] > mDesc.memoryBudget) mip++;
+            if (mip == t.residentMip) continue;
+
+            setResidentMip(id, mip, changes);
+            mStats.loads++;
+            mStats.bytesLoaded += t.levelsSize[mip];
+            loadedBytes += t.levelsSize[mip];
+        }
+
+        mStats.texturesWaiting = 0;
+        for (const auto& t : mTextures)
+        {
+            if (t.lastUsed == mUpdateCount && t.usedMip < t.residentMip) mStats.texturesWaiting++;
+        }
+    }
+
+    std::string TextureResidency::getStatsString() const
+    {
+        return "TextureResidency: " + std::to_string(mStats.textureCount) + " textures, " + formatMB(mStats.residentBytes) + " resident of a " + formatMB(mDesc.memoryBudget) +
+            " budget (tails " + formatMB(mStats.tailBytes) + ", fully resident " + formatMB(mStats.fullBytes) + "). " + std::to_string(mStats.texturesUsed) + " textures used, needing " +
+            formatMB(mStats.usedBytes) + ", " + std::to_string(mStats.texturesWaiting) + " waiting. " + std::to_string(mStats.loads) + " loads (" + formatMB(mStats.bytesLoaded) + "), " +
+            std::to_string(mStats.evictions) + " evictions";
+    }
+}
@@ -0,0 +1,162 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "API/Formats.h"
+
+namespace Falcor
+{
+    /** Decides which mip-levels of streamed textures are resident, under a memory budget.
+        This is only the policy. It doesn't touch files or the GPU, so it can be driven by TextureFeedbackSimulator to test policies
+        without a GPU. TextureStreamer applies its decisions to real textures.
+
+        Every texture always keeps its mip tail resident: the levels no larger than Desc::tailSize. Finer levels are made resident
+        when requestMip() asks for them, in order of how many levels are missing. When that would exceed the budget, memory is
+        reclaimed, least recently used textures first: levels finer than a texture was last used at are dropped, and textures that
+        weren't used in the current update drop back to their tail. Textures used in the current update are never trimmed below the
+        level they are used at, so they can't thrash against each other. If there's still not enough memory, a texture gets as many
+        of the levels it asked for as fit.
+    */
+    class TextureResidency
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TextureResidency>;
+        using SharedConstPtr = std::shared_ptr<const TextureResidency>;
+
+        struct Desc
+        {
+            uint64_t memoryBudget = 512ull * 1024 * 1024;           ///< Memory all streamed textures may use together, including their tails
+            uint32_t tailSize = 64;                                 ///< Levels whose width and height are no larger than this are always resident
+            uint64_t maxLoadBytesPerUpdate = 32ull * 1024 * 1024;   ///< Limits the data loaded per update(), to spread loading over several frames
+        };
+
+        struct TextureDesc
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t mipCount = 0;
+            ResourceFormat format = ResourceFormat::Unknown;
+        };
+
+        /** A texture whose resident levels change. The levels from topMip down to the smallest one become resident.
+        */
+        struct Change
+        {
+            uint32_t textureId;
+            uint32_t topMip;
+        };
+
+        struct Stats
+        {
+            uint32_t textureCount = 0;
+            uint64_t residentBytes = 0;     ///< Memory used by the resident levels
+            uint64_t tailBytes = 0;         ///< Memory used by the mip tails
+            uint64_t fullBytes = 0;         ///< Memory all the textures would use if they were fully resident
+            uint64_t usedBytes = 0;         ///< Memory the textures used in the last update would need at the levels they're used at
+            uint32_t texturesUsed = 0;      ///< Textures used in the last update
+            uint32_t texturesWaiting = 0;   ///< Textures used in the last update at a finer level than the resident one
+            uint64_t loads = 0;             ///< Changes which made finer levels resident
+            uint64_t evictions = 0;         ///< Changes which dropped levels
+            uint64_t bytesLoaded = 0;       ///< Data loaded by the loads. Each load reads all the levels that become resident.
+        };
+
+        static SharedPtr create(const Desc& desc);
+
+        /** Add a texture. Its mip tail is resident from the start.
+            \return The texture's ID
+        */
+        uint32_t addTexture(const TextureDesc& desc);
+
+        /** Get the level a texture's mip tail would start at, if it was added
+        */
+        uint32_t findTailMip(const TextureDesc& desc) const;
+
+        /** Get the memory used by the levels of a texture from topMip down to the smallest one
+        */
+        static uint64_t getLevelsSize(const TextureDesc& desc, uint32_t topMip);
+
+        /** Get the number of textures added
+        */
+        uint32_t getTextureCount() const { return (uint32_t)mTextures.size(); }
+
+        const TextureDesc& getTextureDesc(uint32_t textureId) const { return mTextures[textureId].desc; }
+
+        /** Get the finest level of a texture's mip tail
+        */
+        uint32_t getTailMip(uint32_t textureId) const { return mTextures[textureId].tailMip; }
+
+        /** Get the finest resident level of a texture
+        */
+        uint32_t getResidentMip(uint32_t textureId) const { return mTextures[textureId].residentMip; }
+
+        /** Get the memory used by the levels of an added texture from topMip down to the smallest one
+        */
+        uint64_t getLevelsSize(uint32_t textureId, uint32_t topMip) const;
+
+        /** Report that a texture is used at a mip-level. Fractional levels are rounded towards the finer level.
+            Call this any number of times between updates. The finest level reported since the last update is the one requested.
+        */
+        void requestMip(uint32_t textureId, float mip);
+
+        /** Decide which levels to make resident, based on the requests since the last update.
+            \param[out] changes The textures whose resident levels change. The new levels are considered resident right away.
+        */
+        void update(std::vector<Change>& changes);
+
+        const Stats& getStats() const { return mStats; }
+
+        /** Get a one-line summary of the stats, for logging
+        */
+        std::string getStatsString() const;
+
+        const Desc& getDesc() const { return mDesc; }
+
+    private:
+        TextureResidency(const Desc& desc) : mDesc(desc) {}
+
+        struct TextureState
+        {
+            TextureDesc desc;
+            std::vector<uint64_t> levelsSize;   ///< levelsSize[mip] is the size of levels mip..mipCount-1
+            uint32_t tailMip = 0;
+            uint32_t residentMip = 0;
+            uint32_t usedMip = 0;               ///< The level the texture was last used at
+            uint32_t requestedMip = 0;          ///< The finest level requested since the last update, or kNoRequest
+            uint64_t lastUsed = 0;              ///< The update the texture was last used in. 0 if it was never used.
+        };
+
+        void setResidentMip(uint32_t textureId, uint32_t mip, std::vector<Change>& changes);
+
+        Desc mDesc;
+        Stats mStats;
+        std::vector<TextureState> mTextures;
+        uint64_t mUpdateCount = 0;
+    };
+}
@@ -0,0 +1,331 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureStreamer.h"
+#include "Graphics/Scene/Scene.h"
+#include "Graphics/Camera/Camera.h"
+#include "Graphics/Material/Material.h"
+#include "API/RenderContext.h"
+#include "Utils/Math/FalcorMath.h"
+#include <fstream>
+#include <unordered_map>
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace
+    {
+        bool readFileRange(const std::string& filename, uint64_t offset, uint64_t size, std::vector<uint8_t>& data)
+        {
+            std::ifstream stream(filename, std::ios::binary);
+            if (stream.is_open() == false) return false;
+            data.resize((size_t)size);
+            stream.seekg(offset);
+            stream.read((char*)data.data(), size);
+            return stream.fail() == false;
+        }
+    }
+
+    TextureStreamer::SharedPtr TextureStreamer::create(const TextureResidency::Desc& desc)
+    {
+        return SharedPtr(new TextureStreamer(desc));
+    }
+
+    TextureStreamer::TextureStreamer(const TextureResidency::Desc& desc)
+    {
+        mpResidency = TextureResidency::create(desc);
+        mpFeedback = TextureFeedbackSimulator::create(mpResidency);
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+        if (mLoader.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mLoadMutex);
+                mStopLoader = true;
+            }
+            mLoadCond.notify_all();
+            mLoader.join();
+        }
+    }
+
+    Texture::SharedPtr TextureStreamer::createTexture(const std::string& cookedFile)
+    {
+        StreamedTexture t;
+        t.filename = cookedFile;
+        if (TextureCooker::readCookedFileDesc(cookedFile, t.fileDesc) == false) return nullptr;
+
+        const TextureCooker::CookedFileDesc& fd = t.fileDesc;
+        TextureResidency::TextureDesc desc;
+        desc.width = fd.width;
+        desc.height = fd.height;
+        desc.mipCount = fd.mipCount;
+        desc.format = fd.format;
+        t.topMip = mpResidency->findTailMip(desc);
+
+        uint64_t fullSize = TextureResidency::getLevelsSize(desc, 0);
+        uint64_t tailSize = TextureResidency::getLevelsSize(desc, t.topMip);
+        std::vector<uint8_t> data;
+        if (readFileRange(cookedFile, fd.dataOffset + fullSize - tailSize, tailSize, data) == false)
+        {
+            logWarning("TextureStreamer: Can't read '" + cookedFile + "'");
+            return nullptr;
+        }
+
+        t.pTexture = Texture::create2D(fd.width >> t.topMip, fd.height >> t.topMip, fd.format, 1, fd.mipCount - t.topMip, data.data(), Texture::BindFlags::ShaderResource);
+        if (t.pTexture == nullptr) return nullptr;
+
+        mpResidency->addTexture(desc);
+        mTextures.push_back(t);
+        return t.pTexture;
+    }
+
+    Texture::SharedPtr TextureStreamer::getMaterialTexture(const Material* pMaterial, Slot slot)
+    {
+        switch (slot)
+        {
+        case Slot::BaseColor:       return pMaterial->getBaseColorTexture();
+        case Slot::Specular:        return pMaterial->getSpecularTexture();
+        case Slot::Emissive:        return pMaterial->getEmissiveTexture();
+        case Slot::NormalMap:       return pMaterial->getNormalMap();
+        case Slot::OcclusionMap:    return pMaterial->getOcclusionMap();
+        case Slot::LightMap:        return pMaterial->getLightMap();
+        default:                    should_not_get_here(); return nullptr;
+        }
+    }
+
+    void TextureStreamer::setScene(const std::shared_ptr<Scene>& pScene)
+    {
+        mpScene = pScene;
+        mpFeedback->clearSurfaces();
+        for (auto& t : mTextures) t.users.clear();
+        if (pScene == nullptr) return;
+
+        std::unordered_map<const Texture*, uint32_t> textureIds;
+        for (uint32_t id = 0; id < mTextures.size(); id++) textureIds[mTextures[id].pTexture.get()] = id;
+
+        // Find the streamed textures of each material
+        std::unordered_map<const Material*, std::vector<uint32_t>> materialTextures;
+        for (uint32_t m = 0; m < pScene->getModelCount(); m++)
+        {
+            const Model* pModel = pScene->getModel(m).get();
+            for (uint32_t i = 0; i < pModel->getMeshCount(); i++)
+            {
+                const Material::SharedPtr& pMaterial = pModel->getMesh(i)->getMaterial();
+                if (pMaterial == nullptr || materialTextures.count(pMaterial.get())) continue;
+
+                std::vector<uint32_t>& ids = materialTextures[pMaterial.get()];
+                for (uint32_t slot = 0; slot < (uint32_t)Slot::Count; slot++)
+                {
+                    auto it = textureIds.find(getMaterialTexture(pMaterial.get(), (Slot)slot).get());
+                    if (it == textureIds.end()) continue;
+                    mTextures[it->second].users.push_back(std::make_pair(pMaterial, (Slot)slot));
+                    if (std::find(ids.begin(), ids.end(), it->second) == ids.end()) ids.push_back(it->second);
+                }
+            }
+        }
+
+        // A feedback surface for each mesh instance with streamed textures. update() refreshes their bounds in the same order.
+        for (uint32_t m = 0; m < pScene->getModelCount(); m++)
+        {
+            for (uint32_t inst = 0; inst < pScene->getModelInstanceCount(m); inst++)
+            {
+                const auto& pModelInstance = pScene->getModelInstance(m, inst);
+                const Model* pModel = pModelInstance->getObject().get();
+                for (uint32_t mesh = 0; mesh < pModel->getMeshCount(); mesh++)
+                {
+                    for (uint32_t i = 0; i < pModel->getMeshInstanceCount(mesh); i++)
+                    {
+                        const auto& pMeshInstance = pModel->getMeshInstance(mesh, i);
+                        TextureFeedbackSimulator::Surface surface;
+                        surface.bounds = pMeshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
+                        surface.textureIds = materialTextures[pMeshInstance->getObject()->getMaterial().get()];
+                        mpFeedback->addSurface(surface);
+                    }
+                }
+            }
+        }
+    }
+
+    void TextureStreamer::update(RenderContext* pContext, const Camera* pCamera, uint32_t viewportHeight)
+    {
+        if (mpScene && pCamera)
+        {
+            // Objects may have moved
+            uint32_t surfaceId = 0;
+            for (uint32_t m = 0; m < mpScene->getModelCount(); m++)
+            {
+                for (uint32_t inst = 0; inst < mpScene->getModelInstanceCount(m); inst++)
+                {
+                    const auto& pModelInstance = mpScene->getModelInstance(m, inst);
+                    const Model* pModel = pModelInstance->getObject().get();
+                    for (uint32_t mesh = 0; mesh < pModel->getMeshCount(); mesh++)
+                    {
+                        for (uint32_t i = 0; i < pModel->getMeshInstanceCount(mesh) && surfaceId < mpFeedback->getSurfaceCount(); i++)
+                        {
+                            mpFeedback->setSurfaceBounds(surfaceId++, pModel->getMeshInstance(mesh, i)->getBoundingBox().transform(pModelInstance->getTransformMatrix()));
+                        }
+                    }
+                }
+            }
+
+            TextureFeedbackSimulator::View view;
+            view.position = pCamera->getPosition();
+            view.viewProjMat = pCamera->getViewProjMatrix();
+            view.fovY = focalLengthToFovY(pCamera->getFocalLength(), pCamera->getFrameHeight());
+            view.viewportHeight = viewportHeight;
+            mpFeedback->simulateView(view);
+        }
+
+        mChanges.clear();
+        mpResidency->update(mChanges);
+        for (const auto& change : mChanges) applyChange(pContext, change);
+
+        // Create the textures whose levels were read since the last update
+        std::vector<LoadResult> results;
+        {
+            std::lock_guard<std::mutex> lock(mLoadMutex);
+            results.swap(mLoadResults);
+        }
+        for (const auto& result : results)
+        {
+            StreamedTexture& t = mTextures[result.request.textureId];
+            if (result.request.serial != t.serial) continue;
+            if (result.success == false)
+            {
+                logWarning("TextureStreamer: Can't read '" + t.filename + "'");
+                continue;
+            }
+            const TextureCooker::CookedFileDesc& fd = t.fileDesc;
+            uint32_t mip = result.request.topMip;
+            replaceTexture(result.request.textureId, Texture::create2D(fd.width >> mip, fd.height >> mip, fd.format, 1, fd.mipCount - mip, result.data.data(), Texture::BindFlags::ShaderResource), mip);
+        }
+    }
+
+    void TextureStreamer::applyChange(RenderContext* pContext, const TextureResidency::Change& change)
+    {
+        StreamedTexture& t = mTextures[change.textureId];
+        const TextureCooker::CookedFileDesc& fd = t.fileDesc;
+        t.serial++;
+
+        if (change.topMip < t.topMip)
+        {
+            // Finer levels are read from the file, together with the ones already resident since the texture is recreated anyway
+            TextureResidency::TextureDesc desc = mpResidency->getTextureDesc(change.textureId);
+            uint64_t fullSize = TextureResidency::getLevelsSize(desc, 0);
+            uint64_t size = TextureResidency::getLevelsSize(desc, change.topMip);
+
+            std::lock_guard<std::mutex> lock(mLoadMutex);
+            mLoadRequests.push_back({ change.textureId, change.topMip, t.serial, t.filename, fd.dataOffset + fullSize - size, size });
+            mPendingLoads++;
+            if (mLoader.joinable() == false) mLoader = std::thread(&TextureStreamer::loaderThread, this);
+            mLoadCond.notify_one();
+        }
+        else if (change.topMip > t.topMip)
+        {
+            // Dropping levels doesn't need the file, the remaining levels are copied from the current texture
+            uint32_t dropped = change.topMip - t.topMip;
+            Texture::SharedPtr pTexture = Texture::create2D(fd.width >> change.topMip, fd.height >> change.topMip, fd.format, 1, fd.mipCount - change.topMip, nullptr, Texture::BindFlags::ShaderResource);
+            for (uint32_t mip = 0; mip < pTexture->getMipCount(); mip++)
+            {
+                pContext->copySubresource(pTexture.get(), pTexture->getSubresourceIndex(0, mip), t.pTexture.get(), t.pTexture->getSubresourceIndex(0, mip + dropped));
+            }
+            replaceTexture(change.textureId, pTexture, change.topMip);
+        }
+        // Otherwise a load which hasn't finished yet was cancelled, and the current texture already has the right levels
+    }
+
+    void TextureStreamer::replaceTexture(uint32_t textureId, const Texture::SharedPtr& pTexture, uint32_t topMip)
+    {
+        StreamedTexture& t = mTextures[textureId];
+        if (pTexture == nullptr) return;
+        pTexture->setSourceFilename(t.pTexture->getSourceFilename());
+
+        for (auto& user : t.users)
+        {
+            Material* pMaterial = user.first.get();
+            if (getMaterialTexture(pMaterial, user.second) != t.pTexture) continue;
+
+            Texture::SharedPtr pNewTexture = pTexture;
+            switch (user.second)
+            {
+            case Slot::BaseColor:
+            {
+                // Setting the base color texture resets the alpha mode from the format, keep the one the material has
+                uint32_t alphaMode = pMaterial->getAlphaMode();
+                pMaterial->setBaseColorTexture(pNewTexture);
+                pMaterial->setAlphaMode(alphaMode);
+                break;
+            }
+            case Slot::Specular:        pMaterial->setSpecularTexture(pNewTexture); break;
+            case Slot::Emissive:        pMaterial->setEmissiveTexture(pNewTexture); break;
+            case Slot::NormalMap:       pMaterial->setNormalMap(pNewTexture); break;
+            case Slot::OcclusionMap:    pMaterial->setOcclusionMap(pNewTexture); break;
+            case Slot::LightMap:        pMaterial->setLightMap(pNewTexture); break;
+            default:                    should_not_get_here();
+            }
+        }
+
+        t.pTexture = pTexture;
+        t.topMip = topMip;
+    }
+
+    void TextureStreamer::loaderThread()
+    {
+        while (true)
+        {
+            LoadRequest request;
+            {
+                std::unique_lock<std::mutex> lock(mLoadMutex);
+                mLoadCond.wait(lock, [this] { return mStopLoader || mLoadRequests.size(); });
+                if (mStopLoader) return;
+                request = mLoadRequests.front();
+                mLoadRequests.pop_front();
+            }
+
+            LoadResult result;
+            result.request = request;
+            result.success = readFileRange(request.filename, request.offset, request.size, result.data);
+
+            std::lock_guard<std::mutex> lock(mLoadMutex);
+            mLoadResults.push_back(std::move(result));
+            mPendingLoads--;
+        }
+    }
+
+    std::string TextureStreamer::getStatsString() const
+    {
+        uint32_t pendingLoads;
+        {
+            std::lock_guard<std::mutex> lock(mLoadMutex);
+            pendingLoads = mPendingLoads;
+        }
+        return mpResidency->getStatsString() + ", " + std::to_string(pendingLoads) + " loads pending";
+    }
+}
@@ -0,0 +1,147 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "API/Texture.h"
+#include "Graphics/TextureCooker.h"
+#include "Graphics/TextureResidency.h"
+#include "Graphics/TextureFeedbackSimulator.h"
+
+namespace Falcor
+{
+    class Scene;
+    class Camera;
+    class Material;
+    class RenderContext;
+
+    /** Streams the mip-levels of baked textures (see TextureCooker) in and out of GPU memory.
+        Textures are created with only their mip tail, the levels no larger than TextureResidency::Desc::tailSize. Baked files store
+        the levels one after the other, largest first, so any range of levels down to the smallest one is a single read from the end
+        of the file. Finer levels are read on a background thread when the residency asks for them, and levels are dropped with a
+        GPU copy when it evicts them. Each change replaces the texture object in the materials that use it.
+
+        Usage is estimated on the CPU by a TextureFeedbackSimulator, with a surface for each mesh instance of the scene.
+        Install a streamer with setTextureStreamer() to have createTextureFromFile() and createTexturesFromFiles() create streamed
+        textures for the images that were baked.
+    */
+    class TextureStreamer
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TextureStreamer>;
+        using SharedConstPtr = std::shared_ptr<const TextureStreamer>;
+
+        static SharedPtr create(const TextureResidency::Desc& desc);
+        ~TextureStreamer();
+
+        /** Create a streamed texture from a baked file. Only the mip tail is loaded.
+            \return The texture, or nullptr if the file can't be read
+        */
+        Texture::SharedPtr createTexture(const std::string& cookedFile);
+
+        /** Set the scene whose materials use the streamed textures. Creates a feedback surface for each of its mesh instances.
+        */
+        void setScene(const std::shared_ptr<Scene>& pScene);
+
+        /** Stream levels in and out, based on what the camera sees. Call once per frame, before rendering.
+        */
+        void update(RenderContext* pContext, const Camera* pCamera, uint32_t viewportHeight);
+
+        const TextureResidency::SharedPtr& getResidency() const { return mpResidency; }
+        const TextureFeedbackSimulator::SharedPtr& getFeedback() const { return mpFeedback; }
+
+        /** Get a one-line summary of the residency stats and the pending loads, for logging
+        */
+        std::string getStatsString() const;
+
+    private:
+        TextureStreamer(const TextureResidency::Desc& desc);
+
+        enum class Slot
+        {
+            BaseColor,
+            Specular,
+            Emissive,
+            NormalMap,
+            OcclusionMap,
+            LightMap,
+            Count
+        };
+
+        struct StreamedTexture
+        {
+            std::string filename;
+            TextureCooker::CookedFileDesc fileDesc;
+            Texture::SharedPtr pTexture;
+            uint32_t topMip = 0;                ///< The level of the file which is the top level of pTexture
+            uint32_t serial = 0;                ///< Incremented by every change, so loads which were overtaken are dropped
+            std::vector<std::pair<std::shared_ptr<Material>, Slot>> users;
+        };
+
+        struct LoadRequest
+        {
+            uint32_t textureId;
+            uint32_t topMip;
+            uint32_t serial;
+            std::string filename;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        struct LoadResult
+        {
+            LoadRequest request;
+            std::vector<uint8_t> data;
+            bool success;
+        };
+
+        static Texture::SharedPtr getMaterialTexture(const Material* pMaterial, Slot slot);
+        void applyChange(RenderContext* pContext, const TextureResidency::Change& change);
+        void replaceTexture(uint32_t textureId, const Texture::SharedPtr& pTexture, uint32_t topMip);
+        void loaderThread();
+
+        TextureResidency::SharedPtr mpResidency;
+        TextureFeedbackSimulator::SharedPtr mpFeedback;
+        std::vector<StreamedTexture> mTextures;
+        std::shared_ptr<Scene> mpScene;
+        std::vector<TextureResidency::Change> mChanges;
+
+        std::thread mLoader;
+        mutable std::mutex mLoadMutex;
+        std::condition_variable mLoadCond;
+        std::deque<LoadRequest> mLoadRequests;
+        std::vector<LoadResult> mLoadResults;
+        uint32_t mPendingLoads = 0;
+        bool mStopLoader = false;
+    };
+}
@@ -31,6 +31,7 @@
 #include "API/RenderContext.h"
 #include "API/LowLevel/LowLevelContextData.h"
 #include "API/VAO.h"
+#include "Utils/Profiler.h"
 
 namespace Falcor
 {
@@ -138,6 +139,16 @@ namespace Falcor
         insertFunc(staticMeshes, true);
         insertFunc(dynamicMeshes, false);
 
+        // The bounds of static groups are in the space the TLAS transform leaves them in, which includes the mesh-instance transform
+        for (auto& data : mBottomLevelData)
+        {
+            data.bounds = mMeshes[data.meshBaseIndex][0]->getObject()->getBoundingBox();
+            for (uint32_t i = data.meshBaseIndex + 1; i < data.meshBaseIndex + data.meshCount; i++)
+            {
+                data.bounds = BoundingBox::fromUnion(data.bounds, mMeshes[i][0]->getObject()->getBoundingBox());
+            }
+        }
+
         // Validate that mBottomLevelData represents a contiguous range that includes all meshes, and that grouped meshes are non-instanced
         uint32_t baseIdx = 0;
         for (auto& it : mBottomLevelData)
@@ -167,90 +178,153 @@ namespace Falcor
         return pRtModel;
     }
 
+    BoundingBox RtModel::computeSkinnedBounds(const BottomLevelData& blasData) const
+    {
+        // A skinned vertex is a weighted average of its bind-pose position transformed by bones, so it lies within the bounds of the
+        // bind-pose bounds transformed by each bone
+        const mat4* pBones = getBoneMatrices();
+        uint32_t boneCount = getBoneCount();
+        if (pBones == nullptr || boneCount == 0) return blasData.bounds;
+
+        BoundingBox bindBounds = mMeshes[blasData.meshBaseIndex][0]->getObject()->getBoundingBox();
+        for (uint32_t i = blasData.meshBaseIndex + 1; i < blasData.meshBaseIndex + blasData.meshCount; i++)
+        {
+            bindBounds = BoundingBox::fromUnion(bindBounds, mMeshes[i][0]->getObject()->getBoundingBox());
+        }
+
+        BoundingBox bounds = bindBounds.transform(pBones[0]);
+        for (uint32_t b = 1; b < boneCount; b++) bounds = BoundingBox::fromUnion(bounds, bindBounds.transform(pBones[b]));
+        return bounds;
+    }
+
     bool RtModel::update()
     {
         // Call base class to compute skinned vertices
-        if (Model::update())
+        if (Model::update() == false) return false;
+
+        PROFILE(updateBlas);
+        for (auto& blasData : mBottomLevelData)
         {
-            buildAccelerationStructure();
-            return true;
+            // Static BLASes don't change once built. Skinned models postpone building them until the first update.
+            if (blasData.isStatic)
+            {
+                if (blasData.pBlas == nullptr) buildBottomLevelAS(blasData, false);
+                continue;
+            }
+
+            // Refit the skinned meshes' BLAS, unless the bounds grew enough that the tree it was built with no longer fits the pose
+            BoundingBox bounds = computeSkinnedBounds(blasData);
+            glm::vec3 extent = bounds.extent;
+            double cost = extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+            BvhUpdateType type = mSkinnedBlasTracker.decide(blasData.pBlas == nullptr, true, cost);
+            blasData.bounds = bounds;
+            buildBottomLevelAS(blasData, type == BvhUpdateType::Refit);
+            mSkinnedBlasTracker.onUpdated(type, cost);
+            if (type == BvhUpdateType::Refit) mBlasRefitCount++;
+            else mBlasRebuildCount++;
         }
-        return false;
+        return true;
     }
 
     void RtModel::buildAccelerationStructure()
     {
-        RenderContext* pContext = gpDevice->getRenderContext().get();
-
-        auto dxrFlags = getDxrBuildFlags(mBuildFlags);
-
         // Create an AS for each mesh-group
         for (auto& blasData : mBottomLevelData)
         {
-            std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geomDesc(blasData.meshCount);
-            for (size_t meshIndex = blasData.meshBaseIndex; meshIndex < blasData.meshBaseIndex + blasData.meshCount; meshIndex++)
+            buildBottomLevelAS(blasData, false);
+        }
+    }
+
+    void RtModel::buildBottomLevelAS(BottomLevelData& blasData, bool refit)
+    {
+        RenderContext* pContext = gpDevice->getRenderContext().get();
+
+        std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geomDesc(blasData.meshCount);
+        for (size_t meshIndex = blasData.meshBaseIndex; meshIndex < blasData.meshBaseIndex + blasData.meshCount; meshIndex++)
+        {
+            assert(meshIndex < mMeshes.size());
+            const Mesh* pMesh = getMesh((uint32_t)meshIndex).get();
+
+            D3D12_RAYTRACING_GEOMETRY_DESC& desc = geomDesc[meshIndex - blasData.meshBaseIndex];
+            desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+            desc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
+            desc.Triangles.Transform3x4 = 0;
+
+            // Get the position VB
+            const Vao* pVao = getMeshVao(pMesh).get();
+            const auto& elemDesc = pVao->getElementIndexByLocation(VERTEX_POSITION_LOC);
+            const auto& pVbLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex);
+
+            const Buffer* pVB = pVao->getVertexBuffer(elemDesc.vbIndex).get();
+            pContext->resourceBarrier(pVB, Resource::State::NonPixelShader);
+            desc.Triangles.VertexBuffer.StartAddress = pVB->getGpuAddress() + pVbLayout->getElementOffset(elemDesc.elementIndex);
+            desc.Triangles.VertexBuffer.StrideInBytes = pVbLayout->getStride();
+            desc.Triangles.VertexCount = pMesh->getVertexCount();
+            desc.Triangles.VertexFormat = getDxgiFormat(pVbLayout->getElementFormat(elemDesc.elementIndex));
+
+            // Get the IB
+            const Buffer* pIB = pVao->getIndexBuffer().get();
+            pContext->resourceBarrier(pIB, Resource::State::NonPixelShader);
+            desc.Triangles.IndexBuffer = pIB->getGpuAddress();
+            desc.Triangles.IndexCount = pMesh->getIndexCount();
+            desc.Triangles.IndexFormat = getDxgiFormat(pVao->getIndexBufferFormat());
+
+            // If this is an opaque mesh, set the opaque flag
+            if (pMesh->getMaterial()->getAlphaMode() == AlphaModeOpaque)
             {
-                assert(meshIndex < mMeshes.size());
-                const Mesh* pMesh = getMesh((uint32_t)meshIndex).get();
-
-                D3D12_RAYTRACING_GEOMETRY_DESC& desc = geomDesc[meshIndex - blasData.meshBaseIndex];
-                desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-                desc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
-                desc.Triangles.Transform3x4 = 0;
-
-                // Get the position VB
-                const Vao* pVao = getMeshVao(pMesh).get();
-                const auto& elemDesc = pVao->getElementIndexByLocation(VERTEX_POSITION_LOC);
-                const auto& pVbLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex);
-
-                const Buffer* pVB = pVao->getVertexBuffer(elemDesc.vbIndex).get();
-                pContext->resourceBarrier(pVB, Resource::State::NonPixelShader);
-                desc.Triangles.VertexBuffer.StartAddress = pVB->getGpuAddress() + pVbLayout->getElementOffset(elemDesc.elementIndex);
-                desc.Triangles.VertexBuffer.StrideInBytes = pVbLayout->getStride();
-                desc.Triangles.VertexCount = pMesh->getVertexCount();
-                desc.Triangles.VertexFormat = getDxgiFormat(pVbLayout->getElementFormat(elemDesc.elementIndex));
-
-                // Get the IB
-                const Buffer* pIB = pVao->getIndexBuffer().get();
-                pContext->resourceBarrier(pIB, Resource::State::NonPixelShader);
-                desc.Triangles.IndexBuffer = pIB->getGpuAddress();
-                desc.Triangles.IndexCount = pMesh->getIndexCount();
-                desc.Triangles.IndexFormat = getDxgiFormat(pVao->getIndexBufferFormat());
-
-                // If this is an opaque mesh, set the opaque flag
-                if (pMesh->getMaterial()->getAlphaMode() == AlphaModeOpaque)
-                {
-                    desc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
-                }
+                desc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
             }
+        }
 
-            // Create the acceleration and aux buffers
-            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
-            inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-            inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
-            inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-            inputs.NumDescs = (uint32_t)geomDesc.size();
-            inputs.pGeometryDescs = geomDesc.data();
+        // Create the acceleration and aux buffers. Dynamic BLASes allow updates, and keep their buffers so updates and rebuilds don't
+        // reallocate them. Their address then stays the same, which saves patching the TLAS instances referencing them.
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
+        inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+        inputs.Flags = blasData.isStatic ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE : D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
+        inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        inputs.NumDescs = (uint32_t)geomDesc.size();
+        inputs.pGeometryDescs = geomDesc.data();
 
-            D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info;
-            GET_COM_INTERFACE(gpDevice->getApiHandle(), ID3D12Device5, pDevice5);
-            pDevice5->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info;
+        GET_COM_INTERFACE(gpDevice->getApiHandle(), ID3D12Device5, pDevice5);
+        pDevice5->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
 
-            Buffer::SharedPtr pScratchBuffer = Buffer::create(info.ScratchDataSizeInBytes, Buffer::BindFlags::UnorderedAccess, Buffer::CpuAccess::None);
+        refit = refit && blasData.pBlas;
+        uint64_t scratchSize = std::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes);
+        if (blasData.pScratch == nullptr || blasData.pScratch->getSize() < scratchSize)
+        {
+            blasData.pScratch = Buffer::create(scratchSize, Buffer::BindFlags::UnorderedAccess, Buffer::CpuAccess::None);
+        }
+        if (blasData.pBlas == nullptr || blasData.pBlas->getSize() < info.ResultDataMaxSizeInBytes)
+        {
             blasData.pBlas = Buffer::create(info.ResultDataMaxSizeInBytes, Buffer::BindFlags::AccelerationStructure, Buffer::CpuAccess::None);
+            refit = false;
+        }
+        else
+        {
+            // The previous build or update of this BLAS must be done before it is overwritten
+            pContext->uavBarrier(blasData.pBlas.get());
+        }
+
+        // Build the AS
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC asDesc = {};
+        asDesc.Inputs = inputs;
+        asDesc.DestAccelerationStructureData = blasData.pBlas->getGpuAddress();
+        asDesc.ScratchAccelerationStructureData = blasData.pScratch->getGpuAddress();
+        if (refit)
+        {
+            asDesc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+            asDesc.SourceAccelerationStructureData = asDesc.DestAccelerationStructureData;
+        }
 
-            // Build the AS
-            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC asDesc = {};
-            asDesc.Inputs = inputs;
-            asDesc.DestAccelerationStructureData = blasData.pBlas->getGpuAddress();
-            asDesc.ScratchAccelerationStructureData = pScratchBuffer->getGpuAddress();
+        GET_COM_INTERFACE(pContext->getLowLevelData()->getCommandList(), ID3D12GraphicsCommandList4, pList4);
+        pList4->BuildRaytracingAccelerationStructure(&asDesc, 0, nullptr);
 
-            GET_COM_INTERFACE(pContext->getLowLevelData()->getCommandList(), ID3D12GraphicsCommandList4, pList4);
-            pList4->BuildRaytracingAccelerationStructure(&asDesc, 0, nullptr);
+        // Insert a UAV barrier
+        pContext->uavBarrier(blasData.pBlas.get());
 
-            // Insert a UAV barrier
-            pContext->uavBarrier(blasData.pBlas.get());
-        }
+        // Static BLASes are built once, don't hold on to their scratch memory
+        if (blasData.isStatic) blasData.pScratch = nullptr;
     }
 
     RtModel::SharedPtr RtModel::createFromFile(const char* filename, RtBuildFlags buildFlags, Model::LoadFlags flags)
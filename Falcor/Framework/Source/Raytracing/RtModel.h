@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include "Graphics/Model/Model.h"
+#include "Graphics/Bvh/BvhUpdateTracker.h"
 
 namespace Falcor
 {
@@ -46,18 +47,35 @@ namespace Falcor
             uint32_t meshCount = 0;
             bool isStatic = true;
             Buffer::SharedPtr pBlas;
+            Buffer::SharedPtr pScratch;     ///< Kept for the updates of dynamic BLASes
+            BoundingBox bounds;             ///< Bounds of the geometry. For skinned meshes, a conservative estimate from the bone matrices.
         };
 
         uint32_t getBottomLevelDataCount() const { return (uint32_t)mBottomLevelData.size(); }
         const BottomLevelData& getBottomLevelData(uint32_t index) const { return mBottomLevelData[index]; }
 
+        /** Set how the BLAS of the skinned meshes follows the animation. By default it is refit in place, and rebuilt when the bounds
+            of the skinned meshes grew by half since the last rebuild (a sign the refit tree has degraded) or after 64 refits.
+        */
+        void setBlasUpdatePolicy(const BvhUpdateTracker::Policy& policy) { mSkinnedBlasTracker.setPolicy(policy); }
+
+        /** Number of dynamic BLAS refits and rebuilds since the model was created. Static BLASes are built once and not counted.
+        */
+        uint32_t getBlasRefitCount() const { return mBlasRefitCount; }
+        uint32_t getBlasRebuildCount() const { return mBlasRebuildCount; }
+
     private:
         RtModel(const Model& model, RtBuildFlags buildFlags);
         bool update() override;            // Override update() from Model, which updates vertices for skinned models
         void buildAccelerationStructure();
+        void buildBottomLevelAS(BottomLevelData& blasData, bool refit);
+        BoundingBox computeSkinnedBounds(const BottomLevelData& blasData) const;
 
         std::vector<BottomLevelData> mBottomLevelData;
         RtBuildFlags mBuildFlags;
+        BvhUpdateTracker mSkinnedBlasTracker;
+        uint32_t mBlasRefitCount = 0;
+        uint32_t mBlasRebuildCount = 0;
         void createBottomLevelData();
     };
 }
\ No newline at end of file
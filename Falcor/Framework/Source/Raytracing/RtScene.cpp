@@ -30,6 +30,10 @@
 #include "Graphics/Scene/SceneImporter.h"
 #include "API/DescriptorSet.h"
 #include "API/Device.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/Profiler.h"
+#include <sstream>
+#include <iomanip>
 
 namespace Falcor
 {
@@ -74,15 +78,19 @@ namespace Falcor
     bool RtScene::update(double currentTime, CameraController* cameraController)
     {
         bool changed = Scene::update(currentTime, cameraController);
-        mTlasHitProgCount = mExtentsDirty ? -1 : mTlasHitProgCount;
 
-        if (mEnableRefit)
-        {
-            mRefit = true;
-        }
+        // The next TLAS update compares the instances with the previous ones to find what actually moved
+        mTlasDirty = mTlasDirty || mExtentsDirty;
         return changed;
     }
 
+    void RtScene::setRefit(bool enableRefit)
+    {
+        BvhUpdateTracker::Policy policy = mTlasUpdateTracker.getPolicy();
+        policy.allowRefit = enableRefit;
+        mTlasUpdateTracker.setPolicy(policy);
+    }
+
     void RtScene::addModelInstance(const ModelInstance::SharedPtr& pInstance)
     {
         RtModel::SharedPtr pRtModel = std::dynamic_pointer_cast<RtModel>(pInstance->getObject());
@@ -113,6 +121,7 @@ namespace Falcor
 
             mModelInstanceToRtModelInstance[pMovable.get()] = pRtMovable;
         }
+        mTlasDirty = true;
 
         // If we have skinned models, attach a skinning cache and animate the scene once to trigger a VB update
         if (pRtModel->hasBones())
@@ -127,6 +136,8 @@ namespace Falcor
         mGeometryCount = 0;
         std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDesc;
         mModelInstanceData.resize(pScene->getModelCount());
+        mFrameInstances.clear();
+        mInstanceLocalBounds.clear();
 
         uint32_t tlasIndex = 0;
         uint32_t instanceContributionToHitGroupIndex = 0;
@@ -183,6 +194,13 @@ namespace Falcor
                         {
                             transform = transform * pModel->getMeshInstance(blasData.meshBaseIndex, meshInstance)->getTransformMatrix();    // If there are multiple meshes in a BLAS, they all have the same transform
                         }
+                        InstanceChangeTracker::Instance inst;
+                        inst.transform = transform;
+                        inst.geometryId = idesc.AccelerationStructure;
+                        inst.flags = idesc.Flags;
+                        mFrameInstances.push_back(inst);
+                        mInstanceLocalBounds.push_back(blasData.bounds);
+
                         transform = transpose(transform);
                         memcpy(idesc.Transform, &transform, sizeof(idesc.Transform));
                         instanceDesc.push_back(idesc);
@@ -216,35 +234,118 @@ namespace Falcor
         return instanceDesc;
     }
 
+    void RtScene::resetTlas()
+    {
+        mModelInstanceData.clear();
+        mpTopLevelAS = nullptr;
+        mTlasSrv = nullptr;
+        mpInstanceData = nullptr;
+        mpTlasScratch = nullptr;
+        mGeometryCount = 0;
+        mInstanceCount = 0;
+        mTlasChangeTracker.reset();
+        mTlasUpdateTracker.invalidate();
+        mUpdateStats = UpdateStats();
+    }
+
     // TODO: Cache TLAS per hitProgCount, as some render pipelines need multiple TLAS:es with different #hit progs in same frame, currently that trigger rebuild every frame. See issue #365.
     void RtScene::createTlas(uint32_t hitProgCount)
     {
-        if (mTlasHitProgCount == hitProgCount) return;
+        if (mTlasHitProgCount == hitProgCount && mTlasDirty == false) return;
+        bool hitProgCountChanged = (mTlasHitProgCount != hitProgCount);
         mTlasHitProgCount = hitProgCount;
+        mTlasDirty = false;
 
         // Early out if hit program count is zero or if scene is empty.
         if (hitProgCount == 0 || getModelCount() == 0)
         {
-            mModelInstanceData.clear();
-            mpTopLevelAS = nullptr;
-            mTlasSrv = nullptr;
-            mGeometryCount = 0;
-            mInstanceCount = 0;
-            mRefit = false;
+            resetTlas();
             return;
         }
 
+        PROFILE(updateTlas);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+
         // todo: move this somewhere fair.
         mRtFlags |= RtBuildFlags::AllowUpdate;
 
-        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS dxrFlags = getDxrBuildFlags(mRtFlags);
-        RenderContext* pContext = gpDevice->getRenderContext().get();
+        // Find the instances which changed. A new hit program count changes the hit group offsets of all of them.
         std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDesc = createInstanceDesc(this, hitProgCount);
+        bool structureChanged = mTlasChangeTracker.update(mFrameInstances) || hitProgCountChanged || (mpTopLevelAS == nullptr);
+        const auto& dirty = mTlasChangeTracker.getDirtyInstances();
 
-        // todo: improve this check - make sure things have not changed much and update was enabled last time
-        bool isRefitPossible = mRefit && mpTopLevelAS && (mInstanceCount == (uint32_t)instanceDesc.size());
+        // Skinned BLAS updates change the bounds the TLAS holds for their instances, without changing the instance descs
+        uint64_t blasRefitCount = 0;
+        uint64_t blasRebuildCount = 0;
+        for (uint32_t modelId = 0; modelId < getModelCount(); modelId++)
+        {
+            const RtModel* pModel = dynamic_cast<RtModel*>(getModel(modelId).get());
+            blasRefitCount += pModel->getBlasRefitCount();
+            blasRebuildCount += pModel->getBlasRebuildCount();
+        }
+        uint64_t blasUpdateCount = blasRefitCount + blasRebuildCount;
+        bool blasChanged = (blasUpdateCount != mBlasUpdateCount);
 
-        mInstanceCount = (uint32_t)instanceDesc.size();
+        // Keep the CPU BVH mirroring the TLAS up to date, refitting it whenever the TLAS is. Its SAH cost tells when the TLAS should be rebuilt.
+        uint32_t instanceCount = (uint32_t)instanceDesc.size();
+        auto updateBounds = [this](uint32_t i)
+        {
+            BoundingBox box = mInstanceLocalBounds[i].transform(mFrameInstances[i].transform);
+            mInstanceBoundsMin[i] = box.getMinPos();
+            mInstanceBoundsMax[i] = box.getMaxPos();
+        };
+        bool updateAllBounds = structureChanged || blasChanged;
+        mInstanceBoundsMin.resize(instanceCount);
+        mInstanceBoundsMax.resize(instanceCount);
+        if (updateAllBounds)
+        {
+            for (uint32_t i = 0; i < instanceCount; i++) updateBounds(i);
+        }
+        else
+        {
+            for (uint32_t i : dirty) updateBounds(i);
+        }
+
+        BvhUpdateType updateType = mTlasUpdateTracker.decide(structureChanged, dirty.empty() == false || blasChanged);
+        double cost = 0;
+        if (updateType == BvhUpdateType::Refit)
+        {
+            if (updateAllBounds || dirty.size() * 4 >= instanceCount)
+            {
+                mTlasCostBvh.refit(mInstanceBoundsMin.data(), mInstanceBoundsMax.data());
+            }
+            else
+            {
+                mTlasCostBvh.refit(mInstanceBoundsMin.data(), mInstanceBoundsMax.data(), dirty.data(), (uint32_t)dirty.size());
+            }
+            cost = mTlasCostBvh.computeSahCost();
+            updateType = mTlasUpdateTracker.decide(false, true, cost);
+        }
+        if (updateType == BvhUpdateType::Rebuild)
+        {
+            Bvh::BuildDesc costDesc;
+            costDesc.maxLeafSize = 1;
+            mTlasCostBvh.build(mInstanceBoundsMin.data(), mInstanceBoundsMax.data(), instanceCount, costDesc);
+            cost = mTlasCostBvh.getBuildStats().sahCost;
+        }
+        mTlasUpdateTracker.onUpdated(updateType, cost);
+        mBlasUpdateCount = blasUpdateCount;
+
+        mUpdateStats.tlasUpdate = updateType;
+        mUpdateStats.instanceCount = instanceCount;
+        mUpdateStats.dirtyInstanceCount = (uint32_t)dirty.size();
+        mUpdateStats.uploadedInstanceCount = 0;
+        mUpdateStats.blasRefitCount = (uint32_t)blasRefitCount;
+        mUpdateStats.blasRebuildCount = (uint32_t)blasRebuildCount;
+
+        // Only the camera moved
+        if (updateType == BvhUpdateType::None)
+        {
+            mUpdateStats.cpuTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            return;
+        }
+
+        mInstanceCount = instanceCount;
 
         // Create the top-level acceleration buffers
         D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
@@ -257,53 +358,93 @@ namespace Falcor
         GET_COM_INTERFACE(gpDevice->getApiHandle(), ID3D12Device5, pDevice5);
         pDevice5->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
 
-        Buffer::SharedPtr pScratchBuffer = Buffer::create(align_to(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, info.ScratchDataSizeInBytes), Buffer::BindFlags::UnorderedAccess, Buffer::CpuAccess::None);
+        // Reuse the buffers while they are large enough. Keeping the TLAS buffer also keeps its SRV valid.
+        RenderContext* pContext = gpDevice->getRenderContext().get();
+        uint64_t scratchSize = align_to(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, std::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes));
+        if (mpTlasScratch == nullptr || mpTlasScratch->getSize() < scratchSize)
+        {
+            mpTlasScratch = Buffer::create(scratchSize, Buffer::BindFlags::UnorderedAccess, Buffer::CpuAccess::None);
+        }
 
-        if (!isRefitPossible)
+        bool createSrv = false;
+        uint64_t tlasSize = align_to(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, info.ResultDataMaxSizeInBytes);
+        if (mpTopLevelAS == nullptr || mpTopLevelAS->getSize() < tlasSize)
         {
-            mpTopLevelAS = Buffer::create(align_to(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, info.ResultDataMaxSizeInBytes), Buffer::BindFlags::AccelerationStructure, Buffer::CpuAccess::None);
+            assert(updateType == BvhUpdateType::Rebuild);
+            mpTopLevelAS = Buffer::create(tlasSize, Buffer::BindFlags::AccelerationStructure, Buffer::CpuAccess::None);
+            createSrv = true;
         }
         else
         {
             pContext->uavBarrier(mpTopLevelAS.get());
         }
 
-        Buffer::SharedPtr pInstanceData = Buffer::create(mInstanceCount * sizeof(D3D12_RAYTRACING_INSTANCE_DESC), Buffer::BindFlags::None, Buffer::CpuAccess::None, instanceDesc.data());
-        assert((mInstanceCount != 0) && pInstanceData->getApiHandle() && mpTopLevelAS->getApiHandle() && pScratchBuffer->getApiHandle());
+        // Upload the instance descs which changed, merging ranges separated by a few clean ones to save copies
+        const uint32_t kMaxUploadGap = 4;
+        size_t instanceDataSize = mInstanceCount * sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
+        if (structureChanged || mpInstanceData == nullptr || mpInstanceData->getSize() < instanceDataSize)
+        {
+            mpInstanceData = Buffer::create(instanceDataSize, Buffer::BindFlags::None, Buffer::CpuAccess::None, instanceDesc.data());
+            mUpdateStats.uploadedInstanceCount = mInstanceCount;
+        }
+        else
+        {
+            for (const auto& range : mTlasChangeTracker.getDirtyRanges(kMaxUploadGap))
+            {
+                mpInstanceData->updateData(&instanceDesc[range.first], range.first * sizeof(D3D12_RAYTRACING_INSTANCE_DESC), range.count * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+                mUpdateStats.uploadedInstanceCount += range.count;
+            }
+        }
+        assert((mInstanceCount != 0) && mpInstanceData->getApiHandle() && mpTopLevelAS->getApiHandle() && mpTlasScratch->getApiHandle());
 
-        // Create the TLAS
+        // Build or refit the TLAS
         D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC asDesc = {};
         asDesc.Inputs = inputs;
-        asDesc.Inputs.InstanceDescs = pInstanceData->getGpuAddress();
+        asDesc.Inputs.InstanceDescs = mpInstanceData->getGpuAddress();
         asDesc.DestAccelerationStructureData = mpTopLevelAS->getGpuAddress();
-        asDesc.ScratchAccelerationStructureData = pScratchBuffer->getGpuAddress();
+        asDesc.ScratchAccelerationStructureData = mpTlasScratch->getGpuAddress();
 
-        if (isRefitPossible)
+        if (updateType == BvhUpdateType::Refit)
         {
             asDesc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
             asDesc.SourceAccelerationStructureData = asDesc.DestAccelerationStructureData;
         }
 
         GET_COM_INTERFACE(pContext->getLowLevelData()->getCommandList(), ID3D12GraphicsCommandList4, pList4);
-        pContext->resourceBarrier(pInstanceData.get(), Resource::State::NonPixelShader);
+        pContext->resourceBarrier(mpInstanceData.get(), Resource::State::NonPixelShader);
         pList4->BuildRaytracingAccelerationStructure(&asDesc, 0, nullptr);
         pContext->uavBarrier(mpTopLevelAS.get());
 
-        // Create the SRV
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.RaytracingAccelerationStructure.Location = mpTopLevelAS->getGpuAddress();
-
-        DescriptorSet::Layout layout;
-        layout.addRange(DescriptorSet::Type::TextureSrv, 0, 1);
-        DescriptorSet::SharedPtr pSet = DescriptorSet::create(gpDevice->getCpuDescriptorPool(), layout);
-        assert(pSet);
-        gpDevice->getApiHandle()->CreateShaderResourceView(nullptr, &srvDesc, pSet->getCpuHandle(0));
+        if (createSrv)
+        {
+            // Create the SRV
+            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
+            srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            srvDesc.RaytracingAccelerationStructure.Location = mpTopLevelAS->getGpuAddress();
+
+            DescriptorSet::Layout layout;
+            layout.addRange(DescriptorSet::Type::TextureSrv, 0, 1);
+            DescriptorSet::SharedPtr pSet = DescriptorSet::create(gpDevice->getCpuDescriptorPool(), layout);
+            assert(pSet);
+            gpDevice->getApiHandle()->CreateShaderResourceView(nullptr, &srvDesc, pSet->getCpuHandle(0));
+
+            ResourceWeakPtr pWeak = mpTopLevelAS;
+            mTlasSrv = std::make_shared<ShaderResourceView>(pWeak, pSet, 0, 1, 0, 1);
+        }
 
-        ResourceWeakPtr pWeak = mpTopLevelAS;
-        mTlasSrv = std::make_shared<ShaderResourceView>(pWeak, pSet, 0, 1, 0, 1);
+        mUpdateStats.cpuTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
 
-        mRefit = false;
+    std::string RtScene::getUpdateStatsString() const
+    {
+        const UpdateStats& s = mUpdateStats;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3);
+        ss << "RtScene: TLAS " << to_string(s.tlasUpdate) << ", " << s.dirtyInstanceCount << " of " << s.instanceCount << " instances changed, "
+           << s.uploadedInstanceCount << " uploaded, " << mTlasUpdateTracker.getRefitCount() << " refits since the last rebuild (SAH cost x"
+           << std::setprecision(2) << mTlasUpdateTracker.getCostGrowth() << "). Skinned BLAS updates so far: " << s.blasRefitCount << " refits, "
+           << s.blasRebuildCount << " rebuilds. " << std::setprecision(3) << s.cpuTimeMs << " ms on the CPU";
+        return ss.str();
     }
-}
\ No newline at end of file
+}
@@ -28,6 +28,8 @@
 #pragma once
 #include "Graphics/Scene/Scene.h"
 #include "RtModel.h"
+#include "Graphics/Bvh/Bvh.h"
+#include "Graphics/Bvh/BvhUpdateTracker.h"
 #include <map>
 
 namespace Falcor
@@ -58,7 +60,33 @@ namespace Falcor
         }
         virtual bool update(double currentTime, CameraController* cameraController = nullptr) override;
 
-        void setRefit(bool enableRefit) { mEnableRefit = enableRefit; }
+        /** Enable refitting the TLAS when instances move. When disabled, any change rebuilds it. Enabled by default.
+            Either way only the instances which changed are re-uploaded. This sets the allowRefit field of the TLAS update policy.
+        */
+        void setRefit(bool enableRefit);
+
+        /** Set when a refit TLAS is rebuilt. Its cost is the SAH cost of a CPU BVH over the instance bounds, which is built along with the
+            TLAS and refit along with it, so it degrades the same way.
+        */
+        void setTlasUpdatePolicy(const BvhUpdateTracker::Policy& policy) { mTlasUpdateTracker.setPolicy(policy); }
+
+        /** What the last TLAS update did. The GPU time of the TLAS and BLAS updates is in the profiler, under updateTlas and updateBlas.
+        */
+        struct UpdateStats
+        {
+            BvhUpdateType tlasUpdate = BvhUpdateType::None;
+            uint32_t instanceCount = 0;
+            uint32_t dirtyInstanceCount = 0;        ///< Instances whose transform or BLAS changed
+            uint32_t uploadedInstanceCount = 0;     ///< Instance descs uploaded, including clean ones between dirty ones
+            uint32_t blasRefitCount = 0;            ///< Skinned BLAS refits so far, summed over the models
+            uint32_t blasRebuildCount = 0;          ///< Skinned BLAS rebuilds so far, summed over the models
+            double cpuTimeMs = 0;                   ///< Time spent on the CPU finding the changes and recording the TLAS update
+        };
+        const UpdateStats& getUpdateStats() const { return mUpdateStats; }
+
+        /** Get a one-line summary of the last TLAS update, for logging
+        */
+        std::string getUpdateStatsString() const;
 
     protected:
         RtScene(RtBuildFlags rtFlags) : mRtFlags(rtFlags), mpSkinningCache(SkinningCache::create()) {}
@@ -69,6 +97,21 @@ namespace Falcor
         ShaderResourceView::SharedPtr mTlasSrv;
         void createTlas(uint32_t rayCount);
         std::vector<D3D12_RAYTRACING_INSTANCE_DESC> createInstanceDesc(const RtScene* pScene, uint32_t hitProgCount);
+        void resetTlas();
+
+        // Change tracking for the TLAS. The instances are compared with the previous update's, and only the descs that changed are uploaded.
+        bool mTlasDirty = true;                                         // Set when something may have moved since the last TLAS update
+        std::vector<InstanceChangeTracker::Instance> mFrameInstances;   // Filled by createInstanceDesc()
+        std::vector<BoundingBox> mInstanceLocalBounds;                  // Bounds of each instance's BLAS. Filled by createInstanceDesc().
+        InstanceChangeTracker mTlasChangeTracker;
+        BvhUpdateTracker mTlasUpdateTracker;
+        Bvh mTlasCostBvh;                                               // CPU BVH over the instance bounds, judging the TLAS refits
+        std::vector<glm::vec3> mInstanceBoundsMin;
+        std::vector<glm::vec3> mInstanceBoundsMax;
+        Buffer::SharedPtr mpInstanceData;
+        Buffer::SharedPtr mpTlasScratch;
+        uint64_t mBlasUpdateCount = 0;                                  // Sum of the RtModels' BLAS refits and rebuilds at the last TLAS update
+        UpdateStats mUpdateStats;
 
         uint32_t mGeometryCount = 0;    // The total number of geometries in the scene
         uint32_t mInstanceCount = 0;    // The total number of TLAS instances in the scene
@@ -85,8 +128,5 @@ namespace Falcor
         std::unordered_map<IMovableObject*, IMovableObject::SharedPtr> mModelInstanceToRtModelInstance;
 
         SkinningCache::SharedPtr mpSkinningCache;
-
-        bool mEnableRefit = false;
-        bool mRefit = false;
     };
 }
\ No newline at end of file
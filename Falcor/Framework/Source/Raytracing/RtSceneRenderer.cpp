@@ -171,6 +171,7 @@ namespace Falcor
             updateVariableOffsets(pState->getProgram()->getHitProgram(0)->getReflector().get()); // Using the local+global reflector, some resources are `shared`
             initializeMeshBufferLocation(pState->getProgram()->getHitProgram(0)->getLocalReflector().get()); // Using the local reflector only
         }
+        createLightStore(pRtVars->getGlobalVars()->getReflection().get());
 
         setRayGenShaderData(pRtVars.get(), data);
         setGlobalData(pRtVars.get(), data);
@@ -184,10 +185,12 @@ namespace Falcor
             }
         }
 
-        // Set the hit-shader data
+        // Set the hit-shader data. The instances are visited in the order of the scene's transform store, so their matrices are read from it when it is current.
+        const uint32_t firstMeshTransformNode = getFirstMeshTransformNode();
         for(data.progId = 0 ; data.progId < hitCount ; data.progId++)
         {
             if(pRtVars->getHitVars(data.progId).empty()) continue;
+            uint32_t transformNode = firstMeshTransformNode;
             for (data.model = 0; data.model < mpScene->getModelCount(); data.model++)
             {
                 const Model* pModel = mpScene->getModel(data.model).get();
@@ -199,6 +202,8 @@ namespace Falcor
                         const Mesh* pMesh = pModel->getMesh(data.mesh).get();
                         for (data.meshInstance = 0; data.meshInstance < pModel->getMeshInstanceCount(data.mesh); data.meshInstance++)
                         {
+                            data.currentData.transformNode = transformNode;
+                            if (transformNode != TransformStore::kInvalidNode) transformNode++;
                             setHitShaderData(pRtVars.get(), data);
                         }
                     }
@@ -281,6 +281,7 @@ namespace Falcor
         mpWindow->msgLoop();
 
         mpRenderer->onShutdown(this);
+        AsyncFrameCapture::releaseDefault();    // Finish writing captured frames while the device is still alive
         if (gpDevice) gpDevice->flushAndSync();
         mpRenderer = nullptr;
         Logger::shutdown();
@@ -0,0 +1,256 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "AsyncFrameCapture.h"
+#include "API/Device.h"
+#include "API/Texture.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    AsyncFrameCapture::SharedPtr AsyncFrameCapture::spDefault;
+
+    AsyncFrameCapture::SharedPtr AsyncFrameCapture::create()
+    {
+        return create(Desc());
+    }
+
+    AsyncFrameCapture::SharedPtr AsyncFrameCapture::create(const Desc& desc)
+    {
+        return SharedPtr(new AsyncFrameCapture(desc));
+    }
+
+    AsyncFrameCapture::AsyncFrameCapture(const Desc& desc) : mDesc(desc)
+    {
+        mDesc.writerThreadCount = std::max(1u, mDesc.writerThreadCount);
+        mDesc.maxPendingFrames = std::max(1u, mDesc.maxPendingFrames);
+
+        mThreads.reserve(mDesc.writerThreadCount);
+        for (uint32_t i = 0; i < mDesc.writerThreadCount; i++)
+        {
+            mThreads.push_back(std::thread(&AsyncFrameCapture::writerThread, this));
+        }
+    }
+
+    AsyncFrameCapture::~AsyncFrameCapture()
+    {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mWorkCond.notify_all();
+        for (auto& t : mThreads) t.join();
+    }
+
+    const AsyncFrameCapture::SharedPtr& AsyncFrameCapture::getDefault()
+    {
+        if (spDefault == nullptr) spDefault = create();
+        return spDefault;
+    }
+
+    void AsyncFrameCapture::releaseDefault()
+    {
+        spDefault = nullptr;
+    }
+
+    bool AsyncFrameCapture::capture(const Texture* pTexture, uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags)
+    {
+        recycleCompletedTasks();
+
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (mPendingFrames >= mDesc.maxPendingFrames)
+            {
+                if (mDesc.queueFullPolicy == QueueFullPolicy::DropNewest)
+                {
+                    mStats.framesDropped++;
+                    return false;
+                }
+
+                // All pending frames may already be with a writer, in which case there's nothing to drop and we have to wait
+                if (mDesc.queueFullPolicy == QueueFullPolicy::DropOldest && mQueue.empty() == false)
+                {
+                    mCompletedTasks.push_back(mQueue.front().pTask);
+                    mQueue.pop_front();
+                    mPendingFrames--;
+                    mStats.framesDropped++;
+                }
+                else
+                {
+                    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+                    mDoneCond.wait(lock, [this] { return mPendingFrames < mDesc.maxPendingFrames; });
+                    mStats.blockedTimeMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+                }
+            }
+        }
+
+        // Writers only return tasks, they never create them, so anything that was freed while we waited can be reused now
+        recycleCompletedTasks();
+
+        Job job;
+        job.filename = filename;
+        job.width = pTexture->getWidth(mipLevel);
+        job.height = pTexture->getHeight(mipLevel);
+        job.format = pTexture->getFormat();
+        job.fileFormat = fileFormat;
+        job.exportFlags = exportFlags;
+
+        // Record the copy and submit it. The writer waits on the task's fence, so the render loop never stalls here.
+        uint32_t subresource = pTexture->getSubresourceIndex(arraySlice, mipLevel);
+        size_t minSize = size_t(job.width) * job.height * getFormatBytesPerBlock(job.format);
+        job.pTask = gpDevice->getRenderContext()->asyncReadTextureSubresource(pTexture, subresource, acquireStagingBuffer(minSize));
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mStats.framesCaptured == 0) mFirstCapture = CpuTimer::getCurrentTimePoint();
+            mStats.framesCaptured++;
+            mPendingFrames++;
+            mStats.maxPendingFrames = std::max(mStats.maxPendingFrames, mPendingFrames);
+            mQueue.push_back(std::move(job));
+        }
+        mWorkCond.notify_one();
+        return true;
+    }
+
+    void AsyncFrameCapture::writerThread()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWorkCond.wait(lock, [this] { return mTerminate || mQueue.empty() == false; });
+                if (mQueue.empty()) return;
+                job = std::move(mQueue.front());
+                mQueue.pop_front();
+            }
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            std::vector<uint8> data = job.pTask->getData();
+            CpuTimer::TimePoint readDone = CpuTimer::getCurrentTimePoint();
+            Bitmap::saveImage(job.filename, job.width, job.height, job.fileFormat, job.exportFlags, job.format, true, data.data());
+            CpuTimer::TimePoint writeDone = CpuTimer::getCurrentTimePoint();
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                // The task owns a fence and the staging buffer. Hand it back so they're released (or reused) on the render thread.
+                mCompletedTasks.push_back(std::move(job.pTask));
+                mPendingFrames--;
+                mStats.framesWritten++;
+                mStats.readbackTimeMs += CpuTimer::calcDuration(start, readDone);
+                mStats.encodeTimeMs += CpuTimer::calcDuration(readDone, writeDone);
+                mLastWrite = writeDone;
+            }
+            mDoneCond.notify_all();
+        }
+    }
+
+    void AsyncFrameCapture::recycleCompletedTasks()
+    {
+        std::vector<CopyContext::ReadTextureTask::SharedPtr> completed;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            completed.swap(mCompletedTasks);
+        }
+
+        for (auto& pTask : completed)
+        {
+            mFreeStagingBuffers.push_back(pTask->getBuffer());
+        }
+
+        // Keep at most one buffer per in-flight frame. Release the smallest ones, they're the least likely to be reused.
+        if (mFreeStagingBuffers.size() > mDesc.maxPendingFrames)
+        {
+            std::sort(mFreeStagingBuffers.begin(), mFreeStagingBuffers.end(), [](const Buffer::SharedPtr& a, const Buffer::SharedPtr& b) { return a->getSize() > b->getSize(); });
+            mFreeStagingBuffers.resize(mDesc.maxPendingFrames);
+        }
+    }
+
+    Buffer::SharedPtr AsyncFrameCapture::acquireStagingBuffer(size_t minSize)
+    {
+        // Best fit. minSize ignores row-pitch alignment, so the copy may still decide the buffer is too small and allocate its own.
+        auto best = mFreeStagingBuffers.end();
+        for (auto it = mFreeStagingBuffers.begin(); it != mFreeStagingBuffers.end(); it++)
+        {
+            if ((*it)->getSize() >= minSize && (best == mFreeStagingBuffers.end() || (*it)->getSize() < (*best)->getSize())) best = it;
+        }
+        if (best == mFreeStagingBuffers.end()) return nullptr;
+
+        Buffer::SharedPtr pBuffer = *best;
+        mFreeStagingBuffers.erase(best);
+        return pBuffer;
+    }
+
+    void AsyncFrameCapture::flush()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mDoneCond.wait(lock, [this] { return mPendingFrames == 0; });
+        }
+        recycleCompletedTasks();
+    }
+
+    uint32_t AsyncFrameCapture::getPendingFrameCount() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mPendingFrames;
+    }
+
+    AsyncFrameCapture::Stats AsyncFrameCapture::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Stats stats = mStats;
+        if (stats.framesWritten > 0)
+        {
+            double seconds = CpuTimer::calcDuration(mFirstCapture, mLastWrite) / 1000.0;
+            stats.framesPerSecond = (seconds > 0) ? double(stats.framesWritten) / seconds : 0;
+        }
+        return stats;
+    }
+
+    void AsyncFrameCapture::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats = Stats();
+    }
+
+    std::string AsyncFrameCapture::getStatsString() const
+    {
+        Stats stats = getStats();
+        double written = (double)std::max<uint64_t>(1, stats.framesWritten);
+        std::stringstream s;
+        s << std::fixed << std::setprecision(2);
+        s << "Frame capture: " << stats.framesWritten << "/" << stats.framesCaptured << " frames written, " << stats.framesDropped << " dropped, "
+          << stats.framesPerSecond << " frames/sec, " << stats.readbackTimeMs / written << " ms readback + " << stats.encodeTimeMs / written << " ms encode per frame, "
+          << stats.blockedTimeMs << " ms blocked, max " << stats.maxPendingFrames << " frames in flight";
+        return s.str();
+    }
+}
@@ -0,0 +1,168 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "API/CopyContext.h"
+#include "Utils/Bitmap.h"
+#include "Utils/CpuTimer.h"
+
+namespace Falcor
+{
+    class Texture;
+
+    /** Writes textures to image files without stalling the render loop.
+        Texture::captureToFile() used to read the texture back synchronously (a full GPU flush) and then spawn a thread per
+        frame to encode it. That is fine for the occasional screenshot, but makes frame-sequence capture run at the speed of
+        the slowest PNG/EXR encode.
+
+        capture() records a copy into a CPU-readable staging buffer and returns immediately. A fixed set of writer threads waits
+        for the copy, encodes the image and writes it to disk. Staging buffers are recycled once their frame has been written,
+        so steady-state capture doesn't allocate GPU memory.
+
+        The number of frames in flight (copied but not yet written) is bounded by Desc::maxPendingFrames. What happens when
+        that limit is reached is controlled by Desc::queueFullPolicy.
+
+        capture(), flush() and the destructor must be called from the thread that owns the render context.
+    */
+    class AsyncFrameCapture
+    {
+    public:
+        using SharedPtr = std::shared_ptr<AsyncFrameCapture>;
+        using SharedConstPtr = std::shared_ptr<const AsyncFrameCapture>;
+
+        /** What capture() does when Desc::maxPendingFrames frames are already in flight
+        */
+        enum class QueueFullPolicy
+        {
+            Block,          ///< Wait until a writer thread finishes a frame. No frame is lost.
+            DropNewest,     ///< Don't capture the new frame
+            DropOldest,     ///< Discard the oldest frame that no writer has started on yet, then capture the new frame
+        };
+
+        struct Desc
+        {
+            uint32_t writerThreadCount = 4;                     ///< Number of threads encoding and writing images
+            uint32_t maxPendingFrames = 16;                     ///< Maximum number of frames copied but not yet written
+            QueueFullPolicy queueFullPolicy = QueueFullPolicy::Block;
+        };
+
+        struct Stats
+        {
+            uint64_t framesCaptured = 0;        ///< Frames accepted by capture()
+            uint64_t framesWritten = 0;         ///< Frames written to disk
+            uint64_t framesDropped = 0;         ///< Frames discarded because of the queue-full policy
+            uint32_t maxPendingFrames = 0;      ///< High-water mark of frames in flight
+            double blockedTimeMs = 0;           ///< Time capture() spent waiting for a free slot (QueueFullPolicy::Block)
+            double readbackTimeMs = 0;          ///< Total writer time spent waiting for the GPU copy and reading the staging buffer
+            double encodeTimeMs = 0;            ///< Total writer time spent encoding and writing files
+            double framesPerSecond = 0;         ///< Write throughput, from the first capture to the last completed write
+        };
+
+        static SharedPtr create();
+        static SharedPtr create(const Desc& desc);
+        ~AsyncFrameCapture();
+
+        /** Capture a texture subresource to a file.
+            \param[in] pTexture The texture to capture. It only needs to stay alive until this call returns.
+            \param[in] mipLevel, arraySlice The subresource to capture.
+            \param[in] filename Output filename.
+            \param[in] fileFormat, exportFlags Passed to Bitmap::saveImage().
+            \return true if the frame was queued, false if it was dropped.
+        */
+        bool capture(const Texture* pTexture, uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None);
+
+        /** Block until every queued frame has been written.
+        */
+        void flush();
+
+        /** Get the number of frames copied but not yet written
+        */
+        uint32_t getPendingFrameCount() const;
+
+        Stats getStats() const;
+        void resetStats();
+
+        /** Get a one-line summary of the stats, for logging
+        */
+        std::string getStatsString() const;
+
+        const Desc& getDesc() const { return mDesc; }
+
+        /** Get the instance used by Texture::captureToFile(). Created on first use.
+        */
+        static const SharedPtr& getDefault();
+
+        /** Flush and destroy the default instance. Called by Sample before the device is destroyed.
+        */
+        static void releaseDefault();
+
+    private:
+        AsyncFrameCapture(const Desc& desc);
+
+        struct Job
+        {
+            CopyContext::ReadTextureTask::SharedPtr pTask;
+            std::string filename;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            ResourceFormat format = ResourceFormat::Unknown;
+            Bitmap::FileFormat fileFormat = Bitmap::FileFormat::PngFile;
+            Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None;
+        };
+
+        void writerThread();
+        void recycleCompletedTasks();
+        Buffer::SharedPtr acquireStagingBuffer(size_t minSize);
+
+        Desc mDesc;
+        std::vector<std::thread> mThreads;
+
+        // Shared with the writer threads, guarded by mMutex
+        mutable std::mutex mMutex;
+        std::condition_variable mWorkCond;      ///< Signaled when a job is queued or we're shutting down
+        std::condition_variable mDoneCond;      ///< Signaled when a writer finishes a job
+        std::deque<Job> mQueue;                 ///< Jobs no writer has started on yet
+        std::vector<CopyContext::ReadTextureTask::SharedPtr> mCompletedTasks;   ///< Finished (or dropped) jobs whose staging buffers can be reused
+        uint32_t mPendingFrames = 0;            ///< Queued jobs + jobs being written
+        bool mTerminate = false;
+        Stats mStats;
+        CpuTimer::TimePoint mFirstCapture;
+        CpuTimer::TimePoint mLastWrite;
+
+        // Only touched by the thread calling capture()
+        std::vector<Buffer::SharedPtr> mFreeStagingBuffers;
+
+        static SharedPtr spDefault;
+    };
+}
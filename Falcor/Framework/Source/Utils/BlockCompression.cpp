@@ -0,0 +1,424 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "BlockCompression.h"
+#include "Utils/Math/SimdFloat4.h"
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace BlockCompression
+    {
+        namespace
+        {
+            // A block in SoA form. texels[c] holds channel c of the 16 texels, rows[c][r] is row r of that channel.
+            struct Block
+            {
+                float texels[4][16];
+                SimdFloat4 rows[4][4];
+            };
+
+            void loadBlock(const uint8_t pPixels[64], Block& block)
+            {
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    for (uint32_t c = 0; c < 4; c++) block.texels[c][i] = pPixels[i * 4 + c];
+                }
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    for (uint32_t r = 0; r < 4; r++) block.rows[c][r] = SimdFloat4::load(&block.texels[c][r * 4]);
+                }
+            }
+
+            // Mean and principal axis of the first channelCount channels, found with a few power iterations on the covariance matrix
+            void findPrincipalAxis(const Block& block, uint32_t channelCount, float mean[4], float axis[4])
+            {
+                SimdFloat4 centered[4][4];
+                for (uint32_t c = 0; c < channelCount; c++)
+                {
+                    SimdFloat4 sum = block.rows[c][0] + block.rows[c][1] + block.rows[c][2] + block.rows[c][3];
+                    mean[c] = simdHorizontalSum(sum) / 16.0f;
+                    for (uint32_t r = 0; r < 4; r++) centered[c][r] = block.rows[c][r] - SimdFloat4(mean[c]);
+                }
+
+                float cov[4][4];
+                for (uint32_t a = 0; a < channelCount; a++)
+                {
+                    for (uint32_t b = a; b < channelCount; b++)
+                    {
+                        SimdFloat4 sum = centered[a][0] * centered[b][0] + centered[a][1] * centered[b][1] + centered[a][2] * centered[b][2] + centered[a][3] * centered[b][3];
+                        cov[a][b] = cov[b][a] = simdHorizontalSum(sum);
+                    }
+                }
+
+                for (uint32_t c = 0; c < channelCount; c++) axis[c] = 1.0f;
+                for (uint32_t iter = 0; iter < 8; iter++)
+                {
+                    float next[4] = {};
+                    float lengthSq = 0;
+                    for (uint32_t a = 0; a < channelCount; a++)
+                    {
+                        for (uint32_t b = 0; b < channelCount; b++) next[a] += cov[a][b] * axis[b];
+                        lengthSq += next[a] * next[a];
+                    }
+                    // A flat block has no principal axis. Any direction will do, the projection is zero either way.
+                    if (lengthSq < 1e-12f) break;
+                    float invLength = 1.0f / std::sqrt(lengthSq);
+                    for (uint32_t c = 0; c < channelCount; c++) axis[c] = next[c] * invLength;
+                }
+            }
+
+            // Project the texels on the axis and return the extreme points along it
+            void findEndpoints(const Block& block, uint32_t channelCount, float ep0[4], float ep1[4])
+            {
+                float mean[4], axis[4];
+                findPrincipalAxis(block, channelCount, mean, axis);
+
+                SimdFloat4 tMin(FLT_MAX), tMax(-FLT_MAX);
+                for (uint32_t r = 0; r < 4; r++)
+                {
+                    SimdFloat4 t(0.0f);
+                    for (uint32_t c = 0; c < channelCount; c++) t = t + (block.rows[c][r] - SimdFloat4(mean[c])) * SimdFloat4(axis[c]);
+                    tMin = simdMin(tMin, t);
+                    tMax = simdMax(tMax, t);
+                }
+
+                float lo = simdHorizontalMin(tMin), hi = simdHorizontalMax(tMax);
+                for (uint32_t c = 0; c < channelCount; c++)
+                {
+                    ep0[c] = std::min(std::max(mean[c] + axis[c] * hi, 0.0f), 255.0f);
+                    ep1[c] = std::min(std::max(mean[c] + axis[c] * lo, 0.0f), 255.0f);
+                }
+            }
+
+            // For each texel, find the closest of paletteSize colors. Returns the total squared error.
+            float findIndices(const Block& block, uint32_t channelCount, const float palette[][4], uint32_t paletteSize, uint8_t indices[16])
+            {
+                float error = 0;
+                for (uint32_t r = 0; r < 4; r++)
+                {
+                    SimdFloat4 bestDist(FLT_MAX), bestIndex(0.0f);
+                    for (uint32_t k = 0; k < paletteSize; k++)
+                    {
+                        SimdFloat4 dist(0.0f);
+                        for (uint32_t c = 0; c < channelCount; c++)
+                        {
+                            SimdFloat4 d = block.rows[c][r] - SimdFloat4(palette[k][c]);
+                            dist = dist + d * d;
+                        }
+                        SimdFloat4 closer = simdLess(dist, bestDist);
+                        bestDist = simdSelect(bestDist, dist, closer);
+                        bestIndex = simdSelect(bestIndex, SimdFloat4((float)k), closer);
+                    }
+                    error += simdHorizontalSum(bestDist);
+
+                    float rowIndices[4];
+                    bestIndex.store(rowIndices);
+                    for (uint32_t i = 0; i < 4; i++) indices[r * 4 + i] = (uint8_t)rowIndices[i];
+                }
+                return error;
+            }
+
+            // Least-squares fit of the endpoints to the texels, given the weight of endpoint 0 for each texel
+            bool fitEndpoints(const Block& block, uint32_t channelCount, const float weights[16], float ep0[4], float ep1[4])
+            {
+                float aa = 0, ab = 0, bb = 0;
+                float ax[4] = {}, bx[4] = {};
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    float a = weights[i], b = 1.0f - a;
+                    aa += a * a;
+                    ab += a * b;
+                    bb += b * b;
+                    for (uint32_t c = 0; c < channelCount; c++)
+                    {
+                        ax[c] += a * block.texels[c][i];
+                        bx[c] += b * block.texels[c][i];
+                    }
+                }
+
+                float det = aa * bb - ab * ab;
+                if (std::abs(det) < 1e-6f) return false;
+                float invDet = 1.0f / det;
+                for (uint32_t c = 0; c < channelCount; c++)
+                {
+                    ep0[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) * invDet, 0.0f), 255.0f);
+                    ep1[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) * invDet, 0.0f), 255.0f);
+                }
+                return true;
+            }
+
+            uint16_t quantize565(const float color[4])
+            {
+                uint32_t r = (uint32_t)std::lround(color[0] * 31.0f / 255.0f);
+                uint32_t g = (uint32_t)std::lround(color[1] * 63.0f / 255.0f);
+                uint32_t b = (uint32_t)std::lround(color[2] * 31.0f / 255.0f);
+                return (uint16_t)((r << 11) | (g << 5) | b);
+            }
+
+            void expand565(uint16_t c, float color[4])
+            {
+                uint32_t r = (c >> 11) & 0x1f, g = (c >> 5) & 0x3f, b = c & 0x1f;
+                color[0] = (float)((r << 3) | (r >> 2));
+                color[1] = (float)((g << 2) | (g >> 4));
+                color[2] = (float)((b << 3) | (b >> 2));
+                color[3] = 0;
+            }
+
+            // Quantize the endpoints and find the indices for the 4-color BC1 palette
+            float evalBC1(const Block& block, const float ep0[4], const float ep1[4], uint16_t& c0, uint16_t& c1, uint8_t indices[16])
+            {
+                c0 = quantize565(ep0);
+                c1 = quantize565(ep1);
+
+                float palette[4][4];
+                expand565(c0, palette[0]);
+                expand565(c1, palette[1]);
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                    palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+                }
+                return findIndices(block, 3, palette, 4, indices);
+            }
+
+            void encodeBC1Block(const Block& block, uint8_t pBlock[8])
+            {
+                static const float kWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+                float ep0[4], ep1[4];
+                findEndpoints(block, 3, ep0, ep1);
+
+                uint16_t c0, c1;
+                uint8_t indices[16];
+                float error = evalBC1(block, ep0, ep1, c0, c1, indices);
+
+                // One refinement step. Fitting the endpoints to the chosen indices usually reduces the error noticeably.
+                float weights[16];
+                for (uint32_t i = 0; i < 16; i++) weights[i] = kWeights[indices[i]];
+                if (error > 0 && fitEndpoints(block, 3, weights, ep0, ep1))
+                {
+                    uint16_t fit0, fit1;
+                    uint8_t fitIndices[16];
+                    if (evalBC1(block, ep0, ep1, fit0, fit1, fitIndices) < error)
+                    {
+                        c0 = fit0;
+                        c1 = fit1;
+                        std::memcpy(indices, fitIndices, sizeof(indices));
+                    }
+                }
+
+                uint32_t packed = 0;
+                for (uint32_t i = 0; i < 16; i++) packed |= (uint32_t)indices[i] << (i * 2);
+
+                // c0 > c1 selects the 4-color mode. Swapping the endpoints swaps indices 0<->1 and 2<->3.
+                if (c0 < c1)
+                {
+                    std::swap(c0, c1);
+                    packed ^= 0x55555555;
+                }
+                else if (c0 == c1)
+                {
+                    packed = 0;
+                }
+
+                std::memcpy(pBlock, &c0, 2);
+                std::memcpy(pBlock + 2, &c1, 2);
+                std::memcpy(pBlock + 4, &packed, 4);
+            }
+
+            void encodeBC4Block(const Block& block, uint32_t channel, uint8_t pBlock[8])
+            {
+                const SimdFloat4* pRows = block.rows[channel];
+                float lo = simdHorizontalMin(simdMin(simdMin(pRows[0], pRows[1]), simdMin(pRows[2], pRows[3])));
+                float hi = simdHorizontalMax(simdMax(simdMax(pRows[0], pRows[1]), simdMax(pRows[2], pRows[3])));
+
+                // a0 > a1 selects the 8-value mode, where index 0 is a0, 1 is a1 and 2-7 interpolate from a0 to a1
+                uint8_t a0 = (uint8_t)hi, a1 = (uint8_t)lo;
+                std::memset(pBlock, 0, 8);
+                pBlock[0] = a0;
+                pBlock[1] = a1;
+                if (a0 == a1) return;
+
+                SimdFloat4 scale(7.0f / (float)(a0 - a1));
+                uint64_t packed = 0;
+                for (uint32_t r = 0; r < 4; r++)
+                {
+                    float steps[4];
+                    simdClamp(simdRound((pRows[r] - SimdFloat4((float)a1)) * scale), 0.0f, 7.0f).store(steps);
+                    for (uint32_t i = 0; i < 4; i++)
+                    {
+                        uint32_t step = (uint32_t)steps[i];
+                        uint64_t index = (step == 7) ? 0 : (step == 0) ? 1 : 8 - step;
+                        packed |= index << ((r * 4 + i) * 3);
+                    }
+                }
+                std::memcpy(pBlock + 2, &packed, 6);
+            }
+
+            class BitWriter
+            {
+            public:
+                BitWriter(uint8_t* pData, uint32_t size) : mpData(pData) { std::memset(pData, 0, size); }
+                void write(uint32_t value, uint32_t bits)
+                {
+                    for (uint32_t i = 0; i < bits; i++, mPos++)
+                    {
+                        if ((value >> i) & 1) mpData[mPos >> 3] |= (uint8_t)(1 << (mPos & 7));
+                    }
+                }
+            private:
+                uint8_t* mpData;
+                uint32_t mPos = 0;
+            };
+
+            static const uint32_t kBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+            // Quantize an endpoint to 7 bits per channel plus a shared p-bit, picking the p-bit with the lower error
+            void quantizeBC7Endpoint(const float ep[4], uint8_t q[4], uint32_t& pBit)
+            {
+                float bestError = FLT_MAX;
+                for (uint32_t p = 0; p < 2; p++)
+                {
+                    uint8_t candidate[4];
+                    float error = 0;
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        int32_t v = (int32_t)std::lround((ep[c] - (float)p) * 0.5f);
+                        candidate[c] = (uint8_t)std::min(std::max(v, 0), 127);
+                        float d = (float)((candidate[c] << 1) | p) - ep[c];
+                        error += d * d;
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        pBit = p;
+                        std::memcpy(q, candidate, 4);
+                    }
+                }
+            }
+
+            float evalBC7(const Block& block, const float ep0[4], const float ep1[4], uint8_t q0[4], uint8_t q1[4], uint32_t& p0, uint32_t& p1, uint8_t indices[16])
+            {
+                quantizeBC7Endpoint(ep0, q0, p0);
+                quantizeBC7Endpoint(ep1, q1, p1);
+
+                float palette[16][4];
+                for (uint32_t k = 0; k < 16; k++)
+                {
+                    uint32_t w = kBC7Weights4[k];
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        uint32_t e0 = (q0[c] << 1) | p0, e1 = (q1[c] << 1) | p1;
+                        palette[k][c] = (float)(((64 - w) * e0 + w * e1 + 32) >> 6);
+                    }
+                }
+                return findIndices(block, 4, palette, 16, indices);
+            }
+
+            void encodeBC7Block(const Block& block, uint8_t pBlock[16])
+            {
+                float ep0[4], ep1[4];
+                findEndpoints(block, 4, ep0, ep1);
+
+                uint8_t q0[4], q1[4], indices[16];
+                uint32_t p0, p1;
+                float error = evalBC7(block, ep0, ep1, q0, q1, p0, p1, indices);
+
+                float weights[16];
+                for (uint32_t i = 0; i < 16; i++) weights[i] = 1.0f - kBC7Weights4[indices[i]] / 64.0f;
+                if (error > 0 && fitEndpoints(block, 4, weights, ep0, ep1))
+                {
+                    uint8_t fitQ0[4], fitQ1[4], fitIndices[16];
+                    uint32_t fitP0, fitP1;
+                    if (evalBC7(block, ep0, ep1, fitQ0, fitQ1, fitP0, fitP1, fitIndices) < error)
+                    {
+                        std::memcpy(q0, fitQ0, 4);
+                        std::memcpy(q1, fitQ1, 4);
+                        std::memcpy(indices, fitIndices, 16);
+                        p0 = fitP0;
+                        p1 = fitP1;
+                    }
+                }
+
+                // The MSB of the first index is implicitly 0. Swapping the endpoints flips the indices.
+                if (indices[0] >= 8)
+                {
+                    for (uint32_t c = 0; c < 4; c++) std::swap(q0[c], q1[c]);
+                    std::swap(p0, p1);
+                    for (uint32_t i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+                }
+
+                BitWriter writer(pBlock, 16);
+                writer.write(1 << 6, 7);    // Mode 6
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    writer.write(q0[c], 7);
+                    writer.write(q1[c], 7);
+                }
+                writer.write(p0, 1);
+                writer.write(p1, 1);
+                writer.write(indices[0], 3);
+                for (uint32_t i = 1; i < 16; i++) writer.write(indices[i], 4);
+            }
+        }
+
+        void encodeBC1(const uint8_t pPixels[64], uint8_t pBlock[8])
+        {
+            Block block;
+            loadBlock(pPixels, block);
+            encodeBC1Block(block, pBlock);
+        }
+
+        void encodeBC3(const uint8_t pPixels[64], uint8_t pBlock[16])
+        {
+            Block block;
+            loadBlock(pPixels, block);
+            encodeBC4Block(block, 3, pBlock);
+            encodeBC1Block(block, pBlock + 8);
+        }
+
+        void encodeBC5(const uint8_t pPixels[64], uint8_t pBlock[16])
+        {
+            Block block;
+            loadBlock(pPixels, block);
+            encodeBC4Block(block, 0, pBlock);
+            encodeBC4Block(block, 1, pBlock + 8);
+        }
+
+        void encodeBC7(const uint8_t pPixels[64], uint8_t pBlock[16])
+        {
+            Block block;
+            loadBlock(pPixels, block);
+            encodeBC7Block(block, pBlock);
+        }
+    }
+}
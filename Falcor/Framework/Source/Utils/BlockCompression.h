@@ -0,0 +1,57 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <stdint.h>
+
+namespace Falcor
+{
+    /** CPU block-compression encoders.
+        Each function encodes one 4x4 block of RGBA8 pixels, given in row-major order (texel (x, y) is at pPixels[(y * 4 + x) * 4]).
+        Partial blocks at the edge of an image should be padded by replicating edge texels.
+        The endpoint search and index selection process four texels at a time with SSE2 when it's available.
+    */
+    namespace BlockCompression
+    {
+        /** Encode the RGB channels as a BC1 block (8 bytes). Alpha is ignored.
+        */
+        void encodeBC1(const uint8_t pPixels[64], uint8_t pBlock[8]);
+
+        /** Encode RGBA as a BC3 block (16 bytes): a BC4 block for alpha followed by a BC1 block for the color.
+        */
+        void encodeBC3(const uint8_t pPixels[64], uint8_t pBlock[16]);
+
+        /** Encode the R and G channels as a BC5 block (16 bytes), for two-channel normal maps.
+        */
+        void encodeBC5(const uint8_t pPixels[64], uint8_t pBlock[16]);
+
+        /** Encode RGBA as a BC7 block (16 bytes). Only mode 6 (a single subset with 7.7.7.7 endpoints, per-endpoint p-bits and 4-bit indices) is used.
+            Encoding is a lot faster than a full mode search, and the quality is still well above BC1/BC3 for most textures.
+        */
+        void encodeBC7(const uint8_t pPixels[64], uint8_t pBlock[16]);
+    }
+}
@@ -0,0 +1,223 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Lz4.h"
+#include <cstring>
+#include <vector>
+
+namespace Falcor
+{
+    namespace Lz4
+    {
+        namespace
+        {
+            // Limits of the block format. Matches are at least 4 bytes, the last 5 bytes are always literals, and the last match starts at least 12 bytes before the end.
+            const size_t kMinMatch = 4;
+            const size_t kLastLiterals = 5;
+            const size_t kMatchSearchLimit = 12;
+            const size_t kMaxOffset = 65535;
+            const uint32_t kHashBits = 14;
+            const size_t kWildCopy = 16;
+            const uint32_t kSkipTrigger = 6;            // Search faster through data that doesn't compress, one more byte per step every 64 misses
+
+            uint32_t read32(const uint8_t* p)
+            {
+                uint32_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+
+            uint32_t hash(uint32_t sequence)
+            {
+                return (sequence * 2654435761u) >> (32 - kHashBits);
+            }
+
+            // Writes the 255-byte extension of a literal or match length
+            uint8_t* writeLength(uint8_t* pOut, size_t length)
+            {
+                for (; length >= 255; length -= 255) *pOut++ = 255;
+                *pOut++ = (uint8_t)length;
+                return pOut;
+            }
+
+            bool readLength(const uint8_t*& pIn, const uint8_t* pInEnd, size_t& length)
+            {
+                uint8_t b;
+                do
+                {
+                    if (pIn >= pInEnd) return false;
+                    b = *pIn++;
+                    length += b;
+                } while (b == 255);
+                return true;
+            }
+
+            // Appends a sequence: a token, literals, and a match if matchLength isn't 0. Returns nullptr if it doesn't fit.
+            uint8_t* writeSequence(uint8_t* pOut, const uint8_t* pOutEnd, const uint8_t* pLiterals, size_t literalLength, size_t offset, size_t matchLength)
+            {
+                size_t size = 1 + literalLength + (literalLength >= 15 ? (literalLength - 15) / 255 + 1 : 0);
+                if (matchLength) size += 2 + (matchLength - kMinMatch >= 15 ? (matchLength - kMinMatch - 15) / 255 + 1 : 0);
+                if (size > (size_t)(pOutEnd - pOut)) return nullptr;
+
+                uint8_t* pToken = pOut++;
+                *pToken = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+                if (literalLength >= 15) pOut = writeLength(pOut, literalLength - 15);
+                if (literalLength) std::memcpy(pOut, pLiterals, literalLength);
+                pOut += literalLength;
+
+                if (matchLength)
+                {
+                    *pOut++ = (uint8_t)(offset & 0xff);
+                    *pOut++ = (uint8_t)(offset >> 8);
+                    size_t length = matchLength - kMinMatch;
+                    *pToken |= (uint8_t)(length < 15 ? length : 15);
+                    if (length >= 15) pOut = writeLength(pOut, length - 15);
+                }
+                return pOut;
+            }
+        }
+
+        size_t compressBound(size_t size)
+        {
+            return size + size / 255 + 16;
+        }
+
+        size_t compress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstCapacity)
+        {
+            const uint8_t* pEnd = pSrc + srcSize;
+            const uint8_t* pAnchor = pSrc;
+            uint8_t* pOut = pDst;
+            const uint8_t* pOutEnd = pDst + dstCapacity;
+
+            if (srcSize > kMatchSearchLimit)
+            {
+                // Positions of the last sequence with each hash. Stale or colliding entries are rejected by comparing the bytes.
+                std::vector<uint32_t> table(size_t(1) << kHashBits, 0);
+                const uint8_t* pSearchEnd = pEnd - kMatchSearchLimit;
+                const uint8_t* pMatchEnd = pEnd - kLastLiterals;
+                const uint8_t* pCur = pSrc + 1;
+                uint32_t misses = 0;
+
+                while (pCur <= pSearchEnd)
+                {
+                    uint32_t sequence = read32(pCur);
+                    uint32_t h = hash(sequence);
+                    const uint8_t* pCandidate = pSrc + table[h];
+                    table[h] = (uint32_t)(pCur - pSrc);
+
+                    if (pCandidate >= pCur || (size_t)(pCur - pCandidate) > kMaxOffset || read32(pCandidate) != sequence)
+                    {
+                        pCur += 1 + (misses++ >> kSkipTrigger);
+                        continue;
+                    }
+                    misses = 0;
+
+                    // Extend the match backwards over the pending literals, then forwards
+                    while (pCur > pAnchor && pCandidate > pSrc && pCur[-1] == pCandidate[-1])
+                    {
+                        pCur--;
+                        pCandidate--;
+                    }
+                    size_t length = kMinMatch;
+                    while (pCur + length < pMatchEnd && pCur[length] == pCandidate[length]) length++;
+
+                    pOut = writeSequence(pOut, pOutEnd, pAnchor, pCur - pAnchor, pCur - pCandidate, length);
+                    if (pOut == nullptr) return 0;
+                    pCur += length;
+                    pAnchor = pCur;
+
+                    // Index a position inside the match, it often starts the next one
+                    if (pCur <= pSearchEnd) table[hash(read32(pCur - 2))] = (uint32_t)(pCur - 2 - pSrc);
+                }
+            }
+
+            pOut = writeSequence(pOut, pOutEnd, pAnchor, pEnd - pAnchor, 0, 0);
+            return pOut ? pOut - pDst : 0;
+        }
+
+        bool decompress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize)
+        {
+            const uint8_t* pIn = pSrc;
+            const uint8_t* pInEnd = pSrc + srcSize;
+            uint8_t* pOut = pDst;
+            uint8_t* pOutEnd = pDst + dstSize;
+
+            while (true)
+            {
+                if (pIn >= pInEnd) return false;
+                uint8_t token = *pIn++;
+
+                size_t literalLength = token >> 4;
+                if (literalLength == 15 && readLength(pIn, pInEnd, literalLength) == false) return false;
+                if (literalLength > (size_t)(pInEnd - pIn) || literalLength > (size_t)(pOutEnd - pOut)) return false;
+                if (literalLength <= kWildCopy && pInEnd - pIn >= (ptrdiff_t)kWildCopy && pOutEnd - pOut >= (ptrdiff_t)kWildCopy)
+                {
+                    // Most literal runs are short. A fixed-size copy is faster than a variable one, the extra bytes are overwritten later.
+                    std::memcpy(pOut, pIn, kWildCopy);
+                }
+                else if (literalLength)
+                {
+                    std::memcpy(pOut, pIn, literalLength);
+                }
+                pIn += literalLength;
+                pOut += literalLength;
+
+                // The last sequence has no match
+                if (pIn == pInEnd) return pOut == pOutEnd;
+
+                if (pInEnd - pIn < 2) return false;
+                size_t offset = pIn[0] | (pIn[1] << 8);
+                pIn += 2;
+                if (offset == 0 || offset > (size_t)(pOut - pDst)) return false;
+
+                size_t matchLength = token & 15;
+                if (matchLength == 15 && readLength(pIn, pInEnd, matchLength) == false) return false;
+                matchLength += kMinMatch;
+                if (matchLength > (size_t)(pOutEnd - pOut)) return false;
+
+                // Matches may overlap the bytes they produce, repeating the last offset bytes. A period shorter than 8 bytes is first
+                // written out byte by byte until it's a multiple of the offset which is at least 8 bytes long.
+                uint8_t* pMatchOutEnd = pOut + matchLength;
+                size_t period = offset;
+                while (period < 8) period += offset;
+                for (size_t i = period - offset; i > 0 && pOut < pMatchOutEnd; i--, pOut++) *pOut = *(pOut - offset);
+
+                // Then copy 8 bytes at a time, overshooting when there is room
+                const uint8_t* pMatch = pOut - period;
+                if (pOutEnd - pMatchOutEnd >= 8)
+                {
+                    for (; pOut < pMatchOutEnd; pOut += 8, pMatch += 8) std::memcpy(pOut, pMatch, 8);
+                    pOut = pMatchOutEnd;
+                    continue;
+                }
+                for (; pMatchOutEnd - pOut >= 8; pOut += 8, pMatch += 8) std::memcpy(pOut, pMatch, 8);
+                while (pOut < pMatchOutEnd) *pOut++ = *pMatch++;
+            }
+        }
+    }
+}
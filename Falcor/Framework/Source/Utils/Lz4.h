@@ -0,0 +1,61 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace Falcor
+{
+    /** Compression in the LZ4 block format.
+        Compression is a single greedy pass with a hash table of recent 4-byte sequences, which favors speed over ratio. Decompression
+        is a simple copy loop. Blocks are interchangeable with the reference implementation's LZ4_compress_default() and LZ4_decompress_safe().
+        Each call is independent and thread-safe. Split large data into blocks to compress or decompress it in parallel.
+    */
+    namespace Lz4
+    {
+        /** Get the largest size compress() can produce for an input of a given size
+        */
+        size_t compressBound(size_t size);
+
+        /** Compress a block
+            \param[in] pSrc, srcSize The data to compress
+            \param[out] pDst Where to write the compressed block
+            \param[in] dstCapacity Size of pDst. Use compressBound() to always succeed.
+            \return The size of the compressed block, or 0 if it doesn't fit in dstCapacity.
+        */
+        size_t compress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstCapacity);
+
+        /** Decompress a block. Every read and write is bounds-checked, so corrupt or malicious blocks are rejected rather than overrunning the buffers.
+            \param[in] pSrc, srcSize The compressed block
+            \param[out] pDst Where to write the data
+            \param[in] dstSize The size of the data. The block must decompress to exactly this size.
+            \return false if the block is invalid or doesn't decompress to dstSize bytes.
+        */
+        bool decompress(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize);
+    }
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define FALCOR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Falcor
+{
+    /** Four floats processed together, using SSE2 when it's available and plain loops otherwise.
+        Used by the CPU-side data processing code (block compression, mip generation, ...) which needs to run on the same data in bulk.
+        Comparisons return a lane mask, which is only meant to be passed to simdSelect(), simdAnd(), simdOr(), simdAndNot() and simdMoveMask().
+    */
+#ifdef FALCOR_USE_SSE2
+    struct SimdFloat4
+    {
+        static const uint32_t kWidth = 4;
+        __m128 v;
+        SimdFloat4() = default;
+        SimdFloat4(__m128 x) : v(x) {}
+        explicit SimdFloat4(float s) : v(_mm_set1_ps(s)) {}
+        SimdFloat4(float x, float y, float z, float w) : v(_mm_setr_ps(x, y, z, w)) {}
+        static SimdFloat4 load(const float* p) { return _mm_loadu_ps(p); }
+        void store(float* p) const { _mm_storeu_ps(p, v); }
+    };
+
+    inline SimdFloat4 operator+(SimdFloat4 a, SimdFloat4 b) { return _mm_add_ps(a.v, b.v); }
+    inline SimdFloat4 operator-(SimdFloat4 a, SimdFloat4 b) { return _mm_sub_ps(a.v, b.v); }
+    inline SimdFloat4 operator*(SimdFloat4 a, SimdFloat4 b) { return _mm_mul_ps(a.v, b.v); }
+    inline SimdFloat4 operator/(SimdFloat4 a, SimdFloat4 b) { return _mm_div_ps(a.v, b.v); }
+    inline SimdFloat4 simdMin(SimdFloat4 a, SimdFloat4 b) { return _mm_min_ps(a.v, b.v); }
+    inline SimdFloat4 simdMax(SimdFloat4 a, SimdFloat4 b) { return _mm_max_ps(a.v, b.v); }
+    inline SimdFloat4 simdRound(SimdFloat4 a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+    inline SimdFloat4 simdLess(SimdFloat4 a, SimdFloat4 b) { return _mm_cmplt_ps(a.v, b.v); }
+    inline SimdFloat4 simdLessEqual(SimdFloat4 a, SimdFloat4 b) { return _mm_cmple_ps(a.v, b.v); }
+    inline SimdFloat4 simdSelect(SimdFloat4 a, SimdFloat4 b, SimdFloat4 mask) { return _mm_or_ps(_mm_andnot_ps(mask.v, a.v), _mm_and_ps(mask.v, b.v)); }
+    inline SimdFloat4 simdAnd(SimdFloat4 maskA, SimdFloat4 maskB) { return _mm_and_ps(maskA.v, maskB.v); }
+    inline SimdFloat4 simdOr(SimdFloat4 maskA, SimdFloat4 maskB) { return _mm_or_ps(maskA.v, maskB.v); }
+    inline SimdFloat4 simdAndNot(SimdFloat4 maskA, SimdFloat4 maskB) { return _mm_andnot_ps(maskB.v, maskA.v); }
+    inline int simdMoveMask(SimdFloat4 mask) { return _mm_movemask_ps(mask.v); }
+
+    inline float simdHorizontalMin(SimdFloat4 a)
+    {
+        __m128 t = _mm_min_ps(a.v, _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1)));
+        t = _mm_min_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(t);
+    }
+
+    inline float simdHorizontalMax(SimdFloat4 a)
+    {
+        __m128 t = _mm_max_ps(a.v, _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1)));
+        t = _mm_max_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(t);
+    }
+
+    inline float simdHorizontalSum(SimdFloat4 a)
+    {
+        __m128 t = _mm_add_ps(a.v, _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1)));
+        t = _mm_add_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(t);
+    }
+#else
+    struct SimdFloat4
+    {
+        static const uint32_t kWidth = 4;
+        float v[4];
+        SimdFloat4() = default;
+        explicit SimdFloat4(float s) { v[0] = v[1] = v[2] = v[3] = s; }
+        SimdFloat4(float x, float y, float z, float w) { v[0] = x; v[1] = y; v[2] = z; v[3] = w; }
+        static SimdFloat4 load(const float* p) { SimdFloat4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+        void store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+    };
+
+#define simd_lanewise(expr) SimdFloat4 r; for (int i = 0; i < 4; i++) r.v[i] = expr; return r;
+    inline SimdFloat4 operator+(SimdFloat4 a, SimdFloat4 b) { simd_lanewise(a.v[i] + b.v[i]) }
+    inline SimdFloat4 operator-(SimdFloat4 a, SimdFloat4 b) { simd_lanewise(a.v[i] - b.v[i]) }
+    inline SimdFloat4 operator*(SimdFloat4 a, SimdFloat4 b) { simd_lanewise(a.v[i] * b.v[i]) }
+    inline SimdFloat4 operator/(SimdFloat4 a, SimdFloat4 b) { simd_lanewise(a.v[i] / b.v[i]) }
+    inline SimdFloat4 simdMin(SimdFloat4 a, SimdFloat4 b) { simd_lanewise(std::min(a.v[i], b.v[i])) }
+    inline SimdFloat4 simdMax(SimdFloat4 a, SimdFloat4 b) { simd_lanewise(std::max(a.v[i], b.v[i])) }
+    inline SimdFloat4 simdRound(SimdFloat4 a) { simd_lanewise(std::nearbyint(a.v[i])) }
+    inline SimdFloat4 simdLess(SimdFloat4 a, SimdFloat4 b) { simd_lanewise(a.v[i] < b.v[i] ? 1.0f : 0.0f) }
+    inline SimdFloat4 simdLessEqual(SimdFloat4 a, SimdFloat4 b) { simd_lanewise(a.v[i] <= b.v[i] ? 1.0f : 0.0f) }
+    inline SimdFloat4 simdSelect(SimdFloat4 a, SimdFloat4 b, SimdFloat4 mask) { simd_lanewise(mask.v[i] != 0 ? b.v[i] : a.v[i]) }
+    inline SimdFloat4 simdAnd(SimdFloat4 maskA, SimdFloat4 maskB) { simd_lanewise((maskA.v[i] != 0 && maskB.v[i] != 0) ? 1.0f : 0.0f) }
+    inline SimdFloat4 simdOr(SimdFloat4 maskA, SimdFloat4 maskB) { simd_lanewise((maskA.v[i] != 0 || maskB.v[i] != 0) ? 1.0f : 0.0f) }
+    inline SimdFloat4 simdAndNot(SimdFloat4 maskA, SimdFloat4 maskB) { simd_lanewise((maskA.v[i] != 0 && maskB.v[i] == 0) ? 1.0f : 0.0f) }
+    inline int simdMoveMask(SimdFloat4 mask) { return (mask.v[0] != 0 ? 1 : 0) | (mask.v[1] != 0 ? 2 : 0) | (mask.v[2] != 0 ? 4 : 0) | (mask.v[3] != 0 ? 8 : 0); }
+#undef simd_lanewise
+
+    inline float simdHorizontalMin(SimdFloat4 a) { return std::min(std::min(a.v[0], a.v[1]), std::min(a.v[2], a.v[3])); }
+    inline float simdHorizontalMax(SimdFloat4 a) { return std::max(std::max(a.v[0], a.v[1]), std::max(a.v[2], a.v[3])); }
+    inline float simdHorizontalSum(SimdFloat4 a) { return (a.v[0] + a.v[1]) + (a.v[2] + a.v[3]); }
+#endif
+
+    inline SimdFloat4 simdClamp(SimdFloat4 a, float lo, float hi) { return simdMin(simdMax(a, SimdFloat4(lo)), SimdFloat4(hi)); }
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Utils/Math/SimdFloat4.h"
+
+#if defined(__AVX__)
+#define FALCOR_USE_AVX
+#include <immintrin.h>
+#endif
+
+namespace Falcor
+{
+    /** Eight floats processed together, with the same interface as SimdFloat4. Uses AVX when the code is compiled for it (/arch:AVX),
+        and a pair of SimdFloat4 otherwise.
+    */
+#ifdef FALCOR_USE_AVX
+    struct SimdFloat8
+    {
+        static const uint32_t kWidth = 8;
+        __m256 v;
+        SimdFloat8() = default;
+        SimdFloat8(__m256 x) : v(x) {}
+        explicit SimdFloat8(float s) : v(_mm256_set1_ps(s)) {}
+        SimdFloat8(SimdFloat4 l, SimdFloat4 h) : v(_mm256_insertf128_ps(_mm256_castps128_ps256(l.v), h.v, 1)) {}
+        static SimdFloat8 load(const float* p) { return _mm256_loadu_ps(p); }
+        void store(float* p) const { _mm256_storeu_ps(p, v); }
+    };
+
+    inline SimdFloat8 operator+(SimdFloat8 a, SimdFloat8 b) { return _mm256_add_ps(a.v, b.v); }
+    inline SimdFloat8 operator-(SimdFloat8 a, SimdFloat8 b) { return _mm256_sub_ps(a.v, b.v); }
+    inline SimdFloat8 operator*(SimdFloat8 a, SimdFloat8 b) { return _mm256_mul_ps(a.v, b.v); }
+    inline SimdFloat8 operator/(SimdFloat8 a, SimdFloat8 b) { return _mm256_div_ps(a.v, b.v); }
+    inline SimdFloat8 simdMin(SimdFloat8 a, SimdFloat8 b) { return _mm256_min_ps(a.v, b.v); }
+    inline SimdFloat8 simdMax(SimdFloat8 a, SimdFloat8 b) { return _mm256_max_ps(a.v, b.v); }
+    inline SimdFloat8 simdLess(SimdFloat8 a, SimdFloat8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    inline SimdFloat8 simdLessEqual(SimdFloat8 a, SimdFloat8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+    inline SimdFloat8 simdSelect(SimdFloat8 a, SimdFloat8 b, SimdFloat8 mask) { return _mm256_blendv_ps(a.v, b.v, mask.v); }
+    inline SimdFloat8 simdAnd(SimdFloat8 maskA, SimdFloat8 maskB) { return _mm256_and_ps(maskA.v, maskB.v); }
+    inline SimdFloat8 simdOr(SimdFloat8 maskA, SimdFloat8 maskB) { return _mm256_or_ps(maskA.v, maskB.v); }
+    inline SimdFloat8 simdAndNot(SimdFloat8 maskA, SimdFloat8 maskB) { return _mm256_andnot_ps(maskB.v, maskA.v); }
+    inline int simdMoveMask(SimdFloat8 mask) { return _mm256_movemask_ps(mask.v); }
+    inline SimdFloat4 simdLow(SimdFloat8 a) { return _mm256_castps256_ps128(a.v); }
+    inline SimdFloat4 simdHigh(SimdFloat8 a) { return _mm256_extractf128_ps(a.v, 1); }
+#else
+    struct SimdFloat8
+    {
+        static const uint32_t kWidth = 8;
+        SimdFloat4 lo, hi;
+        SimdFloat8() = default;
+        SimdFloat8(SimdFloat4 l, SimdFloat4 h) : lo(l), hi(h) {}
+        explicit SimdFloat8(float s) : lo(s), hi(s) {}
+        static SimdFloat8 load(const float* p) { return SimdFloat8(SimdFloat4::load(p), SimdFloat4::load(p + 4)); }
+        void store(float* p) const { lo.store(p); hi.store(p + 4); }
+    };
+
+    inline SimdFloat8 operator+(SimdFloat8 a, SimdFloat8 b) { return SimdFloat8(a.lo + b.lo, a.hi + b.hi); }
+    inline SimdFloat8 operator-(SimdFloat8 a, SimdFloat8 b) { return SimdFloat8(a.lo - b.lo, a.hi - b.hi); }
+    inline SimdFloat8 operator*(SimdFloat8 a, SimdFloat8 b) { return SimdFloat8(a.lo * b.lo, a.hi * b.hi); }
+    inline SimdFloat8 operator/(SimdFloat8 a, SimdFloat8 b) { return SimdFloat8(a.lo / b.lo, a.hi / b.hi); }
+    inline SimdFloat8 simdMin(SimdFloat8 a, SimdFloat8 b) { return SimdFloat8(simdMin(a.lo, b.lo), simdMin(a.hi, b.hi)); }
+    inline SimdFloat8 simdMax(SimdFloat8 a, SimdFloat8 b) { return SimdFloat8(simdMax(a.lo, b.lo), simdMax(a.hi, b.hi)); }
+    inline SimdFloat8 simdLess(SimdFloat8 a, SimdFloat8 b) { return SimdFloat8(simdLess(a.lo, b.lo), simdLess(a.hi, b.hi)); }
+    inline SimdFloat8 simdLessEqual(SimdFloat8 a, SimdFloat8 b) { return SimdFloat8(simdLessEqual(a.lo, b.lo), simdLessEqual(a.hi, b.hi)); }
+    inline SimdFloat8 simdSelect(SimdFloat8 a, SimdFloat8 b, SimdFloat8 mask) { return SimdFloat8(simdSelect(a.lo, b.lo, mask.lo), simdSelect(a.hi, b.hi, mask.hi)); }
+    inline SimdFloat8 simdAnd(SimdFloat8 maskA, SimdFloat8 maskB) { return SimdFloat8(simdAnd(maskA.lo, maskB.lo), simdAnd(maskA.hi, maskB.hi)); }
+    inline SimdFloat8 simdOr(SimdFloat8 maskA, SimdFloat8 maskB) { return SimdFloat8(simdOr(maskA.lo, maskB.lo), simdOr(maskA.hi, maskB.hi)); }
+    inline SimdFloat8 simdAndNot(SimdFloat8 maskA, SimdFloat8 maskB) { return SimdFloat8(simdAndNot(maskA.lo, maskB.lo), simdAndNot(maskA.hi, maskB.hi)); }
+    inline int simdMoveMask(SimdFloat8 mask) { return simdMoveMask(mask.lo) | (simdMoveMask(mask.hi) << 4); }
+    inline SimdFloat4 simdLow(SimdFloat8 a) { return a.lo; }
+    inline SimdFloat4 simdHigh(SimdFloat8 a) { return a.hi; }
+#endif
+}
@@ -0,0 +1,308 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace MeshOptimizer
+    {
+        namespace
+        {
+            static const uint32_t kInvalidIndex = uint32_t(-1);
+
+            // The triangles using each vertex, as a flat list
+            struct Adjacency
+            {
+                std::vector<uint32_t> offsets;      // Triangles of vertex v are triangles[offsets[v]] to triangles[offsets[v + 1] - 1]
+                std::vector<uint32_t> triangles;
+            };
+
+            void buildAdjacency(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, Adjacency& adjacency)
+            {
+                adjacency.offsets.assign(vertexCount + 1, 0);
+                adjacency.triangles.resize(indexCount);
+                for (size_t i = 0; i < indexCount; i++) adjacency.offsets[pIndices[i] + 1]++;
+                for (uint32_t v = 0; v < vertexCount; v++) adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+                std::vector<uint32_t> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+                for (size_t i = 0; i < indexCount; i++)
+                {
+                    adjacency.triangles[cursor[pIndices[i]]++] = uint32_t(i / 3);
+                }
+            }
+
+            // FIFO cache model. A vertex is in the cache if fewer than cacheSize misses happened since it was added.
+            // Bumping the clock by cacheSize + 1 empties the cache without touching the timestamps.
+            class FifoCache
+            {
+            public:
+                FifoCache(uint32_t vertexCount, uint32_t cacheSize) : mTimestamps(vertexCount, 0), mCacheSize(cacheSize), mTime(cacheSize + 1) {}
+
+                // Returns 1 on a miss
+                uint32_t access(uint32_t v)
+                {
+                    if (mTime - mTimestamps[v] <= mCacheSize) return 0;
+                    mTimestamps[v] = mTime++;
+                    return 1;
+                }
+
+                uint32_t accessTriangle(const uint32_t* pTriangle)
+                {
+                    return access(pTriangle[0]) + access(pTriangle[1]) + access(pTriangle[2]);
+                }
+
+                void reset() { mTime += mCacheSize + 1; }
+
+            private:
+                std::vector<uint32_t> mTimestamps;
+                uint32_t mCacheSize;
+                uint32_t mTime;
+            };
+
+            const glm::vec3& getPosition(const float* pPositions, size_t stride, uint32_t v)
+            {
+                return *(const glm::vec3*)((const uint8_t*)pPositions + stride * v);
+            }
+        }
+
+        CacheStats analyzeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+        {
+            CacheStats stats;
+            if (indexCount < 3) return stats;
+
+            FifoCache cache(vertexCount, cacheSize);
+            std::vector<uint8_t> referenced(vertexCount, 0);
+            uint32_t referencedCount = 0;
+            for (size_t i = 0; i < indexCount; i++)
+            {
+                stats.transformedVertices += cache.access(pIndices[i]);
+                if (referenced[pIndices[i]] == 0)
+                {
+                    referenced[pIndices[i]] = 1;
+                    referencedCount++;
+                }
+            }
+
+            stats.acmr = float(stats.transformedVertices) / float(indexCount / 3);
+            stats.atvr = float(stats.transformedVertices) / float(referencedCount);
+            return stats;
+        }
+
+        void optimizeVertexCache(uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+        {
+            assert(indexCount % 3 == 0);
+            size_t triangleCount = indexCount / 3;
+            if (triangleCount == 0) return;
+
+            Adjacency adjacency;
+            buildAdjacency(pIndices, indexCount, vertexCount, adjacency);
+
+            // Number of triangles using each vertex which weren't emitted yet
+            std::vector<uint32_t> liveTriangles(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++) liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+            std::vector<uint32_t> timestamps(vertexCount, 0);
+            std::vector<uint8_t> emitted(triangleCount, 0);
+            std::vector<uint32_t> deadEnd;          // Recently used vertices, to restart from when the fan runs dry
+            std::vector<uint32_t> candidates;       // The vertices of the triangles emitted by the current fan
+            std::vector<uint32_t> result(indexCount);
+            deadEnd.reserve(indexCount);
+            size_t resultCount = 0;
+            uint32_t time = cacheSize + 1;
+            uint32_t inputCursor = 0;               // Vertices before it have no live triangles left
+
+            uint32_t fanVertex = pIndices[0];
+            while (fanVertex != kInvalidIndex)
+            {
+                // Emit all the remaining triangles around the fan vertex
+                candidates.clear();
+                for (uint32_t k = adjacency.offsets[fanVertex]; k < adjacency.offsets[fanVertex + 1]; k++)
+                {
+                    uint32_t t = adjacency.triangles[k];
+                    if (emitted[t]) continue;
+                    emitted[t] = 1;
+
+                    for (uint32_t j = 0; j < 3; j++)
+                    {
+                        uint32_t v = pIndices[t * 3 + j];
+                        result[resultCount++] = v;
+                        deadEnd.push_back(v);
+                        candidates.push_back(v);
+                        liveTriangles[v]--;
+                        if (time - timestamps[v] > cacheSize) timestamps[v] = time++;
+                    }
+                }
+
+                // Continue with the oldest candidate which will still be in the cache after its own fan is emitted
+                fanVertex = kInvalidIndex;
+                int32_t bestPriority = -1;
+                for (uint32_t v : candidates)
+                {
+                    if (liveTriangles[v] == 0) continue;
+                    int32_t priority = 0;
+                    if (time - timestamps[v] + 2 * liveTriangles[v] <= cacheSize) priority = int32_t(time - timestamps[v]);
+                    if (priority > bestPriority)
+                    {
+                        bestPriority = priority;
+                        fanVertex = v;
+                    }
+                }
+
+                // Dead end. Restart from the most recently used vertex with live triangles, or from the next one in input order.
+                while (fanVertex == kInvalidIndex && deadEnd.size())
+                {
+                    uint32_t v = deadEnd.back();
+                    deadEnd.pop_back();
+                    if (liveTriangles[v]) fanVertex = v;
+                }
+                while (fanVertex == kInvalidIndex && inputCursor < vertexCount)
+                {
+                    if (liveTriangles[inputCursor]) fanVertex = inputCursor;
+                    else inputCursor++;
+                }
+            }
+
+            assert(resultCount == indexCount);
+            std::copy(result.begin(), result.end(), pIndices);
+        }
+
+        void optimizeOverdraw(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride, uint32_t vertexCount, float threshold, uint32_t cacheSize)
+        {
+            assert(indexCount % 3 == 0);
+            uint32_t triangleCount = uint32_t(indexCount / 3);
+            if (triangleCount < 2) return;
+
+            // Hard boundaries: triangles whose vertices all miss the cache start a new fan, so splitting there costs nothing
+            FifoCache cache(vertexCount, cacheSize);
+            std::vector<uint32_t> hardBoundaries;
+            for (uint32_t t = 0; t < triangleCount; t++)
+            {
+                if (cache.accessTriangle(pIndices + t * 3) == 3) hardBoundaries.push_back(t);
+            }
+            hardBoundaries.push_back(triangleCount);
+
+            // Soft boundaries: split each hard cluster as soon as the part so far, starting with a cold cache, is about as efficient as the whole
+            std::vector<uint32_t> clusters;
+            for (size_t c = 0; c + 1 < hardBoundaries.size(); c++)
+            {
+                uint32_t start = hardBoundaries[c];
+                uint32_t end = hardBoundaries[c + 1];
+
+                cache.reset();
+                uint32_t clusterMisses = 0;
+                for (uint32_t t = start; t < end; t++) clusterMisses += cache.accessTriangle(pIndices + t * 3);
+                float limit = threshold * float(clusterMisses) / float(end - start);
+
+                cache.reset();
+                uint32_t misses = 0;
+                uint32_t last = start;
+                clusters.push_back(start);
+                for (uint32_t t = start; t + 1 < end; t++)
+                {
+                    misses += cache.accessTriangle(pIndices + t * 3);
+                    if (float(misses) / float(t + 1 - last) <= limit)
+                    {
+                        clusters.push_back(t + 1);
+                        last = t + 1;
+                        misses = 0;
+                        cache.reset();
+                    }
+                }
+            }
+            if (clusters.size() < 2) return;
+            clusters.push_back(triangleCount);
+
+            // Sort the clusters by how far they face away from the center of the mesh, most outward-facing first
+            glm::vec3 meshCenter(0);
+            uint32_t referencedCount = 0;
+            std::vector<uint8_t> referenced(vertexCount, 0);
+            for (size_t i = 0; i < indexCount; i++)
+            {
+                if (referenced[pIndices[i]]) continue;
+                referenced[pIndices[i]] = 1;
+                meshCenter += getPosition(pPositions, positionStride, pIndices[i]);
+                referencedCount++;
+            }
+            meshCenter /= float(referencedCount);
+
+            uint32_t clusterCount = uint32_t(clusters.size() - 1);
+            std::vector<float> sortKeys(clusterCount);
+            for (uint32_t c = 0; c < clusterCount; c++)
+            {
+                glm::vec3 center(0);
+                glm::vec3 normal(0);
+                float area = 0;
+                for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+                {
+                    const glm::vec3& p0 = getPosition(pPositions, positionStride, pIndices[t * 3 + 0]);
+                    const glm::vec3& p1 = getPosition(pPositions, positionStride, pIndices[t * 3 + 1]);
+                    const glm::vec3& p2 = getPosition(pPositions, positionStride, pIndices[t * 3 + 2]);
+                    glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                    float a = glm::length(n);
+                    center += (p0 + p1 + p2) * (a / 3.0f);
+                    normal += n;
+                    area += a;
+                }
+
+                float normalLength = glm::length(normal);
+                sortKeys[c] = (area > 0 && normalLength > 0) ? glm::dot(center / area - meshCenter, normal / normalLength) : 0.0f;
+            }
+
+            std::vector<uint32_t> order(clusterCount);
+            for (uint32_t c = 0; c < clusterCount; c++) order[c] = c;
+            std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+            std::vector<uint32_t> result;
+            result.reserve(indexCount);
+            for (uint32_t c : order)
+            {
+                result.insert(result.end(), pIndices + clusters[c] * 3, pIndices + clusters[c + 1] * 3);
+            }
+            std::copy(result.begin(), result.end(), pIndices);
+        }
+
+        void optimizeVertexFetch(uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& remap)
+        {
+            remap.assign(vertexCount, kInvalidIndex);
+            uint32_t next = 0;
+            for (size_t i = 0; i < indexCount; i++)
+            {
+                uint32_t& newIndex = remap[pIndices[i]];
+                if (newIndex == kInvalidIndex) newIndex = next++;
+                pIndices[i] = newIndex;
+            }
+
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                if (remap[v] == kInvalidIndex) remap[v] = next++;
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace Falcor
+{
+    /** Reorders indexed triangle lists for the GPU's post-transform vertex cache, for overdraw, and for vertex fetch locality.
+        Typical use is to run optimizeVertexCache(), then optimizeOverdraw(), then optimizeVertexFetch() and apply its remap table to the
+        vertex data. All functions work on 32-bit triangle-list indices and only touch the arrays they are given, so meshes can be
+        optimized on different threads concurrently.
+    */
+    namespace MeshOptimizer
+    {
+        static const uint32_t kDefaultCacheSize = 16;       ///< FIFO size used to model the post-transform cache
+
+        struct CacheStats
+        {
+            uint32_t transformedVertices = 0;   ///< Vertex shader invocations in a simulated FIFO cache
+            float acmr = 0;     ///< Average cache miss ratio: transformed vertices per triangle. 0.5 is the lower bound for large grid-like meshes, 3 is the worst case.
+            float atvr = 0;     ///< Average transformed vertex ratio: transformed vertices per referenced vertex. 1 is optimal.
+        };
+
+        /** Simulate a FIFO post-transform cache over an index buffer
+        */
+        CacheStats analyzeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = kDefaultCacheSize);
+
+        /** Reorder triangles to reduce vertex shader invocations. This uses Tipsify (Sander et al. 2007), which runs in linear time.
+            The winding of each triangle is preserved.
+        */
+        void optimizeVertexCache(uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = kDefaultCacheSize);
+
+        /** Reorder clusters of triangles so the ones facing outwards from the mesh's center are drawn first, which lets early-z reject more
+            of the fragments behind them. Call it on the output of optimizeVertexCache(). Clusters are cut where the cache restarts anyway,
+            and where the cache efficiency of the cluster so far stays within threshold times that of the whole cluster.
+            \param[in] pPositions The vertex positions, 3 floats each
+            \param[in] positionStride The distance between positions, in bytes
+            \param[in] threshold How much the ACMR may grow. Larger values allow smaller clusters, which sort better.
+        */
+        void optimizeOverdraw(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride, uint32_t vertexCount, float threshold = 1.05f, uint32_t cacheSize = kDefaultCacheSize);
+
+        /** Renumber the vertices in the order the triangles first use them, so vertex fetches walk the vertex buffer mostly linearly.
+            Vertices no triangle uses are moved to the end, so the vertex count doesn't change.
+            \param[in,out] pIndices The indices. They are rewritten to use the new numbering.
+            \param[out] remap For each original vertex, its new index. Move vertex i of each vertex attribute to remap[i].
+        */
+        void optimizeVertexFetch(uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& remap);
+    }
+}
@@ -0,0 +1,458 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MipGenerator.h"
+#include "Utils/Math/SimdFloat4.h"
+#include "Utils/ParallelFor.h"
+#include <atomic>
+#include <memory>
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+    namespace MipGenerator
+    {
+        namespace
+        {
+            static const uint32_t kTileRows = 16;                   // Destination rows filtered per task
+            static const uint32_t kTexelsPerThread = 64 * 1024;     // Levels smaller than this aren't worth another thread
+            static const float kKaiserRadius = 2.0f;                // In destination texels
+            static const float kKaiserAlpha = 4.0f;
+            static const float kPi = 3.14159265358979f;
+
+            enum class Encoding
+            {
+                Unorm8,
+                Srgb8,
+                Float16,
+                Float32,
+            };
+
+            bool getEncoding(ResourceFormat format, Encoding& encoding)
+            {
+                switch (format)
+                {
+                case ResourceFormat::RGBA8Unorm:
+                case ResourceFormat::BGRA8Unorm:
+                case ResourceFormat::BGRX8Unorm:
+                    encoding = Encoding::Unorm8;
+                    return true;
+                case ResourceFormat::RGBA8UnormSrgb:
+                case ResourceFormat::BGRA8UnormSrgb:
+                case ResourceFormat::BGRX8UnormSrgb:
+                    encoding = Encoding::Srgb8;
+                    return true;
+                case ResourceFormat::RGBA16Float:
+                    encoding = Encoding::Float16;
+                    return true;
+                case ResourceFormat::RGBA32Float:
+                    encoding = Encoding::Float32;
+                    return true;
+                default:
+                    return false;
+                }
+            }
+
+            const float* getSrgbToLinearTable()
+            {
+                static const std::vector<float> kTable = []()
+                {
+                    std::vector<float> table(256);
+                    for (uint32_t i = 0; i < 256; i++)
+                    {
+                        float c = i / 255.0f;
+                        table[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                    }
+                    return table;
+                }();
+                return kTable.data();
+            }
+
+            // Indexed by a linear value in [0, 1], scaled by kLinearToSrgbTableSize - 1
+            static const uint32_t kLinearToSrgbTableSize = 4096;
+            const uint8_t* getLinearToSrgbTable()
+            {
+                static const std::vector<uint8_t> kTable = []()
+                {
+                    std::vector<uint8_t> table(kLinearToSrgbTableSize);
+                    for (uint32_t i = 0; i < kLinearToSrgbTableSize; i++)
+                    {
+                        float c = i / float(kLinearToSrgbTableSize - 1);
+                        float s = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                        table[i] = (uint8_t)(s * 255.0f + 0.5f);
+                    }
+                    return table;
+                }();
+                return kTable.data();
+            }
+
+            float halfToFloat(uint16_t h)
+            {
+                uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+                uint32_t exponent = (h >> 10) & 0x1f;
+                uint32_t mantissa = h & 0x3ff;
+                uint32_t bits;
+                if (exponent == 0)
+                {
+                    // Zero or denormal
+                    float f = mantissa * (1.0f / 16777216.0f);
+                    return sign ? -f : f;
+                }
+                else if (exponent == 31)
+                {
+                    bits = sign | 0x7f800000 | (mantissa << 13);
+                }
+                else
+                {
+                    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+                }
+                float f;
+                std::memcpy(&f, &bits, sizeof(f));
+                return f;
+            }
+
+            // Round to nearest even
+            uint16_t floatToHalf(float f)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+                uint32_t floatExponent = (bits >> 23) & 0xff;
+                uint32_t mantissa = bits & 0x7fffff;
+
+                if (floatExponent == 0xff) return sign | 0x7c00 | (mantissa ? 0x200 : 0);      // Inf or NaN
+                int32_t exponent = (int32_t)floatExponent - 127 + 15;
+                if (exponent >= 31) return sign | 0x7c00;                                       // Overflows to Inf
+
+                uint32_t shift = 13;
+                if (exponent <= 0)
+                {
+                    // Denormal, or too small
+                    if (exponent < -10) return sign;
+                    mantissa |= 0x800000;
+                    shift = 14 - exponent;
+                    exponent = 0;
+                }
+                uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> shift);
+                uint32_t remainder = mantissa & ((1u << shift) - 1);
+                uint32_t halfway = 1u << (shift - 1);
+                if (remainder > halfway || (remainder == halfway && (half & 1))) half++;    // A carry into the exponent is still correct
+                return sign | (uint16_t)half;
+            }
+
+            uint32_t getBytesPerTexel(Encoding encoding)
+            {
+                switch (encoding)
+                {
+                case Encoding::Float16: return 8;
+                case Encoding::Float32: return 16;
+                default:                return 4;
+                }
+            }
+
+            // Convert a row of texels to linear RGBA floats
+            void decodeRow(const uint8_t* pSrc, uint32_t width, Encoding encoding, float* pDst)
+            {
+                switch (encoding)
+                {
+                case Encoding::Unorm8:
+                    for (uint32_t i = 0; i < width * 4; i++) pDst[i] = pSrc[i] * (1.0f / 255.0f);
+                    break;
+                case Encoding::Srgb8:
+                {
+                    const float* pTable = getSrgbToLinearTable();
+                    for (uint32_t i = 0; i < width * 4; i += 4)
+                    {
+                        pDst[i + 0] = pTable[pSrc[i + 0]];
+                        pDst[i + 1] = pTable[pSrc[i + 1]];
+                        pDst[i + 2] = pTable[pSrc[i + 2]];
+                        pDst[i + 3] = pSrc[i + 3] * (1.0f / 255.0f);
+                    }
+                    break;
+                }
+                case Encoding::Float16:
+                    for (uint32_t i = 0; i < width * 4; i++)
+                    {
+                        uint16_t h;
+                        std::memcpy(&h, pSrc + i * 2, sizeof(h));
+                        pDst[i] = halfToFloat(h);
+                    }
+                    break;
+                case Encoding::Float32:
+                    std::memcpy(pDst, pSrc, width * 16);
+                    break;
+                }
+            }
+
+            void encodeRow(const float* pSrc, uint32_t width, Encoding encoding, uint8_t* pDst)
+            {
+                switch (encoding)
+                {
+                case Encoding::Unorm8:
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        float texel[4];
+                        (simdClamp(SimdFloat4::load(pSrc + x * 4), 0.0f, 1.0f) * SimdFloat4(255.0f) + SimdFloat4(0.5f)).store(texel);
+                        for (uint32_t c = 0; c < 4; c++) pDst[x * 4 + c] = (uint8_t)texel[c];
+                    }
+                    break;
+                case Encoding::Srgb8:
+                {
+                    const uint8_t* pTable = getLinearToSrgbTable();
+                    const SimdFloat4 scale(kLinearToSrgbTableSize - 1.0f, kLinearToSrgbTableSize - 1.0f, kLinearToSrgbTableSize - 1.0f, 255.0f);
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        float texel[4];
+                        (simdClamp(SimdFloat4::load(pSrc + x * 4), 0.0f, 1.0f) * scale + SimdFloat4(0.5f)).store(texel);
+                        pDst[x * 4 + 0] = pTable[(uint32_t)texel[0]];
+                        pDst[x * 4 + 1] = pTable[(uint32_t)texel[1]];
+                        pDst[x * 4 + 2] = pTable[(uint32_t)texel[2]];
+                        pDst[x * 4 + 3] = (uint8_t)texel[3];
+                    }
+                    break;
+                }
+                case Encoding::Float16:
+                    for (uint32_t i = 0; i < width * 4; i++)
+                    {
+                        uint16_t h = floatToHalf(pSrc[i]);
+                        std::memcpy(pDst + i * 2, &h, sizeof(h));
+                    }
+                    break;
+                case Encoding::Float32:
+                    std::memcpy(pDst, pSrc, width * 16);
+                    break;
+                }
+            }
+
+            float besselI0(float x)
+            {
+                float sum = 1, term = 1;
+                for (uint32_t k = 1; k < 32 && term > sum * 1e-8f; k++)
+                {
+                    float t = x / (2.0f * k);
+                    term *= t * t;
+                    sum += term;
+                }
+                return sum;
+            }
+
+            // t is the distance from the destination texel's center, in destination texels
+            float kaiserSinc(float t)
+            {
+                if (std::abs(t) >= kKaiserRadius) return 0;
+                float sinc = (t == 0) ? 1.0f : std::sin(kPi * t) / (kPi * t);
+                float r = t / kKaiserRadius;
+                return sinc * besselI0(kKaiserAlpha * std::sqrt(1.0f - r * r)) / besselI0(kKaiserAlpha);
+            }
+
+            // Filter taps along one axis. Destination texel d uses taps [offsets[d], offsets[d + 1]).
+            // Taps outside the image are clamped to the edge texel and merged with it.
+            struct FilterTable
+            {
+                std::vector<uint32_t> offsets;
+                std::vector<uint32_t> indices;
+                std::vector<float> weights;
+            };
+
+            FilterTable buildFilterTable(uint32_t srcSize, uint32_t dstSize, Filter filter)
+            {
+                FilterTable table;
+                table.offsets.push_back(0);
+
+                float scale = float(srcSize) / float(dstSize);
+                float support = (filter == Filter::Box) ? scale * 0.5f : kKaiserRadius * scale;
+                for (uint32_t d = 0; d < dstSize; d++)
+                {
+                    float center = (d + 0.5f) * scale;
+                    int32_t first = (int32_t)std::floor(center - support);
+                    int32_t last = (int32_t)std::ceil(center + support);
+                    size_t start = table.weights.size();
+                    float sum = 0;
+                    for (int32_t i = first; i < last; i++)
+                    {
+                        float w;
+                        if (filter == Filter::Box)
+                        {
+                            w = std::max(std::min(center + support, i + 1.0f) - std::max(center - support, (float)i), 0.0f);
+                        }
+                        else
+                        {
+                            w = kaiserSinc((i + 0.5f - center) / scale);
+                        }
+                        if (w == 0) continue;
+
+                        uint32_t index = (uint32_t)std::min(std::max(i, 0), (int32_t)srcSize - 1);
+                        if (table.weights.size() > start && table.indices.back() == index)
+                        {
+                            table.weights.back() += w;
+                        }
+                        else
+                        {
+                            table.indices.push_back(index);
+                            table.weights.push_back(w);
+                        }
+                        sum += w;
+                    }
+                    for (size_t i = start; i < table.weights.size(); i++) table.weights[i] /= sum;
+                    table.offsets.push_back((uint32_t)table.weights.size());
+                }
+                return table;
+            }
+
+            struct Level
+            {
+                uint32_t width;
+                uint32_t height;
+                size_t offset;
+                FilterTable horizontal;     ///< Filters from the previous level into this one
+                FilterTable vertical;
+            };
+
+            // Per-thread buffers
+            struct Scratch
+            {
+                std::vector<float> decoded;
+                std::vector<float> rows;
+                std::vector<float> output;
+            };
+
+            // Filter destination rows [row0, row1) of a level from the previous level. The source rows they need are decoded
+            // and filtered horizontally first, then the vertical filter combines them.
+            void filterTile(const uint8_t* pSrc, const Level& src, uint8_t* pDst, const Level& dst, Encoding encoding, uint32_t row0, uint32_t row1, Scratch& scratch)
+            {
+                const FilterTable& h = dst.horizontal;
+                const FilterTable& v = dst.vertical;
+                uint32_t firstRow = v.indices[v.offsets[row0]];
+                uint32_t lastRow = v.indices[v.offsets[row1] - 1];
+                uint32_t bytesPerTexel = getBytesPerTexel(encoding);
+
+                scratch.decoded.resize(src.width * 4);
+                scratch.rows.resize((size_t)(lastRow - firstRow + 1) * dst.width * 4);
+                scratch.output.resize(dst.width * 4);
+
+                for (uint32_t r = firstRow; r <= lastRow; r++)
+                {
+                    decodeRow(pSrc + (size_t)r * src.width * bytesPerTexel, src.width, encoding, scratch.decoded.data());
+                    float* pRow = scratch.rows.data() + (size_t)(r - firstRow) * dst.width * 4;
+                    for (uint32_t x = 0; x < dst.width; x++)
+                    {
+                        SimdFloat4 sum(0.0f);
+                        for (uint32_t t = h.offsets[x]; t < h.offsets[x + 1]; t++)
+                        {
+                            sum = sum + SimdFloat4::load(&scratch.decoded[h.indices[t] * 4]) * SimdFloat4(h.weights[t]);
+                        }
+                        sum.store(pRow + x * 4);
+                    }
+                }
+
+                for (uint32_t y = row0; y < row1; y++)
+                {
+                    float* pOut = scratch.output.data();
+                    std::memset(pOut, 0, dst.width * 4 * sizeof(float));
+                    for (uint32_t t = v.offsets[y]; t < v.offsets[y + 1]; t++)
+                    {
+                        const float* pRow = scratch.rows.data() + (size_t)(v.indices[t] - firstRow) * dst.width * 4;
+                        SimdFloat4 w(v.weights[t]);
+                        for (uint32_t x = 0; x < dst.width * 4; x += 4)
+                        {
+                            (SimdFloat4::load(pOut + x) + SimdFloat4::load(pRow + x) * w).store(pOut + x);
+                        }
+                    }
+                    encodeRow(pOut, dst.width, encoding, pDst + (size_t)y * dst.width * bytesPerTexel);
+                }
+            }
+        }
+
+        bool isFormatSupported(ResourceFormat format)
+        {
+            Encoding encoding;
+            return getEncoding(format, encoding);
+        }
+
+        uint32_t getMipCount(uint32_t width, uint32_t height)
+        {
+            uint32_t count = 1;
+            while ((std::max(width, height) >> count) > 0) count++;
+            return count;
+        }
+
+        bool generate(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, Filter filter, std::vector<uint8_t>& chain, uint32_t threadCount)
+        {
+            Encoding encoding;
+            if (getEncoding(format, encoding) == false) return false;
+            uint32_t bytesPerTexel = getBytesPerTexel(encoding);
+
+            uint32_t mipCount = getMipCount(width, height);
+            std::vector<Level> levels(mipCount);
+            size_t size = 0;
+            for (uint32_t mip = 0; mip < mipCount; mip++)
+            {
+                Level& level = levels[mip];
+                level.width = std::max(width >> mip, 1u);
+                level.height = std::max(height >> mip, 1u);
+                level.offset = size;
+                size += (size_t)level.width * level.height * bytesPerTexel;
+                if (mip > 0)
+                {
+                    level.horizontal = buildFilterTable(levels[mip - 1].width, level.width, filter);
+                    level.vertical = buildFilterTable(levels[mip - 1].height, level.height, filter);
+                }
+            }
+
+            chain.resize(size);
+            std::memcpy(chain.data(), pData, (size_t)width * height * bytesPerTexel);
+            if (mipCount == 1) return true;
+
+            // Levels are filtered in order, since each one is filtered from the previous one. Within a level, threads take tiles of rows.
+            size_t level1Texels = (size_t)levels[1].width * levels[1].height;
+            if (threadCount == 0) threadCount = WorkerPool::get().getThreadCount();
+            threadCount = (uint32_t)std::max<size_t>(1, std::min<size_t>(threadCount, level1Texels / kTexelsPerThread));
+
+            // One scratch buffer per thread. A thread takes tiles until the level is done, and the threads finish a level before the next one starts.
+            std::vector<Scratch> scratch(threadCount);
+            for (uint32_t mip = 1; mip < mipCount; mip++)
+            {
+                const Level& src = levels[mip - 1];
+                const Level& dst = levels[mip];
+                uint32_t tileCount = (dst.height + kTileRows - 1) / kTileRows;
+                std::atomic<uint32_t> nextTile(0);
+                parallelFor(threadCount, threadCount, [&](uint32_t thread)
+                {
+                    for (uint32_t tile = nextTile++; tile < tileCount; tile = nextTile++)
+                    {
+                        uint32_t row0 = tile * kTileRows;
+                        uint32_t row1 = std::min(row0 + kTileRows, dst.height);
+                        filterTile(chain.data() + src.offset, src, chain.data() + dst.offset, dst, encoding, row0, row1, scratch[thread]);
+                    }
+                });
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "API/Formats.h"
+
+namespace Falcor
+{
+    /** CPU mip-chain generation.
+        The GPU path (Texture::generateMips()) needs a device, a render-target view per level and a blit per level. This generates the
+        chain on the CPU instead, so it can be uploaded in one go with the rest of the texture, or written to disk by tools.
+        Each level is filtered from the previous one. Filtering is done in linear space: sRGB formats are decoded before filtering and
+        encoded again afterwards. Rows of a level are split into tiles which are filtered in parallel, and the filter math runs on all
+        four channels of a texel at once with SSE2 when it's available.
+    */
+    namespace MipGenerator
+    {
+        enum class Filter
+        {
+            Box,        ///< Average of the texels each destination texel covers. Fast, slightly blurry.
+            Kaiser,     ///< Kaiser-windowed sinc. Sharper, at the cost of some ringing. Unorm formats clamp the ringing to [0, 1].
+        };
+
+        /** Check whether a format is supported: RGBA8/BGRA8/BGRX8 (linear and sRGB), RGBA16Float and RGBA32Float.
+        */
+        bool isFormatSupported(ResourceFormat format);
+
+        /** Get the number of levels of a full mip-chain
+        */
+        uint32_t getMipCount(uint32_t width, uint32_t height);
+
+        /** Generate a full mip-chain.
+            \param[in] pData The texels of level 0, tightly packed
+            \param[in] width, height The size of level 0
+            \param[in] format The format of the texels. Must be supported (see isFormatSupported()).
+            \param[in] filter The filter to use
+            \param[out] chain Receives all the levels, starting with a copy of level 0, tightly packed. This is the layout Texture::create2D() expects.
+            \param[in] threadCount The number of threads to use. 0 uses one thread per hardware thread.
+            \return false if the format isn't supported
+        */
+        bool generate(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, Filter filter, std::vector<uint8_t>& chain, uint32_t threadCount = 0);
+    }
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ParallelFor.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Set on the pool's threads, and on a thread while it runs tasks, so nested calls don't wait for the pool they are running on
+        thread_local bool tInsideRun = false;
+    }
+
+    WorkerPool& WorkerPool::get()
+    {
+        static WorkerPool sPool;
+        return sPool;
+    }
+
+    WorkerPool::WorkerPool() : mNext(0)
+    {
+        const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+        for (uint32_t i = 1; i < hardwareThreads; i++)
+        {
+            mThreads.push_back(std::thread(&WorkerPool::workerLoop, this));
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQuit = true;
+        }
+        mWakeCond.notify_all();
+        for (auto& t : mThreads) t.join();
+    }
+
+    void WorkerPool::runTasks()
+    {
+        for (uint32_t i = mNext++; i < mCount; i = mNext++)
+        {
+            mTask(mpContext, i);
+        }
+    }
+
+    void WorkerPool::workerLoop()
+    {
+        tInsideRun = true;
+        uint64_t lastGeneration = 0;
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            mWakeCond.wait(lock, [&]() { return mQuit || (mGeneration != lastGeneration && mWantedWorkers > 0); });
+            if (mQuit) return;
+
+            lastGeneration = mGeneration;
+            mWantedWorkers--;
+            mActiveWorkers++;
+            lock.unlock();
+            runTasks();
+            lock.lock();
+            if (--mActiveWorkers == 0) mDoneCond.notify_all();
+        }
+    }
+
+    void WorkerPool::run(uint32_t count, uint32_t threadCount, Task task, const void* pContext)
+    {
+        threadCount = std::min(threadCount ? threadCount : getThreadCount(), std::min(count, getThreadCount()));
+        std::unique_lock<std::mutex> runLock;
+        if (threadCount > 1 && tInsideRun == false)
+        {
+            runLock = std::unique_lock<std::mutex>(mRunMutex, std::try_to_lock);
+        }
+
+        if (runLock.owns_lock() == false)
+        {
+            for (uint32_t i = 0; i < count; i++) task(pContext, i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTask = task;
+            mpContext = pContext;
+            mCount = count;
+            mNext = 0;
+            mWantedWorkers = threadCount - 1;
+            mGeneration++;
+        }
+        mWakeCond.notify_all();
+
+        tInsideRun = true;
+        runTasks();
+        tInsideRun = false;
+
+        // Workers which didn't wake up in time must not join once the context is gone. The ones which did only have to finish their last task.
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWantedWorkers = 0;
+        mDoneCond.wait(lock, [&]() { return mActiveWorkers == 0; });
+    }
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+    /** Threads kept alive for the lifetime of the application, which parallelFor() runs its tasks on.
+        Loops which run every frame would otherwise spend a good part of their time creating and joining threads.
+        The pool has one thread less than the hardware threads, since the thread calling run() takes tasks too.
+    */
+    class WorkerPool
+    {
+    public:
+        using Task = void(*)(const void* pContext, uint32_t index);
+
+        /** Get the pool. The threads are started on the first call.
+        */
+        static WorkerPool& get();
+
+        ~WorkerPool();
+
+        /** Get the number of threads run() can use, including the calling thread
+        */
+        uint32_t getThreadCount() const { return (uint32_t)mThreads.size() + 1; }
+
+        /** Call a task for every index in [0, count), and return once they are all done
+            \param[in] threadCount The maximal number of threads to use, including the calling thread. 0 uses all of them.
+            Calls made from a task, or while another thread is running tasks on the pool, run on the calling thread only.
+        */
+        void run(uint32_t count, uint32_t threadCount, Task task, const void* pContext);
+
+    private:
+        WorkerPool();
+        void workerLoop();
+        void runTasks();
+
+        std::vector<std::thread> mThreads;
+        std::mutex mRunMutex;                   ///< Held by the thread running tasks on the pool
+        std::mutex mMutex;                      ///< Protects the members below
+        std::condition_variable mWakeCond;
+        std::condition_variable mDoneCond;
+        uint64_t mGeneration = 0;               ///< Incremented by every run(), so a worker joins each one at most once
+        uint32_t mWantedWorkers = 0;            ///< Workers which may still join the current run()
+        uint32_t mActiveWorkers = 0;            ///< Workers taking tasks of the current run()
+        bool mQuit = false;
+
+        Task mTask = nullptr;
+        const void* mpContext = nullptr;
+        uint32_t mCount = 0;
+        std::atomic<uint32_t> mNext;
+    };
+
+    /** Call func(i) for every i in [0, count) on the worker pool's threads
+        \param[in] threadCount The maximal number of threads to use, including the calling thread. 0 uses all of them.
+    */
+    template<typename Func>
+    void parallelFor(uint32_t count, uint32_t threadCount, const Func& func)
+    {
+        WorkerPool::get().run(count, threadCount, [](const void* pFunc, uint32_t i) { (*(const Func*)pFunc)(i); }, &func);
+    }
+}
@@ -29,9 +29,97 @@
 #include "Framework.h"
 #include "Utils/Picking/Picking.h"
 #include "Graphics/FboHelper.h"
+#include "Utils/CpuTimer.h"
+#include "Data/VertexAttrib.h"
+#include <cstring>
 
 namespace Falcor
 {
+    namespace
+    {
+        // Hits rejected by the alpha test or the gizmo culling before the ray gives up. Every rejection traces the ray again from the rejected hit.
+        const uint32_t kMaxHitCount = 256;
+
+        // Largest size of the alpha textures read back for the CPU alpha test. Larger textures are read from a smaller mip level.
+        const uint32_t kMaxAlphaTextureSize = 1024;
+
+        bool readTexCoords(const Mesh* pMesh, std::vector<glm::vec2>& texCoords)
+        {
+            const Vao* pVao = pMesh->getVao().get();
+            const auto& elemDesc = pVao->getElementIndexByLocation(VERTEX_TEXCOORD_LOC);
+            if (elemDesc.vbIndex == Vao::ElementDesc::kInvalidIndex) return false;
+
+            const VertexBufferLayout* pVbLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex).get();
+            ResourceFormat format = pVbLayout->getElementFormat(elemDesc.elementIndex);
+            if (format != ResourceFormat::RG32Float && format != ResourceFormat::RGB32Float)
+            {
+                logWarning("Picking - Only RG32Float and RGB32Float texture coordinates are supported by the CPU alpha test. The mesh is picked as opaque.");
+                return false;
+            }
+
+            texCoords.resize(pMesh->getVertexCount());
+            const Buffer::SharedPtr& pVB = pVao->getVertexBuffer(elemDesc.vbIndex);
+            const uint8_t* pVertexData = (const uint8_t*)pVB->map(Buffer::MapType::Read) + pVbLayout->getElementOffset(elemDesc.elementIndex);
+            for (size_t i = 0; i < texCoords.size(); i++) std::memcpy(&texCoords[i], pVertexData + i * pVbLayout->getStride(), sizeof(glm::vec2));
+            pVB->unmap();
+            return true;
+        }
+
+        float applyAddressMode(float x, Sampler::AddressMode mode)
+        {
+            switch (mode)
+            {
+            case Sampler::AddressMode::Clamp:
+            case Sampler::AddressMode::Border:
+                return glm::clamp(x, 0.0f, 1.0f);
+            case Sampler::AddressMode::Mirror:
+            {
+                float f = x - 2.0f * std::floor(x * 0.5f);
+                return (f > 1.0f) ? 2.0f - f : f;
+            }
+            case Sampler::AddressMode::MirrorOnce:
+                return glm::clamp(std::abs(x), 0.0f, 1.0f);
+            default:
+                return x - std::floor(x);
+            }
+        }
+
+        /** Bilinear lookup in an alpha texture. uv is in [0, 1] after the address mode was applied.
+        */
+        float sampleAlpha(const uint8_t* pAlpha, uint32_t width, uint32_t height, const glm::vec2& uv, bool wrap)
+        {
+            float x = uv.x * width - 0.5f;
+            float y = uv.y * height - 0.5f;
+            float fx = std::floor(x);
+            float fy = std::floor(y);
+            float tx = x - fx;
+            float ty = y - fy;
+
+            const int32_t w = (int32_t)width;
+            const int32_t h = (int32_t)height;
+            auto texel = [&](int32_t ix, int32_t iy)
+            {
+                if (wrap)
+                {
+                    ix = ((ix % w) + w) % w;
+                    iy = ((iy % h) + h) % h;
+                }
+                else
+                {
+                    ix = glm::clamp(ix, 0, w - 1);
+                    iy = glm::clamp(iy, 0, h - 1);
+                }
+                return pAlpha[iy * w + ix] / 255.0f;
+            };
+
+            int32_t ix = (int32_t)fx;
+            int32_t iy = (int32_t)fy;
+            float top = glm::mix(texel(ix, iy), texel(ix + 1, iy), tx);
+            float bottom = glm::mix(texel(ix, iy + 1), texel(ix + 1, iy + 1), tx);
+            return glm::mix(top, bottom, ty);
+        }
+    }
+
     Picking::UniquePtr Picking::create(const Scene::SharedPtr& pScene, uint32_t fboWidth, uint32_t fboHeight)
     {
         return UniquePtr(new Picking(pScene, fboWidth, fboHeight));
@@ -39,9 +127,21 @@ namespace Falcor
 
     bool Picking::pick(RenderContext* pContext, const glm::vec2& mousePos, const Camera::SharedPtr& pCamera)
     {
-        calculateScissor(mousePos);
-        renderScene(pContext, pCamera.get());
-        readPickResults(pContext);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        mPickedPrimitiveId = BvhHit::kInvalidId;
+
+        if (mMode == Mode::RayCast)
+        {
+            rayCast(pContext, mousePos, pCamera.get());
+        }
+        else
+        {
+            calculateScissor(mousePos);
+            renderScene(pContext, pCamera.get());
+            readPickResults(pContext);
+        }
+
+        mLastPickTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
         return mPickResult.pModelInstance != nullptr;
     }
 
@@ -142,6 +242,137 @@ namespace Falcor
         }
     }
 
+    void Picking::rayCast(RenderContext* pContext, const glm::vec2& mousePos, const Camera* pCamera)
+    {
+        mPickResult = Instance();
+
+        // Build the BVH on the first pick, and again when instances were added to or removed from the scene
+        if (mpBvh == nullptr || mpBvh->update(mpScene.get()) == false)
+        {
+            mpBvh = SceneBvh::create(mpScene.get());
+        }
+
+        bool hasGizmos = false;
+        for (const auto& pGizmo : mSceneGizmos)
+        {
+            hasGizmos = hasGizmos || (pGizmo != nullptr);
+        }
+
+        // Walk the hits front to back, skipping the rejected ones. Gizmos are drawn over the rest of the scene, so a gizmo
+        // behind the closest hit still wins, and the walk only stops early when there are no gizmos.
+        BvhRay ray = SceneBvh::createPrimaryRay(pCamera, mousePos, glm::uvec2(1, 1));
+        BvhHit picked;
+        for (uint32_t i = 0; i < kMaxHitCount; i++)
+        {
+            BvhHit hit;
+            if (mpBvh->intersect(ray, hit) == false) break;
+            ray.tMin = std::nextafter(hit.t, FLT_MAX);
+            if (isHitAccepted(pContext, ray, hit) == false) continue;
+
+            const SceneBvh::Instance& inst = mpBvh->getInstance(hit.instanceId);
+            bool isGizmo = hasGizmos && (Gizmo::getGizmoType(mSceneGizmos, mpScene->getModel(inst.modelId).get()) != Gizmo::Type::Invalid);
+            if (picked.isValid() == false || isGizmo)
+            {
+                picked = hit;
+            }
+            if (hasGizmos == false || isGizmo) break;
+        }
+
+        if (picked.isValid() == false) return;
+
+        const SceneBvh::Instance& inst = mpBvh->getInstance(picked.instanceId);
+        const Model* pModel = mpScene->getModel(inst.modelId).get();
+        mPickResult = Instance(mpScene->getModelInstance(inst.modelId, inst.modelInstanceId), pModel->getMeshInstance(inst.meshId, inst.meshInstanceId));
+        mPickedPrimitiveId = picked.primitiveId;
+        mPickedPosition = ray.origin + ray.direction * picked.t;
+    }
+
+    bool Picking::isHitAccepted(RenderContext* pContext, const BvhRay& ray, const BvhHit& hit)
+    {
+        const SceneBvh::Instance& inst = mpBvh->getInstance(hit.instanceId);
+        const Model* pModel = mpScene->getModel(inst.modelId).get();
+        if (mpScene->getModelInstance(inst.modelId, inst.modelInstanceId)->isVisible() == false) return false;
+        if (pModel->getMeshInstance(inst.meshId, inst.meshInstanceId)->isVisible() == false) return false;
+
+        glm::vec3 posW = ray.origin + ray.direction * hit.t;
+
+        // Rotation gizmos discard the parts facing away from the camera, see CULL_REAR_SECTION in SceneEditor.slang
+        if (Gizmo::getGizmoType(mSceneGizmos, pModel) == Gizmo::Type::Rotate)
+        {
+            glm::vec3 toVertex = glm::normalize(posW - glm::vec3(inst.worldMat[3]));
+            glm::vec3 toCamera = glm::normalize(ray.origin - posW);
+            if (glm::dot(toCamera, toVertex) < -0.1f) return false;
+        }
+
+        // Alpha test, as done by the default shading with _DEFAULT_ALPHA_TEST
+        const Mesh::SharedPtr& pMesh = pModel->getMesh(inst.meshId);
+        const Material* pMaterial = pMesh->getMaterial().get();
+        if (pMaterial == nullptr || pMaterial->getAlphaMode() != AlphaModeMask) return true;
+
+        float alpha = pMaterial->getBaseColor().a;
+        const Texture::SharedPtr& pTexture = pMaterial->getBaseColorTexture();
+        if (pTexture)
+        {
+            const MeshTexCoords& texCoords = getMeshTexCoords(pMesh);
+            const AlphaTexture& alphaTexture = getAlphaTexture(pContext, pTexture);
+            if (texCoords.texCoords.empty() || alphaTexture.alpha.empty()) return true;
+
+            const auto& indices = mpBvh->getMeshBvh(inst.meshBvhId)->getIndices();
+            const uint32_t* pTriangle = &indices[hit.primitiveId * 3];
+            glm::vec2 uv = texCoords.texCoords[pTriangle[0]] * (1.0f - hit.u - hit.v) + texCoords.texCoords[pTriangle[1]] * hit.u + texCoords.texCoords[pTriangle[2]] * hit.v;
+
+            const Sampler* pSampler = pMaterial->getSampler().get();
+            Sampler::AddressMode modeU = pSampler ? pSampler->getAddressModeU() : Sampler::AddressMode::Wrap;
+            Sampler::AddressMode modeV = pSampler ? pSampler->getAddressModeV() : Sampler::AddressMode::Wrap;
+            uv = glm::vec2(applyAddressMode(uv.x, modeU), applyAddressMode(uv.y, modeV));
+            alpha = sampleAlpha(alphaTexture.alpha.data(), alphaTexture.width, alphaTexture.height, uv, modeU == Sampler::AddressMode::Wrap && modeV == Sampler::AddressMode::Wrap);
+        }
+        return alpha >= pMaterial->getAlphaThreshold();
+    }
+
+    const Picking::AlphaTexture& Picking::getAlphaTexture(RenderContext* pContext, const Texture::SharedPtr& pTexture)
+    {
+        AlphaTexture& entry = mAlphaTextures[pTexture.get()];
+        if (entry.pTexture.lock() == pTexture) return entry;
+
+        entry = AlphaTexture();
+        entry.pTexture = pTexture;
+        if (pTexture->getType() != Resource::Type::Texture2D)
+        {
+            logWarning("Picking - The CPU alpha test only supports 2D textures. The texture is picked as opaque.");
+            return entry;
+        }
+
+        // Convert the texture to RGBA8 with a blit, which handles every format including the compressed ones, then read it back
+        uint32_t mip = 0;
+        while ((pTexture->getWidth(mip) > kMaxAlphaTextureSize || pTexture->getHeight(mip) > kMaxAlphaTextureSize) && mip + 1 < pTexture->getMipCount())
+        {
+            mip++;
+        }
+        entry.width = pTexture->getWidth(mip);
+        entry.height = pTexture->getHeight(mip);
+
+        Texture::SharedPtr pCopy = Texture::create2D(entry.width, entry.height, ResourceFormat::RGBA8Unorm, 1, 1, nullptr, Resource::BindFlags::ShaderResource | Resource::BindFlags::RenderTarget);
+        pContext->blit(pTexture->getSRV(mip, 1, 0, 1), pCopy->getRTV(), uvec4(-1), uvec4(-1), Sampler::Filter::Point);
+        std::vector<uint8_t> data = pContext->readTextureSubresource(pCopy.get(), 0);
+
+        entry.alpha.resize(entry.width * entry.height);
+        for (size_t i = 0; i < entry.alpha.size(); i++) entry.alpha[i] = data[i * 4 + 3];
+        return entry;
+    }
+
+    const Picking::MeshTexCoords& Picking::getMeshTexCoords(const Mesh::SharedPtr& pMesh)
+    {
+        MeshTexCoords& entry = mMeshTexCoords[pMesh.get()];
+        if (entry.pMesh.lock() == pMesh) return entry;
+
+        entry = MeshTexCoords();
+        entry.pMesh = pMesh;
+        // The BVH was only built if the indices are in range of the vertices, so they index the texture coordinates safely
+        readTexCoords(pMesh.get(), entry.texCoords);
+        return entry;
+    }
+
     void Picking::setPerFrameData(const CurrentWorkingData& currentData)
     {
         if (currentData.pCamera)
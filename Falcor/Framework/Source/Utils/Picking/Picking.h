@@ -30,11 +30,13 @@
 #include "Graphics/Scene/SceneRenderer.h"
 #include "Graphics/Model/ObjectInstance.h"
 #include "Graphics/Scene/Editor/Gizmo.h"
+#include "Graphics/Bvh/SceneBvh.h"
 #include <unordered_set>
 
 namespace Falcor
 {
     /** SceneRenderer extended to add picking capabilities. Determines which object in the scene was clicked by the mouse.
+        By default a ray is cast through a CPU BVH of the scene, which doesn't wait for the GPU. Mode::Raster renders the object IDs and reads them back instead.
     */
     class Picking : public SceneRenderer
     {
@@ -50,6 +52,23 @@ namespace Falcor
         */
         static UniquePtr create(const Scene::SharedPtr& pScene, uint32_t fboWidth, uint32_t fboHeight);
 
+        /** How pick() finds the object under the mouse.
+            With Mode::RayCast, skinned meshes are picked in their bind pose, and meshes which aren't indexed triangle lists can't be picked.
+        */
+        enum class Mode
+        {
+            RayCast,    ///< Cast a ray through a CPU BVH of the scene. The BVH is built on the first pick and refit when instances move.
+            Raster,     ///< Render the object IDs under the mouse into the internal FBO and read them back. Waits for the GPU to finish rendering.
+        };
+
+        /** Set the picking mode. Defaults to Mode::RayCast.
+        */
+        void setMode(Mode mode) { mMode = mode; }
+
+        /** Get the picking mode
+        */
+        Mode getMode() const { return mMode; }
+
         /** Performs a picking operation on the scene and stores the result.
             \param[in] mousePos Mouse position in the range [0,1] with (0,0) being the top left corner. Same coordinate space as in MouseEvent.
             \param[in] pContext Render context to render scene with.
@@ -68,6 +87,19 @@ namespace Falcor
         */
         Scene::ModelInstance::SharedPtr getPickedModelInstance() const;
 
+        /** Gets the picked triangle.
+            \return The triangle's index in the mesh's index buffer, or BvhHit::kInvalidId if nothing was picked or the mode is Mode::Raster.
+        */
+        uint32_t getPickedPrimitiveId() const { return mPickedPrimitiveId; }
+
+        /** Gets the world-space position of the picked point. Only valid if something was picked with Mode::RayCast.
+        */
+        const glm::vec3& getPickedPosition() const { return mPickedPosition; }
+
+        /** Get the time the last pick() took, in milliseconds. With Mode::RayCast, it includes building or updating the BVH and reading back alpha-tested textures.
+        */
+        double getLastPickTimeMs() const { return mLastPickTimeMs; }
+
         /** Resize the internal FBO used for picking.
             \param[in] width Width of the FBO.
             \param[in] height Height of the FBO.
@@ -91,6 +123,33 @@ namespace Falcor
 
         void calculateScissor(const glm::vec2& mousePos);
 
+        void rayCast(RenderContext* pContext, const glm::vec2& mousePos, const Camera* pCamera);
+
+        /** Check whether a hit stays after the alpha test, the rear culling of rotation gizmos and the instances' visibility
+        */
+        bool isHitAccepted(RenderContext* pContext, const BvhRay& ray, const BvhHit& hit);
+
+        /** Base color alpha of a texture, read back for the CPU alpha test
+        */
+        struct AlphaTexture
+        {
+            std::weak_ptr<Texture> pTexture;    ///< To notice when the texture was released and another one got its address
+            std::vector<uint8_t> alpha;
+            uint32_t width = 0;
+            uint32_t height = 0;
+        };
+
+        /** Texture coordinates of a mesh, read back for the CPU alpha test. Empty if the mesh has none in a supported format.
+        */
+        struct MeshTexCoords
+        {
+            std::weak_ptr<Mesh> pMesh;
+            std::vector<glm::vec2> texCoords;
+        };
+
+        const AlphaTexture& getAlphaTexture(RenderContext* pContext, const Texture::SharedPtr& pTexture);
+        const MeshTexCoords& getMeshTexCoords(const Mesh::SharedPtr& pMesh);
+
         struct Instance
         {
             Scene::ModelInstance::SharedPtr pModelInstance;
@@ -120,5 +179,13 @@ namespace Falcor
         DepthStencilState::SharedPtr mpExcludeStencilDS;
 
         GraphicsState::Scissor mScissor;
+
+        Mode mMode = Mode::RayCast;
+        SceneBvh::SharedPtr mpBvh;
+        std::unordered_map<const Texture*, AlphaTexture> mAlphaTextures;
+        std::unordered_map<const Mesh*, MeshTexCoords> mMeshTexCoords;
+        uint32_t mPickedPrimitiveId = BvhHit::kInvalidId;
+        glm::vec3 mPickedPosition;
+        double mLastPickTimeMs = 0;
     };
 }
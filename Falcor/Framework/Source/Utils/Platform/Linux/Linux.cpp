@@ -37,6 +37,7 @@
 #include <gtk/gtk.h>
 #include <fstream>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <libgen.h>
 #include <errno.h>
 #include <algorithm>
@@ -477,6 +478,31 @@ namespace Falcor
         return s.st_mtime;
     }
 
+    const void* mapFile(const std::string& filename, size_t& size)
+    {
+        size = 0;
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+
+        struct stat s;
+        void* pData = nullptr;
+        if (fstat(fd, &s) == 0 && s.st_size > 0)
+        {
+            pData = mmap(nullptr, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (pData == MAP_FAILED) pData = nullptr;
+            else size = (size_t)s.st_size;
+        }
+
+        // The mapping keeps its own reference to the file
+        close(fd);
+        return pData;
+    }
+
+    void unmapFile(const void* pData, size_t size)
+    {
+        if (pData) munmap(const_cast<void*>(pData), size);
+    }
+
     uint32_t bitScanReverse(uint32_t a)
     {
         // __builtin_clz counts 0's from the MSB, convert to index from the LSB
@@ -259,6 +259,17 @@ namespace Falcor
     */
     time_t getFileModifiedTime(const std::string& filename);
 
+    /** Map a file into memory for reading. The pages are loaded on demand by the OS, so this is cheap even for very large files.
+        \param[in] filename The file to map
+        \param[out] size The size of the file in bytes
+        \return A pointer to the file's content, or nullptr if the file can't be opened or is empty. Release it with unmapFile().
+    */
+    const void* mapFile(const std::string& filename, size_t& size);
+
+    /** Release a mapping created by mapFile()
+    */
+    void unmapFile(const void* pData, size_t size);
+
     enum class ThreadPriorityType : int32_t
     {
         BackgroundBegin     = -2,   //< Indicates I/O-intense thread
@@ -484,6 +484,34 @@ namespace Falcor
         return s.st_mtime;
     }
 
+    const void* mapFile(const std::string& filename, size_t& size)
+    {
+        size = 0;
+        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE) return nullptr;
+
+        const void* pData = nullptr;
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0)
+        {
+            HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (hMapping)
+            {
+                pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+                if (pData) size = (size_t)fileSize.QuadPart;
+                // The view keeps the mapping object alive
+                CloseHandle(hMapping);
+            }
+        }
+        CloseHandle(hFile);
+        return pData;
+    }
+
+    void unmapFile(const void* pData, size_t size)
+    {
+        if (pData) UnmapViewOfFile(pData);
+    }
+
     uint64_t getTotalVirtualMemory()
     {
         MEMORYSTATUSEX memInfo;
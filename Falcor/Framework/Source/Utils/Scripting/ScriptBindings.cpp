@@ -82,7 +82,7 @@ namespace Falcor
         // Model load flags
         auto model = pybind11::enum_<Model::LoadFlags>(m, "ModelLoadFlags");
         model.val(Model::LoadFlags::None).val(Model::LoadFlags::DontGenerateTangentSpace).val(Model::LoadFlags::FindDegeneratePrimitives).val(Model::LoadFlags::AssumeLinearSpaceTextures);
-        model.val(Model::LoadFlags::DontMergeMeshes).val(Model::LoadFlags::BuffersAsShaderResource).val(Model::LoadFlags::RemoveInstancing).val(Model::LoadFlags::UseSpecGlossMaterials);
+        model.val(Model::LoadFlags::DontMergeMeshes).val(Model::LoadFlags::BuffersAsShaderResource).val(Model::LoadFlags::RemoveInstancing).val(Model::LoadFlags::UseSpecGlossMaterials).val(Model::LoadFlags::DontOptimizeMeshes).val(Model::LoadFlags::GenerateMeshlets);
 
         // Scene load flags
         auto scene = pybind11::enum_<Scene::LoadFlags>(m, "SceneLoadFlags");
@@ -0,0 +1,183 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "AnimationTest.h"
+#include "TestHelper.h"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtx/transform.hpp"
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    const uint32_t kFrameCount = 16;
+    const uint32_t kRepeatCount = 5;
+
+    // More bones than Animation evaluates on one thread
+    const uint32_t kBoneCount = 2048;
+    const uint32_t kKeysPerChannel = 32;
+    const float kAnimationDuration = 100.0f;
+    const float kTicksPerSecond = 25.0f;
+
+    // Largest allowed difference between a bone matrix and its reference, relative to the reference
+    const float kTolerance = 1e-3f;
+
+    glm::quat randomRotation(std::mt19937& rng)
+    {
+        std::normal_distribution<float> normal;
+        return glm::normalize(glm::quat(normal(rng), normal(rng), normal(rng), normal(rng)));
+    }
+
+    glm::vec3 interpolate(const glm::vec3& a, const glm::vec3& b, float ratio) { return glm::mix(a, b, ratio); }
+    glm::quat interpolate(const glm::quat& a, const glm::quat& b, float ratio) { return glm::slerp(a, b, ratio); }
+
+    // A key lookup like Animation's, with a binary search of every key. The key after the last one is the first one of the next loop.
+    template<typename T>
+    T interpolateReference(const std::vector<Animation::AnimationKey<T>>& keys, float ticks, const T& defaultValue)
+    {
+        if (keys.empty()) return defaultValue;
+
+        uint32_t key = 0;
+        if (ticks >= keys[0].time)
+        {
+            auto it = std::upper_bound(keys.begin(), keys.end(), ticks, [](float t, const Animation::AnimationKey<T>& k) { return t < k.time; });
+            key = (uint32_t)(it - keys.begin()) - 1;
+        }
+        uint32_t nextKey = (key + 1 == keys.size()) ? 0 : key + 1;
+        float diff = keys[nextKey].time - keys[key].time;
+        if (diff < 0) diff += kAnimationDuration;
+        float ratio = (diff > 0 && ticks > keys[key].time) ? (ticks - keys[key].time) / diff : 0.0f;
+        return interpolate(keys[key].value, keys[nextKey].value, ratio);
+    }
+
+    glm::mat4 evaluateReference(const Animation::AnimationSet& set, float ticks)
+    {
+        glm::vec3 translation = interpolateReference(set.translation.keys, ticks, glm::vec3(0.0f));
+        glm::vec3 scaling = interpolateReference(set.scaling.keys, ticks, glm::vec3(1.0f));
+        glm::quat rotation = interpolateReference(set.rotation.keys, ticks, glm::quat(1, 0, 0, 0));
+        return glm::translate(translation) * glm::mat4_cast(rotation) * glm::scale(scaling);
+    }
+}
+
+void AnimationTest::addTests()
+{
+    addTestToList<TestAnimate>();
+}
+
+void AnimationTest::onInit()
+{
+}
+
+testing_func(AnimationTest, TestAnimate)
+{
+    // Random keys, at the same times for every channel
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Animation::AnimationSet> sets(kBoneCount);
+    std::vector<Bone> bones(kBoneCount);
+    for (uint32_t i = 0; i < kBoneCount; i++)
+    {
+        Animation::AnimationSet& set = sets[i];
+        set.boneID = i;
+        for (uint32_t k = 0; k < kKeysPerChannel; k++)
+        {
+            float time = kAnimationDuration * k / kKeysPerChannel;
+            set.translation.keys.push_back({ glm::vec3(unit(rng), unit(rng), unit(rng)) * 2.0f - 1.0f, time });
+            set.scaling.keys.push_back({ glm::vec3(0.5f + unit(rng)), time });
+            set.rotation.keys.push_back({ randomRotation(rng), time });
+        }
+
+        // Roots without an offset, so the bone matrices are the local transforms the animation sets
+        bones[i].parentID = AnimationController::kInvalidBoneID;
+        bones[i].boneID = i;
+        bones[i].name = std::to_string(i);
+    }
+    Animation::UniquePtr pAnimation = Animation::create("Test", sets, kAnimationDuration, kTicksPerSecond);
+    AnimationController::UniquePtr pController = AnimationController::create(bones);
+
+    // Play the animation once
+    const double loopSeconds = kAnimationDuration / kTicksPerSecond;
+    auto getTime = [&](uint32_t frame) { return loopSeconds * frame / kFrameCount; };
+    auto getTicks = [&](uint32_t frame) { return (float)fmod(getTime(frame) * kTicksPerSecond, kAnimationDuration); };
+
+    volatile float sink = 0;            // Keeps the reference computation from being optimized away
+    double referenceMs = TestHelper::measureFastestMs(kRepeatCount, [&]()
+    {
+        float checksum = 0;
+        for (uint32_t frame = 0; frame < kFrameCount; frame++)
+        {
+            for (const auto& set : sets) checksum += evaluateReference(set, getTicks(frame))[3][0];
+        }
+        sink = checksum;
+    });
+    double parallelMs = TestHelper::measureFastestMs(kRepeatCount, [&]()
+    {
+        for (uint32_t frame = 0; frame < kFrameCount; frame++) pAnimation->animate(getTime(frame), pController.get());
+    });
+    // Loops run from a task of the worker pool run on that thread only
+    double serialMs = TestHelper::measureFastestMs(kRepeatCount, [&]()
+    {
+        parallelFor(1, 1, [&](uint32_t)
+        {
+            for (uint32_t frame = 0; frame < kFrameCount; frame++) pAnimation->animate(getTime(frame), pController.get());
+        });
+    });
+
+    float maxError = 0;
+    for (uint32_t frame = 0; frame < kFrameCount; frame++)
+    {
+        pAnimation->animate(getTime(frame), pController.get());
+        pController->animate(0);        // Computes the bone matrices from the local transforms, without an active animation
+        for (uint32_t i = 0; i < kBoneCount; i++)
+        {
+            maxError = std::max(maxError, TestHelper::maxRelativeDifference(pController->getBoneMatrices()[i], evaluateReference(sets[i], getTicks(frame))));
+        }
+    }
+    if (maxError > kTolerance)
+    {
+        return test_fail("The bone transforms differ from the reference by " + std::to_string(maxError));
+    }
+
+    const uint64_t boneCount = (uint64_t)kBoneCount * kFrameCount;
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "Animation: " << kBoneCount << " bones over " << kFrameCount << " frames. Reference " << boneCount / referenceMs << " bones/ms, animate() "
+       << boneCount / serialMs << " bones/ms on 1 thread, " << boneCount / parallelMs << " bones/ms on " << WorkerPool::get().getThreadCount() << " threads. Max error "
+       << std::scientific << std::setprecision(2) << maxError;
+    logInfo(ss.str());
+    return test_pass();
+}
+
+int main()
+{
+    AnimationTest at;
+    at.init(true);
+    at.run();
+    return 0;
+}
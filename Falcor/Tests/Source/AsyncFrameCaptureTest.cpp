@@ -0,0 +1,224 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "AsyncFrameCaptureTest.h"
+#include "Utils/AsyncFrameCapture.h"
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    const uint32_t kThroughputFrameCount = 64;
+    const uint32_t kPolicyFrameCount = 16;
+
+    struct Resolution
+    {
+        const char* name;
+        uint32_t width;
+        uint32_t height;
+    };
+    const Resolution kResolutions[] = { { "1080p", 1920, 1080 }, { "4K", 3840, 2160 } };
+
+    /** A single writer and two frames in flight, so capturing without pause always fills the queue
+    */
+    AsyncFrameCapture::SharedPtr createSmallQueue(AsyncFrameCapture::QueueFullPolicy policy)
+    {
+        AsyncFrameCapture::Desc desc;
+        desc.writerThreadCount = 1;
+        desc.maxPendingFrames = 2;
+        desc.queueFullPolicy = policy;
+        return AsyncFrameCapture::create(desc);
+    }
+
+    /** Capture frames as fast as possible, and wait until they're written
+        \return The number of frames capture() accepted
+    */
+    uint32_t captureFrames(AsyncFrameCapture* pCapture, const Texture* pTexture, const std::string& directory, uint32_t frameCount, std::vector<std::string>& filenames)
+    {
+        uint32_t accepted = 0;
+        filenames.resize(frameCount);
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            std::stringstream ss;
+            ss << directory << "/frame" << std::setw(4) << std::setfill('0') << frame << ".png";
+            filenames[frame] = ss.str();
+            std::remove(filenames[frame].c_str());
+            if (pCapture->capture(pTexture, 0, 0, filenames[frame], Bitmap::FileFormat::PngFile)) accepted++;
+        }
+        pCapture->flush();
+        return accepted;
+    }
+}
+
+void AsyncFrameCaptureTest::addTests()
+{
+    addTestToList<TestThroughput>();
+    addTestToList<TestBlock>();
+    addTestToList<TestDropNewest>();
+    addTestToList<TestDropOldest>();
+}
+
+void AsyncFrameCaptureTest::onInit()
+{
+}
+
+std::string AsyncFrameCaptureTest::createTestDirectory(const std::string& name)
+{
+    std::string directory = getExecutableDirectory() + "/AsyncFrameCaptureTest";
+    createDirectory(directory);
+    directory += "/" + name;
+    createDirectory(directory);
+    return directory;
+}
+
+Texture::SharedPtr AsyncFrameCaptureTest::createNoiseTexture(uint32_t width, uint32_t height)
+{
+    std::mt19937 rng(width);
+    std::vector<uint32_t> texels((size_t)width * height);
+    for (auto& t : texels) t = rng();
+    return Texture::create2D(width, height, ResourceFormat::RGBA8Unorm, 1, 1, texels.data());
+}
+
+testing_func(AsyncFrameCaptureTest, TestThroughput)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    for (const Resolution& res : kResolutions)
+    {
+        Texture::SharedPtr pTexture = createNoiseTexture(res.width, res.height);
+        std::string directory = createTestDirectory(std::string("Throughput") + res.name);
+
+        // The default settings, as used by Texture::captureToFile()
+        AsyncFrameCapture::SharedPtr pCapture = AsyncFrameCapture::create();
+        std::vector<std::string> filenames;
+        uint32_t accepted = captureFrames(pCapture.get(), pTexture.get(), directory, kThroughputFrameCount, filenames);
+
+        AsyncFrameCapture::Stats stats = pCapture->getStats();
+        if (accepted != kThroughputFrameCount || stats.framesWritten != kThroughputFrameCount)
+        {
+            return test_fail(std::string(res.name) + ": " + std::to_string(stats.framesWritten) + " of " + std::to_string(kThroughputFrameCount) + " frames were written");
+        }
+        for (const auto& f : filenames)
+        {
+            if (doesFileExist(f) == false) return test_fail("Missing " + f);
+        }
+        ss << "AsyncFrameCapture: " << res.name << " PNG, " << pCapture->getDesc().writerThreadCount << " writers: " << stats.framesPerSecond << " frames/s, capture() blocked for "
+           << stats.blockedTimeMs << " ms (" << pCapture->getStatsString() << ")\n";
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(AsyncFrameCaptureTest, TestBlock)
+{
+    Texture::SharedPtr pTexture = createNoiseTexture(kResolutions[1].width, kResolutions[1].height);
+    std::string directory = createTestDirectory("Block");
+    AsyncFrameCapture::SharedPtr pCapture = createSmallQueue(AsyncFrameCapture::QueueFullPolicy::Block);
+    std::vector<std::string> filenames;
+    uint32_t accepted = captureFrames(pCapture.get(), pTexture.get(), directory, kPolicyFrameCount, filenames);
+
+    // Every frame is kept, capture() waits for the writer instead, and the queue never grows past its limit
+    AsyncFrameCapture::Stats stats = pCapture->getStats();
+    if (accepted != kPolicyFrameCount || stats.framesWritten != kPolicyFrameCount || stats.framesDropped != 0)
+    {
+        return test_fail("Blocking capture lost frames");
+    }
+    if (stats.blockedTimeMs <= 0)
+    {
+        return test_fail("capture() never waited, though the writer can't keep up");
+    }
+    if (stats.maxPendingFrames > pCapture->getDesc().maxPendingFrames)
+    {
+        return test_fail(std::to_string(stats.maxPendingFrames) + " frames were in flight, the limit is " + std::to_string(pCapture->getDesc().maxPendingFrames));
+    }
+    for (const auto& f : filenames)
+    {
+        if (doesFileExist(f) == false) return test_fail("Missing " + f);
+    }
+    return test_pass();
+}
+
+testing_func(AsyncFrameCaptureTest, TestDropNewest)
+{
+    Texture::SharedPtr pTexture = createNoiseTexture(kResolutions[1].width, kResolutions[1].height);
+    std::string directory = createTestDirectory("DropNewest");
+    AsyncFrameCapture::SharedPtr pCapture = createSmallQueue(AsyncFrameCapture::QueueFullPolicy::DropNewest);
+    std::vector<std::string> filenames;
+    uint32_t accepted = captureFrames(pCapture.get(), pTexture.get(), directory, kPolicyFrameCount, filenames);
+
+    // Frames are dropped instead of waiting. The first frames always fit in the queue, so they are the ones written.
+    AsyncFrameCapture::Stats stats = pCapture->getStats();
+    if (stats.framesDropped == 0 || accepted + stats.framesDropped != kPolicyFrameCount || stats.framesWritten != accepted)
+    {
+        return test_fail(std::to_string(accepted) + " frames accepted, " + std::to_string(stats.framesWritten) + " written and " + std::to_string(stats.framesDropped) + " dropped");
+    }
+    if (stats.blockedTimeMs != 0)
+    {
+        return test_fail("capture() waited, though it should drop the frame");
+    }
+    for (uint32_t frame = 0; frame < pCapture->getDesc().maxPendingFrames; frame++)
+    {
+        if (doesFileExist(filenames[frame]) == false) return test_fail("Missing " + filenames[frame]);
+    }
+    return test_pass();
+}
+
+testing_func(AsyncFrameCaptureTest, TestDropOldest)
+{
+    Texture::SharedPtr pTexture = createNoiseTexture(kResolutions[1].width, kResolutions[1].height);
+    std::string directory = createTestDirectory("DropOldest");
+    AsyncFrameCapture::SharedPtr pCapture = createSmallQueue(AsyncFrameCapture::QueueFullPolicy::DropOldest);
+    std::vector<std::string> filenames;
+    uint32_t accepted = captureFrames(pCapture.get(), pTexture.get(), directory, kPolicyFrameCount, filenames);
+
+    // Every frame is accepted, and queued frames are discarded to make room. The last frame is never discarded.
+    AsyncFrameCapture::Stats stats = pCapture->getStats();
+    if (accepted != kPolicyFrameCount || stats.framesDropped == 0 || stats.framesWritten + stats.framesDropped != kPolicyFrameCount)
+    {
+        return test_fail(std::to_string(stats.framesWritten) + " frames written and " + std::to_string(stats.framesDropped) + " dropped");
+    }
+    if (doesFileExist(filenames.back()) == false)
+    {
+        return test_fail("The newest frame wasn't written");
+    }
+    uint32_t fileCount = 0;
+    for (const auto& f : filenames) fileCount += doesFileExist(f) ? 1 : 0;
+    if (fileCount != stats.framesWritten)
+    {
+        return test_fail(std::to_string(fileCount) + " files for " + std::to_string(stats.framesWritten) + " written frames");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    AsyncFrameCaptureTest afct;
+    afct.init(true);
+    afct.run();
+    return 0;
+}
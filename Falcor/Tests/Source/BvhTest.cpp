@@ -0,0 +1,368 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BvhTest.h"
+#include "TestHelper.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    // Relative to the directory given by SCENE_DATA_DIR, which the project sets to CommonPasses/Data
+    const char* kScenes[] =
+    {
+        "Scenes/pink_room/pink_room.fscene",
+        "Scenes/forest/forest.fscene",
+        "Scenes/Purple_Bedroom_Scene/purple_bedroom.fscene",
+        "Scenes/Bistro_Scene/bistro.fscene",
+        "Scenes/Sun_Temple_Scene/SunTemple.fscene",
+    };
+
+    struct TestMesh
+    {
+        std::string name;
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+
+        uint32_t getTriangleCount() const { return (uint32_t)indices.size() / 3; }
+    };
+
+    /** A bumpy sphere, a closed surface like most scanned or sculpted models
+    */
+    TestMesh createSphere(uint32_t rings, uint32_t segments)
+    {
+        TestMesh mesh;
+        mesh.name = "sphere";
+        for (uint32_t r = 0; r <= rings; r++)
+        {
+            float theta = (float)M_PI * r / rings;
+            for (uint32_t s = 0; s <= segments; s++)
+            {
+                float phi = 2.0f * (float)M_PI * s / segments;
+                float radius = 1.0f + 0.05f * std::sin(theta * 17.0f) * std::cos(phi * 13.0f);
+                mesh.positions.push_back(radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+            }
+        }
+        for (uint32_t r = 0; r < rings; r++)
+        {
+            for (uint32_t s = 0; s < segments; s++)
+            {
+                uint32_t v = r * (segments + 1) + s;
+                mesh.indices.insert(mesh.indices.end(), { v, v + 1, v + segments + 1, v + 1, v + segments + 2, v + segments + 1 });
+            }
+        }
+        return mesh;
+    }
+
+    /** Small triangles scattered in a cube, like foliage. Their bounds overlap a lot, which is the hard case for the SAH build.
+    */
+    TestMesh createTriangleSoup(uint32_t triangleCount)
+    {
+        TestMesh mesh;
+        mesh.name = "triangle soup";
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> offset(-0.05f, 0.05f);
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 center(position(rng), position(rng), position(rng));
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                mesh.indices.push_back((uint32_t)mesh.positions.size());
+                mesh.positions.push_back(center + glm::vec3(offset(rng), offset(rng), offset(rng)));
+            }
+        }
+        return mesh;
+    }
+
+    MeshBvh::SharedPtr createBvh(const TestMesh& mesh, uint32_t threadCount)
+    {
+        Bvh::BuildDesc desc;
+        desc.threadCount = threadCount;
+        return MeshBvh::create(&mesh.positions[0].x, sizeof(glm::vec3), mesh.indices.data(), mesh.getTriangleCount(), desc);
+    }
+
+    /** Rays from random points around the mesh towards random points inside it, so most of them hit
+    */
+    std::vector<BvhRay> createRays(uint32_t rayCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> normal;
+        std::uniform_real_distribution<float> target(-0.5f, 0.5f);
+        std::vector<BvhRay> rays(rayCount);
+        for (BvhRay& ray : rays)
+        {
+            ray.origin = glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng))) * 3.0f;
+            ray.direction = glm::vec3(target(rng), target(rng), target(rng)) - ray.origin;
+        }
+        return rays;
+    }
+
+    /** Rays from a pinhole camera looking at the mesh, one per pixel in row order, so packets hold neighboring pixels like primary rays
+    */
+    std::vector<BvhRay> createCameraRays(uint32_t width, uint32_t height)
+    {
+        std::vector<BvhRay> rays(width * height);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                BvhRay& ray = rays[y * width + x];
+                ray.origin = glm::vec3(0, 0, 3.0f);
+                ray.direction = glm::vec3((x + 0.5f) / width - 0.5f, 0.5f - (y + 0.5f) / height, -1.0f);
+            }
+        }
+        return rays;
+    }
+
+    BvhHit intersectBruteForce(const TestMesh& mesh, const BvhRay& ray)
+    {
+        BvhHit hit;
+        for (uint32_t t = 0; t < mesh.getTriangleCount(); t++)
+        {
+            // Moller-Trumbore, with the barycentrics MeshBvh reports
+            const glm::vec3& v0 = mesh.positions[mesh.indices[t * 3 + 0]];
+            glm::vec3 e1 = mesh.positions[mesh.indices[t * 3 + 1]] - v0;
+            glm::vec3 e2 = mesh.positions[mesh.indices[t * 3 + 2]] - v0;
+            glm::vec3 p = glm::cross(ray.direction, e2);
+            float det = glm::dot(e1, p);
+            if (std::abs(det) < 1e-12f) continue;
+            float invDet = 1.0f / det;
+            glm::vec3 s = ray.origin - v0;
+            float u = glm::dot(s, p) * invDet;
+            glm::vec3 q = glm::cross(s, e1);
+            float v = glm::dot(ray.direction, q) * invDet;
+            float d = glm::dot(e2, q) * invDet;
+            if (u < 0 || v < 0 || u + v > 1 || d < ray.tMin || d > ray.tMax || d >= hit.t) continue;
+            hit.t = d;
+            hit.u = u;
+            hit.v = v;
+            hit.primitiveId = t;
+        }
+        return hit;
+    }
+
+    /** Hits at the same distance on different triangles are ambiguous, so only the distances are compared
+    */
+    bool isSameHit(const BvhHit& a, const BvhHit& b)
+    {
+        if (a.isValid() != b.isValid()) return false;
+        return a.isValid() == false || std::abs(a.t - b.t) <= 1e-4f * std::max(1.0f, a.t);
+    }
+
+    /** Run every query type on a set of rays, checking them against the closest hits in 'reference'
+        \return An empty string on success, otherwise the first mismatch
+    */
+    template<typename BvhT>
+    std::string compareQueries(const BvhT& bvh, const std::vector<BvhRay>& rays, const std::vector<BvhHit>& reference)
+    {
+        for (size_t i = 0; i + 8 <= rays.size(); i += 8)
+        {
+            BvhHit hits1[8], hits4[8], hits8[8];
+            for (uint32_t l = 0; l < 8; l++) bvh.intersect(rays[i + l], hits1[l]);
+            bvh.intersect4(&rays[i], hits4);
+            bvh.intersect4(&rays[i + 4], hits4 + 4);
+            bvh.intersect8(&rays[i], hits8);
+            uint32_t occluded4 = bvh.occluded4(&rays[i]) | (bvh.occluded4(&rays[i + 4]) << 4);
+            uint32_t occluded8 = bvh.occluded8(&rays[i]);
+
+            for (uint32_t l = 0; l < 8; l++)
+            {
+                const BvhHit& expected = reference[i + l];
+                const std::string ray = "Ray " + std::to_string(i + l) + ": ";
+                if (isSameHit(hits1[l], expected) == false) return ray + "intersect() doesn't match the reference";
+                if (isSameHit(hits4[l], expected) == false) return ray + "intersect4() doesn't match the reference";
+                if (isSameHit(hits8[l], expected) == false) return ray + "intersect8() doesn't match the reference";
+                if (bvh.occluded(rays[i + l]) != expected.isValid()) return ray + "occluded() doesn't match the reference";
+                if (((occluded4 >> l) & 1) != (expected.isValid() ? 1u : 0u)) return ray + "occluded4() doesn't match the reference";
+                if (((occluded8 >> l) & 1) != (expected.isValid() ? 1u : 0u)) return ray + "occluded8() doesn't match the reference";
+            }
+        }
+        return "";
+    }
+
+    /** Trace the rays with each query type on the calling thread, and log the throughput
+    */
+    template<typename BvhT>
+    std::string measureTracing(const BvhT& bvh, const std::vector<BvhRay>& rays)
+    {
+        const uint32_t rayCount = (uint32_t)rays.size() & ~7u;
+        std::vector<BvhHit> hits(rayCount);
+        std::vector<uint32_t> masks(rayCount / 4);
+        double closestHit[3], anyHit[3];
+        // The closest-hit queries only look for hits closer than the ones they are given, so start each run from no hits
+        auto reset = [&]() { std::fill(hits.begin(), hits.end(), BvhHit()); };
+        closestHit[0] = TestHelper::measureFastestMs(3, [&]() { reset(); for (uint32_t i = 0; i < rayCount; i++) bvh.intersect(rays[i], hits[i]); });
+        closestHit[1] = TestHelper::measureFastestMs(3, [&]() { reset(); for (uint32_t i = 0; i < rayCount; i += 4) bvh.intersect4(&rays[i], &hits[i]); });
+        closestHit[2] = TestHelper::measureFastestMs(3, [&]() { reset(); for (uint32_t i = 0; i < rayCount; i += 8) bvh.intersect8(&rays[i], &hits[i]); });
+        anyHit[0] = TestHelper::measureFastestMs(3, [&]() { for (uint32_t i = 0; i < rayCount; i++) masks[i / 4] = bvh.occluded(rays[i]) ? 1 : 0; });
+        anyHit[1] = TestHelper::measureFastestMs(3, [&]() { for (uint32_t i = 0; i < rayCount; i += 4) masks[i / 4] = bvh.occluded4(&rays[i]); });
+        anyHit[2] = TestHelper::measureFastestMs(3, [&]() { for (uint32_t i = 0; i < rayCount; i += 8) masks[i / 4] = bvh.occluded8(&rays[i]); });
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2);
+        ss << rayCount << " rays on one thread. Closest-hit: " << TestHelper::toMillionsPerSecond(rayCount, closestHit[0]) << " / "
+           << TestHelper::toMillionsPerSecond(rayCount, closestHit[1]) << " / " << TestHelper::toMillionsPerSecond(rayCount, closestHit[2]) << " Mrays/s, any-hit: "
+           << TestHelper::toMillionsPerSecond(rayCount, anyHit[0]) << " / " << TestHelper::toMillionsPerSecond(rayCount, anyHit[1]) << " / "
+           << TestHelper::toMillionsPerSecond(rayCount, anyHit[2]) << " Mrays/s (single rays / 4-ray packets / 8-ray packets)";
+        return ss.str();
+    }
+}
+
+void BvhTest::addTests()
+{
+    addTestToList<TestMeshBuild>();
+    addTestToList<TestMeshQueries>();
+    addTestToList<TestMeshTraceThroughput>();
+    addTestToList<TestSceneBuildAndTrace>();
+}
+
+void BvhTest::onInit()
+{
+    addDataDirectory(SCENE_DATA_DIR);
+}
+
+testing_func(BvhTest, TestMeshBuild)
+{
+    const TestMesh meshes[] = { createSphere(512, 1024), createTriangleSoup(1 << 20) };
+    std::vector<uint32_t> threadCounts = { 1 };
+    if (WorkerPool::get().getThreadCount() > 1) threadCounts.push_back(WorkerPool::get().getThreadCount());
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    for (const TestMesh& mesh : meshes)
+    {
+        for (uint32_t threadCount : threadCounts)
+        {
+            MeshBvh::SharedPtr pBvh;
+            double ms = TestHelper::measureFastestMs(3, [&]() { pBvh = createBvh(mesh, threadCount); });
+
+            // Every triangle is in exactly one leaf
+            const Bvh& bvh = pBvh->getBvh();
+            std::vector<uint32_t> leafCount(mesh.getTriangleCount(), 0);
+            for (const BvhNode& node : bvh.getNodes())
+            {
+                if (node.isLeaf() == false) continue;
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++) leafCount[bvh.getPrimitiveIndices()[i]]++;
+            }
+            if (std::any_of(leafCount.begin(), leafCount.end(), [](uint32_t c) { return c != 1; })) return test_fail(mesh.name + ": the leaves don't hold every triangle once");
+
+            const Bvh::BuildStats& stats = bvh.getBuildStats();
+            ss << "MeshBvh " << mesh.name << ", " << mesh.getTriangleCount() << " triangles on " << stats.threadCount << " threads: "
+               << TestHelper::toMillionsPerSecond(mesh.getTriangleCount(), ms) << " Mtri/s, " << stats.nodeCount << " nodes, depth " << stats.maxDepth
+               << ", SAH cost " << stats.sahCost << "\n";
+        }
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(BvhTest, TestMeshQueries)
+{
+    const TestMesh meshes[] = { createSphere(64, 128), createTriangleSoup(20000) };
+    std::vector<BvhRay> rays = createRays(2000, 2);
+    const std::vector<BvhRay> cameraRays = createCameraRays(48, 48);
+    rays.insert(rays.end(), cameraRays.begin(), cameraRays.end());
+
+    for (const TestMesh& mesh : meshes)
+    {
+        std::vector<BvhHit> reference(rays.size());
+        for (size_t i = 0; i < rays.size(); i++) reference[i] = intersectBruteForce(mesh, rays[i]);
+
+        // Trees built on one thread and on the pool differ in their layout, so check both
+        for (uint32_t threadCount : { 1u, 0u })
+        {
+            MeshBvh::SharedPtr pBvh = createBvh(mesh, threadCount);
+            std::string error = compareQueries(*pBvh, rays, reference);
+            if (error.size()) return test_fail(mesh.name + " built on " + std::to_string(pBvh->getBvh().getBuildStats().threadCount) + " threads: " + error);
+        }
+    }
+    return test_pass();
+}
+
+testing_func(BvhTest, TestMeshTraceThroughput)
+{
+    const TestMesh meshes[] = { createSphere(512, 1024), createTriangleSoup(1 << 20) };
+    const std::vector<BvhRay> cameraRays = createCameraRays(512, 512);
+    const std::vector<BvhRay> randomRays = createRays(1 << 18, 3);
+
+    std::stringstream ss;
+    for (const TestMesh& mesh : meshes)
+    {
+        MeshBvh::SharedPtr pBvh = createBvh(mesh, 0);
+        ss << "MeshBvh " << mesh.name << ", " << mesh.getTriangleCount() << " triangles, camera rays: " << measureTracing(*pBvh, cameraRays) << "\n";
+        ss << "MeshBvh " << mesh.name << ", " << mesh.getTriangleCount() << " triangles, incoherent rays: " << measureTracing(*pBvh, randomRays) << "\n";
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(BvhTest, TestSceneBuildAndTrace)
+{
+    const glm::uvec2 frameSize(1280, 720);
+    for (const char* scene : kScenes)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(scene, fullpath) == false || TestHelper::hasSceneModels(fullpath) == false)
+        {
+            logInfo(std::string("BvhTest: ") + scene + " skipped, its models aren't there");
+            continue;
+        }
+
+        Scene::SharedPtr pScene = Scene::loadFromFile(fullpath);
+        if (pScene == nullptr) return test_fail(std::string("Can't load ") + scene);
+        SceneBvh::SharedPtr pBvh = SceneBvh::create(pScene.get());
+        if (pBvh == nullptr) return test_fail(std::string("Can't build the BVH of ") + scene);
+        logInfo(std::string(scene) + ": " + pBvh->getBuildStatsString());
+
+        // One primary ray per pixel from the scene's camera
+        const Camera* pCamera = pScene->getActiveCamera().get();
+        if (pCamera == nullptr) continue;
+        std::vector<BvhRay> rays(frameSize.x * frameSize.y);
+        for (uint32_t y = 0; y < frameSize.y; y++)
+        {
+            for (uint32_t x = 0; x < frameSize.x; x++) rays[y * frameSize.x + x] = SceneBvh::createPrimaryRay(pCamera, glm::vec2(x + 0.5f, y + 0.5f), frameSize);
+        }
+
+        std::vector<BvhHit> reference(rays.size());
+        for (size_t i = 0; i < rays.size(); i++) pBvh->intersect(rays[i], reference[i]);
+        std::string error = compareQueries(*pBvh, rays, reference);
+        if (error.size()) return test_fail(std::string(scene) + ": " + error);
+        logInfo(std::string(scene) + ", primary rays: " + measureTracing(*pBvh, rays));
+    }
+    return test_pass();
+}
+
+int main()
+{
+    BvhTest bt;
+    bt.init(true);
+    bt.run();
+    return 0;
+}
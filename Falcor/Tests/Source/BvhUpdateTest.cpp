@@ -0,0 +1,467 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BvhUpdateTest.h"
+#include <random>
+
+namespace
+{
+    const uint32_t kBoxCount = 5000;
+    const uint32_t kGridSize = 64;
+    const uint32_t kRayCount = 2000;
+
+    void createRandomBoxes(std::mt19937& rng, float extent, std::vector<glm::vec3>& boundsMin, std::vector<glm::vec3>& boundsMax)
+    {
+        std::uniform_real_distribution<float> position(0, extent);
+        std::uniform_real_distribution<float> size(0.01f, 1.0f);
+        boundsMin.resize(kBoxCount);
+        boundsMax.resize(kBoxCount);
+        for (uint32_t i = 0; i < kBoxCount; i++)
+        {
+            boundsMin[i] = glm::vec3(position(rng), position(rng), position(rng));
+            boundsMax[i] = boundsMin[i] + glm::vec3(size(rng), size(rng), size(rng));
+        }
+    }
+
+    void moveBox(std::mt19937& rng, glm::vec3& boundsMin, glm::vec3& boundsMax)
+    {
+        std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+        glm::vec3 d(offset(rng), offset(rng), offset(rng));
+        boundsMin += d;
+        boundsMax += d;
+    }
+
+    // Bit-exact comparison of the nodes of two trees with the same structure
+    bool haveSameBounds(const Bvh& a, const Bvh& b)
+    {
+        const auto& nodesA = a.getNodes();
+        const auto& nodesB = b.getNodes();
+        if (nodesA.size() != nodesB.size()) return false;
+        for (size_t n = 0; n < nodesA.size(); n++)
+        {
+            if (nodesA[n].boundsMin != nodesB[n].boundsMin || nodesA[n].boundsMax != nodesB[n].boundsMax) return false;
+        }
+        return true;
+    }
+
+    InstanceChangeTracker::Instance createInstance(uint32_t i)
+    {
+        InstanceChangeTracker::Instance instance;
+        instance.transform = glm::translate(glm::mat4(), glm::vec3(float(i), 0, 0));
+        instance.geometryId = i % 7;
+        return instance;
+    }
+
+    std::string toString(const std::vector<uint32_t>& v)
+    {
+        std::string s;
+        for (uint32_t i : v) s += (s.empty() ? "" : ", ") + std::to_string(i);
+        return "{" + s + "}";
+    }
+}
+
+void BvhUpdateTest::addTests()
+{
+    addTestToList<TestUpdateDecisions>();
+    addTestToList<TestInstanceChanges>();
+    addTestToList<TestDirtyRanges>();
+    addTestToList<TestFullRefit>();
+    addTestToList<TestPartialRefit>();
+    addTestToList<TestMeshRefitMatchesRebuild>();
+    addTestToList<TestMeshRebuildOnDegradation>();
+}
+
+void BvhUpdateTest::onInit()
+{
+}
+
+BvhUpdateTest::TestMesh::TestMesh(uint32_t size)
+{
+    for (uint32_t z = 0; z <= size; z++)
+    {
+        for (uint32_t x = 0; x <= size; x++) positions.push_back(glm::vec3(float(x), 0, float(z)));
+    }
+    for (uint32_t z = 0; z < size; z++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint32_t v = z * (size + 1) + x;
+            indices.insert(indices.end(), { v, v + size + 1, v + 1, v + 1, v + size + 1, v + size + 2 });
+        }
+    }
+}
+
+void BvhUpdateTest::TestMesh::animate(float phase)
+{
+    for (glm::vec3& p : positions)
+    {
+        p.y = 2.0f * (std::sin(p.x * 0.3f + phase) + std::cos(p.z * 0.2f + phase * 0.5f));
+    }
+}
+
+void BvhUpdateTest::TestMesh::scramble()
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> random(0, float(kGridSize));
+    for (glm::vec3& p : positions) p = glm::vec3(random(rng), random(rng), random(rng));
+}
+
+BvhHit BvhUpdateTest::TestMesh::intersectBruteForce(const BvhRay& ray) const
+{
+    BvhHit hit;
+    for (uint32_t t = 0; t < getTriangleCount(); t++)
+    {
+        // Moller-Trumbore, with the barycentrics MeshBvh reports
+        const glm::vec3& v0 = positions[indices[t * 3 + 0]];
+        glm::vec3 e1 = positions[indices[t * 3 + 1]] - v0;
+        glm::vec3 e2 = positions[indices[t * 3 + 2]] - v0;
+        glm::vec3 p = glm::cross(ray.direction, e2);
+        float det = glm::dot(e1, p);
+        if (std::abs(det) < 1e-12f) continue;
+        float invDet = 1.0f / det;
+        glm::vec3 s = ray.origin - v0;
+        float u = glm::dot(s, p) * invDet;
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(ray.direction, q) * invDet;
+        float d = glm::dot(e2, q) * invDet;
+        if (u < 0 || v < 0 || u + v > 1 || d < ray.tMin || d > ray.tMax || d >= hit.t) continue;
+        hit.t = d;
+        hit.u = u;
+        hit.v = v;
+        hit.primitiveId = t;
+    }
+    return hit;
+}
+
+std::string BvhUpdateTest::checkTightBounds(const Bvh& bvh, const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax)
+{
+    const auto& nodes = bvh.getNodes();
+    const auto& primitives = bvh.getPrimitiveIndices();
+    for (size_t n = 0; n < nodes.size(); n++)
+    {
+        const BvhNode& node = nodes[n];
+        glm::vec3 expectedMin(FLT_MAX), expectedMax(-FLT_MAX);
+        if (node.isLeaf())
+        {
+            for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+            {
+                expectedMin = glm::min(expectedMin, boundsMin[primitives[i]]);
+                expectedMax = glm::max(expectedMax, boundsMax[primitives[i]]);
+            }
+        }
+        else
+        {
+            for (uint32_t c = node.offset; c < node.offset + 2; c++)
+            {
+                expectedMin = glm::min(expectedMin, nodes[c].boundsMin);
+                expectedMax = glm::max(expectedMax, nodes[c].boundsMax);
+            }
+        }
+        if (node.boundsMin != expectedMin || node.boundsMax != expectedMax)
+        {
+            return "The bounds of node " + std::to_string(n) + (node.isLeaf() ? " (a leaf)" : "") + " don't match its content";
+        }
+    }
+    return "";
+}
+
+std::string BvhUpdateTest::compareHits(const MeshBvh* pBvh, const TestMesh& mesh)
+{
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> position(-2.0f, float(kGridSize) + 2.0f);
+    std::uniform_real_distribution<float> slope(-0.5f, 0.5f);
+    for (uint32_t r = 0; r < kRayCount; r++)
+    {
+        BvhRay ray;
+        ray.origin = glm::vec3(position(rng), float(kGridSize) * 2, position(rng));
+        ray.direction = glm::vec3(slope(rng), -1.0f, slope(rng));
+
+        BvhHit expected = mesh.intersectBruteForce(ray);
+        BvhHit hit;
+        pBvh->intersect(ray, hit);
+
+        // Rays through shared edges may report either triangle, so only the distances are compared
+        if (hit.isValid() != expected.isValid() || (hit.isValid() && std::abs(hit.t - expected.t) > 1e-4f * expected.t))
+        {
+            return "Ray " + std::to_string(r) + " hits at " + (hit.isValid() ? std::to_string(hit.t) : "nothing") + ", expected " + (expected.isValid() ? std::to_string(expected.t) : "nothing");
+        }
+    }
+    return "";
+}
+
+testing_func(BvhUpdateTest, TestUpdateDecisions)
+{
+    BvhUpdateTracker::Policy policy;
+    policy.maxRefitCount = 4;
+    policy.maxCostGrowth = 1.5f;
+    BvhUpdateTracker tracker(policy);
+
+    if (tracker.decide(false, false) != BvhUpdateType::Rebuild) return test_fail("A structure which was never built must be built");
+    tracker.onUpdated(BvhUpdateType::Rebuild, 10.0);
+
+    if (tracker.decide(false, false, 100.0) != BvhUpdateType::None) return test_fail("Nothing changed, but an update was requested");
+    if (tracker.decide(true, false) != BvhUpdateType::Rebuild) return test_fail("A structure change must rebuild");
+    if (tracker.decide(false, true, 14.0) != BvhUpdateType::Refit) return test_fail("A cost growth below the limit must refit");
+    if (tracker.decide(false, true, 16.0) != BvhUpdateType::Rebuild) return test_fail("A cost growth above the limit must rebuild");
+    if (tracker.decide(false, true, 0.0) != BvhUpdateType::Refit) return test_fail("An unknown cost must skip the cost test");
+
+    // The refit limit counts refits since the last rebuild
+    for (uint32_t i = 0; i < policy.maxRefitCount; i++)
+    {
+        if (tracker.decide(false, true, 12.0) != BvhUpdateType::Refit) return test_fail("Refit " + std::to_string(i) + " was refused before the limit");
+        tracker.onUpdated(BvhUpdateType::Refit, 12.0);
+    }
+    if (tracker.getRefitCount() != policy.maxRefitCount) return test_fail("The refit count is wrong");
+    if (std::abs(tracker.getCostGrowth() - 1.2) > 1e-9) return test_fail("The cost growth is " + std::to_string(tracker.getCostGrowth()) + ", expected 1.2");
+    if (tracker.decide(false, true, 12.0) != BvhUpdateType::Rebuild) return test_fail("The refit limit didn't rebuild");
+
+    // A rebuild resets the count and the reference cost
+    tracker.onUpdated(BvhUpdateType::Rebuild, 20.0);
+    if (tracker.getRefitCount() != 0 || tracker.getCostGrowth() != 1.0) return test_fail("A rebuild didn't reset the tracker");
+    if (tracker.decide(false, true, 29.0) != BvhUpdateType::Refit) return test_fail("The reference cost wasn't updated by the rebuild");
+
+    tracker.invalidate();
+    if (tracker.decide(false, false) != BvhUpdateType::Rebuild) return test_fail("invalidate() didn't force a rebuild");
+
+    // Without refits, every change rebuilds, but unchanged structures are left alone
+    policy.allowRefit = false;
+    tracker = BvhUpdateTracker(policy);
+    tracker.onUpdated(BvhUpdateType::Rebuild, 10.0);
+    if (tracker.decide(false, true, 10.0) != BvhUpdateType::Rebuild) return test_fail("A refit was requested while refits are disabled");
+    if (tracker.decide(false, false) != BvhUpdateType::None) return test_fail("An update was requested with refits disabled and nothing changed");
+
+    // A limit of 0 disables each test
+    policy = BvhUpdateTracker::Policy();
+    policy.maxRefitCount = 0;
+    policy.maxCostGrowth = 0;
+    tracker = BvhUpdateTracker(policy);
+    tracker.onUpdated(BvhUpdateType::Rebuild, 1.0);
+    for (uint32_t i = 0; i < 1000; i++) tracker.onUpdated(BvhUpdateType::Refit, 1000.0);
+    if (tracker.decide(false, true, 1000.0) != BvhUpdateType::Refit) return test_fail("Disabled limits still rebuilt");
+    return test_pass();
+}
+
+testing_func(BvhUpdateTest, TestInstanceChanges)
+{
+    std::vector<InstanceChangeTracker::Instance> instances;
+    for (uint32_t i = 0; i < 100; i++) instances.push_back(createInstance(i));
+
+    InstanceChangeTracker tracker;
+    if (tracker.update(instances) == false || tracker.getDirtyInstances().size() != instances.size())
+    {
+        return test_fail("The first update must be a structure change with every instance dirty");
+    }
+    if (tracker.update(instances) || tracker.getDirtyInstances().empty() == false) return test_fail("Unchanged instances were reported dirty");
+
+    // Each kind of change dirties its instance. Writing the same values again doesn't.
+    instances[3].transform[3][1] = 1.0f;
+    instances[40].geometryId = 1000;
+    instances[41].flags = 1;
+    instances[99].transform[0][1] = 0.25f;
+    instances[50] = createInstance(50);
+    tracker.update(instances);
+    std::vector<uint32_t> expected = { 3, 40, 41, 99 };
+    if (tracker.getDirtyInstances() != expected) return test_fail("Dirty instances are " + toString(tracker.getDirtyInstances()) + ", expected " + toString(expected));
+
+    // The tracker keeps the new values, so the next frame compares against them
+    if (tracker.getInstances()[40].geometryId != 1000) return test_fail("The tracker didn't store the new values");
+    tracker.update(instances);
+    if (tracker.getDirtyInstances().empty() == false) return test_fail("Changes were reported twice");
+
+    // Adding an instance, or resetting, is a structure change
+    instances.push_back(createInstance(100));
+    if (tracker.update(instances) == false || tracker.getDirtyInstances().size() != instances.size()) return test_fail("Adding an instance isn't a structure change");
+    tracker.reset();
+    if (tracker.update(instances) == false) return test_fail("reset() didn't cause a structure change");
+
+    instances.clear();
+    if (tracker.update(instances) == false || tracker.getDirtyInstances().empty() == false) return test_fail("Removing all instances isn't handled");
+    return test_pass();
+}
+
+testing_func(BvhUpdateTest, TestDirtyRanges)
+{
+    std::vector<InstanceChangeTracker::Instance> instances;
+    for (uint32_t i = 0; i < 64; i++) instances.push_back(createInstance(i));
+    InstanceChangeTracker tracker;
+    tracker.update(instances);
+
+    // A single update's ranges cover exactly its dirty instances when gaps aren't merged
+    auto ranges = tracker.getDirtyRanges();
+    if (ranges.size() != 1 || ranges[0].first != 0 || ranges[0].count != 64) return test_fail("A structure change must be a single range");
+
+    for (uint32_t i : { 2u, 3u, 4u, 8u, 10u, 30u, 63u }) instances[i].flags = 1;
+    tracker.update(instances);
+
+    struct Expected
+    {
+        uint32_t maxGap;
+        std::vector<InstanceChangeTracker::Range> ranges;
+    };
+    const Expected cases[] =
+    {
+        { 0,  { { 2, 3 }, { 8, 1 }, { 10, 1 }, { 30, 1 }, { 63, 1 } } },
+        { 1,  { { 2, 3 }, { 8, 3 }, { 30, 1 }, { 63, 1 } } },
+        { 3,  { { 2, 9 }, { 30, 1 }, { 63, 1 } } },
+        { 19, { { 2, 29 }, { 63, 1 } } },
+        { 64, { { 2, 62 } } },
+    };
+    for (const auto& c : cases)
+    {
+        ranges = tracker.getDirtyRanges(c.maxGap);
+        bool match = ranges.size() == c.ranges.size();
+        for (size_t i = 0; match && i < ranges.size(); i++)
+        {
+            match = ranges[i].first == c.ranges[i].first && ranges[i].count == c.ranges[i].count;
+        }
+        if (match == false) return test_fail("Wrong ranges with a gap of " + std::to_string(c.maxGap));
+    }
+
+    tracker.update(instances);
+    if (tracker.getDirtyRanges(64).empty() == false) return test_fail("Clean instances produced ranges");
+    return test_pass();
+}
+
+testing_func(BvhUpdateTest, TestFullRefit)
+{
+    std::mt19937 rng(3);
+    std::vector<glm::vec3> boundsMin, boundsMax;
+    createRandomBoxes(rng, 100.0f, boundsMin, boundsMax);
+
+    // Subtrees are built in parallel and appended, which must still put children after their parents
+    Bvh bvh;
+    bvh.build(boundsMin.data(), boundsMax.data(), kBoxCount, Bvh::BuildDesc());
+    std::string error = checkTightBounds(bvh, boundsMin, boundsMax);
+    if (error.size()) return test_fail("After the build: " + error);
+
+    for (uint32_t i = 0; i < kBoxCount; i++) moveBox(rng, boundsMin[i], boundsMax[i]);
+    bvh.refit(boundsMin.data(), boundsMax.data());
+    error = checkTightBounds(bvh, boundsMin, boundsMax);
+    if (error.size()) return test_fail("After the refit: " + error);
+
+    // Refitting keeps the tree, and a rebuild over the moved boxes is at least as good
+    Bvh rebuilt;
+    rebuilt.build(boundsMin.data(), boundsMax.data(), kBoxCount, Bvh::BuildDesc());
+    if (rebuilt.computeSahCost() > bvh.computeSahCost() * 1.001) return test_fail("The rebuilt tree is worse than the refit one");
+    if (std::abs(rebuilt.computeSahCost() - rebuilt.getBuildStats().sahCost) > 1e-3 * rebuilt.getBuildStats().sahCost)
+    {
+        return test_fail("computeSahCost() doesn't match the cost reported by the build");
+    }
+    return test_pass();
+}
+
+testing_func(BvhUpdateTest, TestPartialRefit)
+{
+    std::mt19937 rng(4);
+    std::vector<glm::vec3> boundsMin, boundsMax;
+    createRandomBoxes(rng, 100.0f, boundsMin, boundsMax);
+
+    Bvh partial, full;
+    partial.build(boundsMin.data(), boundsMax.data(), kBoxCount, Bvh::BuildDesc());
+    full = partial;
+
+    // Over several frames, move a few boxes, some of them repeatedly, and compare the partial refit with a full one
+    std::uniform_int_distribution<uint32_t> box(0, kBoxCount - 1);
+    for (uint32_t frame = 0; frame < 10; frame++)
+    {
+        std::vector<uint32_t> changed;
+        for (uint32_t i = 0; i < 50; i++) changed.push_back(box(rng));
+        changed.push_back(frame);
+        for (uint32_t i : changed) moveBox(rng, boundsMin[i], boundsMax[i]);
+
+        partial.refit(boundsMin.data(), boundsMax.data(), changed.data(), (uint32_t)changed.size());
+        full.refit(boundsMin.data(), boundsMax.data());
+        if (haveSameBounds(partial, full) == false) return test_fail("The partial refit of frame " + std::to_string(frame) + " differs from a full refit");
+    }
+
+    std::string error = checkTightBounds(partial, boundsMin, boundsMax);
+    if (error.size()) return test_fail(error);
+
+    // An empty change list leaves the tree as it is
+    partial.refit(boundsMin.data(), boundsMax.data(), nullptr, 0);
+    if (haveSameBounds(partial, full) == false) return test_fail("A refit without changes modified the tree");
+    return test_pass();
+}
+
+testing_func(BvhUpdateTest, TestMeshRefitMatchesRebuild)
+{
+    TestMesh mesh(kGridSize);
+    mesh.animate(0);
+    auto pBvh = MeshBvh::create(&mesh.positions[0].x, sizeof(glm::vec3), mesh.indices.data(), mesh.getTriangleCount());
+    std::string error = compareHits(pBvh.get(), mesh);
+    if (error.size()) return test_fail("After the build: " + error);
+
+    // Smooth motion, like skinning, is refit. The hits match both brute force and a BVH built from scratch over the moved vertices.
+    for (uint32_t frame = 1; frame <= 4; frame++)
+    {
+        mesh.animate(0.1f * frame);
+        if (pBvh->update(&mesh.positions[0].x, sizeof(glm::vec3)) != BvhUpdateType::Refit) return test_fail("Smooth motion in frame " + std::to_string(frame) + " wasn't refit");
+        error = compareHits(pBvh.get(), mesh);
+        if (error.size()) return test_fail("After refit " + std::to_string(frame) + ": " + error);
+
+        auto pRebuilt = MeshBvh::create(&mesh.positions[0].x, sizeof(glm::vec3), mesh.indices.data(), mesh.getTriangleCount());
+        error = compareHits(pRebuilt.get(), mesh);
+        if (error.size()) return test_fail("The rebuilt BVH: " + error);
+    }
+    return test_pass();
+}
+
+testing_func(BvhUpdateTest, TestMeshRebuildOnDegradation)
+{
+    TestMesh mesh(kGridSize);
+    auto pBvh = MeshBvh::create(&mesh.positions[0].x, sizeof(glm::vec3), mesh.indices.data(), mesh.getTriangleCount());
+
+    // Scrambling the vertices degrades the refit tree far beyond the default cost growth limit, so the mesh is rebuilt
+    mesh.scramble();
+    if (pBvh->update(&mesh.positions[0].x, sizeof(glm::vec3)) != BvhUpdateType::Rebuild) return test_fail("Scrambled vertices didn't rebuild the tree");
+    std::string error = compareHits(pBvh.get(), mesh);
+    if (error.size()) return test_fail("After the rebuild: " + error);
+
+    // With the cost test disabled, going back to the wave is refit until the refit limit is reached
+    BvhUpdateTracker::Policy policy;
+    policy.maxRefitCount = 2;
+    policy.maxCostGrowth = 0;
+    pBvh->getUpdateTracker().setPolicy(policy);
+    BvhUpdateType expected[] = { BvhUpdateType::Refit, BvhUpdateType::Refit, BvhUpdateType::Rebuild, BvhUpdateType::Refit };
+    for (uint32_t frame = 0; frame < arraysize(expected); frame++)
+    {
+        mesh.animate(0.1f * frame);
+        BvhUpdateType type = pBvh->update(&mesh.positions[0].x, sizeof(glm::vec3));
+        if (type != expected[frame]) return test_fail("Frame " + std::to_string(frame) + " did a " + to_string(type) + ", expected a " + to_string(expected[frame]));
+        error = compareHits(pBvh.get(), mesh);
+        if (error.size()) return test_fail("Frame " + std::to_string(frame) + ": " + error);
+    }
+    return test_pass();
+}
+
+int main()
+{
+    BvhUpdateTest but;
+    but.init(false);
+    but.run();
+    return 0;
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+
+class BvhUpdateTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override;
+    register_testing_func(TestUpdateDecisions);
+    register_testing_func(TestInstanceChanges);
+    register_testing_func(TestDirtyRanges);
+    register_testing_func(TestFullRefit);
+    register_testing_func(TestPartialRefit);
+    register_testing_func(TestMeshRefitMatchesRebuild);
+    register_testing_func(TestMeshRebuildOnDegradation);
+
+    /** A grid of triangles which can be deformed, standing in for a skinned mesh
+    */
+    struct TestMesh
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+
+        TestMesh(uint32_t size);
+        uint32_t getTriangleCount() const { return (uint32_t)indices.size() / 3; }
+
+        /** Shape the grid as a wave. Changing the phase moves the vertices smoothly, as skinning does.
+        */
+        void animate(float phase);
+
+        /** Move the vertices to random places, which degrades a refit tree
+        */
+        void scramble();
+
+        /** Intersect a ray with every triangle
+        */
+        BvhHit intersectBruteForce(const BvhRay& ray) const;
+    };
+
+    /** Check that every node's bounds are exactly the union of its children's bounds, or of its primitives' bounds for leaves
+        \return An empty string on success, otherwise what's wrong
+    */
+    static std::string checkTightBounds(const Bvh& bvh, const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax);
+
+    /** Cast rays at a mesh through its BVH, and compare the closest hits with brute force
+        \return An empty string on success, otherwise the first mismatch
+    */
+    static std::string compareHits(const MeshBvh* pBvh, const TestMesh& mesh);
+};
@@ -0,0 +1,203 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "CpuSkinningTest.h"
+#include "TestHelper.h"
+#include "Data/VertexAttrib.h"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtx/transform.hpp"
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    const uint32_t kRepeatCount = 5;
+    const uint32_t kVertexCount = 3 * 100000;
+    const uint32_t kBoneCount = 64;
+
+    // Largest allowed difference between a skinned vertex and its reference, relative to the reference
+    const float kTolerance = 1e-3f;
+
+    float relativeDifference(float a, float b)
+    {
+        return std::abs(a - b) / std::max(1.0f, std::abs(b));
+    }
+
+    float maxDifference(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b)
+    {
+        float result = 0;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            for (uint32_t c = 0; c < 3; c++) result = std::max(result, relativeDifference(a[i][c], b[i][c]));
+        }
+        return result;
+    }
+
+    glm::quat randomRotation(std::mt19937& rng)
+    {
+        std::normal_distribution<float> normal;
+        return glm::normalize(glm::quat(normal(rng), normal(rng), normal(rng), normal(rng)));
+    }
+
+    // One bone matrix at a time with glm, like SkinningCache's shader
+    void skinReference(const CpuSkinning::MeshData& mesh, const glm::mat4* pBones, const glm::mat4* pBonesInvTranspose, std::vector<glm::vec3> result[3])
+    {
+        for (uint32_t v = 0; v < (uint32_t)mesh.positions.size(); v++)
+        {
+            uint32_t ids = mesh.boneIds[v];
+            const glm::vec4& w = mesh.boneWeights[v];
+            glm::mat4 boneMat = pBones[ids & 0xff] * w.x + pBones[(ids >> 8) & 0xff] * w.y + pBones[(ids >> 16) & 0xff] * w.z + pBones[ids >> 24] * w.w;
+            glm::mat4 invMat = pBonesInvTranspose[ids & 0xff] * w.x + pBonesInvTranspose[(ids >> 8) & 0xff] * w.y + pBonesInvTranspose[(ids >> 16) & 0xff] * w.z + pBonesInvTranspose[ids >> 24] * w.w;
+            result[0][v] = glm::vec3(boneMat * glm::vec4(mesh.positions[v], 1.0f));
+            result[1][v] = glm::mat3(invMat) * mesh.normals[v];
+            result[2][v] = glm::mat3(boneMat) * mesh.bitangents[v];
+        }
+    }
+}
+
+void CpuSkinningTest::addTests()
+{
+    addTestToList<TestSkin>();
+}
+
+void CpuSkinningTest::onInit()
+{
+}
+
+testing_func(CpuSkinningTest, TestSkin)
+{
+    Model::SharedPtr pModel = createSkinnedModel(kVertexCount, kBoneCount);
+    CpuSkinning::SharedPtr pSkinning = CpuSkinning::create(pModel.get());
+    if (pSkinning == nullptr || pSkinning->getMeshCount() != 1)
+    {
+        return test_fail("Can't create the skinning data of the model");
+    }
+
+    const CpuSkinning::MeshData& mesh = pSkinning->getMeshData(0);
+    std::vector<glm::vec3> reference[3], result[3];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        reference[i].resize(kVertexCount);
+        result[i].resize(kVertexCount);
+    }
+    CpuSkinning::Output output;
+    output.pPositions = &result[0][0].x;
+    output.pNormals = &result[1][0].x;
+    output.pBitangents = &result[2][0].x;
+
+    const glm::mat4* pBones = pModel->getBoneMatrices();
+    const glm::mat4* pBonesInvTranspose = pModel->getBoneInvTransposeMatrices();
+    double referenceMs = TestHelper::measureFastestMs(kRepeatCount, [&]() { skinReference(mesh, pBones, pBonesInvTranspose, reference); });
+    double serialMs = TestHelper::measureFastestMs(kRepeatCount, [&]() { pSkinning->skin(pModel.get(), &output, 1); });
+    float serialError = 0;
+    for (uint32_t i = 0; i < 3; i++) serialError = std::max(serialError, maxDifference(result[i], reference[i]));
+    double parallelMs = TestHelper::measureFastestMs(kRepeatCount, [&]() { pSkinning->skin(pModel.get(), &output); });
+    float parallelError = 0;
+    for (uint32_t i = 0; i < 3; i++) parallelError = std::max(parallelError, maxDifference(result[i], reference[i]));
+
+    if (std::max(serialError, parallelError) > kTolerance)
+    {
+        return test_fail("The skinned vertices differ from the reference by " + std::to_string(std::max(serialError, parallelError)));
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "CpuSkinning: " << kVertexCount << " vertices, " << kBoneCount << " bones. Reference " << TestHelper::toMillionsPerSecond(kVertexCount, referenceMs) << " Mverts/s, SIMD "
+       << TestHelper::toMillionsPerSecond(kVertexCount, serialMs) << " Mverts/s on 1 thread, " << TestHelper::toMillionsPerSecond(kVertexCount, parallelMs) << " Mverts/s on " << pSkinning->getStats().threadCount
+       << " threads. Max error " << std::scientific << std::setprecision(2) << std::max(serialError, parallelError);
+    logInfo(ss.str());
+    return test_pass();
+}
+
+Model::SharedPtr CpuSkinningTest::createSkinnedModel(uint32_t vertexCount, uint32_t boneCount)
+{
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<uint32_t> bone(0, boneCount - 1);
+    auto randomVector = [&]() { return glm::vec3(unit(rng), unit(rng), unit(rng)) * 2.0f - 1.0f; };
+
+    // Each vertex blends 4 random bones
+    std::vector<glm::vec3> positions(vertexCount), normals(vertexCount), bitangents(vertexCount);
+    std::vector<glm::vec4> weights(vertexCount);
+    std::vector<uint32_t> boneIds(vertexCount), indices(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        positions[v] = randomVector() * 10.0f;
+        normals[v] = glm::normalize(randomVector());
+        bitangents[v] = glm::normalize(randomVector());
+        weights[v] = glm::vec4(unit(rng), unit(rng), unit(rng), unit(rng)) + 0.01f;
+        weights[v] /= weights[v].x + weights[v].y + weights[v].z + weights[v].w;
+        boneIds[v] = bone(rng) | (bone(rng) << 8) | (bone(rng) << 16) | (bone(rng) << 24);
+        indices[v] = v;
+    }
+
+    // One vertex buffer per attribute, in the formats the importer creates
+    Vao::BufferVec vertexBuffers;
+    VertexLayout::SharedPtr pLayout = VertexLayout::create();
+    auto addAttribute = [&](const void* pData, uint32_t elementSize, const std::string& name, ResourceFormat format, uint32_t location)
+    {
+        VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+        pBufferLayout->addElement(name, 0, format, 1, location);
+        pLayout->addBufferLayout((uint32_t)vertexBuffers.size(), pBufferLayout);
+        vertexBuffers.push_back(Buffer::create(elementSize * vertexCount, Resource::BindFlags::Vertex, Buffer::CpuAccess::None, pData));
+    };
+    addAttribute(positions.data(), sizeof(glm::vec3), VERTEX_POSITION_NAME, ResourceFormat::RGB32Float, VERTEX_POSITION_LOC);
+    addAttribute(normals.data(), sizeof(glm::vec3), VERTEX_NORMAL_NAME, ResourceFormat::RGB32Float, VERTEX_NORMAL_LOC);
+    addAttribute(bitangents.data(), sizeof(glm::vec3), VERTEX_BITANGENT_NAME, ResourceFormat::RGB32Float, VERTEX_BITANGENT_LOC);
+    addAttribute(weights.data(), sizeof(glm::vec4), VERTEX_BONE_WEIGHT_NAME, ResourceFormat::RGBA32Float, VERTEX_BONE_WEIGHT_LOC);
+    addAttribute(boneIds.data(), sizeof(uint32_t), VERTEX_BONE_ID_NAME, ResourceFormat::RGBA8Uint, VERTEX_BONE_ID_LOC);
+    Buffer::SharedPtr pIndexBuffer = Buffer::create(sizeof(uint32_t) * vertexCount, Resource::BindFlags::Index, Buffer::CpuAccess::None, indices.data());
+
+    BoundingBox box = BoundingBox::fromMinMax(glm::vec3(-10.0f), glm::vec3(10.0f));
+    Mesh::SharedPtr pMesh = Mesh::create(vertexBuffers, vertexCount, pIndexBuffer, vertexCount, pLayout, Vao::Topology::TriangleList, Material::create("Skinned"), box, true);
+    Model::SharedPtr pModel = Model::create();
+    pModel->addMeshInstance(pMesh, glm::mat4());
+
+    // Root bones with random transforms
+    std::vector<Bone> bones(boneCount);
+    for (uint32_t i = 0; i < boneCount; i++)
+    {
+        bones[i].parentID = AnimationController::kInvalidBoneID;
+        bones[i].boneID = i;
+        bones[i].name = std::to_string(i);
+        bones[i].localTransform = glm::translate(randomVector()) * glm::mat4_cast(randomRotation(rng)) * glm::scale(glm::vec3(0.5f + unit(rng)));
+        bones[i].originalLocalTransform = bones[i].localTransform;
+    }
+    AnimationController::UniquePtr pController = AnimationController::create(bones);
+    pController->animate(0);
+    pModel->setAnimationController(std::move(pController));
+    return pModel;
+}
+
+int main()
+{
+    CpuSkinningTest cst;
+    cst.init(true);
+    cst.run();
+    return 0;
+}
@@ -0,0 +1,145 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "InstanceCullerTest.h"
+#include "glm/gtx/transform.hpp"
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    const uint32_t kFrameCount = 16;
+    const uint32_t kInstanceCount = 100000;
+    const float kMovedFraction = 0.1f;
+}
+
+void InstanceCullerTest::addTests()
+{
+    addTestToList<TestCulling>();
+}
+
+void InstanceCullerTest::onInit()
+{
+}
+
+testing_func(InstanceCullerTest, TestCulling)
+{
+    // Random boxes around the camera. Every frame, some of them move, and the bounds are updated from the transform store before culling.
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+    std::vector<glm::vec3> positions(kInstanceCount);
+    std::vector<BoundingBox> localBounds(kInstanceCount);
+    TransformStore::SharedPtr pStore = TransformStore::create();
+    for (uint32_t i = 0; i < kInstanceCount; i++)
+    {
+        positions[i] = glm::vec3(position(rng), position(rng), position(rng));
+        localBounds[i].center = glm::vec3(size(rng) - 1.0f, size(rng) - 1.0f, size(rng) - 1.0f);
+        localBounds[i].extent = glm::vec3(size(rng), size(rng), size(rng));
+        pStore->addNode(glm::translate(positions[i]));
+    }
+    pStore->update();
+
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setPosition(glm::vec3(0, 0, 0));
+    pCamera->setTarget(glm::vec3(0, 0, 1));
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    pCamera->setDepthRange(0.1f, 1000.0f);
+
+    auto getLocalBounds = [&](std::vector<BoundingBox>& bounds) { bounds = localBounds; };
+    InstanceCuller::SharedPtr pCuller = InstanceCuller::create();
+    InstanceCuller::SharedPtr pSerialCuller = InstanceCuller::create(1);
+    pCuller->updateBounds(pStore, 0, kInstanceCount, getLocalBounds);
+    pSerialCuller->updateBounds(pStore, 0, kInstanceCount, getLocalBounds);
+
+    const uint32_t movedCount = (uint32_t)(kInstanceCount * kMovedFraction);
+    double updateMs = 0, serialMs = 0, parallelMs = 0, referenceMs = 0;
+    uint32_t threadCount = 0;
+    uint64_t visibleCount = 0;
+    std::vector<uint32_t> reference;
+    reference.reserve(kInstanceCount);
+    for (uint32_t frame = 0; frame < kFrameCount; frame++)
+    {
+        // The moved instances advance through the instances from frame to frame
+        const uint32_t firstMoved = (frame * movedCount) % kInstanceCount;
+        for (uint32_t i = 0; i < movedCount; i++)
+        {
+            uint32_t instance = (firstMoved + i) % kInstanceCount;
+            pStore->setLocalMatrix(instance, glm::translate(positions[instance]) * glm::rotate(0.05f * (frame + 1) + instance, glm::vec3(0, 1, 0)));
+        }
+        pStore->update();
+
+        auto start = CpuTimer::getCurrentTimePoint();
+        uint32_t updatedCount = pCuller->updateBounds(pStore, 0, kInstanceCount, getLocalBounds);
+        updateMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        if (updatedCount != movedCount)
+        {
+            return test_fail("updateBounds() rewrote " + std::to_string(updatedCount) + " bounds, but " + std::to_string(movedCount) + " instances moved");
+        }
+        pSerialCuller->updateBounds(pStore, 0, kInstanceCount, getLocalBounds);
+
+        pSerialCuller->cull(pCamera.get());
+        serialMs += pSerialCuller->getStats().cullTimeMs;
+        pCuller->cull(pCamera.get());
+        parallelMs += pCuller->getStats().cullTimeMs;
+        threadCount = pCuller->getStats().threadCount;
+
+        // Reference: transform every box, and test it with the camera, one at a time
+        reference.clear();
+        start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kInstanceCount; i++)
+        {
+            if (pCamera->isObjectCulled(localBounds[i].transform(pStore->getWorldMatrix(i))) == false) reference.push_back(i);
+        }
+        referenceMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        visibleCount += reference.size();
+
+        if (pCuller->getVisibleInstances() != reference || pSerialCuller->getVisibleInstances() != reference)
+        {
+            return test_fail("The visible instances don't match Camera::isObjectCulled() in frame " + std::to_string(frame));
+        }
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "InstanceCuller: " << kInstanceCount << " instances (" << visibleCount / kFrameCount << " visible), " << movedCount << " moved per frame. Per frame: updateBounds "
+       << updateMs / kFrameCount << " ms, cull " << serialMs / kFrameCount << " ms on 1 thread, " << parallelMs / kFrameCount << " ms on " << threadCount << " threads. "
+       << "Reference (transform and Camera::isObjectCulled() one at a time) " << referenceMs / kFrameCount << " ms";
+    logInfo(ss.str());
+    return test_pass();
+}
+
+int main()
+{
+    InstanceCullerTest ict;
+    ict.init(true);
+    ict.run();
+    return 0;
+}
@@ -0,0 +1,190 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightStoreTest.h"
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    const uint32_t kFrameCount = 16;
+    const uint32_t kLightCounts[] = { 100, 1000, 10000, 100000 };
+    const float kMovedFraction = 0.01f;
+
+    /** Get the reflection of the gLights buffer, which ShaderCommon declares, as the renderers pass it to the store
+    */
+    ReflectionResourceType::SharedConstPtr getLightBufferType()
+    {
+        GraphicsProgram::SharedPtr pProgram = GraphicsProgram::createFromFile("RenderPasses/ForwardLightingPass.slang", "", "ps");
+        const ReflectionVar* pVar = pProgram->getReflector()->getDefaultParameterBlock()->getResource("gLights").get();
+        const ReflectionResourceType* pType = pVar ? pVar->getType()->unwrapArray()->asResourceType() : nullptr;
+        return pType ? pType->inherit_shared_from_this::shared_from_this() : nullptr;
+    }
+}
+
+void LightStoreTest::addTests()
+{
+    addTestToList<TestUpdate>();
+    addTestToList<TestSceneSync>();
+}
+
+void LightStoreTest::onInit()
+{
+}
+
+testing_func(LightStoreTest, TestUpdate)
+{
+    ReflectionResourceType::SharedConstPtr pType = getLightBufferType();
+    if (pType == nullptr)
+    {
+        return test_fail("Can't find the gLights buffer in the reflection of ForwardLightingPass");
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    for (uint32_t lightCount : kLightCounts)
+    {
+        std::mt19937 rng(lightCount);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_int_distribution<uint32_t> lightIndex(0, lightCount - 1);
+
+        std::vector<Light::SharedPtr> lights(lightCount);
+        std::vector<PointLight*> pointLights(lightCount);
+        for (uint32_t i = 0; i < lightCount; i++)
+        {
+            auto pLight = PointLight::create();
+            pLight->setWorldPosition(glm::vec3(position(rng), position(rng), position(rng)));
+            pointLights[i] = pLight.get();
+            lights[i] = pLight;
+        }
+
+        LightStore::SharedPtr pStore = LightStore::create(pType);
+        if (pStore == nullptr)
+        {
+            return test_fail("Can't create a light store for the gLights buffer");
+        }
+        auto start = CpuTimer::getCurrentTimePoint();
+        pStore->update(lights);
+        double createMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        const uint32_t movedCount = std::max(1u, (uint32_t)(lightCount * kMovedFraction));
+        std::vector<bool> moved(lightCount);
+        double compareMs = 0, uploadMs = 0;
+        uint64_t uploadedBytes = 0;
+        for (uint32_t frame = 0; frame < kFrameCount; frame++)
+        {
+            std::fill(moved.begin(), moved.end(), false);
+            uint32_t distinctCount = 0;
+            for (uint32_t i = 0; i < movedCount; i++)
+            {
+                uint32_t light = lightIndex(rng);
+                pointLights[light]->setWorldPosition(glm::vec3(position(rng), position(rng), position(rng)));
+                if (moved[light] == false) distinctCount++;
+                moved[light] = true;
+            }
+            pStore->update(lights);
+
+            // Only the moved lights are compared, and they all changed
+            const LightStore::UpdateStats& stats = pStore->getUpdateStats();
+            if (stats.comparedLightCount != distinctCount || stats.dirtyLightCount != distinctCount || pStore->getChangedLights().size() != distinctCount)
+            {
+                return test_fail(std::to_string(distinctCount) + " of " + std::to_string(lightCount) + " lights moved, but " + std::to_string(stats.comparedLightCount) + " were compared and " +
+                    std::to_string(stats.dirtyLightCount) + " changed");
+            }
+            compareMs += stats.compareTimeMs;
+            uploadMs += stats.uploadTimeMs;
+            uploadedBytes += stats.uploadedBytes;
+        }
+
+        ss << "LightStore: " << lightCount << " lights, " << movedCount << " moved per frame. First upload " << createMs << " ms, per frame: compare "
+           << compareMs / kFrameCount << " ms, upload " << uploadMs / kFrameCount << " ms (" << uploadedBytes / (1024.0 * kFrameCount) << " KB)\n";
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(LightStoreTest, TestSceneSync)
+{
+    ReflectionResourceType::SharedConstPtr pType = getLightBufferType();
+    if (pType == nullptr)
+    {
+        return test_fail("Can't find the gLights buffer in the reflection of ForwardLightingPass");
+    }
+
+    Scene::SharedPtr pScene = Scene::create();
+    for (uint32_t i = 0; i < 3; i++) pScene->addLight(PointLight::create());
+    const LightStore* pStore = pScene->createLightStore(pType).get();
+    if (pStore == nullptr || pStore->getLightCount() != 3 || pScene->isLightStoreCurrent() == false)
+    {
+        return test_fail("The store doesn't hold the scene's lights after it's created");
+    }
+
+    // Lights added after update() are only uploaded by the next update(), or by syncLightStore() which the renderers call before binding gLights
+    pScene->addLight(PointLight::create());
+    if (pScene->isLightStoreCurrent())
+    {
+        return test_fail("The store is reported as current after a light was added");
+    }
+    pScene->syncLightStore();
+    if (pStore->getLightCount() != 4 || pScene->isLightStoreCurrent() == false || pStore->getChangedLights() != std::vector<uint32_t>{ 3 })
+    {
+        return test_fail("syncLightStore() didn't upload the added light");
+    }
+
+    // Replacing a light keeps the count, so the store has to track the changes to the light list rather than compare counts
+    auto pReplacement = PointLight::create();
+    pReplacement->setWorldPosition(glm::vec3(1, 2, 3));
+    pScene->deleteLight(0);
+    pScene->addLight(pReplacement);
+    if (pScene->isLightStoreCurrent())
+    {
+        return test_fail("The store is reported as current after a light was replaced");
+    }
+    pScene->syncLightStore();
+    if (pStore->getLightCount() != 4 || pStore->getChangedLights().empty() || pStore->getChangedLights().back() != 3)
+    {
+        return test_fail("syncLightStore() didn't upload the replaced light");
+    }
+
+    // Nothing to do when the store is current
+    uint64_t version = pStore->getVersion();
+    pScene->syncLightStore();
+    if (pStore->getVersion() != version)
+    {
+        return test_fail("syncLightStore() updated a store which was current");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    LightStoreTest lst;
+    lst.init(true);
+    lst.run();
+    return 0;
+}
@@ -0,0 +1,299 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MeshOptimizerTest.h"
+#include "TestHelper.h"
+#include "Utils/MeshOptimizer.h"
+#include "Graphics/Bvh/MeshBvh.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    // Relative to the directory given by SCENE_DATA_DIR, which the project sets to CommonPasses/Data
+    const char* kScenes[] =
+    {
+        "Scenes/pink_room/pink_room.fscene",
+        "Scenes/forest/forest.fscene",
+        "Scenes/Purple_Bedroom_Scene/purple_bedroom.fscene",
+        "Scenes/Bistro_Scene/bistro.fscene",
+        "Scenes/Sun_Temple_Scene/SunTemple.fscene",
+    };
+
+    struct TestMesh
+    {
+        std::string name;
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    TestMesh createGrid(uint32_t size)
+    {
+        TestMesh mesh;
+        mesh.name = "grid " + std::to_string(size) + "x" + std::to_string(size);
+        for (uint32_t z = 0; z <= size; z++)
+        {
+            for (uint32_t x = 0; x <= size; x++) mesh.positions.push_back(glm::vec3(float(x), 0, float(z)));
+        }
+        for (uint32_t z = 0; z < size; z++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                uint32_t v = z * (size + 1) + x;
+                mesh.indices.insert(mesh.indices.end(), { v, v + size + 1, v + 1, v + 1, v + size + 1, v + size + 2 });
+            }
+        }
+        return mesh;
+    }
+
+    TestMesh createSphere(uint32_t rings, uint32_t segments)
+    {
+        TestMesh mesh;
+        mesh.name = "sphere " + std::to_string(rings * segments * 2) + " triangles";
+        for (uint32_t r = 0; r <= rings; r++)
+        {
+            float theta = (float)M_PI * r / rings;
+            for (uint32_t s = 0; s <= segments; s++)
+            {
+                float phi = 2.0f * (float)M_PI * s / segments;
+                mesh.positions.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+            }
+        }
+        for (uint32_t r = 0; r < rings; r++)
+        {
+            for (uint32_t s = 0; s < segments; s++)
+            {
+                uint32_t v = r * (segments + 1) + s;
+                mesh.indices.insert(mesh.indices.end(), { v, v + 1, v + segments + 1, v + 1, v + segments + 2, v + segments + 1 });
+            }
+        }
+        return mesh;
+    }
+
+    /** Shuffle the triangles and the vertices, like a mesh exported without any optimization
+    */
+    TestMesh shuffle(TestMesh mesh)
+    {
+        std::mt19937 rng(1);
+        uint32_t triangleCount = (uint32_t)mesh.indices.size() / 3;
+        std::vector<uint32_t> order(triangleCount);
+        for (uint32_t t = 0; t < triangleCount; t++) order[t] = t;
+        std::shuffle(order.begin(), order.end(), rng);
+        std::vector<uint32_t> vertexOrder(mesh.positions.size());
+        for (uint32_t v = 0; v < (uint32_t)vertexOrder.size(); v++) vertexOrder[v] = v;
+        std::shuffle(vertexOrder.begin(), vertexOrder.end(), rng);
+
+        TestMesh shuffled;
+        shuffled.name = "shuffled " + mesh.name;
+        shuffled.positions.resize(mesh.positions.size());
+        for (size_t v = 0; v < mesh.positions.size(); v++) shuffled.positions[vertexOrder[v]] = mesh.positions[v];
+        for (uint32_t t : order)
+        {
+            for (uint32_t i = 0; i < 3; i++) shuffled.indices.push_back(vertexOrder[mesh.indices[t * 3 + i]]);
+        }
+        return shuffled;
+    }
+
+    /** Get the triangles as a sorted list of positions, each rotated to start at its smallest vertex so the winding is kept.
+        This doesn't depend on the triangle order or on the vertex numbering.
+    */
+    std::vector<std::array<float, 9>> getTriangleSet(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+    {
+        std::vector<std::array<float, 9>> triangles(indices.size() / 3);
+        for (size_t t = 0; t < triangles.size(); t++)
+        {
+            std::array<std::array<float, 3>, 3> corners;
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                const glm::vec3& p = positions[indices[t * 3 + i]];
+                corners[i] = { p.x, p.y, p.z };
+            }
+            uint32_t first = (uint32_t)(std::min_element(corners.begin(), corners.end()) - corners.begin());
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                for (uint32_t c = 0; c < 3; c++) triangles[t][i * 3 + c] = corners[(first + i) % 3][c];
+            }
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    /** Run the full optimization, the way AssimpModelImporter does, and apply the remap table to the positions
+        \return false if the remap table isn't a permutation
+    */
+    bool optimize(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+    {
+        const uint32_t vertexCount = (uint32_t)positions.size();
+        MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+        MeshOptimizer::optimizeOverdraw(indices.data(), indices.size(), &positions[0].x, sizeof(glm::vec3), vertexCount);
+        std::vector<uint32_t> remap;
+        MeshOptimizer::optimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+
+        std::vector<glm::vec3> remapped(vertexCount);
+        std::vector<bool> used(vertexCount, false);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            if (remap[v] >= vertexCount || used[remap[v]]) return false;
+            used[remap[v]] = true;
+            remapped[remap[v]] = positions[v];
+        }
+        positions.swap(remapped);
+        return true;
+    }
+
+    /** Check that the vertices are numbered in the order the triangles first use them
+    */
+    bool isFetchOrdered(const std::vector<uint32_t>& indices)
+    {
+        uint32_t next = 0;
+        for (uint32_t i : indices)
+        {
+            if (i > next) return false;
+            if (i == next) next++;
+        }
+        return true;
+    }
+}
+
+void MeshOptimizerTest::addTests()
+{
+    addTestToList<TestGeneratedMeshes>();
+    addTestToList<TestScenes>();
+}
+
+void MeshOptimizerTest::onInit()
+{
+    addDataDirectory(SCENE_DATA_DIR);
+}
+
+testing_func(MeshOptimizerTest, TestGeneratedMeshes)
+{
+    struct Case
+    {
+        TestMesh mesh;
+        float maxAcmr;      ///< Largest allowed ACMR after the optimization
+    };
+    const TestMesh grid = createGrid(256);
+    const TestMesh sphere = createSphere(128, 256);
+    const Case cases[] = { { grid, 0.75f }, { shuffle(grid), 0.75f }, { sphere, 0.75f }, { shuffle(sphere), 0.75f } };
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "MeshOptimizer: ACMR and ATVR with a " << MeshOptimizer::kDefaultCacheSize << "-entry FIFO cache\n";
+    for (const Case& c : cases)
+    {
+        std::vector<glm::vec3> positions = c.mesh.positions;
+        std::vector<uint32_t> indices = c.mesh.indices;
+        const uint32_t vertexCount = (uint32_t)positions.size();
+        const uint32_t triangleCount = (uint32_t)indices.size() / 3;
+        MeshOptimizer::CacheStats before = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+        bool isPermutation = true;
+        double ms = TestHelper::measureFastestMs(1, [&]() { isPermutation = optimize(positions, indices); });
+        if (isPermutation == false) return test_fail(c.mesh.name + ": the vertex remap table isn't a permutation");
+        MeshOptimizer::CacheStats after = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+        if (getTriangleSet(positions, indices) != getTriangleSet(c.mesh.positions, c.mesh.indices))
+        {
+            return test_fail(c.mesh.name + ": the optimized mesh has different triangles");
+        }
+        if (isFetchOrdered(indices) == false) return test_fail(c.mesh.name + ": the vertices aren't in first-use order");
+        if (after.acmr > c.maxAcmr || after.acmr > before.acmr)
+        {
+            return test_fail(c.mesh.name + ": the ACMR went from " + std::to_string(before.acmr) + " to " + std::to_string(after.acmr));
+        }
+        ss << "  " << c.mesh.name << ": ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << ", "
+           << std::setprecision(1) << TestHelper::toMillionsPerSecond(triangleCount, ms) << " Mtri/s" << std::setprecision(3) << "\n";
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestScenes)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    for (const char* scene : kScenes)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(scene, fullpath) == false || TestHelper::hasSceneModels(fullpath) == false)
+        {
+            ss << "MeshOptimizer: " << scene << " skipped, its models aren't there\n";
+            continue;
+        }
+
+        // Load the meshes as Assimp orders them, and run the optimization on the copies read back from the GPU
+        Scene::SharedPtr pScene = Scene::loadFromFile(fullpath, Model::LoadFlags::DontOptimizeMeshes);
+        if (pScene == nullptr) return test_fail(std::string("Can't load ") + scene);
+
+        uint64_t triangles = 0, vertices = 0, transformedBefore = 0, transformedAfter = 0;
+        double ms = 0;
+        for (uint32_t m = 0; m < pScene->getModelCount(); m++)
+        {
+            const Model* pModel = pScene->getModel(m).get();
+            for (uint32_t i = 0; i < pModel->getMeshCount(); i++)
+            {
+                std::vector<glm::vec3> positions;
+                std::vector<uint32_t> indices;
+                if (MeshBvh::readMeshGeometry(pModel->getMesh(i).get(), positions, indices) == false) continue;
+                const uint32_t vertexCount = (uint32_t)positions.size();
+                std::vector<glm::vec3> originalPositions = positions;
+                std::vector<uint32_t> originalIndices = indices;
+
+                transformedBefore += MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertexCount).transformedVertices;
+                bool isPermutation = true;
+                ms += TestHelper::measureFastestMs(1, [&]() { isPermutation = optimize(positions, indices); });
+                transformedAfter += MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertexCount).transformedVertices;
+                if (isPermutation == false || getTriangleSet(positions, indices) != getTriangleSet(originalPositions, originalIndices))
+                {
+                    return test_fail(std::string(scene) + ": the optimization changed the triangles of mesh " + std::to_string(i) + " of model " + std::to_string(m));
+                }
+                triangles += indices.size() / 3;
+                vertices += vertexCount;
+            }
+        }
+        if (triangles == 0) return test_fail(std::string(scene) + " has no indexed triangle meshes");
+        if (transformedAfter > transformedBefore) return test_fail(std::string(scene) + ": the optimization made the cache efficiency worse");
+
+        ss << "MeshOptimizer: " << scene << ", " << triangles << " triangles: ACMR " << double(transformedBefore) / triangles << " -> " << double(transformedAfter) / triangles
+           << ", ATVR " << double(transformedBefore) / vertices << " -> " << double(transformedAfter) / vertices << ", " << std::setprecision(1)
+           << TestHelper::toMillionsPerSecond(triangles, ms) << " Mtri/s" << std::setprecision(3) << "\n";
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+int main()
+{
+    MeshOptimizerTest mot;
+    mot.init(true);
+    mot.run();
+    return 0;
+}
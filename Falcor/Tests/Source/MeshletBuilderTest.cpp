@@ -0,0 +1,305 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MeshletBuilderTest.h"
+#include "TestHelper.h"
+#include "Utils/MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    // Relative to the directory given by SCENE_DATA_DIR, which the project sets to CommonPasses/Data
+    const char* kScenes[] =
+    {
+        "Scenes/pink_room/pink_room.fscene",
+        "Scenes/forest/forest.fscene",
+        "Scenes/Purple_Bedroom_Scene/purple_bedroom.fscene",
+        "Scenes/Bistro_Scene/bistro.fscene",
+        "Scenes/Sun_Temple_Scene/SunTemple.fscene",
+    };
+
+    const float kEpsilon = 1e-4f;
+
+    struct TestMesh
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    /** A unit sphere with outward-facing triangles, ordered for the vertex cache like the importer does
+    */
+    TestMesh createSphere(uint32_t rings, uint32_t segments)
+    {
+        TestMesh mesh;
+        for (uint32_t r = 0; r <= rings; r++)
+        {
+            float theta = (float)M_PI * r / rings;
+            for (uint32_t s = 0; s <= segments; s++)
+            {
+                float phi = 2.0f * (float)M_PI * s / segments;
+                mesh.positions.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+            }
+        }
+        for (uint32_t r = 0; r < rings; r++)
+        {
+            for (uint32_t s = 0; s < segments; s++)
+            {
+                uint32_t v = r * (segments + 1) + s;
+                if (r > 0) mesh.indices.insert(mesh.indices.end(), { v, v + 1, v + segments + 1 });
+                if (r < rings - 1) mesh.indices.insert(mesh.indices.end(), { v + 1, v + segments + 2, v + segments + 1 });
+            }
+        }
+        MeshOptimizer::optimizeVertexCache(mesh.indices.data(), mesh.indices.size(), (uint32_t)mesh.positions.size());
+        return mesh;
+    }
+
+    glm::vec3 getNormal(const TestMesh& mesh, uint32_t triangle)
+    {
+        const glm::vec3& p0 = mesh.positions[mesh.indices[triangle * 3 + 0]];
+        const glm::vec3& p1 = mesh.positions[mesh.indices[triangle * 3 + 1]];
+        const glm::vec3& p2 = mesh.positions[mesh.indices[triangle * 3 + 2]];
+        return glm::cross(p1 - p0, p2 - p0);
+    }
+
+    bool isTriangleBackfacing(const TestMesh& mesh, uint32_t triangle, const glm::vec3& viewPosition)
+    {
+        return glm::dot(glm::normalize(getNormal(mesh, triangle)), viewPosition - mesh.positions[mesh.indices[triangle * 3]]) <= kEpsilon;
+    }
+
+    /** Check that a built mesh is a permutation of the original triangles, and that the meshlets describe it
+    */
+    std::string validate(const TestMesh& original, const TestMesh& mesh, const MeshletData& data, const MeshletBuilder::Desc& desc)
+    {
+        std::vector<std::array<uint32_t, 3>> before(original.indices.size() / 3), after(mesh.indices.size() / 3);
+        auto rotate = [](const uint32_t* pTriangle)
+        {
+            uint32_t first = (uint32_t)(std::min_element(pTriangle, pTriangle + 3) - pTriangle);
+            return std::array<uint32_t, 3>{ pTriangle[first], pTriangle[(first + 1) % 3], pTriangle[(first + 2) % 3] };
+        };
+        for (size_t t = 0; t < before.size(); t++) before[t] = rotate(&original.indices[t * 3]);
+        for (size_t t = 0; t < after.size(); t++) after[t] = rotate(&mesh.indices[t * 3]);
+        std::sort(before.begin(), before.end());
+        std::sort(after.begin(), after.end());
+        if (before != after) return "the triangles changed";
+        if (desc.keepTriangleOrder && mesh.indices != original.indices) return "the triangle order changed";
+
+        uint32_t nextTriangle = 0;
+        for (size_t m = 0; m < data.meshlets.size(); m++)
+        {
+            const Meshlet& meshlet = data.meshlets[m];
+            const std::string name = "meshlet " + std::to_string(m);
+            if (meshlet.triangleOffset != nextTriangle) return name + " doesn't start after the previous one";
+            if (meshlet.triangleCount == 0 || meshlet.triangleCount > desc.maxTriangles || meshlet.vertexCount > desc.maxVertices) return name + " breaks the limits";
+            nextTriangle += meshlet.triangleCount;
+
+            for (uint32_t t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; t++)
+            {
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    uint8_t local = data.triangles[t * 3 + i];
+                    if (local >= meshlet.vertexCount || data.vertices[meshlet.vertexOffset + local] != mesh.indices[t * 3 + i]) return name + " doesn't match the index buffer";
+                }
+            }
+            for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+            {
+                const glm::vec3& p = mesh.positions[data.vertices[meshlet.vertexOffset + i]];
+                glm::vec3 boxMin = meshlet.bounds.center - meshlet.bounds.extent - kEpsilon;
+                glm::vec3 boxMax = meshlet.bounds.center + meshlet.bounds.extent + kEpsilon;
+                if (p.x < boxMin.x || p.y < boxMin.y || p.z < boxMin.z || p.x > boxMax.x || p.y > boxMax.y || p.z > boxMax.z) return name + " has a vertex outside its box";
+                if (glm::length(p - meshlet.sphereCenter) > meshlet.sphereRadius + kEpsilon) return name + " has a vertex outside its sphere";
+            }
+        }
+        if (nextTriangle * 3 != mesh.indices.size()) return "the meshlets don't cover the mesh";
+        return "";
+    }
+}
+
+void MeshletBuilderTest::addTests()
+{
+    addTestToList<TestBuild>();
+    addTestToList<TestBackfaceCulling>();
+    addTestToList<TestCameraCulling>();
+    addTestToList<TestSceneCulling>();
+}
+
+void MeshletBuilderTest::onInit()
+{
+    addDataDirectory(SCENE_DATA_DIR);
+}
+
+testing_func(MeshletBuilderTest, TestBuild)
+{
+    const TestMesh sphere = createSphere(256, 512);
+    const uint32_t triangleCount = (uint32_t)sphere.indices.size() / 3;
+
+    MeshletBuilder::Desc descs[3];
+    descs[1].keepTriangleOrder = true;
+    descs[2].maxVertices = 128;
+    descs[2].maxTriangles = 256;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    for (const MeshletBuilder::Desc& desc : descs)
+    {
+        TestMesh mesh;
+        MeshletData data;
+        double ms = TestHelper::measureFastestMs(3, [&]()
+        {
+            mesh = sphere;
+            MeshletBuilder::build(mesh.indices.data(), mesh.indices.size(), &mesh.positions[0].x, sizeof(glm::vec3), (uint32_t)mesh.positions.size(), desc, data);
+        });
+
+        const std::string config = std::to_string(desc.maxVertices) + "/" + std::to_string(desc.maxTriangles) + (desc.keepTriangleOrder ? " keeping the triangle order" : "");
+        std::string error = validate(sphere, mesh, data, desc);
+        if (error.size()) return test_fail(config + ": " + error);
+
+        ss << "MeshletBuilder " << config << ": " << triangleCount << " triangles in " << data.meshlets.size() << " meshlets, "
+           << double(triangleCount) / data.meshlets.size() << " triangles and " << double(data.vertices.size()) / data.meshlets.size() << " vertices per meshlet, "
+           << TestHelper::toMillionsPerSecond(triangleCount, ms) << " Mtri/s\n";
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(MeshletBuilderTest, TestBackfaceCulling)
+{
+    const TestMesh sphere = createSphere(256, 512);
+    const uint32_t triangleCount = (uint32_t)sphere.indices.size() / 3;
+    MeshletBuilder::Desc descs[2];
+    descs[1].keepTriangleOrder = true;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    for (const MeshletBuilder::Desc& desc : descs)
+    {
+        TestMesh mesh = sphere;
+        MeshletData data;
+        MeshletBuilder::build(mesh.indices.data(), mesh.indices.size(), &mesh.positions[0].x, sizeof(glm::vec3), (uint32_t)mesh.positions.size(), desc, data);
+
+        // Look at the sphere from random points, close and far. Culling a meshlet with a triangle facing the viewer is an error;
+        // the efficiency is the share of the back-facing triangles which the cones remove.
+        std::mt19937 rng(1);
+        std::normal_distribution<float> normal;
+        std::uniform_real_distribution<float> distance(1.1f, 20.0f);
+        uint64_t backfacing = 0, culled = 0;
+        const uint32_t kViewCount = 64;
+        for (uint32_t v = 0; v < kViewCount; v++)
+        {
+            glm::vec3 viewPosition = glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng))) * distance(rng);
+            for (uint32_t t = 0; t < triangleCount; t++) backfacing += isTriangleBackfacing(mesh, t, viewPosition) ? 1 : 0;
+            for (const Meshlet& meshlet : data.meshlets)
+            {
+                if (MeshletBuilder::isBackfacing(meshlet, viewPosition) == false) continue;
+                culled += meshlet.triangleCount;
+                for (uint32_t t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; t++)
+                {
+                    if (isTriangleBackfacing(mesh, t, viewPosition) == false) return test_fail("A meshlet with a front-facing triangle was culled");
+                }
+            }
+        }
+
+        double efficiency = 100.0 * double(culled) / double(backfacing);
+        if (efficiency < 50) return test_fail("The normal cones remove only " + std::to_string(efficiency) + "% of the back-facing triangles");
+        ss << "MeshletBuilder back-face culling" << (desc.keepTriangleOrder ? ", keeping the triangle order" : "") << ": the cones remove "
+           << efficiency << "% of the back-facing triangles, " << 100.0 * double(culled) / (double(triangleCount) * kViewCount) << "% of all triangles\n";
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(MeshletBuilderTest, TestCameraCulling)
+{
+    TestMesh mesh = createSphere(256, 512);
+    const uint32_t triangleCount = (uint32_t)mesh.indices.size() / 3;
+    MeshletData data;
+    MeshletBuilder::build(mesh.indices.data(), mesh.indices.size(), &mesh.positions[0].x, sizeof(glm::vec3), (uint32_t)mesh.positions.size(), MeshletBuilder::Desc(), data);
+
+    // Close enough that the sphere fills the view and part of it is outside the frustum
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setPosition(glm::vec3(0, 0, 1.5f));
+    pCamera->setTarget(glm::vec3(0, 0, 0));
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+    pCamera->setAspectRatio(16.0f / 9.0f);
+    pCamera->setDepthRange(0.1f, 100.0f);
+
+    const glm::mat4 worldMat;
+    uint64_t left = 0, backfaceOnly = 0;
+    double ms = TestHelper::measureFastestMs(10, [&]()
+    {
+        left = 0;
+        backfaceOnly = 0;
+        for (const Meshlet& meshlet : data.meshlets)
+        {
+            if (MeshletBuilder::isCulled(meshlet, worldMat, pCamera->getPosition(), pCamera.get(), true) == false) left += meshlet.triangleCount;
+            if (MeshletBuilder::isBackfacing(meshlet, pCamera->getPosition()) == false) backfaceOnly += meshlet.triangleCount;
+        }
+    });
+
+    // The whole sphere passes instance culling, so everything meshlet culling removes is saved
+    if (left >= backfaceOnly || left == 0) return test_fail("Frustum culling of meshlets didn't remove anything");
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "MeshletBuilder camera culling: " << 100.0 * double(left) / triangleCount << "% of the triangles left, " << 100.0 * double(backfaceOnly) / triangleCount
+       << "% with back-face culling alone, " << TestHelper::toMillionsPerSecond(data.meshlets.size(), ms) << " M meshlets/s";
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(MeshletBuilderTest, TestSceneCulling)
+{
+    for (const char* scene : kScenes)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(scene, fullpath) == false || TestHelper::hasSceneModels(fullpath) == false)
+        {
+            logInfo(std::string("MeshletBuilder: ") + scene + " skipped, its models aren't there");
+            continue;
+        }
+
+        Scene::SharedPtr pScene = Scene::loadFromFile(fullpath, Model::LoadFlags::GenerateMeshlets);
+        if (pScene == nullptr) return test_fail(std::string("Can't load ") + scene);
+        const Camera* pCamera = pScene->getActiveCamera().get();
+        if (pCamera == nullptr) continue;
+
+        MeshletBuilder::CullStats stats = MeshletBuilder::evaluateCulling(pScene.get(), pCamera);
+        if (stats.trianglesAfterMeshletCulling > stats.trianglesAfterObjectCulling) return test_fail(std::string(scene) + ": meshlet culling added triangles");
+        logInfo(std::string(scene) + ", from its camera: " + MeshletBuilder::getCullStatsString(stats));
+    }
+    return test_pass();
+}
+
+int main()
+{
+    MeshletBuilderTest mbt;
+    mbt.init(true);
+    mbt.run();
+    return 0;
+}
@@ -0,0 +1,221 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MipGeneratorTest.h"
+#include "TestHelper.h"
+#include "Utils/MipGenerator.h"
+#include "Utils/ParallelFor.h"
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    const uint32_t kThroughputSize = 2048;
+    const uint32_t kRepeatCount = 3;
+
+    struct FilterDesc
+    {
+        const char* name;
+        MipGenerator::Filter filter;
+    };
+    const FilterDesc kFilters[] = { { "box", MipGenerator::Filter::Box }, { "Kaiser", MipGenerator::Filter::Kaiser } };
+
+    std::vector<uint8_t> createNoiseImage(uint32_t width, uint32_t height)
+    {
+        std::mt19937 rng(width + height);
+        std::vector<uint8_t> texels((size_t)width * height * 4);
+        for (auto& t : texels) t = (uint8_t)rng();
+        return texels;
+    }
+
+    uint64_t getChainSize(uint32_t width, uint32_t height, uint32_t bytesPerTexel)
+    {
+        uint64_t size = 0;
+        for (uint32_t m = 0; m < MipGenerator::getMipCount(width, height); m++)
+        {
+            size += (uint64_t)std::max(1u, width >> m) * std::max(1u, height >> m) * bytesPerTexel;
+        }
+        return size;
+    }
+}
+
+void MipGeneratorTest::addTests()
+{
+    addTestToList<TestChainLayout>();
+    addTestToList<TestFiltering>();
+    addTestToList<TestThreadCountInvariance>();
+    addTestToList<TestThroughput>();
+}
+
+void MipGeneratorTest::onInit()
+{
+}
+
+testing_func(MipGeneratorTest, TestChainLayout)
+{
+    // Non-square and non-power-of-two sizes, down to a single texel
+    const uint32_t sizes[][2] = { { 1, 1 }, { 256, 256 }, { 300, 17 }, { 1, 64 }, { 1023, 513 } };
+    for (const auto& size : sizes)
+    {
+        uint32_t expectedMips = 1 + (uint32_t)std::floor(std::log2((float)std::max(size[0], size[1])));
+        if (MipGenerator::getMipCount(size[0], size[1]) != expectedMips)
+        {
+            return test_fail("Wrong mip count for " + std::to_string(size[0]) + "x" + std::to_string(size[1]));
+        }
+
+        std::vector<uint8_t> image = createNoiseImage(size[0], size[1]);
+        std::vector<uint8_t> chain;
+        if (MipGenerator::generate(image.data(), size[0], size[1], ResourceFormat::RGBA8UnormSrgb, MipGenerator::Filter::Box, chain) == false)
+        {
+            return test_fail("RGBA8UnormSrgb isn't supported");
+        }
+        if (chain.size() != getChainSize(size[0], size[1], 4) || std::memcmp(chain.data(), image.data(), image.size()) != 0)
+        {
+            return test_fail("The chain for " + std::to_string(size[0]) + "x" + std::to_string(size[1]) + " doesn't start with level 0 or has the wrong size");
+        }
+    }
+
+    std::vector<uint8_t> chain;
+    uint8_t texel[16] = {};
+    if (MipGenerator::isFormatSupported(ResourceFormat::BC1Unorm) || MipGenerator::generate(texel, 2, 2, ResourceFormat::BC1Unorm, MipGenerator::Filter::Box, chain))
+    {
+        return test_fail("A block-compressed format was accepted");
+    }
+    return test_pass();
+}
+
+testing_func(MipGeneratorTest, TestFiltering)
+{
+    // A black and white checkerboard averages to 50% gray in linear space, which is 188 in sRGB and 128 (rounded) in linear formats
+    const uint32_t size = 64;
+    std::vector<uint8_t> checker((size_t)size * size * 4);
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint8_t value = ((x + y) & 1) ? 255 : 0;
+            for (int c = 0; c < 3; c++) checker[(y * size + x) * 4 + c] = value;
+            checker[(y * size + x) * 4 + 3] = 255;
+        }
+    }
+    struct { ResourceFormat format; int expected; } cases[] = { { ResourceFormat::RGBA8UnormSrgb, 188 }, { ResourceFormat::RGBA8Unorm, 128 } };
+    for (const auto& c : cases)
+    {
+        std::vector<uint8_t> chain;
+        MipGenerator::generate(checker.data(), size, size, c.format, MipGenerator::Filter::Box, chain);
+        size_t level1 = (size_t)size * size * 4;
+        for (size_t i = level1; i < chain.size(); i += 4)
+        {
+            if (std::abs(int(chain[i]) - c.expected) > 1 || chain[i + 3] != 255)
+            {
+                return test_fail("The box filter of a checkerboard gave " + std::to_string(chain[i]) + " in " + to_string(c.format) + ", expected " + std::to_string(c.expected));
+            }
+        }
+    }
+
+    // A constant image stays constant with both filters, in a float format where the Kaiser filter's ringing isn't clamped
+    const glm::vec4 constant(0.25f, 2.0f, -1.0f, 0.5f);
+    std::vector<glm::vec4> flat((size_t)size * size, constant);
+    for (const FilterDesc& filter : kFilters)
+    {
+        std::vector<uint8_t> chain;
+        MipGenerator::generate(flat.data(), size, size, ResourceFormat::RGBA32Float, filter.filter, chain);
+        const glm::vec4* pTexels = (const glm::vec4*)chain.data();
+        for (size_t i = 0; i < chain.size() / sizeof(glm::vec4); i++)
+        {
+            glm::vec4 d = glm::abs(pTexels[i] - constant);
+            if (std::max(std::max(d.x, d.y), std::max(d.z, d.w)) > 1e-5f)
+            {
+                return test_fail(std::string("The ") + filter.name + " filter changed a constant image");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(MipGeneratorTest, TestThreadCountInvariance)
+{
+    // The tiles a level is split into mustn't show in the result
+    std::vector<uint8_t> image = createNoiseImage(517, 1030);
+    for (const FilterDesc& filter : kFilters)
+    {
+        std::vector<uint8_t> reference;
+        MipGenerator::generate(image.data(), 517, 1030, ResourceFormat::RGBA8UnormSrgb, filter.filter, reference, 1);
+        const uint32_t threadCounts[] = { 2, 3, 0 };
+        for (uint32_t threadCount : threadCounts)
+        {
+            std::vector<uint8_t> chain;
+            MipGenerator::generate(image.data(), 517, 1030, ResourceFormat::RGBA8UnormSrgb, filter.filter, chain, threadCount);
+            if (chain != reference)
+            {
+                return test_fail(std::string("The ") + filter.name + " filter gives a different chain with " + std::to_string(threadCount) + " threads");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(MipGeneratorTest, TestThroughput)
+{
+    // Throughput is counted in texels of level 0, like createTexturesFromFiles() logs it
+    const uint32_t poolThreads = WorkerPool::get().getThreadCount();
+    const uint64_t texelCount = (uint64_t)kThroughputSize * kThroughputSize;
+    std::vector<uint8_t> image8 = createNoiseImage(kThroughputSize, kThroughputSize);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> hdr(0.0f, 4.0f);
+    std::vector<glm::vec4> image32(texelCount);
+    for (auto& t : image32) t = glm::vec4(hdr(rng), hdr(rng), hdr(rng), 1.0f);
+
+    struct { ResourceFormat format; const void* pData; } images[] = { { ResourceFormat::RGBA8UnormSrgb, image8.data() }, { ResourceFormat::RGBA32Float, image32.data() } };
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "MipGenerator: full chain of a " << kThroughputSize << "x" << kThroughputSize << " image\n";
+    for (const auto& image : images)
+    {
+        for (const FilterDesc& filter : kFilters)
+        {
+            std::vector<uint8_t> chain;
+            double singleMs = TestHelper::measureFastestMs(kRepeatCount, [&]() { MipGenerator::generate(image.pData, kThroughputSize, kThroughputSize, image.format, filter.filter, chain, 1); });
+            double poolMs = TestHelper::measureFastestMs(kRepeatCount, [&]() { MipGenerator::generate(image.pData, kThroughputSize, kThroughputSize, image.format, filter.filter, chain, 0); });
+            ss << "  " << to_string(image.format) << ", " << filter.name << ": " << TestHelper::toMillionsPerSecond(texelCount, singleMs) << " MPix/s on 1 thread, "
+               << TestHelper::toMillionsPerSecond(texelCount, poolMs) << " MPix/s on " << poolThreads << " threads\n";
+        }
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+int main()
+{
+    MipGeneratorTest mgt;
+    mgt.init(false);
+    mgt.run();
+    return 0;
+}
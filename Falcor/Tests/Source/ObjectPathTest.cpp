@@ -0,0 +1,275 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ObjectPathTest.h"
+#include "rapidjson/document.h"
+
+namespace
+{
+    // Scenes with camera paths, relative to the directory given by SCENE_DATA_DIR, which the project sets to CommonPasses/Data
+    const char* kScenes[] =
+    {
+        "Scenes/Bistro_Scene/bistro.fscene",
+        "Scenes/Purple_Bedroom_Scene/purple_bedroom.fscene",
+        "Scenes/Sun_Temple_Scene/SunTemple.fscene",
+        "Scenes/forest/forest.fscene",
+        "Scenes/pink_room/pink_room.fscene",
+    };
+
+    // Enough frames that the distance between consecutive positions is close to the distance along the path, even in the tight turns of the Sun Temple path
+    const uint32_t kFrameCount = 3000;
+
+    // Largest allowed difference between the distance covered by a frame and the average, relative to the average
+    const float kSpeedTolerance = 0.02f;
+
+    glm::vec3 readVec3(const rapidjson::Value& value)
+    {
+        return glm::vec3(value[0].GetFloat(), value[1].GetFloat(), value[2].GetFloat());
+    }
+
+    // Positions are compared relative to the size of the path
+    float getTolerance(ObjectPath* pPath, float relative)
+    {
+        return relative * std::max(1.0f, pPath->getLength());
+    }
+}
+
+void ObjectPathTest::addTests()
+{
+    addTestToList<TestConstantSpeed>();
+    addTestToList<TestEndPoints>();
+    addTestToList<TestFixedStepPlayback>();
+    addTestToList<TestRebake>();
+}
+
+void ObjectPathTest::onInit()
+{
+    addDataDirectory(SCENE_DATA_DIR);
+}
+
+std::vector<ObjectPath::SharedPtr> ObjectPathTest::loadScenePaths(std::string& error)
+{
+    std::vector<ObjectPath::SharedPtr> paths;
+    for (const char* scene : kScenes)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(scene, fullpath) == false)
+        {
+            error = std::string("Can't find ") + scene;
+            return {};
+        }
+
+        rapidjson::Document document;
+        document.Parse(readFile(fullpath).c_str());
+        if (document.HasParseError() || document.HasMember("paths") == false)
+        {
+            error = std::string("Can't read the paths of ") + scene;
+            return {};
+        }
+
+        const rapidjson::Value& jsonPaths = document["paths"];
+        for (rapidjson::SizeType i = 0; i < jsonPaths.Size(); i++)
+        {
+            const rapidjson::Value& jsonPath = jsonPaths[i];
+            auto pPath = ObjectPath::create();
+            pPath->setName(std::string(scene) + ", path " + std::to_string(i));
+            if (jsonPath.HasMember("loop"))
+            {
+                pPath->setAnimationRepeat(jsonPath["loop"].GetBool());
+            }
+
+            const rapidjson::Value& frames = jsonPath["frames"];
+            for (rapidjson::SizeType f = 0; f < frames.Size(); f++)
+            {
+                pPath->addKeyFrame(frames[f]["time"].GetFloat(), readVec3(frames[f]["pos"]), readVec3(frames[f]["target"]), readVec3(frames[f]["up"]));
+            }
+
+            pPath->attachObject(std::make_shared<PathRecorder>());
+            paths.push_back(pPath);
+        }
+    }
+    return paths;
+}
+
+testing_func(ObjectPathTest, TestConstantSpeed)
+{
+    std::string error;
+    auto paths = loadScenePaths(error);
+    if (paths.empty()) return test_fail(error);
+
+    for (auto& pPath : paths)
+    {
+        // Paths which only turn the camera are played at a constant rate instead, which TestFixedStepPlayback covers
+        if (pPath->getLength() <= 0) continue;
+
+        const PathRecorder* pRecorder = static_cast<const PathRecorder*>(pPath->getAttachedObject(0).get());
+        std::vector<float> steps;
+        pPath->animateFrame(0, kFrameCount);
+        glm::vec3 previous = pRecorder->mPosition;
+        for (uint32_t frame = 1; frame < kFrameCount; frame++)
+        {
+            pPath->animateFrame(frame, kFrameCount);
+            steps.push_back(glm::length(pRecorder->mPosition - previous));
+            previous = pRecorder->mPosition;
+        }
+
+        float total = 0;
+        for (float step : steps) total += step;
+        const float average = total / steps.size();
+        for (uint32_t i = 0; i < steps.size(); i++)
+        {
+            if (std::abs(steps[i] - average) > kSpeedTolerance * average)
+            {
+                return test_fail(pPath->getName() + ": frame " + std::to_string(i + 1) + " moves " + std::to_string(steps[i]) + ", but the average is " + std::to_string(average));
+            }
+        }
+
+        // Repeating paths stop one frame short of the end
+        const float expected = pPath->getLength() * (pPath->isRepeatOn() ? float(kFrameCount - 1) / kFrameCount : 1.0f);
+        if (std::abs(total - expected) > 0.01f * expected)
+        {
+            return test_fail(pPath->getName() + ": the frames cover " + std::to_string(total) + ", but the path is " + std::to_string(expected) + " long");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(ObjectPathTest, TestEndPoints)
+{
+    std::string error;
+    auto paths = loadScenePaths(error);
+    if (paths.empty()) return test_fail(error);
+
+    for (auto& pPath : paths)
+    {
+        const PathRecorder* pRecorder = static_cast<const PathRecorder*>(pPath->getAttachedObject(0).get());
+        const ObjectPath::Frame& first = pPath->getKeyFrame(0);
+        const ObjectPath::Frame& last = pPath->getKeyFrame(pPath->getKeyFrameCount() - 1);
+        const float tolerance = getTolerance(pPath.get(), 1e-4f);
+
+        pPath->animateFrame(0, kFrameCount);
+        if (glm::length(pRecorder->mPosition - first.position) > tolerance || glm::length(pRecorder->mTarget - first.target) > tolerance)
+        {
+            return test_fail(pPath->getName() + ": the first frame is not at the first key frame");
+        }
+
+        if (pPath->isRepeatOn())
+        {
+            // Playing past the last frame starts over
+            glm::vec3 start = pRecorder->mPosition;
+            pPath->animateFrame(kFrameCount, kFrameCount);
+            if (pRecorder->mPosition != start)
+            {
+                return test_fail(pPath->getName() + ": frame " + std::to_string(kFrameCount) + " of a repeating path is not the first frame");
+            }
+        }
+        else
+        {
+            pPath->animateFrame(kFrameCount - 1, kFrameCount);
+            if (glm::length(pRecorder->mPosition - last.position) > tolerance || glm::length(pRecorder->mTarget - last.target) > tolerance)
+            {
+                return test_fail(pPath->getName() + ": the last frame is not at the last key frame");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(ObjectPathTest, TestFixedStepPlayback)
+{
+    std::string error;
+    auto paths = loadScenePaths(error);
+    if (paths.empty()) return test_fail(error);
+
+    for (auto& pPath : paths)
+    {
+        const PathRecorder* pRecorder = static_cast<const PathRecorder*>(pPath->getAttachedObject(0).get());
+        const float tolerance = getTolerance(pPath.get(), 1e-4f);
+        const float firstTime = pPath->getKeyFrame(0).time;
+        const float timeStep = pPath->getDuration() / (pPath->isRepeatOn() ? kFrameCount : kFrameCount - 1);
+
+        std::vector<glm::vec3> positions(kFrameCount);
+        for (uint32_t frame = 0; frame < kFrameCount; frame++)
+        {
+            pPath->animateFrame(frame, kFrameCount);
+            positions[frame] = pRecorder->mPosition;
+        }
+
+        // Playing at a fixed time step in constant-speed mode reaches the same frames, and replaying gives the same results
+        pPath->setPlaybackMode(ObjectPath::Playback::ConstantSpeed);
+        for (uint32_t frame = 0; frame < kFrameCount; frame++)
+        {
+            pPath->animate(firstTime + frame * timeStep);
+            if (glm::length(pRecorder->mPosition - positions[frame]) > tolerance)
+            {
+                return test_fail(pPath->getName() + ": playing at a fixed time step doesn't reach frame " + std::to_string(frame));
+            }
+
+            pPath->animateFrame(frame, kFrameCount);
+            if (pRecorder->mPosition != positions[frame])
+            {
+                return test_fail(pPath->getName() + ": replaying frame " + std::to_string(frame) + " gives a different position");
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(ObjectPathTest, TestRebake)
+{
+    std::string error;
+    auto paths = loadScenePaths(error);
+    if (paths.empty()) return test_fail(error);
+
+    const uint32_t kSampleCount = 100;
+    for (auto& pPath : paths)
+    {
+        pPath->bake(kSampleCount);
+        if (pPath->getBakedSamples().size() != kSampleCount)
+        {
+            return test_fail(pPath->getName() + ": the table doesn't have the requested sample count");
+        }
+
+        // Moving the first key frame moves the start of the table, which keeps its sample count
+        glm::vec3 offset(1.0f, 2.0f, 3.0f);
+        pPath->setFramePosition(0, pPath->getKeyFrame(0).position + offset);
+        const auto& samples = pPath->getBakedSamples();
+        if (samples.size() != kSampleCount || glm::length(samples[0].position - pPath->getKeyFrame(0).position) > getTolerance(pPath.get(), 1e-4f))
+        {
+            return test_fail(pPath->getName() + ": the table was not rebuilt when a key frame moved");
+        }
+    }
+    return test_pass();
+}
+
+int main()
+{
+    ObjectPathTest opt;
+    opt.init(false);
+    opt.run();
+    return 0;
+}
@@ -0,0 +1,398 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ProgramCacheTest.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    const char* kShader = "Shader.slang";
+    const char* kInclude = "Include.slangh";
+
+    // Number of stages the stub compiler produces code for. Only some of them are used, as with real programs.
+    const uint32_t kStageCount = 3;
+
+    ProgramCache::SharedPtr createEmptyCache(const std::string& directory, uint64_t maxSizeInBytes = 256 * 1024 * 1024)
+    {
+        ProgramCache::Desc desc;
+        desc.directory = directory;
+        desc.maxSizeInBytes = maxSizeInBytes;
+        auto pCache = ProgramCache::create(desc);
+        if (pCache)
+        {
+            // Entries left by a previous run
+            pCache->clear();
+            pCache->resetStats();
+        }
+        return pCache;
+    }
+
+    // Write the shader, which includes a second file, and return the shader's path
+    std::string writeSources(const std::string& directory, const std::string& includeText)
+    {
+        std::ofstream(directory + "/" + kShader) << "#include \"" << kInclude << "\"\nfloat4 main() : SV_TARGET { return color(); }\n";
+        std::ofstream(directory + "/" + kInclude) << includeText;
+        return directory + "/" + kShader;
+    }
+}
+
+void ProgramCacheTest::addTests()
+{
+    addTestToList<TestKeyHashing>();
+    addTestToList<TestHitAndMiss>();
+    addTestToList<TestStaleDependencies>();
+    addTestToList<TestPersistence>();
+    addTestToList<TestCorruptFiles>();
+    addTestToList<TestEviction>();
+}
+
+void ProgramCacheTest::onInit()
+{
+}
+
+ProgramCache::CodeBlobs ProgramCacheTest::StubCompiler::generate(const std::string& filename, const std::string& defines, std::vector<std::string>& dependencies)
+{
+    dependencies.clear();
+    uint64_t codeHash = ProgramCache::hash(defines);
+    std::vector<std::string> files = { filename };
+    while (files.empty() == false)
+    {
+        std::string file = files.back();
+        files.pop_back();
+        if (doesFileExist(file) == false) continue;
+        dependencies.push_back(file);
+
+        std::string text = readFile(file);
+        codeHash = ProgramCache::hash(text, codeHash);
+
+        std::stringstream lines(text);
+        std::string line;
+        const std::string directive = "#include \"";
+        while (std::getline(lines, line))
+        {
+            if (line.compare(0, directive.size(), directive) == 0)
+            {
+                files.push_back(getDirectoryFromFile(file) + "/" + line.substr(directive.size(), line.find('"', directive.size()) - directive.size()));
+            }
+        }
+    }
+
+    // Stage 1 is unused. The other two get code of different sizes.
+    ProgramCache::CodeBlobs code(kStageCount);
+    for (uint32_t stage = 0; stage < kStageCount; stage += 2)
+    {
+        code[stage].resize(64 + stage * 100);
+        for (size_t i = 0; i < code[stage].size(); i++)
+        {
+            code[stage][i] = (uint8_t)(codeHash >> ((i + stage) % 8 * 8));
+        }
+    }
+    return code;
+}
+
+bool ProgramCacheTest::StubCompiler::compile(ProgramCache* pCache, const std::string& filename, const std::string& defines, ProgramCache::CodeBlobs& code)
+{
+    const std::string key = getKey(filename, defines);
+    if (pCache && pCache->find(key, code)) return true;
+
+    mCompileCount++;
+    std::vector<std::string> dependencies;
+    code = generate(filename, defines, dependencies);
+    if (pCache) pCache->store(key, dependencies, code, 1.0);
+    return false;
+}
+
+std::string ProgramCacheTest::createTestDirectory(const std::string& name)
+{
+    std::string directory = getExecutableDirectory() + "/ProgramCacheTest";
+    createDirectory(directory);
+    directory += "/" + name;
+    createDirectory(directory);
+    return directory;
+}
+
+void ProgramCacheTest::writeTextFile(const std::string& filename, const std::string& text)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file << text;
+}
+
+std::string ProgramCacheTest::getEntryFilename(const std::string& directory, const std::string& key)
+{
+    // Entries are named after the hash of their key
+    std::stringstream ss;
+    ss << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << ProgramCache::hash(key) << ".bin";
+    return ss.str();
+}
+
+testing_func(ProgramCacheTest, TestKeyHashing)
+{
+    // Reference values of 64-bit FNV-1a
+    if (ProgramCache::hash(std::string()) != 0xcbf29ce484222325ull || ProgramCache::hash(std::string("a")) != 0xaf63dc4c8601ec8cull || ProgramCache::hash(std::string("foobar")) != 0x85944171f73967e8ull)
+    {
+        return test_fail("The hash doesn't match the FNV-1a reference values");
+    }
+
+    // Hashing in pieces with the previous hash as the seed is the same as hashing everything at once, which is how file contents are folded into keys
+    if (ProgramCache::hash(std::string("bar"), ProgramCache::hash(std::string("foo"))) != ProgramCache::hash(std::string("foobar")))
+    {
+        return test_fail("Chaining hashes doesn't match hashing the concatenation");
+    }
+
+    // Keys which only differ in their defines or in one character of a path are different entries
+    std::string directory = createTestDirectory("KeyHashing");
+    auto pCache = createEmptyCache(directory);
+    if (pCache == nullptr) return test_fail("Can't create the cache");
+
+    std::string shader = writeSources(directory, "float4 color() { return 1; }\n");
+    StubCompiler compiler;
+    ProgramCache::CodeBlobs code;
+    compiler.compile(pCache.get(), shader, "A=1", code);
+    const char* otherKeys[] = { "A=2", "A=1;B=1", "" };
+    for (const char* defines : otherKeys)
+    {
+        if (compiler.compile(pCache.get(), shader, defines, code))
+        {
+            return test_fail(std::string("The defines '") + defines + "' hit the entry compiled with 'A=1'");
+        }
+    }
+    if (pCache->find(StubCompiler::getKey(shader + " ", "A=1"), code))
+    {
+        return test_fail("A different path hit the entry");
+    }
+
+    if (pCache->getEntryCount() != 4) return test_fail("Expected one entry per key, found " + std::to_string(pCache->getEntryCount()));
+    return test_pass();
+}
+
+testing_func(ProgramCacheTest, TestHitAndMiss)
+{
+    std::string directory = createTestDirectory("HitAndMiss");
+    auto pCache = createEmptyCache(directory);
+    if (pCache == nullptr) return test_fail("Can't create the cache");
+
+    std::string shader = writeSources(directory, "float4 color() { return 1; }\n");
+    StubCompiler compiler;
+    ProgramCache::CodeBlobs code;
+    if (compiler.compile(pCache.get(), shader, "A=1", code)) return test_fail("The empty cache hit");
+
+    // The second compile is a hit, and returns the same code for every stage, including the empty one
+    std::vector<std::string> dependencies;
+    ProgramCache::CodeBlobs expected = StubCompiler::generate(shader, "A=1", dependencies);
+    if (compiler.compile(pCache.get(), shader, "A=1", code) == false) return test_fail("Compiling again missed");
+    if (code != expected) return test_fail("The cached code is different from the compiled code");
+    if (compiler.mCompileCount != 1) return test_fail("Compiled again on a hit");
+
+    // Changing a define and going back, as addDefine()/removeDefine() do, hits the first entry again
+    compiler.compile(pCache.get(), shader, "A=2", code);
+    if (compiler.compile(pCache.get(), shader, "A=1", code) == false || code != expected)
+    {
+        return test_fail("Returning to the first defines missed");
+    }
+
+    ProgramCache::Stats stats = pCache->getStats();
+    if (stats.hits != 2 || stats.misses != 2 || stats.staleMisses != 0 || stats.stores != 2)
+    {
+        return test_fail("Unexpected stats: " + pCache->getStatsString());
+    }
+    if (stats.missCompileTimeMs != 2.0 || stats.savedCompileTimeMs != 2.0)
+    {
+        return test_fail("The compile times reported to store() are not accounted for");
+    }
+    return test_pass();
+}
+
+testing_func(ProgramCacheTest, TestStaleDependencies)
+{
+    std::string directory = createTestDirectory("StaleDependencies");
+    auto pCache = createEmptyCache(directory);
+    if (pCache == nullptr) return test_fail("Can't create the cache");
+
+    std::string shader = writeSources(directory, "float4 color() { return 1; }\n");
+    StubCompiler compiler;
+    ProgramCache::CodeBlobs code;
+    compiler.compile(pCache.get(), shader, "", code);
+
+    // Editing a file the shader includes makes the entry stale. The key didn't change, so it is reported separately from plain misses.
+    writeTextFile(directory + "/" + kInclude, "float4 color() { return float4(1, 0, 0, 1); }\n");
+    if (compiler.compile(pCache.get(), shader, "", code)) return test_fail("Hit after an included file changed");
+
+    std::vector<std::string> dependencies;
+    if (code != StubCompiler::generate(shader, "", dependencies)) return test_fail("The recompiled code doesn't match the edited sources");
+    if (compiler.compile(pCache.get(), shader, "", code) == false) return test_fail("The recompiled entry missed");
+
+    // An entry depending on a file which was deleted is stale too
+    std::remove((directory + "/" + kInclude).c_str());
+    if (pCache->find(StubCompiler::getKey(shader, ""), code)) return test_fail("Hit after an included file was deleted");
+
+    ProgramCache::Stats stats = pCache->getStats();
+    if (stats.staleMisses != 2 || stats.hits != 1 || stats.misses != 1)
+    {
+        return test_fail("Unexpected stats: " + pCache->getStatsString());
+    }
+    return test_pass();
+}
+
+testing_func(ProgramCacheTest, TestPersistence)
+{
+    std::string directory = createTestDirectory("Persistence");
+    std::string shader = writeSources(directory, "float4 color() { return 1; }\n");
+    StubCompiler compiler;
+    ProgramCache::CodeBlobs code;
+    {
+        auto pCache = createEmptyCache(directory);
+        if (pCache == nullptr) return test_fail("Can't create the cache");
+        compiler.compile(pCache.get(), shader, "A=1", code);
+        compiler.compile(pCache.get(), shader, "A=2", code);
+    }
+
+    // A new cache in the same directory, as on the next run, finds the entries the first one stored
+    ProgramCache::Desc desc;
+    desc.directory = directory;
+    auto pCache = ProgramCache::create(desc);
+    if (pCache->getEntryCount() != 2) return test_fail("The index was not reloaded");
+    if (compiler.compile(pCache.get(), shader, "A=1", code) == false || compiler.compile(pCache.get(), shader, "A=2", code) == false)
+    {
+        return test_fail("Entries stored by the previous cache missed");
+    }
+    if (compiler.mCompileCount != 2) return test_fail("Compiled again after reloading");
+
+    // An index written by a different version is ignored, but doesn't prevent using the directory
+    pCache = nullptr;
+    writeTextFile(directory + "/index.txt", "FalcorProgramCache 0\n0000000000000000 100 1\n");
+    pCache = ProgramCache::create(desc);
+    if (pCache->getEntryCount() != 0) return test_fail("An index with a different header was loaded");
+    if (compiler.compile(pCache.get(), shader, "A=1", code)) return test_fail("Hit an entry missing from the index");
+    if (compiler.compile(pCache.get(), shader, "A=1", code) == false) return test_fail("The entry stored after ignoring the index missed");
+    return test_pass();
+}
+
+testing_func(ProgramCacheTest, TestCorruptFiles)
+{
+    std::string directory = createTestDirectory("CorruptFiles");
+    auto pCache = createEmptyCache(directory);
+    if (pCache == nullptr) return test_fail("Can't create the cache");
+
+    std::string shader = writeSources(directory, "float4 color() { return 1; }\n");
+    const std::string key = StubCompiler::getKey(shader, "");
+    const std::string entryFile = getEntryFilename(directory, key);
+    StubCompiler compiler;
+    ProgramCache::CodeBlobs code;
+    compiler.compile(pCache.get(), shader, "", code);
+    if (doesFileExist(entryFile) == false) return test_fail("The entry is not stored in " + entryFile);
+    const std::string original = readFile(entryFile);
+
+    // Every truncation of the file is rejected
+    for (size_t size = 0; size < original.size(); size++)
+    {
+        writeTextFile(entryFile, original.substr(0, size));
+        if (pCache->find(key, code)) return test_fail("Hit a file truncated to " + std::to_string(size) + " bytes");
+        if (code.empty() == false) return test_fail("A rejected lookup returned code");
+    }
+
+    // So are lengths and counts far larger than the file, which must not be trusted for allocations.
+    // The key's length comes right after the magic number and version, and is followed by the key, the compile time and the dependency count.
+    const size_t keyLengthOffset = 8;
+    const size_t depCountOffset = keyLengthOffset + 4 + key.size() + sizeof(double);
+    for (size_t offset : { keyLengthOffset, depCountOffset, depCountOffset + 4 })
+    {
+        std::string corrupt = original;
+        for (size_t i = 0; i < 4; i++) corrupt[offset + i] = (char)0xff;
+        writeTextFile(entryFile, corrupt);
+        if (pCache->find(key, code)) return test_fail("Hit a file with a corrupt length at offset " + std::to_string(offset));
+    }
+
+    // Wrong magic number
+    std::string corrupt = original;
+    corrupt[0] ^= 0x55;
+    writeTextFile(entryFile, corrupt);
+    if (pCache->find(key, code)) return test_fail("Hit a file with the wrong magic number");
+
+    // A file holding another key, as after a hash collision
+    corrupt = original;
+    corrupt[keyLengthOffset + 4] ^= 0x01;
+    writeTextFile(entryFile, corrupt);
+    if (pCache->find(key, code)) return test_fail("Hit a file stored for another key");
+
+    // Recompiling replaces the corrupt entry
+    if (compiler.compile(pCache.get(), shader, "", code)) return test_fail("Hit a corrupt file");
+    if (compiler.compile(pCache.get(), shader, "", code) == false || readFile(entryFile) != original)
+    {
+        return test_fail("The corrupt entry was not replaced");
+    }
+    return test_pass();
+}
+
+testing_func(ProgramCacheTest, TestEviction)
+{
+    std::string directory = createTestDirectory("Eviction");
+    std::string shader = writeSources(directory, "float4 color() { return 1; }\n");
+    StubCompiler compiler;
+    ProgramCache::CodeBlobs code;
+
+    // Measure the size of an entry, then make room for three of them
+    uint64_t entrySize;
+    {
+        auto pCache = createEmptyCache(directory);
+        if (pCache == nullptr) return test_fail("Can't create the cache");
+        compiler.compile(pCache.get(), shader, "A=0", code);
+        entrySize = pCache->getSizeInBytes();
+    }
+    auto pCache = createEmptyCache(directory, entrySize * 3 + entrySize / 2);
+
+    compiler.compile(pCache.get(), shader, "A=1", code);
+    compiler.compile(pCache.get(), shader, "A=2", code);
+    compiler.compile(pCache.get(), shader, "A=3", code);
+
+    // Using A=1 makes A=2 the least recently used, so storing a fourth entry evicts it
+    compiler.compile(pCache.get(), shader, "A=1", code);
+    compiler.compile(pCache.get(), shader, "A=4", code);
+    if (pCache->getEntryCount() != 3 || pCache->getStats().evictions != 1) return test_fail("Expected one eviction: " + pCache->getStatsString());
+    if (pCache->getSizeInBytes() > pCache->getDesc().maxSizeInBytes) return test_fail("The cache is larger than its limit");
+    if (doesFileExist(getEntryFilename(directory, StubCompiler::getKey(shader, "A=2")))) return test_fail("The evicted entry's file was not deleted");
+
+    uint32_t compileCount = compiler.mCompileCount;
+    for (const char* defines : { "A=1", "A=3", "A=4" })
+    {
+        if (compiler.compile(pCache.get(), shader, defines, code) == false) return test_fail(std::string("The entry for ") + defines + " was evicted");
+    }
+    if (compiler.compile(pCache.get(), shader, "A=2", code) || compiler.mCompileCount != compileCount + 1)
+    {
+        return test_fail("The least recently used entry was not the one evicted");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    ProgramCacheTest pct;
+    pct.init(false);
+    pct.run();
+    return 0;
+}
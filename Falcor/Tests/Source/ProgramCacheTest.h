@@ -0,0 +1,71 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+
+class ProgramCacheTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override;
+    register_testing_func(TestKeyHashing);
+    register_testing_func(TestHitAndMiss);
+    register_testing_func(TestStaleDependencies);
+    register_testing_func(TestPersistence);
+    register_testing_func(TestCorruptFiles);
+    register_testing_func(TestEviction);
+
+    /** Stands in for Slang. "Compiles" a source file by hashing it and the files it includes, and counts how often it runs.
+        Includes are lines of the form '#include "file"', relative to the including file's directory.
+    */
+    class StubCompiler
+    {
+    public:
+        /** Compile a file with a set of defines, the same way Program does: look up the cache first, and store the result on a miss
+            \param[in] pCache The cache, or nullptr to always compile
+            \param[out] code The code of each stage
+            \return Whether the code came from the cache
+        */
+        bool compile(ProgramCache* pCache, const std::string& filename, const std::string& defines, ProgramCache::CodeBlobs& code);
+
+        /** The code compile() produces for a file, to check what the cache returns
+        */
+        static ProgramCache::CodeBlobs generate(const std::string& filename, const std::string& defines, std::vector<std::string>& dependencies);
+
+        static std::string getKey(const std::string& filename, const std::string& defines) { return "file=" + filename + ";define=" + defines + ";"; }
+
+        uint32_t mCompileCount = 0;
+    };
+
+    /** Create an empty directory for a test's cache and sources, next to the executable
+    */
+    static std::string createTestDirectory(const std::string& name);
+
+    static void writeTextFile(const std::string& filename, const std::string& text);
+    static std::string getEntryFilename(const std::string& directory, const std::string& key);
+};
@@ -0,0 +1,119 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ProgramCompileTest.h"
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    struct ProgramDesc
+    {
+        const char* filename;
+        const char* vsEntry;        ///< nullptr for compute programs
+        const char* psOrCsEntry;
+    };
+
+    const ProgramDesc kPrograms[] =
+    {
+        { "Framework/Shaders/Gui.slang", "vs", "ps" },
+        { "Framework/Shaders/SceneEditor.slang", "editorVs", "editorPs" },
+        { "Framework/Shaders/MaterialBlock.slang", "", "main" },
+        { "RenderPasses/ForwardLightingPass.slang", "", "ps" },
+        { "Framework/Shaders/ComputeSkinning.cs.slang", nullptr, "main" },
+        { "Effects/ParticleSort.cs.slang", nullptr, "main" },
+    };
+
+    // Each program is compiled with this many values of an unused define, so there are more compiles than threads
+    const uint32_t kVariantCount = 4;
+
+    Program::SharedPtr createProgram(uint32_t index)
+    {
+        const ProgramDesc& desc = kPrograms[index / kVariantCount];
+        Program::DefineList defines;
+        defines.add("_PROGRAM_COMPILE_TEST_VARIANT", std::to_string(index % kVariantCount));
+        if (desc.vsEntry == nullptr) return ComputeProgram::createFromFile(desc.filename, desc.psOrCsEntry, defines);
+        return GraphicsProgram::createFromFile(desc.filename, desc.vsEntry, desc.psOrCsEntry, defines);
+    }
+
+    // The number of resources the program declares, or -1 if it didn't link
+    int32_t getResourceCount(const Program::SharedPtr& pProgram)
+    {
+        if (pProgram == nullptr || pProgram->getActiveVersion() == nullptr) return -1;
+        return (int32_t)pProgram->getReflector()->getDefaultParameterBlock()->getResourceVec().size();
+    }
+}
+
+void ProgramCompileTest::addTests()
+{
+    addTestToList<TestConcurrentCompile>();
+}
+
+void ProgramCompileTest::onInit()
+{
+}
+
+testing_func(ProgramCompileTest, TestConcurrentCompile)
+{
+    // Without the cache, every program is compiled by Slang
+    auto pCache = Program::getProgramCache();
+    Program::setProgramCache(nullptr);
+
+    const uint32_t count = (uint32_t)arraysize(kPrograms) * kVariantCount;
+    std::vector<int32_t> serialCounts(count);
+    auto start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < count; i++) serialCounts[i] = getResourceCount(createProgram(i));
+    double serialMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::vector<int32_t> concurrentCounts(count);
+    start = CpuTimer::getCurrentTimePoint();
+    parallelFor(count, 0, [&](uint32_t i) { concurrentCounts[i] = getResourceCount(createProgram(i)); });
+    double concurrentMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    Program::setProgramCache(pCache);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const std::string name = std::string(kPrograms[i / kVariantCount].filename) + " variant " + std::to_string(i % kVariantCount);
+        if (serialCounts[i] < 0) return test_fail(name + " doesn't compile");
+        if (concurrentCounts[i] != serialCounts[i]) return test_fail(name + " compiled concurrently doesn't match the serial compile");
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << "ProgramCompileTest: " << count << " programs, serial " << serialMs << " ms, concurrent on "
+       << WorkerPool::get().getThreadCount() << " threads " << concurrentMs << " ms (" << std::setprecision(2) << serialMs / concurrentMs << "x)";
+    logInfo(ss.str());
+    return test_pass();
+}
+
+int main()
+{
+    ProgramCompileTest pct;
+    pct.init(true);
+    pct.run();
+    return 0;
+}
@@ -27,6 +27,7 @@
 ***************************************************************************/
 #include "TestHelper.h"
 #include "API/VertexLayout.h"
+#include "rapidjson/document.h"
 
 namespace Falcor
 {
@@ -89,5 +90,35 @@ namespace Falcor
         {
             return nearCompare(lhs.x, rhs.x) && nearCompare(lhs.y, rhs.y) && nearCompare(lhs.z, rhs.z) && nearCompare(lhs.w, rhs.w);
         }
+
+        float maxRelativeDifference(const glm::mat4& value, const glm::mat4& reference)
+        {
+            float result = 0;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                for (uint32_t r = 0; r < 4; r++)
+                {
+                    result = std::max(result, std::abs(value[c][r] - reference[c][r]) / std::max(1.0f, std::abs(reference[c][r])));
+                }
+            }
+            return result;
+        }
+
+        double toMillionsPerSecond(uint64_t count, double ms)
+        {
+            return count / (std::max(ms, 0.001) * 1000.0);
+        }
+
+        bool hasSceneModels(const std::string& sceneFile)
+        {
+            rapidjson::Document document;
+            document.Parse(readFile(sceneFile).c_str());
+            if (document.HasParseError() || document.HasMember("models") == false || document["models"].IsArray() == false) return false;
+            for (const auto& model : document["models"].GetArray())
+            {
+                if (model.HasMember("file") == false || doesFileExist(getDirectoryFromFile(sceneFile) + "/" + model["file"].GetString()) == false) return false;
+            }
+            return true;
+        }
     }
 }
@@ -38,5 +38,33 @@ namespace Falcor
         vec4 randVec4ZeroToOne();
         bool nearCompare(const float lhs, const float rhs);
         bool nearVec4(const vec4& lhs, const vec4& rhs);
+
+        /** The largest difference between the elements of two matrices, relative to the magnitude of the reference element
+        */
+        float maxRelativeDifference(const glm::mat4& value, const glm::mat4& reference);
+
+        /** Convert a number of items processed in some ms to millions of items per second
+        */
+        double toMillionsPerSecond(uint64_t count, double ms);
+
+        /** Check whether the models a scene file references exist. The models of the scenes in CommonPasses/Data are downloaded separately,
+            so tests skip the scenes whose models are missing instead of loading them and reporting errors.
+        */
+        bool hasSceneModels(const std::string& sceneFile);
+
+        /** Run a function a few times, and return the time of the fastest run in ms
+        */
+        template<typename Func>
+        double measureFastestMs(uint32_t repeatCount, const Func& func)
+        {
+            double best = 1e30;
+            for (uint32_t r = 0; r < repeatCount; r++)
+            {
+                auto start = CpuTimer::getCurrentTimePoint();
+                func();
+                best = std::min(best, (double)CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()));
+            }
+            return best;
+        }
     }
 }
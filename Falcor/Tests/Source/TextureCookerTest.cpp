@@ -0,0 +1,372 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TextureCookerTest.h"
+#include "TestHelper.h"
+#include "Utils/BlockCompression.h"
+#include "Utils/ParallelFor.h"
+#include <experimental/filesystem>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+    const uint32_t kImageSize = 1024;
+    const uint32_t kRepeatCount = 3;
+
+    // Relative to the directory given by SCENE_DATA_DIR, which the project sets to CommonPasses/Data
+    const char* kTextureDirectory = "Scenes/pink_room/textures";
+
+    using EncodeFunc = void(*)(const uint8_t*, uint8_t*);
+
+    struct Format
+    {
+        const char* name;
+        EncodeFunc encode;
+        uint32_t blockSize;             ///< Bytes per 4x4 block
+        uint32_t channelCount;          ///< The channels the format keeps, starting with red
+        float maxRmse;                  ///< Largest allowed RMS error per channel on the test image, in 8-bit units. The image's noise alone accounts for about 3.7.
+    };
+
+    // Reference decoders, written from the format specifications rather than from the encoders
+    void decodeColors565(const uint8_t* pBlock, bool allowThreeColorMode, uint8_t pPixels[64])
+    {
+        uint16_t c[2] = { uint16_t(pBlock[0] | (pBlock[1] << 8)), uint16_t(pBlock[2] | (pBlock[3] << 8)) };
+        int palette[4][3];
+        for (int e = 0; e < 2; e++)
+        {
+            int r = (c[e] >> 11) & 31, g = (c[e] >> 5) & 63, b = c[e] & 31;
+            palette[e][0] = (r << 3) | (r >> 2);
+            palette[e][1] = (g << 2) | (g >> 4);
+            palette[e][2] = (b << 3) | (b >> 2);
+        }
+        bool fourColors = (c[0] > c[1]) || allowThreeColorMode == false;
+        for (int i = 0; i < 3; i++)
+        {
+            palette[2][i] = fourColors ? (2 * palette[0][i] + palette[1][i]) / 3 : (palette[0][i] + palette[1][i]) / 2;
+            palette[3][i] = fourColors ? (palette[0][i] + 2 * palette[1][i]) / 3 : 0;
+        }
+        uint32_t indices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | (uint32_t(pBlock[7]) << 24);
+        for (int t = 0; t < 16; t++)
+        {
+            for (int i = 0; i < 3; i++) pPixels[t * 4 + i] = (uint8_t)palette[(indices >> (2 * t)) & 3][i];
+        }
+    }
+
+    void decodeChannelBC4(const uint8_t* pBlock, uint32_t channel, uint8_t pPixels[64])
+    {
+        int a0 = pBlock[0], a1 = pBlock[1];
+        int palette[8] = { a0, a1 };
+        for (int i = 1; i < 7; i++)
+        {
+            if (a0 > a1) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+            else if (i < 5) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        }
+        if (a0 <= a1)
+        {
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++) indices |= uint64_t(pBlock[2 + i]) << (8 * i);
+        for (int t = 0; t < 16; t++) pPixels[t * 4 + channel] = (uint8_t)palette[(indices >> (3 * t)) & 7];
+    }
+
+    // Only mode 6, which is all the encoder writes
+    bool decodeBC7(const uint8_t* pBlock, uint8_t pPixels[64])
+    {
+        if ((pBlock[0] & 0x7f) != 0x40) return false;
+        uint32_t bit = 7;
+        auto read = [&](uint32_t count)
+        {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; i++, bit++) value |= ((pBlock[bit / 8] >> (bit % 8)) & 1) << i;
+            return value;
+        };
+        int endpoints[2][4];
+        for (int c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = read(7);
+            endpoints[1][c] = read(7);
+        }
+        for (int e = 0; e < 2; e++)
+        {
+            uint32_t p = read(1);
+            for (int c = 0; c < 4; c++) endpoints[e][c] = (endpoints[e][c] << 1) | p;
+        }
+        static const int kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        for (int t = 0; t < 16; t++)
+        {
+            int w = kWeights[read(t == 0 ? 3 : 4)];
+            for (int c = 0; c < 4; c++) pPixels[t * 4 + c] = (uint8_t)(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+        }
+        return true;
+    }
+
+    bool decodeBlock(const std::string& format, const uint8_t* pBlock, uint8_t pPixels[64])
+    {
+        if (format == "BC1") decodeColors565(pBlock, true, pPixels);
+        else if (format == "BC3")
+        {
+            decodeChannelBC4(pBlock, 3, pPixels);
+            decodeColors565(pBlock + 8, false, pPixels);
+        }
+        else if (format == "BC5")
+        {
+            decodeChannelBC4(pBlock, 0, pPixels);
+            decodeChannelBC4(pBlock + 8, 1, pPixels);
+        }
+        else return decodeBC7(pBlock, pPixels);
+        return true;
+    }
+
+    const Format kFormats[] =
+    {
+        { "BC1", BlockCompression::encodeBC1, 8, 3, 5.0f },
+        { "BC3", BlockCompression::encodeBC3, 16, 4, 5.0f },
+        { "BC5", BlockCompression::encodeBC5, 16, 2, 1.5f },
+        { "BC7", BlockCompression::encodeBC7, 16, 4, 4.5f },
+    };
+
+    /** An RGBA8 image with smooth color and alpha gradients plus some noise, like a photographed texture
+    */
+    struct TestImage
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> texels;
+
+        TestImage(uint32_t w, uint32_t h) : width(w), height(h), texels((size_t)w * h * 4)
+        {
+            std::mt19937 rng(w * h);
+            std::uniform_int_distribution<int> noise(-6, 6);
+            for (uint32_t y = 0; y < h; y++)
+            {
+                for (uint32_t x = 0; x < w; x++)
+                {
+                    float u = float(x) / w, v = float(y) / h;
+                    float value[4] = { 0.5f + 0.4f * std::sin(u * 12.0f + v * 3.0f), 0.5f + 0.4f * std::cos(v * 9.0f - u * 4.0f), u * v, 0.2f + 0.6f * v };
+                    for (int c = 0; c < 4; c++)
+                    {
+                        texels[((size_t)y * w + x) * 4 + c] = (uint8_t)glm::clamp(int(value[c] * 255.0f + 0.5f) + noise(rng), 0, 255);
+                    }
+                }
+            }
+        }
+
+        /** Copy a 4x4 block, in the layout the encoders take
+        */
+        void getBlock(uint32_t blockX, uint32_t blockY, uint8_t pBlock[64]) const
+        {
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                std::memcpy(pBlock + y * 16, &texels[(((size_t)blockY * 4 + y) * width + blockX * 4) * 4], 16);
+            }
+        }
+    };
+
+    /** Encode an image, one row of blocks per task
+    */
+    void encodeImage(const TestImage& image, const Format& format, uint32_t threadCount, std::vector<uint8_t>& blocks)
+    {
+        const uint32_t blocksX = image.width / 4, blocksY = image.height / 4;
+        blocks.resize((size_t)blocksX * blocksY * format.blockSize);
+        parallelFor(blocksY, threadCount, [&](uint32_t by)
+        {
+            uint8_t pixels[64];
+            for (uint32_t bx = 0; bx < blocksX; bx++)
+            {
+                image.getBlock(bx, by, pixels);
+                format.encode(pixels, &blocks[((size_t)by * blocksX + bx) * format.blockSize]);
+            }
+        });
+    }
+}
+
+void TextureCookerTest::addTests()
+{
+    addTestToList<TestEncodeQuality>();
+    addTestToList<TestEncodeThroughput>();
+    addTestToList<TestCookSceneTextures>();
+}
+
+void TextureCookerTest::onInit()
+{
+    addDataDirectory(SCENE_DATA_DIR);
+}
+
+testing_func(TextureCookerTest, TestEncodeQuality)
+{
+    TestImage image(256, 256);
+    for (const Format& format : kFormats)
+    {
+        std::vector<uint8_t> blocks;
+        encodeImage(image, format, 1, blocks);
+
+        // Decode every block and compare it to the source, per channel
+        double squaredError[4] = {};
+        const uint32_t blocksX = image.width / 4;
+        for (uint32_t b = 0; b < blocks.size() / format.blockSize; b++)
+        {
+            uint8_t source[64], decoded[64] = {};
+            image.getBlock(b % blocksX, b / blocksX, source);
+            if (decodeBlock(format.name, &blocks[b * format.blockSize], decoded) == false)
+            {
+                return test_fail(std::string(format.name) + " wrote a block the decoder doesn't understand");
+            }
+            for (uint32_t t = 0; t < 16; t++)
+            {
+                for (uint32_t c = 0; c < format.channelCount; c++)
+                {
+                    double d = double(decoded[t * 4 + c]) - double(source[t * 4 + c]);
+                    squaredError[c] += d * d;
+                }
+            }
+        }
+        for (uint32_t c = 0; c < format.channelCount; c++)
+        {
+            double rmse = std::sqrt(squaredError[c] / (image.width * image.height));
+            if (rmse > format.maxRmse)
+            {
+                return test_fail(std::string(format.name) + " channel " + std::to_string(c) + " has an RMS error of " + std::to_string(rmse) + ", the limit is " + std::to_string(format.maxRmse));
+            }
+        }
+    }
+
+    // A constant block must come out (almost) exactly, which catches swapped endpoints and misplaced index bits
+    uint8_t flat[64];
+    for (uint32_t t = 0; t < 16; t++)
+    {
+        flat[t * 4 + 0] = 200;
+        flat[t * 4 + 1] = 100;
+        flat[t * 4 + 2] = 40;
+        flat[t * 4 + 3] = 255;
+    }
+    for (const Format& format : kFormats)
+    {
+        uint8_t block[16], decoded[64] = {};
+        format.encode(flat, block);
+        decodeBlock(format.name, block, decoded);
+        for (uint32_t t = 0; t < 16; t++)
+        {
+            for (uint32_t c = 0; c < format.channelCount; c++)
+            {
+                if (std::abs(int(decoded[t * 4 + c]) - int(flat[t * 4 + c])) > 4)
+                {
+                    return test_fail(std::string(format.name) + " doesn't reproduce a constant block");
+                }
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(TextureCookerTest, TestEncodeThroughput)
+{
+    TestImage image(kImageSize, kImageSize);
+    const uint32_t threadCount = WorkerPool::get().getThreadCount();
+    const uint64_t pixelCount = (uint64_t)image.width * image.height;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "BlockCompression: encoding a " << kImageSize << "x" << kImageSize << " RGBA8 image\n";
+    for (const Format& format : kFormats)
+    {
+        std::vector<uint8_t> blocks;
+        double singleMs = TestHelper::measureFastestMs(kRepeatCount, [&]() { encodeImage(image, format, 1, blocks); });
+        double parallelMs = TestHelper::measureFastestMs(kRepeatCount, [&]() { encodeImage(image, format, threadCount, blocks); });
+
+        // The memory saved, compared to uploading the image as RGBA8
+        const uint64_t uncompressed = pixelCount * 4;
+        ss << "  " << format.name << ": " << TestHelper::toMillionsPerSecond(pixelCount, singleMs) << " MPix/s on 1 thread, " << TestHelper::toMillionsPerSecond(pixelCount, parallelMs)
+           << " MPix/s on " << threadCount << " threads, " << uncompressed / 1024 << " KB -> " << blocks.size() / 1024 << " KB (" << 100.0 * (uncompressed - blocks.size()) / uncompressed << "% saved)\n";
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(TextureCookerTest, TestCookSceneTextures)
+{
+    std::string textureDirectory;
+    if (findFileInDataDirectories(kTextureDirectory, textureDirectory) == false) return test_fail(std::string("Can't find ") + kTextureDirectory);
+
+    std::vector<TextureCooker::CookRequest> requests;
+    for (const auto& entry : fs::directory_iterator(textureDirectory))
+    {
+        TextureCooker::CookRequest request;
+        request.filename = entry.path().string();
+        if (hasSuffix(request.filename, ".png", false) == false && hasSuffix(request.filename, ".jpg", false) == false) continue;
+        request.isSrgb = true;
+        requests.push_back(request);
+    }
+
+    // Start from an empty directory, so every texture is baked by this run
+    std::string directory = getExecutableDirectory() + "/TextureCookerTest";
+    fs::remove_all(directory);
+    TextureCooker::Desc desc;
+    desc.directory = directory;
+    TextureCooker::SharedPtr pCooker = TextureCooker::create(desc);
+    if (pCooker == nullptr) return test_fail("Can't create the cooker");
+
+    pCooker->cookTextures(requests);
+    TextureCooker::Stats stats = pCooker->getStats();
+    if (stats.texturesCooked + stats.texturesSkipped != requests.size() || stats.texturesUpToDate != 0)
+    {
+        return test_fail(std::to_string(requests.size()) + " textures requested, " + pCooker->getStatsString());
+    }
+    if (stats.texturesCooked == 0) return test_fail("None of the textures could be baked");
+    if (stats.compressedBytes >= stats.uncompressedBytes) return test_fail("Baking didn't save any memory");
+
+    // The second run finds everything baked
+    pCooker->resetStats();
+    pCooker->cookTextures(requests);
+    TextureCooker::Stats second = pCooker->getStats();
+    if (second.texturesCooked != 0 || second.texturesUpToDate != stats.texturesCooked)
+    {
+        return test_fail("Baking again didn't find the baked files: " + pCooker->getStatsString());
+    }
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "TextureCooker: " << stats.texturesCooked << " of " << requests.size() << " pink_room textures baked, " << TestHelper::toMillionsPerSecond(stats.pixelsEncoded, stats.cookTimeMs) << " MPix/s overall, "
+       << TestHelper::toMillionsPerSecond(stats.pixelsEncoded, stats.encodeTimeMs) << " MPix/s per thread. GPU memory " << stats.uncompressedBytes / (1024.0 * 1024.0) << " MB -> "
+       << stats.compressedBytes / (1024.0 * 1024.0) << " MB, " << 100.0 * (stats.uncompressedBytes - stats.compressedBytes) / stats.uncompressedBytes << "% saved\n";
+    logInfo(ss.str());
+    return test_pass();
+}
+
+int main()
+{
+    TextureCookerTest tct;
+    tct.init(true);
+    tct.run();
+    return 0;
+}
@@ -0,0 +1,211 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TextureDecodeTest.h"
+#include "TestHelper.h"
+#include <experimental/filesystem>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+    // Relative to the directory given by SCENE_DATA_DIR, which the project sets to CommonPasses/Data
+    const char* kTextureDirectories[] =
+    {
+        "Scenes/pink_room/textures",
+        "Scenes/forest/textures",
+        "Scenes/Purple_Bedroom_Scene",
+    };
+
+    // The models of these scenes are downloaded separately. Scenes whose models are missing are skipped.
+    const char* kScenes[] =
+    {
+        "Scenes/pink_room/pink_room.fscene",
+        "Scenes/forest/forest.fscene",
+        "Scenes/Purple_Bedroom_Scene/purple_bedroom.fscene",
+        "Scenes/Bistro_Scene/bistro.fscene",
+    };
+
+    const char* kImageExtensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
+
+    bool isSameTexture(const Texture* pA, const Texture* pB)
+    {
+        if (pA == nullptr || pB == nullptr) return pA == pB;
+        return pA->getWidth() == pB->getWidth() && pA->getHeight() == pB->getHeight() && pA->getFormat() == pB->getFormat() && pA->getMipCount() == pB->getMipCount();
+    }
+}
+
+void TextureDecodeTest::addTests()
+{
+    addTestToList<TestDecodeByThreadCount>();
+    addTestToList<TestDuplicateFiles>();
+    addTestToList<TestImportByThreadCount>();
+}
+
+void TextureDecodeTest::onInit()
+{
+    addDataDirectory(SCENE_DATA_DIR);
+}
+
+std::vector<TextureFileDesc> TextureDecodeTest::findSceneTextures()
+{
+    std::vector<TextureFileDesc> files;
+    for (const char* directory : kTextureDirectories)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(directory, fullpath) == false) continue;
+        for (const auto& entry : fs::directory_iterator(fullpath))
+        {
+            std::string filename = entry.path().string();
+            for (const char* ext : kImageExtensions)
+            {
+                if (hasSuffix(filename, ext, false))
+                {
+                    TextureFileDesc file;
+                    file.filename = filename;
+                    file.loadAsSrgb = true;
+                    files.push_back(file);
+                    break;
+                }
+            }
+        }
+    }
+    return files;
+}
+
+std::vector<uint32_t> TextureDecodeTest::getThreadCounts()
+{
+    const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> counts;
+    for (uint32_t count = 1; count < hardwareThreads; count *= 2) counts.push_back(count);
+    counts.push_back(hardwareThreads);
+    return counts;
+}
+
+testing_func(TextureDecodeTest, TestDecodeByThreadCount)
+{
+    std::vector<TextureFileDesc> files = findSceneTextures();
+    if (files.empty()) return test_fail("Can't find the scene textures");
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << "createTexturesFromFiles: " << files.size() << " scene textures with mips\n";
+    const uint32_t oldThreadCount = getTextureDecodeThreadCount();
+    std::vector<Texture::SharedPtr> reference;
+    double referenceMs = 0;
+    for (uint32_t threadCount : getThreadCounts())
+    {
+        setTextureDecodeThreadCount(threadCount);
+        std::vector<Texture::SharedPtr> textures;
+        double ms = TestHelper::measureFastestMs(2, [&]() { textures = createTexturesFromFiles(files, true); });
+
+        // Every thread count has to produce the same textures as decoding on the calling thread
+        if (reference.empty())
+        {
+            reference = textures;
+            referenceMs = ms;
+        }
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            if (isSameTexture(textures[i].get(), reference[i].get()) == false)
+            {
+                setTextureDecodeThreadCount(oldThreadCount);
+                return test_fail(files[i].filename + " differs when decoded with " + std::to_string(threadCount) + " threads");
+            }
+        }
+        ss << "  " << threadCount << " threads: " << ms << " ms, " << std::setprecision(2) << referenceMs / ms << "x" << std::setprecision(1) << "\n";
+    }
+    setTextureDecodeThreadCount(oldThreadCount);
+
+    uint32_t loaded = 0;
+    for (const auto& pTex : reference) loaded += pTex ? 1 : 0;
+    if (loaded == 0) return test_fail("None of the scene textures loaded");
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(TextureDecodeTest, TestDuplicateFiles)
+{
+    std::vector<TextureFileDesc> files = findSceneTextures();
+    if (files.size() < 2) return test_fail("Can't find the scene textures");
+
+    // The same file twice shares a texture, the same file in another color space doesn't
+    std::vector<TextureFileDesc> batch = { files[0], files[1], files[0], files[0] };
+    batch[3].loadAsSrgb = false;
+    std::vector<Texture::SharedPtr> textures = createTexturesFromFiles(batch, false);
+    if (textures.size() != batch.size()) return test_fail("Expected one texture per file");
+    if (textures[0] == nullptr || textures[0] != textures[2]) return test_fail("A file requested twice wasn't shared");
+    if (textures[0] == textures[1] || textures[0] == textures[3]) return test_fail("Different files or color spaces share a texture");
+    return test_pass();
+}
+
+testing_func(TextureDecodeTest, TestImportByThreadCount)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    const uint32_t oldThreadCount = getTextureDecodeThreadCount();
+    for (const char* scene : kScenes)
+    {
+        std::string fullpath;
+        if (findFileInDataDirectories(scene, fullpath) == false || TestHelper::hasSceneModels(fullpath) == false)
+        {
+            ss << "Scene import: " << scene << " skipped, its model isn't there\n";
+            continue;
+        }
+
+        ss << "Scene import: " << scene << "\n";
+        double referenceMs = 0;
+        for (uint32_t threadCount : getThreadCounts())
+        {
+            setTextureDecodeThreadCount(threadCount);
+            auto start = CpuTimer::getCurrentTimePoint();
+            Scene::SharedPtr pScene = Scene::loadFromFile(fullpath);
+            double ms = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            if (pScene == nullptr || pScene->getModelCount() == 0)
+            {
+                setTextureDecodeThreadCount(oldThreadCount);
+                return test_fail("Can't load " + std::string(scene));
+            }
+            if (referenceMs == 0) referenceMs = ms;
+            ss << "  " << threadCount << " threads: " << ms << " ms, " << std::setprecision(2) << referenceMs / ms << "x" << std::setprecision(1) << "\n";
+        }
+    }
+    setTextureDecodeThreadCount(oldThreadCount);
+    logInfo(ss.str());
+    return test_pass();
+}
+
+int main()
+{
+    TextureDecodeTest tdt;
+    tdt.init(true);
+    tdt.run();
+    return 0;
+}
@@ -0,0 +1,231 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TransformStoreTest.h"
+#include "TestHelper.h"
+#include "glm/gtx/transform.hpp"
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace
+{
+    const uint32_t kFrameCount = 16;
+
+    // Each instance is a root with a few children, like the mesh instances of a model instance
+    const uint32_t kInstanceCounts[] = { 1000, 10000, 100000 };
+    const uint32_t kChildrenPerInstance = 3;
+
+    // Largest allowed difference between a matrix and its reference, relative to the reference
+    const float kTolerance = 1e-3f;
+}
+
+void TransformStoreTest::addTests()
+{
+    addTestToList<TestUpdate>();
+    addTestToList<TestSceneChanges>();
+}
+
+void TransformStoreTest::onInit()
+{
+}
+
+testing_func(TransformStoreTest, TestUpdate)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+
+    for (uint32_t instanceCount : kInstanceCounts)
+    {
+        std::mt19937 rng(instanceCount);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        std::vector<glm::vec3> positions(instanceCount);
+        std::vector<glm::mat4> childLocals(kChildrenPerInstance);
+        for (auto& p : positions) p = glm::vec3(position(rng), position(rng), position(rng));
+        for (auto& m : childLocals) m = glm::translate(glm::vec3(unit(rng), unit(rng), unit(rng))) * glm::scale(glm::vec3(0.5f + unit(rng)));
+
+        TransformStore::SharedPtr pStore = TransformStore::create();
+        auto start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < instanceCount; i++)
+        {
+            uint32_t root = pStore->addNode(glm::translate(positions[i]));
+            for (const auto& local : childLocals) pStore->addNode(local, root);
+        }
+        pStore->update();
+        pStore->upload();
+        double createMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        // All the roots move every frame
+        std::vector<glm::mat4> rootLocals(instanceCount);
+        double setMs = 0, updateMs = 0, uploadMs = 0, referenceMs = 0;
+        uint64_t uploadedBytes = 0;
+        volatile float sink = 0;            // Keeps the reference computation from being optimized away
+        for (uint32_t frame = 0; frame < kFrameCount; frame++)
+        {
+            for (uint32_t i = 0; i < instanceCount; i++)
+            {
+                rootLocals[i] = glm::translate(positions[i]) * glm::rotate(0.05f * (frame + 1) + i, glm::vec3(0, 1, 0));
+            }
+
+            auto t0 = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < instanceCount; i++) pStore->setLocalMatrix(i * (kChildrenPerInstance + 1), rootLocals[i]);
+            auto t1 = CpuTimer::getCurrentTimePoint();
+            pStore->update();
+            auto t2 = CpuTimer::getCurrentTimePoint();
+            pStore->upload();
+            auto t3 = CpuTimer::getCurrentTimePoint();
+            setMs += CpuTimer::calcDuration(t0, t1);
+            updateMs += CpuTimer::calcDuration(t1, t2);
+            uploadMs += CpuTimer::calcDuration(t2, t3);
+            uploadedBytes += pStore->getUploadStats().uploadedBytes;
+
+            // What SceneRenderer does for every drawn mesh instance when the matrices are not read from a store
+            auto r0 = CpuTimer::getCurrentTimePoint();
+            float checksum = 0;
+            for (uint32_t i = 0; i < instanceCount; i++)
+            {
+                uint32_t root = i * (kChildrenPerInstance + 1);
+                const glm::mat4& rootWorld = pStore->getLocalMatrix(root);
+                const glm::mat4& rootPrevWorld = pStore->getPrevLocalMatrix(root);
+                for (uint32_t c = 0; c < kChildrenPerInstance; c++)
+                {
+                    glm::mat4 world = rootWorld * childLocals[c];
+                    glm::mat4 prevWorld = rootPrevWorld * childLocals[c];
+                    glm::mat3x4 worldInvTranspose = transpose(inverse(glm::mat3(world)));
+                    checksum += world[3][0] + prevWorld[3][1] + worldInvTranspose[2][2];
+                }
+            }
+            sink = checksum;
+            referenceMs += CpuTimer::calcDuration(r0, CpuTimer::getCurrentTimePoint());
+        }
+
+        // Check the store against the reference
+        float maxError = 0;
+        for (uint32_t node = 0; node < pStore->getNodeCount(); node++)
+        {
+            uint32_t parent = pStore->getParent(node);
+            if (parent == TransformStore::kInvalidNode) continue;
+            glm::mat4 world = pStore->getWorldMatrix(parent) * pStore->getLocalMatrix(node);
+            glm::mat4 prevWorld = pStore->getPrevWorldMatrix(parent) * pStore->getPrevLocalMatrix(node);
+            glm::mat3 normal = transpose(inverse(glm::mat3(world)));
+            maxError = std::max(maxError, TestHelper::maxRelativeDifference(pStore->getWorldMatrix(node), world));
+            maxError = std::max(maxError, TestHelper::maxRelativeDifference(pStore->getPrevWorldMatrix(node), prevWorld));
+            maxError = std::max(maxError, TestHelper::maxRelativeDifference(glm::mat4(glm::mat3(pStore->getNormalMatrix(node))), glm::mat4(normal)));
+        }
+        if (maxError > kTolerance)
+        {
+            return test_fail("The matrices of " + std::to_string(instanceCount) + " instances differ from the reference by " + std::to_string(maxError));
+        }
+
+        ss << "TransformStore: " << instanceCount << " instances (" << pStore->getNodeCount() << " nodes), all moved every frame. First update " << createMs << " ms, per frame: set "
+           << setMs / kFrameCount << " ms, update " << updateMs / kFrameCount << " ms, upload " << uploadMs / kFrameCount << " ms (" << uploadedBytes / (1024.0 * kFrameCount) << " KB). "
+           << "Per-draw reference " << referenceMs / kFrameCount << " ms\n";
+    }
+    logInfo(ss.str());
+    return test_pass();
+}
+
+testing_func(TransformStoreTest, TestSceneChanges)
+{
+    // Models without meshes, so the store only holds the model instances' root nodes
+    Scene::SharedPtr pScene = Scene::create();
+    Model::SharedPtr pModelA = Model::create();
+    Model::SharedPtr pModelB = Model::create();
+    for (uint32_t i = 0; i < 3; i++) pScene->addModelInstance(pModelA, "A" + std::to_string(i), glm::vec3((float)i, 0, 0));
+    for (uint32_t i = 0; i < 2; i++) pScene->addModelInstance(pModelB, "B" + std::to_string(i), glm::vec3(0, (float)i, 0));
+    pScene->update(0);
+    const TransformStore* pStore = pScene->getTransformStore().get();
+    if (pStore == nullptr || pStore->getNodeCount() != 5 || pScene->isTransformStoreCurrent() == false)
+    {
+        return test_fail("The store doesn't hold the scene's instances after update()");
+    }
+
+    // The setters and move() push the instance's node, so update() only refreshes that node
+    const Scene::ModelInstance::SharedPtr& pSet = pScene->getModelInstance(1, 1);
+    pSet->setTranslation(glm::vec3(0, 0, 5), true);
+    pScene->update(0);
+    if (pStore->getUpdatedNodes() != std::vector<uint32_t>{ 4 } || pStore->getWorldMatrix(4) != pSet->getTransformMatrix())
+    {
+        return test_fail("update() didn't refresh only the node of the instance moved by setTranslation()");
+    }
+
+    const Scene::ModelInstance::SharedPtr& pMoved = pScene->getModelInstance(0, 0);
+    pMoved->move(glm::vec3(1, 2, 3), glm::vec3(1, 2, 4), glm::vec3(0, 1, 0));
+    pScene->update(0);
+    if (pStore->getUpdatedNodes() != std::vector<uint32_t>{ 0 } || pStore->getWorldMatrix(0) != pMoved->getTransformMatrix() || pStore->getPrevWorldMatrix(0) != pMoved->getPrevTransformMatrix())
+    {
+        return test_fail("update() didn't refresh only the node of the instance moved by move()");
+    }
+
+    pScene->update(0);
+    if (pStore->getUpdatedNodes().empty() == false)
+    {
+        return test_fail("update() refreshed nodes although no instance changed");
+    }
+
+    // Removing an instance rebuilds the hierarchy, and the removed instance doesn't push its old node anymore
+    Scene::ModelInstance::SharedPtr pRemoved = pScene->getModelInstance(0, 2);
+    pScene->deleteModelInstance(0, 2);
+    if (pScene->isTransformStoreCurrent())
+    {
+        return test_fail("The store is reported as current after an instance was removed");
+    }
+    pScene->update(0);
+    if (pStore->getNodeCount() != 4 || pScene->isTransformStoreCurrent() == false || pStore->getWorldMatrix(2) != pScene->getModelInstance(1, 0)->getTransformMatrix())
+    {
+        return test_fail("update() didn't rebuild the store after an instance was removed");
+    }
+    pRemoved->setTranslation(glm::vec3(7, 0, 0), true);
+    pScene->update(0);
+    if (pStore->getUpdatedNodes().empty() == false)
+    {
+        return test_fail("A removed instance still refreshes the store");
+    }
+
+    // Adding an instance of a model already in the scene also rebuilds it
+    pScene->addModelInstance(pModelA, "A3", glm::vec3(3, 0, 0));
+    if (pScene->isTransformStoreCurrent())
+    {
+        return test_fail("The store is reported as current after an instance was added");
+    }
+    pScene->update(0);
+    if (pStore->getNodeCount() != 5 || pStore->getWorldMatrix(2) != pScene->getModelInstance(0, 2)->getTransformMatrix())
+    {
+        return test_fail("update() didn't rebuild the store after an instance was added");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    TransformStoreTest tst;
+    tst.init(true);
+    tst.run();
+    return 0;
+}
@@ -0,0 +1,215 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "UserAreaLightTest.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include <fstream>
+
+namespace
+{
+    // Scenes describing rectangular area lights in their user_defined block, relative to the directory given by SCENE_DATA_DIR, which the project sets to CommonPasses/Data
+    const char* kScenes[] =
+    {
+        "Scenes/forest/forest10.fscene",
+        "Scenes/forest/forest20.fscene",
+        "Scenes/forest/forest40.fscene",
+        "Scenes/forest/forest80.fscene",
+    };
+
+    // Largest allowed difference between the light data and the description, relative to the compared value
+    const float kTolerance = 1e-4f;
+
+    bool readVec(const rapidjson::Value& block, const std::string& key, float* pVec, uint32_t size)
+    {
+        auto it = block.FindMember(key.c_str());
+        if (it == block.MemberEnd() || it->value.IsArray() == false || it->value.Size() != size) return false;
+        for (uint32_t i = 0; i < size; i++)
+        {
+            pVec[i] = it->value[i].GetFloat();
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool isClose(const T& a, const T& b)
+    {
+        return glm::length(a - b) <= kTolerance * std::max(1.0f, glm::length(b));
+    }
+
+    bool isClose(float a, float b)
+    {
+        return std::abs(a - b) <= kTolerance * std::max(1.0f, std::abs(b));
+    }
+}
+
+void UserAreaLightTest::addTests()
+{
+    addTestToList<TestOffByDefault>();
+    addTestToList<TestLightsMatchDescription>();
+}
+
+void UserAreaLightTest::onInit()
+{
+    addDataDirectory(SCENE_DATA_DIR);
+}
+
+std::string UserAreaLightTest::prepareScene(const std::string& scene, std::vector<LightDesc>& descs, std::string& error)
+{
+    std::string fullpath;
+    if (findFileInDataDirectories(scene, fullpath) == false)
+    {
+        error = "Can't find " + scene;
+        return "";
+    }
+
+    rapidjson::Document document;
+    document.Parse(readFile(fullpath).c_str());
+    if (document.HasParseError() || document.HasMember("user_defined") == false || document["user_defined"].HasMember("numLights") == false)
+    {
+        error = "Can't read the user-defined lights of " + scene;
+        return "";
+    }
+
+    const rapidjson::Value& block = document["user_defined"];
+    descs.resize(block["numLights"].GetUint());
+    for (uint32_t i = 0; i < (uint32_t)descs.size(); i++)
+    {
+        const std::string prefix = "l" + std::to_string(i) + "_";
+        LightDesc& desc = descs[i];
+        if (!readVec(block, prefix + "power", &desc.power[0], 3) || !readVec(block, prefix + "extent", &desc.extent[0], 2) || !readVec(block, prefix + "center", &desc.center[0], 3) ||
+            !readVec(block, prefix + "left", &desc.left[0], 3) || !readVec(block, prefix + "up", &desc.up[0], 3))
+        {
+            error = scene + ": light " + std::to_string(i) + " is incomplete";
+            return "";
+        }
+    }
+
+    document.RemoveMember("models");
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    document.Accept(writer);
+
+    std::string filename = getExecutableDirectory() + "/UserAreaLightTest_" + getFilenameFromPath(scene);
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file << buffer.GetString();
+    return filename;
+}
+
+std::vector<Light::SharedPtr> UserAreaLightTest::getAreaRectLights(const Scene* pScene)
+{
+    std::vector<Light::SharedPtr> lights;
+    for (const auto& pLight : pScene->getLights())
+    {
+        if (pLight->getType() == LightAreaRect)
+        {
+            lights.push_back(pLight);
+        }
+    }
+    return lights;
+}
+
+testing_func(UserAreaLightTest, TestOffByDefault)
+{
+    for (const char* scene : kScenes)
+    {
+        std::string error;
+        std::vector<LightDesc> descs;
+        std::string filename = prepareScene(scene, descs, error);
+        if (filename.empty()) return test_fail(error);
+
+        Scene::SharedPtr pScene = Scene::loadFromFile(filename);
+        if (pScene == nullptr) return test_fail(std::string("Can't load ") + scene);
+
+        // The block is still read as user variables
+        if (getAreaRectLights(pScene.get()).size() != 0)
+        {
+            return test_fail(std::string(scene) + ": area lights were created without Scene::LoadFlags::CreateUserAreaLights");
+        }
+        if (pScene->getUserVariable("numLights").type == Scene::UserVariable::Type::Unknown)
+        {
+            return test_fail(std::string(scene) + ": the user-defined block was not loaded");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(UserAreaLightTest, TestLightsMatchDescription)
+{
+    for (const char* scene : kScenes)
+    {
+        std::string error;
+        std::vector<LightDesc> descs;
+        std::string filename = prepareScene(scene, descs, error);
+        if (filename.empty()) return test_fail(error);
+
+        Scene::SharedPtr pDefault = Scene::loadFromFile(filename);
+        Scene::SharedPtr pScene = Scene::loadFromFile(filename, Model::LoadFlags::None, Scene::LoadFlags::CreateUserAreaLights);
+        if (pDefault == nullptr || pScene == nullptr) return test_fail(std::string("Can't load ") + scene);
+
+        // The flag only adds the described lights
+        std::vector<Light::SharedPtr> lights = getAreaRectLights(pScene.get());
+        if (lights.size() != descs.size() || pScene->getLightCount() != pDefault->getLightCount() + descs.size())
+        {
+            return test_fail(std::string(scene) + ": " + std::to_string(lights.size()) + " area lights were created, but " + std::to_string(descs.size()) + " are described");
+        }
+
+        for (uint32_t i = 0; i < (uint32_t)lights.size(); i++)
+        {
+            const LightDesc& desc = descs[i];
+            const LightData& data = lights[i]->getData();
+            const std::string name = std::string(scene) + ", light " + std::to_string(i);
+
+            // The rectangle spans the extent along the left direction and the orthogonalized up direction, and emits along cross(left, up)
+            glm::vec3 left = glm::normalize(desc.left);
+            glm::vec3 up = glm::normalize(desc.up - left * glm::dot(desc.up, left));
+            if (!isClose(data.posW, desc.center)) return test_fail(name + ": the center doesn't match");
+            if (!isClose(data.dirW, glm::cross(left, up))) return test_fail(name + ": the normal doesn't match");
+            if (!isClose(data.tangent, left * (0.5f * desc.extent.x)) || !isClose(data.bitangent, up * (0.5f * desc.extent.y)))
+            {
+                return test_fail(name + ": the edges don't match");
+            }
+            if (!isClose(data.surfaceArea, desc.extent.x * desc.extent.y)) return test_fail(name + ": the area doesn't match");
+
+            // All the described power leaves the light
+            if (!isClose(lights[i]->getPower(), luminance(desc.power)))
+            {
+                return test_fail(name + ": the power is " + std::to_string(lights[i]->getPower()) + ", but " + std::to_string(luminance(desc.power)) + " is described");
+            }
+        }
+    }
+    return test_pass();
+}
+
+int main()
+{
+    UserAreaLightTest ualt;
+    ualt.init(true);
+    ualt.run();
+    return 0;
+}
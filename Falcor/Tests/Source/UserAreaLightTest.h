@@ -0,0 +1,61 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+
+class UserAreaLightTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override;
+    register_testing_func(TestOffByDefault);
+    register_testing_func(TestLightsMatchDescription);
+
+    /** A rectangular light as described in a scene's user_defined block
+    */
+    struct LightDesc
+    {
+        glm::vec3 power;
+        glm::vec2 extent;
+        glm::vec3 center;
+        glm::vec3 left;
+        glm::vec3 up;
+    };
+
+    /** Read the area lights a forest scene describes in its user_defined block, and write a copy of the scene without its models next to the test's executable.
+        The lights don't depend on the models, and the forest model is not part of the repository.
+        \param[out] descs The described lights
+        \param[out] error Set to the reason when the scene can't be read
+        \return The filename of the copy, or an empty string on failure
+    */
+    static std::string prepareScene(const std::string& scene, std::vector<LightDesc>& descs, std::string& error);
+
+    /** Get the lights of a scene which are rectangular area lights, in the order they were added
+    */
+    static std::vector<Light::SharedPtr> getAreaRectLights(const Scene* pScene);
+};
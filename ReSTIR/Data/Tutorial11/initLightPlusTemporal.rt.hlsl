@@ -64,6 +64,17 @@ Texture2D<float4>   gDiffuseMatl;   // G-buffer diffuse material (RGB) and opaci
 RWTexture2D<float4> gReservoirPrev;		// For ReSTIR - need to be read-write because it is also updated in the shader as well
 RWTexture2D<float4> gReservoirCurr;		// For ReSTIR - need to be read-write because it is also updated in the shader as wellRWTexture2D<float4> gOutput;        // Output to store shaded result
 RWTexture2D<float4> gIndirectOutput; //For output from indirect illumination 
+RWTexture2D<float2> gReservoirSamplePrev;	// For ReSTIR - the point each reservoir picked on its light (see updateReservoir())
+RWTexture2D<float2> gReservoirSampleCurr;
+
+// For ReSTIR - one bit per light, set for the lights which changed since the previous frame's reservoirs were picked
+ByteAddressBuffer   gChangedLightMask;
+
+// Did a light change (or disappear) since the previous frame?  Reservoirs which picked it have a stale weight and visibility.
+bool lightChanged(uint index)
+{
+	return index >= uint(gLightsCount) || ((gChangedLightMask.Load((index >> 5) * 4) >> (index & 31)) & 1) != 0;
+}
 
 // Our environment map, used for the miss shader for indirect rays
 Texture2D<float4> gEnvMap;
@@ -100,14 +111,15 @@ void IndirectClosestHit(inout IndirectRayPayload rayData, BuiltInTriangleInterse
 	// Run a helper functions to extract Falcor scene data for shading
 	ShadingData shadeData = getHitShadingData(attribs);
 
-	// Pick a random light from our scene to shoot a shadow ray towards	
+	// Pick a random light from our scene to shoot a shadow ray towards, and a random point on it
 	int lightToSample = min(int(nextRand(rayData.rndSeed) * gLightsCount), gLightsCount - 1);
+	float2 lightSample = float2(nextRand(rayData.rndSeed), nextRand(rayData.rndSeed));
 
 	// Query the scene to find info about the randomly selected light
 	float distToLight;
 	float3 lightIntensity;
 	float3 toLight;
-	getLightData(lightToSample, shadeData.posW, toLight, lightIntensity, distToLight);
+	getLightData(lightToSample, shadeData.posW, lightSample, toLight, lightIntensity, distToLight);
 
 	// Compute our lambertion term (L dot N)
 	float LdotN = saturate(dot(shadeData.N, toLight));
@@ -175,6 +187,7 @@ void LambertShadowsRayGen()
 		float LdotN;			// Lambert term
 
 		float4 prev_reservoir = float4(0.f); // initialize previous reservoir
+		float2 prev_sample = float2(0.5f);   // and the point it picked on its light
 
 		// if not first time fill with previous frame reservoir
 		if (!gInitLight) {
@@ -186,10 +199,18 @@ void LambertShadowsRayGen()
 
 			if (prevIndex.x >= 0 && prevIndex.x < launchDim.x && prevIndex.y >= 0 && prevIndex.y < launchDim.y) {
 				prev_reservoir = gReservoirPrev[prevIndex];
+				prev_sample = gReservoirSamplePrev[prevIndex];
+			}
+
+			// Start over if the light the previous reservoir picked has changed since
+			if (lightChanged(uint(prev_reservoir.y))) {
+				prev_reservoir = float4(0.f);
 			}
 		}
 
 		float4 reservoir = float4(0.f);
+		float2 reservoirSample = float2(0.5f);
+		float2 lightSample;
 		float p_hat;
 
 		// initialize previous reservoir if this is the first iteraation
@@ -202,12 +223,13 @@ void LambertShadowsRayGen()
 		// Generate Initial Candidates - Algorithm 3 of ReSTIR paper
 		for (int i = 0; i < min(gLightsCount, 32); i++) {
 			lightToSample = min(int(nextRand(randSeed) * gLightsCount), gLightsCount - 1);
-			getLightData(lightToSample, worldPos.xyz, toLight, lightIntensity, distToLight);
+			lightSample = float2(nextRand(randSeed), nextRand(randSeed)); // the point on area lights
+			getLightData(lightToSample, worldPos.xyz, lightSample, toLight, lightIntensity, distToLight);
 			LdotN = saturate(dot(worldNorm.xyz, toLight)); // lambertian term
 
 			// p_hat of the light is f * Le * G / pdf
 			p_hat = length(difMatlColor.xyz / M_PI * lightIntensity * LdotN / (distToLight * distToLight)); // technically p_hat is divided by pdf, but point light pdf is 1
-			reservoir = updateReservoir(reservoir, lightToSample, p_hat, randSeed);
+			reservoir = updateReservoir(reservoir, lightToSample, lightSample, p_hat, randSeed, reservoirSample);
 		}
 
 		// ----------------------------------------------------------------------------------------------
@@ -216,7 +238,7 @@ void LambertShadowsRayGen()
 
 		// Evaluate visibility for initial candidate and set r.W value
 		lightToSample = reservoir.y;
-		getLightData(lightToSample, worldPos.xyz, toLight, lightIntensity, distToLight);
+		getLightData(lightToSample, worldPos.xyz, reservoirSample, toLight, lightIntensity, distToLight);
 		LdotN = saturate(dot(worldNorm.xyz, toLight));
 		p_hat = length(difMatlColor.xyz / M_PI * lightIntensity * LdotN / (distToLight * distToLight));
 		reservoir.w = (1.f / max(p_hat, 0.0001f)) * (reservoir.x / max(reservoir.z, 0.0001f));
@@ -230,28 +252,30 @@ void LambertShadowsRayGen()
 		// ----------------------------------------------------------------------------------------------
 		if (gTemporalReuse) {
 			float4 temporal_reservoir = float4(0.f);
+			float2 temporal_sample = reservoirSample;
 
 			// combine current reservoir
-			temporal_reservoir = updateReservoir(temporal_reservoir, reservoir.y, p_hat * reservoir.w * reservoir.z, randSeed);
+			temporal_reservoir = updateReservoir(temporal_reservoir, reservoir.y, reservoirSample, p_hat * reservoir.w * reservoir.z, randSeed, temporal_sample);
 
 			// combine previous reservoir
-			getLightData(prev_reservoir.y, worldPos.xyz, toLight, lightIntensity, distToLight);
+			getLightData(prev_reservoir.y, worldPos.xyz, prev_sample, toLight, lightIntensity, distToLight);
 			LdotN = saturate(dot(worldNorm.xyz, toLight));
 			p_hat = length(difMatlColor.xyz / M_PI * lightIntensity * LdotN / (distToLight * distToLight));
 			prev_reservoir.z = min(20.f * reservoir.z, prev_reservoir.z);
-			temporal_reservoir = updateReservoir(temporal_reservoir, prev_reservoir.y, p_hat * prev_reservoir.w * prev_reservoir.z, randSeed);
+			temporal_reservoir = updateReservoir(temporal_reservoir, prev_reservoir.y, prev_sample, p_hat * prev_reservoir.w * prev_reservoir.z, randSeed, temporal_sample);
 
 			// set M value
 			temporal_reservoir.z = reservoir.z + prev_reservoir.z;
 
 			// set W value
-			getLightData(temporal_reservoir.y, worldPos.xyz, toLight, lightIntensity, distToLight);
+			getLightData(temporal_reservoir.y, worldPos.xyz, temporal_sample, toLight, lightIntensity, distToLight);
 			LdotN = saturate(dot(worldNorm.xyz, toLight));
 			p_hat = length(difMatlColor.xyz / M_PI * lightIntensity * LdotN / (distToLight * distToLight));
 			temporal_reservoir.w = (1.f / max(p_hat, 0.0001f)) * (temporal_reservoir.x / max(temporal_reservoir.z, 0.0001f));
 
 			// set current reservoir to the combined temporal reservoir
 			reservoir = temporal_reservoir;
+			reservoirSample = temporal_sample;
 		}
 
 		// ----------------------------------------------------------------------------------------------
@@ -295,6 +319,7 @@ void LambertShadowsRayGen()
 
 		// Save the computed reserrvoir back into the buffer
 		gReservoirCurr[launchIndex] = reservoir;
+		gReservoirSampleCurr[launchIndex] = reservoirSample;
 		gIndirectOutput[launchIndex] = float4(0.f); //Intialize to 0 
 		if (gDoIndirectGI)
 		{
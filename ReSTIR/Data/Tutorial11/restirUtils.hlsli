@@ -19,12 +19,15 @@
 // Define pi
 #define M_1_PI  0.318309886183790671538
 
-float4 updateReservoir(float4 reservoir, int lightToSample, float weight, uint randSeed) {
+// The sample kept by a reservoir is a light plus a point on it.  The point is stored apart from the reservoir, in reservoirSample,
+//     as the two uniform random numbers it was picked with, so reusing the reservoir evaluates the same point on area lights.
+float4 updateReservoir(float4 reservoir, int lightToSample, float2 lightSample, float weight, uint randSeed, inout float2 reservoirSample) {
 	// Algorithm 2 of ReSTIR paper
 	reservoir.x = reservoir.x + weight; // r.w_sum
 	reservoir.z = reservoir.z + 1.0f; // r.M
 	if (nextRand(randSeed) < weight / reservoir.x) {
 		reservoir.y = lightToSample; // r.y
+		reservoirSample = lightSample;
 	}
 
 	return reservoir;
@@ -32,7 +35,8 @@ float4 updateReservoir(float4 reservoir, int lightToSample, float weight, uint r
 
 // A helper to extract important light data from internal Falcor data structures.  What's going on isn't particularly
 //     important -- any framework you use will expose internal scene data in some way.  Use your framework's utilities.
-void getLightData(in int index, in float3 hitPos, out float3 toLight, out float3 lightIntensity, out float distToLight)
+//     u picks the point on area lights, as two uniform random numbers.  (0.5, 0.5) is the light's center.
+void getLightData(in int index, in float3 hitPos, in float2 u, out float3 toLight, out float3 lightIntensity, out float distToLight)
 {
 	// Use built-in Falcor functions and data structures to fill in a LightSample data structure
 	//   -> See "Lights.slang" for it's definition
@@ -42,6 +46,13 @@ void getLightData(in int index, in float3 hitPos, out float3 toLight, out float3
 	if (gLights[index].type == LightDirectional)
 		ls = evalDirectionalLight(gLights[index], hitPos);
 
+	// A rectangular area light?  Sample a point on it.  The sample's intensity is already divided by its pdf.
+	else if (gLights[index].type == LightAreaRect)
+	{
+		float pdf;
+		ls = sampleAreaRectLight(gLights[index], hitPos, u, pdf);
+	}
+
 	// No?  Must be a point light.
 	else
 		ls = evalPointLight(gLights[index], hitPos);
@@ -29,6 +29,8 @@ Texture2D<float4>   gDiffuseMatl;   // G-buffer diffuse material (RGB) and opaci
 
 RWTexture2D<float4> gReservoirCurr;			// For ReSTIR - need to be read-write because it is also updated in the shader as well
 RWTexture2D<float4> gReservoirSpatial;		// For ReSTIR - need to be read-write because it is also updated in the shader as well
+RWTexture2D<float2> gReservoirSampleCurr;		// For ReSTIR - the point each reservoir picked on its light (see updateReservoir())
+RWTexture2D<float2> gReservoirSampleSpatial;
 
 // How do we shade our g-buffer and generate shadow rays?
 [shader("raygeneration")]
@@ -50,6 +52,7 @@ void LambertShadowsRayGen()
 	uint randSeed = initRand(launchIndex.x + launchIndex.y * launchDim.x, gFrameCount, 16);
 
 	float4 reservoirNew = float4(0.f);
+	float2 sampleNew = float2(0.5f);
 
 	// Our camera sees the background if worldPos.w is 0, only do diffuse shading elsewhere
 	if (worldPos.w != 0.0f && gSpatialReuse)
@@ -69,17 +72,19 @@ void LambertShadowsRayGen()
 		uint2 neighborOffset;
 		uint2	neighborIndex;
 		float4 neighborReservoir;
+		float2 neighborSample;
 
 		int neighborsCount = 15;
 		int neighborsRange = 5; // Want to sample neighbors within [-neighborsRange, neighborsRange] offset
 
 		// Combine with reservoir at current pixel -------------------------------------------------------
 		float4 reservoir = gReservoirCurr[launchIndex];
-		getLightData(reservoir.y, worldPos.xyz, toLight, lightIntensity, distToLight);
+		float2 reservoirSample = gReservoirSampleCurr[launchIndex];
+		getLightData(reservoir.y, worldPos.xyz, reservoirSample, toLight, lightIntensity, distToLight);
 		LdotN = saturate(dot(worldNorm.xyz, toLight)); // lambertian term
 		p_hat = length(difMatlColor.xyz / M_PI * lightIntensity * LdotN / (distToLight * distToLight));
 
-		reservoirNew = updateReservoir(reservoirNew, reservoir.y, p_hat * reservoir.w * reservoir.z, randSeed);
+		reservoirNew = updateReservoir(reservoirNew, reservoir.y, reservoirSample, p_hat * reservoir.w * reservoir.z, randSeed, sampleNew);
 
 		float lightSamplesCount = reservoir.z;
 		// Combined logic of picking random neighbor and combine reservoirs
@@ -100,12 +105,13 @@ void LambertShadowsRayGen()
 			neighborIndex.y = max(0, min(launchDim.y - 1, launchIndex.y + neighborOffset.y));
 
 			neighborReservoir = gReservoirCurr[neighborIndex];
+			neighborSample = gReservoirSampleCurr[neighborIndex];
 
-			getLightData(neighborReservoir.y, worldPos.xyz, toLight, lightIntensity, distToLight);
+			getLightData(neighborReservoir.y, worldPos.xyz, neighborSample, toLight, lightIntensity, distToLight);
 			LdotN = saturate(dot(worldNorm.xyz, toLight)); // lambertian term
 			p_hat = length(difMatlColor.xyz / M_PI * lightIntensity * LdotN / (distToLight * distToLight));
 
-			reservoirNew = updateReservoir(reservoirNew, neighborReservoir.y, p_hat * neighborReservoir.w * neighborReservoir.z, randSeed);
+			reservoirNew = updateReservoir(reservoirNew, neighborReservoir.y, neighborSample, p_hat * neighborReservoir.w * neighborReservoir.z, randSeed, sampleNew);
 
 			lightSamplesCount += neighborReservoir.z;
 		}
@@ -114,7 +120,7 @@ void LambertShadowsRayGen()
 		reservoirNew.z = lightSamplesCount;
 
 		// Update the adjusted final weight of the current reservoir ------------------------------------
-		getLightData(reservoirNew.y, worldPos.xyz, toLight, lightIntensity, distToLight);
+		getLightData(reservoirNew.y, worldPos.xyz, sampleNew, toLight, lightIntensity, distToLight);
 		LdotN = saturate(dot(worldNorm.xyz, toLight)); // lambertian term
 		p_hat = length(difMatlColor.xyz / M_PI * lightIntensity * LdotN / (distToLight * distToLight));
 
@@ -122,4 +128,5 @@ void LambertShadowsRayGen()
 	}
 
 	gReservoirSpatial[launchIndex] = reservoirNew;
+	gReservoirSampleSpatial[launchIndex] = sampleNew;
 }
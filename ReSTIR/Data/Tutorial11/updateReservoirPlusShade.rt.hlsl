@@ -45,6 +45,8 @@ Texture2D<float4>   gDiffuseMatl;   // G-buffer diffuse material (RGB) and opaci
 
 RWTexture2D<float4> gReservoirPrev;			// For ReSTIR - need to be read-write because it is also updated in the shader as well
 Texture2D<float4>	gReservoirSpatial;	
+RWTexture2D<float2> gReservoirSamplePrev;		// For ReSTIR - the point each reservoir picked on its light (see updateReservoir())
+Texture2D<float2>	gReservoirSampleSpatial;
 
 RWTexture2D<float4> gIndirectOutput; //For output from indirect illumination 
 
@@ -68,6 +70,8 @@ void LambertShadowsRayGen()
 
 	float4 reservoir = gReservoirSpatial[launchIndex];
 	gReservoirPrev[launchIndex] = reservoir; // Update reservoir value to be used for next pass
+	float2 reservoirSample = gReservoirSampleSpatial[launchIndex];
+	gReservoirSamplePrev[launchIndex] = reservoirSample;
 
 	// Our camera sees the background if worldPos.w is 0, only do diffuse shading elsewhere
 	if (worldPos.w != 0.0f)
@@ -82,7 +86,7 @@ void LambertShadowsRayGen()
 		float shadowMult; // Visibility term 
 		
 		lightToSample = reservoir.y;
-		getLightData(lightToSample, worldPos.xyz, toLight, lightIntensity, distToLight);
+		getLightData(lightToSample, worldPos.xyz, reservoirSample, toLight, lightIntensity, distToLight);
 		LdotN = saturate(dot(worldNorm.xyz, toLight));
 		shadowMult = float(gLightsCount) * shadowRayVisibility(worldPos.xyz, toLight, gMinT, distToLight);
 		shadeColor = shadowMult * reservoir.w * LdotN * lightIntensity * difMatlColor.rgb / M_PI;
@@ -22,9 +22,13 @@ bool InitLightPlusTemporalPass::initialize(RenderContext* pRenderContext, Resour
 	mpResManager = pResManager;
 	mpResManager->requestTextureResources({ "WorldPosition", "WorldNormal", "MaterialDiffuse", "ReservoirPrev",
 											"ReservoirCurr", "IndirectOutput" });	
+	mpResManager->requestTextureResources({ "ReservoirSamplePrev", "ReservoirSampleCurr" }, ResourceFormat::RG32Float);
 	mpResManager->requestTextureResource(ResourceManager::kOutputChannel);
 	mpResManager->requestTextureResource(ResourceManager::kEnvironmentMap);
 
+	// The forest scenes describe their area lights in their user-defined block
+	mpResManager->requestSceneLoadFlags(Scene::LoadFlags::CreateUserAreaLights);
+
 	// mpResManager->updateEnvironmentMap("Data/BackgroundImages/MonValley_G_DirtRoad_3k.hdr");
 	mpResManager->setDefaultSceneName("Data/Scenes/forest/forest80.fscene");
 
@@ -76,9 +80,45 @@ void InitLightPlusTemporalPass::initScene(RenderContext* pRenderContext, Scene::
 		mpCurrCameraMatrix = mpScene->getActiveCamera()->getViewProjMatrix();
 	}
 
+	// Lights of a new scene all count as changed
+	mLightStoreVersion = 0;
+
 	if (mpRays) mpRays->setScene(mpScene);
 }
 
+void InitLightPlusTemporalPass::updateChangedLightMask()
+{
+	// The scene's light store is updated once per frame, and remembers which update last changed each light.  Ask it for
+	//     the lights changed since our last frame:  reservoirs from that frame which picked one have a stale weight and visibility.
+	LightStore::SharedPtr pLightStore = mpScene ? mpScene->getLightStore() : nullptr;
+	uint32_t lightCount = pLightStore ? pLightStore->getLightCount() : 0;
+	uint32_t wordCount = std::max(1u, (lightCount + 31) / 32);
+
+	bool hadChanges = mChangedLightCount > 0;
+	mChangedLightBits.assign(wordCount, 0);
+	mChangedLightCount = 0;
+	if (pLightStore)
+	{
+		pLightStore->getChangedLightsSince(mLightStoreVersion, mChangedLights);
+		mLightStoreVersion = pLightStore->getVersion();
+		for (uint32_t index : mChangedLights)
+		{
+			mChangedLightBits[index >> 5] |= 1u << (index & 31);
+		}
+		mChangedLightCount = (uint32_t)mChangedLights.size();
+	}
+
+	// Only upload the mask when it changed.  Words past the current light count are never read.
+	if (!mpChangedLightMask || mpChangedLightMask->getSize() < wordCount * sizeof(uint32_t))
+	{
+		mpChangedLightMask = Buffer::create(wordCount * sizeof(uint32_t), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, mChangedLightBits.data());
+	}
+	else if (hadChanges || mChangedLightCount > 0)
+	{
+		mpChangedLightMask->updateData(mChangedLightBits.data(), 0, wordCount * sizeof(uint32_t));
+	}
+}
+
 void InitLightPlusTemporalPass::execute(RenderContext* pRenderContext)
 {
 	// Get the output buffer we're writing into; clear it to black.
@@ -96,15 +136,15 @@ void InitLightPlusTemporalPass::execute(RenderContext* pRenderContext)
 
 	// Set our ray tracing shader variables 
 	auto rayGenVars = mpRays->getRayGenVars();
-	rayGenVars["RayGenCB"]["gMinT"]       = mpResManager->getMinTDist();
-	rayGenVars["RayGenCB"]["gFrameCount"] = mFrameCount++;
+	mMinTVar.set(rayGenVars, mpResManager->getMinTDist());
+	mFrameCountVar.set(rayGenVars, mFrameCount++);
 	// For ReSTIR - update the toggle in the shader
-	rayGenVars["RayGenCB"]["gInitLight"]  = mInitLightPerPixel; 
-	rayGenVars["RayGenCB"]["gTemporalReuse"] = mTemporalReuse;
-	rayGenVars["RayGenCB"]["gDoIndirectGI"] = mDoIndirectGI;
-	rayGenVars["RayGenCB"]["gCosSampling"] = mDoCosSampling;
-	rayGenVars["RayGenCB"]["gDirectShadow"] = mDoDirectShadows;
-	rayGenVars["RayGenCB"]["gLastCameraMatrix"] = mpLastCameraMatrix;
+	mInitLightVar.set(rayGenVars, mInitLightPerPixel);
+	mTemporalReuseVar.set(rayGenVars, mTemporalReuse);
+	mDoIndirectGIVar.set(rayGenVars, mDoIndirectGI);
+	mCosSamplingVar.set(rayGenVars, mDoCosSampling);
+	mDirectShadowVar.set(rayGenVars, mDoDirectShadows);
+	mLastCameraVar.set(rayGenVars, mpLastCameraMatrix);
 
 	// Pass our G-buffer textures down to the HLSL so we can shade
 	rayGenVars["gPos"]         = mpResManager->getTexture("WorldPosition");
@@ -116,6 +156,14 @@ void InitLightPlusTemporalPass::execute(RenderContext* pRenderContext)
 	rayGenVars["gReservoirCurr"] = mpResManager->getTexture("ReservoirCurr");
 	rayGenVars["gIndirectOutput"] = mpResManager->getTexture("IndirectOutput");
 
+	// For ReSTIR - the points the reservoirs picked on area lights, as two random numbers each
+	rayGenVars["gReservoirSamplePrev"] = mpResManager->getTexture("ReservoirSamplePrev");
+	rayGenVars["gReservoirSampleCurr"] = mpResManager->getTexture("ReservoirSampleCurr");
+
+	// For ReSTIR - flag the lights which changed since the previous reservoirs were picked
+	updateChangedLightMask();
+	rayGenVars["gChangedLightMask"] = mpChangedLightMask;
+
 	// Set our environment map texture for indirect rays that miss geometry 
 	auto missVars = mpRays->getMissVars(1);       // Remember, indirect rays are ray type #1
 	missVars["gEnvMap"] = mpResManager->getTexture(ResourceManager::kEnvironmentMap);
@@ -24,6 +24,7 @@ protected:
 
 	// Implementation of RenderPass interface
 	bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) override;
+	void compileShaders() override { mpRays->compileShaders(); }
 	void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
 	void execute(RenderContext* pRenderContext) override;
 	void renderGui(Gui* pGui) override;
@@ -35,12 +36,32 @@ protected:
 	// A helper utility to determine if the current scene (if any) has had any camera motion
 	bool hasCameraMoved();
 
+	// Upload a mask of the lights changed since our last frame, so temporal reuse drops the reservoirs that picked one of them
+	void updateChangedLightMask();
+
 	// Rendering state
 	RayLaunch::SharedPtr                    mpRays;                 ///< Our wrapper around a DX Raytracing pass
 	RtScene::SharedPtr                      mpScene;                ///< Our scene file (passed in from app)  
 	mat4                          mpLastCameraMatrix;
 	mat4                          mpCurrCameraMatrix;
 
+	// Handles to our RayGenCB variables, so we don't look them up by name every frame
+	SimpleVars::CachedVar<float>            mMinTVar           = { "RayGenCB", "gMinT" };
+	SimpleVars::CachedVar<uint32_t>         mFrameCountVar     = { "RayGenCB", "gFrameCount" };
+	SimpleVars::CachedVar<bool>             mInitLightVar      = { "RayGenCB", "gInitLight" };
+	SimpleVars::CachedVar<bool>             mTemporalReuseVar  = { "RayGenCB", "gTemporalReuse" };
+	SimpleVars::CachedVar<bool>             mDoIndirectGIVar   = { "RayGenCB", "gDoIndirectGI" };
+	SimpleVars::CachedVar<bool>             mCosSamplingVar    = { "RayGenCB", "gCosSampling" };
+	SimpleVars::CachedVar<bool>             mDirectShadowVar   = { "RayGenCB", "gDirectShadow" };
+	SimpleVars::CachedVar<mat4>             mLastCameraVar     = { "RayGenCB", "gLastCameraMatrix" };
+
 	// Various internal parameters
 	uint32_t                                mFrameCount = 0x1337u;  ///< A frame counter to vary random numbers over time
+
+	// For ReSTIR - which lights changed since the reservoirs of our last frame were picked
+	Buffer::SharedPtr                       mpChangedLightMask;     ///< One bit per light, read by the ray generation shader
+	std::vector<uint32_t>                   mChangedLightBits;      ///< CPU copy of mpChangedLightMask
+	std::vector<uint32_t>                   mChangedLights;         ///< Scratch list of changed light indices
+	uint32_t                                mChangedLightCount = 0; ///< Bits set in mpChangedLightMask
+	uint64_t                                mLightStoreVersion = 0; ///< Version of the scene's light store at our last frame
 };
@@ -17,6 +17,7 @@ bool SpatialReusePass::initialize(RenderContext* pRenderContext, ResourceManager
 	// Stash a copy of our resource manager so we can get rendering resources
 	mpResManager = pResManager;
 	mpResManager->requestTextureResources({ "WorldPosition", "WorldNormal", "MaterialDiffuse", "ReservoirCurr", "ReservoirSpatial"});
+	mpResManager->requestTextureResources({ "ReservoirSampleCurr", "ReservoirSampleSpatial" }, ResourceFormat::RG32Float);
 	mpResManager->requestTextureResource(ResourceManager::kOutputChannel);
 
 	// Create our wrapper around a ray tracing pass.  Tell it where our ray generation shader and ray-specific shaders are
@@ -54,9 +55,11 @@ void SpatialReusePass::execute(RenderContext* pRenderContext)
 
 	// Set our ray tracing shader variables 
 	auto rayGenVars = mpRays->getRayGenVars();
-	rayGenVars["RayGenCB"]["gMinT"]       = mpResManager->getMinTDist();
-	rayGenVars["RayGenCB"]["gFrameCount"] = mFrameCount++;
-	rayGenVars["RayGenCB"]["gSpatialReuse"] = mSpatialReuse;
+	RayGenCBData cbData;
+	cbData.gMinT         = mpResManager->getMinTDist();
+	cbData.gFrameCount   = mFrameCount++;
+	cbData.gSpatialReuse = mSpatialReuse ? 1u : 0u;
+	mRayGenCB.set(rayGenVars, cbData);
 
 	// Pass our G-buffer textures down to the HLSL so we can shade
 	rayGenVars["gPos"]         = mpResManager->getTexture("WorldPosition");
@@ -66,6 +69,8 @@ void SpatialReusePass::execute(RenderContext* pRenderContext)
 	// For ReSTIR - update the buffer storing reservoir (weight sum, chosen light index, number of candidates seen) 
 	rayGenVars["gReservoirCurr"] = mpResManager->getTexture("ReservoirCurr");
 	rayGenVars["gReservoirSpatial"] = mpResManager->getTexture("ReservoirSpatial");
+	rayGenVars["gReservoirSampleCurr"] = mpResManager->getTexture("ReservoirSampleCurr");
+	rayGenVars["gReservoirSampleSpatial"] = mpResManager->getTexture("ReservoirSampleSpatial");
 
 	// Shoot our rays and shade our primary hit points
 	mpRays->execute( pRenderContext, mpResManager->getScreenSize() );
@@ -18,6 +18,7 @@ protected:
 
 	// Implementation of RenderPass interface
 	bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) override;
+	void compileShaders() override { mpRays->compileShaders(); }
 	void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
 	void execute(RenderContext* pRenderContext) override;
 	void renderGui(Gui* pGui);
@@ -32,4 +33,13 @@ protected:
 
 	// Various internal parameters
 	uint32_t                                mFrameCount = 0x1337u;  ///< A frame counter to vary random numbers over time
+
+	// A C++ mirror of RayGenCB in spatialReuse.rt.hlsl, uploaded with a single copy each frame
+	struct RayGenCBData
+	{
+		float    gMinT;
+		uint32_t gFrameCount;
+		uint32_t gSpatialReuse;        ///< An HLSL bool is 4 bytes
+	};
+	SimpleVars::CachedBlob<RayGenCBData>    mRayGenCB = { "RayGenCB" };
 };
@@ -18,6 +18,7 @@ bool UpdateReservoirPlusShadePass::initialize(RenderContext* pRenderContext, Res
 	mpResManager = pResManager;
 	mpResManager->requestTextureResources({ "WorldPosition", "WorldNormal", "MaterialDiffuse",
 											"ReservoirPrev", "ReservoirSpatial", "IndirectOutput" });	
+	mpResManager->requestTextureResources({ "ReservoirSamplePrev", "ReservoirSampleSpatial" }, ResourceFormat::RG32Float);
 	mpResManager->requestTextureResource(ResourceManager::kOutputChannel);
 
 	// Create our wrapper around a ray tracing pass.  Tell it where our ray generation shader and ray-specific shaders are
@@ -46,7 +47,7 @@ void UpdateReservoirPlusShadePass::execute(RenderContext* pRenderContext)
 
 	// Set our ray tracing shader variables 
 	auto rayGenVars = mpRays->getRayGenVars();
-	rayGenVars["RayGenCB"]["gMinT"]       = mpResManager->getMinTDist();
+	mMinTVar.set(rayGenVars, mpResManager->getMinTDist());
 
 	// Pass our G-buffer textures down to the HLSL so we can shade
 	rayGenVars["gPos"]         = mpResManager->getTexture("WorldPosition");
@@ -56,6 +57,8 @@ void UpdateReservoirPlusShadePass::execute(RenderContext* pRenderContext)
 	// For ReSTIR - update the buffer storing reservoir (weight sum, chosen light index, number of candidates seen) 
 	rayGenVars["gReservoirPrev"] = mpResManager->getTexture("ReservoirPrev");
 	rayGenVars["gReservoirSpatial"] = mpResManager->getTexture("ReservoirSpatial");
+	rayGenVars["gReservoirSamplePrev"] = mpResManager->getTexture("ReservoirSamplePrev");
+	rayGenVars["gReservoirSampleSpatial"] = mpResManager->getTexture("ReservoirSampleSpatial");
 	rayGenVars["gIndirectOutput"] = mpResManager->getTexture("IndirectOutput");
 
 	rayGenVars["gOutput"]      = pDstTex;
@@ -16,6 +16,7 @@ protected:
 
 	// Implementation of RenderPass interface
 	bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) override;
+	void compileShaders() override { mpRays->compileShaders(); }
 	void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
 	void execute(RenderContext* pRenderContext) override;
 
@@ -26,4 +27,5 @@ protected:
 	// Rendering state
 	RayLaunch::SharedPtr                    mpRays;                 ///< Our wrapper around a DX Raytracing pass
 	RtScene::SharedPtr                      mpScene;                ///< Our scene file (passed in from app)  
+	SimpleVars::CachedVar<float>            mMinTVar = { "RayGenCB", "gMinT" };
 };
@@ -98,24 +98,35 @@ void FullscreenLaunch::setCamera(Falcor::Camera::SharedPtr pActiveCamera)
 	}
 }
 
-void FullscreenLaunch::setLights(const std::vector< Falcor::Light::SharedPtr > &pLights)
+void FullscreenLaunch::setLights(const Falcor::Scene::SharedPtr &pScene)
 {
+	if (!pScene) return;
+
 	// Shouldn't need to change unless Falcor internals do
 	const char*__internalCB = "InternalPerFrameCB";
 	const char*__internalCountName = "gLightsCount";
 	const char*__internalLightsName = "gLights";
 
+	// The lights live in a structured buffer owned by the scene, which uploads the lights that changed once per frame.
+	//     We only bind it, create it if no other pass rendering the scene did yet, and upload the lights added or removed since the scene's update().
+	const ReflectionVar* pLightsVar = mpVars->getReflection()->getDefaultParameterBlock()->getResource(__internalLightsName).get();
+	const ReflectionResourceType* pLightsType = pLightsVar ? pLightsVar->getType()->unwrapArray()->asResourceType() : nullptr;
+	LightStore::SharedPtr pLightStore = pScene->getLightStore();
+	if (!pLightStore && pLightsType)
+	{
+		pLightStore = pScene->createLightStore(pLightsType->inherit_shared_from_this::shared_from_this());
+	}
+	pScene->syncLightStore();
+	if (pLightStore && pLightsType)
+	{
+		mpVars->setStructuredBuffer(__internalLightsName, pLightStore->getBuffer());
+	}
+
 	// Actually set the internals
 	ConstantBuffer::SharedPtr perFrameCB = mpVars[__internalCB];
 	if (perFrameCB)
 	{
-		perFrameCB[__internalCountName] = uint32_t(pLights.size());
-		const auto& pLightOffset = perFrameCB->getBufferReflector()->findMember(__internalLightsName);
-		size_t lightOffset = pLightOffset ? pLightOffset->getOffset() : ConstantBuffer::kInvalidOffset;
-		for (uint32_t i = 0; i < uint32_t(pLights.size()); i++)
-		{
-			pLights[i]->setIntoProgramVars(mpVars.get(), perFrameCB.get(), i * Light::getShaderStructSize() + lightOffset);
-		}
+		perFrameCB[__internalCountName] = pLightStore ? pLightStore->getLightCount() : 0u;
 	}
 }
 
@@ -60,7 +60,7 @@ public:
 	//     data related to the scene (since there is not necessarily a "scene" for a full-screen pass).
 	//     If you want to use Falcor data like 'gCamera' and 'gLights[]' in HLSL, you can call these methods
 	void setCamera(Falcor::Camera::SharedPtr pActiveCamera);
-	void setLights(const std::vector< Falcor::Light::SharedPtr > &pLights);
+	void setLights(const Falcor::Scene::SharedPtr &pScene);
 
 	// Falcor allows programmatically adding #defines to your HLSL shader.  If you use this class, you
 	//     should set them using the following methods (rather than default Falcor methods) to ensure
@@ -0,0 +1,243 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "PipelineTimingLog.h"
+#include <fstream>
+
+using namespace Falcor;
+
+namespace {
+	// Pass names are user-provided; make sure they can't break the JSON we write.
+	std::string escapeJsonString(const std::string& str)
+	{
+		std::string out;
+		out.reserve(str.size());
+		for (char c : str)
+		{
+			if (c == '"' || c == '\\') { out.push_back('\\'); out.push_back(c); }
+			else if (c == '\n')        { out += "\\n"; }
+			else if (c == '\t')        { out += "\\t"; }
+			else if (uint8_t(c) >= 0x20) { out.push_back(c); }
+		}
+		return out;
+	}
+
+	// CSV fields containing commas or quotes need to be quoted
+	std::string escapeCsvString(const std::string& str)
+	{
+		if (str.find_first_of(",\"\n") == std::string::npos) return str;
+		std::string out = "\"";
+		for (char c : str)
+		{
+			if (c == '"') out.push_back('"');
+			out.push_back(c);
+		}
+		return out + "\"";
+	}
+};
+
+PipelineTimingLog::SharedPtr PipelineTimingLog::create()
+{
+	return create(Desc());
+}
+
+PipelineTimingLog::SharedPtr PipelineTimingLog::create(const Desc& desc)
+{
+	return SharedPtr(new PipelineTimingLog(desc));
+}
+
+PipelineTimingLog::PipelineTimingLog(const Desc& desc)
+	: mDesc(desc)
+{
+	// A zero-sized buffer would flush every frame into the same file; clamp to something sensible.
+	mDesc.framesPerFile = std::max(1u, mDesc.framesPerFile);
+	mDesc.maxFiles = std::max(1u, mDesc.maxFiles);
+
+	mFrames.reserve(mDesc.framesPerFile);
+	mLogStart = CpuTimer::getCurrentTimePoint();
+}
+
+PipelineTimingLog::~PipelineTimingLog()
+{
+	flush();
+}
+
+void PipelineTimingLog::beginFrame(uint64_t frameId)
+{
+	FrameTiming& frame = mInFlight[mCurBuffer];
+	frame.frameId = frameId;
+	frame.passes.clear();
+}
+
+void PipelineTimingLog::beginPass(uint32_t passNum, const std::string& passName)
+{
+	// Lazily create GPU timers the first time we see a pass in a given pipeline slot
+	if (passNum >= mTimers.size()) mTimers.resize(passNum + 1);
+	PassTimers& timers = mTimers[passNum];
+	if (!timers.pTimer[mCurBuffer]) timers.pTimer[mCurBuffer] = GpuTimer::create();
+
+	PassTiming pass;
+	pass.name = passName;
+	pass.passNum = passNum;
+	mInFlight[mCurBuffer].passes.push_back(pass);
+
+	mPassStart = CpuTimer::getCurrentTimePoint();
+	timers.pTimer[mCurBuffer]->begin();
+	timers.wasUsed[mCurBuffer] = true;
+}
+
+void PipelineTimingLog::endPass(uint32_t passNum, uint64_t raysLaunched)
+{
+	assert(passNum < mTimers.size() && !mInFlight[mCurBuffer].passes.empty());
+	mTimers[passNum].pTimer[mCurBuffer]->end();
+
+	CpuTimer::TimePoint passEnd = CpuTimer::getCurrentTimePoint();
+	PassTiming& pass = mInFlight[mCurBuffer].passes.back();
+	pass.cpuStartMs = std::chrono::duration<double, std::milli>(mPassStart - mLogStart).count();   // Double precision; long runs overflow float ms
+	pass.cpuMs = CpuTimer::calcDuration(mPassStart, passEnd);
+	pass.raysLaunched = raysLaunched;
+}
+
+void PipelineTimingLog::endFrame()
+{
+	// The frame recorded in the other buffer was submitted last frame; its GPU timers can be read without a stall.
+	uint32_t prevBuffer = 1 - mCurBuffer;
+	if (mHavePendingFrame)
+	{
+		commitFrame(mInFlight[prevBuffer], prevBuffer);
+	}
+
+	mHavePendingFrame = true;
+	mCurBuffer = prevBuffer;
+}
+
+void PipelineTimingLog::commitFrame(FrameTiming& frame, uint32_t bufferIdx)
+{
+	for (auto& pass : frame.passes)
+	{
+		PassTimers& timers = mTimers[pass.passNum];
+		if (timers.wasUsed[bufferIdx])
+		{
+			pass.gpuMs = timers.pTimer[bufferIdx]->getElapsedTime();
+		}
+	}
+	for (auto& timers : mTimers)
+	{
+		timers.wasUsed[bufferIdx] = false;
+	}
+
+	mFrames.push_back(frame);
+	mLastCompleted = frame;
+	mCommittedFrames++;
+
+	// Keep memory bounded; once our buffer is full, write it out.
+	if (mFrames.size() >= mDesc.framesPerFile) flush();
+}
+
+void PipelineTimingLog::flush()
+{
+	if (mFrames.empty()) return;
+
+	// Files roll over after maxFiles, overwriting the oldest one.
+	std::string base = mDesc.baseName + "_" + std::to_string(mNextFileIdx % mDesc.maxFiles);
+	mNextFileIdx++;
+
+	if (is_set(mDesc.formats, OutputFormat::Csv))         writeCsv(base + ".csv");
+	if (is_set(mDesc.formats, OutputFormat::Json))        writeJson(base + ".json");
+	if (is_set(mDesc.formats, OutputFormat::ChromeTrace)) writeChromeTrace(base + ".trace.json");
+
+	mFrames.clear();
+}
+
+void PipelineTimingLog::writeCsv(const std::string& filename) const
+{
+	std::ofstream out(filename, std::ios::out | std::ios::trunc);
+	if (!out.is_open())
+	{
+		logWarning("PipelineTimingLog: Unable to open '" + filename + "' for writing");
+		return;
+	}
+
+	out << "frame,passNum,pass,cpuStartMs,cpuMs,gpuMs,raysLaunched\n";
+	for (const auto& frame : mFrames)
+	{
+		for (const auto& pass : frame.passes)
+		{
+			out << frame.frameId << "," << pass.passNum << "," << escapeCsvString(pass.name) << ","
+				<< pass.cpuStartMs << "," << pass.cpuMs << "," << pass.gpuMs << "," << pass.raysLaunched << "\n";
+		}
+	}
+}
+
+void PipelineTimingLog::writeJson(const std::string& filename) const
+{
+	std::ofstream out(filename, std::ios::out | std::ios::trunc);
+	if (!out.is_open())
+	{
+		logWarning("PipelineTimingLog: Unable to open '" + filename + "' for writing");
+		return;
+	}
+
+	out << "{\n  \"frames\": [\n";
+	for (size_t f = 0; f < mFrames.size(); f++)
+	{
+		const FrameTiming& frame = mFrames[f];
+		out << "    { \"frame\": " << frame.frameId << ", \"passes\": [";
+		for (size_t p = 0; p < frame.passes.size(); p++)
+		{
+			const PassTiming& pass = frame.passes[p];
+			out << (p ? ", " : " ") << "{ \"name\": \"" << escapeJsonString(pass.name) << "\", \"passNum\": " << pass.passNum
+				<< ", \"cpuStartMs\": " << pass.cpuStartMs << ", \"cpuMs\": " << pass.cpuMs << ", \"gpuMs\": " << pass.gpuMs
+				<< ", \"raysLaunched\": " << pass.raysLaunched << " }";
+		}
+		out << " ] }" << ((f + 1 < mFrames.size()) ? ",\n" : "\n");
+	}
+	out << "  ]\n}\n";
+}
+
+void PipelineTimingLog::writeChromeTrace(const std::string& filename) const
+{
+	std::ofstream out(filename, std::ios::out | std::ios::trunc);
+	if (!out.is_open())
+	{
+		logWarning("PipelineTimingLog: Unable to open '" + filename + "' for writing");
+		return;
+	}
+
+	// Chrome's trace_event format uses microseconds.  CPU submission goes on thread 0, GPU execution on thread 1.
+	//    We don't have absolute GPU timestamps, so GPU events are laid out back-to-back starting at the
+	//    frame's first CPU submit.  The durations are exact; the offsets are only approximate.
+	out << "{ \"traceEvents\": [\n";
+	out << "  { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": { \"name\": \"CPU submit\" } },\n";
+	out << "  { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 1, \"args\": { \"name\": \"GPU\" } }";
+	for (const auto& frame : mFrames)
+	{
+		double gpuCursorUs = frame.passes.empty() ? 0.0 : frame.passes[0].cpuStartMs * 1000.0;
+		for (const auto& pass : frame.passes)
+		{
+			std::string name = escapeJsonString(pass.name);
+			out << ",\n  { \"name\": \"" << name << "\", \"cat\": \"cpu\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": "
+				<< pass.cpuStartMs * 1000.0 << ", \"dur\": " << pass.cpuMs * 1000.0 << ", \"args\": { \"frame\": " << frame.frameId << " } }";
+			out << ",\n  { \"name\": \"" << name << "\", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 0, \"tid\": 1, \"ts\": "
+				<< gpuCursorUs << ", \"dur\": " << pass.gpuMs * 1000.0 << ", \"args\": { \"frame\": " << frame.frameId
+				<< ", \"raysLaunched\": " << pass.raysLaunched << " } }";
+			gpuCursorUs += pass.gpuMs * 1000.0;
+		}
+	}
+	out << "\n] }\n";
+}
@@ -0,0 +1,149 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "Falcor.h"
+
+/** Records per-pass CPU and GPU timings for every frame the RenderingPipeline renders and writes them out
+    in machine-readable form (CSV, JSON and/or Chrome's trace_event format, viewable in chrome://tracing).
+
+    Memory use is bounded:  at most Desc::framesPerFile frames are kept in memory.  When that many frames have
+    been recorded, they are written to disk and the in-memory buffer is reused.  Files roll over, so a long
+    run produces <baseName>_0.csv, <baseName>_1.csv, ... up to Desc::maxFiles, after which the oldest file is
+    overwritten.
+
+    GPU timers are double-buffered (like Falcor's Profiler) to avoid stalling the GPU, so the GPU times for a
+    frame become available one frame later.  Frames are only committed once their GPU times are known.
+
+Usage (the RenderingPipeline does this for you if you call RenderingPipeline::enableTimingExport()):
+	mpTimingLog->beginFrame(frameId);
+	for (each pass)
+	{
+		mpTimingLog->beginPass(passNum, passName);
+		pass->onExecute(pRenderContext);
+		mpTimingLog->endPass(passNum, raysLaunchedByPass);
+	}
+	mpTimingLog->endFrame();
+*/
+class PipelineTimingLog : public std::enable_shared_from_this<PipelineTimingLog>
+{
+public:
+	using SharedPtr = std::shared_ptr<PipelineTimingLog>;
+	using SharedConstPtr = std::shared_ptr<const PipelineTimingLog>;
+
+	/** Output formats.  These are bit flags and can be or'ed together.
+	*/
+	enum class OutputFormat
+	{
+		None        = 0x0,
+		Csv         = 0x1,    ///< One line per pass per frame:  frame,pass,cpuMs,gpuMs,rays
+		Json        = 0x2,    ///< An array of frames, each containing an array of passes
+		ChromeTrace = 0x4,    ///< Chrome trace_event format (CPU on thread 0, GPU on thread 1)
+		All         = 0x7,
+	};
+
+	struct Desc
+	{
+		std::string  baseName      = "pipelineTimings";   ///< Output files are named <baseName>_<idx>.<ext>
+		OutputFormat formats       = OutputFormat::All;   ///< Which files to write
+		uint32_t     framesPerFile = 1000;                ///< Maximum number of frames buffered in memory (and written per file)
+		uint32_t     maxFiles      = 8;                   ///< Number of files to rotate through before overwriting the oldest
+	};
+
+	/** Timings for a single pass within a frame
+	*/
+	struct PassTiming
+	{
+		std::string name;
+		uint32_t    passNum = 0;         ///< Position of the pass in the pipeline
+		double      cpuStartMs = 0.0;    ///< CPU start of the pass, relative to the start of the log
+		double      cpuMs = 0.0;         ///< CPU time spent submitting the pass
+		double      gpuMs = 0.0;         ///< GPU time spent executing the pass
+		uint64_t    raysLaunched = 0;    ///< Number of ray generation threads launched by the pass
+	};
+
+	/** Timings for all passes in a frame
+	*/
+	struct FrameTiming
+	{
+		uint64_t                frameId = 0;
+		std::vector<PassTiming> passes;
+	};
+
+	static SharedPtr create();
+	static SharedPtr create(const Desc& desc);
+	virtual ~PipelineTimingLog();
+
+	/** Call at the start of the frame, before any pass executes.
+	*/
+	void beginFrame(uint64_t frameId);
+
+	/** Call immediately before executing pass number <passNum> in the pipeline.
+	*/
+	void beginPass(uint32_t passNum, const std::string& passName);
+
+	/** Call immediately after executing pass number <passNum> in the pipeline.
+	*/
+	void endPass(uint32_t passNum, uint64_t raysLaunched = 0);
+
+	/** Call once all passes have executed.  Resolves the previous frame's GPU timers and commits that frame.
+	*/
+	void endFrame();
+
+	/** Write all committed frames to disk now (also called when the buffer fills and on destruction).
+	*/
+	void flush();
+
+	/** Returns the last frame for which both CPU and GPU timings are known (empty if none yet).
+	*/
+	const FrameTiming& getLastCompletedFrame() const { return mLastCompleted; }
+
+	/** Returns the number of frames committed since the log was created.
+	*/
+	uint64_t getCommittedFrameCount() const { return mCommittedFrames; }
+
+	const Desc& getDesc() const { return mDesc; }
+
+protected:
+	PipelineTimingLog(const Desc& desc);
+
+	// Per-pass GPU timers, double buffered so we read last frame's timers while recording this frame's.
+	struct PassTimers
+	{
+		Falcor::GpuTimer::SharedPtr pTimer[2];
+		bool                        wasUsed[2] = { false, false };
+	};
+
+	void commitFrame(FrameTiming& frame, uint32_t bufferIdx);
+	void writeCsv(const std::string& filename) const;
+	void writeJson(const std::string& filename) const;
+	void writeChromeTrace(const std::string& filename) const;
+
+	Desc                            mDesc;
+	std::vector<FrameTiming>        mFrames;              ///< Committed frames waiting to be written (bounded by framesPerFile)
+	FrameTiming                     mInFlight[2];         ///< Frames whose GPU timers have not been resolved yet
+	std::vector<PassTimers>         mTimers;
+	uint32_t                        mCurBuffer = 0;
+	bool                            mHavePendingFrame = false;
+	FrameTiming                     mLastCompleted;
+	uint64_t                        mCommittedFrames = 0;
+	uint32_t                        mNextFileIdx = 0;
+	Falcor::CpuTimer::TimePoint     mLogStart;
+	Falcor::CpuTimer::TimePoint     mPassStart;
+};
+enum_class_operators(PipelineTimingLog::OutputFormat);
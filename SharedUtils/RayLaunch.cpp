@@ -18,6 +18,8 @@
 
 #include "RayLaunch.h"
 
+uint64_t RayLaunch::sRaysLaunched = 0;
+
 RayLaunch::SharedPtr RayLaunch::RayLaunch::create(const std::string &rayGenFile, const std::string& rayGenEntryPoint, int recursionDepth)
 {
 	return SharedPtr(new RayLaunch(rayGenFile, rayGenEntryPoint, recursionDepth));
@@ -74,6 +76,22 @@ void RayLaunch::compileRayProgram()
 	createRayTracingVariables();
 }
 
+void RayLaunch::compileShaders()
+{
+	if (!mpRayProg) return;
+
+	// Asking for a program's active version links it, which compiles it (or pulls it out of the shader cache)
+	mpRayProg->getRayGenProgram()->getActiveVersion();
+	for (uint32_t i = 0; i < mpRayProg->getMissProgramCount(); i++)
+	{
+		if (mpRayProg->getMissProgram(i)) mpRayProg->getMissProgram(i)->getActiveVersion();
+	}
+	for (uint32_t i = 0; i < mpRayProg->getHitProgramCount(); i++)
+	{
+		if (mpRayProg->getHitProgram(i)) mpRayProg->getHitProgram(i)->getActiveVersion();
+	}
+}
+
 bool RayLaunch::readyToRender()
 {
 	// Do we already know everything is ready?
@@ -209,6 +227,7 @@ void RayLaunch::execute(RenderContext* pRenderContext, uvec2 rayLaunchDimensions
 	}
 
 	// Ok.  We're ready and have done all our error checking.  Launch the ray tracing!
+	sRaysLaunched += uint64_t(rayLaunchDimensions.x) * uint64_t(rayLaunchDimensions.y);
 	mpSceneRenderer->renderScene(pRenderContext, mpRayVars, mpRayState, uvec3(rayLaunchDimensions.x, rayLaunchDimensions.y, 1), camPtr);
 }
 
@@ -218,5 +237,6 @@ void RayLaunch::experimentalExecute(RenderContext::SharedPtr pRenderContext, uve
 	if (!mpRayVars) return;
 
 	// Ok.  We're ready and have done all our error checking.  Launch the ray tracing!
+	sRaysLaunched += uint64_t(rayLaunchDimensions.x) * uint64_t(rayLaunchDimensions.y);
 	mpSceneRenderer->renderScene(pRenderContext.get(), mpRayVars, mpRayState, uvec3(rayLaunchDimensions.x, rayLaunchDimensions.y, 1), nullptr);
 }
@@ -97,6 +97,10 @@ public:
 	// Call once you have added all the desired ray types
 	void compileRayProgram();
 
+	// Shaders are normally compiled lazily, when a scene is set.  This compiles them right away instead (it does
+	//    not need a scene).  It may be called on a worker thread, as long as no other thread uses this RayLaunch.
+	void compileShaders();
+
 	// Returns true if we have everything needed to call execute().
 	bool readyToRender();
 
@@ -132,6 +136,10 @@ public:
 	using SimpleVarsVector = std::vector<SimpleVars::SharedPtr>;
 	SimpleVarsVector &getHitVars(uint32_t rayType);
 
+	// Returns the total number of ray generation threads launched by all RayLaunch objects so far.  Sample this
+	//     before and after a pass executes to find out how many rays that pass launched.
+	static uint64_t getRaysLaunchedCounter() { return sRaysLaunched; }
+
 protected:
 	RayLaunch(const std::string &rayGenFile, const std::string& rayGenEntryPoint, int recursionDepth=2);
 
@@ -158,4 +166,7 @@ protected:
 
 	// Used only to return a zero-length list of hit shaders
 	SimpleVarsVector mDefaultHitVarList;
+
+	// Running count of ray generation threads launched (across all instances)
+	static uint64_t sRaysLaunched;
 };
\ No newline at end of file
@@ -37,6 +37,7 @@ protected:
 	//
 
 	virtual bool initialize(Falcor::RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) = 0;
+	virtual void compileShaders() {}
 	virtual void initScene(Falcor::RenderContext* pRenderContext, Falcor::Scene::SharedPtr pScene) {}
 	virtual void resize(uint32_t width, uint32_t height) {}
 	virtual void pipelineUpdated(ResourceManager::SharedPtr pResManager) { mpResManager = pResManager; }
@@ -74,6 +75,13 @@ public:
     */
     bool onInitialize(Falcor::RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager);
 
+    /** Called once after onInitialize() to compile the pass' shaders.  Request resources in initialize(), but do
+        slow shader compilation here.  The pipeline calls this for all passes concurrently, on the WorkerPool's threads, so
+        implementations must only touch state owned by the pass (e.g., call RayLaunch::compileShaders()).  Compiling the pass'
+        own programs is safe, since the state programs share (Slang sessions, program cache, empty root signature) is locked.
+    */
+    void onCompileShaders() { if (mIsInitialized) compileShaders(); }
+
     /** Callback on scene initialization.
         \param[in] context Provides the current context to initialize resources for your renderer.
         \param[in] scene Provides the newly loaded scene.
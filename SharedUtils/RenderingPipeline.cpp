@@ -20,7 +20,9 @@
 #include "RenderingPipeline.h"
 #include "Externals/dear_imgui/imgui.h"
 #include "SceneLoaderWrapper.h"
+#include "RayLaunch.h"
 #include <algorithm>
+#include <set>
 
 namespace {
 	const char     *kNullPassDescriptor = "< None >";   ///< Name used in dropdown lists when no pass is selected.
@@ -49,6 +51,39 @@ void RenderingPipeline::onLoad(SampleCallbacks* pSample, const RenderContext::Sh
 	mpResourceManager = ResourceManager::create(mLastKnownSize.x, mLastKnownSize.y, pSample);
 	mOutputBufferIndex = mpResourceManager->requestTextureResource(ResourceManager::kOutputChannel);
 
+	// Passes compile their shaders when initialized, so set up the shader cache first
+	if (mUseShaderCache && !Program::getProgramCache())
+	{
+		ProgramCache::Desc cacheDesc;
+		cacheDesc.directory = mShaderCacheDir.empty() ? getExecutableDirectory() + "/ShaderCache" : mShaderCacheDir;
+		Program::setProgramCache(ProgramCache::create(cacheDesc));
+	}
+	if (mUseSceneCache && !Model::getModelCache())
+	{
+		ModelCache::Desc cacheDesc;
+		cacheDesc.directory = mSceneCacheDir.empty() ? getExecutableDirectory() + "/SceneCache" : mSceneCacheDir;
+		Model::setModelCache(ModelCache::create(cacheDesc));
+	}
+	if (mUseTextureCooking && !mpTextureCooker)
+	{
+		TextureCooker::Desc cookerDesc = mTextureCookerDesc;
+		if (cookerDesc.directory.empty()) cookerDesc.directory = getExecutableDirectory() + "/TextureCache";
+		mpTextureCooker = TextureCooker::create(cookerDesc);
+		setTextureCooker(mpTextureCooker);
+	}
+	if (mUseTextureStreaming && !mpTextureStreamer)
+	{
+		if (mpTextureCooker)
+		{
+			mpTextureStreamer = TextureStreamer::create(mTextureResidencyDesc);
+			setTextureStreamer(mpTextureStreamer);
+		}
+		else
+		{
+			logWarning("RenderingPipeline: texture streaming needs texture cooking to be enabled.  Textures will be loaded fully.");
+		}
+	}
+
 	// Initialize all of the RenderPasses we have available to select for our pipeline
 	for (uint32_t i = 0; i < mAvailPasses.size(); i++)
 	{
@@ -60,6 +95,9 @@ void RenderingPipeline::onLoad(SampleCallbacks* pSample, const RenderContext::Sh
 		}
 	}
 
+	// Passes have requested their resources; now compile all their shaders in parallel before the first frame
+	compilePassShaders();
+
     // If nobody has started inserting passes into our pipeline, set up our GUI so we can start adding passes manually.
 	if (mActivePasses.size() == 0)
 	{
@@ -74,13 +112,12 @@ void RenderingPipeline::onLoad(SampleCallbacks* pSample, const RenderContext::Sh
     }
 
 	// Create identifiers for profiling.
-    mProfileGPUTimes.resize(mActivePasses.size() * 2);
-    mProfileLastGPUTimes.resize(mActivePasses.size() * 2);
-	for (uint32_t i = 0; i < mActivePasses.size()*2; i++)
+	updateProfileNames();
+
+	// If the user asked for timings to be exported before we had a device, we can now create the GPU timers
+	if (mExportTimings && !mpTimingLog)
 	{
-		char buf[256];
-		sprintf_s(buf, "Pass_%d", i);
-		mProfileNames.push_back( HashedString(std::string(buf)) );
+		mpTimingLog = PipelineTimingLog::create(mTimingLogDesc);
 	}
 
 	// Create a camera controller
@@ -226,7 +263,7 @@ void RenderingPipeline::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
 		{
 			// A wrapper function to open a window, load a UI, and do some sanity checking
 			Fbo::SharedPtr outputFBO = pSample->getCurrentFbo();
-			RtScene::SharedPtr loadedScene = loadScene(uvec2(outputFBO->getWidth(), outputFBO->getHeight()));
+			RtScene::SharedPtr loadedScene = loadScene(uvec2(outputFBO->getWidth(), outputFBO->getHeight()), nullptr, mpResourceManager->getSceneLoadFlags());
 
 			// We have a method that explicitly initializes all render passes given our new scene.
 			if (loadedScene)
@@ -284,6 +321,13 @@ void RenderingPipeline::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
 			mpResourceManager->setMinTDist(mMinTArray[mMinTSelection]);
 			mGlobalPipeRefresh = true;
 		}
+
+		// How this frame's acceleration structure update went.  The GPU times are in the profiler (updateTlas, updateBlas).
+		RtScene* pRtScene = dynamic_cast<RtScene*>(mpScene.get());
+		if (pRtScene)
+		{
+			pGui->addText(pRtScene->getUpdateStatsString().c_str());
+		}
 		pGui->addSeparator();
 	}
 
@@ -370,6 +414,17 @@ void RenderingPipeline::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
 		}
 	}
 
+	// Play the camera path over a fixed number of frames, e.g., to export repeatable timings
+	if (mpScene && mpScene->getPathCount())
+	{
+		pGui->addIntVar("Camera path frames", mPathGuiFrameCount, 1);
+		if (pGui->addButton(isPlayingCameraPath() ? "Stop camera path" : "Play camera path", true))
+		{
+			if (isPlayingCameraPath()) stopCameraPath();
+			else playCameraPath(uint32_t(mPathGuiFrameCount), mExportTimings);
+		}
+	}
+
 	// Allow control over any scene animation
 	if (mPipeHasAnimation)
 	{
@@ -382,6 +437,11 @@ void RenderingPipeline::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
     pGui->addText("");
     pGui->addSeparator();
     pGui->addText(Falcor::gProfileEnabled ? "Press (P):  Hide profiling window" : "Press (P):  Show profiling window");
+	if (pGui->addCheckBox("Export per-pass timings to disk", mExportTimings))
+	{
+		if (mExportTimings) enableTimingExport(mTimingLogDesc);
+		else disableTimingExport();
+	}
     pGui->addSeparator();
 }
 
@@ -601,7 +661,7 @@ void RenderingPipeline::onFirstRun(SampleCallbacks* pSample)
 	// Did the user ask for us to load a scene by default?
 	if (mPipeNeedsDefaultScene)
 	{
-		RtScene::SharedPtr loadedScene = loadScene(mLastKnownSize, mpResourceManager->getDefaultSceneName().c_str());
+		RtScene::SharedPtr loadedScene = loadScene(mLastKnownSize, mpResourceManager->getDefaultSceneName().c_str(), mpResourceManager->getSceneLoadFlags());
 		if (loadedScene) onInitNewScene(pSample->getRenderContext().get(), loadedScene);
 	}
 
@@ -628,6 +688,15 @@ void RenderingPipeline::onFrameRender(SampleCallbacks* pSample, const RenderCont
 		// Make sure we're updateing the correct camera, then update the scene
 		mpCameraControl->attachCamera(mpScene->getActiveCamera() ? mpScene->getActiveCamera() : nullptr);
 		mpScene->update(pSample->getCurrentTime(), mpCameraControl.get());
+
+		// When playing the camera path, step along it by frame rather than by time
+		if (mPathFrameCount > 0) updateCameraPath();
+
+		// Stream texture levels in and out for the updated view, before any pass samples them
+		if (mpTextureStreamer && mpScene->getActiveCamera())
+		{
+			mpTextureStreamer->update(pRenderContext.get(), mpScene->getActiveCamera().get(), mLastKnownSize.y);
+		}
 	}
 
 	// Check if the pipeline has changed since last frame and needs updating
@@ -645,6 +714,7 @@ void RenderingPipeline::onFrameRender(SampleCallbacks* pSample, const RenderCont
 
 		// Update our flags
 		updatePipelineRequirementFlags();
+		updateProfileNames();
 		updatedPipeline = true;
 	}
 
@@ -662,25 +732,44 @@ void RenderingPipeline::onFrameRender(SampleCallbacks* pSample, const RenderCont
 		mGlobalPipeRefresh = false;
 	}
 
+	if (mpTimingLog) mpTimingLog->beginFrame(pSample->getFrameID());
+
     // Execute all of the passes in the current pipeline
     for (uint32_t passNum = 0; passNum < mActivePasses.size(); passNum++)
     {
         if (mActivePasses[passNum])
         {
+			// If we're exporting timings, remember how many rays were launched before this pass
+			uint64_t raysBefore = RayLaunch::getRaysLaunchedCounter();
+			if (mpTimingLog) mpTimingLog->beginPass(passNum, mActivePasses[passNum]->getName());
+
             if (Falcor::gProfileEnabled)
             {
                 // Insert a per-pass profiling event.  
                 assert(passNum < mProfileNames.size());
-                Falcor::ProfilerEvent _profileEvent(mActivePasses[passNum]->getName().c_str());
+                Falcor::ProfilerEvent _profileEvent(mProfileNames[passNum]);
                 mActivePasses[passNum]->onExecute(pRenderContext.get());
             }
             else
             {
                 mActivePasses[passNum]->onExecute(pRenderContext.get());
             }
+
+			if (mpTimingLog) mpTimingLog->endPass(passNum, RayLaunch::getRaysLaunchedCounter() - raysBefore);
         }
     }
 
+	if (mpTimingLog) mpTimingLog->endFrame();
+
+	// The timing log commits a frame one frame late (once its GPU times are known), so we stop one frame after the last
+	//    frame of the path; that frame isn't committed.
+	if (mPathStarted)
+	{
+		if (mPathFrame < mPathFrameCount) mPathFrame++;
+		else stopCameraPath();
+	}
+	if (Falcor::gProfileEnabled) extractProfilingData();
+
 	// Now that we're done rendering, grab out output texture and blit it into our target FBO
 	if (pTargetFbo && mpResourceManager->getTexture(mOutputBufferIndex))
 	{
@@ -696,10 +785,28 @@ void RenderingPipeline::onFrameRender(SampleCallbacks* pSample, const RenderCont
 
 void RenderingPipeline::onInitNewScene(RenderContext* pRenderContext, Scene::SharedPtr pScene)
 {
+	// The camera path we were playing belongs to the old scene
+	if (pScene && mPathStarted)
+	{
+		stopCameraPath();
+	}
+
 	// Stash the scene in the pipeline
 	if (pScene) 
 		mpScene = pScene;
 
+	// Bake any textures that weren't baked yet, so the next load of this scene can use them
+	if (pScene && mpTextureCooker)
+	{
+		mpTextureCooker->cookScene(pScene.get());
+	}
+
+	// Textures created from baked files only have their mip tail; let the streamer find the materials and instances using them
+	if (pScene && mpTextureStreamer)
+	{
+		mpTextureStreamer->setScene(pScene);
+	}
+
 	// When a new scene is loaded, we'll tell all our passes about it (not just active passes)
 	for (uint32_t i = 0; i < mAvailPasses.size(); i++)
 	{
@@ -737,6 +844,28 @@ void RenderingPipeline::onResizeSwapChain(SampleCallbacks* pSample, uint32_t wid
 
 void RenderingPipeline::onShutdown(SampleCallbacks* pSample)
 {
+	// Make sure any buffered timings make it to disk while we still have a device
+	disableTimingExport();
+
+	// Report how well the shader cache did this run
+	if (Program::getProgramCache())
+	{
+		logInfo(Program::getProgramCache()->getStatsString());
+		Program::getProgramCache()->flush();
+	}
+	if (Model::getModelCache())
+	{
+		logInfo(Model::getModelCache()->getStatsString());
+	}
+	if (mpTextureCooker)
+	{
+		logInfo(mpTextureCooker->getStatsString());
+	}
+	if (mpTextureStreamer)
+	{
+		logInfo(mpTextureStreamer->getStatsString());
+	}
+
 	// On program shutdown, call the shutdown callback on all the render passes.
     // We do not have to worry about double-deletion etc. It is currently enforced that a pass is only bound to one pipeline.
 	for (uint32_t i = 0; i < mAvailPasses.size(); i++)
@@ -843,45 +972,207 @@ void RenderingPipeline::addPipeInstructions(const std::string &str)
 	mPipeDescription.push_back(str);
 }
 
+void RenderingPipeline::updateProfileNames(void)
+{
+	// Name each profiler event after the pass it measures, so the profiler window (and anyone
+	//    querying Falcor's Profiler) can tell which pass is which.  Empty slots keep a placeholder.
+	mProfileNames.clear();
+	for (uint32_t i = 0; i < mActivePasses.size(); i++)
+	{
+		std::string name = mActivePasses[i] ? mActivePasses[i]->getName() : std::string(kNullPassDescriptor);
+
+		// Two slots could hold passes with the same name; keep the event names unique
+		for (uint32_t j = 0; j < i; j++)
+		{
+			if (mProfileNames[j].str == name)
+			{
+				name += " [" + std::to_string(i) + "]";
+				break;
+			}
+		}
+		mProfileNames.push_back(HashedString(name));
+	}
+	mProfileGPUTimes.assign(mActivePasses.size(), 0.0);
+	mProfileLastGPUTimes.assign(mActivePasses.size(), 0.0);
+}
+
 void RenderingPipeline::extractProfilingData(void)
 {
-	// This is a pretty ugly method.  It basically undoes Falcor's standard
-	//    profiler output, which is a strigified concatenation of all the data
-	//    we care about.  The 'right' way to deal with this is to update 
-	//    Falcor to provide a more granular way of accessing profile data that
-	//    isn't stringified.  For now, I'll just extract the data from 
-	//    the string.  So, yeah, this is ugly.  And if Falcor changes the profiler,
-	//    this will need updating.
+	// Query Falcor's profiler directly by event name.  Due to the profiler's double buffering,
+	//    these are the GPU times from the previous frame.
+	for (uint32_t i = 0; i < mActivePasses.size() && i < mProfileNames.size(); i++)
+	{
+		if (!mActivePasses[i] || !Profiler::isEventRegistered(mProfileNames[i])) continue;
+		mProfileLastGPUTimes[i] = mProfileGPUTimes[i];
+		mProfileGPUTimes[i] = Profiler::getEventGpuTime(mProfileNames[i]);
+	}
+}
+
+void RenderingPipeline::enableTimingExport(const PipelineTimingLog::Desc& desc)
+{
+	mTimingLogDesc = desc;
+	mExportTimings = true;
+
+	// GPU timers need a device, so if we're not yet initialized, we'll create the log in onLoad()
+	if (mIsInitialized)
+	{
+		mpTimingLog = PipelineTimingLog::create(mTimingLogDesc);
+	}
+}
+
+void RenderingPipeline::disableTimingExport()
+{
+	mExportTimings = false;
+	mpTimingLog = nullptr;   // Destructor flushes any buffered frames
+}
+
+void RenderingPipeline::playCameraPath(uint32_t frameCount, bool exportTimings)
+{
+	if (isPlayingCameraPath()) stopCameraPath();
+
+	mPathFrameCount = frameCount;
+	mPathFrame = 0;
+	mPathExportTimings = exportTimings;
+}
+
+void RenderingPipeline::stopCameraPath()
+{
+	if (mPathStarted)
+	{
+		if (mPathOwnsTimingExport) disableTimingExport();
+		if (mPathAttachedCamera && mpScene->getActiveCamera())
+		{
+			mpScene->getPath(0)->detachObject(mpScene->getActiveCamera());
+			mUseSceneCameraPath = false;
+		}
+		logInfo("Played " + std::to_string(mPathFrame) + " frames of the camera path.");
+	}
+
+	mPathFrameCount = 0;
+	mPathFrame = 0;
+	mPathStarted = false;
+	mPathOwnsTimingExport = false;
+	mPathAttachedCamera = false;
+}
+
+void RenderingPipeline::updateCameraPath(void)
+{
+	if (!mPathStarted)
+	{
+		if (!mpScene->getPathCount() || !mpScene->getActiveCamera())
+		{
+			logWarning("RenderingPipeline::playCameraPath() - the scene has no path or no camera. Nothing to play.");
+			stopCameraPath();
+			return;
+		}
+
+		// Attach the camera to the path, unless the user already did
+		const ObjectPath::SharedPtr& pPath = mpScene->getPath(0);
+		bool attached = false;
+		for (uint32_t i = 0; i < pPath->getAttachedObjectCount(); i++)
+		{
+			attached = attached || (pPath->getAttachedObject(i) == mpScene->getActiveCamera());
+		}
+		if (!attached)
+		{
+			pPath->attachObject(mpScene->getActiveCamera());
+			mUseSceneCameraPath = true;
+			mPathAttachedCamera = true;
+		}
+
+		if (mPathExportTimings && !mExportTimings)
+		{
+			enableTimingExport(mTimingLogDesc);
+			mPathOwnsTimingExport = true;
+		}
+		mPathStarted = true;
+	}
 
-	// Get our Falcor profiler string
-	std::string profileMsg = Profiler::getEventsString();
-    mTmpStr = profileMsg;
+	// Once the last frame was played, we render one more frame at the end of the path to commit its timings
+	if (mPathFrame < mPathFrameCount)
+	{
+		mpScene->getPath(0)->animateFrame(mPathFrame, mPathFrameCount);
+	}
+}
 
-	// Grab all of the lines with profiling data
-	int findPass = 0;
-	int count = 1;
+void RenderingPipeline::compilePassShaders(void)
+{
+	mPassCompileTimes.assign(mAvailPasses.size(), 0.0);
+	CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
 
-	size_t endOfLine = profileMsg.find('\n');
-	while (endOfLine != std::string::npos && findPass < mActivePasses.size())
+	// Passes may be listed more than once; only compile each one once
+	std::vector<uint32_t> passIndices;
+	std::set<::RenderPass*> passesSeen;
+	for (uint32_t i = 0; i < mAvailPasses.size(); i++)
 	{
-		// Each RenderPass is profiled with the name "Pass_%d" where %d various from 0 to (#passes-1)
-		char buf[128], passName[128];
-		float cpuTime, gpuTime;
-		sprintf_s(buf, "Pass_%d", findPass);
+		if (mAvailPasses[i] && passesSeen.insert(mAvailPasses[i].get()).second) passIndices.push_back(i);
+	}
 
-		// See if this line contains the time for the next pass (each line contains: <profileEventName> <cpuTime> <gpuTime>)
-		sscanf( profileMsg.substr(0, endOfLine).c_str(), "%s %f %f ", passName, &cpuTime, &gpuTime );
-		if (!strcmp(buf, passName))
+	// parallelFor() returns once every pass is compiled. Each pass writes its own entry of mPassCompileTimes.
+	parallelFor((uint32_t)passIndices.size(), 0, [&](uint32_t j)
+	{
+		uint32_t i = passIndices[j];
+		CpuTimer::TimePoint passStart = CpuTimer::getCurrentTimePoint();
+		mAvailPasses[i]->onCompileShaders();
+		mPassCompileTimes[i] = CpuTimer::calcDuration(passStart, CpuTimer::getCurrentTimePoint());
+	});
+	double totalMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+	std::string report = "Shader compilation took " + std::to_string(totalMs) + " ms:";
+	for (uint32_t i = 0; i < mAvailPasses.size(); i++)
+	{
+		if (mAvailPasses[i] && mPassCompileTimes[i] > 0.0)
 		{
-			mProfileGPUTimes[findPass++] = gpuTime;	
+			report += "\n    " + mAvailPasses[i]->getName() + ": " + std::to_string(mPassCompileTimes[i]) + " ms";
 		}
+	}
+	logInfo(report);
+}
 
-		// Move onto the next line of the string.
-		profileMsg = profileMsg.substr(endOfLine+1);
-		endOfLine = profileMsg.find('\n');
+void RenderingPipeline::setShaderCache(bool enable, const std::string& directory)
+{
+	if (mIsInitialized)
+	{
+		logWarning("RenderingPipeline::setShaderCache() must be called before the pipeline is initialized.  Call ignored.");
+		return;
 	}
+	mUseShaderCache = enable;
+	mShaderCacheDir = directory;
 }
 
+void RenderingPipeline::setSceneCache(bool enable, const std::string& directory)
+{
+	if (mIsInitialized)
+	{
+		logWarning("RenderingPipeline::setSceneCache() must be called before the pipeline is initialized.  Call ignored.");
+		return;
+	}
+	mUseSceneCache = enable;
+	mSceneCacheDir = directory;
+}
+
+void RenderingPipeline::setTextureCooking(bool enable, const std::string& directory, bool highQuality)
+{
+	if (mIsInitialized)
+	{
+		logWarning("RenderingPipeline::setTextureCooking() must be called before the pipeline is initialized.  Call ignored.");
+		return;
+	}
+	mUseTextureCooking = enable;
+	mTextureCookerDesc.directory = directory;
+	mTextureCookerDesc.highQuality = highQuality;
+}
+
+void RenderingPipeline::setTextureStreaming(bool enable, uint32_t memoryBudgetMB)
+{
+	if (mIsInitialized)
+	{
+		logWarning("RenderingPipeline::setTextureStreaming() must be called before the pipeline is initialized.  Call ignored.");
+		return;
+	}
+	mUseTextureStreaming = enable;
+	mTextureResidencyDesc.memoryBudget = uint64_t(memoryBudgetMB) * 1024 * 1024;
+}
 
 void RenderingPipeline::run(RenderingPipeline *pipe, SampleConfig &config)
 {
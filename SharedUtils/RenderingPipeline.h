@@ -20,6 +20,7 @@
 #include "Falcor.h"
 #include "RenderPass.h"
 #include "ResourceManager.h"
+#include "PipelineTimingLog.h"
 
 class RenderingPipeline : public Renderer, inherit_shared_from_this<Renderer, RenderingPipeline>
 {
@@ -49,6 +50,58 @@ public:
 	*/
 	uint32_t addPass(::RenderPass::SharedPtr pNewPass);
 
+	/** Start writing per-pass CPU/GPU timings (and rays launched) for every rendered frame to disk.  May be
+	    called before or after the renderer has been initialized.  See PipelineTimingLog for the file formats.
+	*/
+	void enableTimingExport(const PipelineTimingLog::Desc& desc = PipelineTimingLog::Desc());
+
+	/** Stop exporting timings.  Any buffered frames are flushed to disk.
+	*/
+	void disableTimingExport();
+
+	/** Play the scene's first path with the active camera attached, one of frameCount equally spaced steps per rendered frame
+	    (see ObjectPath::animateFrame()), and stop once all frameCount frames were rendered.  The camera sees the same views on
+	    every run, independent of the frame rate, so this suits benchmarks.  If exportTimings is set, per-pass timings are exported
+	    while the path plays (see enableTimingExport()), and the export stops with it unless it was already on.  May be called before
+	    the renderer has been initialized; playback starts with the first frame that has a scene.
+	*/
+	void playCameraPath(uint32_t frameCount, bool exportTimings = true);
+
+	/** Stop playing the camera path before all its frames were rendered.  See playCameraPath().
+	*/
+	void stopCameraPath();
+
+	/** Returns true while playCameraPath() is playing the camera path.
+	*/
+	bool isPlayingCameraPath() const { return mPathFrameCount > 0; }
+
+	/** Cache compiled shaders on disk, so later runs skip most of the shader compilation.  This is on by default,
+	    using a "ShaderCache" directory next to the executable.  Must be called before the pipeline is initialized.
+	*/
+	void setShaderCache(bool enable, const std::string& directory = "");
+
+	/** Cache imported models on disk, so later runs skip the Assimp import when loading a scene.  This is on by default,
+	    using a "SceneCache" directory next to the executable.  Must be called before the pipeline is initialized.
+	*/
+	void setSceneCache(bool enable, const std::string& directory = "");
+
+	/** Bake the textures of each loaded scene into block-compressed DDS files, and load the baked files instead of the source images
+	    from then on.  This is off by default; baked files go to a "TextureCache" directory next to the executable.  The first load of a
+	    scene bakes its textures, later loads use them.  Must be called before the pipeline is initialized.
+	*/
+	void setTextureCooking(bool enable, const std::string& directory = "", bool highQuality = false);
+
+	/** Stream the mip-levels of baked textures in and out of GPU memory based on what the camera sees, keeping them within a memory
+	    budget.  This is off by default, and needs texture cooking (see setTextureCooking()); textures which weren't baked yet are
+	    loaded fully.  Must be called before the pipeline is initialized.
+	*/
+	void setTextureStreaming(bool enable, uint32_t memoryBudgetMB = 512);
+
+	/** Returns how long each available pass took to compile its shaders at startup, in ms (same order as the passes
+	    were added).  Passes compile concurrently, so these overlap in time.
+	*/
+	const std::vector<double>& getPassCompileTimes() const { return mPassCompileTimes; }
+
 	/** To start running the application with this rendering pipeline, call this method
 	*/
 	static void run(RenderingPipeline *pipe, SampleConfig &config);
@@ -114,6 +167,15 @@ private:
 	// Extract profiling data
 	void extractProfilingData(void);
 
+	// (Re)build the per-pass profiler event names from the names of the currently active passes
+	void updateProfileNames(void);
+
+	// Start playing the camera path if playCameraPath() asked for it, and move the camera to the path's current frame
+	void updateCameraPath(void);
+
+	// Compile the shaders of all available passes concurrently on the worker pool, and wait until they're all done
+	void compilePassShaders(void);
+
 	enum UIOptions { CanRemove = 0x1u, CanAddAfter = 0x2u };
 
 	// Internal state
@@ -138,9 +200,34 @@ private:
 	CameraController::SharedPtr mpCameraControl;
 	GraphicsState::SharedPtr mpDefaultGfxState;
 	std::vector< std::string > mPipeDescription;            ///< Can store a description of the pipeline for display in the UI
-	std::vector< HashedString > mProfileNames;
+	std::vector< HashedString > mProfileNames;              ///< Profiler event names, one per active pass (derived from the pass names)
 	std::vector< double > mProfileGPUTimes;
     std::vector< double > mProfileLastGPUTimes;
+	PipelineTimingLog::Desc mTimingLogDesc;                 ///< Settings used when (re)creating our timing log
+	PipelineTimingLog::SharedPtr mpTimingLog;               ///< Non-null if we're exporting per-pass timings to disk
+	bool mExportTimings = false;
+
+	// Camera path playback (see playCameraPath())
+	uint32_t mPathFrameCount = 0;                           ///< Number of frames to play; 0 when we're not playing the path
+	uint32_t mPathFrame = 0;                                ///< Next frame of the path to play
+	bool mPathStarted = false;                              ///< Whether playback has started (it waits for a scene)
+	bool mPathExportTimings = false;                        ///< Export timings while the path plays
+	bool mPathOwnsTimingExport = false;                     ///< Whether playback turned the timing export on, and so turns it off again
+	bool mPathAttachedCamera = false;                       ///< Whether playback attached the camera to the path, and so detaches it again
+	int32_t mPathGuiFrameCount = 1000;                      ///< Frame count used by the "Play camera path" button
+
+	// Persistent shader cache settings
+	bool mUseShaderCache = true;
+	std::string mShaderCacheDir;                            ///< Empty to use the default location
+	bool mUseSceneCache = true;
+	std::string mSceneCacheDir;                             ///< Empty to use the default location
+	bool mUseTextureCooking = false;
+	TextureCooker::Desc mTextureCookerDesc;                 ///< An empty directory selects the default location
+	TextureCooker::SharedPtr mpTextureCooker;
+	bool mUseTextureStreaming = false;
+	TextureResidency::Desc mTextureResidencyDesc;
+	TextureStreamer::SharedPtr mpTextureStreamer;
+	std::vector<double> mPassCompileTimes;                  ///< Per-pass shader compile time at startup (ms)
 
 	// Are we storing an environment map?
 	Gui::DropdownList mEnvMapSelector;
@@ -117,6 +117,10 @@ public:
 	void setDefaultSceneName(const std::string &sceneFilename);        // Set the default scene name
 	bool userSetDefaultScene() const { return mUserSetDefaultScene; }  // Return 'true' if setDefaultSceneName() has been called
 
+	// Do passes need optional scene content (e.g., the area lights in a scene's user-defined block)?  Flags requested by all passes are combined.
+	Scene::LoadFlags getSceneLoadFlags() const { return mSceneLoadFlags; }
+	void requestSceneLoadFlags(Scene::LoadFlags flags) { mSceneLoadFlags |= flags; }
+
     // Resize the buffers to the new size, if it is different. 
     void resize(uint32_t width, uint32_t height);
 
@@ -155,6 +159,7 @@ protected:
 	// Can specify the default scene to load
 	std::string mDefaultSceneName = "Media/Arcade/Arcade.fscene";
 	bool        mUserSetDefaultScene = false;    // If the developer changes the default scene, assume they want it loaded.
+	Scene::LoadFlags mSceneLoadFlags = Scene::LoadFlags::None;   // Passed to the scene importer when loading scenes
 
 	// Falcor's callbacks structure to access basic resources of the application
 	SampleCallbacks *mpAppCallbacks;
@@ -26,7 +26,7 @@ namespace {
     //const FileDialogFilterVec kTextureExtensions = { { "hdr" }, { "png" }, { "jpg" }, { ".bmp" } };
 };
 
-Falcor::RtScene::SharedPtr loadScene( uvec2 currentScreenSize, const char *defaultFilename )
+Falcor::RtScene::SharedPtr loadScene( uvec2 currentScreenSize, const char *defaultFilename, Falcor::Scene::LoadFlags sceneLoadFlags )
 {
 	RtScene::SharedPtr pScene;
 
@@ -55,7 +55,22 @@ Falcor::RtScene::SharedPtr loadScene( uvec2 currentScreenSize, const char *defau
 	// Load a scene
 	if (hasSuffix(filename, ".fscene", false))
 	{
-		pScene = RtScene::loadFromFile(filename, RtBuildFlags::None, Model::LoadFlags::RemoveInstancing);
+		// Time the load, so we can tell how much the model cache helps (cold vs. warm loads)
+		ModelCache::Stats cacheStats = Model::getModelCache() ? Model::getModelCache()->getStats() : ModelCache::Stats();
+		CpuTimer::TimePoint loadStart = CpuTimer::getCurrentTimePoint();
+		pScene = RtScene::loadFromFile(filename, RtBuildFlags::None, Model::LoadFlags::RemoveInstancing, sceneLoadFlags);
+		double loadTimeMs = CpuTimer::calcDuration(loadStart, CpuTimer::getCurrentTimePoint());
+
+		std::string report = "Loaded scene '" + getFilenameFromPath(filename) + "' in " + std::to_string(loadTimeMs) + " ms";
+		if (Model::getModelCache())
+		{
+			const ModelCache::Stats& newStats = Model::getModelCache()->getStats();
+			uint32_t hits = newStats.hits - cacheStats.hits;
+			uint32_t models = hits + (newStats.misses - cacheStats.misses) + (newStats.staleMisses - cacheStats.staleMisses);
+			const char* loadType = (hits == 0) ? "cold" : (hits == models ? "warm" : "partially warm");
+			report += std::string(" (") + loadType + ", " + std::to_string(hits) + "/" + std::to_string(models) + " models from the model cache)";
+		}
+		logInfo(report);
 
 		// If we have a valid scene, do some sanity checking; set some defaults
 		if (pScene)
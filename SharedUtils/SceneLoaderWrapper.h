@@ -36,7 +36,8 @@
 
 // Load a scene, with an aspect ratio determined by the specified size.  If a filename is specified,
 //    load that scene.  If no filename specified, a dialog box is opened so the user can select a file to load.
-Falcor::RtScene::SharedPtr loadScene( uvec2 currentScreenSize, const char *defaultFilename = 0 );
+//    The scene load flags are passed to Falcor's scene importer (e.g., to create the user-defined area lights).
+Falcor::RtScene::SharedPtr loadScene( uvec2 currentScreenSize, const char *defaultFilename = 0, Falcor::Scene::LoadFlags sceneLoadFlags = Falcor::Scene::LoadFlags::None );
 
 
 // Opens a file dialog looking for textures.  Returns the full path name.
@@ -30,9 +30,12 @@ SimpleVars::SharedPtr SimpleVars::SimpleVars::create(Falcor::GraphicsVars *pVars
 	return SharedPtr(new SimpleVars( pVars ));
 }
 
+uint64_t SimpleVars::sNextUid = 1;   // 0 is reserved for handles that have never been resolved
+
 SimpleVars::SimpleVars(Falcor::GraphicsVars *pVars)
 {
 	mpVars = pVars;
+	mUid = sNextUid++;
 }
 
 #if 0
@@ -39,6 +39,14 @@ also use more Falcor-like syntax if you just want this class' beefed up error ch
 	hlslVars->setTexture("myTexture", myTextureResource);
 	hlslVars->setTypedBuffer("myBuffer", myBufferResource);
 
+Each hlslVars["myShaderCB"]["myVar"] looks up the variable by name.  For constants you set every frame, you
+can instead keep a handle around that does the lookup once per shader compile:
+    SimpleVars::CachedVar<float> mMyFloatVar = { "myShaderCB", "myFloatVar" };   // A class member
+	mMyFloatVar.set(hlslVars, 2.0f);                                           // Each frame
+or upload a C++ mirror of the entire constant buffer with one copy:
+    SimpleVars::CachedBlob<MyShaderCBData> mMyShaderCB = { "myShaderCB" };     // A class member
+	mMyShaderCB.set(hlslVars, myShaderCBData);                                 // Each frame
+
 The C++ code for this class, below, is ugly, confusing, and I'm not particularly proud of it.  
 However, this syntactic sugar makes my coding, debugging, and experentation so much easier that
 quite a number of people have decided to use this wrapper (or similar earlier versions I've written)
@@ -114,6 +122,104 @@ public:
 		Idx1 operator[](const std::string& var) { return Idx1(get(), var); }
 	};
 
+	// A handle to a single constant buffer variable.  The buffer's bind location is looked up the first time the
+	//     handle is used with a given SimpleVars object.  Each set() then fetches the buffer bound at that location
+	//     (an array index, not a name lookup) and redoes the offset lookup only if a different buffer is bound.
+	//     RayLaunch creates new SimpleVars objects whenever it recompiles, so the lookup is automatically redone
+	//     after a shader or define change.  The handle holds a reference to the buffer, so it never points at a
+	//     freed one.
+	template<typename T>
+	class CachedVar
+	{
+	public:
+		CachedVar(const std::string& cBuf, const std::string& var) : mCBufName(cBuf), mVarName(var) {}
+
+		// Returns false (and does nothing) if the variable does not exist in the current shader
+		bool set(const SharedPtr& pVars, const T& val)
+		{
+			if (!resolve(pVars)) return false;
+			mpCB->setVariable(mOffset, val);
+			return true;
+		}
+
+	protected:
+		bool resolve(const SharedPtr& pVars)
+		{
+			if (!pVars) return false;
+			if (pVars->getUid() != mVarsUid)
+			{
+				mVarsUid = pVars->getUid();
+				mLocation = pVars->getConstantBufferLocation(mCBufName);
+				mpCB = nullptr;
+			}
+			Falcor::ConstantBuffer::SharedPtr pCB = pVars->getConstantBuffer(mLocation);
+			if (pCB != mpCB)
+			{
+				mpCB = pCB;
+				mOffset = mpCB ? mpCB->getVariableOffset(mVarName) : Falcor::VariablesBuffer::kInvalidOffset;
+			}
+			return mpCB && (mOffset != Falcor::VariablesBuffer::kInvalidOffset);
+		}
+
+		const std::string                               mCBufName;
+		const std::string                               mVarName;
+		Falcor::ParameterBlockReflection::BindLocation  mLocation;
+		Falcor::ConstantBuffer::SharedPtr               mpCB;
+		size_t                                          mOffset = Falcor::VariablesBuffer::kInvalidOffset;
+		uint64_t                                        mVarsUid = 0;
+	};
+
+	// A handle that uploads a C++ struct mirroring an entire constant buffer with a single setBlob().  The struct
+	//     must match the HLSL packing rules (e.g., HLSL bools are 4 bytes, so mirror them with uint32_t, and
+	//     variables may not straddle a 16-byte boundary).  If a variable name is given, the blob is written
+	//     starting at that variable's offset rather than at the start of the buffer.  The buffer is tracked the
+	//     same way CachedVar tracks it.
+	template<typename T>
+	class CachedBlob
+	{
+	public:
+		CachedBlob(const std::string& cBuf, const std::string& var = "") : mCBufName(cBuf), mVarName(var) {}
+
+		// Returns false (and does nothing) if the buffer does not exist or is too small to hold a T
+		bool set(const SharedPtr& pVars, const T& blob)
+		{
+			if (!resolve(pVars)) return false;
+			mpCB->setBlob(&blob, mOffset, sizeof(T));
+			return true;
+		}
+
+	protected:
+		bool resolve(const SharedPtr& pVars)
+		{
+			if (!pVars) return false;
+			if (pVars->getUid() != mVarsUid)
+			{
+				mVarsUid = pVars->getUid();
+				mLocation = pVars->getConstantBufferLocation(mCBufName);
+				mpCB = nullptr;
+			}
+			Falcor::ConstantBuffer::SharedPtr pCB = pVars->getConstantBuffer(mLocation);
+			if (pCB != mpCB)
+			{
+				mpCB = pCB;
+				mOffset = mVarName.empty() ? 0 : (mpCB ? mpCB->getVariableOffset(mVarName) : Falcor::VariablesBuffer::kInvalidOffset);
+				if (mpCB && mOffset != Falcor::VariablesBuffer::kInvalidOffset && mOffset + sizeof(T) > mpCB->getSize())
+				{
+					Falcor::logWarning("SimpleVars::CachedBlob - blob of " + std::to_string(sizeof(T)) + " bytes does not fit in constant buffer '" + mCBufName + "'");
+					mOffset = Falcor::VariablesBuffer::kInvalidOffset;
+				}
+			}
+			return mpCB && (mOffset != Falcor::VariablesBuffer::kInvalidOffset);
+		}
+
+		const std::string                               mCBufName;
+		const std::string                               mVarName;
+		Falcor::ParameterBlockReflection::BindLocation  mLocation;
+		Falcor::ConstantBuffer::SharedPtr               mpCB;
+		size_t                                          mOffset = Falcor::VariablesBuffer::kInvalidOffset;
+		uint64_t                                        mVarsUid = 0;
+	};
+
 	// public constructors
 	static SharedPtr create( Falcor::Program::SharedPtr pProg );       // Create from a Falcor program
 	static SharedPtr create( Falcor::GraphicsVars *pVars );  
@@ -146,11 +252,30 @@ public:
 		return mpVars;
 	}
 
+	// Get the bind location of a constant buffer in the default parameter block.  Used by CachedVar and CachedBlob.
+	Falcor::ParameterBlockReflection::BindLocation getConstantBufferLocation(const std::string& cBuf)
+	{
+		return mpVars ? mpVars->getDefaultBlock()->getReflection()->getResourceBinding(cBuf) : Falcor::ParameterBlockReflection::BindLocation();
+	}
+
+	// Get the constant buffer currently bound at a location (or nullptr if there is none).  Used by CachedVar and CachedBlob.
+	Falcor::ConstantBuffer::SharedPtr getConstantBuffer(const Falcor::ParameterBlockReflection::BindLocation& location)
+	{
+		if (!mpVars || location.setIndex == Falcor::ParameterBlockReflection::BindLocation::kInvalidLocation) return nullptr;
+		return mpVars->getDefaultBlock()->getConstantBuffer(location, 0);
+	}
+
+	// A unique, never reused ID for this object.  Cached handles use this to detect when they need to redo
+	//    their lookups (comparing pointers is not safe, as a new object may get allocated at an old address).
+	uint64_t getUid() const { return mUid; }
+
 protected:
 	SimpleVars(Falcor::GraphicsVars *pVars);
 
 private:
 	Falcor::GraphicsVars*   mpVars = nullptr;
+	uint64_t                mUid;
+	static uint64_t         sNextUid;
 
 	// Internal utility function that does additional error checking beyond Falcor's built-in checks
 	//    -> returns true if shader variable [varName] exists and has type [varType]